@@ -797,6 +797,8 @@ struct chanlist {
 	const char *number;
 	/*! Original channel name.  Must be freed.  Could be NULL if allocation failed. */
 	char *orig_chan_name;
+	/*! Cause code set by ast_request() if the channel could not be created. */
+	int cause;
 	uint64_t flags;
 	/*! Saved connected party info from an AST_CONTROL_CONNECTED_LINE. */
 	struct ast_party_connected_line connected;
@@ -837,6 +839,88 @@ static void hanguptree(struct dial_head *out_chans, struct ast_channel *exceptio
 	}
 }
 
+/*!
+ * \internal
+ * \brief Arguments for requesting one destination channel in its own thread.
+ */
+struct dial_request {
+	/*! Destination to request a channel for.  The resulting channel and
+	 * cause code are stored on this entry. */
+	struct chanlist *outgoing;
+	/*! Channel requesting the dial (the caller). */
+	struct ast_channel *requestor;
+	/*! Format capabilities to request the channel with. */
+	struct ast_format_cap *cap;
+	/*! Thread performing the request or AST_PTHREADT_NULL if run inline. */
+	pthread_t thread;
+};
+
+static void *dial_request_run(void *data)
+{
+	struct dial_request *req = data;
+	struct chanlist *outgoing = req->outgoing;
+
+	outgoing->chan = ast_request(outgoing->tech, req->cap, NULL, req->requestor,
+		outgoing->number, &outgoing->cause);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Request a channel for every parsed dial destination.
+ *
+ * Requesting a channel can block on DNS or realtime lookups in the channel
+ * driver, so when dialing more than one destination each request is given
+ * its own thread and the time before ringing starts is bounded by the
+ * slowest destination instead of the sum of all of them.  A failed request
+ * leaves the entry's chan NULL with the cause code set for the caller to
+ * report.
+ */
+static void request_peers(struct dial_head *peers, struct ast_channel *chan)
+{
+	struct ast_format_cap *nativeformats;
+	struct dial_request *reqs;
+	struct chanlist *tmp;
+	int num_peers = 0;
+	int i = 0;
+
+	AST_LIST_TRAVERSE(peers, tmp, node) {
+		num_peers++;
+	}
+
+	ast_channel_lock(chan);
+	nativeformats = ao2_bump(ast_channel_nativeformats(chan));
+	ast_channel_unlock(chan);
+
+	if (num_peers == 1) {
+		tmp = AST_LIST_FIRST(peers);
+		tmp->chan = ast_request(tmp->tech, nativeformats, NULL, chan, tmp->number,
+			&tmp->cause);
+		ao2_cleanup(nativeformats);
+		return;
+	}
+
+	reqs = ast_alloca(num_peers * sizeof(*reqs));
+	AST_LIST_TRAVERSE(peers, tmp, node) {
+		reqs[i].outgoing = tmp;
+		reqs[i].requestor = chan;
+		reqs[i].cap = nativeformats;
+		if (ast_pthread_create(&reqs[i].thread, NULL, dial_request_run, &reqs[i])) {
+			/* Request this destination inline instead. */
+			reqs[i].thread = AST_PTHREADT_NULL;
+			dial_request_run(&reqs[i]);
+		}
+		i++;
+	}
+	for (i = 0; i < num_peers; i++) {
+		if (reqs[i].thread != AST_PTHREADT_NULL) {
+			pthread_join(reqs[i].thread, NULL);
+		}
+	}
+
+	ao2_cleanup(nativeformats);
+}
+
 #define AST_MAX_WATCHERS 256
 
 /*
@@ -2168,12 +2252,12 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 	int res = -1; /* default: error */
 	char *rest, *cur; /* scan the list of destinations */
 	struct dial_head out_chans = AST_LIST_HEAD_NOLOCK_INIT_VALUE; /* list of destinations */
+	struct dial_head req_chans = AST_LIST_HEAD_NOLOCK_INIT_VALUE; /* parsed destinations awaiting setup */
 	struct chanlist *outgoing;
 	struct chanlist *tmp;
 	struct ast_channel *peer;
 	int to; /* timeout */
 	struct cause_args num = { chan, 0, 0, 0 };
-	int cause;
 
 	struct ast_bridge_config config = { { 0, } };
 	struct timeval calldurationlimit = { 0, };
@@ -2454,16 +2538,14 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		ast_app_exec_sub(NULL, chan, opt_args[OPT_ARG_PREDIAL_CALLER], 0);
 	}
 
-	/* loop through the list of dial destinations */
+	/* loop through the list of dial destinations, parsing each one */
 	rest = args.peers;
 	while ((cur = strsep(&rest, "&")) ) {
-		struct ast_channel *tc; /* channel for this destination */
 		/* Get a technology/resource pair */
 		char *number = cur;
 		char *tech = strsep(&number, "/");
 		size_t tech_len;
 		size_t number_len;
-		struct ast_format_cap *nativeformats;
 
 		num_dialed++;
 		if (ast_strlen_zero(number)) {
@@ -2504,35 +2586,41 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 			ast_set2_flag64(tmp, args.url, DIAL_NOFORWARDHTML);
 		}
 
-		/* Request the peer */
-
-		ast_channel_lock(chan);
 		/*
 		 * Seed the chanlist's connected line information with previously
 		 * acquired connected line info from the incoming channel.  The
 		 * previously acquired connected line info could have been set
 		 * through the CONNECTED_LINE dialplan function.
 		 */
+		ast_channel_lock(chan);
 		ast_party_connected_line_copy(&tmp->connected, ast_channel_connected(chan));
-
-		nativeformats = ao2_bump(ast_channel_nativeformats(chan));
-
 		ast_channel_unlock(chan);
 
-		tc = ast_request(tmp->tech, nativeformats, NULL, chan, tmp->number, &cause);
+		AST_LIST_INSERT_TAIL(&req_chans, tmp, node);
+	}
 
-		ao2_cleanup(nativeformats);
+	/* Request every destination before any of them is set up, so one
+	 * destination with slow channel creation does not delay ringing for
+	 * the others. */
+	if (!AST_LIST_EMPTY(&req_chans)) {
+		request_peers(&req_chans, chan);
+	}
+
+	/* Set up each destination whose channel could be created */
+	while ((tmp = AST_LIST_REMOVE_HEAD(&req_chans, node))) {
+		struct ast_channel *tc = tmp->chan; /* channel for this destination */
 
+		tmp->chan = NULL;
 		if (!tc) {
-			/* If we can't, just go on to the next call */
+			/* If we couldn't create it, just go on to the next call */
 			ast_log(LOG_WARNING, "Unable to create channel of type '%s' (cause %d - %s)\n",
-				tmp->tech, cause, ast_cause2str(cause));
-			handle_cause(cause, &num);
-			if (!rest) {
+				tmp->tech, tmp->cause, ast_cause2str(tmp->cause));
+			handle_cause(tmp->cause, &num);
+			if (AST_LIST_EMPTY(&req_chans)) {
 				/* we are on the last destination */
-				ast_channel_hangupcause_set(chan, cause);
+				ast_channel_hangupcause_set(chan, tmp->cause);
 			}
-			if (!ignore_cc && (cause == AST_CAUSE_BUSY || cause == AST_CAUSE_CONGESTION)) {
+			if (!ignore_cc && (tmp->cause == AST_CAUSE_BUSY || tmp->cause == AST_CAUSE_CONGESTION)) {
 				if (!ast_cc_callback(chan, tmp->tech, tmp->number, ast_cc_busy_interface)) {
 					ast_cc_extension_monitor_add_dialstring(chan, tmp->interface, "");
 				}
@@ -2554,7 +2642,8 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		pbx_builtin_setvar_helper(tc, "DIALEDPEERNUMBER", tmp->number);
 
 		/* Setup outgoing SDP to match incoming one */
-		if (!AST_LIST_FIRST(&out_chans) && !rest && CAN_EARLY_BRIDGE(peerflags, chan, tc)) {
+		if (!AST_LIST_FIRST(&out_chans) && AST_LIST_EMPTY(&req_chans)
+			&& CAN_EARLY_BRIDGE(peerflags, chan, tc)) {
 			/* We are on the only destination. */
 			ast_rtp_instance_early_bridge_make_compatible(tc, chan);
 		}
@@ -3223,6 +3312,8 @@ out:
 	}
 
 	ast_channel_early_bridge(chan, NULL);
+	/* Destinations that were parsed but never dialed */
+	hanguptree(&req_chans, NULL, -1);
 	 /* forward 'answered elsewhere' if we received it */
 	hanguptree(&out_chans, NULL,
 		ast_channel_hangupcause(chan) == AST_CAUSE_ANSWERED_ELSEWHERE
@@ -237,16 +237,22 @@ static int pickup_by_channel(struct ast_channel *chan, const char *name)
 static int pickup_by_exten(struct ast_channel *chan, const char *exten, const char *context)
 {
 	struct ast_channel *target = NULL;/*!< Potential pickup target */
-	struct ast_channel_iterator *iter;
+	struct ao2_iterator iter;
 	int res = -1;
 
-	if (!(iter = ast_channel_iterator_by_exten_new(exten, context))) {
-		return -1;
-	}
-
-	while ((target = ast_channel_iterator_next(iter))) {
+	/*
+	 * Scan the pickup candidate index instead of every channel; only
+	 * ringing channels can match, and the index is a superset of those.
+	 */
+	iter = ast_pickup_candidates_iterator();
+	while ((target = ao2_iterator_next(&iter))) {
 		ast_channel_lock(target);
-		if ((chan != target) && ast_can_pickup(target)) {
+		if ((chan != target)
+			&& (!strcasecmp(ast_channel_context(target), context)
+				|| !strcasecmp(ast_channel_macrocontext(target), context))
+			&& (!strcasecmp(ast_channel_exten(target), exten)
+				|| !strcasecmp(ast_channel_macroexten(target), exten))
+			&& ast_can_pickup(target)) {
 			ast_log(LOG_NOTICE, "%s pickup by %s\n", ast_channel_name(target), ast_channel_name(chan));
 			break;
 		}
@@ -254,7 +260,7 @@ static int pickup_by_exten(struct ast_channel *chan, const char *exten, const ch
 		target = ast_channel_unref(target);
 	}
 
-	ast_channel_iterator_destroy(iter);
+	ao2_iterator_destroy(&iter);
 
 	if (target) {
 		res = ast_do_pickup(chan, target);
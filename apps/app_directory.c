@@ -39,6 +39,7 @@
 #include "asterisk/say.h"
 #include "asterisk/app.h"
 #include "asterisk/utils.h"
+#include "asterisk/astobj2.h"
 
 /*** DOCUMENTATION
 	<application name="Directory" language="en_US">
@@ -173,6 +174,55 @@ struct directory_item {
 	AST_LIST_ENTRY(directory_item) entry;
 };
 
+/*!
+ * \brief A single searchable directory entry.
+ *
+ * Entries are parsed out of the directory sources once, when a snapshot
+ * is built, instead of being re-parsed by every caller.
+ */
+struct directory_entry {
+	/*! Aliases to match when the 'a' option is enabled */
+	struct ast_variable *aliases;
+	/*! Full name of the mailbox owner */
+	char *fullname;
+	AST_LIST_ENTRY(directory_entry) list;
+	/*! Mailbox or user extension */
+	char exten[AST_MAX_EXTENSION + 1];
+};
+
+/*! \brief Searchable entries of a single voicemail context */
+struct directory_context {
+	AST_LIST_HEAD_NOLOCK(, directory_entry) entries;
+	/*! Context directoryintro prompt, if any */
+	char *dirintro;
+	AST_LIST_ENTRY(directory_context) list;
+	char name[AST_MAX_CONTEXT + 1];
+};
+
+/*!
+ * \brief Prebuilt, immutable view of the directory sources.
+ *
+ * Directory() used to re-read and re-parse voicemail.conf and users.conf
+ * on every invocation, which gets expensive with thousands of mailboxes.
+ * The parsed entries are instead kept in a refcounted snapshot shared by
+ * all callers and rebuilt only when the underlying files change or the
+ * module is reloaded.  Realtime mailboxes are inherently per-query, so
+ * installs with realtime voicemail build a private snapshot per call.
+ */
+struct directory_snapshot {
+	/*! Voicemail contexts, in configuration order */
+	AST_LIST_HEAD_NOLOCK(, directory_context) contexts;
+	/*! users.conf entries, matched against every searched context */
+	AST_LIST_HEAD_NOLOCK(, directory_entry) users;
+	/*! [general] directoryintro prompt, if any */
+	char *dirintro;
+	/*! Search every context when no context argument is given */
+	int searchcontexts;
+};
+
+/*! \brief The shared snapshot handed out to non-realtime callers */
+static AO2_GLOBAL_OBJ_STATIC(directory_cache);
+
 AST_APP_OPTIONS(directory_app_options, {
 	AST_APP_OPTION_ARG('f', OPT_LISTBYFIRSTNAME, OPT_ARG_FIRSTNAME),
 	AST_APP_OPTION_ARG('l', OPT_LISTBYLASTNAME, OPT_ARG_LASTNAME),
@@ -598,75 +648,154 @@ static int check_match(struct directory_item **result, const char *item_context,
 
 typedef AST_LIST_HEAD_NOLOCK(, directory_item) itemlist;
 
-static int search_directory_sub(const char *context, struct ast_config *vmcfg, struct ast_config *ucfg, const char *ext, struct ast_flags flags, itemlist *alist)
+static void directory_entry_free(struct directory_entry *entry)
 {
-	struct ast_variable *v;
+	ast_variables_destroy(entry->aliases);
+	ast_free(entry->fullname);
+	ast_free(entry);
+}
+
+static struct directory_entry *directory_entry_alloc(const char *exten, const char *fullname)
+{
+	struct directory_entry *entry;
+
+	if (!(entry = ast_calloc(1, sizeof(*entry)))) {
+		return NULL;
+	}
+	if (!(entry->fullname = ast_strdup(fullname))) {
+		ast_free(entry);
+		return NULL;
+	}
+	ast_copy_string(entry->exten, exten, sizeof(entry->exten));
+
+	return entry;
+}
+
+static int directory_entry_add_alias(struct directory_entry *entry, const char *alias)
+{
+	struct ast_variable **tail;
+	struct ast_variable *var;
+
+	if (!(var = ast_variable_new("alias", alias, ""))) {
+		return -1;
+	}
+	for (tail = &entry->aliases; *tail; tail = &(*tail)->next) {
+	}
+	*tail = var;
+
+	return 0;
+}
+
+static void directory_snapshot_destroy(void *obj)
+{
+	struct directory_snapshot *snap = obj;
+	struct directory_context *dc;
+	struct directory_entry *de;
+
+	while ((dc = AST_LIST_REMOVE_HEAD(&snap->contexts, list))) {
+		while ((de = AST_LIST_REMOVE_HEAD(&dc->entries, list))) {
+			directory_entry_free(de);
+		}
+		ast_free(dc->dirintro);
+		ast_free(dc);
+	}
+	while ((de = AST_LIST_REMOVE_HEAD(&snap->users, list))) {
+		directory_entry_free(de);
+	}
+	ast_free(snap->dirintro);
+}
+
+/*!
+ * \internal
+ * \brief Parse the directory sources into a snapshot.
+ *
+ * \param vmcfg Parsed voicemail.conf, possibly with realtime entries merged in.
+ * \param ucfg Parsed users.conf, or NULL if not available.
+ *
+ * \return New snapshot with a reference for the caller, or NULL on error.
+ */
+static struct directory_snapshot *directory_snapshot_build(struct ast_config *vmcfg, struct ast_config *ucfg)
+{
+	struct directory_snapshot *snap;
+	struct directory_context *dc;
+	struct directory_entry *de;
 	struct ast_str *buf = ast_str_thread_get(&commonbuf, 100);
+	struct ast_variable *v;
+	const char *searchcontexts = ast_variable_retrieve(vmcfg, "general", "searchcontexts");
+	const char *dirintro = ast_variable_retrieve(vmcfg, "general", "directoryintro");
+	const char *cat;
 	char *name;
 	char *options;
 	char *alias;
-	char *cat;
-	struct directory_item *item;
-	int res;
+	char *a;
 
 	if (!buf) {
-		return -1;
+		return NULL;
 	}
 
-	ast_debug(2, "Pattern: %s\n", ext);
-
-	for (v = ast_variable_browse(vmcfg, context); v; v = v->next) {
-		ast_str_set(&buf, 0, "%s", v->value);
-		options = ast_str_buffer(buf);
+	if (!(snap = ao2_alloc(sizeof(*snap), directory_snapshot_destroy))) {
+		return NULL;
+	}
+	snap->searchcontexts = !ast_strlen_zero(searchcontexts) && ast_true(searchcontexts);
+	if (!ast_strlen_zero(dirintro) && !(snap->dirintro = ast_strdup(dirintro))) {
+		goto failed;
+	}
 
-		/* password,Full Name,email,pager,options */
-		strsep(&options, ",");          /* Skip password */
-		name = strsep(&options, ",");   /* Save full name */
-		strsep(&options, ",");          /* Skip email */
-		strsep(&options, ",");          /* Skip pager */
-		/* options is now the options field if it exists. */
-
-		if (options && strcasestr(options, "hidefromdir=yes")) {
-			/* Ignore hidden */
-			continue;
-		}
-		if (ast_strlen_zero(name)) {
-			/* No name to compare against */
+	for (cat = ast_category_browse(vmcfg, NULL); cat; cat = ast_category_browse(vmcfg, cat)) {
+		if (!strcmp(cat, "general") || !strcmp(cat, "zonemessages")) {
 			continue;
 		}
 
-		res = 0;
-		if (ast_test_flag(&flags, OPT_LISTBYLASTNAME)) {
-			res = check_match(&item, context, name, v->name, ext, 0 /* use_first_name */);
+		if (!(dc = ast_calloc(1, sizeof(*dc)))) {
+			goto failed;
 		}
-		if (!res && ast_test_flag(&flags, OPT_LISTBYFIRSTNAME)) {
-			res = check_match(&item, context, name, v->name, ext, 1 /* use_first_name */);
+		ast_copy_string(dc->name, cat, sizeof(dc->name));
+		dirintro = ast_variable_retrieve(vmcfg, cat, "directoryintro");
+		if (!ast_strlen_zero(dirintro) && !(dc->dirintro = ast_strdup(dirintro))) {
+			ast_free(dc);
+			goto failed;
 		}
-		if (!res && ast_test_flag(&flags, OPT_ALIAS)
-			&& options && (alias = strcasestr(options, "alias="))) {
-			char *a;
+		AST_LIST_INSERT_TAIL(&snap->contexts, dc, list);
+
+		for (v = ast_variable_browse(vmcfg, cat); v; v = v->next) {
+			ast_str_set(&buf, 0, "%s", v->value);
+			options = ast_str_buffer(buf);
 
-			ast_debug(1, "Found alias: %s\n", alias);
-			while ((a = strsep(&alias, "|"))) {
-				if (!strncasecmp(a, "alias=", 6)) {
-					if ((res = check_match(&item, context, a + 6, v->name, ext, 1))) {
-						break;
+			/* password,Full Name,email,pager,options */
+			strsep(&options, ",");          /* Skip password */
+			name = strsep(&options, ",");   /* Save full name */
+			strsep(&options, ",");          /* Skip email */
+			strsep(&options, ",");          /* Skip pager */
+			/* options is now the options field if it exists. */
+
+			if (options && strcasestr(options, "hidefromdir=yes")) {
+				/* Ignore hidden */
+				continue;
+			}
+			if (ast_strlen_zero(name)) {
+				/* No name to compare against */
+				continue;
+			}
+
+			if (!(de = directory_entry_alloc(v->name, name))) {
+				goto failed;
+			}
+			if (options && (alias = strcasestr(options, "alias="))) {
+				ast_debug(1, "Found alias: %s\n", alias);
+				while ((a = strsep(&alias, "|"))) {
+					if (!strncasecmp(a, "alias=", 6)
+						&& directory_entry_add_alias(de, a + 6)) {
+						directory_entry_free(de);
+						goto failed;
 					}
 				}
 			}
+			AST_LIST_INSERT_TAIL(&dc->entries, de, list);
 		}
-
-		if (!res) {
-			continue;
-		} else if (res < 0) {
-			return -1;
-		}
-
-		AST_LIST_INSERT_TAIL(alist, item, entry);
 	}
 
 	if (ucfg) {
-		for (cat = ast_category_browse(ucfg, NULL); cat ; cat = ast_category_browse(ucfg, cat)) {
+		for (cat = ast_category_browse(ucfg, NULL); cat; cat = ast_category_browse(ucfg, cat)) {
 			const char *position;
 
 			if (!strcasecmp(cat, "general")) {
@@ -681,60 +810,191 @@ static int search_directory_sub(const char *context, struct ast_config *vmcfg, s
 				continue;
 			}
 
-			res = 0;
-			if (ast_test_flag(&flags, OPT_LISTBYLASTNAME)) {
-				res = check_match(&item, context, position, cat, ext, 0 /* use_first_name */);
+			if (!(de = directory_entry_alloc(cat, position))) {
+				goto failed;
 			}
-			if (!res && ast_test_flag(&flags, OPT_LISTBYFIRSTNAME)) {
-				res = check_match(&item, context, position, cat, ext, 1 /* use_first_name */);
+			for (v = ast_variable_browse(ucfg, cat); v; v = v->next) {
+				if (!strcasecmp(v->name, "alias")
+					&& directory_entry_add_alias(de, v->value)) {
+					directory_entry_free(de);
+					goto failed;
+				}
 			}
-			if (!res && ast_test_flag(&flags, OPT_ALIAS)) {
-				for (v = ast_variable_browse(ucfg, cat); v; v = v->next) {
-					if (!strcasecmp(v->name, "alias")
-						&& (res = check_match(&item, context, v->value, cat, ext, 1))) {
-						break;
-					}
+			AST_LIST_INSERT_TAIL(&snap->users, de, list);
+		}
+	}
+
+	return snap;
+
+failed:
+	ao2_ref(snap, -1);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Get the shared directory snapshot, rebuilding it as needed.
+ *
+ * \param use_cached Non-zero to reuse the cached snapshot when the
+ * underlying files have not changed since it was built.
+ *
+ * \return Snapshot with a reference for the caller, or NULL on error.
+ */
+static struct directory_snapshot *directory_snapshot_get(int use_cached)
+{
+	struct ast_flags config_flags = { use_cached ? CONFIG_FLAG_FILEUNCHANGED : 0 };
+	struct ast_flags no_flags = { 0 };
+	struct directory_snapshot *snap;
+	struct ast_config *vmcfg;
+	struct ast_config *ucfg;
+
+	vmcfg = ast_config_load(VOICEMAIL_CONFIG, config_flags);
+	ucfg = ast_config_load("users.conf", config_flags);
+
+	if (vmcfg == CONFIG_STATUS_FILEUNCHANGED && ucfg == CONFIG_STATUS_FILEUNCHANGED) {
+		if ((snap = ao2_global_obj_ref(directory_cache))) {
+			return snap;
+		}
+		/* The files have not changed but there is nothing cached to hand
+		 * out (an earlier rebuild failed); force a full parse. */
+		vmcfg = ast_config_load(VOICEMAIL_CONFIG, no_flags);
+		ucfg = ast_config_load("users.conf", no_flags);
+	} else if (vmcfg == CONFIG_STATUS_FILEUNCHANGED) {
+		vmcfg = ast_config_load(VOICEMAIL_CONFIG, no_flags);
+	} else if (ucfg == CONFIG_STATUS_FILEUNCHANGED) {
+		ucfg = ast_config_load("users.conf", no_flags);
+	}
+
+	if (!vmcfg) {
+		ast_log(LOG_WARNING, "Loading config failed.\n");
+	} else if (vmcfg == CONFIG_STATUS_FILEINVALID) {
+		ast_log(LOG_ERROR, "Config file %s is in an invalid format.  Aborting.\n", VOICEMAIL_CONFIG);
+		vmcfg = NULL;
+	}
+	if (ucfg == CONFIG_STATUS_FILEINVALID) {
+		ast_log(LOG_ERROR, "Config file users.conf is in an invalid format.  Aborting.\n");
+		ucfg = NULL;
+	}
+	if (!vmcfg) {
+		if (ucfg) {
+			ast_config_destroy(ucfg);
+		}
+		return NULL;
+	}
+
+	snap = directory_snapshot_build(vmcfg, ucfg);
+	if (ucfg) {
+		ast_config_destroy(ucfg);
+	}
+	ast_config_destroy(vmcfg);
+	if (snap) {
+		ao2_global_obj_replace_unref(directory_cache, snap);
+	}
+
+	return snap;
+}
+
+/*! \brief Find the directoryintro prompt for a context, if any */
+static const char *directory_snapshot_dirintro(struct directory_snapshot *snap, const char *context)
+{
+	struct directory_context *dc;
+
+	if (!ast_strlen_zero(context)) {
+		AST_LIST_TRAVERSE(&snap->contexts, dc, list) {
+			if (!strcasecmp(dc->name, context)) {
+				if (!ast_strlen_zero(dc->dirintro)) {
+					return dc->dirintro;
 				}
+				break;
 			}
+		}
+	}
 
-			if (!res) {
-				continue;
-			} else if (res < 0) {
+	return snap->dirintro;
+}
+
+static int entry_match(struct directory_entry *de, const char *context, const char *ext, struct ast_flags flags, itemlist *alist)
+{
+	struct directory_item *item;
+	struct ast_variable *alias;
+	int res = 0;
+
+	if (ast_test_flag(&flags, OPT_LISTBYLASTNAME)) {
+		res = check_match(&item, context, de->fullname, de->exten, ext, 0 /* use_first_name */);
+	}
+	if (!res && ast_test_flag(&flags, OPT_LISTBYFIRSTNAME)) {
+		res = check_match(&item, context, de->fullname, de->exten, ext, 1 /* use_first_name */);
+	}
+	if (!res && ast_test_flag(&flags, OPT_ALIAS)) {
+		for (alias = de->aliases; alias; alias = alias->next) {
+			if ((res = check_match(&item, context, alias->value, de->exten, ext, 1))) {
+				break;
+			}
+		}
+	}
+
+	if (res < 0) {
+		return -1;
+	} else if (res) {
+		AST_LIST_INSERT_TAIL(alist, item, entry);
+	}
+
+	return 0;
+}
+
+static int search_directory_sub(const char *context, struct directory_snapshot *snap, const char *ext, struct ast_flags flags, itemlist *alist)
+{
+	struct directory_context *dc;
+	struct directory_entry *de;
+
+	ast_debug(2, "Pattern: %s\n", ext);
+
+	AST_LIST_TRAVERSE(&snap->contexts, dc, list) {
+		if (!strcasecmp(dc->name, context)) {
+			break;
+		}
+	}
+	if (dc) {
+		AST_LIST_TRAVERSE(&dc->entries, de, list) {
+			if (entry_match(de, context, ext, flags, alist)) {
 				return -1;
 			}
+		}
+	}
 
-			AST_LIST_INSERT_TAIL(alist, item, entry);
+	/* users.conf entries are not tied to a voicemail context and are
+	 * candidates in every searched context. */
+	AST_LIST_TRAVERSE(&snap->users, de, list) {
+		if (entry_match(de, context, ext, flags, alist)) {
+			return -1;
 		}
 	}
+
 	return 0;
 }
 
-static int search_directory(const char *context, struct ast_config *vmcfg, struct ast_config *ucfg, const char *ext, struct ast_flags flags, itemlist *alist)
+static int search_directory(const char *context, struct directory_snapshot *snap, const char *ext, struct ast_flags flags, itemlist *alist)
 {
-	const char *searchcontexts = ast_variable_retrieve(vmcfg, "general", "searchcontexts");
 	if (ast_strlen_zero(context)) {
-		if (!ast_strlen_zero(searchcontexts) && ast_true(searchcontexts)) {
+		if (snap->searchcontexts) {
 			/* Browse each context for a match */
 			int res;
-			const char *catg;
-			for (catg = ast_category_browse(vmcfg, NULL); catg; catg = ast_category_browse(vmcfg, catg)) {
-				if (!strcmp(catg, "general") || !strcmp(catg, "zonemessages")) {
-					continue;
-				}
+			struct directory_context *dc;
 
-				if ((res = search_directory_sub(catg, vmcfg, ucfg, ext, flags, alist))) {
+			AST_LIST_TRAVERSE(&snap->contexts, dc, list) {
+				if ((res = search_directory_sub(dc->name, snap, ext, flags, alist))) {
 					return res;
 				}
 			}
 			return 0;
 		} else {
 			ast_debug(1, "Searching by category default\n");
-			return search_directory_sub("default", vmcfg, ucfg, ext, flags, alist);
+			return search_directory_sub("default", snap, ext, flags, alist);
 		}
 	} else {
 		/* Browse only the listed context for a match */
 		ast_debug(1, "Searching by category %s\n", context);
-		return search_directory_sub(context, vmcfg, ucfg, ext, flags, alist);
+		return search_directory_sub(context, snap, ext, flags, alist);
 	}
 }
 
@@ -760,7 +1020,7 @@ static void sort_items(struct directory_item **sorted, int count)
 	} while (reordered);
 }
 
-static int do_directory(struct ast_channel *chan, struct ast_config *vmcfg, struct ast_config *ucfg, char *context, char *dialcontext, char digit, int digits, struct ast_flags *flags, char *opts[])
+static int do_directory(struct ast_channel *chan, struct directory_snapshot *snap, char *context, char *dialcontext, char digit, int digits, struct ast_flags *flags, char *opts[])
 {
 	/* Read in the first three digits..  "digit" is the first digit, already read */
 	int res = 0;
@@ -783,7 +1043,7 @@ static int do_directory(struct ast_channel *chan, struct ast_config *vmcfg, stru
 	if (ast_readstring(chan, ext + 1, digits - 1, 3000, 3000, "#") < 0)
 		return -1;
 
-	res = search_directory(context, vmcfg, ucfg, ext, *flags, &alist);
+	res = search_directory(context, snap, ext, *flags, &alist);
 	if (res)
 		goto exit;
 
@@ -842,11 +1102,10 @@ exit:
 static int directory_exec(struct ast_channel *chan, const char *data)
 {
 	int res = 0, digit = 3;
-	struct ast_config *cfg, *ucfg;
+	struct directory_snapshot *snap;
 	const char *dirintro;
 	char *parse, *opts[OPT_ARG_ARRAY_SIZE] = { 0, };
 	struct ast_flags flags = { 0 };
-	struct ast_flags config_flags = { 0 };
 	enum { FIRST, LAST, BOTH } which = LAST;
 	char digits[9] = "digits/3";
 	AST_DECLARE_APP_ARGS(args,
@@ -862,19 +1121,34 @@ static int directory_exec(struct ast_channel *chan, const char *data)
 	if (args.options && ast_app_parse_options(directory_app_options, &flags, opts, args.options))
 		return -1;
 
-	if (!(cfg = realtime_directory(args.vmcontext))) {
+	if (ast_check_realtime("voicemail")) {
+		/* Realtime mailboxes are per-query, so build a private view of
+		 * the directory for this call rather than using the cache. */
+		struct ast_config *cfg, *ucfg;
+		struct ast_flags config_flags = { 0 };
+
+		if (!(cfg = realtime_directory(args.vmcontext))) {
+			ast_log(LOG_ERROR, "Unable to read the configuration data!\n");
+			return -1;
+		}
+		if ((ucfg = ast_config_load("users.conf", config_flags)) == CONFIG_STATUS_FILEINVALID) {
+			ast_log(LOG_ERROR, "Config file users.conf is in an invalid format.  Aborting.\n");
+			ucfg = NULL;
+		}
+		snap = directory_snapshot_build(cfg, ucfg);
+		if (ucfg) {
+			ast_config_destroy(ucfg);
+		}
+		ast_config_destroy(cfg);
+	} else {
+		snap = directory_snapshot_get(1);
+	}
+	if (!snap) {
 		ast_log(LOG_ERROR, "Unable to read the configuration data!\n");
 		return -1;
 	}
 
-	if ((ucfg = ast_config_load("users.conf", config_flags)) == CONFIG_STATUS_FILEINVALID) {
-		ast_log(LOG_ERROR, "Config file users.conf is in an invalid format.  Aborting.\n");
-		ucfg = NULL;
-	}
-
-	dirintro = ast_variable_retrieve(cfg, args.vmcontext, "directoryintro");
-	if (ast_strlen_zero(dirintro))
-		dirintro = ast_variable_retrieve(cfg, "general", "directoryintro");
+	dirintro = directory_snapshot_dirintro(snap, args.vmcontext);
 	/* the above prompts probably should be modified to include 0 for dialing operator
 	   and # for exiting (continues in dialplan) */
 
@@ -947,7 +1221,7 @@ static int directory_exec(struct ast_channel *chan, const char *data)
 			break;
 		}
 
-		res = do_directory(chan, cfg, ucfg, args.vmcontext, args.dialcontext, res, digit, &flags, opts);
+		res = do_directory(chan, snap, args.vmcontext, args.dialcontext, res, digit, &flags, opts);
 		if (res)
 			break;
 
@@ -958,9 +1232,7 @@ static int directory_exec(struct ast_channel *chan, const char *data)
 		}
 	}
 
-	if (ucfg)
-		ast_config_destroy(ucfg);
-	ast_config_destroy(cfg);
+	ao2_ref(snap, -1);
 
 	if (ast_check_hangup(chan)) {
 		pbx_builtin_setvar_helper(chan, "DIRECTORY_RESULT", "HANGUP");
@@ -975,13 +1247,40 @@ static int directory_exec(struct ast_channel *chan, const char *data)
 static int unload_module(void)
 {
 	int res;
+
 	res = ast_unregister_application(app);
+	ao2_global_obj_release(directory_cache);
+
 	return res;
 }
 
 static int load_module(void)
 {
+	struct directory_snapshot *snap;
+
+	/* Prime the shared snapshot.  Failure is not fatal here; it is
+	 * reported again when the application actually runs. */
+	if ((snap = directory_snapshot_get(0))) {
+		ao2_ref(snap, -1);
+	}
+
 	return ast_register_application_xml(app, directory_exec);
 }
 
-AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Extension Directory");
+static int reload(void)
+{
+	struct directory_snapshot *snap;
+
+	if ((snap = directory_snapshot_get(0))) {
+		ao2_ref(snap, -1);
+	}
+
+	return 0;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Extension Directory",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.reload = reload,
+);
@@ -479,6 +479,12 @@ static int playback_exec(struct ast_channel *chan, const char *data)
 
 		ast_stopstream(chan);
 		while (!res && (front = strsep(&back, "&"))) {
+			if (!option_say && !ast_strlen_zero(back)) {
+				/* Pull the next file in while this one plays */
+				char *next = ast_strdupa(back);
+
+				ast_stream_prefetch(strsep(&next, "&"), ast_channel_language(chan));
+			}
 			if (option_say)
 				res = say_full(chan, front, "", ast_channel_language(chan), NULL, -1, -1);
 			else
@@ -2354,6 +2354,157 @@ static void pending_members_remove(struct member *mem)
 	ao2_find(pending_members, mem, OBJ_POINTER | OBJ_NODATA | OBJ_UNLINK);
 }
 
+/*
+ * A tally of the devices (or hint extensions) queue members draw their state
+ * from. Device state events for devices that no member watches -- the bulk
+ * of the traffic on a busy system -- can then be discarded without walking
+ * every member of every queue under each queue's lock.
+ */
+static struct ao2_container *device_interests;
+#define MAX_DEVICE_INTEREST_BUCKETS 353
+
+struct device_interest {
+	/*! Number of queue members watching this device */
+	int watchers;
+	/*! Device name, or exten@context for hint based members */
+	char device[0];
+};
+
+static int device_interests_hash(const void *obj, const int flags)
+{
+	const struct device_interest *interest;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		interest = obj;
+		key = interest->device;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_case_hash(key);
+}
+
+static int device_interests_cmp(void *obj, void *arg, int flags)
+{
+	const struct device_interest *object_left = obj;
+	const struct device_interest *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->device;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(object_left->device, right_key);
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		/* Not supported by container. */
+		ast_assert(0);
+		return 0;
+	default:
+		cmp = 0;
+		break;
+	}
+	if (cmp) {
+		return 0;
+	}
+	return CMP_MATCH;
+}
+
+static void device_interest_add(const char *device)
+{
+	struct device_interest *interest;
+
+	if (!device_interests) {
+		return;
+	}
+
+	ao2_lock(device_interests);
+	interest = ao2_find(device_interests, device, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!interest) {
+		interest = ao2_alloc_options(sizeof(*interest) + strlen(device) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!interest) {
+			ao2_unlock(device_interests);
+			return;
+		}
+		strcpy(interest->device, device); /* Safe */
+		ao2_link_flags(device_interests, interest, OBJ_NOLOCK);
+	}
+	interest->watchers++;
+	ao2_unlock(device_interests);
+	ao2_ref(interest, -1);
+}
+
+static void device_interest_remove(const char *device)
+{
+	struct device_interest *interest;
+
+	if (!device_interests) {
+		return;
+	}
+
+	ao2_lock(device_interests);
+	interest = ao2_find(device_interests, device, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (interest) {
+		if (!--interest->watchers) {
+			ao2_unlink_flags(device_interests, interest, OBJ_NOLOCK);
+		}
+		ao2_ref(interest, -1);
+	}
+	ao2_unlock(device_interests);
+}
+
+static int device_interest_exists(const char *device)
+{
+	struct device_interest *interest;
+
+	if (!device_interests) {
+		/* Play it safe and let the queues be scanned */
+		return 1;
+	}
+
+	interest = ao2_find(device_interests, device, OBJ_SEARCH_KEY);
+	if (!interest) {
+		return 0;
+	}
+	ao2_ref(interest, -1);
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Get the key a member's state source is tracked under in \ref device_interests.
+ *
+ * For device state based members this is the device name aggregate device
+ * state events will carry, mirroring the matching in device_state_cb().
+ * For hint based members it is "exten@context" as matched in
+ * extension_state_cb().
+ */
+static void member_get_interest_key(const struct member *mem, char *buf, size_t len)
+{
+	char *slash_pos;
+
+	if (!ast_strlen_zero(mem->state_exten)) {
+		snprintf(buf, len, "%s@%s", mem->state_exten, mem->state_context);
+		return;
+	}
+
+	ast_copy_string(buf, mem->state_interface, len);
+	if ((slash_pos = strchr(buf, '/'))) {
+		if (!strncasecmp(buf, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
+			*slash_pos = '\0';
+		}
+	}
+}
+
 /*! \brief set a member's status based on device state of that member's state_interface.
  *
  * Lock interface list find sc, iterate through each queues queue_member list for member to
@@ -2424,7 +2575,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	struct ast_device_state_message *dev_state;
 	struct member *m;
 	struct call_queue *q;
-	char interface[80], *slash_pos;
+	char interface[80];
 	int found = 0;			/* Found this member in any queue */
 	int found_member;		/* Found this member in this queue */
 	int avail = 0;			/* Found an available member in this queue */
@@ -2439,6 +2590,14 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
+	if (!device_interest_exists(dev_state->device)) {
+		ast_debug(3, "Device '%s' changed to state '%u' (%s) but we don't care because they're not a member of any queue.\n",
+			dev_state->device,
+			dev_state->state,
+			ast_devstate2str(dev_state->state));
+		return;
+	}
+
 	qiter = ao2_iterator_init(queues, 0);
 	while ((q = ao2_t_iterator_next(&qiter, "Iterate over queues"))) {
 		ao2_lock(q);
@@ -2448,13 +2607,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		miter = ao2_iterator_init(q->members, 0);
 		for (; (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
 			if (!found_member) {
-				ast_copy_string(interface, m->state_interface, sizeof(interface));
-
-				if ((slash_pos = strchr(interface, '/'))) {
-					if (!strncasecmp(interface, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
-						*slash_pos = '\0';
-					}
-				}
+				member_get_interest_key(m, interface, sizeof(interface));
 
 				if (!strcasecmp(interface, dev_state->device)) {
 					found_member = 1;
@@ -2541,6 +2694,7 @@ static int extension_state_cb(const char *context, const char *exten, struct ast
 	struct ao2_iterator miter, qiter;
 	struct member *m;
 	struct call_queue *q;
+	char key[AST_MAX_EXTENSION + AST_MAX_CONTEXT];
 	int state = info->exten_state;
 	int found = 0, device_state = extensionstate2devicestate(state);
 
@@ -2549,6 +2703,13 @@ static int extension_state_cb(const char *context, const char *exten, struct ast
 		return 0;
 	}
 
+	snprintf(key, sizeof(key), "%s@%s", exten, context);
+	if (!device_interest_exists(key)) {
+		ast_debug(3, "Extension '%s@%s' changed to state '%d' (%s) but we don't care because they're not a member of any queue.\n",
+			exten, context, device_state, ast_devstate2str(device_state));
+		return 0;
+	}
+
 	qiter = ao2_iterator_init(queues, 0);
 	while ((q = ao2_t_iterator_next(&qiter, "Iterate through queues"))) {
 		ao2_lock(q);
@@ -2585,12 +2746,22 @@ static int get_queue_member_status(struct member *cur)
 	return ast_strlen_zero(cur->state_exten) ? ast_device_state(cur->state_interface) : extensionstate2devicestate(ast_extension_state(NULL, cur->state_context, cur->state_exten));
 }
 
+static void member_destructor(void *obj)
+{
+	struct member *mem = obj;
+	char key[AST_MAX_EXTENSION + AST_MAX_CONTEXT];
+
+	member_get_interest_key(mem, key, sizeof(key));
+	device_interest_remove(key);
+}
+
 /*! \brief allocate space for new queue member and set fields based on parameters passed */
 static struct member *create_queue_member(const char *interface, const char *membername, int penalty, int paused, const char *state_interface, int ringinuse)
 {
 	struct member *cur;
+	char key[AST_MAX_EXTENSION + AST_MAX_CONTEXT];
 
-	if ((cur = ao2_alloc(sizeof(*cur), NULL))) {
+	if ((cur = ao2_alloc(sizeof(*cur), member_destructor))) {
 		cur->ringinuse = ringinuse;
 		cur->penalty = penalty;
 		cur->paused = paused;
@@ -2619,6 +2790,9 @@ static struct member *create_queue_member(const char *interface, const char *mem
 			ast_copy_string(cur->state_context, S_OR(context, "default"), sizeof(cur->state_context));
 		}
 		cur->status = get_queue_member_status(cur);
+
+		member_get_interest_key(cur, key, sizeof(key));
+		device_interest_add(key);
 	}
 
 	return cur;
@@ -11047,6 +11221,11 @@ static int unload_module(void)
 	ao2_cleanup(queues);
 	ao2_cleanup(pending_members);
 
+	/* Must outlive the queues and pending members, whose member destructors
+	 * drop their device interests */
+	ao2_cleanup(device_interests);
+	device_interests = NULL;
+
 	queues = NULL;
 	return 0;
 }
@@ -11081,6 +11260,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	device_interests = ao2_container_alloc(
+		MAX_DEVICE_INTEREST_BUCKETS, device_interests_hash, device_interests_cmp);
+	if (!device_interests) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	use_weight = 0;
 
 	if (reload_handler(0, &mask, NULL)) {
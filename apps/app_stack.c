@@ -39,6 +39,7 @@
 #include "asterisk/channel.h"
 #include "asterisk/agi.h"
 #include "asterisk/stasis_channels.h"
+#include "asterisk/threadstorage.h"
 
 /*** DOCUMENTATION
 	<application name="Gosub" language="en_US">
@@ -251,12 +252,48 @@ struct gosub_stack_frame {
 	unsigned int is_special:1;
 	/*! Whether or not we were in a subroutine when this one was created */
 	unsigned int in_subroutine:1;
+	/*! TRUE if the frame is the fixed pooled size and may be cached for reuse */
+	unsigned int pooled:1;
 	char *context;
 	char extension[0];
 };
 
 AST_LIST_HEAD(gosub_stack_list, gosub_stack_frame);
 
+/*!
+ * \brief Per-thread cache of released stack frames.
+ *
+ * A typical call setup runs tens of Gosubs, each of which used to malloc
+ * and free its frame.  Frames whose extension and context fit the inline
+ * storage are instead a fixed size and, once released, parked on the
+ * releasing thread's free list for the next Gosub to pick up without
+ * touching the allocator or any lock.  Oversized frames keep the old
+ * exact-size allocation and are never cached.
+ */
+struct gosub_frame_pool {
+	AST_LIST_HEAD_NOLOCK(, gosub_stack_frame) free_frames;
+	unsigned int count;
+};
+
+/*! \brief Inline extension + context storage in a pooled frame */
+#define GOSUB_FRAME_INLINE_STORAGE 64
+
+/*! \brief Most released frames cached per thread */
+#define GOSUB_FRAME_POOL_MAX 10
+
+static void gosub_frame_pool_cleanup(void *data)
+{
+	struct gosub_frame_pool *pool = data;
+	struct gosub_stack_frame *frame;
+
+	while ((frame = AST_LIST_REMOVE_HEAD(&pool->free_frames, entries))) {
+		ast_free(frame);
+	}
+	ast_free(pool);
+}
+
+AST_THREADSTORAGE_CUSTOM(gosub_frame_pool_storage, NULL, gosub_frame_pool_cleanup);
+
 static int frame_set_var(struct ast_channel *chan, struct gosub_stack_frame *frame, const char *var, const char *value)
 {
 	struct ast_var_t *variables;
@@ -303,10 +340,20 @@ static void gosub_release_frame(struct ast_channel *chan, struct gosub_stack_fra
 	 */
 	while ((vardata = AST_LIST_REMOVE_HEAD(&frame->varshead, entries))) {
 		if (chan)
-			pbx_builtin_setvar_helper(chan, ast_var_name(vardata), NULL);	
+			pbx_builtin_setvar_helper(chan, ast_var_name(vardata), NULL);
 		ast_var_delete(vardata);
 	}
 
+	if (frame->pooled) {
+		struct gosub_frame_pool *pool;
+
+		pool = ast_threadstorage_get(&gosub_frame_pool_storage, sizeof(*pool));
+		if (pool && pool->count < GOSUB_FRAME_POOL_MAX) {
+			AST_LIST_INSERT_HEAD(&pool->free_frames, frame, entries);
+			pool->count++;
+			return;
+		}
+	}
 	ast_free(frame);
 }
 
@@ -315,7 +362,25 @@ static struct gosub_stack_frame *gosub_allocate_frame(const char *context, const
 	struct gosub_stack_frame *new = NULL;
 	int len_extension = strlen(extension), len_context = strlen(context);
 
-	if ((new = ast_calloc(1, sizeof(*new) + 2 + len_extension + len_context))) {
+	if (len_extension + len_context + 2 <= GOSUB_FRAME_INLINE_STORAGE) {
+		struct gosub_frame_pool *pool;
+
+		pool = ast_threadstorage_get(&gosub_frame_pool_storage, sizeof(*pool));
+		if (pool && (new = AST_LIST_REMOVE_HEAD(&pool->free_frames, entries))) {
+			pool->count--;
+			memset(new, 0, sizeof(*new));
+		}
+		if (!new) {
+			new = ast_calloc(1, sizeof(*new) + GOSUB_FRAME_INLINE_STORAGE);
+		}
+		if (new) {
+			new->pooled = 1;
+		}
+	} else {
+		new = ast_calloc(1, sizeof(*new) + 2 + len_extension + len_context);
+	}
+
+	if (new) {
 		AST_LIST_HEAD_INIT_NOLOCK(&new->varshead);
 		strcpy(new->extension, extension);
 		new->context = new->extension + len_extension + 1;
@@ -1024,6 +1024,16 @@ static void mwi_sub_task_dtor(struct mwi_sub_task *mwist)
 
 static struct ast_taskprocessor *mwi_subscription_tps;
 
+/*! \brief Number of taskprocessors initial mailbox scans are spread across.
+ *
+ * Establishing MWI for a freshly subscribed mailbox means counting its
+ * folders on disk.  At startup every known mailbox subscribes at once, and
+ * doing those scans one after another on the subscription taskprocessor can
+ * hold up MWI for minutes on large spools.
+ */
+#define MWI_SCAN_TPS_COUNT 4
+static struct ast_taskprocessor *mwi_scan_tps[MWI_SCAN_TPS_COUNT];
+
 static AST_RWLIST_HEAD_STATIC(mwi_subs, mwi_sub);
 
 /* custom audio control prompts for voicemail playback */
@@ -1212,6 +1222,98 @@ static int inprocess_count(const char *context, const char *mailbox, int delta)
 
 #if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
 static int __has_voicemail(const char *context, const char *mailbox, const char *folder, int shortcircuit);
+
+/*
+ * Counting a folder means reading its whole directory, which mailbox polling
+ * and MWI checks do constantly.  Cache the per-folder counts keyed on the
+ * directory's modification time: leaving, moving or deleting a message
+ * touches the directory, so a single stat() tells us whether the cached
+ * count can still be trusted, no matter who changed the mailbox.
+ */
+struct ao2_container *folder_count_cache;
+
+struct folder_count {
+	/*! Modification time of the folder directory when it was counted */
+	time_t mtime;
+	/*! Number of messages in the folder */
+	int count;
+	/*! Full spool path of the folder */
+	char dir[0];
+};
+
+static int folder_count_hash_fn(const void *obj, const int flags)
+{
+	const struct folder_count *f = obj;
+	return ast_str_hash(f->dir);
+}
+
+static int folder_count_cmp_fn(void *obj, void *arg, int flags)
+{
+	struct folder_count *f = obj, *g = arg;
+	return strcmp(f->dir, g->dir) ? 0 : CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Fetch the cached count for a folder, or -1 when the cache cannot help.
+ */
+static int folder_count_get(const char *dir, const struct stat *st)
+{
+	struct folder_count *f, *arg = ast_alloca(sizeof(*arg) + strlen(dir) + 1);
+	int count = -1;
+
+	if (!folder_count_cache) {
+		return -1;
+	}
+
+	strcpy(arg->dir, dir); /* SAFE */
+	if ((f = ao2_find(folder_count_cache, arg, 0))) {
+		if (f->mtime == st->st_mtime) {
+			count = f->count;
+		} else {
+			ao2_unlink(folder_count_cache, f);
+		}
+		ao2_ref(f, -1);
+	}
+
+	return count;
+}
+
+/*!
+ * \internal
+ * \brief Remember the count for a folder as of the given directory state.
+ */
+static void folder_count_put(const char *dir, const struct stat *st, int count)
+{
+	struct folder_count *f, *dup;
+
+	if (!folder_count_cache) {
+		return;
+	}
+
+	/* If the directory changed this very second, another change could
+	 * still slip in without advancing the mtime; don't trust it yet. */
+	if (st->st_mtime >= time(NULL) - 1) {
+		return;
+	}
+
+	if (!(f = ao2_alloc(sizeof(*f) + strlen(dir) + 1, NULL))) {
+		return;
+	}
+	f->mtime = st->st_mtime;
+	f->count = count;
+	strcpy(f->dir, dir); /* SAFE */
+
+	ao2_lock(folder_count_cache);
+	if ((dup = ao2_find(folder_count_cache, f, OBJ_NOLOCK))) {
+		/* Somebody else counted it in the meantime; keep theirs */
+		ao2_ref(dup, -1);
+	} else {
+		ao2_link_flags(folder_count_cache, f, OBJ_NOLOCK);
+	}
+	ao2_unlock(folder_count_cache);
+	ao2_ref(f, -1);
+}
 #endif
 
 /*!
@@ -5970,6 +6072,8 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 	DIR *dir;
 	struct dirent *de;
 	char fn[256];
+	struct stat st;
+	int have_st;
 	int ret = 0;
 
 	/* If no mailbox, return immediately */
@@ -5983,6 +6087,17 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	snprintf(fn, sizeof(fn), "%s%s/%s/%s", VM_SPOOL_DIR, context, mailbox, folder);
 
+	/* A message cannot appear or disappear without changing the directory's
+	 * mtime, so one stat() tells whether the cached count is still good. */
+	have_st = !stat(fn, &st);
+	if (have_st) {
+		ret = folder_count_get(fn, &st);
+		if (ret >= 0) {
+			return shortcircuit ? ret > 0 : ret;
+		}
+		ret = 0;
+	}
+
 	if (!(dir = opendir(fn)))
 		return 0;
 
@@ -5999,6 +6114,10 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	closedir(dir);
 
+	if (!shortcircuit && have_st) {
+		folder_count_put(fn, &st, ret);
+	}
+
 	return ret;
 }
 
@@ -13120,6 +13239,54 @@ static int handle_unsubscribe(void *datap)
 	return 0;
 }
 
+/*! \brief Establish the initial state of one freshly subscribed mailbox.
+ *
+ * Runs on one of the \ref mwi_scan_tps taskprocessors.  The subscription may
+ * already be gone again by the time this runs, in which case there is nobody
+ * left to tell and the scan is simply skipped.
+ */
+static int handle_initial_scan(void *datap)
+{
+	char *mailbox = datap;
+	struct mwi_sub *mwi_sub;
+
+	AST_RWLIST_RDLOCK(&mwi_subs);
+	AST_RWLIST_TRAVERSE(&mwi_subs, mwi_sub, entry) {
+		if (!strcmp(mwi_sub->mailbox, mailbox)) {
+			poll_subscribed_mailbox(mwi_sub);
+			break;
+		}
+	}
+	AST_RWLIST_UNLOCK(&mwi_subs);
+
+	ast_free(mailbox);
+	return 0;
+}
+
+/*! \brief Spread initial mailbox scans round robin over the scan taskprocessors. */
+static int queue_initial_scan(const char *mailbox)
+{
+	static int next_tps = 0;
+	struct ast_taskprocessor *tps;
+	char *mb;
+
+	tps = mwi_scan_tps[ast_atomic_fetchadd_int(&next_tps, +1) % MWI_SCAN_TPS_COUNT];
+	if (!tps) {
+		return -1;
+	}
+
+	if (!(mb = ast_strdup(mailbox))) {
+		return -1;
+	}
+
+	if (ast_taskprocessor_push(tps, handle_initial_scan, mb) < 0) {
+		ast_free(mb);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int handle_subscribe(void *datap)
 {
 	unsigned int len;
@@ -13149,7 +13316,10 @@ static int handle_subscribe(void *datap)
 	AST_RWLIST_INSERT_TAIL(&mwi_subs, mwi_sub, entry);
 	AST_RWLIST_UNLOCK(&mwi_subs);
 	mwi_sub_task_dtor(p);
-	poll_subscribed_mailbox(mwi_sub);
+	if (queue_initial_scan(mwi_sub->mailbox)) {
+		/* No scan pool; do it here like we used to */
+		poll_subscribed_mailbox(mwi_sub);
+	}
 	return 0;
 }
 
@@ -14900,6 +15070,7 @@ static int reload(void)
 static int unload_module(void)
 {
 	int res;
+	int x;
 
 	res = ast_unregister_application(app);
 	res |= ast_unregister_application(app2);
@@ -14932,6 +15103,13 @@ static int unload_module(void)
 		stop_poll_thread();
 
 	mwi_subscription_tps = ast_taskprocessor_unreference(mwi_subscription_tps);
+	for (x = 0; x < MWI_SCAN_TPS_COUNT; x++) {
+		mwi_scan_tps[x] = ast_taskprocessor_unreference(mwi_scan_tps[x]);
+	}
+#if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	ao2_cleanup(folder_count_cache);
+	folder_count_cache = NULL;
+#endif
 	ast_unload_realtime("voicemail");
 	ast_unload_realtime("voicemail_data");
 
@@ -14957,6 +15135,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	int res;
+	int x;
 	my_umask = umask(0);
 	umask(my_umask);
 
@@ -14971,6 +15150,21 @@ static int load_module(void)
 		ast_log(AST_LOG_WARNING, "failed to reference mwi subscription taskprocessor.  MWI will not work\n");
 	}
 
+	for (x = 0; x < MWI_SCAN_TPS_COUNT; x++) {
+		char tps_name[64];
+
+		snprintf(tps_name, sizeof(tps_name), "app_voicemail_scan/%d", x);
+		if (!(mwi_scan_tps[x] = ast_taskprocessor_get(tps_name, 0))) {
+			ast_log(AST_LOG_WARNING, "failed to reference mailbox scan taskprocessor '%s'.  Initial MWI scans will not be parallelized\n", tps_name);
+		}
+	}
+
+#if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	if (!(folder_count_cache = ao2_container_alloc(997, folder_count_hash_fn, folder_count_cmp_fn))) {
+		ast_log(AST_LOG_WARNING, "failed to create the folder count cache.  Mailbox polls will always read the spool\n");
+	}
+#endif
+
 	if ((res = load_config(0))) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
@@ -52,6 +52,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/timing.h"
 #include "asterisk/translate.h"
+#include "asterisk/sdt.h"
 
 #define MAX_DATALEN 8096
 
@@ -70,6 +71,16 @@
 /*! \brief Number of mixing iterations to perform between gathering statistics. */
 #define SOFTMIX_STAT_INTERVAL 100
 
+/*! \brief Participant count at which the mixing loop fans out to helper mixing threads. */
+#define SOFTMIX_MIX_WORKER_THRESHOLD 32
+
+/*! \brief Maximum number of helper mixing threads per bridge.
+ *
+ * The mixing thread itself also mixes a shard, so the mix is spread
+ * across at most one more than this many threads.
+ */
+#define SOFTMIX_MAX_MIX_WORKERS 3
+
 /* This is the threshold in ms at which a channel's own audio will stop getting
  * mixed out its own write audio stream because it is not talking. */
 #define DEFAULT_SOFTMIX_SILENCE_THRESHOLD 2500
@@ -77,6 +88,163 @@
 
 #define DEFAULT_ENERGY_HISTORY_LEN 150
 
+/*!
+ * \internal
+ * \brief Saturated slinear mixing kernels.
+ *
+ * The mixing loop and the per-channel "remove my own audio" pass account
+ * for nearly all of this module's CPU on large conferences.  Both are
+ * saturating 16-bit adds/subtracts over contiguous buffers, which map
+ * directly onto the packed saturating instructions every mainstream ISA
+ * provides (PADDSW/PSUBSW on x86, VQADD/VQSUB on ARM).  The kernels below
+ * are selected once at module load based on what the running CPU supports
+ * and fall back to the scalar helpers from utils.h otherwise.
+ */
+typedef void (*softmix_mix_fn)(int16_t *dst, int16_t *src, unsigned int samples);
+
+static void softmix_mix_add_scalar(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_add(&dst[i], &src[i]);
+	}
+}
+
+static void softmix_mix_subtract_scalar(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_subtract(&dst[i], &src[i]);
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#define SOFTMIX_HAVE_X86_KERNELS 1
+
+#include <immintrin.h>
+
+static __attribute__((target("sse2"))) void softmix_mix_add_sse2(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i d = _mm_loadu_si128((__m128i *) &dst[i]);
+		__m128i s = _mm_loadu_si128((__m128i *) &src[i]);
+
+		_mm_storeu_si128((__m128i *) &dst[i], _mm_adds_epi16(d, s));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_add(&dst[i], &src[i]);
+	}
+}
+
+static __attribute__((target("sse2"))) void softmix_mix_subtract_sse2(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i d = _mm_loadu_si128((__m128i *) &dst[i]);
+		__m128i s = _mm_loadu_si128((__m128i *) &src[i]);
+
+		_mm_storeu_si128((__m128i *) &dst[i], _mm_subs_epi16(d, s));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_subtract(&dst[i], &src[i]);
+	}
+}
+
+static __attribute__((target("avx2"))) void softmix_mix_add_avx2(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i d = _mm256_loadu_si256((__m256i *) &dst[i]);
+		__m256i s = _mm256_loadu_si256((__m256i *) &src[i]);
+
+		_mm256_storeu_si256((__m256i *) &dst[i], _mm256_adds_epi16(d, s));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_add(&dst[i], &src[i]);
+	}
+}
+
+static __attribute__((target("avx2"))) void softmix_mix_subtract_avx2(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= samples; i += 16) {
+		__m256i d = _mm256_loadu_si256((__m256i *) &dst[i]);
+		__m256i s = _mm256_loadu_si256((__m256i *) &src[i]);
+
+		_mm256_storeu_si256((__m256i *) &dst[i], _mm256_subs_epi16(d, s));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_subtract(&dst[i], &src[i]);
+	}
+}
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+#define SOFTMIX_HAVE_NEON_KERNELS 1
+
+#include <arm_neon.h>
+
+static void softmix_mix_add_neon(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		vst1q_s16(&dst[i], vqaddq_s16(vld1q_s16(&dst[i]), vld1q_s16(&src[i])));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_add(&dst[i], &src[i]);
+	}
+}
+
+static void softmix_mix_subtract_neon(int16_t *dst, int16_t *src, unsigned int samples)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		vst1q_s16(&dst[i], vqsubq_s16(vld1q_s16(&dst[i]), vld1q_s16(&src[i])));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_subtract(&dst[i], &src[i]);
+	}
+}
+
+#endif
+
+/*! \brief Kernel used to mix a participant's audio into the common buffer */
+static softmix_mix_fn softmix_mix_add = softmix_mix_add_scalar;
+
+/*! \brief Kernel used to remove a participant's own audio from its write buffer */
+static softmix_mix_fn softmix_mix_subtract = softmix_mix_subtract_scalar;
+
+/*!
+ * \internal
+ * \brief Select the widest mixing kernels the running CPU supports.
+ */
+static void softmix_mix_init(void)
+{
+#if defined(SOFTMIX_HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		softmix_mix_add = softmix_mix_add_avx2;
+		softmix_mix_subtract = softmix_mix_subtract_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		softmix_mix_add = softmix_mix_add_sse2;
+		softmix_mix_subtract = softmix_mix_subtract_sse2;
+	}
+#elif defined(SOFTMIX_HAVE_NEON_KERNELS)
+	softmix_mix_add = softmix_mix_add_neon;
+	softmix_mix_subtract = softmix_mix_subtract_neon;
+#endif
+}
+
 struct video_follow_talker_data {
 	/*! audio energy history */
 	int energy_history[DEFAULT_ENERGY_HISTORY_LEN];
@@ -118,6 +286,22 @@ struct softmix_channel {
 	struct video_follow_talker_data video_talker;
 };
 
+struct softmix_bridge_data;
+
+/*! \brief Helper thread mixing one shard of a large conference */
+struct softmix_mix_worker {
+	/*! Thread handling this shard */
+	pthread_t thread;
+	/*! Back pointer to the owning bridge data */
+	struct softmix_bridge_data *softmix_data;
+	/*! Which shard of the mixing array this worker owns */
+	unsigned int idx;
+	/*! Last job generation this worker has picked up */
+	unsigned int generation;
+	/*! Partial mix accumulated by this worker for the current job */
+	int16_t partial_buf[MAX_DATALEN];
+};
+
 struct softmix_bridge_data {
 	struct ast_timer *timer;
 	/*!
@@ -136,8 +320,32 @@ struct softmix_bridge_data {
 	pthread_t thread;
 	unsigned int internal_rate;
 	unsigned int internal_mixing_interval;
+	/*! Lock coordinating the helper mixing workers */
+	ast_mutex_t mix_lock;
+	/*! Condition the helper workers wait on for a new job */
+	ast_cond_t mix_cond;
+	/*! Condition the mixing thread waits on for the workers to finish */
+	ast_cond_t mix_done_cond;
+	/*! Mixing array buffers of the currently published job */
+	int16_t **mix_buffers;
+	/*! Number of used entries in the published mixing array */
+	unsigned int mix_used_entries;
+	/*! Samples per buffer in the published job */
+	unsigned int mix_samples;
+	/*! Job generation counter; bumping it publishes a new job */
+	unsigned int mix_generation;
+	/*! Number of workers still mixing the current job */
+	unsigned int mix_pending;
+	/*! Helper mixing workers; started the first time the bridge grows large */
+	struct softmix_mix_worker *mix_workers;
+	/*! Number of helper mixing workers actually running */
+	unsigned int num_mix_workers;
 	/*! TRUE if the mixing thread should stop */
 	unsigned int stop:1;
+	/*! TRUE if the helper mixing workers should stop (under mix_lock) */
+	unsigned int mix_stop:1;
+	/*! TRUE once starting helper workers has been attempted */
+	unsigned int mix_workers_started:1;
 };
 
 struct softmix_stats {
@@ -260,20 +468,24 @@ static int16_t *softmix_process_read_audio(struct softmix_channel *sc, unsigned
  * \details This function will remove the channel's talking from its own audio if present and
  * possibly even do the channel's write translation for it depending on how many other
  * channels use the same write format.
+ *
+ * The common mix is passed in \a mix_buf and is only copied into the channel's
+ * own buffer when this channel actually needs a private copy: talkers that
+ * subtract their own audio, and channels for which no shared encode exists.
+ * Channels sharing an encode translate straight out of the mix buffer once
+ * and only the (much smaller) encoded payload is copied per participant.
  */
 static void softmix_process_write_audio(struct softmix_translate_helper *trans_helper,
 	struct ast_format *raw_write_fmt,
-	struct softmix_channel *sc)
+	struct softmix_channel *sc, const int16_t *mix_buf)
 {
 	struct softmix_translate_helper_entry *entry = NULL;
-	int i;
 
 	/* If we provided audio that was not determined to be silence,
 	 * then take it out while in slinear format. */
 	if (sc->have_audio && sc->talking) {
-		for (i = 0; i < sc->write_frame.samples; i++) {
-			ast_slinear_saturated_subtract(&sc->final_buf[i], &sc->our_buf[i]);
-		}
+		memcpy(sc->final_buf, mix_buf, sc->write_frame.datalen);
+		softmix_mix_subtract(sc->final_buf, sc->our_buf, sc->write_frame.samples);
 		/* check to see if any entries exist for the format. if not we'll want
 		   to remove it during cleanup */
 		AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
@@ -302,13 +514,19 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 			entry->trans_pvt = ast_translator_build_path(entry->dst_format, trans_helper->slin_src);
 		}
 		if (entry->trans_pvt && !entry->out_frame) {
-			entry->out_frame = ast_translate(entry->trans_pvt, &sc->write_frame, 0);
+			/* Encode the common mix once, straight out of the mix buffer;
+			 * every other channel sharing this entry reuses the result. */
+			struct ast_frame mix_frame = sc->write_frame;
+
+			mix_frame.data.ptr = (void *) mix_buf;
+			entry->out_frame = ast_translate(entry->trans_pvt, &mix_frame, 0);
 		}
 		if (entry->out_frame && (entry->out_frame->datalen < MAX_DATALEN)) {
 			ao2_replace(sc->write_frame.subclass.format, entry->out_frame->subclass.format);
 			memcpy(sc->final_buf, entry->out_frame->data.ptr, entry->out_frame->datalen);
 			sc->write_frame.datalen = entry->out_frame->datalen;
 			sc->write_frame.samples = entry->out_frame->samples;
+			return;
 		}
 		break;
 	}
@@ -317,6 +535,10 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 	if (!entry && (entry = softmix_translate_helper_entry_alloc(raw_write_fmt))) {
 		AST_LIST_INSERT_HEAD(&trans_helper->entries, entry, entry);
 	}
+
+	/* No shared encode was available for this channel, so it gets the
+	 * slinear mix and its own write path does any translation needed. */
+	memcpy(sc->final_buf, mix_buf, sc->write_frame.datalen);
 }
 
 static void softmix_translate_helper_cleanup(struct softmix_translate_helper *trans_helper)
@@ -897,6 +1119,146 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Helper mixing worker thread.
+ *
+ * Waits for the mixing thread to publish a job, mixes every
+ * num_mix_workers + 1'th participant starting at its own offset into a
+ * private partial buffer, and reports completion.  The stride keeps each
+ * worker touching the same stable subset of participant buffers from one
+ * interval to the next, which keeps those buffers warm in that worker's
+ * cache.
+ */
+static void *softmix_mix_worker_thread(void *data)
+{
+	struct softmix_mix_worker *worker = data;
+	struct softmix_bridge_data *softmix_data = worker->softmix_data;
+
+	ast_mutex_lock(&softmix_data->mix_lock);
+	while (!softmix_data->mix_stop) {
+		unsigned int stride = softmix_data->num_mix_workers + 1;
+		unsigned int used_entries;
+		unsigned int samples;
+		unsigned int idx;
+		int16_t **buffers;
+
+		if (worker->generation == softmix_data->mix_generation) {
+			ast_cond_wait(&softmix_data->mix_cond, &softmix_data->mix_lock);
+			continue;
+		}
+		worker->generation = softmix_data->mix_generation;
+		buffers = softmix_data->mix_buffers;
+		used_entries = softmix_data->mix_used_entries;
+		samples = softmix_data->mix_samples;
+		ast_mutex_unlock(&softmix_data->mix_lock);
+
+		memset(worker->partial_buf, 0, samples * sizeof(int16_t));
+		for (idx = worker->idx + 1; idx < used_entries; idx += stride) {
+			softmix_mix_add(worker->partial_buf, buffers[idx], samples);
+		}
+
+		ast_mutex_lock(&softmix_data->mix_lock);
+		if (!--softmix_data->mix_pending) {
+			ast_cond_signal(&softmix_data->mix_done_cond);
+		}
+	}
+	ast_mutex_unlock(&softmix_data->mix_lock);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Start the helper mixing workers for a bridge that has grown large.
+ *
+ * Only attempted once per bridge.  On a single core box or if thread
+ * creation fails the bridge simply keeps mixing everything on the mixing
+ * thread.
+ */
+static void softmix_mix_workers_start(struct softmix_bridge_data *softmix_data)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int num;
+	unsigned int idx;
+
+	if (softmix_data->mix_workers_started) {
+		return;
+	}
+	softmix_data->mix_workers_started = 1;
+
+	if (cpus < 2) {
+		return;
+	}
+	num = MIN((unsigned int) cpus - 1, SOFTMIX_MAX_MIX_WORKERS);
+
+	softmix_data->mix_workers = ast_calloc(num, sizeof(*softmix_data->mix_workers));
+	if (!softmix_data->mix_workers) {
+		return;
+	}
+
+	/* Publish the worker count before any worker computes its stride. */
+	softmix_data->num_mix_workers = num;
+	for (idx = 0; idx < num; ++idx) {
+		struct softmix_mix_worker *worker = &softmix_data->mix_workers[idx];
+
+		worker->softmix_data = softmix_data;
+		worker->idx = idx;
+		worker->generation = softmix_data->mix_generation;
+		if (ast_pthread_create(&worker->thread, NULL, softmix_mix_worker_thread, worker)) {
+			softmix_data->num_mix_workers = idx;
+			break;
+		}
+	}
+	if (!softmix_data->num_mix_workers) {
+		ast_free(softmix_data->mix_workers);
+		softmix_data->mix_workers = NULL;
+		return;
+	}
+	ast_debug(1, "Bridge %s: started %u helper mixing threads\n",
+		softmix_data->bridge->uniqueid, softmix_data->num_mix_workers);
+}
+
+/*!
+ * \internal
+ * \brief Mix a large conference across the helper workers.
+ *
+ * The mixing thread publishes the mixing array as a job, mixes its own
+ * shard while the workers mix theirs, then folds the workers' partial
+ * sums into the final buffer.
+ */
+static void softmix_mix_sharded(struct softmix_bridge_data *softmix_data, int16_t *buf,
+	struct softmix_mixing_array *mixing_array, unsigned int softmix_samples)
+{
+	unsigned int stride = softmix_data->num_mix_workers + 1;
+	unsigned int idx;
+
+	ast_mutex_lock(&softmix_data->mix_lock);
+	softmix_data->mix_buffers = mixing_array->buffers;
+	softmix_data->mix_used_entries = mixing_array->used_entries;
+	softmix_data->mix_samples = softmix_samples;
+	softmix_data->mix_pending = softmix_data->num_mix_workers;
+	++softmix_data->mix_generation;
+	ast_cond_broadcast(&softmix_data->mix_cond);
+	ast_mutex_unlock(&softmix_data->mix_lock);
+
+	/* Mix our own shard while the workers handle theirs. */
+	for (idx = 0; idx < mixing_array->used_entries; idx += stride) {
+		softmix_mix_add(buf, mixing_array->buffers[idx], softmix_samples);
+	}
+
+	ast_mutex_lock(&softmix_data->mix_lock);
+	while (softmix_data->mix_pending) {
+		ast_cond_wait(&softmix_data->mix_done_cond, &softmix_data->mix_lock);
+	}
+	ast_mutex_unlock(&softmix_data->mix_lock);
+
+	/* Fold the workers' partial sums into the final mix. */
+	for (idx = 0; idx < softmix_data->num_mix_workers; ++idx) {
+		softmix_mix_add(buf, softmix_data->mix_workers[idx].partial_buf, softmix_samples);
+	}
+}
+
 /*!
  * \brief Mixing loop.
  *
@@ -915,7 +1277,6 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 	int timingfd;
 	int update_all_rates = 0; /* set this when the internal sample rate has changed */
 	unsigned int idx;
-	unsigned int x;
 	int res = -1;
 
 	timer = softmix_data->timer;
@@ -956,6 +1317,9 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			goto softmix_cleanup;
 		}
 
+		ast_sdt_probe3(softmix_mixing_start, bridge->uniqueid,
+			bridge->num_channels, softmix_data->internal_mixing_interval);
+
 		/* init the number of buffers stored in the mixing array to 0.
 		 * As buffers are added for mixing, this number is incremented. */
 		mixing_array.used_entries = 0;
@@ -1005,9 +1369,15 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 
 		/* mix it like crazy */
 		memset(buf, 0, softmix_datalen);
-		for (idx = 0; idx < mixing_array.used_entries; ++idx) {
-			for (x = 0; x < softmix_samples; ++x) {
-				ast_slinear_saturated_add(buf + x, mixing_array.buffers[idx] + x);
+		if (mixing_array.used_entries >= SOFTMIX_MIX_WORKER_THRESHOLD) {
+			softmix_mix_workers_start(softmix_data);
+		}
+		if (softmix_data->num_mix_workers
+			&& mixing_array.used_entries >= SOFTMIX_MIX_WORKER_THRESHOLD) {
+			softmix_mix_sharded(softmix_data, buf, &mixing_array, softmix_samples);
+		} else {
+			for (idx = 0; idx < mixing_array.used_entries; ++idx) {
+				softmix_mix_add(buf, mixing_array.buffers[idx], softmix_samples);
 			}
 		}
 
@@ -1027,10 +1397,10 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 				"Replace softmix channel slin format");
 			sc->write_frame.datalen = softmix_datalen;
 			sc->write_frame.samples = softmix_samples;
-			memcpy(sc->final_buf, buf, softmix_datalen);
 
 			/* process the softmix channel's new write audio */
-			softmix_process_write_audio(&trans_helper, ast_channel_rawwriteformat(bridge_channel->chan), sc);
+			softmix_process_write_audio(&trans_helper,
+				ast_channel_rawwriteformat(bridge_channel->chan), sc, buf);
 
 			ast_mutex_unlock(&sc->lock);
 
@@ -1045,6 +1415,8 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		}
 		stat_iteration_counter--;
 
+		ast_sdt_probe1(softmix_mixing_end, bridge->uniqueid);
+
 		ast_bridge_unlock(bridge);
 		/* cleanup any translation frame data from the previous mixing iteration. */
 		softmix_translate_helper_cleanup(&trans_helper);
@@ -1135,6 +1507,10 @@ static void softmix_bridge_data_destroy(struct softmix_bridge_data *softmix_data
 	}
 	ast_mutex_destroy(&softmix_data->lock);
 	ast_cond_destroy(&softmix_data->cond);
+	ast_mutex_destroy(&softmix_data->mix_lock);
+	ast_cond_destroy(&softmix_data->mix_cond);
+	ast_cond_destroy(&softmix_data->mix_done_cond);
+	ast_free(softmix_data->mix_workers);
 	ast_free(softmix_data);
 }
 
@@ -1150,6 +1526,9 @@ static int softmix_bridge_create(struct ast_bridge *bridge)
 	softmix_data->bridge = bridge;
 	ast_mutex_init(&softmix_data->lock);
 	ast_cond_init(&softmix_data->cond, NULL);
+	ast_mutex_init(&softmix_data->mix_lock);
+	ast_cond_init(&softmix_data->mix_cond, NULL);
+	ast_cond_init(&softmix_data->mix_done_cond, NULL);
 	softmix_data->timer = ast_timer_open();
 	if (!softmix_data->timer) {
 		ast_log(AST_LOG_WARNING, "Failed to open timer for softmix bridge\n");
@@ -1220,6 +1599,20 @@ static void softmix_bridge_destroy(struct ast_bridge *bridge)
 		pthread_join(thread, NULL);
 	}
 
+	/* With the mixing thread gone no new jobs can be published, so the
+	 * helper workers are all idle and can be stopped. */
+	if (softmix_data->mix_workers) {
+		unsigned int idx;
+
+		ast_mutex_lock(&softmix_data->mix_lock);
+		softmix_data->mix_stop = 1;
+		ast_cond_broadcast(&softmix_data->mix_cond);
+		ast_mutex_unlock(&softmix_data->mix_lock);
+		for (idx = 0; idx < softmix_data->num_mix_workers; ++idx) {
+			pthread_join(softmix_data->mix_workers[idx].thread, NULL);
+		}
+	}
+
 	softmix_bridge_data_destroy(softmix_data);
 	bridge->tech_pvt = NULL;
 }
@@ -1245,6 +1638,7 @@ static int unload_module(void)
 
 static int load_module(void)
 {
+	softmix_mix_init();
 	if (ast_bridge_technology_register(&softmix_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
@@ -95,6 +95,11 @@ static char *name = "csv";
 
 AST_MUTEX_DEFINE_STATIC(f_lock);
 
+/*! \brief Master file kept open for the duration of a batch.  Protected by \ref f_lock. */
+static FILE *batch_master_file;
+/*! \brief Number of overlapping batches in flight.  Protected by \ref f_lock. */
+static unsigned int batch_depth;
+
 static int load_config(int reload)
 {
 	struct ast_config *cfg;
@@ -294,6 +299,33 @@ static int writefile_account(char *s, char *acc)
 	return writefile(s, file_account);
 }
 
+/*! \brief Open the master file once per batch instead of once per record */
+static void csv_batch_begin(void)
+{
+	ast_mutex_lock(&f_lock);
+	if (batch_depth++ == 0) {
+		batch_master_file = fopen(file_csv_master, "a");
+		if (!batch_master_file) {
+			/* csv_log() falls back to opening per record */
+			ast_log(LOG_ERROR, "Unable to open file %s : %s\n", file_csv_master, strerror(errno));
+		}
+	}
+	ast_mutex_unlock(&f_lock);
+}
+
+static void csv_batch_end(void)
+{
+	ast_mutex_lock(&f_lock);
+	if (--batch_depth == 0 && batch_master_file) {
+		/* fclose() flushes, so the whole batch hits the disk in one go */
+		if (fclose(batch_master_file)) {
+			ast_log(LOG_WARNING, "Unable to write CSV records to master '%s' : %s\n", file_csv_master, strerror(errno));
+		}
+		batch_master_file = NULL;
+	}
+	ast_mutex_unlock(&f_lock);
+}
+
 static int csv_log(struct ast_cdr *cdr)
 {
 	/* Make sure we have a big enough buf */
@@ -304,7 +336,10 @@ static int csv_log(struct ast_cdr *cdr)
 	}
 
 	ast_mutex_lock(&f_lock);
-	if (writefile(buf, file_csv_master))
+	if (batch_master_file) {
+		if (fputs(buf, batch_master_file) == EOF)
+			ast_log(LOG_WARNING, "Unable to write CSV record to master '%s' : %s\n", file_csv_master, strerror(errno));
+	} else if (writefile(buf, file_csv_master))
 		ast_log(LOG_WARNING, "Unable to write CSV record to master '%s' : %s\n", file_csv_master, strerror(errno));
 
 	if (accountlogs && !ast_strlen_zero(cdr->accountcode)) {
@@ -333,7 +368,8 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
-	if ((res = ast_cdr_register(name, ast_module_info->description, csv_log))) {
+	if ((res = ast_cdr_register_batch(name, ast_module_info->description, csv_log,
+			csv_batch_begin, csv_batch_end))) {
 		ast_log(LOG_ERROR, "Unable to register CSV CDR handling\n");
 	} else {
 		loaded = 1;
@@ -61,6 +61,8 @@ static sqlite3 *db = NULL;
 
 static char table[80];
 static char *columns;
+/*! TRUE if a batch transaction is open.  Protected by \ref lock. */
+static int in_transaction;
 
 struct values {
 	AST_LIST_ENTRY(values) list;
@@ -275,6 +277,40 @@ static int write_cdr(struct ast_cdr *cdr)
 	return res;
 }
 
+/*! \brief Wrap all inserts of a CDR batch in one transaction */
+static void write_cdr_batch_begin(void)
+{
+	char *error = NULL;
+
+	ast_mutex_lock(&lock);
+	/* If batches overlap, fold the later one into the open transaction. */
+	if (db && !in_transaction) {
+		if (sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &error) != SQLITE_OK) {
+			ast_log(LOG_ERROR, "Unable to begin CDR batch transaction: %s.\n", error);
+			sqlite3_free(error);
+		} else {
+			in_transaction = 1;
+		}
+	}
+	ast_mutex_unlock(&lock);
+}
+
+static void write_cdr_batch_end(void)
+{
+	char *error = NULL;
+
+	ast_mutex_lock(&lock);
+	if (in_transaction) {
+		if (sqlite3_exec(db, "COMMIT", NULL, NULL, &error) != SQLITE_OK) {
+			ast_log(LOG_ERROR, "Unable to commit CDR batch: %s.\n", error);
+			sqlite3_free(error);
+			sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+		}
+		in_transaction = 0;
+	}
+	ast_mutex_unlock(&lock);
+}
+
 static int unload_module(void)
 {
 	if (ast_cdr_unregister(name)) {
@@ -323,7 +359,8 @@ static int load_module(void)
 		}
 	}
 
-	res = ast_cdr_register(name, desc, write_cdr);
+	res = ast_cdr_register_batch(name, desc, write_cdr,
+		write_cdr_batch_begin, write_cdr_batch_end);
 	if (res) {
 		ast_log(LOG_ERROR, "Unable to register custom SQLite3 CDR handling\n");
 		free_config(0);
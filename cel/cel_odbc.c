@@ -47,6 +47,7 @@
 #include "asterisk/res_odbc.h"
 #include "asterisk/cel.h"
 #include "asterisk/module.h"
+#include "asterisk/paths.h"
 
 #define	CONFIG	"cel_odbc.conf"
 
@@ -80,12 +81,185 @@ struct tables {
 	char *table;
 	unsigned int usegmtime:1;
 	unsigned int allowleapsec:1;
+	unsigned int backslash_is_escape:1;
 	AST_LIST_HEAD_NOLOCK(odbc_columns, columns) columns;
 	AST_RWLIST_ENTRY(tables) list;
 };
 
 static AST_RWLIST_HEAD_STATIC(odbc_tables, tables);
 
+static SQLHSTMT generic_prepare(struct odbc_obj *obj, void *data);
+
+/*!
+ * Inserts are not executed in the CEL delivery thread.  Each event is
+ * rendered into a complete INSERT statement and queued here; a single
+ * writer thread drains the queue in batches, so the connection
+ * acquisition and database round trips are paid per batch instead of
+ * per event.
+ */
+struct pending_insert {
+	AST_LIST_ENTRY(pending_insert) list;
+	/*! The rendered INSERT statement (points into connection[]) */
+	char *sql;
+	/*! Connection name, followed by the SQL */
+	char connection[0];
+};
+
+static AST_LIST_HEAD_STATIC(inserts, pending_insert);
+static ast_cond_t inserts_cond;
+static pthread_t inserts_thread = AST_PTHREADT_NULL;
+static int inserts_shutdown;
+static int inserts_cnt;
+
+/*! Write out a batch once this many inserts are waiting ... */
+#define BATCH_SIZE 100
+/*! ... or this many milliseconds after the first one was queued. */
+#define BATCH_TIME_MS 1000
+/*! Queue no more than this many inserts; the excess spills to disk. */
+#define BATCH_MAX 10000
+
+/*! File in the log directory collecting inserts which could not be delivered */
+#define SPILL_FILE "cel_odbc.sql"
+
+/*!
+ * \internal
+ * \brief Append an insert that could not be delivered to the spill file.
+ *
+ * One INSERT statement per line, preceded by a comment naming the
+ * connection, so records lost to a sustained database outage or queue
+ * overflow can be replayed later by hand.
+ */
+static void spill_insert(const char *connection, const char *sql)
+{
+	char fn[PATH_MAX];
+	FILE *f;
+
+	snprintf(fn, sizeof(fn), "%s/%s", ast_config_AST_LOG_DIR, SPILL_FILE);
+	f = fopen(fn, "a");
+	if (!f) {
+		ast_log(LOG_ERROR, "Unable to spill CEL insert to '%s': %s\n", fn, strerror(errno));
+		return;
+	}
+	fprintf(f, "-- %s\n%s;\n", connection, sql);
+	fclose(f);
+}
+
+/*!
+ * \internal
+ * \brief Hand a rendered INSERT statement to the writer thread.
+ */
+static void queue_insert(const char *connection, const char *sql)
+{
+	struct pending_insert *insert;
+	int lenconnection = strlen(connection);
+
+	insert = ast_malloc(sizeof(*insert) + lenconnection + 1 + strlen(sql) + 1);
+	if (!insert) {
+		return;
+	}
+	strcpy(insert->connection, connection); /* SAFE */
+	insert->sql = insert->connection + lenconnection + 1;
+	strcpy(insert->sql, sql); /* SAFE */
+
+	AST_LIST_LOCK(&inserts);
+	if (inserts_cnt >= BATCH_MAX) {
+		AST_LIST_UNLOCK(&inserts);
+		ast_log(LOG_WARNING, "CEL insert queue is full.  Spilling record for '%s' to disk.\n", connection);
+		spill_insert(connection, sql);
+		ast_free(insert);
+		return;
+	}
+	AST_LIST_INSERT_TAIL(&inserts, insert, list);
+	if (++inserts_cnt == 1 || inserts_cnt >= BATCH_SIZE) {
+		/* Wake the writer to start the batch timer or flush a full batch. */
+		ast_cond_signal(&inserts_cond);
+	}
+	AST_LIST_UNLOCK(&inserts);
+}
+
+/*!
+ * \internal
+ * \brief The batch writer thread.
+ *
+ * Sleeps until inserts are queued, gives the batch BATCH_TIME_MS to
+ * fill (or BATCH_SIZE entries, whichever comes first), then writes it
+ * out over a connection which is reused across the batch.  Inserts
+ * which cannot be delivered spill to disk.
+ */
+static void *inserts_run(void *data)
+{
+	struct odbc_obj *obj = NULL;
+	char current_connection[40] = "";
+
+	for (;;) {
+		AST_LIST_HEAD_NOLOCK(, pending_insert) batch = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+		struct pending_insert *insert;
+
+		AST_LIST_LOCK(&inserts);
+		while (!inserts_shutdown && AST_LIST_EMPTY(&inserts)) {
+			ast_cond_wait(&inserts_cond, &inserts.lock);
+		}
+		if (!inserts_shutdown && inserts_cnt < BATCH_SIZE) {
+			/* Give the batch a chance to fill up before writing it out. */
+			struct timeval expires = ast_tvadd(ast_tvnow(), ast_samp2tv(BATCH_TIME_MS, 1000));
+			struct timespec ts = { expires.tv_sec, expires.tv_usec * 1000 };
+
+			while (!inserts_shutdown && inserts_cnt < BATCH_SIZE) {
+				if (ast_cond_timedwait(&inserts_cond, &inserts.lock, &ts) == ETIMEDOUT) {
+					break;
+				}
+			}
+		}
+		if (AST_LIST_EMPTY(&inserts)) {
+			/* Only happens at shutdown, once the queue is drained. */
+			AST_LIST_UNLOCK(&inserts);
+			break;
+		}
+		AST_LIST_APPEND_LIST(&batch, &inserts, list);
+		inserts_cnt = 0;
+		AST_LIST_UNLOCK(&inserts);
+
+		while ((insert = AST_LIST_REMOVE_HEAD(&batch, list))) {
+			SQLHSTMT stmt;
+			SQLLEN rows = 0;
+
+			if (obj && strcmp(current_connection, insert->connection)) {
+				ast_odbc_release_obj(obj);
+				obj = NULL;
+			}
+			if (!obj && (obj = ast_odbc_request_obj(insert->connection, 0))) {
+				ast_copy_string(current_connection, insert->connection, sizeof(current_connection));
+			}
+			if (!obj) {
+				ast_log(LOG_WARNING, "Unable to retrieve database handle for '%s'.  Spilling CEL record to disk.\n", insert->connection);
+				spill_insert(insert->connection, insert->sql);
+				ast_free(insert);
+				continue;
+			}
+
+			ast_debug(3, "Executing SQL statement: [%s]\n", insert->sql);
+			stmt = ast_odbc_prepare_and_execute(obj, generic_prepare, insert->sql);
+			if (stmt) {
+				SQLRowCount(stmt, &rows);
+				SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+			}
+			if (rows == 0) {
+				ast_log(LOG_WARNING, "Insert failed on '%s'.  Spilling CEL record to disk: %s\n", insert->connection, insert->sql);
+				spill_insert(insert->connection, insert->sql);
+			}
+			ast_free(insert);
+		}
+
+		/* Don't pin a pooled connection while the queue is idle. */
+		if (obj) {
+			ast_odbc_release_obj(obj);
+			obj = NULL;
+		}
+	}
+
+	return NULL;
+}
+
 static int load_config(void)
 {
 	struct ast_config *cfg;
@@ -185,6 +359,9 @@ static int load_config(void)
 			tableptr->allowleapsec = ast_true(tmp);
 		}
 
+		/* Cached so rendering an insert doesn't need a connection. */
+		tableptr->backslash_is_escape = ast_odbc_backslash_is_escape(obj) ? 1 : 0;
+
 		ast_verb(3, "Found CEL table %s@%s.\n", tableptr->table, tableptr->connection);
 
 		/* Check for filters first */
@@ -364,12 +541,9 @@ static void odbc_log(struct ast_event *event)
 {
 	struct tables *tableptr;
 	struct columns *entry;
-	struct odbc_obj *obj;
 	struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
 	char *tmp;
 	char colbuf[1024], *colptr;
-	SQLHSTMT stmt = NULL;
-	SQLLEN rows = 0;
 	struct ast_cel_event_record record = {
 		.version = AST_CEL_EVENT_RECORD_VERSION,
 	};
@@ -398,12 +572,6 @@ static void odbc_log(struct ast_event *event)
 		ast_str_set(&sql, 0, "INSERT INTO %s (", tableptr->table);
 		ast_str_set(&sql2, 0, " VALUES (");
 
-		/* No need to check the connection now; we'll handle any failure in prepare_and_execute */
-		if (!(obj = ast_odbc_request_obj(tableptr->connection, 0))) {
-			ast_log(LOG_WARNING, "Unable to retrieve database handle for '%s:%s'.  CEL failed: %s\n", tableptr->connection, tableptr->table, ast_str_buffer(sql));
-			continue;
-		}
-
 		AST_LIST_TRAVERSE(&(tableptr->columns), entry, list) {
 			int datefield = 0;
 			int unknown = 0;
@@ -536,7 +704,7 @@ static void odbc_log(struct ast_event *event)
 					for (tmp = colptr; *tmp; tmp++) {
 						if (*tmp == '\'') {
 							ast_str_append(&sql2, 0, "''");
-						} else if (*tmp == '\\' && ast_odbc_backslash_is_escape(obj)) {
+						} else if (*tmp == '\\' && tableptr->backslash_is_escape) {
 							ast_str_append(&sql2, 0, "\\\\");
 						} else {
 							ast_str_append(&sql2, 0, "%c", *tmp);
@@ -754,17 +922,8 @@ static void odbc_log(struct ast_event *event)
 		ast_str_append(&sql2, 0, ")");
 		ast_str_append(&sql, 0, "%s", ast_str_buffer(sql2));
 
-		ast_debug(3, "Executing SQL statement: [%s]\n", ast_str_buffer(sql));
-		stmt = ast_odbc_prepare_and_execute(obj, generic_prepare, ast_str_buffer(sql));
-		if (stmt) {
-			SQLRowCount(stmt, &rows);
-			SQLFreeHandle(SQL_HANDLE_STMT, stmt);
-		}
-		if (rows == 0) {
-			ast_log(LOG_WARNING, "Insert failed on '%s:%s'.  CEL failed: %s\n", tableptr->connection, tableptr->table, ast_str_buffer(sql));
-		}
-early_release:
-		ast_odbc_release_obj(obj);
+		queue_insert(tableptr->connection, ast_str_buffer(sql));
+early_release:;
 	}
 	AST_RWLIST_UNLOCK(&odbc_tables);
 
@@ -788,10 +947,20 @@ static int unload_module(void)
 	}
 
 	ast_cel_backend_unregister(ODBC_BACKEND_NAME);
+
+	/* Wake the writer thread and wait for it to drain the queue. */
+	AST_LIST_LOCK(&inserts);
+	inserts_shutdown = 1;
+	ast_cond_signal(&inserts_cond);
+	AST_LIST_UNLOCK(&inserts);
+	pthread_join(inserts_thread, NULL);
+	inserts_thread = AST_PTHREADT_NULL;
+	ast_cond_destroy(&inserts_cond);
+
 	free_config();
 	AST_RWLIST_UNLOCK(&odbc_tables);
 	AST_RWLIST_HEAD_DESTROY(&odbc_tables);
-        
+
 	return 0;
 }
 
@@ -805,6 +974,12 @@ static int load_module(void)
 	}
 	load_config();
 	AST_RWLIST_UNLOCK(&odbc_tables);
+	ast_cond_init(&inserts_cond, NULL);
+	if (ast_pthread_create_background(&inserts_thread, NULL, inserts_run, NULL)) {
+		ast_log(LOG_ERROR, "Unable to start insert thread\n");
+		ast_cond_destroy(&inserts_cond);
+		return AST_MODULE_LOAD_FAILURE;
+	}
 	if (ast_cel_backend_register(ODBC_BACKEND_NAME, odbc_log)) {
 		ast_log(LOG_ERROR, "Unable to subscribe to CEL events\n");
 		return AST_MODULE_LOAD_FAILURE;
@@ -8583,6 +8583,12 @@ static struct ast_frame *dahdi_read(struct ast_channel *ast)
 	}
 	readbuf = ((unsigned char *)p->subs[idx].buffer) + AST_FRIENDLY_OFFSET;
 	CHECK_BLOCKING(ast);
+	/* One read per channel per chunk is imposed by the DAHDI interface:
+	 * every channel is a separate character device and the kernel offers
+	 * no span-level bulk read, so media for a span cannot be serviced in
+	 * fewer syscalls from here.  The per-channel 'buffers' policy
+	 * (DAHDI_SET_BUFINFO above) is the available knob for trading
+	 * latency against wakeup frequency. */
 	res = read(p->subs[idx].dfd, readbuf, p->subs[idx].linear ? READ_SIZE * 2 : READ_SIZE);
 	ast_clear_flag(ast_channel_flags(ast), AST_FLAG_BLOCKING);
 	/* Check for hangup */
@@ -411,6 +411,20 @@ static int (*iax2_regfunk)(const char *username, int onoff) = NULL;
 static struct io_context *io;
 static struct ast_sched_context *sched;
 
+/*!
+ * \brief Scheduler contexts for per-call timers.
+ *
+ * Pings, lag requests, retransmissions and the other timers that exist per
+ * call all used to share the main sched context, whose single lock became
+ * the serialization point with a couple thousand calls up.  Each call is
+ * pinned to one of these contexts for its whole life (even across a callno
+ * change in make_trunk()), so additions and deletions always go to the
+ * context holding the entry.  Everything not tied to a call stays on the
+ * main sched context.
+ */
+#define IAX2_CALL_SCHED_SHARDS 4
+static struct ast_sched_context *call_scheds[IAX2_CALL_SCHED_SHARDS];
+
 static iax2_format iax2_capability = IAX_CAPABILITY_FULLBANDWIDTH;
 
 static int iaxdebug = 0;
@@ -591,6 +605,25 @@ struct iax2_peer {
 
 #define IAX2_TRUNK_PREFACE (sizeof(struct iax_frame) + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr))
 
+/*! Number of staging buffers per trunk peer.  Each call always stages into
+ *  the same buffer (selected by call number), so concurrent calls to the
+ *  same peer only contend for a lock when they happen to share a shard. */
+#define IAX2_TRUNK_SHARDS 4
+
+/*! \brief Staging area for outgoing trunk data
+ *
+ * Media threads append miniframes here under the shard lock alone; the
+ * shards are folded into a single datagram by send_trunk(), which runs
+ * with the owning peer's lock held.
+ */
+struct iax2_trunk_shard {
+	ast_mutex_t lock;
+	unsigned char *data;
+	unsigned int len;
+	unsigned int alloc;
+	int calls;
+};
+
 struct iax2_trunk_peer {
 	ast_mutex_t lock;
 	int sockfd;
@@ -600,13 +633,13 @@ struct iax2_trunk_peer {
 	struct timeval lasttxtime;		/*!< Last transmitted trunktime */
 	struct timeval trunkact;		/*!< Last trunk activity */
 	unsigned int lastsent;			/*!< Last sent time */
-	/* Trunk data and length */
+	/* Assembled trunk frame, filled from the shards at send time */
 	unsigned char *trunkdata;
-	unsigned int trunkdatalen;
+	int trunkdatalen;			/*!< Bytes staged across all shards, updated atomically */
 	unsigned int trunkdataalloc;
+	struct iax2_trunk_shard shard[IAX2_TRUNK_SHARDS];
 	int trunkmaxmtu;
 	int trunkerror;
-	int calls;
 	AST_LIST_ENTRY(iax2_trunk_peer) list;
 };
 
@@ -696,6 +729,8 @@ typedef uint16_t callno_entry;
 struct chan_iax2_pvt {
 	/*! Socket to send/receive on for this call */
 	int sockfd;
+	/*! Scheduler context holding this call's timers, fixed for the life of the call */
+	struct ast_sched_context *call_sched;
 	/*! ast_callid bound to dialog */
 	ast_callid callid;
 	/*! Last received voice format */
@@ -1721,7 +1756,7 @@ static void __send_ping(const void *data)
 		send_command(iaxs[callno], AST_FRAME_IAX, IAX_COMMAND_PING, 0, NULL, 0, -1);
 
 		/* Schedule sending next ping. */
-		iaxs[callno]->pingid = iax2_sched_add(sched, ping_time * 1000, send_ping, data);
+		iaxs[callno]->pingid = iax2_sched_add(iaxs[callno]->call_sched, ping_time * 1000, send_ping, data);
 	}
 
 	ast_mutex_unlock(&iaxsl[callno]);
@@ -1785,7 +1820,7 @@ static void __send_lagrq(const void *data)
 		send_command(iaxs[callno], AST_FRAME_IAX, IAX_COMMAND_LAGRQ, 0, NULL, 0, -1);
 
 		/* Schedule sending next lagrq. */
-		iaxs[callno]->lagid = iax2_sched_add(sched, lagrq_time * 1000, send_lagrq, data);
+		iaxs[callno]->lagid = iax2_sched_add(iaxs[callno]->call_sched, lagrq_time * 1000, send_lagrq, data);
 	}
 
 	ast_mutex_unlock(&iaxsl[callno]);
@@ -2077,15 +2112,49 @@ static int iax2_getpeername(struct ast_sockaddr addr, char *host, int len)
 }
 
 /* Call AST_SCHED_DEL on a scheduled task if it is found in scheduler. */
+struct iax2_sched_delete {
+	struct ast_sched_context *con;
+	int id;
+};
+
 static int iax2_delete_from_sched(const void* data)
 {
-	int sched_id = (int)(long)data;
+	struct iax2_sched_delete *del = (struct iax2_sched_delete *) data;
+
+	AST_SCHED_DEL(del->con, del->id);
+	ast_free(del);
+
+	return 0;
+}
 
-	AST_SCHED_DEL(sched, sched_id);
+/*! \brief Free a deferred delete request still pending when its context is torn down */
+static int iax2_delete_from_sched_cleanup(const void *data)
+{
+	ast_free((void *) data);
 
 	return 0;
 }
 
+/*! \brief Have a scheduler context delete one of its own entries
+ *
+ * Used when deleting directly would deadlock between the scheduler thread
+ * callback locking the callno mutex and the deleting thread already
+ * holding it.  The delete must run on the context holding the entry.
+ */
+static void iax2_sched_delete_later(struct ast_sched_context *con, int id)
+{
+	struct iax2_sched_delete *del;
+
+	if (id < 0 || !(del = ast_malloc(sizeof(*del)))) {
+		return;
+	}
+	del->con = con;
+	del->id = id;
+	if (iax2_sched_add(con, 0, iax2_delete_from_sched, del) < 0) {
+		ast_free(del);
+	}
+}
+
 /*!\note Assumes the lock on the pvt is already held, when
  * iax2_destroy_helper() is called. */
 static void iax2_destroy_helper(struct chan_iax2_pvt *pvt)
@@ -2117,22 +2186,24 @@ static void iax2_destroy_helper(struct chan_iax2_pvt *pvt)
 	 * more times.  It is better to have another thread delete the scheduled
 	 * callbacks which doesn't lock the callno mutex.
 	 */
-	iax2_sched_add(sched, 0, iax2_delete_from_sched, (void*)(long)pvt->pingid);
-	iax2_sched_add(sched, 0, iax2_delete_from_sched, (void*)(long)pvt->lagid);
+	iax2_sched_delete_later(pvt->call_sched, pvt->pingid);
+	iax2_sched_delete_later(pvt->call_sched, pvt->lagid);
 
 	pvt->pingid = -1;
 	pvt->lagid = -1;
 
-	AST_SCHED_DEL(sched, pvt->autoid);
-	AST_SCHED_DEL(sched, pvt->authid);
-	AST_SCHED_DEL(sched, pvt->initid);
-	AST_SCHED_DEL(sched, pvt->jbid);
-	AST_SCHED_DEL(sched, pvt->keyrotateid);
+	AST_SCHED_DEL(pvt->call_sched, pvt->autoid);
+	AST_SCHED_DEL(pvt->call_sched, pvt->authid);
+	AST_SCHED_DEL(pvt->call_sched, pvt->initid);
+	AST_SCHED_DEL(pvt->call_sched, pvt->jbid);
+	AST_SCHED_DEL(pvt->call_sched, pvt->keyrotateid);
 }
 
 static void iax2_frame_free(struct iax_frame *fr)
 {
-	AST_SCHED_DEL(sched, fr->retrans);
+	struct ast_sched_context *con = fr->retrans_sched ? fr->retrans_sched : sched;
+
+	AST_SCHED_DEL(con, fr->retrans);
 	iax_frame_free(fr);
 }
 
@@ -2252,6 +2323,7 @@ static struct chan_iax2_pvt *new_iax(struct ast_sockaddr *addr, const char *host
 		return NULL;
 	}
 
+	tmp->call_sched = sched;
 	tmp->pingid = -1;
 	tmp->lagid = -1;
 	tmp->autoid = -1;
@@ -2362,8 +2434,8 @@ static int make_trunk(unsigned short callno, int locked)
 	 * \note We delete these before switching the slot, because if
 	 * they fire in the meantime, they will generate a warning.
 	 */
-	AST_SCHED_DEL(sched, iaxs[callno]->pingid);
-	AST_SCHED_DEL(sched, iaxs[callno]->lagid);
+	AST_SCHED_DEL(iaxs[callno]->call_sched, iaxs[callno]->pingid);
+	AST_SCHED_DEL(iaxs[callno]->call_sched, iaxs[callno]->lagid);
 	iaxs[callno]->lagid = iaxs[callno]->pingid = -1;
 	iaxs[x] = iaxs[callno];
 	iaxs[x]->callno = x;
@@ -2382,9 +2454,9 @@ static int make_trunk(unsigned short callno, int locked)
 
 	iaxs[callno] = NULL;
 	/* Update the two timers that should have been started */
-	iaxs[x]->pingid = iax2_sched_add(sched,
+	iaxs[x]->pingid = iax2_sched_add(iaxs[x]->call_sched,
 		ping_time * 1000, send_ping, (void *)(long)x);
-	iaxs[x]->lagid = iax2_sched_add(sched,
+	iaxs[x]->lagid = iax2_sched_add(iaxs[x]->call_sched,
 		lagrq_time * 1000, send_lagrq, (void *)(long)x);
 
 	if (locked)
@@ -3207,10 +3279,11 @@ static int __find_callno(unsigned short callno, unsigned short dcallno, struct a
 			ast_sockaddr_copy(&iaxs[x]->addr, addr);
 			iaxs[x]->peercallno = callno;
 			iaxs[x]->callno = x;
+			iaxs[x]->call_sched = call_scheds[x % IAX2_CALL_SCHED_SHARDS];
 			iaxs[x]->pingtime = DEFAULT_RETRY_TIME;
 			iaxs[x]->expiry = min_reg_expire;
-			iaxs[x]->pingid = iax2_sched_add(sched, ping_time * 1000, send_ping, (void *)(long)x);
-			iaxs[x]->lagid = iax2_sched_add(sched, lagrq_time * 1000, send_lagrq, (void *)(long)x);
+			iaxs[x]->pingid = iax2_sched_add(iaxs[x]->call_sched, ping_time * 1000, send_ping, (void *)(long)x);
+			iaxs[x]->lagid = iax2_sched_add(iaxs[x]->call_sched, lagrq_time * 1000, send_lagrq, (void *)(long)x);
 			iaxs[x]->amaflags = amaflags;
 			ast_copy_flags64(iaxs[x], &globalflags, IAX_NOTRANSFER | IAX_TRANSFERMEDIA | IAX_USEJITTERBUF | IAX_SENDCONNECTEDLINE | IAX_RECVCONNECTEDLINE | IAX_FORCE_ENCRYPT);
 			ast_string_field_set(iaxs[x], accountcode, accountcode);
@@ -3611,7 +3684,8 @@ static void __attempt_transmit(const void *data)
 			/* Transfer messages max out at one second */
 			if (f->transfer && (f->retrytime > 1000))
 				f->retrytime = 1000;
-			f->retrans = iax2_sched_add(sched, f->retrytime, attempt_transmit, f);
+			f->retrans_sched = iaxs[callno]->call_sched;
+			f->retrans = iax2_sched_add(f->retrans_sched, f->retrytime, attempt_transmit, f);
 		}
 	} else {
 		/* Make sure it gets freed */
@@ -4121,7 +4195,7 @@ static void update_jbsched(struct chan_iax2_pvt *pvt)
 		when = 1;
 	}
 
-	pvt->jbid = iax2_sched_replace(pvt->jbid, sched, when, get_from_jb,
+	pvt->jbid = iax2_sched_replace(pvt->jbid, pvt->call_sched, when, get_from_jb,
 		CALLNO_TO_PTR(pvt->callno));
 }
 
@@ -4302,7 +4376,8 @@ static int transmit_frame(void *data)
 		/* We need reliable delivery.  Schedule a retransmission */
 		AST_LIST_INSERT_TAIL(&frame_queue[fr->callno], fr, list);
 		fr->retries++;
-		fr->retrans = iax2_sched_add(sched, fr->retrytime, attempt_transmit, fr);
+		fr->retrans_sched = iaxs[fr->callno] ? iaxs[fr->callno]->call_sched : sched;
+		fr->retrans = iax2_sched_add(fr->retrans_sched, fr->retrytime, attempt_transmit, fr);
 		ast_mutex_unlock(&iaxsl[fr->callno]);
 	}
 
@@ -5235,10 +5310,10 @@ static int iax2_call(struct ast_channel *c, const char *dest, int timeout)
 	if (iaxs[callno]->maxtime) {
 		/* Initialize pingtime and auto-congest time */
 		iaxs[callno]->pingtime = iaxs[callno]->maxtime / 2;
-		iaxs[callno]->initid = iax2_sched_add(sched, iaxs[callno]->maxtime * 2, auto_congest, CALLNO_TO_PTR(callno));
+		iaxs[callno]->initid = iax2_sched_add(iaxs[callno]->call_sched, iaxs[callno]->maxtime * 2, auto_congest, CALLNO_TO_PTR(callno));
 	} else if (autokill) {
 		iaxs[callno]->pingtime = autokill / 2;
-		iaxs[callno]->initid = iax2_sched_add(sched, autokill * 2, auto_congest, CALLNO_TO_PTR(callno));
+		iaxs[callno]->initid = iax2_sched_add(iaxs[callno]->call_sched, autokill * 2, auto_congest, CALLNO_TO_PTR(callno));
 	}
 
 	/* Check if there is an OSP token */
@@ -5464,7 +5539,7 @@ static int iax2_key_rotate(const void *vpvt)
 	};
 
 	ast_mutex_lock(&iaxsl[pvt->callno]);
-	pvt->keyrotateid = ast_sched_add(sched, 120000 + (ast_random() % 180001), iax2_key_rotate, vpvt);
+	pvt->keyrotateid = ast_sched_add(pvt->call_sched, 120000 + (ast_random() % 180001), iax2_key_rotate, vpvt);
 
 	snprintf(key, sizeof(key), "%lX", (unsigned long)ast_random());
 
@@ -6253,7 +6328,12 @@ static struct iax2_trunk_peer *find_tpeer(struct ast_sockaddr *addr, int fd)
 
 	if (!tpeer) {
 		if ((tpeer = ast_calloc(1, sizeof(*tpeer)))) {
+			int x;
+
 			ast_mutex_init(&tpeer->lock);
+			for (x = 0; x < IAX2_TRUNK_SHARDS; x++) {
+				ast_mutex_init(&tpeer->shard[x].lock);
+			}
 			tpeer->lastsent = 9999;
 			ast_sockaddr_copy(&tpeer->addr, addr);
 			tpeer->trunkact = ast_tvnow();
@@ -6277,70 +6357,85 @@ static int iax2_trunk_queue(struct chan_iax2_pvt *pvt, struct iax_frame *fr)
 {
 	struct ast_frame *f;
 	struct iax2_trunk_peer *tpeer;
+	struct iax2_trunk_shard *sh;
 	void *tmp, *ptr;
 	struct timeval now;
+	int trunkdatalen;
+	unsigned int startlen;
 	struct ast_iax2_meta_trunk_entry *met;
 	struct ast_iax2_meta_trunk_mini *mtm;
 
 	f = &fr->af;
 	tpeer = find_tpeer(&pvt->addr, pvt->sockfd);
-	if (tpeer) {
+	if (!tpeer) {
+		return 0;
+	}
 
-		if (tpeer->trunkdatalen + f->datalen + 4 >= tpeer->trunkdataalloc) {
-			/* Need to reallocate space */
-			if (tpeer->trunkdataalloc < trunkmaxsize) {
-				if (!(tmp = ast_realloc(tpeer->trunkdata, tpeer->trunkdataalloc + DEFAULT_TRUNKDATA + IAX2_TRUNK_PREFACE))) {
-					ast_mutex_unlock(&tpeer->lock);
-					return -1;
-				}
+	/* if we have enough for a full MTU, ship what is staged before appending
+	   more rather than letting the datagram outgrow it */
+	if (global_max_trunk_mtu > 0 && tpeer->trunkdatalen + f->datalen + 4 >= global_max_trunk_mtu) {
+		now = ast_tvnow();
+		send_trunk(tpeer, &now);
+		trunk_untimed ++;
+	}
 
-				tpeer->trunkdataalloc += DEFAULT_TRUNKDATA;
-				tpeer->trunkdata = tmp;
-				ast_debug(1, "Expanded trunk '%s' to %u bytes\n", ast_sockaddr_stringify(&tpeer->addr), tpeer->trunkdataalloc);
-			} else {
-				ast_log(LOG_WARNING, "Maximum trunk data space exceeded to %s\n", ast_sockaddr_stringify(&tpeer->addr));
-				ast_mutex_unlock(&tpeer->lock);
+	/* Take the shard lock before giving up the peer lock so that the peer
+	   cannot be dropped while we hold neither */
+	sh = &tpeer->shard[pvt->callno % IAX2_TRUNK_SHARDS];
+	ast_mutex_lock(&sh->lock);
+	ast_mutex_unlock(&tpeer->lock);
+
+	if (sh->len + f->datalen + 4 >= sh->alloc) {
+		/* Need to reallocate space */
+		if (sh->alloc < trunkmaxsize) {
+			if (!(tmp = ast_realloc(sh->data, sh->alloc + DEFAULT_TRUNKDATA))) {
+				ast_mutex_unlock(&sh->lock);
 				return -1;
 			}
-		}
 
-		/* Append to meta frame */
-		ptr = tpeer->trunkdata + IAX2_TRUNK_PREFACE + tpeer->trunkdatalen;
-		if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)) {
-			mtm = (struct ast_iax2_meta_trunk_mini *)ptr;
-			mtm->len = htons(f->datalen);
-			mtm->mini.callno = htons(pvt->callno);
-			mtm->mini.ts = htons(0xffff & fr->ts);
-			ptr += sizeof(struct ast_iax2_meta_trunk_mini);
-			tpeer->trunkdatalen += sizeof(struct ast_iax2_meta_trunk_mini);
+			sh->alloc += DEFAULT_TRUNKDATA;
+			sh->data = tmp;
+			ast_debug(1, "Expanded trunk '%s' to %u bytes\n", ast_sockaddr_stringify(&tpeer->addr), sh->alloc);
 		} else {
-			met = (struct ast_iax2_meta_trunk_entry *)ptr;
-			/* Store call number and length in meta header */
-			met->callno = htons(pvt->callno);
-			met->len = htons(f->datalen);
-			/* Advance pointers/decrease length past trunk entry header */
-			ptr += sizeof(struct ast_iax2_meta_trunk_entry);
-			tpeer->trunkdatalen += sizeof(struct ast_iax2_meta_trunk_entry);
+			ast_log(LOG_WARNING, "Maximum trunk data space exceeded to %s\n", ast_sockaddr_stringify(&tpeer->addr));
+			ast_mutex_unlock(&sh->lock);
+			return -1;
 		}
-		/* Copy actual trunk data */
-		memcpy(ptr, f->data.ptr, f->datalen);
-		tpeer->trunkdatalen += f->datalen;
+	}
 
-		tpeer->calls++;
+	/* Append to this shard of the meta frame */
+	startlen = sh->len;
+	ptr = sh->data + sh->len;
+	if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)) {
+		mtm = (struct ast_iax2_meta_trunk_mini *)ptr;
+		mtm->len = htons(f->datalen);
+		mtm->mini.callno = htons(pvt->callno);
+		mtm->mini.ts = htons(0xffff & fr->ts);
+		ptr += sizeof(struct ast_iax2_meta_trunk_mini);
+		sh->len += sizeof(struct ast_iax2_meta_trunk_mini);
+	} else {
+		met = (struct ast_iax2_meta_trunk_entry *)ptr;
+		/* Store call number and length in meta header */
+		met->callno = htons(pvt->callno);
+		met->len = htons(f->datalen);
+		/* Advance pointers/decrease length past trunk entry header */
+		ptr += sizeof(struct ast_iax2_meta_trunk_entry);
+		sh->len += sizeof(struct ast_iax2_meta_trunk_entry);
+	}
+	/* Copy actual trunk data */
+	memcpy(ptr, f->data.ptr, f->datalen);
+	sh->len += f->datalen;
 
-		/* track the largest mtu we actually have sent */
-		if (tpeer->trunkdatalen + f->datalen + 4 > trunk_maxmtu)
-			trunk_maxmtu = tpeer->trunkdatalen + f->datalen + 4 ;
+	sh->calls++;
+	trunkdatalen = ast_atomic_fetchadd_int(&tpeer->trunkdatalen, (int) (sh->len - startlen))
+		+ (int) (sh->len - startlen);
 
-		/* if we have enough for a full MTU, ship it now without waiting */
-		if (global_max_trunk_mtu > 0 && tpeer->trunkdatalen + f->datalen + 4 >= global_max_trunk_mtu) {
-			now = ast_tvnow();
-			send_trunk(tpeer, &now);
-			trunk_untimed ++;
-		}
+	ast_mutex_unlock(&sh->lock);
+
+	/* track the largest mtu we actually have sent */
+	if (trunkdatalen + f->datalen + 4 > trunk_maxmtu)
+		trunk_maxmtu = trunkdatalen + f->datalen + 4 ;
 
-		ast_mutex_unlock(&tpeer->lock);
-	}
 	return 0;
 }
 
@@ -9307,7 +9402,7 @@ static int auth_fail(int callno, int failcode)
 		iaxs[callno]->authfail = failcode;
 		if (delayreject) {
 			iaxs[callno]->authid = iax2_sched_replace(iaxs[callno]->authid,
-				sched, 1000, auth_reject, (void *)(long)callno);
+				iaxs[callno]->call_sched, 1000, auth_reject, (void *)(long)callno);
 		} else
 			auth_reject((void *)(long)callno);
 	}
@@ -9349,7 +9444,7 @@ static void iax2_dprequest(struct iax2_dpcache *dp, int callno)
 	struct iax_ie_data ied;
 	/* Auto-hangup with 30 seconds of inactivity */
 	iaxs[callno]->autoid = iax2_sched_replace(iaxs[callno]->autoid,
-		sched, 30000, auto_hangup, (void *)(long)callno);
+		iaxs[callno]->call_sched, 30000, auto_hangup, (void *)(long)callno);
 	memset(&ied, 0, sizeof(ied));
 	iax_ie_append_str(&ied, IAX_IE_CALLED_NUMBER, dp->exten);
 	send_command(iaxs[callno], AST_FRAME_IAX, IAX_COMMAND_DPREQ, 0, ied.buf, ied.pos, -1);
@@ -9399,13 +9494,47 @@ static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 	struct ast_iax2_meta_hdr *meta;
 	struct ast_iax2_meta_trunk_hdr *mth;
 	int calls = 0;
+	unsigned int len = 0;
+	int x;
 
-	/* Point to frame */
-	fr = (struct iax_frame *)tpeer->trunkdata;
-	/* Point to meta data */
-	meta = (struct ast_iax2_meta_hdr *)fr->afdata;
-	mth = (struct ast_iax2_meta_trunk_hdr *)meta->data;
-	if (tpeer->trunkdatalen) {
+	/* Fold the staging shards into one frame.  Calls staging into other
+	   shards carry on in parallel; anything they add after its shard is
+	   folded simply rides the next trunk interval. */
+	for (x = 0; x < IAX2_TRUNK_SHARDS; x++) {
+		struct iax2_trunk_shard *sh = &tpeer->shard[x];
+
+		ast_mutex_lock(&sh->lock);
+		if (sh->len) {
+			if (len + sh->len > tpeer->trunkdataalloc) {
+				void *tmp;
+
+				if (!(tmp = ast_realloc(tpeer->trunkdata, len + sh->len + IAX2_TRUNK_PREFACE))) {
+					/* Drop this shard's data rather than send a frame missing its meta entries */
+					ast_atomic_fetchadd_int(&tpeer->trunkdatalen, -(int) sh->len);
+					sh->len = 0;
+					sh->calls = 0;
+					ast_mutex_unlock(&sh->lock);
+					continue;
+				}
+				tpeer->trunkdata = tmp;
+				tpeer->trunkdataalloc = len + sh->len;
+			}
+			memcpy(tpeer->trunkdata + IAX2_TRUNK_PREFACE + len, sh->data, sh->len);
+			len += sh->len;
+			calls += sh->calls;
+			ast_atomic_fetchadd_int(&tpeer->trunkdatalen, -(int) sh->len);
+			sh->len = 0;
+			sh->calls = 0;
+		}
+		ast_mutex_unlock(&sh->lock);
+	}
+
+	if (len) {
+		/* Point to frame */
+		fr = (struct iax_frame *)tpeer->trunkdata;
+		/* Point to meta data */
+		meta = (struct ast_iax2_meta_hdr *)fr->afdata;
+		mth = (struct ast_iax2_meta_trunk_hdr *)meta->data;
 		/* We're actually sending a frame, so fill the meta trunk header and meta header */
 		meta->zeros = 0;
 		meta->metacmd = IAX_META_TRUNK;
@@ -9417,18 +9546,15 @@ static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 		/* And the rest of the ast_iax2 header */
 		fr->direction = DIRECTION_OUTGRESS;
 		fr->retrans = -1;
+		fr->retrans_sched = NULL;
 		fr->transfer = 0;
 		/* Any appropriate call will do */
 		fr->data = fr->afdata;
-		fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
+		fr->datalen = len + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
 		res = transmit_trunk(fr, &tpeer->addr, tpeer->sockfd);
-		calls = tpeer->calls;
 #if 0
 		ast_debug(1, "Trunking %d call chunks in %d bytes to %s:%d, ts=%d\n", calls, fr->datalen, ast_inet_ntoa(tpeer->addr.sin_addr), ntohs(tpeer->addr.sin_port), ntohl(mth->ts));
 #endif
-		/* Reset transmit trunk side data */
-		tpeer->trunkdatalen = 0;
-		tpeer->calls = 0;
 	}
 	if (res < 0)
 		return res;
@@ -9477,7 +9603,7 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			res = send_trunk(tpeer, &now);
 			trunk_timed++;
 			if (iaxtrunkdebug) {
-				ast_verbose(" - Trunk peer (%s) has %d call chunk%s in transit, %u bytes backloged and has hit a high water mark of %u bytes\n",
+				ast_verbose(" - Trunk peer (%s) has %d call chunk%s in transit, %d bytes backloged and has hit a high water mark of %u bytes\n",
 							ast_sockaddr_stringify(&tpeer->addr),
 							res,
 							(res != 1) ? "s" : "",
@@ -9493,6 +9619,8 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 	AST_LIST_UNLOCK(&tpeers);
 
 	if (drop) {
+		int x;
+
 		ast_mutex_lock(&drop->lock);
 		/*  Once we have this lock, we're sure nobody else is using it or could use it once we release it,
 			because by the time they could get tpeerlock, we've already grabbed it */
@@ -9501,6 +9629,16 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			ast_free(drop->trunkdata);
 			drop->trunkdata = NULL;
 		}
+		for (x = 0; x < IAX2_TRUNK_SHARDS; x++) {
+			/* Taking each shard lock waits out any call still appending to it */
+			ast_mutex_lock(&drop->shard[x].lock);
+			if (drop->shard[x].data) {
+				ast_free(drop->shard[x].data);
+				drop->shard[x].data = NULL;
+			}
+			ast_mutex_unlock(&drop->shard[x].lock);
+			ast_mutex_destroy(&drop->shard[x].lock);
+		}
 		ast_mutex_unlock(&drop->lock);
 		ast_mutex_destroy(&drop->lock);
 		ast_free(drop);
@@ -10627,7 +10765,7 @@ static int socket_process_helper(struct iax2_thread *thread)
 			}
 		}
 		if (f.frametype == AST_FRAME_IAX) {
-			AST_SCHED_DEL(sched, iaxs[fr->callno]->initid);
+			AST_SCHED_DEL(iaxs[fr->callno]->call_sched, iaxs[fr->callno]->initid);
 			/* Handle the IAX pseudo frame itself */
 			if (iaxdebug)
 				ast_debug(1, "IAX subclass %d received\n", f.subclass.integer);
@@ -12217,7 +12355,7 @@ static int iax2_provision(struct ast_sockaddr *end, int sockfd, const char *dest
 	if (iaxs[callno]) {
 		/* Schedule autodestruct in case they don't ever give us anything back */
 		iaxs[callno]->autoid = iax2_sched_replace(iaxs[callno]->autoid,
-			sched, 15000, auto_hangup, (void *)(long)callno);
+			iaxs[callno]->call_sched, 15000, auto_hangup, (void *)(long)callno);
 		ast_set_flag64(iaxs[callno], IAX_PROVISION);
 		/* Got a call number now, so go ahead and send the provisioning information */
 		send_command(iaxs[callno], AST_FRAME_IAX, IAX_COMMAND_PROVISION, 0, ied.buf, ied.pos, -1);
@@ -14688,6 +14826,20 @@ static void cleanup_thread_list(void *head)
 	AST_LIST_UNLOCK(list_head);
 }
 
+/*! \brief Tear down however many per-call scheduler contexts got created */
+static void destroy_call_scheds(void)
+{
+	int x;
+
+	for (x = 0; x < IAX2_CALL_SCHED_SHARDS; x++) {
+		if (call_scheds[x]) {
+			ast_sched_clean_by_callback(call_scheds[x], iax2_delete_from_sched, iax2_delete_from_sched_cleanup);
+			ast_sched_context_destroy(call_scheds[x]);
+			call_scheds[x] = NULL;
+		}
+	}
+}
+
 static int __unload_module(void)
 {
 	int x;
@@ -14764,6 +14916,7 @@ static int __unload_module(void)
 	ast_sched_clean_by_callback(sched, peercnt_remove_cb, peercnt_remove_cb);
 	ast_sched_context_destroy(sched);
 	sched = NULL;
+	destroy_call_scheds();
 	ao2_ref(peercnts, -1);
 
 	ast_context_destroy_by_name(regcontext, "IAX2");
@@ -14848,7 +15001,7 @@ static int load_objects(void)
 		goto container_fail;
 	} else if (create_callno_pools()) {
 		goto container_fail;
-	} else if  (!(transmit_processor = ast_taskprocessor_get("iax2_transmit", TPS_REF_DEFAULT))) {
+	} else if  (!(transmit_processor = ast_taskprocessor_get_pooled("iax2_transmit", TPS_REF_DEFAULT))) {
 		goto container_fail;
 	}
 
@@ -15095,7 +15248,7 @@ static int load_module(void)
 		ast_mutex_init(&iaxsl[x]);
 	}
 
-	if (!(sched = ast_sched_context_create())) {
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Failed to create scheduler thread\n");
 		return AST_MODULE_LOAD_FAILURE;
 	}
@@ -15106,8 +15259,20 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	for (x = 0; x < IAX2_CALL_SCHED_SHARDS; x++) {
+		if (!(call_scheds[x] = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))
+			|| ast_sched_start_thread(call_scheds[x])) {
+			ast_log(LOG_ERROR, "Failed to create call scheduler thread\n");
+			destroy_call_scheds();
+			ast_sched_context_destroy(sched);
+			sched = NULL;
+			return AST_MODULE_LOAD_FAILURE;
+		}
+	}
+
 	if (!(io = io_context_create())) {
 		ast_log(LOG_ERROR, "Failed to create I/O context\n");
+		destroy_call_scheds();
 		ast_sched_context_destroy(sched);
 		sched = NULL;
 		return AST_MODULE_LOAD_FAILURE;
@@ -15116,6 +15281,7 @@ static int load_module(void)
 	if (!(netsock = ast_netsock_list_alloc())) {
 		ast_log(LOG_ERROR, "Failed to create netsock list\n");
 		io_context_destroy(io);
+		destroy_call_scheds();
 		ast_sched_context_destroy(sched);
 		sched = NULL;
 		return AST_MODULE_LOAD_FAILURE;
@@ -15126,6 +15292,7 @@ static int load_module(void)
 	if (!outsock) {
 		ast_log(LOG_ERROR, "Could not allocate outsock list.\n");
 		io_context_destroy(io);
+		destroy_call_scheds();
 		ast_sched_context_destroy(sched);
 		sched = NULL;
 		return AST_MODULE_LOAD_FAILURE;
@@ -584,6 +584,18 @@ static int answer(void *data)
 	return (status == PJ_SUCCESS) ? 0 : -1;
 }
 
+/*! \brief Completion callback run by the session serializer after \ref answer */
+static void answer_complete(void *data, int res)
+{
+	struct ast_sip_session *session = data;
+
+	if (res) {
+		ast_log(LOG_WARNING, "Failed to answer session on endpoint '%s'\n",
+			ast_sorcery_object_get_id(session->endpoint));
+	}
+	ao2_ref(session, -1);
+}
+
 /*! \brief Function called by core when we should answer a PJSIP session */
 static int chan_pjsip_answer(struct ast_channel *ast)
 {
@@ -605,21 +617,20 @@ static int chan_pjsip_answer(struct ast_channel *ast)
 	}
 #endif
 
-	/* the answer task needs to be pushed synchronously otherwise a race condition
-	   can occur between this thread and bridging (specifically when native bridging
-	   attempts to do direct media) */
-	ast_channel_unlock(ast);
-	if (ast_sip_push_task_synchronous(session->serializer, answer, session)) {
+	/* The answer task must be queued on the serializer before this function
+	   returns so that it runs ahead of any direct media task bridging may
+	   push afterwards.  The completion push guarantees that ordering without
+	   making the channel thread sleep through a serializer round trip the
+	   way the old synchronous push did.  The session reference is consumed
+	   by answer_complete(). */
+	if (ast_sip_push_task_completion(session->serializer, answer, session, answer_complete)) {
 		ast_log(LOG_WARNING, "Unable to push answer task to the threadpool. Cannot answer call\n");
 #ifdef HAVE_PJSIP_INV_SESSION_REF
 		pjsip_inv_dec_ref(session->inv_session);
 #endif
 		ao2_ref(session, -1);
-		ast_channel_lock(ast);
 		return -1;
 	}
-	ao2_ref(session, -1);
-	ast_channel_lock(ast);
 
 	return 0;
 }
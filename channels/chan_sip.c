@@ -230,6 +230,9 @@
 #include <signal.h>
 #include <regex.h>
 #include <inttypes.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include "asterisk/network.h"
 #include "asterisk/paths.h"	/* need ast_config_AST_SYSTEM_NAME */
@@ -2553,6 +2556,225 @@ static struct sip_threadinfo *sip_threadinfo_create(struct ast_tcptls_session_in
 	return th;
 }
 
+#ifdef HAVE_EPOLL
+/*!
+ * \page SipTcpParking Idle TCP/TLS connection parking
+ *
+ * Rather than dedicating a mostly-idle thread to every TCP/TLS connection
+ * for its whole life, a helper thread that has seen no traffic for
+ * SIP_TCP_PARK_TIMEOUT seconds hands its connection to a single
+ * epoll-based parking thread and exits.  The parking thread watches the
+ * session socket and the alert pipe of every parked connection; when
+ * either becomes readable the connection is unparked onto a fresh helper
+ * thread, which resumes the normal processing path.  Helper thread count
+ * thus tracks concurrent traffic instead of connection count.
+ */
+
+/*! \brief Seconds a TCP/TLS helper thread stays idle before parking its connection */
+#define SIP_TCP_PARK_TIMEOUT 30
+
+/*! \brief An idle TCP/TLS connection watched by the parking thread */
+struct sip_tcptls_parked {
+	/*! The parked session; NULL once ownership passed to a new helper thread */
+	struct ast_tcptls_session_instance *tcptls_session;
+	/*! The connection's threadinfo, still linked in threadt */
+	struct sip_threadinfo *threadinfo;
+	/*! TRUE while the connection's fds are registered with epoll */
+	int armed;
+};
+
+static struct ao2_container *parked_sessions;
+static int park_epollfd = -1;
+static int park_alert_pipe[2] = { -1, -1 };
+static pthread_t park_thread = AST_PTHREADT_NULL;
+AST_MUTEX_DEFINE_STATIC(park_lock);
+
+static void sip_tcptls_parked_destructor(void *obj)
+{
+	struct sip_tcptls_parked *parked = obj;
+
+	if (parked->tcptls_session) {
+		ao2_t_ref(parked->tcptls_session, -1, "Release parked tcptls_session");
+	}
+	if (parked->threadinfo) {
+		ao2_t_ref(parked->threadinfo, -1, "Release parked threadinfo");
+	}
+}
+
+/*!
+ * \internal
+ * \brief Take a parked connection off the epoll set and give it a helper thread.
+ *
+ * \retval 0 if this call disarmed the entry; the caller must unlink it.
+ * \retval -1 if the entry was already disarmed by someone else.
+ */
+static int sip_tcp_unpark(struct sip_tcptls_parked *parked)
+{
+	struct ast_tcptls_session_instance *tcptls_session;
+	pthread_t launched;
+
+	ast_mutex_lock(&park_lock);
+	if (!parked->armed) {
+		ast_mutex_unlock(&park_lock);
+		return -1;
+	}
+	parked->armed = 0;
+	epoll_ctl(park_epollfd, EPOLL_CTL_DEL, parked->tcptls_session->fd, NULL);
+	epoll_ctl(park_epollfd, EPOLL_CTL_DEL, parked->threadinfo->alert_pipe[0], NULL);
+	ast_mutex_unlock(&park_lock);
+
+	/* Hand the entry's session reference over to a fresh helper thread. */
+	tcptls_session = parked->tcptls_session;
+	parked->tcptls_session = NULL;
+	if (ast_pthread_create_detached_background(&launched, NULL, sip_tcp_worker_fn, tcptls_session)) {
+		ast_log(LOG_ERROR, "Failed to launch helper thread for unparked SIP %s connection\n",
+			tcptls_session->ssl ? "TLS" : "TCP");
+		ao2_t_unlink(threadt, parked->threadinfo, "Removing threadinfo, unpark failed");
+		ao2_lock(tcptls_session);
+		ast_tcptls_close_session_file(tcptls_session);
+		tcptls_session->parent = NULL;
+		ao2_unlock(tcptls_session);
+		ao2_t_ref(tcptls_session, -1, "Release session, unpark failed");
+	}
+	return 0;
+}
+
+/*! \brief The shared event loop watching all parked connections */
+static void *sip_tcp_park_thread(void *data)
+{
+	struct epoll_event events[16];
+	struct sip_tcptls_parked *done[ARRAY_LEN(events)];
+	int count, idx, done_count;
+
+	for (;;) {
+		count = epoll_wait(park_epollfd, events, ARRAY_LEN(events), -1);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ast_log(LOG_ERROR, "SIP TCP parking thread: epoll_wait() failed: %s\n",
+				strerror(errno));
+			break;
+		}
+
+		/*
+		 * Unlinking is deferred to the end of the batch: a connection's
+		 * socket and alert pipe can both appear in one batch, and the
+		 * container reference must keep the entry alive until every
+		 * event referring to it has been looked at.
+		 */
+		done_count = 0;
+		for (idx = 0; idx < count; idx++) {
+			struct sip_tcptls_parked *parked = events[idx].data.ptr;
+
+			if (!parked) {
+				/* Alert pipe says the module is unloading. */
+				return NULL;
+			}
+			if (!sip_tcp_unpark(parked)) {
+				done[done_count++] = parked;
+			}
+		}
+		for (idx = 0; idx < done_count; idx++) {
+			ao2_t_unlink(parked_sessions, done[idx], "Connection unparked");
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Park an idle authenticated connection onto the shared epoll thread.
+ *
+ * \retval 0 on success; the caller's tcptls_session reference is consumed
+ * and the calling helper thread must exit without closing the session.
+ * \retval -1 on failure; the caller keeps ownership and continues serving.
+ */
+static int sip_tcp_park(struct ast_tcptls_session_instance *tcptls_session, struct sip_threadinfo *me)
+{
+	struct sip_tcptls_parked *parked;
+	struct epoll_event ev = { .events = EPOLLIN, };
+
+	ast_mutex_lock(&park_lock);
+	if (park_epollfd == -1 && (park_epollfd = epoll_create1(0)) == -1) {
+		ast_mutex_unlock(&park_lock);
+		return -1;
+	}
+	if (park_thread == AST_PTHREADT_NULL) {
+		struct epoll_event alert_ev = { .events = EPOLLIN, };
+
+		if (park_alert_pipe[0] == -1 && pipe(park_alert_pipe)) {
+			ast_mutex_unlock(&park_lock);
+			return -1;
+		}
+		if (epoll_ctl(park_epollfd, EPOLL_CTL_ADD, park_alert_pipe[0], &alert_ev)
+			|| ast_pthread_create_background(&park_thread, NULL, sip_tcp_park_thread, NULL)) {
+			park_thread = AST_PTHREADT_NULL;
+			ast_mutex_unlock(&park_lock);
+			return -1;
+		}
+	}
+	ast_mutex_unlock(&park_lock);
+
+	parked = ao2_t_alloc(sizeof(*parked), sip_tcptls_parked_destructor, "Allocate parked connection");
+	if (!parked) {
+		return -1;
+	}
+	parked->tcptls_session = tcptls_session; /* Steals the caller's ref on success */
+	ao2_t_ref(me, +1, "threadinfo ref for parked connection");
+	parked->threadinfo = me;
+	ao2_t_link(parked_sessions, parked, "Parking idle connection");
+
+	ev.data.ptr = parked;
+	ast_mutex_lock(&park_lock);
+	parked->armed = 1;
+	if (epoll_ctl(park_epollfd, EPOLL_CTL_ADD, tcptls_session->fd, &ev)
+		|| epoll_ctl(park_epollfd, EPOLL_CTL_ADD, me->alert_pipe[0], &ev)) {
+		epoll_ctl(park_epollfd, EPOLL_CTL_DEL, tcptls_session->fd, NULL);
+		parked->armed = 0;
+		parked->tcptls_session = NULL; /* The caller keeps its reference */
+		ast_mutex_unlock(&park_lock);
+		ao2_t_unlink(parked_sessions, parked, "Failed to park connection");
+		ao2_t_ref(parked, -1, "Drop alloc ref, failed to park");
+		return -1;
+	}
+	ast_mutex_unlock(&park_lock);
+	ao2_t_ref(parked, -1, "Drop alloc ref, container holds the parked connection");
+	return 0;
+}
+
+/*! \brief Stop the parking thread and release its resources */
+static void sip_tcp_park_shutdown(void)
+{
+	pthread_t thread;
+
+	ast_mutex_lock(&park_lock);
+	thread = park_thread;
+	park_thread = AST_PTHREADT_NULL;
+	ast_mutex_unlock(&park_lock);
+
+	if (thread != AST_PTHREADT_NULL) {
+		int stop = 1;
+
+		if (write(park_alert_pipe[1], &stop, sizeof(stop)) != sizeof(stop)) {
+			ast_log(LOG_ERROR, "Failed to alert SIP TCP parking thread to stop: %s\n",
+				strerror(errno));
+			pthread_kill(thread, SIGURG);
+		}
+		pthread_join(thread, NULL);
+	}
+	if (park_alert_pipe[0] != -1) {
+		close(park_alert_pipe[0]);
+		close(park_alert_pipe[1]);
+		park_alert_pipe[0] = park_alert_pipe[1] = -1;
+	}
+	if (park_epollfd != -1) {
+		close(park_epollfd);
+		park_epollfd = -1;
+	}
+}
+#endif	/* HAVE_EPOLL */
+
 /*! \brief used to indicate to a tcptls thread that data is ready to be written */
 static int sip_tcptls_write(struct ast_tcptls_session_instance *tcptls_session, const void *buf, size_t len)
 {
@@ -2949,26 +3171,36 @@ static void *_sip_tcp_helper_thread(struct ast_tcptls_session_instance *tcptls_s
 	 * 3. Last, the tcptls_session must be started.
 	 */
 	if (!tcptls_session->client) {
-		if (ast_atomic_fetchadd_int(&unauth_sessions, +1) >= authlimit) {
-			/* unauth_sessions is decremented in the cleanup code */
-			goto cleanup;
-		}
+		struct sip_threadinfo tmp = {
+			.tcptls_session = tcptls_session,
+		};
 
-		if ((flags = fcntl(tcptls_session->fd, F_GETFL)) == -1) {
-			ast_log(LOG_ERROR, "error setting socket to non blocking mode, fcntl() failed: %s\n", strerror(errno));
-			goto cleanup;
-		}
+		if ((me = ao2_t_find(threadt, &tmp, OBJ_POINTER, "ao2_find, resuming parked connection in tcp helper thread"))) {
+			/* This is a connection that was parked while idle being
+			 * unparked; it authenticated before it was parked. */
+			authenticated = 1;
+		} else {
+			if (ast_atomic_fetchadd_int(&unauth_sessions, +1) >= authlimit) {
+				/* unauth_sessions is decremented in the cleanup code */
+				goto cleanup;
+			}
 
-		flags |= O_NONBLOCK;
-		if (fcntl(tcptls_session->fd, F_SETFL, flags) == -1) {
-			ast_log(LOG_ERROR, "error setting socket to non blocking mode, fcntl() failed: %s\n", strerror(errno));
-			goto cleanup;
-		}
+			if ((flags = fcntl(tcptls_session->fd, F_GETFL)) == -1) {
+				ast_log(LOG_ERROR, "error setting socket to non blocking mode, fcntl() failed: %s\n", strerror(errno));
+				goto cleanup;
+			}
 
-		if (!(me = sip_threadinfo_create(tcptls_session, tcptls_session->ssl ? AST_TRANSPORT_TLS : AST_TRANSPORT_TCP))) {
-			goto cleanup;
+			flags |= O_NONBLOCK;
+			if (fcntl(tcptls_session->fd, F_SETFL, flags) == -1) {
+				ast_log(LOG_ERROR, "error setting socket to non blocking mode, fcntl() failed: %s\n", strerror(errno));
+				goto cleanup;
+			}
+
+			if (!(me = sip_threadinfo_create(tcptls_session, tcptls_session->ssl ? AST_TRANSPORT_TLS : AST_TRANSPORT_TCP))) {
+				goto cleanup;
+			}
+			ao2_t_ref(me, +1, "Adding threadinfo ref for tcp_helper_thread");
 		}
-		ao2_t_ref(me, +1, "Adding threadinfo ref for tcp_helper_thread");
 	} else {
 		struct sip_threadinfo tmp = {
 			.tcptls_session = tcptls_session,
@@ -3014,7 +3246,7 @@ static void *_sip_tcp_helper_thread(struct ast_tcptls_session_instance *tcptls_s
 	ast_tcptls_stream_set_exclusive_input(tcptls_session->stream_cookie, 0);
 
 	ast_tcptls_stream_set_timeout_sequence(tcptls_session->stream_cookie, ast_tvnow(),
-		tcptls_session->client ? -1 : (authtimeout * 1000));
+		(tcptls_session->client || authenticated) ? -1 : (authtimeout * 1000));
 
 	for (;;) {
 		struct ast_str *str_save;
@@ -3036,7 +3268,13 @@ static void *_sip_tcp_helper_thread(struct ast_tcptls_session_instance *tcptls_s
 				goto cleanup;
 			}
 		} else {
+#ifdef HAVE_EPOLL
+			/* Idle authenticated server connections get parked on the
+			 * shared epoll thread instead of pinning this one. */
+			timeout = tcptls_session->client ? -1 : (SIP_TCP_PARK_TIMEOUT * 1000);
+#else
 			timeout = -1;
+#endif
 		}
 
 		if (ast_str_strlen(tcptls_session->overflow_buf) == 0) {
@@ -3045,6 +3283,23 @@ static void *_sip_tcp_helper_thread(struct ast_tcptls_session_instance *tcptls_s
 				ast_debug(2, "SIP %s server :: ast_wait_for_input returned %d\n", tcptls_session->ssl ? "TLS": "TCP", res);
 				goto cleanup;
 			} else if (res == 0) {
+#ifdef HAVE_EPOLL
+				if (authenticated && !tcptls_session->client) {
+					if (!ast_tcptls_stream_pending(tcptls_session->stream_cookie)
+						&& !sip_tcp_park(tcptls_session, me)) {
+						/* The connection now belongs to the parking
+						 * thread; exit without closing the session. */
+						ast_debug(2, "Parked idle SIP %s connection\n",
+							tcptls_session->ssl ? "TLS" : "TCP");
+						ao2_t_ref(me, -1, "Removing tcp_helper_threads threadinfo ref, connection parked");
+						deinit_req(&reqcpy);
+						deinit_req(&req);
+						return NULL;
+					}
+					/* Could not park; keep serving the connection. */
+					continue;
+				}
+#endif
 				/* timeout */
 				ast_debug(2, "SIP %s server timed out\n", tcptls_session->ssl ? "TLS": "TCP");
 				goto cleanup;
@@ -5567,6 +5822,99 @@ static int realtime_peer_by_addr(const char **name, struct ast_sockaddr *addr, c
 	return 1;
 }
 
+/*! \brief A peer name that recently failed a realtime lookup.
+ *
+ * Scanners probing a public box generate a steady stream of requests for
+ * From-users that do not exist, and without this cache every one of them
+ * turned into a database query.  Misses are remembered for
+ * \ref sip_settings::rtnegcachettl seconds.
+ */
+struct sip_negcache_entry {
+	time_t expiry;
+	char name[0];
+};
+
+static struct ao2_container *rt_negcache;
+
+static int negcache_hash_cb(const void *obj, const int flags)
+{
+	const struct sip_negcache_entry *entry = obj;
+
+	return ast_str_case_hash((flags & OBJ_KEY) ? obj : entry->name);
+}
+
+static int negcache_cmp_cb(void *obj, void *arg, int flags)
+{
+	struct sip_negcache_entry *entry = obj;
+	const char *name = (flags & OBJ_KEY) ? arg : ((struct sip_negcache_entry *) arg)->name;
+
+	return !strcasecmp(entry->name, name) ? CMP_MATCH | CMP_STOP : 0;
+}
+
+/*! \brief Check whether a name recently failed a realtime lookup.
+ * \retval TRUE The name is a cached miss and the database need not be asked.
+ */
+static int sip_negcache_check(const char *name)
+{
+	struct sip_negcache_entry *entry;
+	int hit = FALSE;
+
+	if (!rt_negcache) {
+		return FALSE;
+	}
+
+	entry = ao2_t_find(rt_negcache, (char *) name, OBJ_KEY, "find name in negative cache");
+	if (entry) {
+		if (time(NULL) < entry->expiry) {
+			hit = TRUE;
+		} else {
+			ao2_t_unlink(rt_negcache, entry, "expire negative cache entry");
+		}
+		ao2_t_ref(entry, -1, "drop negative cache find ref");
+	}
+
+	return hit;
+}
+
+/*! \brief Remember that a name failed a realtime lookup */
+static void sip_negcache_add(const char *name)
+{
+	struct sip_negcache_entry *entry;
+
+	if (!rt_negcache) {
+		return;
+	}
+
+	entry = ao2_t_alloc(sizeof(*entry) + strlen(name) + 1, NULL, "allocate negative cache entry");
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->name, name); /* safe */
+	entry->expiry = time(NULL) + sip_cfg.rtnegcachettl;
+	ao2_t_link(rt_negcache, entry, "link entry into negative cache");
+	ao2_t_ref(entry, -1, "drop negative cache alloc ref");
+}
+
+/*! \brief Forget a cached miss, e.g. because the peer turned up after all */
+static void sip_negcache_invalidate(const char *name)
+{
+	struct sip_negcache_entry *entry;
+
+	if (!rt_negcache) {
+		return;
+	}
+	entry = ao2_t_find(rt_negcache, (char *) name, OBJ_KEY | OBJ_UNLINK, "invalidate negative cache entry");
+	ao2_t_cleanup(entry, "drop invalidated negative cache entry");
+}
+
+/*! \brief Drop all cached misses, e.g. because the database was repopulated */
+static void sip_negcache_flush(void)
+{
+	if (rt_negcache) {
+		ao2_t_callback(rt_negcache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL, "flush negative cache");
+	}
+}
+
 static int register_realtime_peers_with_callbackextens(void)
 {
 	struct ast_config *cfg;
@@ -5599,6 +5947,77 @@ static int register_realtime_peers_with_callbackextens(void)
 	return 0;
 }
 
+/*! \brief Bulk load all realtime peers into the peer cache.
+ *
+ * With rtpreloadfriends enabled, the whole sippeers table is streamed into
+ * the cache with a single query (two with sipregs) instead of one query
+ * per peer on first use, so steady state inbound processing only touches
+ * the database on cache misses.  Requires rtcachefriends.
+ */
+static int preload_realtime_peers(void)
+{
+	struct ast_config *cfg;
+	struct ast_config *regs = NULL;
+	char *cat = NULL;
+	int loaded = 0;
+
+	if (!sip_cfg.rtpreloadfriends
+		|| !ast_test_flag(&global_flags[1], SIP_PAGE2_RTCACHEFRIENDS)
+		|| !ast_check_realtime("sippeers")) {
+		return 0;
+	}
+
+	/* As above, name must be the first property so it becomes the category */
+	if (!(cfg = ast_load_realtime_multientry("sippeers", "name LIKE", "%", SENTINEL))) {
+		return -1;
+	}
+	if (ast_check_realtime("sipregs")) {
+		regs = ast_load_realtime_multientry("sipregs", "name LIKE", "%", SENTINEL);
+	}
+
+	while ((cat = ast_category_browse(cfg, cat))) {
+		struct sip_peer *peer;
+		struct ast_variable *var = ast_category_root(cfg, cat);
+		struct ast_variable *varregs = regs ? ast_category_root(regs, cat) : NULL;
+
+		/* The peer may already be cached from before a reload */
+		if ((peer = sip_find_peer(cat, NULL, FALSE, FINDALLDEVICES, FALSE, 0))) {
+			sip_unref_peer(peer, "preload: peer is already cached");
+			continue;
+		}
+
+		if (!(peer = build_peer(cat, var, varregs, TRUE, FALSE))) {
+			continue;
+		}
+
+		ast_copy_flags(&peer->flags[1], &global_flags[1], SIP_PAGE2_RTAUTOCLEAR|SIP_PAGE2_RTCACHEFRIENDS);
+		if (ast_test_flag(&global_flags[1], SIP_PAGE2_RTAUTOCLEAR)) {
+			AST_SCHED_REPLACE_UNREF(peer->expire, sched, sip_cfg.rtautoclear * 1000, expire_register, peer,
+					sip_unref_peer(_data, "remove registration ref"),
+					sip_unref_peer(peer, "remove registration ref"),
+					sip_ref_peer(peer, "add registration ref"));
+		}
+		ao2_t_link(peers, peer, "link preloaded peer into peers table");
+		if (!ast_sockaddr_isnull(&peer->addr)) {
+			ao2_t_link(peers_by_ip, peer, "link preloaded peer into peers_by_ip table");
+		}
+		peer->is_realtime = 1;
+		loaded++;
+		sip_unref_peer(peer, "preload: done with peer");
+	}
+
+	if (regs) {
+		ast_config_destroy(regs);
+	}
+	ast_config_destroy(cfg);
+
+	if (loaded) {
+		ast_verb(3, "Preloaded %d realtime SIP peers into the cache\n", loaded);
+	}
+
+	return 0;
+}
+
 /*! \brief  realtime_peer: Get peer from realtime storage
  * Checks the "sippeers" realtime family from extconfig.conf
  * Checks the "sipregs" realtime family from extconfig.conf if it's configured.
@@ -5615,6 +6034,7 @@ static struct sip_peer *realtime_peer(const char *newpeername, struct ast_sockad
 	struct ast_variable *varregs = NULL;
 	char ipaddr[INET6_ADDRSTRLEN];
 	int realtimeregs = ast_check_realtime("sipregs");
+	int negcache_miss = 0;
 
 	if (addr) {
 		ast_copy_string(ipaddr, ast_sockaddr_stringify_addr(addr), sizeof(ipaddr));
@@ -5622,11 +6042,19 @@ static struct sip_peer *realtime_peer(const char *newpeername, struct ast_sockad
 		ipaddr[0] = '\0';
 	}
 
-	if (newpeername && realtime_peer_by_name(&newpeername, addr, ipaddr, &var, realtimeregs ? &varregs : NULL)) {
+	if (newpeername && sip_cfg.rtnegcachettl > 0 && sip_negcache_check(newpeername)) {
+		ast_debug(3, "-REALTIME- skipping database lookup for '%s' (cached miss)\n", newpeername);
+		negcache_miss = 1;
+	}
+
+	if (newpeername && !negcache_miss && realtime_peer_by_name(&newpeername, addr, ipaddr, &var, realtimeregs ? &varregs : NULL)) {
 		;
 	} else if (addr && realtime_peer_by_addr(&newpeername, addr, ipaddr, callbackexten, &var, realtimeregs ? &varregs : NULL)) {
 		;
 	} else {
+		if (newpeername && !negcache_miss && sip_cfg.rtnegcachettl > 0) {
+			sip_negcache_add(newpeername);
+		}
 		return NULL;
 	}
 
@@ -5647,6 +6075,11 @@ static struct sip_peer *realtime_peer(const char *newpeername, struct ast_sockad
 		goto cleanup;
 	}
 
+	/* An address lookup can turn up a name that failed a lookup earlier */
+	if (sip_cfg.rtnegcachettl > 0) {
+		sip_negcache_invalidate(peer->name);
+	}
+
 	/* Previous versions of Asterisk did not require the type field to be
 	 * set for real time peers.  This statement preserves that behavior. */
 	if  (peer->type == 0) {
@@ -6686,6 +7119,9 @@ static void sip_pvt_dtor(void *vdoomed)
 
 	offered_media_list_destroy(p);
 
+	ast_free(p->last_sdp_body);
+	p->last_sdp_body = NULL;
+
 	if (p->chanvars) {
 		ast_variables_destroy(p->chanvars);
 		p->chanvars = NULL;
@@ -8447,6 +8883,28 @@ static const char *find_full_alias(const char *name, const char *_default)
 	return _default;
 }
 
+/*! \brief Hash a header name down to one byte for quick mismatch rejection
+ *
+ * The hash covers the characters up to (but not including) the ':' separating
+ * the name from the value, folding case and skipping blanks so that it matches
+ * the comparisons done in __get_header(), including the blanks-before-colon
+ * tolerance enabled by pedanticsipchecking.  Collisions are harmless; a hash
+ * match only means the full comparison in __get_header() still runs.
+ */
+static unsigned char header_name_hash(const char *name)
+{
+	unsigned int hash = 5381;
+
+	for (; *name && *name != ':'; name++) {
+		if (*name == ' ' || *name == '\t') {
+			continue;
+		}
+		hash = hash * 33 ^ (unsigned char) tolower(*name);
+	}
+
+	return hash & 0xff;
+}
+
 static const char *__get_header(const struct sip_request *req, const char *name, int *start)
 {
 	/*
@@ -8460,9 +8918,19 @@ static const char *__get_header(const struct sip_request *req, const char *name,
 	 */
 	const char *sname = find_alias(name, NULL);
 	int x, len = strlen(name), slen = (sname ? 1 : 0);
+	unsigned char hash = header_name_hash(name);
+	unsigned char shash = slen ? header_name_hash(sname) : 0;
 	for (x = *start; x < req->headers; x++) {
-		const char *header = REQ_OFFSET_TO_STR(req, header[x]);
-		int smatch = 0, match = !strncasecmp(header, name, len);
+		const char *header;
+		int smatch = 0, match;
+
+		/* The name hashes recorded by parse_request() let us reject
+		   non-matching headers without reading the line itself. */
+		if (req->header_hash[x] != hash && (!slen || req->header_hash[x] != shash)) {
+			continue;
+		}
+		header = REQ_OFFSET_TO_STR(req, header[x]);
+		match = !strncasecmp(header, name, len);
 		if (slen) {
 			smatch = !strncasecmp(header, sname, slen);
 		}
@@ -9918,6 +10386,12 @@ static int parse_request(struct sip_request *req)
 		ast_log(LOG_WARNING, "Too many lines, skipping <%s>\n", c);
 	}
 
+	/* Record each header's name hash so get_header() can skip
+	   non-matching headers without comparing their names */
+	for (i = 0; i < req->headers; i++) {
+		req->header_hash[i] = header_name_hash(REQ_OFFSET_TO_STR(req, header[i]));
+	}
+
 	/* Split up the first line parts */
 	return determine_firstline_parts(req);
 }
@@ -10075,6 +10549,52 @@ static int has_media_stream(struct sip_pvt *p, enum media_type m)
  	Return 0 on success, a negative value on errors.
 	Must be called after find_sdp().
 */
+/*!
+ * \internal
+ * \brief Copy the SDP body of a request, skipping the o= line.
+ *
+ * Session timer refreshes commonly carry an SDP identical to the last
+ * negotiated one except for an incremented o= version.  Keeping a copy
+ * of the body with the o= line excluded lets process_sdp() recognize
+ * such refreshes by exact comparison and skip renegotiation.
+ */
+static char *sdp_body_dup(struct sip_request *req)
+{
+	size_t len = 0;
+	unsigned int idx;
+	unsigned int stop = req->sdp_start + req->sdp_count;
+	const char *line;
+	char *body;
+	char *pos;
+
+	for (idx = req->sdp_start; idx < stop; ++idx) {
+		line = REQ_OFFSET_TO_STR(req, line[idx]);
+		if (line[0] == 'o' && line[1] == '=') {
+			continue;
+		}
+		len += strlen(line) + 1;
+	}
+
+	body = ast_malloc(len + 1);
+	if (!body) {
+		return NULL;
+	}
+	pos = body;
+	for (idx = req->sdp_start; idx < stop; ++idx) {
+		line = REQ_OFFSET_TO_STR(req, line[idx]);
+		if (line[0] == 'o' && line[1] == '=') {
+			continue;
+		}
+		len = strlen(line);
+		memcpy(pos, line, len);
+		pos += len;
+		*pos++ = '\n';
+	}
+	*pos = '\0';
+
+	return body;
+}
+
 static int process_sdp(struct sip_pvt *p, struct sip_request *req, int t38action, int is_offer)
 {
 	int res = 0;
@@ -10136,6 +10656,7 @@ static int process_sdp(struct sip_pvt *p, struct sip_request *req, int t38action
 	int red_num_gen = 0;		/* For T.140 RED */
 	char red_fmtp[100] = "empty";	/* For T.140 RED */
 	int debug = sip_debug_test_pvt(p);
+	char *sdp_body = sdp_body_dup(req);
 
 	/* START UNKNOWN */
 	struct ast_str *codec_buf = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
@@ -10184,6 +10705,17 @@ static int process_sdp(struct sip_pvt *p, struct sip_request *req, int t38action
 				res = (p->session_modify == FALSE) ? 0 : -1;
 				goto process_sdp_cleanup;
 			}
+			/* Even when the version was incremented, a body identical to
+			 * the last one we negotiated (o= line aside) is only a session
+			 * refresh, so skip renegotiation entirely. */
+			if (is_offer && t38action == SDP_T38_NONE
+				&& sdp_body && p->last_sdp_body
+				&& !strcmp(sdp_body, p->last_sdp_body)) {
+				ast_debug(2, "Call %s sent a session refresh with an unchanged SDP body; skipping renegotiation.\n", p->callid);
+				p->session_modify = FALSE;
+				res = 0;
+				goto process_sdp_cleanup;
+			}
 			processed = TRUE;
 			break;
 		case 'c':
@@ -11067,7 +11599,15 @@ static int process_sdp(struct sip_pvt *p, struct sip_request *req, int t38action
 		change_hold_state(p, req, TRUE, sendonly);
 	}
 
+	/* Remember the SDP we accepted so an identical refresh can be recognized. */
+	if (sdp_body) {
+		ast_free(p->last_sdp_body);
+		p->last_sdp_body = sdp_body;
+		sdp_body = NULL;
+	}
+
 process_sdp_cleanup:
+	ast_free(sdp_body);
 	if (res) {
 		offered_media_list_destroy(p);
 	}
@@ -16376,6 +16916,9 @@ static void destroy_association(struct sip_peer *peer)
 			ast_db_del("SIP/PeerMethods", peer->name);
 		}
 	}
+
+	/* The astdb entry is gone (or stale), so the next registration must be written out again */
+	ast_string_field_set(peer, regdata, "");
 }
 
 static void set_socket_transport(struct sip_socket *socket, int transport)
@@ -16713,6 +17256,7 @@ static int set_address_from_contact(struct sip_pvt *pvt)
 static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, struct sip_peer *peer, struct sip_request *req)
 {
 	char contact[SIPBUFSIZE];
+	char oldcontact[SIPBUFSIZE];
 	char data[SIPBUFSIZE];
 	const char *expires = sip_get_header(req, "Expires");
 	int expire = atoi(expires);
@@ -16724,6 +17268,8 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 	int start = 0;
 	int wildcard_found = 0;
 	int single_binding_found = 0;
+	int had_registration = (peer->expire > -1);
+	int unchanged = 0;
 
 	ast_copy_string(contact, __get_header(req, "Contact", &start), sizeof(contact));
 
@@ -16795,6 +17341,9 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 		return PARSE_REGISTER_UPDATE;
 	}
 
+	/* Remember the binding we had so an identical re-registration can be detected below */
+	ast_copy_string(oldcontact, peer->fullcontact, sizeof(oldcontact));
+
 	/* Store whatever we got as a contact from the client */
 	ast_string_field_set(peer, fullcontact, curi);
 
@@ -16877,6 +17426,14 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 		ao2_t_link(peers_by_ip, peer, "ao2_link into peers_by_ip table");
 	}
 
+	/* A re-registration repeating the binding we already have refreshes the
+	 * expiry schedule but changes nothing anybody else can observe, so the
+	 * state publishing and qualify restart below may be skipped.  This is
+	 * what keeps a post-outage registration storm cheap. */
+	unchanged = had_registration
+		&& !ast_sockaddr_cmp(&peer->addr, &oldsin)
+		&& !strcmp(peer->fullcontact, oldcontact);
+
 	/* Save SIP options profile */
 	peer->sipoptions = pvt->sipoptions;
 
@@ -16903,7 +17460,7 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 	snprintf(data, sizeof(data), "%s:%d:%s:%s", ast_sockaddr_stringify(&peer->addr),
 		 expire, peer->username, peer->fullcontact);
 	/* We might not immediately be able to reconnect via TCP, but try caching it anyhow */
-	if (!peer->rt_fromcontact || !sip_cfg.peer_rtupdate) {
+	if ((!peer->rt_fromcontact || !sip_cfg.peer_rtupdate) && strcmp(data, peer->regdata)) {
 		if (!sip_route_empty(&peer->path)) {
 			struct ast_str *r = sip_route_list(&peer->path, 0, 0);
 			if (r) {
@@ -16912,9 +17469,11 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 			}
 		}
 		ast_db_put("SIP/Registry", peer->name, data);
+		ast_string_field_set(peer, regdata, data);
 	}
 
-	if (peer->endpoint) {
+	if (peer->endpoint
+		&& (!unchanged || ast_endpoint_get_state(peer->endpoint) != AST_ENDPOINT_ONLINE)) {
 		RAII_VAR(struct ast_json *, blob, NULL, ast_json_unref);
 		ast_endpoint_set_state(peer->endpoint, AST_ENDPOINT_ONLINE);
 		blob = ast_json_pack("{s: s, s: s}",
@@ -16928,10 +17487,14 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 		ast_verb(3, "Registered SIP '%s' at %s\n", peer->name,
 			ast_sockaddr_stringify(&peer->addr));
 	}
-	sip_pvt_unlock(pvt);
-	sip_poke_peer(peer, 0);
-	sip_pvt_lock(pvt);
-	register_peer_exten(peer, 1);
+	if (!unchanged || (!peer->call && peer->pokeexpire == -1)) {
+		sip_pvt_unlock(pvt);
+		sip_poke_peer(peer, 0);
+		sip_pvt_lock(pvt);
+	}
+	if (!unchanged) {
+		register_peer_exten(peer, 1);
+	}
 
 	/* Save User agent */
 	useragent = sip_get_header(req, "User-Agent");
@@ -20516,11 +21079,13 @@ static char *sip_prune_realtime(struct ast_cli_entry *e, int cmd, struct ast_cli
 				ast_cli(a->fd, "%d peers pruned.\n", pruned);
 			} else
 				ast_cli(a->fd, "No peers found to prune.\n");
+			sip_negcache_flush();
 		}
 	} else {
 		if (prunepeer) {
 			struct sip_peer tmp;
 			ast_copy_string(tmp.name, name, sizeof(tmp.name));
+			sip_negcache_invalidate(name);
 			if ((peer = ao2_t_find(peers, &tmp, OBJ_POINTER | OBJ_UNLINK, "finding to unlink from peers"))) {
 				if (!ast_sockaddr_isnull(&peer->addr)) {
 					ao2_t_unlink(peers_by_ip, peer, "unlinking peer from peers_by_ip also");
@@ -21713,6 +22278,8 @@ static char *sip_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		ast_cli(a->fd, "  Save sys. name:         %s\n", AST_CLI_YESNO(sip_cfg.rtsave_sysname));
 		ast_cli(a->fd, "  Save path header:       %s\n", AST_CLI_YESNO(sip_cfg.rtsave_path));
 		ast_cli(a->fd, "  Auto Clear:             %d (%s)\n", sip_cfg.rtautoclear, ast_test_flag(&global_flags[1], SIP_PAGE2_RTAUTOCLEAR) ? "Enabled" : "Disabled");
+		ast_cli(a->fd, "  Preload Friends:        %s\n", AST_CLI_YESNO(sip_cfg.rtpreloadfriends));
+		ast_cli(a->fd, "  Neg. Cache TTL:         %d (%s)\n", sip_cfg.rtnegcachettl, sip_cfg.rtnegcachettl > 0 ? "Enabled" : "Disabled");
 	}
 	ast_cli(a->fd, "\n----\n");
 	return CLI_SUCCESS;
@@ -28882,6 +29449,215 @@ static int handle_incoming(struct sip_pvt *p, struct sip_request *req, struct as
 	return res;
 }
 
+/*! \brief Upper bound on distributor_threads from sip.conf */
+#define DISTRIBUTOR_MAX_THREADS 32
+
+/*! \brief Received messages a single distributor queue may hold before new ones are dropped */
+#define DISTRIBUTOR_QUEUE_DEPTH 1000
+
+/*! \brief A received UDP message waiting for a distributor thread */
+struct distributor_msg {
+	struct sip_request req;
+	struct ast_sockaddr addr;
+	AST_LIST_ENTRY(distributor_msg) next;
+};
+
+/*! \brief One distributor thread and its queue of received UDP messages
+ *
+ * Messages are assigned to a queue by a hash of their Call-ID, so all
+ * messages belonging to one dialog are handled in arrival order by the
+ * same thread.  Everything else the message touches is protected by the
+ * dialog and channel locks taken in handle_request_do().
+ */
+struct distributor_queue {
+	ast_mutex_t lock;
+	ast_cond_t wakeup;
+	pthread_t thread;
+	int depth;                          /*!< Number of queued messages */
+	AST_LIST_HEAD_NOLOCK(, distributor_msg) msgs;
+};
+
+static struct distributor_queue *distributor_queues;
+static int distributor_count;    /*!< Number of running distributor threads */
+static int distributor_stopping;
+
+/*! \brief Hash the Call-ID of a not-yet-parsed message to pick a distributor queue
+ *
+ * This runs on the raw datagram, where lines still end in CRLF.  Both the
+ * long and compact header forms are recognized, with the same tolerance
+ * for blanks around the colon that __get_header() has.  Messages without
+ * a Call-ID all land on queue zero; handle_request_do() rejects them.
+ */
+static unsigned int distributor_callid_hash(const char *buf)
+{
+	const char *line = buf;
+
+	while (line && *line) {
+		const char *value = NULL;
+
+		if (!strncasecmp(line, "Call-ID", 7)) {
+			value = ast_skip_blanks(line + 7);
+		} else if (tolower(*line) == 'i') {
+			value = ast_skip_blanks(line + 1);
+		}
+		if (value && *value == ':') {
+			unsigned int hash = 5381;
+
+			for (value = ast_skip_blanks(value + 1); *value && *value != '\r' && *value != '\n'; value++) {
+				hash = hash * 33 ^ (unsigned char) *value;
+			}
+			return hash;
+		}
+		line = strchr(line, '\n');
+		if (line) {
+			line++;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Hand a received UDP message to the distributor thread owning its Call-ID */
+static int distributor_dispatch(const char *readbuf, struct ast_sockaddr *addr)
+{
+	struct distributor_msg *msg;
+	struct distributor_queue *queue;
+
+	if (!(msg = ast_calloc(1, sizeof(*msg)))) {
+		return 1;
+	}
+
+	if (!(msg->req.data = ast_str_create(SIP_MIN_PACKET))
+		|| ast_str_set(&msg->req.data, 0, "%s", readbuf) == AST_DYNSTR_BUILD_FAILED) {
+		deinit_req(&msg->req);
+		ast_free(msg);
+		return 1;
+	}
+
+	msg->req.socket.fd = sipsock;
+	set_socket_transport(&msg->req.socket, AST_TRANSPORT_UDP);
+	msg->req.socket.tcptls_session = NULL;
+	msg->req.socket.port = htons(ast_sockaddr_port(&bindaddr));
+	ast_sockaddr_copy(&msg->addr, addr);
+
+	queue = &distributor_queues[distributor_callid_hash(readbuf) % distributor_count];
+
+	ast_mutex_lock(&queue->lock);
+	if (queue->depth >= DISTRIBUTOR_QUEUE_DEPTH) {
+		ast_mutex_unlock(&queue->lock);
+		ast_debug(1, "SIP distributor queue full, dropping message from %s\n",
+			ast_sockaddr_stringify(addr));
+		deinit_req(&msg->req);
+		ast_free(msg);
+		return 1;
+	}
+	AST_LIST_INSERT_TAIL(&queue->msgs, msg, next);
+	queue->depth++;
+	ast_cond_signal(&queue->wakeup);
+	ast_mutex_unlock(&queue->lock);
+
+	return 1;
+}
+
+/*! \brief Thread handling the messages queued on one distributor queue */
+static void *distributor_thread(void *data)
+{
+	struct distributor_queue *queue = data;
+
+	ast_mutex_lock(&queue->lock);
+	for (;;) {
+		struct distributor_msg *msg = AST_LIST_REMOVE_HEAD(&queue->msgs, next);
+
+		if (!msg) {
+			if (distributor_stopping) {
+				break;
+			}
+			ast_cond_wait(&queue->wakeup, &queue->lock);
+			continue;
+		}
+		queue->depth--;
+		ast_mutex_unlock(&queue->lock);
+
+		handle_request_do(&msg->req, &msg->addr);
+		deinit_req(&msg->req);
+		ast_free(msg);
+
+		ast_mutex_lock(&queue->lock);
+	}
+	ast_mutex_unlock(&queue->lock);
+
+	return NULL;
+}
+
+/*! \brief Start the distributor threads configured in sip.conf
+ *
+ * Called from the module load and reload paths only, so starting and
+ * stopping never races the dispatch done by the monitor thread.
+ */
+static void distributor_start(void)
+{
+	int i;
+
+	if (distributor_count || sip_cfg.distributor_threads <= 0) {
+		return;
+	}
+
+	distributor_queues = ast_calloc(sip_cfg.distributor_threads, sizeof(*distributor_queues));
+	if (!distributor_queues) {
+		return;
+	}
+	distributor_stopping = 0;
+
+	for (i = 0; i < sip_cfg.distributor_threads; i++) {
+		struct distributor_queue *queue = &distributor_queues[i];
+
+		ast_mutex_init(&queue->lock);
+		ast_cond_init(&queue->wakeup, NULL);
+		if (ast_pthread_create_background(&queue->thread, NULL, distributor_thread, queue)) {
+			ast_cond_destroy(&queue->wakeup);
+			ast_mutex_destroy(&queue->lock);
+			break;
+		}
+	}
+
+	distributor_count = i;
+	if (!distributor_count) {
+		ast_log(LOG_WARNING, "Unable to start SIP distributor threads; messages will be handled by the monitor thread\n");
+		ast_free(distributor_queues);
+		distributor_queues = NULL;
+	}
+}
+
+/*! \brief Stop the distributor threads after handling everything already queued */
+static void distributor_shutdown(void)
+{
+	int i;
+
+	if (!distributor_count) {
+		return;
+	}
+
+	for (i = 0; i < distributor_count; i++) {
+		struct distributor_queue *queue = &distributor_queues[i];
+
+		ast_mutex_lock(&queue->lock);
+		distributor_stopping = 1;
+		ast_cond_signal(&queue->wakeup);
+		ast_mutex_unlock(&queue->lock);
+	}
+	for (i = 0; i < distributor_count; i++) {
+		struct distributor_queue *queue = &distributor_queues[i];
+
+		pthread_join(queue->thread, NULL);
+		ast_cond_destroy(&queue->wakeup);
+		ast_mutex_destroy(&queue->lock);
+	}
+
+	ast_free(distributor_queues);
+	distributor_queues = NULL;
+	distributor_count = 0;
+}
+
 /*! \brief Read data from SIP UDP socket
 \note sipsock_read locks the owner channel while we are processing the SIP message
 \return 1 on error, 0 on success
@@ -28909,6 +29685,10 @@ static int sipsock_read(int *id, int fd, short events, void *ignore)
 
 	readbuf[res] = '\0';
 
+	if (distributor_count) {
+		return distributor_dispatch(readbuf, &addr);
+	}
+
 	if (!(req.data = ast_str_create(SIP_MIN_PACKET))) {
 		return 1;
 	}
@@ -28979,6 +29759,11 @@ static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
 	 * not fail. */
 	owner_chan_ref = sip_pvt_lock_full(p);
 
+	/* From here on the dialog and channel locks protect everything this
+	 * message touches; release netlock so other processing threads can
+	 * look up their own dialogs. */
+	ast_mutex_unlock(&netlock);
+
 	copy_socket_data(&p->socket, &req->socket);
 
 	ast_sockaddr_copy(&p->recv, addr);
@@ -29007,7 +29792,6 @@ static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
 		ast_channel_unref(owner_chan_ref);
 	}
 	sip_pvt_unlock(p);
-	ast_mutex_unlock(&netlock);
 
 	if (p->logger_callid) {
 		ast_callid_threadassoc_remove();
@@ -32063,6 +32847,9 @@ static int reload_config(enum channelreloadreason reason)
 	if (reason != CHANNEL_MODULE_LOAD) {
 		ast_debug(4, "--------------- SIP reload started\n");
 
+		/* The database may have been repopulated behind our back */
+		sip_negcache_flush();
+
 		clear_sip_domains();
 		ast_mutex_lock(&authl_lock);
 		if (authl) {
@@ -32184,6 +32971,8 @@ static int reload_config(enum channelreloadreason reason)
 	global_rtpkeepalive = DEFAULT_RTPKEEPALIVE;
 	sip_cfg.allowtransfer = TRANSFER_OPENFORALL;	/* Merrily accept all transfers by default */
 	sip_cfg.rtautoclear = 120;
+	sip_cfg.rtnegcachettl = 0;
+	sip_cfg.rtpreloadfriends = FALSE;
 	ast_set_flag(&global_flags[1], SIP_PAGE2_ALLOWSUBSCRIBE);	/* Default for all devices: TRUE */
 	ast_set_flag(&global_flags[1], SIP_PAGE2_ALLOWOVERLAP_YES);	/* Default for all devices: Yes */
 	sip_cfg.peer_rtupdate = TRUE;
@@ -32191,6 +32980,7 @@ static int reload_config(enum channelreloadreason reason)
 	sip_cfg.tcp_enabled = FALSE;
 	sip_cfg.websocket_enabled = TRUE;
 	sip_cfg.websocket_write_timeout = AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT;
+	sip_cfg.distributor_threads = 0;
 
 	/* Session-Timers */
 	global_st_mode = SESSION_TIMER_MODE_ACCEPT;
@@ -32312,6 +33102,11 @@ static int reload_config(enum channelreloadreason reason)
 			sip_cfg.allowtransfer = ast_true(v->value) ? TRANSFER_OPENFORALL : TRANSFER_CLOSED;
 		} else if (!strcasecmp(v->name, "rtcachefriends")) {
 			ast_set2_flag(&global_flags[1], ast_true(v->value), SIP_PAGE2_RTCACHEFRIENDS);
+		} else if (!strcasecmp(v->name, "rtpreloadfriends")) {
+			sip_cfg.rtpreloadfriends = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "rtnegcachettl")) {
+			int i = atoi(v->value);
+			sip_cfg.rtnegcachettl = i > 0 ? i : 0;
 		} else if (!strcasecmp(v->name, "rtsavesysname")) {
 			sip_cfg.rtsave_sysname = ast_true(v->value);
 		} else if (!strcasecmp(v->name, "rtsavepath")) {
@@ -32824,6 +33619,13 @@ static int reload_config(enum channelreloadreason reason)
 			}
 		} else if (!strcasecmp(v->name, "websocket_enabled")) {
 			sip_cfg.websocket_enabled = ast_true(v->value);
+		} else if (!strcasecmp(v->name, "distributor_threads")) {
+			if (sscanf(v->value, "%30d", &sip_cfg.distributor_threads) != 1
+				|| sip_cfg.distributor_threads < 0
+				|| sip_cfg.distributor_threads > DISTRIBUTOR_MAX_THREADS) {
+				ast_log(LOG_WARNING, "'%s' is not a valid distributor_threads value at line %d. Using default '0'.\n", v->value, v->lineno);
+				sip_cfg.distributor_threads = 0;
+			}
 		}
 	}
 
@@ -32921,9 +33723,19 @@ static int reload_config(enum channelreloadreason reason)
 
 	ast_mutex_lock(&netlock);
 	if ((sipsock > -1) && (ast_sockaddr_cmp(&old_bindaddr, &bindaddr))) {
+		ast_listener_fd_unregister(sipsock);
 		close(sipsock);
 		sipsock = -1;
 	}
+	if (sipsock < 0) {
+		sipsock = ast_listener_fd_acquire(&bindaddr);
+		if (sipsock > -1) {
+			/* Socket inherited across a restart is already bound. */
+			ast_verb(2, "SIP Listening on %s (inherited)\n", ast_sockaddr_stringify(&bindaddr));
+			ast_set_qos(sipsock, global_tos_sip, global_cos_sip, "SIP");
+			ast_listener_fd_register(sipsock, &bindaddr);
+		}
+	}
 	if (sipsock < 0) {
 		sipsock = socket(ast_sockaddr_is_ipv6(&bindaddr) ?
 				 AF_INET6 : AF_INET, SOCK_DGRAM, 0);
@@ -32950,6 +33762,7 @@ static int reload_config(enum channelreloadreason reason)
 			} else {
 				ast_verb(2, "SIP Listening on %s\n", ast_sockaddr_stringify(&bindaddr));
 				ast_set_qos(sipsock, global_tos_sip, global_cos_sip, "SIP");
+				ast_listener_fd_register(sipsock, &bindaddr);
 			}
 		}
 	} else {
@@ -33173,6 +33986,8 @@ static int reload_config(enum channelreloadreason reason)
 
 	register_realtime_peers_with_callbackextens();
 
+	preload_realtime_peers();
+
 	/* Load the list of manual NOTIFY types to support */
 	if (notify_types) {
 		ast_config_destroy(notify_types);
@@ -33866,6 +34681,14 @@ static int sip_do_reload(enum channelreloadreason reason)
 	reload_config(reason);
 	ast_sched_dump(sched);
 
+	/* Apply a changed distributor_threads setting.  We run in the monitor
+	 * thread, which is also the only dispatcher, so this cannot race an
+	 * incoming message. */
+	if (sip_cfg.distributor_threads != distributor_count) {
+		distributor_shutdown();
+		distributor_start();
+	}
+
 	start_poke = time(0);
 	/* Prune peers who still are supposed to be deleted */
 	unlink_marked_peers_from_tables();
@@ -35196,18 +36019,33 @@ static int load_module(void)
 
 	/* the fact that ao2_containers can't resize automatically is a major worry! */
 	/* if the number of objects gets above MAX_XXX_BUCKETS, things will slow down */
-	peers = ao2_t_container_alloc(HASH_PEER_SIZE, peer_hash_cb, peer_cmp_cb, "allocate peers");
-	peers_by_ip = ao2_t_container_alloc(HASH_PEER_SIZE, peer_iphash_cb, peer_ipcmp_cb, "allocate peers_by_ip");
-	dialogs = ao2_t_container_alloc(HASH_DIALOG_SIZE, dialog_hash_cb, dialog_cmp_cb, "allocate dialogs");
+	peers = ao2_t_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, HASH_PEER_SIZE, peer_hash_cb, NULL,
+		peer_cmp_cb, "allocate peers");
+	peers_by_ip = ao2_t_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, HASH_PEER_SIZE, peer_iphash_cb, NULL,
+		peer_ipcmp_cb, "allocate peers_by_ip");
+	dialogs = ao2_t_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, HASH_DIALOG_SIZE, dialog_hash_cb, NULL,
+		dialog_cmp_cb, "allocate dialogs");
 	dialogs_needdestroy = ao2_t_container_alloc(1, NULL, NULL, "allocate dialogs_needdestroy");
 	dialogs_rtpcheck = ao2_t_container_alloc(HASH_DIALOG_SIZE, dialog_hash_cb, dialog_cmp_cb, "allocate dialogs for rtpchecks");
 	threadt = ao2_t_container_alloc(HASH_DIALOG_SIZE, threadt_hash_cb, threadt_cmp_cb, "allocate threadt table");
+	rt_negcache = ao2_t_container_alloc(HASH_PEER_SIZE, negcache_hash_cb, negcache_cmp_cb, "allocate negative realtime cache");
 	if (!peers || !peers_by_ip || !dialogs || !dialogs_needdestroy || !dialogs_rtpcheck
-		|| !threadt) {
+		|| !threadt || !rt_negcache) {
 		ast_log(LOG_ERROR, "Unable to create primary SIP container(s)\n");
 		unload_module();
 		return AST_MODULE_LOAD_FAILURE;
 	}
+#ifdef HAVE_EPOLL
+	parked_sessions = ao2_t_container_alloc(1, NULL, NULL, "allocate parked sessions table");
+	if (!parked_sessions) {
+		ast_log(LOG_ERROR, "Unable to create primary SIP container(s)\n");
+		unload_module();
+		return AST_MODULE_LOAD_FAILURE;
+	}
+#endif
 
 	if (!(sip_cfg.caps = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT))) {
 		unload_module();
@@ -35219,7 +36057,7 @@ static int load_module(void)
 	subscription_mwi_list = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX,
 		AO2_CONTAINER_ALLOC_OPT_INSERT_BEGIN, NULL, NULL, "allocate subscription_mwi_list");
 
-	if (!(sched = ast_sched_context_create())) {
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Unable to create scheduler context\n");
 		unload_module();
 		return AST_MODULE_LOAD_FAILURE;
@@ -35341,6 +36179,9 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	/* Start the message distributor threads, if configured */
+	distributor_start();
+
 	/* And start the monitor for the first time */
 	restart_monitor();
 
@@ -35436,6 +36277,40 @@ static int unload_module(void)
 	}
 	ast_ssl_teardown(sip_tls_desc.tls_cfg);
 
+#ifdef HAVE_EPOLL
+	/* Stop the parking thread before draining parked_sessions: a batch
+	 * already returned by epoll_wait() holds raw pointers into parked
+	 * entries, so every entry must stay alive until the thread has been
+	 * joined. */
+	sip_tcp_park_shutdown();
+
+	/* With the parking thread gone (and its epoll set closed) nothing
+	 * else touches the parked entries.  Close the still-armed ones
+	 * directly and drop them from threadt before the thread kill loop
+	 * below so their stale thread ids are never signalled. */
+	if (parked_sessions) {
+		struct ao2_iterator pi;
+		struct sip_tcptls_parked *parked;
+
+		pi = ao2_iterator_init(parked_sessions, AO2_ITERATOR_UNLINK);
+		while ((parked = ao2_iterator_next(&pi))) {
+			if (parked->armed) {
+				parked->armed = 0;
+				ao2_t_unlink(threadt, parked->threadinfo, "Removing parked connection threadinfo");
+				ao2_lock(parked->tcptls_session);
+				ast_tcptls_close_session_file(parked->tcptls_session);
+				parked->tcptls_session->parent = NULL;
+				ao2_unlock(parked->tcptls_session);
+			}
+			/* A disarmed entry was unparked during the thread's final
+			 * batch and its session already belongs to a helper thread;
+			 * only the container reference is left to drop. */
+			ao2_t_ref(parked, -1, "drop parked connection ref from unload iterator");
+		}
+		ao2_iterator_destroy(&pi);
+	}
+#endif
+
 	/* Kill all existing TCP/TLS threads */
 	i = ao2_iterator_init(threadt, 0);
 	while ((th = ao2_t_iterator_next(&i, "iterate through tcp threads for 'sip show tcp'"))) {
@@ -35470,6 +36345,10 @@ static int unload_module(void)
 		ast_mutex_unlock(&monlock);
 	}
 
+	/* With the monitor gone nothing dispatches any more, so this just
+	 * drains whatever the distributor threads still have queued. */
+	distributor_shutdown();
+
 	cleanup_all_regs();
 
 	{
@@ -35546,7 +36425,13 @@ static int unload_module(void)
 	ao2_t_cleanup(dialogs_needdestroy, "unref dialogs_needdestroy");
 	ao2_t_cleanup(dialogs_rtpcheck, "unref dialogs_rtpcheck");
 	ao2_t_cleanup(threadt, "unref the thread table");
+#ifdef HAVE_EPOLL
+	ao2_t_cleanup(parked_sessions, "unref the parked sessions table");
+	parked_sessions = NULL;
+#endif
 	ao2_t_cleanup(sip_monitor_instances, "unref the sip_monitor_instances table");
+	ao2_t_cleanup(rt_negcache, "unref the negative realtime cache");
+	rt_negcache = NULL;
 
 	clear_sip_domains();
 	sip_cfg.contact_acl = ast_free_acl_list(sip_cfg.contact_acl);
@@ -35554,6 +36439,7 @@ static int unload_module(void)
 		ast_io_remove(io, sipsock_read_id);
 		sipsock_read_id = NULL;
 	}
+	ast_listener_fd_unregister(sipsock);
 	close(sipsock);
 	io_context_destroy(io);
 	ast_sched_context_destroy(sched);
@@ -127,6 +127,8 @@ struct iax_frame {
 	int iseqno;
 	/*! Retransmission ID */
 	int retrans;
+	/*! Scheduler context holding the retransmission entry */
+	struct ast_sched_context *retrans_sched;
 	/*! is this packet encrypted or not. if set this varible holds encryption methods*/
 	int encmethods;
 	/*! store encrypt key */
@@ -1267,6 +1267,7 @@ struct iax_frame *iax_frame_new(int direction, int datalen, unsigned int cacheab
 
 	fr->direction = direction;
 	fr->retrans = -1;
+	fr->retrans_sched = NULL;
 	
 	if (fr->direction == DIRECTION_INGRESS)
 		ast_atomic_fetchadd_int(&iframes, 1);
@@ -744,6 +744,8 @@ struct sip_settings {
 	int rtsave_path;            /*!< G: Save path header on registration */
 	int ignore_regexpire;       /*!< G: Ignore expiration of peer  */
 	int rtautoclear;            /*!< Realtime ?? */
+	int rtnegcachettl;          /*!< G: TTL in seconds for caching failed realtime lookups (0 = disabled) */
+	int rtpreloadfriends;       /*!< G: Bulk load all realtime peers into the cache at load and reload */
 	int directrtpsetup;         /*!< Enable support for Direct RTP setup (no re-invites) */
 	int pedanticsipchecking;    /*!< Extra checking ?  Default off */
 	enum autocreatepeer_mode autocreatepeer;  /*!< Auto creation of peers at registration? Default off. */
@@ -781,6 +783,7 @@ struct sip_settings {
 	int default_max_forwards;    /*!< Default max forwards (SIP Anti-loop) */
 	int websocket_write_timeout; /*!< Socket write timeout for websocket transports, in ms */
 	int websocket_enabled;       /*!< Are websockets enabled? */
+	int distributor_threads;     /*!< Threads handling received UDP messages; 0 leaves it to the monitor thread */
 };
 
 struct ast_websocket;
@@ -832,6 +835,7 @@ struct sip_request {
 	char authenticated;     /*!< non-zero if this request was authenticated */
 	ptrdiff_t header[SIP_MAX_HEADERS]; /*!< Array of offsets into the request string of each SIP header*/
 	ptrdiff_t line[SIP_MAX_LINES];     /*!< Array of offsets into the request string of each SDP line*/
+	unsigned char header_hash[SIP_MAX_HEADERS]; /*!< Tiny hash of each header's name, so get_header can skip mismatches without touching the line */
 	struct ast_str *data;
 	struct ast_str *content;
 	/* XXX Do we need to unref socket.ser when the request goes away? */
@@ -1112,6 +1116,7 @@ struct sip_pvt {
 	long branch;                        /*!< The branch identifier of this session */
 	long invite_branch;                 /*!< The branch used when we sent the initial INVITE */
 	int64_t sessionversion_remote;      /*!< Remote UA's SDP Session Version */
+	char *last_sdp_body;                /*!< Copy of the last accepted SDP body, o= line excluded */
 	unsigned int portinuri:1;           /*!< Non zero if a port has been specified, will also disable srv lookups */
 	struct ast_sockaddr sa;              /*!< Our peer */
 	struct ast_sockaddr redirip;         /*!< Where our RTP should be going if not to us */
@@ -1278,6 +1283,7 @@ struct sip_peer {
 		AST_STRING_FIELD(fromuser);     /*!< From: user when calling this peer */
 		AST_STRING_FIELD(fromdomain);   /*!< From: domain when calling this peer */
 		AST_STRING_FIELD(fullcontact);  /*!< Contact registered with us (not in sip.conf) */
+		AST_STRING_FIELD(regdata);      /*!< Last registration entry written to astdb, kept to skip rewriting identical ones */
 		AST_STRING_FIELD(cid_num);      /*!< Caller ID num */
 		AST_STRING_FIELD(cid_name);     /*!< Caller ID name */
 		AST_STRING_FIELD(cid_tag);      /*!< Caller ID tag */
@@ -41,6 +41,136 @@
 #include "asterisk/slin.h"
 #include "ex_alaw.h"
 
+/*!
+ * \brief Conversion kernels.
+ *
+ * Same idea as the kernels in codec_ulaw.c: instead of one data-dependent
+ * table load per sample, the AVX2 variants compute A-law companding
+ * arithmetically across eight 32-bit lanes (segment by compare-accumulate
+ * against the segment ends, quantization by variable shift).  The result
+ * is bit-for-bit identical to the classic __ast_lin2a/__ast_alaw tables;
+ * the G711_NEW_ALGORITHM tables differ, so the kernels are compiled out in
+ * that configuration.
+ */
+typedef void (*alaw_decode_fn)(int16_t *dst, const unsigned char *src, int n);
+typedef void (*alaw_encode_fn)(unsigned char *dst, const int16_t *src, int n);
+
+static void alaw_decode_scalar(int16_t *dst, const unsigned char *src, int n)
+{
+	while (n--)
+		*dst++ = AST_ALAW(*src++);
+}
+
+static void alaw_encode_scalar(unsigned char *dst, const int16_t *src, int n)
+{
+	while (n--)
+		*dst++ = AST_LIN2A(*src++);
+}
+
+#if !defined(G711_NEW_ALGORITHM) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+static __attribute__((target("avx2"))) void alaw_decode_avx2(int16_t *dst, const unsigned char *src, int n)
+{
+	int i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i res[2];
+		int half;
+
+		for (half = 0; half < 2; half++) {
+			__m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + i + half * 8)));
+			__m256i base, seg, shifted, val, nonzero, nneg;
+
+			a = _mm256_xor_si256(a, _mm256_set1_epi32(0x55));
+			base = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0x0F)), 4),
+				_mm256_set1_epi32(8));
+			seg = _mm256_and_si256(_mm256_srli_epi32(a, 4), _mm256_set1_epi32(7));
+			/* (base + 0x100) << (seg - 1); the shift count is -1 for seg == 0
+			 * but those lanes are replaced with base by the blend below */
+			shifted = _mm256_sllv_epi32(_mm256_add_epi32(base, _mm256_set1_epi32(0x100)),
+				_mm256_sub_epi32(seg, _mm256_set1_epi32(1)));
+			nonzero = _mm256_cmpgt_epi32(seg, _mm256_setzero_si256());
+			val = _mm256_blendv_epi8(base, shifted, nonzero);
+			/* negate where the (inverted) sign bit is clear */
+			nneg = _mm256_cmpeq_epi32(_mm256_and_si256(a, _mm256_set1_epi32(0x80)),
+				_mm256_setzero_si256());
+			res[half] = _mm256_sub_epi32(_mm256_xor_si256(val, nneg), nneg);
+		}
+		{
+			__m256i p = _mm256_packs_epi32(res[0], res[1]);
+
+			p = _mm256_permute4x64_epi64(p, 0xD8);
+			_mm256_storeu_si256((__m256i *) (dst + i), p);
+		}
+	}
+	alaw_decode_scalar(dst + i, src + i, n - i);
+}
+
+static __attribute__((target("avx2"))) void alaw_encode_avx2(unsigned char *dst, const int16_t *src, int n)
+{
+	int i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i res[2];
+		int half;
+
+		for (half = 0; half < 2; half++) {
+			__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (src + i + half * 8)));
+			__m256i neg, mask, v, seg, shift;
+
+			/* the table is built last-write-wins over each >> 3 bucket, so
+			 * the lookup is equivalent to encoding (sample | 7) exactly */
+			x = _mm256_or_si256(x, _mm256_set1_epi32(7));
+			neg = _mm256_srai_epi32(x, 31);
+			mask = _mm256_xor_si256(_mm256_set1_epi32(0x55 | 0x80),
+				_mm256_and_si256(neg, _mm256_set1_epi32(0x80)));
+			v = _mm256_abs_epi32(x);
+			seg = _mm256_setzero_si256();
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x00FF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x01FF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x03FF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x07FF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x0FFF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x1FFF)));
+			seg = _mm256_sub_epi32(seg, _mm256_cmpgt_epi32(v, _mm256_set1_epi32(0x3FFF)));
+			/* shift count is seg + 3 for seg >= 1 and 4 for seg == 0 */
+			shift = _mm256_max_epi32(_mm256_add_epi32(seg, _mm256_set1_epi32(3)),
+				_mm256_set1_epi32(4));
+			res[half] = _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi32(seg, 4),
+				_mm256_and_si256(_mm256_srlv_epi32(v, shift), _mm256_set1_epi32(0x0F))), mask);
+		}
+		{
+			__m256i p = _mm256_packus_epi32(res[0], res[1]);
+
+			p = _mm256_permute4x64_epi64(p, 0xD8);
+			p = _mm256_packus_epi16(p, _mm256_setzero_si256());
+			p = _mm256_permute4x64_epi64(p, 0x08);
+			_mm_storeu_si128((__m128i *) (dst + i), _mm256_castsi256_si128(p));
+		}
+	}
+	alaw_encode_scalar(dst + i, src + i, n - i);
+}
+
+#define ALAW_HAVE_SIMD 1
+
+#endif
+
+static alaw_decode_fn alaw_decode = alaw_decode_scalar;
+static alaw_encode_fn alaw_encode = alaw_encode_scalar;
+
+static void alaw_kernels_init(void)
+{
+#if defined(ALAW_HAVE_SIMD)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		alaw_decode = alaw_decode_avx2;
+		alaw_encode = alaw_encode_avx2;
+	}
+#endif
+}
+
 /*! \brief decode frame into lin and fill output buffer. */
 static int alawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
@@ -50,9 +180,8 @@ static int alawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 
 	pvt->samples += i;
 	pvt->datalen += i * 2;	/* 2 bytes/sample */
-	
-	while (i--)
-		*dst++ = AST_ALAW(*src++);
+
+	alaw_decode(dst, src, i);
 
 	return 0;
 }
@@ -67,8 +196,7 @@ static int lintoalaw_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->samples += i;
 	pvt->datalen += i;	/* 1 byte/sample */
 
-	while (i--) 
-		*dst++ = AST_LIN2A(*src++);
+	alaw_encode((unsigned char *) dst, src, i);
 
 	return 0;
 }
@@ -125,6 +253,8 @@ static int load_module(void)
 {
 	int res;
 
+	alaw_kernels_init();
+
 	res = ast_register_translator(&alawtolin);
 	res |= ast_register_translator(&lintoalaw);
 
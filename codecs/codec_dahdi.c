@@ -443,11 +443,17 @@ static struct ast_frame *dahdi_encoder_frameout(struct ast_trans_pvt *pvt)
 		return NULL;
 	}
 
-	if (dahdip->samples_written_to_hardware >= dahdip->required_samples) {
+	/* Try to collect a result without waiting first.  With one frame double
+	 * buffered in the card, the previous submission has had a full frame
+	 * interval to complete, so in steady state this read succeeds directly
+	 * and neither the poll() nor any sleeping in the kernel is needed.
+	 * Only once two frames are outstanding do we wait for the card. */
+	res = read(dahdip->fd, pvt->outbuf.c + pvt->datalen, pvt->t->buf_size - pvt->datalen);
+	if (-1 == res && EWOULDBLOCK == errno
+		&& dahdip->samples_written_to_hardware >= 2 * dahdip->required_samples) {
 		dahdi_wait_for_packet(dahdip->fd);
+		res = read(dahdip->fd, pvt->outbuf.c + pvt->datalen, pvt->t->buf_size - pvt->datalen);
 	}
-
-	res = read(dahdip->fd, pvt->outbuf.c + pvt->datalen, pvt->t->buf_size - pvt->datalen);
 	if (-1 == res) {
 		if (EWOULDBLOCK == errno) {
 			/* Nothing waiting... */
@@ -496,6 +502,14 @@ static int dahdi_decoder_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	return -1;
 }
 
+static int dahdi_decoder_read(struct ast_trans_pvt *pvt, struct codec_dahdi_pvt *dahdip)
+{
+	if (dahdip->softslin) {
+		return read(dahdip->fd, dahdip->ulaw_buffer, sizeof(dahdip->ulaw_buffer));
+	}
+	return read(dahdip->fd, pvt->outbuf.c + pvt->datalen, pvt->t->buf_size - pvt->datalen);
+}
+
 static struct ast_frame *dahdi_decoder_frameout(struct ast_trans_pvt *pvt)
 {
 	int res;
@@ -518,15 +532,14 @@ static struct ast_frame *dahdi_decoder_frameout(struct ast_trans_pvt *pvt)
 		return NULL;
 	}
 
-	if (dahdip->samples_written_to_hardware >= ULAW_SAMPLES) {
+	/* Let's check to see if there is a new frame for us....  As in the
+	 * encoder, try without waiting first; only wait for the card when the
+	 * pipeline already holds two frames. */
+	res = dahdi_decoder_read(pvt, dahdip);
+	if (-1 == res && EWOULDBLOCK == errno
+		&& dahdip->samples_written_to_hardware >= 2 * ULAW_SAMPLES) {
 		dahdi_wait_for_packet(dahdip->fd);
-	}
-
-	/* Let's check to see if there is a new frame for us.... */
-	if (dahdip->softslin) {
-		res = read(dahdip->fd, dahdip->ulaw_buffer, sizeof(dahdip->ulaw_buffer));
-	} else {
-		res = read(dahdip->fd, pvt->outbuf.c + pvt->datalen, pvt->t->buf_size - pvt->datalen);
+		res = dahdi_decoder_read(pvt, dahdip);
 	}
 
 	if (-1 == res) {
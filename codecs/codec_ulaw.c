@@ -41,6 +41,135 @@
 #include "asterisk/slin.h"
 #include "ex_ulaw.h"
 
+/*!
+ * \brief Conversion kernels.
+ *
+ * The table lookups convert one sample per iteration and the loads are
+ * data dependent, so the per-sample loop is limited by load latency.  On
+ * x86 we provide AVX2 kernels that compute the companding arithmetically
+ * (sign/clip/bias, then exponent by compare-accumulate and mantissa by
+ * variable shift) across eight 32-bit lanes at a time.  The arithmetic
+ * reproduces the classic table contents bit-for-bit, including the
+ * quantization introduced by building __ast_lin2mu from the top sample of
+ * each four-sample bucket; it does not match the G711_NEW_ALGORITHM
+ * variant and is compiled out when that is selected.
+ */
+typedef void (*ulaw_decode_fn)(int16_t *dst, const unsigned char *src, int n);
+typedef void (*ulaw_encode_fn)(unsigned char *dst, const int16_t *src, int n);
+
+static void ulaw_decode_scalar(int16_t *dst, const unsigned char *src, int n)
+{
+	while (n--)
+		*dst++ = AST_MULAW(*src++);
+}
+
+static void ulaw_encode_scalar(unsigned char *dst, const int16_t *src, int n)
+{
+	while (n--)
+		*dst++ = AST_LIN2MU(*src++);
+}
+
+#if !defined(G711_NEW_ALGORITHM) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+static __attribute__((target("avx2"))) void ulaw_decode_avx2(int16_t *dst, const unsigned char *src, int n)
+{
+	int i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i res[2];
+		int half;
+
+		for (half = 0; half < 2; half++) {
+			__m256i mu = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (src + i + half * 8)));
+			__m256i e, f, y, neg;
+
+			mu = _mm256_xor_si256(mu, _mm256_set1_epi32(0xFF));
+			e = _mm256_and_si256(_mm256_srli_epi32(mu, 4), _mm256_set1_epi32(7));
+			f = _mm256_and_si256(mu, _mm256_set1_epi32(0x0F));
+			/* f << (e + 3) plus the exponent bias table (33 << (e + 2)) - 132,
+			 * folded into a single variable shift: ((2f + 33) << (e + 2)) - 132 */
+			y = _mm256_sllv_epi32(_mm256_add_epi32(_mm256_add_epi32(f, f), _mm256_set1_epi32(33)),
+				_mm256_add_epi32(e, _mm256_set1_epi32(2)));
+			y = _mm256_sub_epi32(y, _mm256_set1_epi32(132));
+			neg = _mm256_cmpeq_epi32(_mm256_and_si256(mu, _mm256_set1_epi32(0x80)),
+				_mm256_set1_epi32(0x80));
+			res[half] = _mm256_sub_epi32(_mm256_xor_si256(y, neg), neg);
+		}
+		{
+			__m256i p = _mm256_packs_epi32(res[0], res[1]);
+
+			p = _mm256_permute4x64_epi64(p, 0xD8);
+			_mm256_storeu_si256((__m256i *) (dst + i), p);
+		}
+	}
+	ulaw_decode_scalar(dst + i, src + i, n - i);
+}
+
+static __attribute__((target("avx2"))) void ulaw_encode_avx2(unsigned char *dst, const int16_t *src, int n)
+{
+	int i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i res[2];
+		int half;
+
+		for (half = 0; half < 2; half++) {
+			__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (src + i + half * 8)));
+			__m256i sign, mag, e, mant;
+
+			/* the table is built last-write-wins over each >> 2 bucket, so
+			 * the lookup is equivalent to encoding (sample | 3) exactly */
+			x = _mm256_or_si256(x, _mm256_set1_epi32(3));
+			sign = _mm256_and_si256(_mm256_srai_epi32(x, 31), _mm256_set1_epi32(0x80));
+			mag = _mm256_abs_epi32(x);
+			mag = _mm256_min_epi32(mag, _mm256_set1_epi32(32635));
+			mag = _mm256_add_epi32(mag, _mm256_set1_epi32(0x84));
+			e = _mm256_setzero_si256();
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x00FF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x01FF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x03FF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x07FF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x0FFF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x1FFF)));
+			e = _mm256_sub_epi32(e, _mm256_cmpgt_epi32(mag, _mm256_set1_epi32(0x3FFF)));
+			mant = _mm256_and_si256(_mm256_srlv_epi32(mag, _mm256_add_epi32(e, _mm256_set1_epi32(3))),
+				_mm256_set1_epi32(0x0F));
+			res[half] = _mm256_and_si256(_mm256_xor_si256(
+				_mm256_or_si256(sign, _mm256_or_si256(_mm256_slli_epi32(e, 4), mant)),
+				_mm256_set1_epi32(-1)), _mm256_set1_epi32(0xFF));
+		}
+		{
+			__m256i p = _mm256_packus_epi32(res[0], res[1]);
+
+			p = _mm256_permute4x64_epi64(p, 0xD8);
+			p = _mm256_packus_epi16(p, _mm256_setzero_si256());
+			p = _mm256_permute4x64_epi64(p, 0x08);
+			_mm_storeu_si128((__m128i *) (dst + i), _mm256_castsi256_si128(p));
+		}
+	}
+	ulaw_encode_scalar(dst + i, src + i, n - i);
+}
+
+#define ULAW_HAVE_SIMD 1
+
+#endif
+
+static ulaw_decode_fn ulaw_decode = ulaw_decode_scalar;
+static ulaw_encode_fn ulaw_encode = ulaw_encode_scalar;
+
+static void ulaw_kernels_init(void)
+{
+#if defined(ULAW_HAVE_SIMD)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		ulaw_decode = ulaw_decode_avx2;
+		ulaw_encode = ulaw_encode_avx2;
+	}
+#endif
+}
+
 /*! \brief convert and store samples in outbuf */
 static int ulawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
@@ -52,8 +181,7 @@ static int ulawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->datalen += i * 2;	/* 2 bytes/sample */
 
 	/* convert and copy in outbuf */
-	while (i--)
-		*dst++ = AST_MULAW(*src++);
+	ulaw_decode(dst, src, i);
 
 	return 0;
 }
@@ -68,8 +196,7 @@ static int lintoulaw_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->samples += i;
 	pvt->datalen += i;	/* 1 byte/sample */
 
-	while (i--)
-		*dst++ = AST_LIN2MU(*src++);
+	ulaw_encode((unsigned char *) dst, src, i);
 
 	return 0;
 }
@@ -174,6 +301,8 @@ static int load_module(void)
 {
 	int res;
 
+	ulaw_kernels_init();
+
 	res = ast_register_translator(&ulawtolin);
 	res |= ast_register_translator(&lintoulaw);
 	res |= ast_register_translator(&lintotestlaw);
@@ -36,6 +36,7 @@
 #endif
 
 #include "g722.h"
+#include "g722_qmf.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -44,6 +45,37 @@
 #define TRUE (!FALSE)
 #endif
 
+/*! Receive QMF kernel, selected once for the CPU we are running on. */
+static g722_qmf_filter_fn qmf_filter = NULL;
+
+/*!
+ * \brief Run the receive QMF over a block of queued band pairs.
+ *
+ * \param s The decoder state, whose filter history is kept current.
+ * \param win Filter window of 22 history samples plus 2*pairs queued inputs.
+ * \param pairs Number of queued band pairs.
+ * \param amp Output location for the 2*pairs PCM samples.
+ */
+static void qmf_rx_flush(g722_decode_state_t *s, int16_t win[], int pairs, int16_t amp[])
+{
+    int32_t sumodd[G722_QMF_BLOCK_PAIRS];
+    int32_t sumeven[G722_QMF_BLOCK_PAIRS];
+    int p;
+    int i;
+
+    qmf_filter(win, pairs, sumodd, sumeven);
+    for (p = 0;  p < pairs;  p++)
+    {
+        amp[2*p] = (int16_t) (sumeven[p] >> 11);
+        amp[2*p + 1] = (int16_t) (sumodd[p] >> 11);
+    }
+    /* Keep the filter history current for the next block */
+    for (i = 0;  i < 24;  i++)
+        s->x[i] = win[2*pairs - 2 + i];
+    for (i = 0;  i < 22;  i++)
+        win[i] = win[2*pairs + i];
+}
+
 static __inline__ int16_t saturate(int32_t amp)
 {
     int16_t amp16;
@@ -157,6 +189,8 @@ g722_decode_state_t *g722_decode_init(g722_decode_state_t *s, int rate, int opti
         if ((s = (g722_decode_state_t *) malloc(sizeof(*s))) == NULL)
             return NULL;
     }
+    if (qmf_filter == NULL)
+        qmf_filter = g722_qmf_filter_select();
     memset(s, 0, sizeof(*s));
     if (rate == 48000)
         s->bits_per_sample = 6;
@@ -235,18 +269,11 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
            1688,   1360,   1040,    728,
             432,    136,   -432,   -136
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
-
     int dlowt;
     int rlow;
     int ihigh;
     int dhigh;
     int rhigh;
-    int xout1;
-    int xout2;
     int wd1;
     int wd2;
     int wd3;
@@ -254,9 +281,15 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
     int outlen;
     int i;
     int j;
+    /* Block QMF working space */
+    int16_t win[22 + 2*G722_QMF_BLOCK_PAIRS];
+    int pending;
 
     outlen = 0;
     rhigh = 0;
+    pending = 0;
+    for (i = 0;  i < 22;  i++)
+        win[i] = (int16_t) s->x[i + 2];
     for (j = 0;  j < len;  )
     {
         if (s->packed)
@@ -374,24 +407,22 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
             }
             else
             {
-                /* Apply the receive QMF */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                s->x[22] = rlow + rhigh;
-                s->x[23] = rlow - rhigh;
-
-                xout1 = 0;
-                xout2 = 0;
-                for (i = 0;  i < 12;  i++)
+                /* Queue this band pair for the receive QMF.  Batching
+                   lets the filter run vectorised over the whole block
+                   outside the per-sample recursion. */
+                win[22 + 2*pending] = (int16_t) (rlow + rhigh);
+                win[22 + 2*pending + 1] = (int16_t) (rlow - rhigh);
+                outlen += 2;
+                if (++pending == G722_QMF_BLOCK_PAIRS)
                 {
-                    xout2 += s->x[2*i]*qmf_coeffs[i];
-                    xout1 += s->x[2*i + 1]*qmf_coeffs[11 - i];
+                    qmf_rx_flush(s, win, pending, amp + outlen - 2*pending);
+                    pending = 0;
                 }
-                amp[outlen++] = (int16_t) (xout1 >> 11);
-                amp[outlen++] = (int16_t) (xout2 >> 11);
             }
         }
     }
+    if (pending)
+        qmf_rx_flush(s, win, pending, amp + outlen - 2*pending);
     return outlen;
 }
 /*- End of function --------------------------------------------------------*/
@@ -38,6 +38,7 @@
 #endif
 
 #include "g722.h"
+#include "g722_qmf.h"
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -46,6 +47,9 @@
 #define TRUE (!FALSE)
 #endif
 
+/*! Transmit QMF kernel, selected once for the CPU we are running on. */
+static g722_qmf_filter_fn qmf_filter = NULL;
+
 static __inline__ int16_t saturate(int32_t amp)
 {
     int16_t amp16;
@@ -156,6 +160,8 @@ g722_encode_state_t *g722_encode_init(g722_encode_state_t *s, int rate, int opti
         if ((s = (g722_encode_state_t *) malloc(sizeof(*s))) == NULL)
             return NULL;
     }
+    if (qmf_filter == NULL)
+        qmf_filter = g722_qmf_filter_select();
     memset(s, 0, sizeof(*s));
     if (rate == 48000)
         s->bits_per_sample = 6;
@@ -265,9 +271,17 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
     int ihigh;
     int ilow;
     int code;
+    /* Block QMF working space */
+    int16_t win[22 + 2*G722_QMF_BLOCK_PAIRS];
+    int32_t sumodd_buf[G722_QMF_BLOCK_PAIRS];
+    int32_t sumeven_buf[G722_QMF_BLOCK_PAIRS];
+    int block_avail;
+    int block_pos;
 
     g722_bytes = 0;
     xhigh = 0;
+    block_avail = 0;
+    block_pos = 0;
     for (j = 0;  j < len;  )
     {
         if (s->itu_test_mode)
@@ -283,20 +297,47 @@ int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[]
             }
             else
             {
-                /* Apply the transmit QMF */
-                /* Shuffle the buffer down */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                s->x[22] = amp[j++];
-                s->x[23] = amp[j++];
-    
-                /* Discard every other QMF output */
-                sumeven = 0;
-                sumodd = 0;
-                for (i = 0;  i < 12;  i++)
+                /* Apply the transmit QMF over as much of the frame as
+                   fits in the block buffer in one go, so the filter can
+                   run vectorised outside the per-sample recursion. */
+                if (block_pos >= block_avail  &&  len - j >= 2)
+                {
+                    block_avail = (len - j)/2;
+                    if (block_avail > G722_QMF_BLOCK_PAIRS)
+                        block_avail = G722_QMF_BLOCK_PAIRS;
+                    for (i = 0;  i < 22;  i++)
+                        win[i] = (int16_t) s->x[i + 2];
+                    memcpy(&win[22], &amp[j], block_avail*2*sizeof(int16_t));
+                    qmf_filter(win, block_avail, sumodd_buf, sumeven_buf);
+                    /* Keep the filter history current for the next block */
+                    for (i = 0;  i < 24;  i++)
+                        s->x[i] = win[2*block_avail - 2 + i];
+                    block_pos = 0;
+                }
+                if (block_pos < block_avail)
+                {
+                    sumodd = sumodd_buf[block_pos];
+                    sumeven = sumeven_buf[block_pos];
+                    block_pos++;
+                    j += 2;
+                }
+                else
                 {
-                    sumodd += s->x[2*i]*qmf_coeffs[i];
-                    sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
+                    /* Trailing odd sample - one pair at a time */
+                    /* Shuffle the buffer down */
+                    for (i = 0;  i < 22;  i++)
+                        s->x[i] = s->x[i + 2];
+                    s->x[22] = amp[j++];
+                    s->x[23] = amp[j++];
+
+                    /* Discard every other QMF output */
+                    sumeven = 0;
+                    sumodd = 0;
+                    for (i = 0;  i < 12;  i++)
+                    {
+                        sumodd += s->x[2*i]*qmf_coeffs[i];
+                        sumeven += s->x[2*i + 1]*qmf_coeffs[11 - i];
+                    }
                 }
                 xlow = (sumeven + sumodd) >> 14;
                 xhigh = (sumeven - sumodd) >> 14;
@@ -0,0 +1,191 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * g722_qmf.h - QMF filterbank kernels for the ITU G.722 codec.
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2005 Steve Underwood
+ *
+ * All rights reserved.
+ *
+ *  Despite my general liking of the GPL, I place my own contributions
+ *  to this code in the public domain for the benefit of all mankind -
+ *  even the slimy ones who might try to proprietize my work and use it
+ *  to my detriment.
+ */
+
+/*! \file */
+
+#if !defined(_G722_QMF_H_)
+#define _G722_QMF_H_
+
+/* The transmit and receive QMF in g722_encode.c/g722_decode.c are plain
+   24 tap FIR filters over the sample (or reconstructed band) stream; they
+   carry no feedback of their own.  That makes them the one part of the
+   codec that can be lifted out of the per-sample ADPCM recursion and run
+   over a whole block at once, where the multiply/accumulate work maps
+   onto packed 16 bit SIMD multiply-add instructions.
+
+   The caller gathers the filter input into a contiguous int16_t window
+   of (22 + 2*pairs) samples - 22 samples of history followed by the new
+   material - and gets back the raw even-tap and odd-tap sums for each
+   output pair.  Scaling and recombination stay with the caller, since
+   the encoder and decoder differ there.  All window values fit in 16
+   bits (PCM input on the transmit side; (rlow +/- rhigh) with the bands
+   limited to +/-16384 on the receive side), and a 16x16 product against
+   the largest coefficient stays well inside 32 bit accumulation.
+
+   Everything is static so each codec file carries its own copy.  The
+   kernel is selected once at init time and falls back to the scalar
+   loop on CPUs without the needed instructions. */
+
+/*! Maximum number of QMF output pairs processed per block. */
+#define G722_QMF_BLOCK_PAIRS 80
+
+typedef void (*g722_qmf_filter_fn)(const int16_t x[], int pairs, int32_t sumodd[], int32_t sumeven[]);
+
+/* The 12 QMF coefficients interleaved with zeros, so that a packed
+   multiply-add over 24 consecutive window samples picks out only the
+   even positions (sumodd) or only the odd positions (sumeven). */
+static const int16_t g722_qmf_codd[24] =
+{
+       3, 0,  -11, 0,   12, 0,   32, 0, -210, 0,  951, 0,
+    3876, 0, -805, 0,  362, 0, -156, 0,   53, 0,  -11, 0
+};
+static const int16_t g722_qmf_ceven[24] =
+{
+    0,  -11, 0,   53, 0, -156, 0,  362, 0, -805, 0, 3876,
+    0,  951, 0, -210, 0,   32, 0,   12, 0,  -11, 0,    3
+};
+
+static void g722_qmf_filter_scalar(const int16_t x[], int pairs, int32_t sumodd[], int32_t sumeven[])
+{
+    int p;
+    int i;
+    int32_t so;
+    int32_t se;
+
+    for (p = 0;  p < pairs;  p++)
+    {
+        so = 0;
+        se = 0;
+        for (i = 0;  i < 12;  i++)
+        {
+            so += x[2*p + 2*i]*g722_qmf_codd[2*i];
+            se += x[2*p + 2*i + 1]*g722_qmf_ceven[2*i + 1];
+        }
+        sumodd[p] = so;
+        sumeven[p] = se;
+    }
+}
+
+#if defined(__GNUC__)  &&  (defined(__x86_64__)  ||  defined(__i386__))
+
+#define G722_QMF_HAVE_X86_KERNELS 1
+
+#include <immintrin.h>
+
+static __attribute__((target("sse2"))) int32_t g722_qmf_hsum_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+static __attribute__((target("sse2"))) void g722_qmf_filter_sse2(const int16_t x[], int pairs, int32_t sumodd[], int32_t sumeven[])
+{
+    const __m128i co0 = _mm_loadu_si128((const __m128i *) &g722_qmf_codd[0]);
+    const __m128i co1 = _mm_loadu_si128((const __m128i *) &g722_qmf_codd[8]);
+    const __m128i co2 = _mm_loadu_si128((const __m128i *) &g722_qmf_codd[16]);
+    const __m128i ce0 = _mm_loadu_si128((const __m128i *) &g722_qmf_ceven[0]);
+    const __m128i ce1 = _mm_loadu_si128((const __m128i *) &g722_qmf_ceven[8]);
+    const __m128i ce2 = _mm_loadu_si128((const __m128i *) &g722_qmf_ceven[16]);
+    __m128i w0;
+    __m128i w1;
+    __m128i w2;
+    __m128i so;
+    __m128i se;
+    int p;
+
+    for (p = 0;  p < pairs;  p++)
+    {
+        w0 = _mm_loadu_si128((const __m128i *) &x[2*p]);
+        w1 = _mm_loadu_si128((const __m128i *) &x[2*p + 8]);
+        w2 = _mm_loadu_si128((const __m128i *) &x[2*p + 16]);
+        so = _mm_add_epi32(_mm_madd_epi16(w0, co0),
+                           _mm_add_epi32(_mm_madd_epi16(w1, co1), _mm_madd_epi16(w2, co2)));
+        se = _mm_add_epi32(_mm_madd_epi16(w0, ce0),
+                           _mm_add_epi32(_mm_madd_epi16(w1, ce1), _mm_madd_epi16(w2, ce2)));
+        sumodd[p] = g722_qmf_hsum_sse2(so);
+        sumeven[p] = g722_qmf_hsum_sse2(se);
+    }
+}
+
+#elif defined(__ARM_NEON)  ||  defined(__aarch64__)
+
+#define G722_QMF_HAVE_NEON_KERNELS 1
+
+#include <arm_neon.h>
+
+static int32_t g722_qmf_hsum_neon(int32x4_t v)
+{
+    int32x2_t d;
+
+    d = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    d = vpadd_s32(d, d);
+    return vget_lane_s32(d, 0);
+}
+
+static void g722_qmf_filter_neon(const int16_t x[], int pairs, int32_t sumodd[], int32_t sumeven[])
+{
+    const int16x8_t co0 = vld1q_s16(&g722_qmf_codd[0]);
+    const int16x8_t co1 = vld1q_s16(&g722_qmf_codd[8]);
+    const int16x8_t co2 = vld1q_s16(&g722_qmf_codd[16]);
+    const int16x8_t ce0 = vld1q_s16(&g722_qmf_ceven[0]);
+    const int16x8_t ce1 = vld1q_s16(&g722_qmf_ceven[8]);
+    const int16x8_t ce2 = vld1q_s16(&g722_qmf_ceven[16]);
+    int16x8_t w0;
+    int16x8_t w1;
+    int16x8_t w2;
+    int32x4_t so;
+    int32x4_t se;
+    int p;
+
+    for (p = 0;  p < pairs;  p++)
+    {
+        w0 = vld1q_s16(&x[2*p]);
+        w1 = vld1q_s16(&x[2*p + 8]);
+        w2 = vld1q_s16(&x[2*p + 16]);
+        so = vmull_s16(vget_low_s16(w0), vget_low_s16(co0));
+        so = vmlal_s16(so, vget_high_s16(w0), vget_high_s16(co0));
+        so = vmlal_s16(so, vget_low_s16(w1), vget_low_s16(co1));
+        so = vmlal_s16(so, vget_high_s16(w1), vget_high_s16(co1));
+        so = vmlal_s16(so, vget_low_s16(w2), vget_low_s16(co2));
+        so = vmlal_s16(so, vget_high_s16(w2), vget_high_s16(co2));
+        se = vmull_s16(vget_low_s16(w0), vget_low_s16(ce0));
+        se = vmlal_s16(se, vget_high_s16(w0), vget_high_s16(ce0));
+        se = vmlal_s16(se, vget_low_s16(w1), vget_low_s16(ce1));
+        se = vmlal_s16(se, vget_high_s16(w1), vget_high_s16(ce1));
+        se = vmlal_s16(se, vget_low_s16(w2), vget_low_s16(ce2));
+        se = vmlal_s16(se, vget_high_s16(w2), vget_high_s16(ce2));
+        sumodd[p] = g722_qmf_hsum_neon(so);
+        sumeven[p] = g722_qmf_hsum_neon(se);
+    }
+}
+
+#endif
+
+static g722_qmf_filter_fn g722_qmf_filter_select(void)
+{
+#if defined(G722_QMF_HAVE_X86_KERNELS)
+    if (__builtin_cpu_supports("sse2"))
+        return g722_qmf_filter_sse2;
+#elif defined(G722_QMF_HAVE_NEON_KERNELS)
+    return g722_qmf_filter_neon;
+#endif
+    return g722_qmf_filter_scalar;
+}
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -380,6 +380,34 @@ static int au_rewrite(struct ast_filestream *s, const char *comment)
 	return 0;
 }
 
+/*! Bytes of audio between safety refreshes of the header length field,
+ * about 30 seconds of 8kHz mulaw.  A refresh costs a seek (which also
+ * flushes the write buffer), so it stays coarse; it only exists to leave
+ * a mostly playable file behind if we die before the final header. */
+#define AU_HEADER_REFRESH	240000
+
+struct au_desc {
+	off_t refresh_size;	/* data length at the last header refresh */
+};
+
+static int au_write(struct ast_filestream *fs, struct ast_frame *f)
+{
+	struct au_desc *d = fs->_private;
+	off_t datalen;
+
+	if (pcm_write(fs, f)) {
+		return -1;
+	}
+
+	datalen = ftello(fs->f) - AU_HEADER_SIZE;
+	if (datalen - d->refresh_size >= AU_HEADER_REFRESH) {
+		update_header(fs->f);
+		d->refresh_size = datalen;
+	}
+
+	return 0;
+}
+
 /* XXX check this, probably incorrect */
 static int au_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 {
@@ -492,12 +520,13 @@ static struct ast_format_def au_f = {
 	.exts = "au",
 	.open = au_open,
 	.rewrite = au_rewrite,
-	.write = pcm_write,
+	.write = au_write,
 	.seek = au_seek,
 	.trunc = au_trunc,
 	.tell = au_tell,
 	.read = pcm_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,	/* this many shorts */
+	.desc_size = sizeof(struct au_desc),
 };
 
 static int load_module(void)
@@ -45,11 +45,18 @@
 
 #define WAV_HEADER_SIZE 44
 
+/*! Seconds of audio between safety refreshes of the header length fields.
+ * The refresh costs a seek (which also flushes the stream's write buffer),
+ * so it is kept coarse; its only purpose is to leave a mostly playable
+ * file behind if we die before wav_close() can write the final header. */
+#define WAV_HEADER_REFRESH 30
+
 struct wav_desc {	/* format-specific parameters */
 	int hz;
 	int bytes;
 	int lasttimeout;
 	int maxlen;
+	int refresh_bytes;	/* value of bytes at the last header refresh */
 	struct timeval last;
 };
 
@@ -437,7 +444,13 @@ static int wav_write(struct ast_filestream *fs, struct ast_frame *f)
 	}
 
 	s->bytes += f->datalen;
-		
+
+	/* s->hz is only set when we wrote the header ourselves */
+	if (s->hz > 0 && s->bytes - s->refresh_bytes >= s->hz * 2 * WAV_HEADER_REFRESH) {
+		update_header(fs->f);
+		s->refresh_bytes = s->bytes;
+	}
+
 	return 0;
 
 }
@@ -59,10 +59,17 @@ static char msgsm_silence[] = /* 65 */
 ,0x92,0x24,0x49,0x92,0x00};
 /* end binary data. size = 65 bytes */
 
+/*! MSGSM blocks between safety refreshes of the header length fields.
+ * Each block holds 80ms of audio, so this is about 30 seconds.  The
+ * refresh costs a seek, so it stays coarse; it only exists to leave a
+ * mostly playable file behind if we die before wav_close(). */
+#define MSGSM_HEADER_REFRESH	375
+
 struct wavg_desc {
 	/* Believe it or not, we must decode/recode to account for the
 	   weird MS format */
 	int secondhalf;						/* Are we on the second half */
+	int blocks;						/* MSGSM blocks written since the last header refresh */
 };
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -468,6 +475,10 @@ static int wav_write(struct ast_filestream *s, struct ast_frame *f)
 			ast_log(LOG_WARNING, "Bad write (%d/65): %s\n", res, strerror(errno));
 			return -1;
 		}
+		if (src && ++fs->blocks >= MSGSM_HEADER_REFRESH) {
+			update_header(s->f);
+			fs->blocks = 0;
+		}
 	}
 	return 0;
 }
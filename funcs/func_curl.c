@@ -575,26 +575,93 @@ static size_t WriteMemoryCallback(void *ptr, size_t size, size_t nmemb, void *da
 
 static const char * const global_useragent = "asterisk-libcurl-agent/1.0";
 
+/* 7.28.0 is the first version with curl_multi_wait() */
+#if CURLVERSION_ATLEAST(7,28,0)
+#define CURL_INSTANCE_HAVE_MULTI 1
+#endif
+
+/*!
+ * \brief Share handle pooling connection state between all threads.
+ *
+ * Each dialplan thread keeps its own easy handle, so repeated CURL()
+ * calls from one thread already reuse that thread's connections.  The
+ * share handle extends the reuse across threads: the DNS cache, TLS
+ * session cache and (on new enough libcurl) the connection cache itself
+ * are common, so a lookup against the same endpoint from any thread
+ * skips the connect/TLS setup another thread already paid for.
+ */
+static CURLSH *curl_share_handle;
+
+static ast_mutex_t curl_share_locks[CURL_LOCK_DATA_LAST];
+
+static void curl_share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	ast_mutex_lock(&curl_share_locks[data]);
+}
+
+static void curl_share_unlock(CURL *handle, curl_lock_data data, void *userptr)
+{
+	ast_mutex_unlock(&curl_share_locks[data]);
+}
+
+static int curl_share_setup(void)
+{
+	int i;
+
+	for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+		ast_mutex_init(&curl_share_locks[i]);
+	}
+
+	if (!(curl_share_handle = curl_share_init())) {
+		return -1;
+	}
+	curl_share_setopt(curl_share_handle, CURLSHOPT_LOCKFUNC, curl_share_lock);
+	curl_share_setopt(curl_share_handle, CURLSHOPT_UNLOCKFUNC, curl_share_unlock);
+	curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if CURLVERSION_ATLEAST(7,57,0)
+	/* 7.57.0 is the first version able to share the connection cache itself */
+	curl_share_setopt(curl_share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+
+	return 0;
+}
+
+struct curl_instance_data {
+	CURL *curl;
+	/*! Used to service the transfer in slices; NULL to fall back to curl_easy_perform() */
+	CURLM *multi;
+};
+
 static int curl_instance_init(void *data)
 {
-	CURL **curl = data;
+	struct curl_instance_data *instance = data;
 
-	if (!(*curl = curl_easy_init()))
+	if (!(instance->curl = curl_easy_init()))
 		return -1;
 
-	curl_easy_setopt(*curl, CURLOPT_NOSIGNAL, 1);
-	curl_easy_setopt(*curl, CURLOPT_TIMEOUT, 180);
-	curl_easy_setopt(*curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-	curl_easy_setopt(*curl, CURLOPT_USERAGENT, global_useragent);
+	curl_easy_setopt(instance->curl, CURLOPT_NOSIGNAL, 1);
+	curl_easy_setopt(instance->curl, CURLOPT_TIMEOUT, 180);
+	curl_easy_setopt(instance->curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+	curl_easy_setopt(instance->curl, CURLOPT_USERAGENT, global_useragent);
+	if (curl_share_handle) {
+		curl_easy_setopt(instance->curl, CURLOPT_SHARE, curl_share_handle);
+	}
+#ifdef CURL_INSTANCE_HAVE_MULTI
+	instance->multi = curl_multi_init();
+#endif
 
 	return 0;
 }
 
 static void curl_instance_cleanup(void *data)
 {
-	CURL **curl = data;
+	struct curl_instance_data *instance = data;
 
-	curl_easy_cleanup(*curl);
+	curl_easy_cleanup(instance->curl);
+	if (instance->multi) {
+		curl_multi_cleanup(instance->multi);
+	}
 
 	ast_free(data);
 }
@@ -602,6 +669,56 @@ static void curl_instance_cleanup(void *data)
 AST_THREADSTORAGE_CUSTOM(curl_instance, curl_instance_init, curl_instance_cleanup);
 AST_THREADSTORAGE(thread_escapebuf);
 
+/*!
+ * \internal
+ * \brief Run the prepared transfer on the thread's easy handle.
+ *
+ * The transfer is serviced through the multi interface in short slices so
+ * the thread can notice that the channel hung up mid-transfer and abandon
+ * the request immediately, instead of sitting in curl_easy_perform() until
+ * the transfer timeout expires while the caller is long gone.
+ */
+static CURLcode curl_perform(struct curl_instance_data *instance, struct ast_channel *chan)
+{
+#ifdef CURL_INSTANCE_HAVE_MULTI
+	CURLcode result = CURLE_OK;
+	CURLMsg *msg;
+	int running = 1;
+	int pending;
+
+	if (!instance->multi
+		|| curl_multi_add_handle(instance->multi, instance->curl) != CURLM_OK) {
+		return curl_easy_perform(instance->curl);
+	}
+
+	while (running) {
+		if (curl_multi_perform(instance->multi, &running) != CURLM_OK) {
+			result = CURLE_RECV_ERROR;
+			break;
+		}
+		if (!running) {
+			break;
+		}
+		if (chan && ast_check_hangup(chan)) {
+			result = CURLE_ABORTED_BY_CALLBACK;
+			break;
+		}
+		curl_multi_wait(instance->multi, NULL, 0, 100, NULL);
+	}
+
+	while ((msg = curl_multi_info_read(instance->multi, &pending))) {
+		if (msg->msg == CURLMSG_DONE && msg->easy_handle == instance->curl) {
+			result = msg->data.result;
+		}
+	}
+	curl_multi_remove_handle(instance->multi, instance->curl);
+
+	return result;
+#else
+	return curl_easy_perform(instance->curl);
+#endif
+}
+
 /*!
  * \brief Check for potential HTTP injection risk.
  *
@@ -637,7 +754,8 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 {
 	struct ast_str *escapebuf = ast_str_thread_get(&thread_escapebuf, 16);
 	int ret = -1;
-	CURL **curl;
+	struct curl_instance_data *instance;
+	CURLcode result;
 	struct curl_settings *cur;
 	struct ast_datastore *store = NULL;
 	int hashcompat = 0;
@@ -648,7 +766,7 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 		return -1;
 	}
 
-	if (!(curl = ast_threadstorage_get(&curl_instance, sizeof(*curl)))) {
+	if (!(instance = ast_threadstorage_get(&curl_instance, sizeof(*instance)))) {
 		ast_log(LOG_ERROR, "Cannot allocate curl structure\n");
 		return -1;
 	}
@@ -667,7 +785,7 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 		if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 			hashcompat = (long) cur->value;
 		} else {
-			curl_easy_setopt(*curl, cur->key, cur->value);
+			curl_easy_setopt(instance->curl, cur->key, cur->value);
 		}
 	}
 	AST_LIST_UNLOCK(&global_curl_info);
@@ -679,39 +797,41 @@ static int acf_curl_helper(struct ast_channel *chan, struct curl_args *args)
 			if (cur->key == CURLOPT_SPECIAL_HASHCOMPAT) {
 				hashcompat = (long) cur->value;
 			} else {
-				curl_easy_setopt(*curl, cur->key, cur->value);
+				curl_easy_setopt(instance->curl, cur->key, cur->value);
 			}
 		}
 	}
 
-	curl_easy_setopt(*curl, CURLOPT_URL, args->url);
-	curl_easy_setopt(*curl, CURLOPT_FILE, (void *) &args->cb_data);
+	curl_easy_setopt(instance->curl, CURLOPT_URL, args->url);
+	curl_easy_setopt(instance->curl, CURLOPT_FILE, (void *) &args->cb_data);
 
 	if (args->postdata) {
-		curl_easy_setopt(*curl, CURLOPT_POST, 1);
-		curl_easy_setopt(*curl, CURLOPT_POSTFIELDS, args->postdata);
+		curl_easy_setopt(instance->curl, CURLOPT_POST, 1);
+		curl_easy_setopt(instance->curl, CURLOPT_POSTFIELDS, args->postdata);
 	}
 
 	/* Temporarily assign a buffer for curl to write errors to. */
 	curl_errbuf[0] = curl_errbuf[CURL_ERROR_SIZE] = '\0';
-	curl_easy_setopt(*curl, CURLOPT_ERRORBUFFER, curl_errbuf);
+	curl_easy_setopt(instance->curl, CURLOPT_ERRORBUFFER, curl_errbuf);
 
-	if (curl_easy_perform(*curl) != 0) {
-		ast_log(LOG_WARNING, "%s ('%s')\n", curl_errbuf, args->url);
+	result = curl_perform(instance, chan);
+	if (result != CURLE_OK) {
+		ast_log(LOG_WARNING, "%s ('%s')\n",
+			curl_errbuf[0] ? curl_errbuf : curl_easy_strerror(result), args->url);
 	}
 
 	/* Reset buffer to NULL so curl doesn't try to write to it when the
 	 * buffer is deallocated. Documentation is vague about allowing NULL
 	 * here, but the source allows it. See: "typecheck: allow NULL to unset
 	 * CURLOPT_ERRORBUFFER" (62bcf005f4678a93158358265ba905bace33b834). */
-	curl_easy_setopt(*curl, CURLOPT_ERRORBUFFER, (char*)NULL);
+	curl_easy_setopt(instance->curl, CURLOPT_ERRORBUFFER, (char*)NULL);
 
 	if (store) {
 		AST_LIST_UNLOCK(list);
 	}
 
 	if (args->postdata) {
-		curl_easy_setopt(*curl, CURLOPT_POST, 0);
+		curl_easy_setopt(instance->curl, CURLOPT_POST, 0);
 	}
 
 	if (args->cb_data.str && ast_str_strlen(args->cb_data.str)) {
@@ -913,6 +1033,11 @@ static int unload_module(void)
 
 	AST_TEST_UNREGISTER(vulnerable_url);
 
+	if (curl_share_handle) {
+		curl_share_cleanup(curl_share_handle);
+		curl_share_handle = NULL;
+	}
+
 	return res;
 }
 
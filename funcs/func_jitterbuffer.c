@@ -52,7 +52,12 @@
 						<para>Set a fixed jitterbuffer on the channel.</para>
 					</option>
 					<option name="adaptive">
-						<para>Set an adaptive jitterbuffer on the channel.</para>
+						<para>Set an adaptive jitterbuffer on the channel. The adaptive
+						jitterbuffer continuously measures network jitter, with outliers
+						discarded, and raises and lowers its target delay mid-call to
+						track the minimum delay current conditions allow. Excess delay
+						left behind by a jitter spike is shed at an accelerated rate
+						once the spike has passed.</para>
 					</option>
 					<option name="disabled">
 						<para>Remove a previously set jitterbuffer from the channel.</para>
@@ -119,6 +119,10 @@ struct acf_odbc_query {
 	char *sql_insert;
 	unsigned int flags;
 	int rowlimit;
+	/*! How long a cached result remains valid, in seconds (0 disables caching) */
+	int cachettl;
+	/*! Cached results, keyed on the substituted SQL.  NULL if caching is disabled. */
+	struct ao2_container *cache;
 	struct ast_custom_function *acf;
 };
 
@@ -440,6 +444,142 @@ static void odbc_datastore_free(void *data)
 	ast_free(result);
 }
 
+#define CACHE_BUCKETS 53
+
+/*! \brief A single cached query result
+ *
+ * Only single-row reads are cached, so the whole result is the row data
+ * as it would have been written into the caller's buffer, plus the
+ * column names which accompany it.
+ */
+struct acf_odbc_cache_entry {
+	/*! When this entry stops being valid */
+	struct timeval expires;
+	/*! Number of rows the query found (0 or 1) */
+	int rows;
+	/*! The row data (points into sql[]) */
+	char *value;
+	/*! The column names (points into sql[]) */
+	char *colnames;
+	/*! The substituted SQL this entry caches, followed by value and colnames */
+	char sql[0];
+};
+
+static int cache_entry_hash(const void *obj, const int flags)
+{
+	const struct acf_odbc_cache_entry *entry;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		key = entry->sql;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_hash(key);
+}
+
+static int cache_entry_cmp(void *obj, void *arg, int flags)
+{
+	const struct acf_odbc_cache_entry *object_left = obj;
+	const struct acf_odbc_cache_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->sql;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcmp(object_left->sql, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+
+	if (cmp) {
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
+/*!
+ * \brief Look up a cached result for the given substituted SQL.
+ *
+ * \param query The function whose cache should be consulted
+ * \param sql The SQL after variable substitution
+ * \param buf Output buffer for the cached row data
+ * \param len Size of buf
+ * \param colnames Updated with the cached column names on a hit
+ * \param rows Updated with the cached row count on a hit
+ * \retval 1 Cache hit
+ * \retval 0 No valid cached result; run the query for real
+ */
+static int cache_lookup(struct acf_odbc_query *query, const char *sql, char *buf, size_t len,
+	struct ast_str **colnames, int *rows)
+{
+	struct acf_odbc_cache_entry *entry;
+
+	entry = ao2_find(query->cache, sql, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return 0;
+	}
+
+	if (ast_tvcmp(ast_tvnow(), entry->expires) > 0) {
+		ao2_unlink(query->cache, entry);
+		ao2_ref(entry, -1);
+		return 0;
+	}
+
+	ast_copy_string(buf, entry->value, len);
+	ast_str_set(colnames, 0, "%s", entry->colnames);
+	*rows = entry->rows;
+	ao2_ref(entry, -1);
+
+	return 1;
+}
+
+/*!
+ * \brief Store a query result in the function's cache.
+ *
+ * Any previous entry for the same SQL is replaced.
+ */
+static void cache_store(struct acf_odbc_query *query, const char *sql, const char *value,
+	const char *colnames, int rows)
+{
+	struct acf_odbc_cache_entry *entry;
+	size_t sql_len = strlen(sql);
+	size_t value_len = strlen(value);
+
+	entry = ao2_alloc(sizeof(*entry) + sql_len + value_len + strlen(colnames) + 3, NULL);
+	if (!entry) {
+		return;
+	}
+
+	/* All three strings are packed into the flexible array member. */
+	strcpy(entry->sql, sql); /* SAFE */
+	entry->value = entry->sql + sql_len + 1;
+	strcpy(entry->value, value); /* SAFE */
+	entry->colnames = entry->value + value_len + 1;
+	strcpy(entry->colnames, colnames); /* SAFE */
+	entry->rows = rows;
+	entry->expires = ast_tvadd(ast_tvnow(), ast_tv(query->cachettl, 0));
+
+	ao2_lock(query->cache);
+	ao2_find(query->cache, sql, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(query->cache, entry, OBJ_NOLOCK);
+	ao2_unlock(query->cache);
+	ao2_ref(entry, -1);
+}
+
 /*!
  * \brief Common execution function for SQL queries.
  *
@@ -785,6 +925,22 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 		}
 	}
 
+	if (query->cache && cache_lookup(query, ast_str_buffer(sql), buf, len, &colnames, &y)) {
+		/* Short-circuit the lookup entirely with the cached result. */
+		ast_debug(2, "Cache hit on function '%s' [%s]\n", cmd, ast_str_buffer(sql));
+		AST_RWLIST_UNLOCK(&queries);
+		if (!bogus_chan) {
+			snprintf(rowcount, sizeof(rowcount), "%d", y);
+			pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
+			pbx_builtin_setvar_helper(chan, "ODBCSTATUS", y ? "SUCCESS" : "NODATA");
+			if (y) {
+				pbx_builtin_setvar_helper(chan, "~ODBCFIELDS~", ast_str_buffer(colnames));
+			}
+			ast_autoservice_stop(chan);
+		}
+		return 0;
+	}
+
 	/* Save these flags, so we can release the lock */
 	escapecommas = ast_test_flag(query, OPT_ESCAPECOMMAS);
 	if (!bogus_chan && ast_test_flag(query, OPT_MULTIROW)) {
@@ -863,6 +1019,10 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 			buf[0] = '\0';
 			ast_copy_string(rowcount, "0", sizeof(rowcount));
 			status = "NODATA";
+			if (query->cache) {
+				/* Cache the miss, too; repeated failed lookups are just as costly. */
+				cache_store(query, ast_str_buffer(sql), "", "", 0);
+			}
 		} else {
 			ast_log(LOG_WARNING, "Error %d in FETCH [%s]\n", res, ast_str_buffer(sql));
 			status = "FETCHERROR";
@@ -1004,6 +1164,9 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	}
 
 end_acf_read:
+	if (query->cache && !resultset && !strcmp(status, "SUCCESS")) {
+		cache_store(query, ast_str_buffer(sql), buf, ast_str_buffer(colnames), y);
+	}
 	if (!bogus_chan) {
 		snprintf(rowcount, sizeof(rowcount), "%d", y);
 		pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
@@ -1153,6 +1316,7 @@ static int free_acf_query(struct acf_odbc_query *query)
 		ast_free(query->sql_read);
 		ast_free(query->sql_write);
 		ast_free(query->sql_insert);
+		ao2_cleanup(query->cache);
 		ast_free(query);
 	}
 	return 0;
@@ -1270,6 +1434,24 @@ static int init_acf_query(struct ast_config *cfg, char *catg, struct acf_odbc_qu
 			sscanf(tmp, "%30d", &((*query)->rowlimit));
 	}
 
+	if ((tmp = ast_variable_retrieve(cfg, catg, "cachettl"))) {
+		if (sscanf(tmp, "%30d", &((*query)->cachettl)) != 1 || (*query)->cachettl < 0) {
+			ast_log(LOG_WARNING, "cachettl must be a non-negative number of seconds in category %s\n", catg);
+			(*query)->cachettl = 0;
+		}
+	}
+
+	if ((*query)->cachettl) {
+		if (ast_test_flag((*query), OPT_MULTIROW) || (*query)->rowlimit > 1) {
+			ast_log(LOG_WARNING, "cachettl only applies to single row reads; ignoring it in category %s\n", catg);
+			(*query)->cachettl = 0;
+		} else if (!((*query)->cache = ao2_container_alloc(CACHE_BUCKETS, cache_entry_hash, cache_entry_cmp))) {
+			free_acf_query(*query);
+			*query = NULL;
+			return ENOMEM;
+		}
+	}
+
 	(*query)->acf = ast_calloc(1, sizeof(struct ast_custom_function));
 	if (!(*query)->acf) {
 		free_acf_query(*query);
@@ -38,6 +38,7 @@
 #include "asterisk/channel.h"
 #include "asterisk/pbx.h"
 #include "asterisk/utils.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/app.h"
 #include "asterisk/localtime.h"
 #include "asterisk/test.h"
@@ -946,6 +947,133 @@ static struct ast_custom_function strreplace_function = {
 	.read2 = strreplace,
 };
 
+/*! \brief Number of buckets for the compiled regex cache */
+#define REGEX_CACHE_BUCKETS 53
+
+/*! \brief Cap on cached compiled patterns; the cache is flushed when hit */
+#define REGEX_CACHE_MAX_ENTRIES 128
+
+/*!
+ * \brief A compiled REGEX() pattern shared across evaluations.
+ *
+ * Routing dialplans evaluate the same handful of patterns on every
+ * call, and regcomp() dwarfs the cost of the match itself.  Compiled
+ * patterns are kept in a refcounted cache keyed on the pattern text,
+ * so each distinct pattern is compiled once.  regexec() is safe to run
+ * concurrently against a shared compiled pattern.
+ */
+struct regex_cache_entry {
+	/*! The compiled pattern */
+	regex_t regexbuf;
+	/*! TRUE if regexbuf holds a successfully compiled pattern */
+	int compiled;
+	/*! The pattern text the entry was compiled from */
+	char pattern[0];
+};
+
+static struct ao2_container *regex_cache;
+
+static void regex_cache_destructor(void *obj)
+{
+	struct regex_cache_entry *entry = obj;
+
+	if (entry->compiled) {
+		regfree(&entry->regexbuf);
+	}
+}
+
+static int regex_cache_hash(const void *obj, const int flags)
+{
+	const struct regex_cache_entry *entry = obj;
+	const char *key = obj;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ast_str_hash(key);
+	case OBJ_SEARCH_OBJECT:
+		return ast_str_hash(entry->pattern);
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int regex_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct regex_cache_entry *object_left = obj;
+	const struct regex_cache_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->pattern;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcmp(object_left->pattern, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+	if (cmp) {
+		return 0;
+	}
+	return CMP_MATCH | CMP_STOP;
+}
+
+/*!
+ * \internal
+ * \brief Get a compiled pattern, compiling and caching it on first use.
+ *
+ * \return Reffed cache entry, or NULL with the regcomp error message
+ * rendered into \a errbuf.
+ */
+static struct regex_cache_entry *regex_cache_get(const char *pattern, char *errbuf, size_t errlen)
+{
+	struct regex_cache_entry *entry;
+	int errcode;
+
+	if (regex_cache && (entry = ao2_find(regex_cache, pattern, OBJ_SEARCH_KEY))) {
+		return entry;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(pattern) + 1,
+		regex_cache_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		ast_copy_string(errbuf, "Out of memory", errlen);
+		return NULL;
+	}
+	if ((errcode = regcomp(&entry->regexbuf, pattern, REG_EXTENDED | REG_NOSUB))) {
+		regerror(errcode, &entry->regexbuf, errbuf, errlen);
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+	entry->compiled = 1;
+	strcpy(entry->pattern, pattern); /* Safe */
+
+	if (regex_cache) {
+		struct regex_cache_entry *existing;
+
+		ao2_lock(regex_cache);
+		if ((existing = ao2_find(regex_cache, pattern, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+			/* Somebody beat us to it; share their copy. */
+			ao2_unlock(regex_cache);
+			ao2_ref(entry, -1);
+			return existing;
+		}
+		if (ao2_container_count(regex_cache) >= REGEX_CACHE_MAX_ENTRIES) {
+			/* Simple bound: dump the cache and start over. */
+			ao2_callback(regex_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+				NULL, NULL);
+		}
+		ao2_link_flags(regex_cache, entry, OBJ_NOLOCK);
+		ao2_unlock(regex_cache);
+	}
+
+	return entry;
+}
+
 static int regex(struct ast_channel *chan, const char *cmd, char *parse, char *buf,
 		 size_t len)
 {
@@ -954,8 +1082,7 @@ static int regex(struct ast_channel *chan, const char *cmd, char *parse, char *b
 			     AST_APP_ARG(reg);
 			     AST_APP_ARG(str);
 	);
-	int errcode;
-	regex_t regexbuf;
+	struct regex_cache_entry *entry;
 
 	buf[0] = '\0';
 
@@ -970,15 +1097,14 @@ static int regex(struct ast_channel *chan, const char *cmd, char *parse, char *b
 
 	ast_debug(1, "FUNCTION REGEX (%s)(%s)\n", args.reg, args.str);
 
-	if ((errcode = regcomp(&regexbuf, args.reg, REG_EXTENDED | REG_NOSUB))) {
-		regerror(errcode, &regexbuf, buf, len);
+	if (!(entry = regex_cache_get(args.reg, buf, len))) {
 		ast_log(LOG_WARNING, "Malformed input %s(%s): %s\n", cmd, parse, buf);
 		return -1;
 	}
-	
-	strcpy(buf, regexec(&regexbuf, args.str, 0, NULL, 0) ? "0" : "1");
 
-	regfree(&regexbuf);
+	strcpy(buf, regexec(&entry->regexbuf, args.str, 0, NULL, 0) ? "0" : "1");
+
+	ao2_ref(entry, -1);
 
 	return 0;
 }
@@ -1962,6 +2088,9 @@ static int unload_module(void)
 	res |= ast_custom_function_unregister(&unshift_function);
 	res |= ast_custom_function_unregister(&passthru_function);
 
+	ao2_cleanup(regex_cache);
+	regex_cache = NULL;
+
 	return res;
 }
 
@@ -1969,6 +2098,10 @@ static int load_module(void)
 {
 	int res = 0;
 
+	/* REGEX() falls back to compiling per evaluation if this fails. */
+	regex_cache = ao2_container_alloc(REGEX_CACHE_BUCKETS, regex_cache_hash,
+		regex_cache_cmp);
+
 	AST_TEST_REGISTER(test_FIELDNUM);
 	AST_TEST_REGISTER(test_REPLACE);
 	AST_TEST_REGISTER(test_FILTER);
@@ -58,6 +58,16 @@ struct ast_ha {
 
 #define ACL_NAME_LENGTH 80
 
+/*!
+ * \brief Compiled form of a list of host access rules.
+ * \since 14.0.0
+ *
+ * Built by the ACL core when a rule list is first applied so matching
+ * costs at most one step per address bit regardless of how many rules
+ * the list holds.  The representation is internal to acl.c.
+ */
+struct ast_ha_trie;
+
 /*!
  * \brief an ast_acl is a linked list node of ast_ha structs which may have names.
  *
@@ -66,6 +76,8 @@ struct ast_ha {
  */
 struct ast_acl {
 	struct ast_ha *acl;             /*!< Rules contained by the ACL */
+	struct ast_ha_trie *trie;       /*!< Compiled form of the rules, built on first application. May be NULL. */
+	int trie_checked;               /*!< If raised, compilation has been attempted; a NULL trie then means the rules need the linear walk. */
 	int is_realtime;                /*!< If raised, this named ACL was retrieved from realtime storage */
 	int is_invalid;                 /*!< If raised, this is an invalid ACL which will automatically reject everything. */
 	char name[ACL_NAME_LENGTH];     /*!< If this was retrieved from the named ACL subsystem, this is the name of the ACL. */
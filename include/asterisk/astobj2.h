@@ -460,8 +460,88 @@ void *__ao2_alloc_with_lockobj(size_t data_size, ao2_destructor_fn destructor_fn
  * @{
  */
 
-#define ao2_t_ref(o,delta,tag) __ao2_ref((o), (delta), (tag),  __FILE__, __LINE__, __PRETTY_FUNCTION__)
-#define ao2_ref(o,delta)       __ao2_ref((o), (delta), "",  __FILE__, __LINE__, __PRETTY_FUNCTION__)
+/*!
+ * \internal
+ * \brief Private data preceding every ao2 object.
+ *
+ * Exposed here only so reference bumps can be inlined below; code
+ * outside main/astobj2.c must never touch these fields directly.
+ */
+struct __priv_data {
+	int ref_counter;
+	ao2_destructor_fn destructor_fn;
+	/*! This field is used for astobj2 and ao2_weakproxy objects to reference each other */
+	void *weakptr;
+#if defined(AO2_DEBUG)
+	/*! User data size for stats */
+	size_t data_size;
+#endif
+	/*! The ao2 object option flags */
+	uint32_t options;
+	/*! magic number.  This is used to verify that a pointer passed in is a
+	 *  valid astobj2 or ao2_weak reference */
+	uint32_t magic;
+};
+
+#define	AO2_MAGIC	0xa570b123
+#define	AO2_WEAK	0xa570b122
+#define IS_AO2_MAGIC_BAD(p) (AO2_MAGIC != (p->priv_data.magic | 1))
+
+/*!
+ * \internal
+ * What an astobj2 object looks like: fixed-size private data
+ * followed by variable-size user data.
+ */
+struct astobj2 {
+	struct __priv_data priv_data;
+	void *user_data[0];
+};
+
+/*!
+ * \internal
+ * \brief convert from a pointer \a user_data to the astobj2 header
+ */
+#define AO2_INTERNAL_OBJ(user_data) \
+	((struct astobj2 *) ((char *) (user_data) - sizeof(struct astobj2)))
+
+int __ao2_ref(void *o, int delta, const char *tag, const char *file, int line, const char *func);
+
+/*! Non-zero while runtime reference debugging (refdebug) is writing a log. */
+extern int ao2_ref_log_active;
+
+#if defined(AO2_DEBUG)
+/* Debug builds keep every reference operation on the full path so the
+ * global object statistics stay accurate. */
+#define __ao2_ref_fast __ao2_ref
+#else
+/*!
+ * \internal
+ * \brief Fast path for reference bumps.
+ *
+ * An increment on a live object can never destroy it or interact with
+ * a weak proxy, so unless reference logging is active it reduces to a
+ * single atomic add on the counter.  Everything else (decrements,
+ * delta 0, invalid pointers, active refdebug) falls through to the
+ * full path in __ao2_ref().
+ */
+AST_INLINE_API(
+int __ao2_ref_fast(void *user_data, int delta, const char *tag,
+	const char *file, int line, const char *func),
+{
+	if (delta > 0 && !ao2_ref_log_active && user_data) {
+		struct astobj2 *p = AO2_INTERNAL_OBJ(user_data);
+
+		if (!IS_AO2_MAGIC_BAD(p)) {
+			return ast_atomic_fetchadd_int(&p->priv_data.ref_counter, delta);
+		}
+	}
+	return __ao2_ref(user_data, delta, tag, file, line, func);
+}
+)
+#endif
+
+#define ao2_t_ref(o,delta,tag) __ao2_ref_fast((o), (delta), (tag),  __FILE__, __LINE__, __PRETTY_FUNCTION__)
+#define ao2_ref(o,delta)       __ao2_ref_fast((o), (delta), "",  __FILE__, __LINE__, __PRETTY_FUNCTION__)
 
 /*!
  * \brief Retrieve the ao2 options used to create the object.
@@ -491,8 +571,6 @@ unsigned int ao2_options_get(void *obj);
 #define ao2_bump(obj) \
 	ao2_t_bump((obj), "")
 
-int __ao2_ref(void *o, int delta, const char *tag, const char *file, int line, const char *func);
-
 /*!
  * \since 12.4.0
  * \brief Replace one object reference with another cleaning up the original.
@@ -1220,6 +1298,45 @@ enum ao2_container_opts {
 	 * ao2_sort_fn.
 	 */
 	AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE = (3 << 1),
+
+	/*!
+	 * \brief Optimize the container for read-mostly workloads.
+	 *
+	 * \details Find and read-only callback traversals enter a
+	 * lightweight reader epoch instead of taking the container
+	 * read lock, so concurrent lookups never contend on a shared
+	 * lock word.  Writers remain serialized by the container lock
+	 * and additionally wait for active readers to drain before
+	 * modifying the container.
+	 *
+	 * \note Only supported by hash containers.
+	 *
+	 * \note Callback functions invoked during an epoch protected
+	 * traversal must not modify the container, just as they must
+	 * not with a read locked container.
+	 *
+	 * \note Iterators continue to use the container lock.
+	 */
+	AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY = (1 << 3),
+
+	/*!
+	 * \brief Use an open-addressing backend for the hash container.
+	 *
+	 * \details The container stores object hashes inline in a flat
+	 * robin-hood probed slot array instead of chained bucket
+	 * lists.  A lookup walks consecutive slots and only touches a
+	 * node when its stored hash matches, so a find costs one or
+	 * two cache lines instead of a pointer chase.  The table grows
+	 * automatically as objects are linked.
+	 *
+	 * \note Only meaningful with ao2_container_alloc_hash().
+	 *
+	 * \note The backend does not maintain ao2_sort_fn traversal
+	 * order; a sort function is only used to detect duplicate keys
+	 * for the AO2_CONTAINER_ALLOC_OPT_DUPS_* options.  Traversal
+	 * and iteration order is unspecified.
+	 */
+	AO2_CONTAINER_ALLOC_OPT_OPEN_ADDRESSING = (1 << 4),
 };
 
 /*!
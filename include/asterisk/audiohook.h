@@ -71,6 +71,13 @@ enum ast_audiohook_init_flags {
 	 * Without enabling this flag on initialization the manipulation callback is guaranteed
 	 * 8khz audio only. */
 	AST_AUDIOHOOK_MANIPULATE_ALL_RATES = (1 << 0),
+	/*! Audiohook is a passive tap. Instead of being fed through the slinear
+	 * factories, frames written to the hook are duplicated once and queued for
+	 * direct consumption with ast_audiohook_tap_read_frame(), avoiding the
+	 * factory copy on write and the buffer copy on read. Only meaningful for
+	 * spy audiohooks; consumers receive frames at whatever size and rate they
+	 * arrived in and must perform any translation themselves. */
+	AST_AUDIOHOOK_TAP = (1 << 1),
 };
 
 struct ast_audiohook;
@@ -115,6 +122,8 @@ struct ast_audiohook {
 	ast_audiohook_manipulate_callback manipulate_callback; /*!< Manipulation callback */
 	struct ast_audiohook_options options;                  /*!< Applicable options */
 	unsigned int hook_internal_samp_rate;                           /*!< internal read/write sample rate on the audiohook.*/
+	AST_LIST_HEAD_NOLOCK(, ast_frame) tap_frames[2];       /*!< Queued frames for each direction when the hook is a tap */
+	unsigned int tap_queue_samples[2];                     /*!< Number of samples queued on each tap frame list */
 	AST_LIST_ENTRY(ast_audiohook) list;                    /*!< Linked list information */
 };
 
@@ -163,6 +172,19 @@ struct ast_frame *ast_audiohook_read_frame(struct ast_audiohook *audiohook, size
  */
 struct ast_frame *ast_audiohook_read_frame_all(struct ast_audiohook *audiohook, size_t samples, struct ast_format *format, struct ast_frame **read_frame, struct ast_frame **write_frame);
 
+/*! \brief Read the next queued frame from a tap audiohook
+ * \param audiohook Audiohook structure, which must be locked
+ * \param direction The direction to read a frame for, either
+ *        AST_AUDIOHOOK_DIRECTION_READ or AST_AUDIOHOOK_DIRECTION_WRITE
+ * \return the next queued frame, or NULL if none are queued
+ * \note The audiohook must have been initialized with AST_AUDIOHOOK_TAP.
+ *       Frames are handed back exactly as they were written to the hook, so
+ *       no buffering, resampling or translation takes place. The caller owns
+ *       the returned frame and must release it with ast_frfree().
+ * \since 14.0.0
+ */
+struct ast_frame *ast_audiohook_tap_read_frame(struct ast_audiohook *audiohook, enum ast_audiohook_direction direction);
+
 /*! \brief Attach audiohook to channel
  * \param chan Channel
  * \param audiohook Audiohook structure
@@ -293,6 +293,14 @@ struct ast_bridge {
 	uint32_t allowed_capabilities;
 	/*! Number of channels participating in the bridge */
 	unsigned int num_channels;
+	/*!
+	 * \brief Cached container of participant uniqueids for snapshots.
+	 *
+	 * Shared (immutable) by every bridge snapshot created until the
+	 * membership changes, at which point it is invalidated and rebuilt
+	 * lazily by the next snapshot.  Protected by the bridge lock.
+	 */
+	struct ao2_container *snapshot_channels;
 	/*! Number of active channels in the bridge. */
 	unsigned int num_active;
 	/*! Number of channels with AST_BRIDGE_CHANNEL_FLAG_LONELY in the bridge. */
@@ -147,6 +147,16 @@ struct ast_bridge_channel {
 	AST_LIST_HEAD_NOLOCK(, ast_frame) wr_queue;
 	/*! Pipe to alert thread when frames are put into the wr_queue. */
 	int alert_pipe[2];
+	/*!
+	 * \brief TRUE if an alert byte is outstanding on alert_pipe.
+	 *
+	 * \details The alert is coalesced: a single byte covers however
+	 * many frames are in the wr_queue, so producers skip the pipe
+	 * write when the channel thread has already been scheduled.
+	 *
+	 * \note Modified with the bridge_channel locked.
+	 */
+	unsigned int alert_armed:1;
 	/*!
 	 * \brief The bridge channel thread activity.
 	 *
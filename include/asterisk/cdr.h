@@ -457,6 +457,15 @@ int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf,
  */
 typedef int (*ast_cdrbe)(struct ast_cdr *cdr);
 
+/*!
+ * \brief CDR backend batch framing callback
+ *
+ * Called before the first record of a batch is posted to the backend
+ * and again after the last, so the backend can group the records of
+ * the batch into a single flush.  See \ref ast_cdr_register_batch().
+ */
+typedef void (*ast_cdrbe_batch)(void);
+
 /*! \brief Return TRUE if CDR subsystem is enabled */
 int ast_cdr_is_enabled(void);
 
@@ -509,6 +518,27 @@ void ast_cdr_free(struct ast_cdr *cdr);
  */
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be);
 
+/*!
+ * \brief Register a CDR handling engine with batch framing callbacks
+ * \param name name associated with the particular CDR handler
+ * \param desc description of the CDR handler
+ * \param be function pointer to a CDR handler
+ * \param batch_begin called before the records of a batch are posted, may be NULL
+ * \param batch_end called after the records of a batch are posted, may be NULL
+ *
+ * Like \ref ast_cdr_register(), but when CDR batch mode is in use the
+ * framing callbacks bracket each submitted batch.  This lets a backend
+ * commit the whole batch at once (one transaction, one file flush)
+ * instead of once per record.  Records are still delivered through
+ * \a be one at a time; outside of batch mode the framing callbacks are
+ * never invoked, so \a be must also work unbracketed.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error
+ */
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be,
+	ast_cdrbe_batch batch_begin, ast_cdrbe_batch batch_end);
+
 /*!
  * \brief Unregister a CDR handling engine
  * \param name name of CDR handler to unregister
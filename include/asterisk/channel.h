@@ -809,7 +809,25 @@ struct ast_hangup_handler {
 AST_LIST_HEAD_NOLOCK(ast_hangup_handler_list, ast_hangup_handler);
 AST_LIST_HEAD_NOLOCK(ast_datastore_list, ast_datastore);
 AST_LIST_HEAD_NOLOCK(ast_autochan_list, ast_autochan);
-AST_LIST_HEAD_NOLOCK(ast_readq_list, ast_frame);
+
+/*!
+ * \brief Channel read queue list head
+ *
+ * The first two members match the layout produced by
+ * AST_LIST_HEAD_NOLOCK() so the AST_LIST macros keep working on the
+ * queue.  The cached depth counters let __ast_queue_frame() enforce its
+ * depth limits without walking the queue on every enqueued frame; every
+ * site that adds or removes frames must keep them current.  The
+ * counters are unused on the deferred readq.
+ */
+struct ast_readq_list {
+	struct ast_frame *first;
+	struct ast_frame *last;
+	/*! Number of frames in the queue */
+	unsigned int frames;
+	/*! Number of voice frames in the queue */
+	unsigned int voice_frames;
+};
 
 typedef int(*ast_timing_func_t)(const void *data);
 /*!
@@ -4231,6 +4249,10 @@ void ast_channel_internal_fd_clear_all(struct ast_channel *chan);
 void ast_channel_internal_fd_set(struct ast_channel *chan, int which, int value);
 int ast_channel_fd(const struct ast_channel *chan, int which);
 int ast_channel_fd_isset(const struct ast_channel *chan, int which);
+/*! \brief Number of fds slots currently holding a descriptor */
+int ast_channel_internal_fd_count(const struct ast_channel *chan);
+/*! \brief Which fds slot the idx'th in-use descriptor occupies */
+int ast_channel_internal_fd_which(const struct ast_channel *chan, int idx);
 
 /* epoll data internal accessors */
 #ifdef HAVE_EPOLL
@@ -27,3 +27,30 @@ int ast_channel_internal_setup_topics(struct ast_channel *chan);
 
 void ast_channel_internal_errno_set(enum ast_channel_error error);
 enum ast_channel_error ast_channel_internal_errno(void);
+
+/*!
+ * \brief Add a datastore to the channel's inline datastore map.
+ *
+ * The map indexes the channel's datastore list by info pointer so
+ * type-only lookups avoid scanning the list.  If the datastore cannot
+ * be placed (map full, or its info is already present) the map is
+ * marked invalid and lookups fall back to the list.
+ */
+void ast_channel_internal_datastore_map_insert(struct ast_channel *chan, struct ast_datastore *datastore);
+
+/*!
+ * \brief Rebuild the channel's inline datastore map from the datastore list.
+ *
+ * Must be called after removing a datastore from the list or otherwise
+ * altering it without going through ast_channel_datastore_add().
+ */
+void ast_channel_internal_datastore_map_rebuild(struct ast_channel *chan);
+
+/*!
+ * \brief Look up a datastore by info pointer in the channel's inline map.
+ *
+ * \retval 0 if the map answered; *datastore holds the result (may be NULL).
+ * \retval -1 if the map is invalid and the caller must scan the list.
+ */
+int ast_channel_internal_datastore_map_find(struct ast_channel *chan,
+	const struct ast_datastore_info *info, struct ast_datastore **datastore);
@@ -28,6 +28,10 @@
 struct ast_var_t {
 	AST_LIST_ENTRY(ast_var_t) entries;
 	char *value;
+	/*! ast_str_hash() of the name without inheritance underscores.
+	 * Computed once at assignment so list scans can reject
+	 * non-matching entries without a string compare. */
+	int namehash;
 	char name[0];
 };
 
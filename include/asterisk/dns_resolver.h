@@ -36,6 +36,14 @@ struct ast_dns_resolver {
     /*! \brief Priority for this resolver if multiple exist, lower being higher priority */
     unsigned int priority;
 
+    /*!
+     * \brief If non-zero results from this resolver may be served from the core result cache
+     *
+     * \note Resolvers which return fabricated or stateful answers (such as ones used
+     *       for testing) should leave this unset
+     */
+    unsigned int cache_results;
+
     /*!
      * \brief Perform resolution of a DNS query
      *
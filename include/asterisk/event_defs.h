@@ -335,7 +335,10 @@ enum ast_event_ie_pltype {
 /*!
  * \brief Results for checking for subscribers
  *
- * \ref ast_event_check_subscriber()
+ * \note The ast_event subscription API that produced these results is
+ *       gone; local event distribution is handled by Stasis.  The values
+ *       remain because they are part of the binary event format shared
+ *       with other cluster nodes.
  */
 enum ast_event_subscriber_res {
 	/*! No subscribers exist */
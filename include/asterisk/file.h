@@ -76,6 +76,22 @@ typedef void (ast_waitstream_fr_cb)(struct ast_channel *chan, long ms, enum ast_
  */
 int ast_streamfile(struct ast_channel *c, const char *filename, const char *preflang);
 
+/*!
+ * \brief Hint that a file is about to be streamed
+ * \param filename the name of the file about to be streamed, minus the extension
+ * \param preflang the preferred language, as it will be given to ast_streamfile()
+ *
+ * Resolves the file the way ast_streamfile() would and warms it into the
+ * shared sound cache (or at least the OS page cache) from a background
+ * thread, so the later open does not have to wait on the disk.  Playlist
+ * players use this to pull in prompt N+1 while prompt N is playing, which
+ * removes the audible seam a cold open can leave between prompts.
+ *
+ * The hint is purely advisory and may be dropped; nothing breaks if the
+ * file is never actually streamed, or never prefetched.
+ */
+void ast_stream_prefetch(const char *filename, const char *preflang);
+
 /*!
  * \brief stream file until digit
  * If the file name is non-empty, try to play it.
@@ -86,6 +102,28 @@ int ast_streamfile(struct ast_channel *c, const char *filename, const char *pref
  */
 int ast_stream_and_wait(struct ast_channel *chan, const char *file, const char *digits);
 
+/*!
+ * \brief Stream a sequence of files, resolving all of them up front
+ * \param chan channel to stream the files to
+ * \param files array of file names to stream, in order, minus the extensions
+ * \param count number of entries in \a files
+ * \param preflang the preferred language the files should be streamed in
+ * \param digits digits that may interrupt playback, "" to check for non-zero
+ * \param audiofd file descriptor to write audio to, or -1
+ * \param ctrlfd file descriptor to monitor for control, or -1, see ast_waitstream_full()
+ *
+ * Every file in the sequence is resolved before playback starts, so
+ * missing prompts are reported before any audio is heard and the
+ * existence lookups during playback are warm. Files that do not exist
+ * are skipped, as with a failed ast_streamfile().
+ *
+ * \retval 0 if success.
+ * \retval -1 if error.
+ * \retval digit if interrupted by a digit.
+ */
+int ast_stream_and_wait_files(struct ast_channel *chan, const char * const *files,
+	size_t count, const char *preflang, const char *digits, int audiofd, int ctrlfd);
+
 /*!
  * \brief Stops a stream
  *
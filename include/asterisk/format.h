@@ -289,6 +289,16 @@ void *ast_format_get_attribute_data(const struct ast_format *format);
  */
 void ast_format_set_attribute_data(struct ast_format *format, void *attribute_data);
 
+/*!
+ * \brief Query whether an attribute interface is involved when comparing the format
+ *
+ * \param format The media format
+ *
+ * \retval 0 comparisons of the format depend only on its codec
+ * \retval 1 an attribute interface takes part in comparisons
+ */
+int ast_format_has_attribute_interface(const struct ast_format *format);
+
 /*!
  * \brief Get the name associated with a format
  *
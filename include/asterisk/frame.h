@@ -554,6 +554,29 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr);
  */
 struct ast_frame *ast_frdup(const struct ast_frame *fr);
 
+/*! \brief Allocate a buffer suitable for use as frame data
+ *
+ * The buffer is served from the same per-thread cache that ast_frfree()
+ * returns frame data buffers to, so drivers that receive media straight
+ * into one of these buffers and attach it to a frame with
+ * AST_MALLOCD_DATA recycle the same few buffers instead of hitting the
+ * allocator once per packet.  When attaching, the frame's offset must be
+ * the distance from the start of the buffer to data.ptr so the buffer is
+ * released correctly.
+ * \param len buffer size in bytes, including any headroom
+ * \return a buffer of at least \a len bytes, or NULL on allocation failure
+ */
+void *ast_frame_data_alloc(size_t len);
+
+/*! \brief Release a buffer obtained from ast_frame_data_alloc()
+ *
+ * Only for buffers that were never attached to a frame; attached buffers
+ * are released by ast_frfree() with the frame.
+ * \param data the buffer to release
+ * \param len the size that was passed to ast_frame_data_alloc()
+ */
+void ast_frame_data_free(void *data, size_t len);
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples);
 
 /* Helpers for byteswapping native samples to/from
@@ -434,4 +434,22 @@ AST_OPTIONAL_API(const char *, ast_websocket_client_accept_protocol,
  */
 AST_OPTIONAL_API(int, ast_websocket_set_timeout, (struct ast_websocket *session, int timeout), {return -1;});
 
+/*!
+ * \brief Enable Nagle-style write batching on a WebSocket session.
+ *
+ * While batching is enabled, written frames are left in the stream buffer
+ * and flushed to the socket once the batch window expires, coalescing
+ * bursts of small frames into fewer socket writes. Each frame still
+ * reaches the client unmodified; only its delivery may be delayed by up
+ * to \a batch_ms milliseconds. Passing zero disables batching, restoring
+ * the flush-per-frame behavior.
+ *
+ * \param session Session to configure
+ * \param batch_ms Window, in milliseconds, during which frames may be held back
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+AST_OPTIONAL_API(int, ast_websocket_set_write_batching, (struct ast_websocket *session, int batch_ms), {return -1;});
+
 #endif
@@ -804,6 +804,35 @@ char *ast_json_dump_string_format(struct ast_json *root, enum ast_json_encoding_
  */
 int ast_json_dump_str_format(struct ast_json *root, struct ast_str **dst, enum ast_json_encoding_format format);
 
+/*!
+ * \brief Callback invoked with successive chunks of an encoding.
+ *
+ * \param chunk Buffer containing a piece of the encoded value.
+ * \param size Size of \a chunk, in bytes.
+ * \param data User data passed to ast_json_dump_callback_format().
+ * \return 0 to continue the encoding.
+ * \return -1 to abort the encoding.
+ */
+typedef int (*ast_json_dump_chunk_cb)(const char *chunk, size_t size, void *data);
+
+#define ast_json_dump_callback(root, callback, data) ast_json_dump_callback_format(root, callback, data, AST_JSON_COMPACT)
+
+/*!
+ * \brief Encode a JSON value as a stream of buffer chunks.
+ *
+ * The encoder invokes \a callback repeatedly with consecutive pieces of
+ * the encoding, so the complete string is never held in memory. This is
+ * preferable to ast_json_dump_string_format() for large values whose
+ * encoding is written straight into an output buffer or stream.
+ *
+ * \param root JSON value.
+ * \param callback Function to invoke with each chunk of the encoding.
+ * \param data Arbitrary pointer passed through to \a callback.
+ * \return 0 on success.
+ * \return -1 on error. The amount of the encoding emitted is undefined.
+ */
+int ast_json_dump_callback_format(struct ast_json *root, ast_json_dump_chunk_cb callback, void *data, enum ast_json_encoding_format format);
+
 #define ast_json_dump_file(root, output) ast_json_dump_file_format(root, output, AST_JSON_COMPACT)
 
 /*!
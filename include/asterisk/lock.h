@@ -214,6 +214,22 @@ int __ast_rwlock_trywrlock(const char *filename, int lineno, const char *func, a
 
 #define	ROFFSET	((lt->reentrancy > 0) ? (lt->reentrancy-1) : 0)
 
+struct ast_str;
+
+/*!
+ * \brief Report sampled lock contention hot spots
+ *
+ * The core keeps an always-on sampled contention profiler: one of every
+ * N contended ast_mutex_t acquisitions per thread (which includes ao2
+ * object locks) is timed and charged to the acquiring call site.  This
+ * builds a rollup across all threads, worst total wait first, for the
+ * "core show lock contention" CLI command.
+ *
+ * \retval ast_str to be freed by the caller on success
+ * \retval NULL on error
+ */
+struct ast_str *ast_lock_contention_report(void);
+
 #ifdef DEBUG_THREADS
 
 #define __ast_mutex_logger(...)  do { if (canlog) ast_log(LOG_ERROR, __VA_ARGS__); else fprintf(stderr, __VA_ARGS__); } while (0)
@@ -101,6 +101,26 @@ struct ao2_container *ast_media_get_media(struct ast_media_index *index);
  */
 int ast_media_index_update(struct ast_media_index *index,
 	const char *variant);
+
+/*!
+ * \brief Update a media index, consulting an on-disk manifest cache
+ *
+ * The cache records the directories visited by a previous scan (with their
+ * modification times) and the files they contained. When every recorded
+ * directory is unmodified the index is rebuilt from the manifest without
+ * walking the tree, eliminating the per-file stat() calls; otherwise a full
+ * scan is performed and the cache is rewritten. Description files are always
+ * re-read from disk, so their contents are never stale.
+ *
+ * \param index Media index in which to query information
+ * \param variant Media variant for which to get the description
+ * \param cache_file Path of the manifest cache to consult and maintain
+ *
+ * \retval non-zero on error
+ * \return zero on success
+ */
+int ast_media_index_update_cached(struct ast_media_index *index,
+	const char *variant, const char *cache_file);
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
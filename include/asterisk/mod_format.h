@@ -119,6 +119,14 @@ struct ast_filestream {
 	void *_private;	/*!< pointer to private buffer */
 	const char *orig_chan_name;
 	char *write_buffer;
+	/*! Reference to the shared in-memory copy of the file that \c f reads
+	 * from when the stream was opened out of the sound file cache (file.c);
+	 * NULL when \c f is a regular stdio stream. */
+	void *sound_cache_entry;
+	/*! Deferred write bookkeeping when the stream's writes are handed off to
+	 * the background writer threads (file.c); NULL when writes happen in the
+	 * calling thread. */
+	void *write_behind;
 };
 
 /*! 
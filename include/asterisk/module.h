@@ -106,7 +106,22 @@ enum ast_module_support_level {
  */
 enum ast_module_load_result ast_load_resource(const char *resource_name);
 
-/*! 
+/*!
+ * \brief Load the module declared to provide a resource.
+ * \param type Kind of resource ("application", "function", "channel").
+ * \param name The name of the resource being looked up.
+ *
+ * Modules listed in the lazy-* sections of modules.conf are not loaded
+ * at startup.  Lookup paths call this when a resource is not registered
+ * so the declared provider is loaded on first use.  Each module gets at
+ * most one load attempt; its declarations are dropped either way.
+ *
+ * \retval 0 a module was loaded and the lookup should be retried.
+ * \retval -1 no module is declared for the resource or the load failed.
+ */
+int ast_module_load_for(const char *type, const char *name);
+
+/*!
  * \brief Unload a module.
  * \param resource_name The name of the module to unload.
  * \param ast_module_unload_mode The force flag. This should be set using one of the AST_FORCE flags.
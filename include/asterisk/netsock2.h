@@ -680,6 +680,66 @@ ssize_t ast_sendto(int sockfd, const void *buf, size_t len, int flags,
  */
 int ast_set_qos(int sockfd, int tos, int cos, const char *desc);
 
+/*!
+ * \brief
+ * Register a bound listener socket for handoff across a restart.
+ *
+ * \details
+ * Registered listeners are kept open across the exec() performed by
+ * 'core restart', so the replacement process keeps accepting on the
+ * same sockets instead of rebinding once its modules have loaded.
+ *
+ * \param fd The bound (and, for stream sockets, listening) descriptor
+ * \param addr The address the descriptor is bound to
+ * \retval 0 Success
+ * \retval -1 Failure
+ */
+int ast_listener_fd_register(int fd, const struct ast_sockaddr *addr);
+
+/*!
+ * \brief
+ * Remove a listener socket from the restart handoff set.
+ *
+ * \details
+ * Must be called before a registered listener is closed so a stale
+ * descriptor is not passed to the replacement process.
+ *
+ * \param fd The descriptor previously registered
+ */
+void ast_listener_fd_unregister(int fd);
+
+/*!
+ * \brief
+ * Claim a listener inherited from the previous process, if any.
+ *
+ * \details
+ * Looks up \a addr among the descriptors the previous process passed
+ * across the restart exec().  A claimed descriptor is removed from the
+ * inherited set and becomes the caller's to register and close.
+ *
+ * \param addr The address the caller was going to bind
+ * \return The inherited descriptor, already bound to \a addr
+ * \retval -1 No inherited listener matches \a addr
+ */
+int ast_listener_fd_acquire(const struct ast_sockaddr *addr);
+
+/*!
+ * \brief
+ * Arrange for registered listeners to survive the restart exec().
+ *
+ * \note Called only by the core restart path after it has marked all
+ * descriptors close-on-exec.
+ */
+void ast_listener_handoff_prepare(void);
+
+/*!
+ * \brief
+ * Close inherited listeners that no subsystem claimed during startup.
+ *
+ * \note Called only by the core once startup has fully completed.
+ */
+void ast_listener_handoff_complete(void);
+
 /*!
  * These are backward compatibility functions that may be used by subsystems
  * that have not yet been converted to IPv6. They will be removed when all
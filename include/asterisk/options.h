@@ -157,6 +157,15 @@ extern int ast_language_is_prefix;
 
 extern unsigned int ast_option_rtpptdynamic;
 
+/*! How long (ms) cached sound file stat() results stay valid (file.c); zero disables the cache */
+extern unsigned int ast_option_statcache_ms;
+
+/*! MB of sound file data kept mapped in memory for shared playback (file.c); zero disables the cache */
+extern unsigned int ast_option_mmapcache;
+
+/*! KB of recorded audio each stream may queue for background writing (file.c); zero keeps writes synchronous */
+extern unsigned int ast_option_recwritebehind;
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
@@ -38,6 +38,39 @@
  */
 int ast_can_pickup(struct ast_channel *chan);
 
+/*!
+ * \brief Re-evaluate a channel's membership in the pickup candidate index.
+ *
+ * Called by the channel core whenever a channel's state changes.  The
+ * index tracks channels in a state that may be picked up so pickup
+ * scans are proportional to the number of ringing channels instead of
+ * the whole channels container.
+ *
+ * \param chan Channel whose state changed.
+ */
+void ast_pickup_state_changed(struct ast_channel *chan);
+
+/*!
+ * \brief Drop a hung up channel from the pickup candidate index.
+ *
+ * Called by the channel core when a channel is hung up, mirroring its
+ * removal from the channels container.
+ *
+ * \param chan Channel being hung up.
+ */
+void ast_pickup_channel_removed(struct ast_channel *chan);
+
+/*!
+ * \brief Get an iterator over channels that may currently be picked up.
+ *
+ * The index is a superset of pickup eligibility: it only tracks channel
+ * state, so consumers must still verify ast_can_pickup() with the
+ * channel locked before acting on a candidate.
+ *
+ * \return An ao2_iterator of channels.  Destroy with ao2_iterator_destroy().
+ */
+struct ao2_iterator ast_pickup_candidates_iterator(void);
+
 /*!
  * \brief Find a pickup channel target by group.
  *
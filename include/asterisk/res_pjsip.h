@@ -1402,6 +1402,32 @@ int ast_sip_push_task(struct ast_taskprocessor *serializer, int (*sip_task)(void
  */
 int ast_sip_push_task_synchronous(struct ast_taskprocessor *serializer, int (*sip_task)(void *), void *task_data);
 
+/*!
+ * \brief Push a task to SIP servants and invoke a completion callback when it finishes
+ *
+ * Like \ref ast_sip_push_task except that the completion callback is invoked,
+ * from the serializer thread, with the task's return value once the task has
+ * run.  The pushing thread never blocks, so this is safe to call from channel
+ * threads and from SIP servant threads where \ref ast_sip_push_task_synchronous
+ * would deadlock.
+ *
+ * \note The task is queued before this function returns, so tasks later pushed
+ * to the same serializer are guaranteed to run after it.
+ *
+ * \note If the push itself fails the completion callback is \b not invoked;
+ * the caller is responsible for cleaning up task_data in that case.
+ *
+ * \param serializer The SIP serializer to which the task belongs. May be NULL.
+ * \param sip_task The task to execute
+ * \param task_data The parameter to pass to the task and completion callback
+ * \param sip_task_complete Callback invoked with task_data and the task's return value
+ * \retval 0 Success
+ * \retval -1 Failure
+ */
+int ast_sip_push_task_completion(struct ast_taskprocessor *serializer,
+	int (*sip_task)(void *), void *task_data,
+	void (*sip_task_complete)(void *task_data, int res));
+
 /*!
  * \brief Determine if the current thread is a SIP servant thread
  *
@@ -131,6 +131,8 @@ struct ast_sip_session {
 	AST_LIST_HEAD_NOLOCK(, ast_sip_session_delayed_request) delayed_requests;
 	/*! When we need to reschedule a reinvite, we use this structure to do it */
 	pj_timer_entry rescheduled_reinvite;
+	/*! Short hold timer used to coalesce session refreshes into one request */
+	pj_timer_entry coalesced_refresh;
 	/*! Format capabilities pertaining to direct media */
 	struct ast_format_cap *direct_media_cap;
 	/*! When we need to forcefully end the session */
@@ -590,20 +590,32 @@ struct ast_rtp_engine {
 	AST_RWLIST_ENTRY(ast_rtp_engine) entry;
 };
 
+/*! Vector of payload type mappings indexed by payload number */
+AST_VECTOR(ast_rtp_payload_type_vector, struct ast_rtp_payload_type *);
+
 /*! Structure that represents codec and packetization information */
 struct ast_rtp_codecs {
 	/*! RW lock that protects elements in this structure */
 	ast_rwlock_t codecs_lock;
 	/*! Rx payload type mapping exceptions */
-	AST_VECTOR(, struct ast_rtp_payload_type *) payload_mapping_rx;
+	struct ast_rtp_payload_type_vector payload_mapping_rx;
 	/*! Tx payload type mapping */
-	AST_VECTOR(, struct ast_rtp_payload_type *) payload_mapping_tx;
+	struct ast_rtp_payload_type_vector payload_mapping_tx;
 	/*! The framing for this media session */
 	unsigned int framing;
+	/*!
+	 * Last payload returned by ast_rtp_codecs_payload_code() (-1 if none).
+	 * A hint only; it is re-validated against payload_mapping_rx before use,
+	 * so it never needs explicit invalidation.
+	 */
+	int payload_code_rx_cache;
+	/*! Last payload returned by ast_rtp_codecs_payload_code_tx() (-1 if none). */
+	int payload_code_tx_cache;
 };
 
 #define AST_RTP_CODECS_NULL_INIT \
-    { .codecs_lock = AST_RWLOCK_INIT_VALUE, .payload_mapping_rx = { 0, }, .payload_mapping_tx = { 0, }, .framing = 0, }
+    { .codecs_lock = AST_RWLOCK_INIT_VALUE, .payload_mapping_rx = { 0, }, .payload_mapping_tx = { 0, }, .framing = 0, \
+      .payload_code_rx_cache = -1, .payload_code_tx_cache = -1, }
 
 /*! Structure that represents the glue that binds an RTP instance to a channel */
 struct ast_rtp_glue {
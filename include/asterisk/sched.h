@@ -145,6 +145,24 @@ extern "C" {
 #define AST_SCHED_REPLACE_UNREF(id, sched, when, callback, data, unrefcall, addfailcall, refcall) \
 	AST_SCHED_REPLACE_VARIABLE_UNREF(id, sched, when, callback, data, 0, unrefcall, addfailcall, refcall)
 
+/*!
+ * \brief Scheduler queue backend selection
+ */
+enum ast_sched_backend {
+	/*! Binary heap ordered by expiration time.  The default. */
+	AST_SCHED_BACKEND_HEAP = 0,
+	/*!
+	 * \brief Hierarchical timing wheel.
+	 *
+	 * O(1) insert and delete, which makes it the better choice for
+	 * contexts carrying large numbers of timers that are nearly
+	 * always cancelled before they fire (RTP keepalives, SIP and
+	 * IAX2 retransmit timers).  Timer resolution is one
+	 * millisecond.  Uses more memory per context than the heap.
+	 */
+	AST_SCHED_BACKEND_WHEEL,
+};
+
 /*!
  * \brief Create a scheduler context
  *
@@ -152,6 +170,15 @@ extern "C" {
  */
 struct ast_sched_context *ast_sched_context_create(void);
 
+/*!
+ * \brief Create a scheduler context with the requested queue backend
+ *
+ * \param backend Queue backend for the context.
+ *
+ * \return Returns a malloc'd sched_context structure, NULL on failure
+ */
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend);
+
 /*!
  * \brief destroys a schedule context
  *
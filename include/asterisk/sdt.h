@@ -0,0 +1,61 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2018, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ * \brief Static userspace probe points
+ *
+ * Thin wrappers around the systemtap/dtrace SDT macros so hot paths can
+ * carry stable probe points that survive inlining, renames and stripped
+ * builds.  Each probe compiles to a single nop plus an ELF note when
+ * sys/sdt.h is available at configure time and to nothing at all when it
+ * is not, so probes may be placed on fast paths without a runtime check.
+ *
+ * All probes share the "asterisk" provider.  List them with
+ * 'stap -L "process(...).mark(*)"' or 'perf probe --exts sdt_asterisk'.
+ *
+ * Probe arguments are evaluated even when no tracer is attached, so only
+ * pass values that are already at hand.
+ */
+
+#ifndef _ASTERISK_SDT_H
+#define _ASTERISK_SDT_H
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define ast_sdt_probe(name) \
+	DTRACE_PROBE(asterisk, name)
+#define ast_sdt_probe1(name, arg1) \
+	DTRACE_PROBE1(asterisk, name, arg1)
+#define ast_sdt_probe2(name, arg1, arg2) \
+	DTRACE_PROBE2(asterisk, name, arg1, arg2)
+#define ast_sdt_probe3(name, arg1, arg2, arg3) \
+	DTRACE_PROBE3(asterisk, name, arg1, arg2, arg3)
+#define ast_sdt_probe4(name, arg1, arg2, arg3, arg4) \
+	DTRACE_PROBE4(asterisk, name, arg1, arg2, arg3, arg4)
+
+#else
+
+#define ast_sdt_probe(name)
+#define ast_sdt_probe1(name, arg1)
+#define ast_sdt_probe2(name, arg1, arg2)
+#define ast_sdt_probe3(name, arg1, arg2, arg3)
+#define ast_sdt_probe4(name, arg1, arg2, arg3, arg4)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif /* _ASTERISK_SDT_H */
@@ -30,14 +30,11 @@
 extern "C" {
 #endif
 
-#define AST_SLINFACTORY_MAX_HOLD 1280
-
 struct ast_slinfactory {
-	AST_LIST_HEAD_NOLOCK(, ast_frame) queue; /*!< A list of unaltered frames */
 	struct ast_trans_pvt *trans;             /*!< Translation path that converts fed frames into signed linear */
-	short hold[AST_SLINFACTORY_MAX_HOLD];    /*!< Hold for audio that no longer belongs to a frame (ie: if only some samples were taken from a frame) */
-	short *offset;                           /*!< Offset into the hold where audio begins */
-	size_t holdlen;                          /*!< Number of samples currently in the hold */
+	short *ring;                             /*!< Ring of queued samples, always a power of two in size */
+	unsigned int ring_size;                  /*!< Capacity of the ring in samples */
+	unsigned int ring_head;                  /*!< Index of the oldest queued sample */
 	unsigned int size;                       /*!< Number of samples currently in the factory */
 	struct ast_format *format;               /*!< Current format the translation path is converting from */
 	struct ast_format *output_format;        /*!< The output format desired */
@@ -81,7 +78,7 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf);
  * \param sf The slinfactory to feed into
  * \param f Frame containing audio to feed in
  *
- * \return Number of frames currently in factory
+ * \return 0 on success, -1 on failure
  */
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f);
 
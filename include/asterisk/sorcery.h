@@ -304,6 +304,9 @@ struct ast_sorcery_wizard {
 	/*! \brief Optional callback for retrieving multiple objects using some optional field criteria */
 	void (*retrieve_multiple)(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const struct ast_variable *fields);
 
+	/*! \brief Optional callback for retrieving multiple objects by their unique identifiers in one request */
+	void (*retrieve_multiple_id)(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects, const char * const *ids, size_t num_ids);
+
 	/*! \brief Callback for updating an object */
 	int (*update)(const struct ast_sorcery *sorcery, void *data, void *object);
 
@@ -1183,6 +1186,29 @@ int ast_sorcery_create(const struct ast_sorcery *sorcery, void *object);
  */
 void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *type, const char *id);
 
+/*!
+ * \brief Retrieve multiple objects using their unique identifiers
+ * \since 14.0.0
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param type Type of object to retrieve
+ * \param ids Array of unique object identifiers
+ * \param num_ids Number of identifiers in the array
+ *
+ * \retval non-NULL container of the objects that were found
+ * \retval NULL if a failure occurred
+ *
+ * \note Wizards implementing the retrieve_multiple_id callback satisfy the
+ *       request with a single backend query; other wizards are asked
+ *       identifier-by-identifier for whatever remains unresolved.
+ *
+ * \note Identifiers which could not be found are simply absent from the
+ *       returned container. Objects are not created in caching wizards.
+ *
+ * \note The returned container must be unreferenced after use.
+ */
+struct ao2_container *ast_sorcery_retrieve_by_id_multiple(const struct ast_sorcery *sorcery, const char *type, const char * const *ids, size_t num_ids);
+
 /*!
  * \brief Retrieve an object or multiple objects using specific fields
  * \since 13.9.0
@@ -47,6 +47,8 @@ enum ast_speech_results_type {
 	AST_SPEECH_RESULTS_TYPE_NBEST,
 };
 
+struct ast_speech_audio_queue;
+
 /* Speech structure */
 struct ast_speech {
 	/*! Structure lock */
@@ -67,6 +69,10 @@ struct ast_speech {
 	enum ast_speech_results_type results_type;
 	/*! Pointer to the engine used by this speech structure */
 	struct ast_speech_engine *engine;
+	/*! Audio buffered for the engine, drained by a per-session worker thread.
+	 * NULL if the worker could not be started and writes go to the engine
+	 * directly. Managed entirely by res_speech. */
+	struct ast_speech_audio_queue *queue;
 };
   
 /* Speech recognition engine structure */
@@ -318,6 +318,13 @@ enum stasis_message_type_result stasis_message_type_create(const char *name,
  */
 const char *stasis_message_type_name(const struct stasis_message_type *type);
 
+/*!
+ * \brief Gets the id of a given message type
+ * \param type The type to get.
+ * \return The id of the type.
+ */
+int stasis_message_type_id(const struct stasis_message_type *type);
+
 /*!
  * \brief Check whether a message type is declined
  *
@@ -604,6 +611,65 @@ struct stasis_subscription *stasis_unsubscribe(
 int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscription,
 	long low_water, long high_water);
 
+/*!
+ * \brief Stasis subscription message type filters.
+ *
+ * A subscription starts with a filter of \c STASIS_SUBSCRIPTION_FILTER_NONE
+ * and receives every message published to its topic.
+ */
+enum stasis_subscription_message_filter {
+	STASIS_SUBSCRIPTION_FILTER_NONE = 0,	/*!< No filter is in place, all messages are raised */
+	STASIS_SUBSCRIPTION_FILTER_FORCED_NONE,	/*!< No filter is in place or can be set, all messages are raised */
+	STASIS_SUBSCRIPTION_FILTER_SELECTIVE,	/*!< Only messages of allowed message types are raised */
+};
+
+/*!
+ * \brief Indicate to a subscription that we are interested in a message type.
+ *
+ * This will cause the subscription to receive messages of the given type,
+ * once the subscription's filter has been set to
+ * \c STASIS_SUBSCRIPTION_FILTER_SELECTIVE.  Subscription change messages are
+ * always delivered regardless of the filter.
+ *
+ * \param subscription Subscription to add message type to.
+ * \param type The message type we wish to receive.
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ */
+int stasis_subscription_accept_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type);
+
+/*!
+ * \brief Indicate to a subscription that we are not interested in a message type.
+ *
+ * \param subscription Subscription to remove message type from.
+ * \param type The message type we don't wish to receive.
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ */
+int stasis_subscription_decline_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type);
+
+/*!
+ * \brief Set the message type filtering level on a subscription.
+ *
+ * This will cause the subscription to either filter messages by the type
+ * set of accepted message types, or receive everything.  A filter of
+ * \c STASIS_SUBSCRIPTION_FILTER_FORCED_NONE is sticky and cannot be
+ * overwritten; it is used by consumers, such as a message router with a
+ * default route, that must see every message.
+ *
+ * \param subscription Subscription to change the filter on.
+ * \param filter The new filter level.
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ */
+int stasis_subscription_set_message_type_filter(struct stasis_subscription *subscription,
+	enum stasis_subscription_message_filter filter);
+
 /*!
  * \brief Block until the last message is processed on a subscription.
  *
@@ -654,6 +654,35 @@ struct ast_str * attribute_malloc ast_str_create(size_t init_len),
 )
 #endif
 
+/*!
+ * \brief Get a malloc'd ast_str from the calling thread's pool.
+ *
+ * Equivalent to ast_str_create(), but recycles buffers previously
+ * returned to the pool with ast_str_pool_put() by this thread.  The
+ * request is rounded up to a power-of-two size class so repeated
+ * get/grow/put cycles converge on a stable buffer size.
+ *
+ * \param init_len The initial length of the string buffer
+ *
+ * \return An ast_str on success, or NULL on allocation failure.
+ *
+ * \note The result is an ordinary malloc'd ast_str; it may be passed to
+ *       ast_free() instead of being returned to the pool.
+ */
+struct ast_str *ast_str_pool_get(size_t init_len);
+
+/*!
+ * \brief Return an ast_str to the calling thread's pool.
+ *
+ * Buffers that do not fit the pool (oversized, or the size class is
+ * already full) are freed, so this is always a valid replacement for
+ * ast_free() on a malloc'd ast_str.  Strings backed by ast_str_alloca()
+ * or thread storage are left untouched.
+ *
+ * \param buf The string to recycle.  NULL is tolerated.
+ */
+void ast_str_pool_put(struct ast_str *buf);
+
 /*! \brief Reset the content of a dynamic string.
  * Useful before a series of ast_str_append.
  */
@@ -165,6 +165,23 @@ struct ast_taskprocessor_listener *ast_taskprocessor_listener_alloc(const struct
  */
 struct ast_taskprocessor *ast_taskprocessor_get(const char *name, enum ast_tps_options create);
 
+/*!
+ * \brief Get a reference to a taskprocessor executed by the shared worker pool
+ *
+ * Behaves like ast_taskprocessor_get() except that a newly created
+ * taskprocessor does not own a dedicated thread.  Its tasks are run by a
+ * small pool of worker threads shared between all pooled taskprocessors,
+ * so idle taskprocessors cost no thread.  Tasks pushed to any one
+ * taskprocessor are still executed in order and never concurrently.
+ *
+ * \param name The name of the taskprocessor
+ * \param create Use 0 by default or specify TPS_REF_IF_EXISTS to return NULL if the taskprocessor does
+ * not already exist
+ * return A pointer to a reference counted taskprocessor under normal conditions, or NULL if the
+ * TPS_REF_IF_EXISTS reference type is specified and the taskprocessor does not exist
+ */
+struct ast_taskprocessor *ast_taskprocessor_get_pooled(const char *name, enum ast_tps_options create);
+
 /*!
  * \brief Create a taskprocessor with a custom listener
  *
@@ -215,6 +232,30 @@ void *ast_taskprocessor_unreference(struct ast_taskprocessor *tps);
  */
 int ast_taskprocessor_push(struct ast_taskprocessor *tps, int (*task_exe)(void *datap), void *datap);
 
+/*! \brief One task of a batch passed to ast_taskprocessor_push_multiple() */
+struct ast_taskprocessor_batch_task {
+	/*! The task handling function */
+	int (*execute)(void *datap);
+	/*! The data to be used by the task handling function */
+	void *datap;
+};
+
+/*!
+ * \brief Push several tasks into the specified taskprocessor queue at once.
+ *
+ * The whole batch is queued under a single acquisition of the taskprocessor
+ * lock and the listener is signaled once, amortizing the per-task push
+ * overhead over the batch.  The tasks execute in array order.
+ *
+ * \param tps The taskprocessor structure
+ * \param tasks Array of tasks to push
+ * \param num Number of entries in \a tasks
+ * \retval 0 success (all tasks queued)
+ * \retval -1 failure (no tasks queued)
+ */
+int ast_taskprocessor_push_multiple(struct ast_taskprocessor *tps,
+	const struct ast_taskprocessor_batch_task *tasks, size_t num);
+
 /*! \brief Local data parameter */
 struct ast_taskprocessor_local {
 	/*! Local data, associated with the taskprocessor. */
@@ -284,6 +325,19 @@ int ast_taskprocessor_is_suspended(struct ast_taskprocessor *tps);
  */
 int ast_taskprocessor_execute(struct ast_taskprocessor *tps);
 
+/*!
+ * \brief Pop up to \a limit tasks off the taskprocessor and execute them.
+ *
+ * The run of tasks is removed from the queue under a single acquisition of
+ * the taskprocessor lock, amortizing the per-task pop overhead over the
+ * batch.  Tasks execute in queue order.
+ *
+ * \param tps The taskprocessor from which to execute.
+ * \param limit Largest number of tasks to execute.
+ * \return The number of tasks executed; 0 means the queue was empty.
+ */
+int ast_taskprocessor_execute_batch(struct ast_taskprocessor *tps, unsigned int limit);
+
 /*!
  * \brief Am I the given taskprocessor's current task.
  * \since 12.7.0
@@ -212,6 +212,17 @@ void ast_tcptls_stream_set_timeout_sequence(struct ast_tcptls_stream *stream, st
  */
 void ast_tcptls_stream_set_exclusive_input(struct ast_tcptls_stream *stream, int exclusive_input);
 
+/*!
+ * \brief Test if the stream has decrypted data buffered that a poll
+ * on the socket would not report.
+ *
+ * \param stream TCP/TLS stream control data.
+ *
+ * \retval 0 No buffered input is pending.
+ * \retval 1 Buffered input is waiting to be read.
+ */
+int ast_tcptls_stream_pending(struct ast_tcptls_stream *stream);
+
 /*! \brief
  * describes a server instance
  */
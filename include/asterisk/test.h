@@ -356,6 +356,38 @@ void ast_test_debug(struct ast_test *test, const char *fmt, ...) __attribute__((
  */
 void ast_test_set_result(struct ast_test *test, enum ast_test_result_state state);
 
+/*!
+ * \brief Run a microbenchmark and report per-iteration timing statistics.
+ *
+ * Invokes \a run \a warmup times without timing to prime caches and any
+ * lazy initialization, then \a iterations more times with each invocation
+ * timed individually on the monotonic clock.  The minimum, mean, median,
+ * 99th percentile and maximum per-iteration times are reported through the
+ * test's status output.
+ *
+ * Benchmarks are ordinary unit tests that call this helper and are
+ * expected to register under the /benchmarks/ category, so they stay out
+ * of category-scoped regression runs and can be executed together with
+ * 'test execute category /benchmarks/' (or 'make benchmark').
+ *
+ * \note When a single operation is near the timer resolution the callback
+ *       should perform a small fixed batch of operations per invocation,
+ *       making the reported figures read as time per batch.
+ *
+ * \param test Currently executing test.
+ * \param label Name for this measurement in the status output.
+ * \param warmup Number of untimed priming invocations of \a run.
+ * \param iterations Number of timed invocations of \a run.
+ * \param run The operation being measured.
+ * \param data Opaque data passed to \a run.
+ *
+ * \retval 0 success
+ * \retval -1 failure; nothing was measured
+ */
+int ast_test_benchmark(struct ast_test *test, const char *label,
+	unsigned int warmup, unsigned int iterations,
+	void (*run)(void *data), void *data);
+
 
 /*!
  * \brief update test's status during testing.
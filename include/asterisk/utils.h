@@ -515,14 +515,21 @@ long int ast_random(void);
 #define ast_std_realloc realloc
 #define ast_std_free free
 
+/*!
+ * \brief Release memory obtained from the ast_malloc() family
+ *
+ * Goes through astmm so the per-module live heap counters stay correct.
+ */
+void __ast_free(void *ptr);
+
 /*!
  * \brief free() wrapper
  *
  * ast_free_ptr should be used when a function pointer for free() needs to be passed
  * as the argument to a function. Otherwise, astmm will cause seg faults.
  */
-#define ast_free free
-#define ast_free_ptr ast_free
+#define ast_free(a) __ast_free(a)
+#define ast_free_ptr __ast_free
 
 #if defined(AST_IN_CORE)
 #define MALLOC_FAILURE_MSG \
@@ -532,103 +539,20 @@ long int ast_random(void);
 	ast_log(LOG_ERROR, "Memory Allocation Failure in function %s at line %d of %s\n", func, lineno, file)
 #endif
 
-AST_INLINE_API(
-void * attribute_malloc __ast_malloc(size_t len, const char *file, int lineno, const char *func),
-{
-	void *p;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
-
-	if (!(p = malloc(len))) {
-		MALLOC_FAILURE_MSG;
-	}
-
-	return p;
-}
-)
-
-AST_INLINE_API(
-void * attribute_malloc __ast_calloc(size_t num, size_t len, const char *file, int lineno, const char *func),
-{
-	void *p;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
-
-	if (!(p = calloc(num, len))) {
-		MALLOC_FAILURE_MSG;
-	}
-
-	return p;
-}
-)
-
-AST_INLINE_API(
-void * attribute_malloc __ast_realloc(void *p, size_t len, const char *file, int lineno, const char *func),
-{
-	void *newp;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
-
-	if (!(newp = realloc(p, len))) {
-		MALLOC_FAILURE_MSG;
-	}
-
-	return newp;
-}
-)
-
-AST_INLINE_API(
-char * attribute_malloc __ast_strdup(const char *str, const char *file, int lineno, const char *func),
-{
-	char *newstr = NULL;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
-
-	if (str) {
-		if (!(newstr = strdup(str))) {
-			MALLOC_FAILURE_MSG;
-		}
-	}
-
-	return newstr;
-}
-)
-
-AST_INLINE_API(
-char * attribute_malloc __ast_strndup(const char *str, size_t len, const char *file, int lineno, const char *func),
-{
-	char *newstr = NULL;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
-
-	if (str) {
-		if (!(newstr = strndup(str, len))) {
-			MALLOC_FAILURE_MSG;
-		}
-	}
-
-	return newstr;
-}
-)
+/*
+ * The allocators live out of line in astmm.c so each allocation can be
+ * credited to its module's live heap counters.
+ */
+void * attribute_malloc __ast_malloc(size_t len, const char *file, int lineno, const char *func);
+void * attribute_malloc __ast_calloc(size_t num, size_t len, const char *file, int lineno, const char *func);
+void * attribute_malloc __ast_realloc(void *p, size_t len, const char *file, int lineno, const char *func);
+char * attribute_malloc __ast_strdup(const char *str, const char *file, int lineno, const char *func);
+char * attribute_malloc __ast_strndup(const char *str, size_t len, const char *file, int lineno, const char *func);
 
 int __attribute__((format(printf, 5, 6)))
 	__ast_asprintf(const char *file, int lineno, const char *func, char **ret, const char *fmt, ...);
-
-AST_INLINE_API(
-__attribute__((format(printf, 2, 0)))
-int __ast_vasprintf(char **ret, const char *fmt, va_list ap, const char *file, int lineno, const char *func),
-{
-	int res;
-
-	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, -1);
-
-	if ((res = vasprintf(ret, fmt, ap)) == -1) {
-		MALLOC_FAILURE_MSG;
-	}
-
-	return res;
-}
-)
+int __attribute__((format(printf, 2, 0)))
+	__ast_vasprintf(char **ret, const char *fmt, va_list ap, const char *file, int lineno, const char *func);
 
 #endif /* AST_DEBUG_MALLOC */
 
@@ -42,6 +42,10 @@ extern "C" {
 #define JB_TARGET_EXTRA 40
 	/*! ms between growing and shrinking; may not be honored if jitterbuffer runs out of space */
 #define JB_ADJUST_DELAY 40
+	/*! ms between shrink adjustments once we are over target by more than twice
+	 * target_extra; lets the delay left behind by a jitter spike drain quickly
+	 * once the spike has passed */
+#define JB_ADJUST_ACCEL_DELAY 125
 /*@} */
 
 enum jb_return_code {
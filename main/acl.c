@@ -217,6 +217,244 @@ static int get_local_address(struct ast_sockaddr *ourip)
 }
 #endif /* HAVE_GETIFADDRS */
 
+/*!
+ * \brief One node of a compiled host access rule trie.
+ *
+ * Each node represents one bit of address prefix.  A rule whose network
+ * prefix ends at this node leaves its list position and sense here;
+ * since rules later in the list override earlier ones, a lookup keeps
+ * the largest position seen along its path.
+ */
+struct ha_trie_node {
+	struct ha_trie_node *child[2];
+	/*! List position of the last rule ending at this node, or -1 for none. */
+	int rule;
+	/*! Sense of that rule. */
+	enum ast_acl_sense sense;
+};
+
+/*!
+ * \brief Compiled form of a host access rule list.
+ *
+ * A binary trie per address family, so matching costs at most one node
+ * per address bit no matter how many rules the list holds.
+ */
+struct ast_ha_trie {
+	struct ha_trie_node *v4;
+	struct ha_trie_node *v6;
+};
+
+/*!
+ * \internal
+ * \brief Get the network-order address bytes of a sockaddr.
+ *
+ * \param addr Address or netmask to examine.
+ * \param[out] len Set to the address length in bytes.
+ *
+ * \retval bytes on success.
+ * \retval NULL for an unsupported address family.
+ */
+static const unsigned char *ha_addr_bytes(const struct ast_sockaddr *addr, unsigned int *len)
+{
+	if (ast_sockaddr_is_ipv4(addr)) {
+		*len = 4;
+		return (const unsigned char *) &((const struct sockaddr_in *) &addr->ss)->sin_addr;
+	}
+	if (ast_sockaddr_is_ipv6(addr)) {
+		*len = 16;
+		return ((const struct sockaddr_in6 *) &addr->ss)->sin6_addr.s6_addr;
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Determine the prefix length of a netmask.
+ *
+ * \param netmask The netmask to examine.
+ *
+ * \retval prefix length in bits on success.
+ * \retval -1 if the netmask is not a contiguous run of high bits.
+ */
+static int ha_netmask_prefix_len(const struct ast_sockaddr *netmask)
+{
+	const unsigned char *bytes;
+	unsigned int len;
+	unsigned int i;
+	int prefix = 0;
+
+	bytes = ha_addr_bytes(netmask, &len);
+	if (!bytes) {
+		return -1;
+	}
+
+	for (i = 0; i < len && bytes[i] == 0xff; i++) {
+		prefix += 8;
+	}
+	if (i < len) {
+		unsigned char partial = bytes[i];
+
+		while (partial & 0x80) {
+			prefix++;
+			partial <<= 1;
+		}
+		if (partial) {
+			return -1;
+		}
+		for (++i; i < len; i++) {
+			if (bytes[i]) {
+				return -1;
+			}
+		}
+	}
+
+	return prefix;
+}
+
+static void ha_trie_node_free(struct ha_trie_node *node)
+{
+	if (!node) {
+		return;
+	}
+	ha_trie_node_free(node->child[0]);
+	ha_trie_node_free(node->child[1]);
+	ast_free(node);
+}
+
+static struct ast_ha_trie *ha_trie_free(struct ast_ha_trie *trie)
+{
+	if (trie) {
+		ha_trie_node_free(trie->v4);
+		ha_trie_node_free(trie->v6);
+		ast_free(trie);
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Record a rule's network prefix in a trie.
+ *
+ * \retval 0 on success.
+ * \retval -1 on allocation failure.
+ */
+static int ha_trie_insert(struct ha_trie_node **root, const unsigned char *key,
+	int prefix_len, int rule, enum ast_acl_sense sense)
+{
+	struct ha_trie_node **slot = root;
+	struct ha_trie_node *node;
+	int bit;
+
+	for (bit = 0;; bit++) {
+		node = *slot;
+		if (!node) {
+			node = ast_calloc(1, sizeof(*node));
+			if (!node) {
+				return -1;
+			}
+			node->rule = -1;
+			*slot = node;
+		}
+		if (bit == prefix_len) {
+			break;
+		}
+		slot = &node->child[(key[bit / 8] >> (7 - bit % 8)) & 1];
+	}
+
+	/* Rules are inserted in list order, so a later rule simply wins the node. */
+	node->rule = rule;
+	node->sense = sense;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Compile a host access rule list into a trie.
+ *
+ * \param ha The head of the list of host access rules to compile.
+ *
+ * \retval trie on success.
+ * \retval NULL if the list is empty or holds a rule the trie cannot
+ * represent (a non-contiguous netmask); callers fall back to the
+ * linear walk of ast_apply_ha().
+ */
+static struct ast_ha_trie *ha_trie_compile(const struct ast_ha *ha)
+{
+	struct ast_ha_trie *trie;
+	const struct ast_ha *current;
+	int rule = 0;
+
+	if (!ha) {
+		return NULL;
+	}
+
+	trie = ast_calloc(1, sizeof(*trie));
+	if (!trie) {
+		return NULL;
+	}
+
+	for (current = ha; current; current = current->next, rule++) {
+		const unsigned char *key;
+		unsigned int len;
+		int prefix_len;
+
+		prefix_len = ha_netmask_prefix_len(&current->netmask);
+		key = ha_addr_bytes(&current->addr, &len);
+		if (prefix_len < 0 || !key
+			|| ha_trie_insert(len == 4 ? &trie->v4 : &trie->v6, key, prefix_len,
+				rule, current->sense)) {
+			return ha_trie_free(trie);
+		}
+	}
+
+	return trie;
+}
+
+/*!
+ * \internal
+ * \brief Match an address against a compiled host access rule trie.
+ *
+ * Walks at most one trie node per address bit and returns the sense of
+ * the matching rule latest in the original list, mirroring the
+ * last-match-wins behavior of ast_apply_ha().
+ */
+static enum ast_acl_sense ha_trie_apply(const struct ast_ha_trie *trie, const struct ast_sockaddr *addr)
+{
+	struct ast_sockaddr mapped_addr;
+	const struct ha_trie_node *node;
+	const unsigned char *key;
+	unsigned int len;
+	unsigned int bit;
+	enum ast_acl_sense sense = AST_SENSE_ALLOW;
+	int best = -1;
+
+	if (ast_sockaddr_is_ipv6(addr) && ast_sockaddr_is_ipv4_mapped(addr)
+		&& ast_sockaddr_ipv4_mapped(addr, &mapped_addr)) {
+		/* IPv4 rules apply to IPv4-mapped addresses */
+		addr = &mapped_addr;
+	}
+
+	key = ha_addr_bytes(addr, &len);
+	if (!key) {
+		return AST_SENSE_ALLOW;
+	}
+
+	node = len == 4 ? trie->v4 : trie->v6;
+	for (bit = 0; node; bit++) {
+		if (best < node->rule) {
+			best = node->rule;
+			sense = node->sense;
+		}
+		if (8 * len <= bit) {
+			break;
+		}
+		node = node->child[(key[bit / 8] >> (7 - bit % 8)) & 1];
+	}
+
+	return sense;
+}
+
 /* Free HA structure */
 void ast_free_ha(struct ast_ha *ha)
 {
@@ -240,6 +478,7 @@ struct ast_acl_list *ast_free_acl_list(struct ast_acl_list *acl_list)
 	AST_LIST_LOCK(acl_list);
 	while ((current = AST_LIST_REMOVE_HEAD(acl_list, list))) {
 		ast_free_ha(current->acl);
+		ha_trie_free(current->trie);
 		ast_free(current);
 	}
 	AST_LIST_UNLOCK(acl_list);
@@ -459,6 +698,10 @@ void ast_append_acl(const char *sense, const char *stuff, struct ast_acl_list **
 		/* With the proper ACL set for modification, we can just pass this off to the ast_ha append function. */
 		acl->acl = ast_append_ha(sense, stuff, acl->acl, error);
 
+		/* The rules changed, so any compiled form is stale. */
+		acl->trie = ha_trie_free(acl->trie);
+		acl->trie_checked = 0;
+
 		AST_LIST_UNLOCK(working_list);
 		return;
 	}
@@ -709,7 +952,21 @@ enum ast_acl_sense ast_apply_acl(struct ast_acl_list *acl_list, const struct ast
 		}
 
 		if (acl->acl) {
-			if (ast_apply_ha(acl->acl, addr) == AST_SENSE_DENY) {
+			enum ast_acl_sense sense;
+
+			if (!acl->trie_checked) {
+				/*
+				 * Compile on first use.  We hold the list lock, as does
+				 * ast_append_acl() when it invalidates the compiled form,
+				 * so the rules cannot change underneath us.
+				 */
+				acl->trie = ha_trie_compile(acl->acl);
+				acl->trie_checked = 1;
+			}
+			sense = acl->trie
+				? ha_trie_apply(acl->trie, addr)
+				: ast_apply_ha(acl->acl, addr);
+			if (sense == AST_SENSE_DENY) {
 				ast_log(LOG_NOTICE, "%sRejecting '%s' due to a failure to pass ACL '%s'\n", purpose ? purpose : "", ast_sockaddr_stringify_addr(addr),
 						ast_strlen_zero(acl->name) ? "(BASELINE)" : acl->name);
 				AST_LIST_UNLOCK(acl_list);
@@ -255,6 +255,12 @@ enum ast_getdata_result ast_app_getdata(struct ast_channel *c, const char *promp
 
 	filename = ast_strdupa(prompt);
 	while ((front = strsep(&filename, "&"))) {
+		if (!ast_strlen_zero(filename)) {
+			/* Pull the next prompt in while this one plays */
+			char *next = ast_strdupa(filename);
+
+			ast_stream_prefetch(strsep(&next, "&"), ast_channel_language(c));
+		}
 		if (!ast_strlen_zero(front)) {
 			res = ast_streamfile(c, front, ast_channel_language(c));
 			if (res)
@@ -1945,6 +1951,109 @@ int ast_app_group_split_group(const char *data, char *group, int group_max, char
 	return res;
 }
 
+/*!
+ * Per (group,category) assignment counters.
+ *
+ * GROUP_COUNT() is evaluated on every call setup when dialplans
+ * implement concurrency caps, and walking the assignment list makes
+ * that linear in the number of active assignments.  These counters are
+ * kept in step with the list at assignment and release time so
+ * ast_app_group_get_count() is a single hash lookup.  The list itself
+ * remains the authority for regex matching and "group show channels".
+ *
+ * Each assignment bumps the (group, "") counter; one with a category
+ * additionally bumps (group, category).  All updates happen under the
+ * groups list wrlock, so counter creation and removal are serialized.
+ */
+#define GROUP_COUNT_BUCKETS 53
+
+struct group_count {
+	int count;
+	/*! Composite "group\x01category" key; the separator cannot appear in either part */
+	char key[0];
+};
+
+static struct ao2_container *group_counts;
+
+static int group_count_hash(const void *obj, const int flags)
+{
+	const struct group_count *gc;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ast_str_case_hash(obj);
+	case OBJ_SEARCH_OBJECT:
+	default:
+		gc = obj;
+		return ast_str_case_hash(gc->key);
+	}
+}
+
+static int group_count_cmp(void *obj, void *arg, int flags)
+{
+	const struct group_count *left = obj;
+	const struct group_count *right = arg;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		return strcasecmp(left->key, right_key) ? 0 : CMP_MATCH;
+	default:
+		return 0;
+	}
+}
+
+static void group_count_build_key(char *key, size_t key_size, const char *group, const char *category)
+{
+	snprintf(key, key_size, "%s\x01%s", group, S_OR(category, ""));
+}
+
+/*! \brief Adjust one (group,category) counter; must hold the groups wrlock */
+static void group_count_adjust(const char *group, const char *category, int delta)
+{
+	char key[180];
+	struct group_count *gc;
+
+	if (!group_counts) {
+		return;
+	}
+
+	group_count_build_key(key, sizeof(key), group, category);
+	gc = ao2_find(group_counts, key, OBJ_SEARCH_KEY);
+	if (!gc) {
+		if (delta <= 0) {
+			/* A release for a counter we never saw; nothing to do. */
+			return;
+		}
+		gc = ao2_alloc(sizeof(*gc) + strlen(key) + 1, NULL);
+		if (!gc) {
+			return;
+		}
+		strcpy(gc->key, key);/* Safe */
+		ao2_link(group_counts, gc);
+	}
+	if (ast_atomic_fetchadd_int(&gc->count, delta) + delta <= 0) {
+		ao2_unlink(group_counts, gc);
+	}
+	ao2_ref(gc, -1);
+}
+
+/*! \brief Count one assignment in or out; must hold the groups wrlock */
+static void group_count_assignment(const char *group, const char *category, int delta)
+{
+	if (ast_strlen_zero(group)) {
+		return;
+	}
+
+	group_count_adjust(group, "", delta);
+	if (!ast_strlen_zero(category)) {
+		group_count_adjust(group, category, delta);
+	}
+}
+
 int ast_app_group_set_channel(struct ast_channel *chan, const char *data)
 {
 	int res = 0;
@@ -1966,6 +2075,7 @@ int ast_app_group_set_channel(struct ast_channel *chan, const char *data)
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&groups, gi, group_list) {
 		if ((gi->chan == chan) && ((ast_strlen_zero(category) && ast_strlen_zero(gi->category)) || (!ast_strlen_zero(gi->category) && !strcasecmp(gi->category, category)))) {
 			AST_RWLIST_REMOVE_CURRENT(group_list);
+			group_count_assignment(gi->group, gi->category, -1);
 			ast_free(gi);
 			break;
 		}
@@ -1983,6 +2093,7 @@ int ast_app_group_set_channel(struct ast_channel *chan, const char *data)
 			strcpy(gi->category, category);
 		}
 		AST_RWLIST_INSERT_TAIL(&groups, gi, group_list);
+		group_count_assignment(group, category, +1);
 	} else {
 		res = -1;
 	}
@@ -1994,20 +2105,20 @@ int ast_app_group_set_channel(struct ast_channel *chan, const char *data)
 
 int ast_app_group_get_count(const char *group, const char *category)
 {
-	struct ast_group_info *gi = NULL;
+	char key[180];
+	struct group_count *gc;
 	int count = 0;
 
-	if (ast_strlen_zero(group)) {
+	if (ast_strlen_zero(group) || !group_counts) {
 		return 0;
 	}
 
-	AST_RWLIST_RDLOCK(&groups);
-	AST_RWLIST_TRAVERSE(&groups, gi, group_list) {
-		if (!strcasecmp(gi->group, group) && (ast_strlen_zero(category) || (!ast_strlen_zero(gi->category) && !strcasecmp(gi->category, category)))) {
-			count++;
-		}
+	group_count_build_key(key, sizeof(key), group, category);
+	gc = ao2_find(group_counts, key, OBJ_SEARCH_KEY);
+	if (gc) {
+		count = gc->count;
+		ao2_ref(gc, -1);
 	}
-	AST_RWLIST_UNLOCK(&groups);
 
 	return count;
 }
@@ -2062,6 +2173,7 @@ int ast_app_group_update(struct ast_channel *old, struct ast_channel *new)
 			gi->chan = new;
 		} else if (gi->chan == new) {
 			AST_RWLIST_REMOVE_CURRENT(group_list);
+			group_count_assignment(gi->group, gi->category, -1);
 			ast_free(gi);
 		}
 	}
@@ -2079,6 +2191,7 @@ int ast_app_group_discard(struct ast_channel *chan)
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&groups, gi, group_list) {
 		if (gi->chan == chan) {
 			AST_RWLIST_REMOVE_CURRENT(group_list);
+			group_count_assignment(gi->group, gi->category, -1);
 			ast_free(gi);
 		}
 	}
@@ -3348,6 +3461,8 @@ struct stasis_topic *ast_queue_topic(const char *queuename)
 
 static void app_cleanup(void)
 {
+	ao2_cleanup(group_counts);
+	group_counts = NULL;
 	ao2_cleanup(queue_topic_pool);
 	queue_topic_pool = NULL;
 	ao2_cleanup(queue_topic_all);
@@ -3367,6 +3482,11 @@ int app_init(void)
 {
 	ast_register_cleanup(app_cleanup);
 
+	group_counts = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		GROUP_COUNT_BUCKETS, group_count_hash, NULL, group_count_cmp);
+	if (!group_counts) {
+		return -1;
+	}
 	if (STASIS_MESSAGE_TYPE_INIT(ast_mwi_state_type) != 0) {
 		return -1;
 	}
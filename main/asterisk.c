@@ -338,6 +338,9 @@ unsigned int option_dtmfminduration;		/*!< Minimum duration of DTMF. */
 long option_minmemfree;				/*!< Minimum amount of free system memory - stop accepting calls if free memory falls below this watermark */
 #endif
 unsigned int ast_option_rtpptdynamic;
+unsigned int ast_option_statcache_ms;		/*!< How long sound file stat() results may be cached */
+unsigned int ast_option_mmapcache;		/*!< MB of sound file data kept mapped in memory for shared playback */
+unsigned int ast_option_recwritebehind;		/*!< KB of recorded audio each stream may queue for background writing */
 
 /*! @} */
 
@@ -2092,6 +2095,9 @@ static void really_quit(int num, shutdown_nice_t niceness, int restart)
 		for (i = 3; i < 32768; i++) {
 			fcntl(i, F_SETFD, FD_CLOEXEC);
 		}
+		/* ... except bound listeners, which the replacement process
+		   inherits so it stays reachable while it boots. */
+		ast_listener_handoff_prepare();
 		ast_verb(0, "Asterisk is now restarting...\n");
 		restartnow = 1;
 
@@ -3499,6 +3505,9 @@ static void ast_readconfig(void)
 	/* Set default value */
 	option_dtmfminduration = AST_MIN_DTMF_DURATION;
 	ast_option_rtpptdynamic = 35;
+	ast_option_statcache_ms = 0;
+	ast_option_mmapcache = 0;
+	ast_option_recwritebehind = 0;
 
 	/* init with buildtime config */
 	ast_copy_string(cfg_paths.config_dir, DEFAULT_CONFIG_DIR, sizeof(cfg_paths.config_dir));
@@ -3654,6 +3663,21 @@ static void ast_readconfig(void)
 			if (sscanf(v->value, "%30u", &option_dtmfminduration) != 1) {
 				option_dtmfminduration = AST_MIN_DTMF_DURATION;
 			}
+		/* How long (ms) sound file stat() results may be served from cache */
+		} else if (!strcasecmp(v->name, "sound_stat_cache")) {
+			if (sscanf(v->value, "%30u", &ast_option_statcache_ms) != 1) {
+				ast_option_statcache_ms = 0;
+			}
+		/* How many MB of sound file data to keep mapped in memory */
+		} else if (!strcasecmp(v->name, "sound_mmap_cache")) {
+			if (sscanf(v->value, "%30u", &ast_option_mmapcache) != 1) {
+				ast_option_mmapcache = 0;
+			}
+		/* How many KB of recorded audio each stream may queue for background writing */
+		} else if (!strcasecmp(v->name, "record_write_behind")) {
+			if (sscanf(v->value, "%30u", &ast_option_recwritebehind) != 1) {
+				ast_option_recwritebehind = 0;
+			}
 		/* http://www.iana.org/assignments/rtp-parameters
 		 * RTP dynamic payload types start at 96 normally; extend down to 0 */
 		} else if (!strcasecmp(v->name, "rtp_pt_dynamic")) {
@@ -4585,10 +4609,16 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	ast_set_flag(&ast_options, AST_OPT_FLAG_FULLY_BOOTED);
 	publish_fully_booted();
 
+	/* Anything inherited across a restart that no module claimed by now
+	   belongs to a listener that is no longer configured. */
+	ast_listener_handoff_complete();
+
 	pthread_sigmask(SIG_UNBLOCK, &sigs, NULL);
 
 #if defined(__AST_DEBUG_MALLOC)
 	__ast_mm_init_phase_2();
+#else
+	__ast_mm_summary_init();
 #endif	/* defined(__AST_DEBUG_MALLOC) */
 
 	ast_cli_register_multiple(cli_asterisk_shutdown, ARRAY_LEN(cli_asterisk_shutdown));
@@ -1558,4 +1558,509 @@ void __ast_mm_init_phase_2(void)
 	ast_register_cleanup(mm_atexit_ast);
 }
 
+#else	/* !defined(__AST_DEBUG_MALLOC) */
+
+/*
+ * Lightweight always-on per-module live heap accounting
+ *
+ * Without MALLOC_DEBUG there is no regions hash and no global lock.
+ * Every wrapped allocation is prefixed with a small header carrying the
+ * allocation size and a pointer to the per-file counters, so the free
+ * and realloc paths know exactly what to credit without any lookup.
+ * Counter updates are batched in a per-thread cache and folded into the
+ * global counters every MM_FLUSH_OPS operations or MM_FLUSH_BYTES
+ * bytes, so the summary lags each thread by at most one batch.
+ *
+ * The compatibility envelope is the same as MALLOC_DEBUG: memory
+ * obtained from ast_malloc() and friends must be released with
+ * ast_free(), never with raw free(), and everything handed to
+ * ast_free() must have come from a wrapper.  That includes
+ * ast_asprintf()/ast_vasprintf(), which allocate through the same
+ * header-carrying path here rather than through raw vasprintf().
+ */
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "asterisk/cli.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
+#include "asterisk/_private.h"
+
+/* The accounting locks are intentionally raw pthread mutexes:  they must
+ * not recurse back into the wrappers they serve. */
+#undef pthread_mutex_t
+#undef pthread_mutex_lock
+#undef pthread_mutex_unlock
+
+/*! \brief Distinct modules tracked in one thread's delta cache */
+#define MM_THREAD_SLOTS 32
+
+/*! \brief Fold a slot into the global counters after this many operations */
+#define MM_FLUSH_OPS 64
+
+/*! \brief ... or when this many bytes have accumulated in it */
+#define MM_FLUSH_BYTES 65536
+
+/*! \brief Live counters for one allocating file */
+struct mm_file_stats {
+	struct mm_file_stats *next;
+	/*! __FILE__ literal of the allocating module */
+	const char *file;
+	int64_t live_bytes;
+	int64_t live_allocs;
+	uint64_t total_allocs;
+};
+
+/*!
+ * \brief Maps a __FILE__ literal pointer to its counters.
+ *
+ * The same file name reaches us through different literal pointers when
+ * allocations are made from inline functions in headers, so several
+ * keys may share one mm_file_stats.
+ */
+struct mm_file_key {
+	struct mm_file_key *next;
+	const char *file;
+	struct mm_file_stats *stats;
+};
+
+#define MM_FILE_HASH 61
+
+static struct mm_file_key *mm_file_keys[MM_FILE_HASH];
+static struct mm_file_stats *mm_file_stats_list;
+/*! \brief Guards the registry and the global counters; intentionally not an ast_mutex_t */
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! \brief Header prefixed to every tracked allocation */
+struct mm_hdr {
+	struct mm_file_stats *stats;
+	size_t size;
+} __attribute__((aligned(2 * sizeof(size_t))));
+
+struct mm_thread_cache {
+	struct {
+		struct mm_file_stats *stats;
+		int64_t bytes;
+		int32_t allocs;
+		/*! New allocations to add to total_allocs */
+		uint32_t news;
+		/*! Operations batched since the last flush */
+		uint32_t ops;
+	} slots[MM_THREAD_SLOTS];
+};
+
+static pthread_key_t mm_thread_key;
+static pthread_once_t mm_thread_once = PTHREAD_ONCE_INIT;
+static int mm_thread_key_ok;
+
+/*! \brief Sentinel stored while a thread's cache allocation is in flight */
+#define MM_CACHE_PENDING ((struct mm_thread_cache *) 1)
+
+static struct mm_file_stats *mm_file_stats_get(const char *file)
+{
+	unsigned int bucket = (unsigned int) ((uintptr_t) file >> 4) % MM_FILE_HASH;
+	struct mm_file_key *key;
+	struct mm_file_stats *stats;
+
+	/* Keys are only ever inserted at the head of a bucket and never
+	 * removed, so the chains are safe to walk without the lock.  A
+	 * racing reader that misses a just published key simply takes the
+	 * locked path below. */
+	for (key = mm_file_keys[bucket]; key; key = key->next) {
+		if (key->file == file) {
+			return key->stats;
+		}
+	}
+
+	pthread_mutex_lock(&mm_lock);
+	for (key = mm_file_keys[bucket]; key; key = key->next) {
+		if (key->file == file) {
+			pthread_mutex_unlock(&mm_lock);
+			return key->stats;
+		}
+	}
+	for (stats = mm_file_stats_list; stats; stats = stats->next) {
+		if (!strcmp(stats->file, file)) {
+			break;
+		}
+	}
+	if (!stats) {
+		stats = ast_std_calloc(1, sizeof(*stats));
+		if (!stats) {
+			pthread_mutex_unlock(&mm_lock);
+			return NULL;
+		}
+		stats->file = file;
+		stats->next = mm_file_stats_list;
+		mm_file_stats_list = stats;
+	}
+	key = ast_std_calloc(1, sizeof(*key));
+	if (key) {
+		key->file = file;
+		key->stats = stats;
+		key->next = mm_file_keys[bucket];
+		/* Publish the fully built key before hooking it into the
+		 * chain that lockless readers walk. */
+		__sync_synchronize();
+		mm_file_keys[bucket] = key;
+	}
+	pthread_mutex_unlock(&mm_lock);
+
+	return stats;
+}
+
+static void mm_flush_slot(struct mm_thread_cache *cache, unsigned int idx)
+{
+	pthread_mutex_lock(&mm_lock);
+	cache->slots[idx].stats->live_bytes += cache->slots[idx].bytes;
+	cache->slots[idx].stats->live_allocs += cache->slots[idx].allocs;
+	cache->slots[idx].stats->total_allocs += cache->slots[idx].news;
+	pthread_mutex_unlock(&mm_lock);
+
+	cache->slots[idx].bytes = 0;
+	cache->slots[idx].allocs = 0;
+	cache->slots[idx].news = 0;
+	cache->slots[idx].ops = 0;
+}
+
+static void mm_thread_cache_destroy(void *data)
+{
+	struct mm_thread_cache *cache = data;
+	unsigned int i;
+
+	if (cache == MM_CACHE_PENDING) {
+		return;
+	}
+
+	for (i = 0; i < MM_THREAD_SLOTS; i++) {
+		if (cache->slots[i].stats && cache->slots[i].ops) {
+			mm_flush_slot(cache, i);
+		}
+	}
+	ast_std_free(cache);
+}
+
+static void mm_thread_key_init(void)
+{
+	mm_thread_key_ok = !pthread_key_create(&mm_thread_key, mm_thread_cache_destroy);
+}
+
+static struct mm_thread_cache *mm_thread_cache_get(void)
+{
+	struct mm_thread_cache *cache;
+
+	if (pthread_once(&mm_thread_once, mm_thread_key_init) || !mm_thread_key_ok) {
+		return NULL;
+	}
+	cache = pthread_getspecific(mm_thread_key);
+	if (cache == MM_CACHE_PENDING) {
+		return NULL;
+	}
+	if (cache) {
+		return cache;
+	}
+
+	/* Park a sentinel so the allocation below cannot recurse into us. */
+	pthread_setspecific(mm_thread_key, MM_CACHE_PENDING);
+	cache = ast_std_calloc(1, sizeof(*cache));
+	pthread_setspecific(mm_thread_key, cache);
+
+	return cache;
+}
+
+/*!
+ * \internal
+ * \brief Credit an allocation (+1), free (-1) or resize (0) to a module.
+ */
+static void mm_account(struct mm_file_stats *stats, int64_t bytes, int allocs)
+{
+	struct mm_thread_cache *cache = mm_thread_cache_get();
+	unsigned int idx;
+
+	if (!cache) {
+		pthread_mutex_lock(&mm_lock);
+		stats->live_bytes += bytes;
+		stats->live_allocs += allocs;
+		if (allocs > 0) {
+			stats->total_allocs++;
+		}
+		pthread_mutex_unlock(&mm_lock);
+		return;
+	}
+
+	idx = (unsigned int) ((uintptr_t) stats >> 5) % MM_THREAD_SLOTS;
+	if (cache->slots[idx].stats != stats) {
+		if (cache->slots[idx].stats && cache->slots[idx].ops) {
+			mm_flush_slot(cache, idx);
+		}
+		cache->slots[idx].stats = stats;
+	}
+	cache->slots[idx].bytes += bytes;
+	cache->slots[idx].allocs += allocs;
+	if (allocs > 0) {
+		cache->slots[idx].news++;
+	}
+	if (++cache->slots[idx].ops >= MM_FLUSH_OPS
+		|| cache->slots[idx].bytes >= MM_FLUSH_BYTES
+		|| cache->slots[idx].bytes <= -MM_FLUSH_BYTES) {
+		mm_flush_slot(cache, idx);
+	}
+}
+
+static void *mm_alloc(size_t size, const char *file, int use_calloc)
+{
+	struct mm_hdr *hdr;
+
+	hdr = use_calloc ? calloc(1, size + sizeof(*hdr)) : malloc(size + sizeof(*hdr));
+	if (!hdr) {
+		return NULL;
+	}
+	hdr->stats = mm_file_stats_get(file);
+	hdr->size = size;
+	if (hdr->stats) {
+		mm_account(hdr->stats, size, 1);
+	}
+
+	return hdr + 1;
+}
+
+void *__ast_malloc(size_t size, const char *file, int lineno, const char *func)
+{
+	void *p;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (!(p = mm_alloc(size, file, 0))) {
+		MALLOC_FAILURE_MSG;
+	}
+
+	return p;
+}
+
+void *__ast_calloc(size_t nmemb, size_t size, const char *file, int lineno, const char *func)
+{
+	void *p;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (nmemb && size > SIZE_MAX / nmemb) {
+		errno = ENOMEM;
+		p = NULL;
+	} else {
+		p = mm_alloc(nmemb * size, file, 1);
+	}
+	if (!p) {
+		MALLOC_FAILURE_MSG;
+	}
+
+	return p;
+}
+
+void __ast_free(void *ptr)
+{
+	struct mm_hdr *hdr;
+
+	if (!ptr) {
+		return;
+	}
+	hdr = (struct mm_hdr *) ptr - 1;
+	if (hdr->stats) {
+		mm_account(hdr->stats, -(int64_t) hdr->size, -1);
+	}
+	free(hdr);
+}
+
+void *__ast_realloc(void *ptr, size_t size, const char *file, int lineno, const char *func)
+{
+	struct mm_hdr *hdr;
+	struct mm_hdr *newhdr;
+	void *p;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (!ptr) {
+		if (!(p = mm_alloc(size, file, 0))) {
+			MALLOC_FAILURE_MSG;
+			return NULL;
+		}
+		return p;
+	}
+
+	if (!size) {
+		__ast_free(ptr);
+		return NULL;
+	}
+
+	hdr = (struct mm_hdr *) ptr - 1;
+	newhdr = realloc(hdr, size + sizeof(*hdr));
+	if (!newhdr) {
+		MALLOC_FAILURE_MSG;
+		return NULL;
+	}
+	if (newhdr->stats) {
+		mm_account(newhdr->stats, (int64_t) size - (int64_t) newhdr->size, 0);
+	}
+	newhdr->size = size;
+
+	return newhdr + 1;
+}
+
+char *__ast_strdup(const char *s, const char *file, int lineno, const char *func)
+{
+	size_t len;
+	char *p = NULL;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (s) {
+		len = strlen(s) + 1;
+		if ((p = mm_alloc(len, file, 0))) {
+			memcpy(p, s, len);
+		} else {
+			MALLOC_FAILURE_MSG;
+		}
+	}
+
+	return p;
+}
+
+char *__ast_strndup(const char *s, size_t n, const char *file, int lineno, const char *func)
+{
+	size_t len;
+	char *p = NULL;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, NULL);
+
+	if (s) {
+		len = strnlen(s, n);
+		if ((p = mm_alloc(len + 1, file, 0))) {
+			memcpy(p, s, len);
+			p[len] = '\0';
+		} else {
+			MALLOC_FAILURE_MSG;
+		}
+	}
+
+	return p;
+}
+
+int __ast_vasprintf(char **strp, const char *fmt, va_list ap, const char *file, int lineno, const char *func)
+{
+	int size;
+	va_list ap2;
+	char s;
+
+	DEBUG_CHAOS_RETURN(DEBUG_CHAOS_ALLOC_CHANCE, -1);
+
+	*strp = NULL;
+	va_copy(ap2, ap);
+	size = vsnprintf(&s, 1, fmt, ap2);
+	va_end(ap2);
+	if (!(*strp = mm_alloc(size + 1, file, 0))) {
+		MALLOC_FAILURE_MSG;
+		return -1;
+	}
+	vsnprintf(*strp, size + 1, fmt, ap);
+
+	return size;
+}
+
+int __ast_asprintf(const char *file, int lineno, const char *func, char **strp, const char *fmt, ...)
+{
+	int size;
+	va_list ap;
+
+	va_start(ap, fmt);
+	size = __ast_vasprintf(strp, fmt, ap, file, lineno, func);
+	va_end(ap);
+
+	return size;
+}
+
+static int mm_stats_cmp(const void *a, const void *b)
+{
+	const struct mm_file_stats *left = *(const struct mm_file_stats * const *) a;
+	const struct mm_file_stats *right = *(const struct mm_file_stats * const *) b;
+
+	/* Largest live footprint first */
+	if (left->live_bytes < right->live_bytes) {
+		return 1;
+	}
+	if (left->live_bytes > right->live_bytes) {
+		return -1;
+	}
+	return 0;
+}
+
+static char *handle_memory_show_summary(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct mm_file_stats *stats;
+	struct mm_file_stats **sorted;
+	struct mm_file_stats *snapshot;
+	unsigned int count = 0;
+	unsigned int i;
+	int64_t total_bytes = 0;
+	int64_t total_allocs = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "memory show summary";
+		e->usage =
+			"Usage: memory show summary\n"
+			"       Summarizes live heap allocations by allocating file.\n"
+			"       Counters are batched per thread, so each module may lag\n"
+			"       its true value by a small number of recent operations.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	pthread_mutex_lock(&mm_lock);
+	for (stats = mm_file_stats_list; stats; stats = stats->next) {
+		count++;
+	}
+	sorted = ast_std_calloc(count ? count : 1, sizeof(*sorted));
+	snapshot = ast_std_calloc(count ? count : 1, sizeof(*snapshot));
+	if (!sorted || !snapshot) {
+		pthread_mutex_unlock(&mm_lock);
+		ast_std_free(sorted);
+		ast_std_free(snapshot);
+		return CLI_FAILURE;
+	}
+	for (stats = mm_file_stats_list, i = 0; stats; stats = stats->next, i++) {
+		snapshot[i] = *stats;
+		sorted[i] = &snapshot[i];
+	}
+	pthread_mutex_unlock(&mm_lock);
+
+	qsort(sorted, count, sizeof(*sorted), mm_stats_cmp);
+
+	ast_cli(a->fd, "%16s %14s %14s  %s\n",
+		"live bytes", "live allocs", "total allocs", "file");
+	for (i = 0; i < count; i++) {
+		ast_cli(a->fd, "%16" PRId64 " %14" PRId64 " %14" PRIu64 "  %s\n",
+			sorted[i]->live_bytes, sorted[i]->live_allocs,
+			sorted[i]->total_allocs, sorted[i]->file);
+		total_bytes += sorted[i]->live_bytes;
+		total_allocs += sorted[i]->live_allocs;
+	}
+	ast_cli(a->fd, "%16" PRId64 " %14" PRId64 " %14s  in %u files\n",
+		total_bytes, total_allocs, "", count);
+
+	ast_std_free(sorted);
+	ast_std_free(snapshot);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_memory[] = {
+	AST_CLI_DEFINE(handle_memory_show_summary, "Summarize live memory allocations by file"),
+};
+
+void __ast_mm_summary_init(void)
+{
+	ast_cli_register_multiple(cli_memory, ARRAY_LEN(cli_memory));
+}
+
 #endif	/* defined(__AST_DEBUG_MALLOC) */
@@ -28,6 +28,7 @@
 #include "asterisk.h"
 
 #include "asterisk/_private.h"
+#define AST_API_MODULE		/* ensure that inlinable API functions will be built in this module if required */
 #include "asterisk/astobj2.h"
 #include "astobj2_private.h"
 #include "astobj2_container_private.h"
@@ -40,41 +41,14 @@
 static FILE *ref_log;
 
 /*!
- * astobj2 objects are always preceded by this data structure,
- * which contains a reference counter,
- * option flags and a pointer to a destructor.
- * The refcount is used to decide when it is time to
- * invoke the destructor.
- * The magic number is used for consistency check.
+ * Non-zero while runtime reference debugging is writing to ref_log.
+ * Read by the inline ao2_ref() fast path to know when reference bumps
+ * must take the full, logged path through __ao2_ref().
  */
-struct __priv_data {
-	int ref_counter;
-	ao2_destructor_fn destructor_fn;
-	/*! This field is used for astobj2 and ao2_weakproxy objects to reference each other */
-	void *weakptr;
-#if defined(AO2_DEBUG)
-	/*! User data size for stats */
-	size_t data_size;
-#endif
-	/*! The ao2 object option flags */
-	uint32_t options;
-	/*! magic number.  This is used to verify that a pointer passed in is a
-	 *  valid astobj2 or ao2_weak reference */
-	uint32_t magic;
-};
+int ao2_ref_log_active;
 
-#define	AO2_MAGIC	0xa570b123
-#define	AO2_WEAK	0xa570b122
-#define IS_AO2_MAGIC_BAD(p) (AO2_MAGIC != (p->priv_data.magic | 1))
-
-/*!
- * What an astobj2 object looks like: fixed-size private data
- * followed by variable-size user data.
- */
-struct astobj2 {
-	struct __priv_data priv_data;
-	void *user_data[0];
-};
+/* The layout of struct __priv_data and struct astobj2 lives in
+ * astobj2.h so the ao2_ref() increment fast path can be inlined. */
 
 struct ao2_weakproxy_notification {
 	ao2_weakproxy_notification_cb cb;
@@ -133,7 +107,7 @@ struct ao2_stats ao2;
 	((struct astobj2_lockobj *) (((char *) (user_data)) - sizeof(struct astobj2_lockobj)))
 
 #define INTERNAL_OBJ(user_data) \
-	(struct astobj2 *) ((char *) user_data - sizeof(struct astobj2))
+	AO2_INTERNAL_OBJ(user_data)
 
 /*!
  * \brief convert from a pointer _p to a user-defined object
@@ -1183,6 +1157,7 @@ static void astobj2_cleanup(void)
 #endif
 
 	if (ast_opt_ref_debug) {
+		ao2_ref_log_active = 0;
 		fclose(ref_log);
 		ref_log = NULL;
 	}
@@ -1197,6 +1172,8 @@ int astobj2_init(void)
 		ref_log = fopen(ref_filename, "w");
 		if (!ref_log) {
 			ast_log(LOG_ERROR, "Could not open ref debug log file: %s\n", ref_filename);
+		} else {
+			ao2_ref_log_active = 1;
 		}
 	}
 
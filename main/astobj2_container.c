@@ -22,11 +22,14 @@
 
 #include "asterisk.h"
 
+#include <sched.h>
+
 #include "asterisk/_private.h"
 #include "asterisk/astobj2.h"
 #include "astobj2_private.h"
 #include "astobj2_container_private.h"
 #include "asterisk/cli.h"
+#include "asterisk/utils.h"
 
 /*!
  * return the number of elements in the container
@@ -36,6 +39,96 @@ int ao2_container_count(struct ao2_container *c)
 	return ast_atomic_fetchadd_int(&c->elements, 0);
 }
 
+/*! Number of sharded reader epoch counters per read-mostly container. */
+#define AO2_READER_SLOTS	32
+
+/*!
+ * \brief Reader epoch state of a read-mostly container.
+ *
+ * \details Each reader picks a slot from its thread id and bumps
+ * that slot's counter for the duration of a find or read-only
+ * callback traversal.  The slots are padded to separate cache
+ * lines so concurrent readers do not false-share.  A writer sets
+ * write_pending under the container write lock and spins until
+ * every slot drains; readers arriving while write_pending is set
+ * take the container read lock instead and block on the writer.
+ */
+struct ao2_container_readers {
+	struct {
+		/*! Number of readers currently in the epoch on this slot. */
+		int entries;
+		/*! Padding to keep each slot on its own cache line. */
+		char pad[64 - sizeof(int)];
+	} slot[AO2_READER_SLOTS];
+	/*! Nonzero while a writer is draining or modifying the container. */
+	int write_pending;
+};
+
+int container_readers_init(struct ao2_container *self)
+{
+	self->readers = ast_calloc(1, sizeof(*self->readers));
+	return self->readers ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Map the running thread to a reader epoch slot.
+ */
+static int container_reader_slot(void)
+{
+	return (int) (((uintptr_t) pthread_self() >> 9) % AO2_READER_SLOTS);
+}
+
+int container_read_enter(struct ao2_container *self)
+{
+	int slot = container_reader_slot();
+
+	ast_atomic_fetchadd_int(&self->readers->slot[slot].entries, +1);
+	if (ast_atomic_fetchadd_int(&self->readers->write_pending, 0)) {
+		/*
+		 * A writer is draining readers or modifying the container.
+		 * Back out of the epoch and wait on the lock like a normal
+		 * reader so the writer is never starved.
+		 */
+		ast_atomic_fetchadd_int(&self->readers->slot[slot].entries, -1);
+		ao2_rdlock(self);
+		return -1;
+	}
+	return slot;
+}
+
+void container_read_exit(struct ao2_container *self, int slot)
+{
+	if (slot < 0) {
+		ao2_unlock(self);
+		return;
+	}
+	ast_atomic_fetchadd_int(&self->readers->slot[slot].entries, -1);
+}
+
+void container_sync_readers(struct ao2_container *self)
+{
+	int idx;
+
+	if (!self->readers) {
+		return;
+	}
+	ast_atomic_fetchadd_int(&self->readers->write_pending, +1);
+	for (idx = 0; idx < AO2_READER_SLOTS; ++idx) {
+		while (ast_atomic_fetchadd_int(&self->readers->slot[idx].entries, 0)) {
+			sched_yield();
+		}
+	}
+}
+
+void container_sync_done(struct ao2_container *self)
+{
+	if (!self->readers) {
+		return;
+	}
+	ast_atomic_fetchadd_int(&self->readers->write_pending, -1);
+}
+
 int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flags,
 	const char *tag, const char *file, int line, const char *func)
 {
@@ -115,6 +208,7 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 		ao2_wrlock(self);
 		orig_lock = AO2_LOCK_REQ_MUTEX;
 	}
+	container_sync_readers(self);
 
 	res = 0;
 	node = self->v_table->new_node(self, obj_new, tag, file, line, func);
@@ -151,6 +245,7 @@ int __ao2_link(struct ao2_container *self, void *obj_new, int flags,
 		}
 	}
 
+	container_sync_done(self);
 	if (flags & OBJ_NOLOCK) {
 		__adjust_lock(self, orig_lock, 0);
 	} else {
@@ -240,6 +335,8 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 	enum ao2_lock_req orig_lock;
 	struct ao2_container *multi_container = NULL;
 	struct ao2_iterator *multi_iterator = NULL;
+	int read_epoch = 0;
+	int read_slot = -1;
 
 	if (!__is_ao2_object(self, file, line, func)) {
 		return NULL;
@@ -299,6 +396,7 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 	if (flags & OBJ_NOLOCK) {
 		if (flags & OBJ_UNLINK) {
 			orig_lock = __adjust_lock(self, AO2_LOCK_REQ_WRLOCK, 1);
+			container_sync_readers(self);
 		} else {
 			orig_lock = __adjust_lock(self, AO2_LOCK_REQ_RDLOCK, 1);
 		}
@@ -306,6 +404,11 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 		orig_lock = AO2_LOCK_REQ_MUTEX;
 		if (flags & OBJ_UNLINK) {
 			ao2_wrlock(self);
+			container_sync_readers(self);
+		} else if (self->readers) {
+			/* Lock-free read path for read-mostly containers. */
+			read_epoch = 1;
+			read_slot = container_read_enter(self);
 		} else {
 			ao2_rdlock(self);
 		}
@@ -389,8 +492,13 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 		ao2_t_ref(node, -1, NULL);
 	}
 
+	if (flags & OBJ_UNLINK) {
+		container_sync_done(self);
+	}
 	if (flags & OBJ_NOLOCK) {
 		__adjust_lock(self, orig_lock, 0);
+	} else if (read_epoch) {
+		container_read_exit(self, read_slot);
 	} else {
 		ao2_unlock(self);
 	}
@@ -604,6 +712,9 @@ void container_destruct(void *_c)
 		c->v_table->destroy(c);
 	}
 
+	ast_free(c->readers);
+	c->readers = NULL;
+
 #if defined(AO2_DEBUG)
 	ast_atomic_fetchadd_int(&ao2.total_containers, -1);
 #endif
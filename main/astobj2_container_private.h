@@ -307,8 +307,69 @@ struct ao2_container {
 	 * issued about container node reference leaks.
 	 */
 	unsigned int destroying:1;
+	/*!
+	 * \brief Sharded reader epoch counters.
+	 *
+	 * \note Only allocated when the container was created with
+	 * AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY.  NULL otherwise.
+	 */
+	struct ao2_container_readers *readers;
 };
 
+/*!
+ * \internal
+ * \brief Allocate the reader epoch counters for a read-mostly container.
+ *
+ * \param self Container to operate upon.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int container_readers_init(struct ao2_container *self);
+
+/*!
+ * \internal
+ * \brief Enter the reader epoch of a read-mostly container.
+ *
+ * \param self Container to operate upon.
+ *
+ * \retval slot index (>= 0) if the epoch was entered.
+ * \retval -1 if a writer is pending and the container read lock
+ * was taken instead.
+ */
+int container_read_enter(struct ao2_container *self);
+
+/*!
+ * \internal
+ * \brief Leave the reader epoch of a read-mostly container.
+ *
+ * \param self Container to operate upon.
+ * \param slot Value returned by container_read_enter().
+ */
+void container_read_exit(struct ao2_container *self, int slot);
+
+/*!
+ * \internal
+ * \brief Wait for all epoch readers to drain from the container.
+ *
+ * \details Must be called with the container write locked.  New
+ * readers entering while the drain is in progress fall back to
+ * the container read lock and therefore block until the writer
+ * is done.  Call container_sync_done() when the modification is
+ * complete.
+ *
+ * \param self Container to operate upon.
+ */
+void container_sync_readers(struct ao2_container *self);
+
+/*!
+ * \internal
+ * \brief Allow epoch readers back into the container.
+ *
+ * \param self Container to operate upon.
+ */
+void container_sync_done(struct ao2_container *self);
+
 /*!
  * \internal
  * \brief Unlink a node from this container.
@@ -328,4 +389,20 @@ int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flag
 void container_destruct(void *_c);
 int container_init(void);
 
+/*!
+ * \internal
+ * \brief Allocate an open-addressing hash container.
+ *
+ * \details Called by __ao2_container_alloc_hash() when the
+ * AO2_CONTAINER_ALLOC_OPT_OPEN_ADDRESSING container option is
+ * set.  Takes the same parameters.
+ *
+ * \retval container on success.
+ * \retval NULL on error.
+ */
+struct ao2_container *__ao2_container_alloc_oaddr(unsigned int ao2_options,
+	unsigned int container_options, unsigned int n_buckets, ao2_hash_fn *hash_fn,
+	ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn,
+	const char *tag, const char *file, int line, const char *func);
+
 #endif /* ASTOBJ2_CONTAINER_PRIVATE_H_ */
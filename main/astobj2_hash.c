@@ -169,6 +169,7 @@ static void hash_ao2_node_destructor(void *v_doomed)
 #endif
 
 		__adjust_lock(my_container, AO2_LOCK_REQ_WRLOCK, 1);
+		container_sync_readers(&my_container->common);
 
 #if defined(AO2_DEBUG)
 		if (!my_container->common.destroying
@@ -179,6 +180,7 @@ static void hash_ao2_node_destructor(void *v_doomed)
 		bucket = &my_container->buckets[doomed->my_bucket];
 		AST_DLLIST_REMOVE(&bucket->list, doomed, links);
 		AO2_DEVMODE_STAT(--my_container->common.nodes);
+		container_sync_done(&my_container->common);
 	}
 
 	/*
@@ -1068,6 +1070,13 @@ static struct ao2_container *hash_ao2_container_init(
 	self->hash_fn = hash_fn ? hash_fn : hash_zero;
 	self->n_buckets = n_buckets;
 
+	if (options & AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY) {
+		if (container_readers_init(&self->common)) {
+			/* Degrade gracefully to the normal locked find path. */
+			self->common.options &= ~AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY;
+		}
+	}
+
 #ifdef AO2_DEBUG
 	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
 #endif	/* defined(AO2_DEBUG) */
@@ -1084,6 +1093,11 @@ struct ao2_container *__ao2_container_alloc_hash(unsigned int ao2_options,
 	size_t container_size;
 	struct ao2_container_hash *self;
 
+	if (container_options & AO2_CONTAINER_ALLOC_OPT_OPEN_ADDRESSING) {
+		return __ao2_container_alloc_oaddr(ao2_options, container_options, n_buckets,
+			hash_fn, sort_fn, cmp_fn, tag, file, line, func);
+	}
+
 	num_buckets = hash_fn ? n_buckets : 1;
 	container_size = sizeof(struct ao2_container_hash) + num_buckets * sizeof(struct hash_bucket);
 
@@ -0,0 +1,812 @@
+/*
+ * astobj2_oaddr - Open-addressing hash table implementation for astobj2.
+ *
+ * Copyright (C) 2006 Marta Carbone, Luigi Rizzo - Univ. di Pisa, Italy
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Open-addressing (robin-hood) hash functions implementing
+ * astobj2 containers.
+ *
+ * \details
+ * Instead of the chained bucket lists of astobj2_hash.c, this
+ * backend keeps a flat power-of-two array of slots, each holding
+ * the object's hash inline next to the node pointer.  A lookup
+ * probes consecutive slots and only dereferences a node when the
+ * stored hash matches, so the common miss/hit path touches one or
+ * two cache lines instead of chasing list pointers.  Robin-hood
+ * displacement with backward-shift deletion keeps probe sequences
+ * short without tombstones.
+ *
+ * Nodes remain individually allocated ao2 objects so that
+ * iterators can hold references across container unlocks, exactly
+ * like the chained backend.  A node's slot index is updated
+ * whenever displacement moves it, which is what traversals and
+ * iterators use to resume.
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "astobj2_private.h"
+#include "astobj2_container_private.h"
+#include "asterisk/utils.h"
+
+/*! Grow the slot array when more than 3/4 full. */
+#define OADDR_LOAD_NUM	3
+#define OADDR_LOAD_DEN	4
+
+/*! Minimum number of slots in the table. */
+#define OADDR_MIN_SLOTS	8
+
+struct oaddr_node;
+
+/*! A slot of the open-addressing table. */
+struct oaddr_slot {
+	/*! Hash of the object held by node.  Valid if node is not NULL. */
+	unsigned int hash;
+	/*! Node in this slot.  NULL if the slot is free. */
+	struct oaddr_node *node;
+};
+
+/*! Container node for the open-addressing table. */
+struct oaddr_node {
+	/*!
+	 * \brief Items common to all container nodes.
+	 * \note Must be first in the specific node struct.
+	 */
+	struct ao2_container_node common;
+	/*! Hash of the stored object. */
+	unsigned int my_hash;
+	/*! Current slot of the node.  Updated when displacement moves it. */
+	int my_slot;
+};
+
+/*!
+ * An open-addressing hash container in addition to values common
+ * to all container types stores the hash callback function and
+ * the slot array.
+ */
+struct ao2_container_oaddr {
+	/*!
+	 * \brief Items common to all containers.
+	 * \note Must be first in the specific container struct.
+	 */
+	struct ao2_container common;
+	ao2_hash_fn *hash_fn;
+	/*! Number of slots in the table.  Always a power of two. */
+	int n_slots;
+	/*! Number of nodes held by the table.  (Includes empty nodes.) */
+	int n_nodes;
+	/*! Hint used to recreate empty clones of the container. */
+	unsigned int n_buckets_hint;
+	/*! Slot array of n_slots. */
+	struct oaddr_slot *slots;
+};
+
+/*! Traversal state to restart an open-addressing container traversal. */
+struct oaddr_traversal_state {
+	/*! Saved comparison callback arg pointer. */
+	void *arg;
+	/*! Hash of the search key if the traversal is keyed. */
+	unsigned int hash;
+	/*! Saved search flags to control traversing the container. */
+	enum search_flags flags;
+	/*! TRUE if probing a single hash chain instead of scanning all slots. */
+	unsigned int keyed:1;
+	/*! TRUE if it is a descending search. */
+	unsigned int descending:1;
+};
+
+struct oaddr_traversal_state_check {
+	/*
+	 * If we have a division by zero compile error here then there
+	 * is not enough room for the state.  Increase AO2_TRAVERSAL_STATE_SIZE.
+	 */
+	char check[1 / (AO2_TRAVERSAL_STATE_SIZE / sizeof(struct oaddr_traversal_state))];
+};
+
+/*!
+ * \internal
+ * \brief Probe distance of a hash stored at the given slot index.
+ */
+static int oaddr_probe_dist(struct ao2_container_oaddr *self, unsigned int hash, int idx)
+{
+	return (idx - (int) (hash & (self->n_slots - 1))) & (self->n_slots - 1);
+}
+
+/*!
+ * \internal
+ * \brief Place a node into the table using robin-hood displacement.
+ *
+ * \note There must be at least one free slot in the table.
+ */
+static void oaddr_place_node(struct ao2_container_oaddr *self, struct oaddr_node *node)
+{
+	struct oaddr_slot carry;
+	struct oaddr_slot displaced;
+	int idx;
+	int dist;
+	int cur_dist;
+
+	carry.hash = node->my_hash;
+	carry.node = node;
+	idx = carry.hash & (self->n_slots - 1);
+	dist = 0;
+	for (;;) {
+		struct oaddr_slot *slot = &self->slots[idx];
+
+		if (!slot->node) {
+			*slot = carry;
+			slot->node->my_slot = idx;
+			return;
+		}
+		cur_dist = oaddr_probe_dist(self, slot->hash, idx);
+		if (cur_dist < dist) {
+			/* Rob the rich slot and carry its entry onward. */
+			displaced = *slot;
+			*slot = carry;
+			slot->node->my_slot = idx;
+			carry = displaced;
+			dist = cur_dist;
+		}
+		idx = (idx + 1) & (self->n_slots - 1);
+		++dist;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Remove a node from the table with backward-shift deletion.
+ */
+static void oaddr_remove_node(struct ao2_container_oaddr *self, struct oaddr_node *node)
+{
+	int idx = node->my_slot;
+
+	for (;;) {
+		int next = (idx + 1) & (self->n_slots - 1);
+		struct oaddr_slot *slot = &self->slots[next];
+
+		if (!slot->node || !oaddr_probe_dist(self, slot->hash, next)) {
+			break;
+		}
+		self->slots[idx] = *slot;
+		self->slots[idx].node->my_slot = idx;
+		idx = next;
+	}
+	self->slots[idx].node = NULL;
+	--self->n_nodes;
+}
+
+/*!
+ * \internal
+ * \brief Grow the slot array to the requested power-of-two size.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.  The table is left unchanged.
+ */
+static int oaddr_grow(struct ao2_container_oaddr *self, int new_slots)
+{
+	struct oaddr_slot *old_slots = self->slots;
+	int old_n_slots = self->n_slots;
+	int idx;
+
+	self->slots = ast_calloc(new_slots, sizeof(*self->slots));
+	if (!self->slots) {
+		self->slots = old_slots;
+		return -1;
+	}
+	self->n_slots = new_slots;
+
+	for (idx = 0; idx < old_n_slots; ++idx) {
+		if (old_slots[idx].node) {
+			oaddr_place_node(self, old_slots[idx].node);
+		}
+	}
+	ast_free(old_slots);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Create an empty copy of this container.
+ *
+ * \param self Container to operate upon.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \retval empty-clone-container on success.
+ * \retval NULL on error.
+ */
+static struct ao2_container *oaddr_ao2_alloc_empty_clone(struct ao2_container_oaddr *self,
+	const char *tag, const char *file, int line, const char *func)
+{
+	if (!__is_ao2_object(self, file, line, func)) {
+		return NULL;
+	}
+
+	return __ao2_container_alloc_hash(ao2_options_get(self), self->common.options,
+		self->n_buckets_hint, self->hash_fn, self->common.sort_fn, self->common.cmp_fn,
+		tag, file, line, func);
+}
+
+/*!
+ * \internal
+ * \brief Destroy an open-addressing container node.
+ *
+ * \details
+ * The container node unlinks itself from the container as part
+ * of its destruction.  The node must be destroyed while the
+ * container is already locked.
+ *
+ * \note The container must be locked when the node is
+ * unreferenced.
+ */
+static void oaddr_ao2_node_destructor(void *v_doomed)
+{
+	struct oaddr_node *doomed = v_doomed;
+
+	if (doomed->common.is_linked) {
+		struct ao2_container_oaddr *my_container;
+
+		/*
+		 * Promote to write lock if not already there.  Since
+		 * adjust_lock() can potentially release and block waiting for a
+		 * write lock, care must be taken to ensure that node references
+		 * are released before releasing the container references.
+		 */
+		my_container = (struct ao2_container_oaddr *) doomed->common.my_container;
+#ifdef AST_DEVMODE
+		is_ao2_object(my_container);
+#endif
+
+		__adjust_lock(my_container, AO2_LOCK_REQ_WRLOCK, 1);
+		container_sync_readers(&my_container->common);
+
+		oaddr_remove_node(my_container, doomed);
+		AO2_DEVMODE_STAT(--my_container->common.nodes);
+		container_sync_done(&my_container->common);
+	}
+
+	/*
+	 * We could have an object in the node if the container is being
+	 * destroyed or the node had not been linked in yet.
+	 */
+	if (doomed->common.obj) {
+		__container_unlink_node(&doomed->common, AO2_UNLINK_NODE_UNLINK_OBJECT);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Create a new container node.
+ *
+ * \param self Container to operate upon.
+ * \param obj_new Object to put into the node.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \retval initialized-node on success.
+ * \retval NULL on error.
+ */
+static struct oaddr_node *oaddr_ao2_new_node(struct ao2_container_oaddr *self, void *obj_new, const char *tag, const char *file, int line, const char *func)
+{
+	struct oaddr_node *node;
+
+	node = ao2_t_alloc_options(sizeof(*node), oaddr_ao2_node_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK, NULL);
+	if (!node) {
+		return NULL;
+	}
+
+	node->my_hash = abs(self->hash_fn(obj_new, OBJ_SEARCH_OBJECT));
+
+	__ao2_ref(obj_new, +1, tag ?: "Container node creation", file, line, func);
+	node->common.obj = obj_new;
+	node->common.my_container = (struct ao2_container *) self;
+
+	return node;
+}
+
+/*!
+ * \internal
+ * \brief Insert a node into this container.
+ *
+ * \param self Container to operate upon.
+ * \param node Container node to insert into the container.
+ *
+ * \return enum ao2_container_insert value.
+ */
+static enum ao2_container_insert oaddr_ao2_insert_node(struct ao2_container_oaddr *self,
+	struct oaddr_node *node)
+{
+	ao2_sort_fn *sort_fn = self->common.sort_fn;
+	uint32_t options = self->common.options;
+
+	/* Grow ahead of need so there is always a free slot to probe into. */
+	if (OADDR_LOAD_DEN * (self->n_nodes + 1) > OADDR_LOAD_NUM * self->n_slots
+		&& oaddr_grow(self, 2 * self->n_slots)
+		&& self->n_nodes + 1 >= self->n_slots) {
+		ast_log(LOG_ERROR, "Could not grow open-addressing container table!\n");
+		return AO2_CONTAINER_INSERT_NODE_REJECTED;
+	}
+
+	if (sort_fn && (options & AO2_CONTAINER_ALLOC_OPT_DUPS_MASK) != AO2_CONTAINER_ALLOC_OPT_DUPS_ALLOW) {
+		/* Scan the probe chain for an existing duplicate key. */
+		int idx = node->my_hash & (self->n_slots - 1);
+		int dist = 0;
+
+		for (;;) {
+			struct oaddr_slot *slot = &self->slots[idx];
+
+			if (!slot->node || oaddr_probe_dist(self, slot->hash, idx) < dist) {
+				/* End of the probe chain.  No duplicate present. */
+				break;
+			}
+			if (slot->hash == node->my_hash && slot->node->common.obj
+				&& !sort_fn(slot->node->common.obj, node->common.obj, OBJ_SEARCH_OBJECT)) {
+				switch (options & AO2_CONTAINER_ALLOC_OPT_DUPS_MASK) {
+				case AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT:
+					/* Reject all objects with the same key. */
+					return AO2_CONTAINER_INSERT_NODE_REJECTED;
+				case AO2_CONTAINER_ALLOC_OPT_DUPS_OBJ_REJECT:
+					if (slot->node->common.obj == node->common.obj) {
+						/* Reject inserting the same object */
+						return AO2_CONTAINER_INSERT_NODE_REJECTED;
+					}
+					break;
+				case AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE:
+					SWAP(slot->node->common.obj, node->common.obj);
+					ao2_t_ref(node, -1, NULL);
+					return AO2_CONTAINER_INSERT_NODE_OBJ_REPLACED;
+				default:
+					break;
+				}
+			}
+			idx = (idx + 1) & (self->n_slots - 1);
+			++dist;
+		}
+	}
+
+	oaddr_place_node(self, node);
+	++self->n_nodes;
+	return AO2_CONTAINER_INSERT_NODE_INSERTED;
+}
+
+/*!
+ * \internal
+ * \brief Resume a keyed probe of the table at the given slot.
+ *
+ * \param self Container to operate upon.
+ * \param state Traversal state of the keyed search.
+ * \param idx Slot index to resume probing from.
+ *
+ * \retval node-ptr of found node (not reffed).
+ * \retval NULL when the probe chain is exhausted.
+ */
+static struct oaddr_node *oaddr_probe_resume(struct ao2_container_oaddr *self,
+	struct oaddr_traversal_state *state, int idx)
+{
+	for (;;) {
+		struct oaddr_slot *slot = &self->slots[idx];
+		int dist;
+
+		if (!slot->node) {
+			return NULL;
+		}
+		dist = (idx - (int) (state->hash & (self->n_slots - 1))) & (self->n_slots - 1);
+		if (oaddr_probe_dist(self, slot->hash, idx) < dist) {
+			/* Anything hashing to our home slot would have robbed this one. */
+			return NULL;
+		}
+		if (slot->hash == state->hash && slot->node->common.obj) {
+			return slot->node;
+		}
+		idx = (idx + 1) & (self->n_slots - 1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Resume a full scan of the table at the given slot.
+ *
+ * \retval node-ptr of found node (not reffed).
+ * \retval NULL when the scan is complete.
+ */
+static struct oaddr_node *oaddr_scan_resume(struct ao2_container_oaddr *self,
+	struct oaddr_traversal_state *state, int idx)
+{
+	if (state->descending) {
+		for (; 0 <= idx; --idx) {
+			if (self->slots[idx].node && self->slots[idx].node->common.obj) {
+				return self->slots[idx].node;
+			}
+		}
+	} else {
+		for (; idx < self->n_slots; ++idx) {
+			if (self->slots[idx].node && self->slots[idx].node->common.obj) {
+				return self->slots[idx].node;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the first open-addressing container node in a traversal.
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control traversing the container
+ * \param arg Comparison callback arg parameter.
+ * \param state Traversal state to restart the container traversal.
+ *
+ * \retval node-ptr of found node (Reffed).
+ * \retval NULL when no node found.
+ */
+static struct oaddr_node *oaddr_ao2_find_first(struct ao2_container_oaddr *self, enum search_flags flags, void *arg, struct oaddr_traversal_state *state)
+{
+	struct oaddr_node *node;
+
+	memset(state, 0, sizeof(*state));
+	state->arg = arg;
+	state->flags = flags;
+
+	switch (flags & OBJ_ORDER_MASK) {
+	case OBJ_ORDER_POST:
+	case OBJ_ORDER_DESCENDING:
+		state->descending = 1;
+		break;
+	default:
+		break;
+	}
+
+	/*
+	 * If lookup by pointer or search key, probe the hash chain.
+	 * Otherwise, scan the whole table.
+	 */
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+	case OBJ_SEARCH_KEY:
+		state->keyed = 1;
+		state->hash = abs(self->hash_fn(arg, flags & OBJ_SEARCH_MASK));
+		node = oaddr_probe_resume(self, state,
+			state->hash & (self->n_slots - 1));
+		break;
+	default:
+		node = oaddr_scan_resume(self, state,
+			state->descending ? self->n_slots - 1 : 0);
+		break;
+	}
+
+	if (node) {
+		ao2_t_ref(node, +1, NULL);
+	}
+	return node;
+}
+
+/*!
+ * \internal
+ * \brief Find the next open-addressing container node in a traversal.
+ *
+ * \param self Container to operate upon.
+ * \param state Traversal state to restart the container traversal.
+ * \param prev Previous node returned by the traversal search functions.
+ *    The ref ownership is passed back to this function.
+ *
+ * \retval node-ptr of found node (Reffed).
+ * \retval NULL when no node found.
+ */
+static struct oaddr_node *oaddr_ao2_find_next(struct ao2_container_oaddr *self, struct oaddr_traversal_state *state, struct oaddr_node *prev)
+{
+	struct oaddr_node *node;
+
+	for (;;) {
+		if (state->keyed) {
+			node = oaddr_probe_resume(self, state,
+				(prev->my_slot + 1) & (self->n_slots - 1));
+		} else {
+			node = oaddr_scan_resume(self, state,
+				state->descending ? prev->my_slot - 1 : prev->my_slot + 1);
+		}
+		if (!node) {
+			break;
+		}
+
+		ao2_t_ref(node, +1, NULL);
+
+		/*
+		 * Dereferencing the prev node may remove it from the table and
+		 * backward-shift following entries, which is why the next node
+		 * is found and reffed before prev is released.
+		 */
+		ao2_t_ref(prev, -1, NULL);
+		if (node->common.obj) {
+			return node;
+		}
+		prev = node;
+	}
+
+	/* No more nodes in the container left to traverse. */
+	ao2_t_ref(prev, -1, NULL);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the next non-empty iteration node in the container.
+ *
+ * \param self Container to operate upon.
+ * \param node Previous node returned by the iterator.
+ * \param flags search_flags to control iterating the container.
+ *   Only AO2_ITERATOR_DESCENDING is useful by the method.
+ *
+ * \note The container is already locked.
+ *
+ * \retval node on success.
+ * \retval NULL on error or no more nodes in the container.
+ */
+static struct oaddr_node *oaddr_ao2_iterator_next(struct ao2_container_oaddr *self, struct oaddr_node *node, enum ao2_iterator_flags flags)
+{
+	int idx;
+
+	if (flags & AO2_ITERATOR_DESCENDING) {
+		idx = node ? node->my_slot - 1 : self->n_slots - 1;
+		for (; 0 <= idx; --idx) {
+			if (self->slots[idx].node && self->slots[idx].node->common.obj) {
+				return self->slots[idx].node;
+			}
+		}
+	} else {
+		idx = node ? node->my_slot + 1 : 0;
+		for (; idx < self->n_slots; ++idx) {
+			if (self->slots[idx].node && self->slots[idx].node->common.obj) {
+				return self->slots[idx].node;
+			}
+		}
+	}
+
+	/* No more nodes to visit in the container. */
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Destroy this container.
+ *
+ * \param self Container to operate upon.
+ */
+static void oaddr_ao2_destroy(struct ao2_container_oaddr *self)
+{
+	if (self->n_nodes) {
+		ast_log(LOG_ERROR, "Node ref leak.  Open-addressing container still has nodes!\n");
+		ast_assert(0);
+	}
+	ast_free(self->slots);
+	self->slots = NULL;
+}
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Display contents of the specified container.
+ *
+ * \param self Container to dump.
+ * \param where User data needed by prnt to determine where to put output.
+ * \param prnt Print output callback function to use.
+ * \param prnt_obj Callback function to print the given object's key. (NULL if not available)
+ */
+static void oaddr_ao2_dump(struct ao2_container_oaddr *self, void *where, ao2_prnt_fn *prnt, ao2_prnt_obj_fn *prnt_obj)
+{
+#define FORMAT  "%6s, %10s, %6s, %16s, %16s, %s\n"
+#define FORMAT2 "%6d, %10u, %6d, %16p, %16p, "
+
+	int idx;
+
+	prnt(where, "Number of slots: %d\n\n", self->n_slots);
+
+	prnt(where, FORMAT, "Slot", "Hash", "Dist", "Node", "Obj", "Key");
+	for (idx = 0; idx < self->n_slots; ++idx) {
+		struct oaddr_slot *slot = &self->slots[idx];
+
+		if (!slot->node) {
+			continue;
+		}
+		prnt(where, FORMAT2,
+			idx,
+			slot->hash,
+			oaddr_probe_dist(self, slot->hash, idx),
+			slot->node,
+			slot->node->common.obj);
+		if (slot->node->common.obj && prnt_obj) {
+			prnt_obj(slot->node->common.obj, where, prnt);
+		}
+		prnt(where, "\n");
+	}
+
+#undef FORMAT
+#undef FORMAT2
+}
+#endif	/* defined(AO2_DEBUG) */
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Display statistics of the specified container.
+ *
+ * \param self Container to display statistics.
+ * \param where User data needed by prnt to determine where to put output.
+ * \param prnt Print output callback function to use.
+ *
+ * \note The container is already locked for reading.
+ */
+static void oaddr_ao2_stats(struct ao2_container_oaddr *self, void *where, ao2_prnt_fn *prnt)
+{
+	int idx;
+	int max_dist = 0;
+	long long total_dist = 0;
+
+	for (idx = 0; idx < self->n_slots; ++idx) {
+		if (self->slots[idx].node) {
+			int dist = oaddr_probe_dist(self, self->slots[idx].hash, idx);
+
+			total_dist += dist;
+			if (max_dist < dist) {
+				max_dist = dist;
+			}
+		}
+	}
+	prnt(where, "Number of slots: %d\n", self->n_slots);
+	prnt(where, "Number of nodes: %d\n", self->n_nodes);
+	prnt(where, "Maximum probe distance: %d\n", max_dist);
+	prnt(where, "Average probe distance: %.2f\n",
+		self->n_nodes ? (double) total_dist / self->n_nodes : 0.0);
+}
+#endif	/* defined(AO2_DEBUG) */
+
+#if defined(AO2_DEBUG)
+/*!
+ * \internal
+ * \brief Perform an integrity check on the specified container.
+ *
+ * \param self Container to check integrity.
+ *
+ * \note The container is already locked for reading.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int oaddr_ao2_integrity(struct ao2_container_oaddr *self)
+{
+	int idx;
+	int count_obj = 0;
+	int count_node = 0;
+
+	for (idx = 0; idx < self->n_slots; ++idx) {
+		struct oaddr_slot *slot = &self->slots[idx];
+
+		if (!slot->node) {
+			continue;
+		}
+		++count_node;
+		if (slot->node->my_slot != idx) {
+			ast_log(LOG_ERROR, "Node at slot %d claims to be at slot %d!\n",
+				idx, slot->node->my_slot);
+			return -1;
+		}
+		if (slot->node->my_hash != slot->hash) {
+			ast_log(LOG_ERROR, "Slot %d inline hash does not match its node!\n", idx);
+			return -1;
+		}
+		if (slot->node->common.obj) {
+			++count_obj;
+			if ((unsigned int) abs(self->hash_fn(slot->node->common.obj, OBJ_SEARCH_OBJECT))
+				!= slot->hash) {
+				ast_log(LOG_ERROR, "Slot %d object does not hash to stored value!\n", idx);
+				return -1;
+			}
+		}
+		if (oaddr_probe_dist(self, slot->hash, idx)
+			&& !self->slots[(idx - 1) & (self->n_slots - 1)].node) {
+			ast_log(LOG_ERROR, "Slot %d breaks the probe chain invariant!\n", idx);
+			return -1;
+		}
+	}
+
+	if (count_node != self->n_nodes) {
+		ast_log(LOG_ERROR, "Total node count of %d does not match stat of %d!\n",
+			count_node, self->n_nodes);
+		return -1;
+	}
+	if (count_obj != ao2_container_count(&self->common)) {
+		ast_log(LOG_ERROR,
+			"Total object count of %d does not match ao2_container_count() of %d!\n",
+			count_obj, ao2_container_count(&self->common));
+		return -1;
+	}
+
+	return 0;
+}
+#endif	/* defined(AO2_DEBUG) */
+
+/*! Open-addressing container virtual method table. */
+static const struct ao2_container_methods v_table_oaddr = {
+	.alloc_empty_clone = (ao2_container_alloc_empty_clone_fn) oaddr_ao2_alloc_empty_clone,
+	.new_node = (ao2_container_new_node_fn) oaddr_ao2_new_node,
+	.insert = (ao2_container_insert_fn) oaddr_ao2_insert_node,
+	.traverse_first = (ao2_container_find_first_fn) oaddr_ao2_find_first,
+	.traverse_next = (ao2_container_find_next_fn) oaddr_ao2_find_next,
+	.iterator_next = (ao2_iterator_next_fn) oaddr_ao2_iterator_next,
+	.destroy = (ao2_container_destroy_fn) oaddr_ao2_destroy,
+#if defined(AO2_DEBUG)
+	.dump = (ao2_container_display) oaddr_ao2_dump,
+	.stats = (ao2_container_statistics) oaddr_ao2_stats,
+	.integrity = (ao2_container_integrity) oaddr_ao2_integrity,
+#endif	/* defined(AO2_DEBUG) */
+};
+
+struct ao2_container *__ao2_container_alloc_oaddr(unsigned int ao2_options,
+	unsigned int container_options, unsigned int n_buckets, ao2_hash_fn *hash_fn,
+	ao2_sort_fn *sort_fn, ao2_callback_fn *cmp_fn,
+	const char *tag, const char *file, int line, const char *func)
+{
+	struct ao2_container_oaddr *self;
+	int n_slots;
+
+	if (!hash_fn) {
+		/* An open-addressing list makes no sense. */
+		return NULL;
+	}
+
+	/* Round the bucket hint up to a power of two. */
+	for (n_slots = OADDR_MIN_SLOTS; (unsigned int) n_slots < n_buckets; n_slots *= 2) {
+	}
+
+	self = __ao2_alloc(sizeof(*self), container_destruct, ao2_options,
+		tag ?: __PRETTY_FUNCTION__, file, line, func);
+	if (!self) {
+		return NULL;
+	}
+
+	self->common.v_table = &v_table_oaddr;
+	self->common.sort_fn = sort_fn;
+	self->common.cmp_fn = cmp_fn;
+	self->common.options = container_options;
+	self->hash_fn = hash_fn;
+	self->n_slots = n_slots;
+	self->n_buckets_hint = n_buckets;
+
+	self->slots = ast_calloc(n_slots, sizeof(*self->slots));
+	if (!self->slots) {
+		ao2_t_ref(self, -1, NULL);
+		return NULL;
+	}
+
+	if (container_options & AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY) {
+		if (container_readers_init(&self->common)) {
+			/* Degrade gracefully to the normal locked find path. */
+			self->common.options &= ~AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY;
+		}
+	}
+
+#ifdef AO2_DEBUG
+	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
+#endif	/* defined(AO2_DEBUG) */
+
+	return (struct ao2_container *) self;
+}
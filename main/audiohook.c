@@ -117,6 +117,9 @@ int ast_audiohook_init(struct ast_audiohook *audiohook, enum ast_audiohook_type
 
 	audiohook->init_flags = init_flags;
 
+	AST_LIST_HEAD_INIT_NOLOCK(&audiohook->tap_frames[0]);
+	AST_LIST_HEAD_INIT_NOLOCK(&audiohook->tap_frames[1]);
+
 	/* initialize internal rate at 8khz, this will adjust if necessary */
 	audiohook_set_internal_rate(audiohook, DEFAULT_INTERNAL_SAMPLE_RATE, 0);
 
@@ -132,6 +135,16 @@ int ast_audiohook_init(struct ast_audiohook *audiohook, enum ast_audiohook_type
  */
 int ast_audiohook_destroy(struct ast_audiohook *audiohook)
 {
+	struct ast_frame *frame;
+	int i;
+
+	/* Drop any frames still queued if this audiohook is a tap */
+	for (i = 0; i < ARRAY_LEN(audiohook->tap_frames); i++) {
+		while ((frame = AST_LIST_REMOVE_HEAD(&audiohook->tap_frames[i], frame_list))) {
+			ast_frfree(frame);
+		}
+	}
+
 	/* Drop the factories used by this audiohook type */
 	switch (audiohook->type) {
 	case AST_AUDIOHOOK_TYPE_SPY:
@@ -156,6 +169,88 @@ int ast_audiohook_destroy(struct ast_audiohook *audiohook)
 	return 0;
 }
 
+/*! \brief Queues a frame on a tap audiohook
+ * \param audiohook Audiohook structure
+ * \param direction Direction the audio frame came from
+ * \param frame Frame to queue
+ * \return Returns 0 on success, -1 on failure
+ *
+ * \note The frame is duplicated exactly once and handed to the consumer as
+ *       is, rather than being copied into a slinear factory on write and
+ *       back out of it on read.
+ */
+static int audiohook_tap_write_frame(struct ast_audiohook *audiohook, enum ast_audiohook_direction direction, struct ast_frame *frame)
+{
+	int idx = (direction == AST_AUDIOHOOK_DIRECTION_READ ? 0 : 1);
+	struct timeval *rwtime = (direction == AST_AUDIOHOOK_DIRECTION_READ ? &audiohook->read_time : &audiohook->write_time);
+	unsigned int limit_ms = ast_test_flag(audiohook, AST_AUDIOHOOK_SMALL_QUEUE) ?
+		AST_AUDIOHOOK_SMALL_QUEUE_TOLERANCE : AST_AUDIOHOOK_LONG_QUEUE_TOLERANCE;
+	unsigned int limit_samples = limit_ms * (ast_format_get_sample_rate(frame->subclass.format) / 1000);
+	struct ast_frame *duped;
+
+	/* Update last feeding time to be current */
+	*rwtime = ast_tvnow();
+
+	if (!(duped = ast_frdup(frame))) {
+		return -1;
+	}
+
+	/* Taps mute only their own copy so other hooks on the channel are unaffected */
+	if ((ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ) && (direction == AST_AUDIOHOOK_DIRECTION_READ)) ||
+		(ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_WRITE) && (direction == AST_AUDIOHOOK_DIRECTION_WRITE))) {
+		if (duped->datalen > 0) {
+			ast_frame_clear(duped);
+		}
+	}
+
+	AST_LIST_INSERT_TAIL(&audiohook->tap_frames[idx], duped, frame_list);
+	audiohook->tap_queue_samples[idx] += duped->samples;
+
+	/* If the consumer has stopped reading don't let frames pile up forever */
+	if (audiohook->tap_queue_samples[idx] > limit_samples) {
+		ast_debug(1, "Tap audiohook %p has stale audio queued. Dropping oldest frames\n", audiohook);
+		while (audiohook->tap_queue_samples[idx] > limit_samples
+			&& (duped = AST_LIST_REMOVE_HEAD(&audiohook->tap_frames[idx], frame_list))) {
+			audiohook->tap_queue_samples[idx] -= duped->samples;
+			ast_frfree(duped);
+		}
+	}
+
+	/* If we need to notify the respective handler of this audiohook, do so */
+	if ((ast_test_flag(audiohook, AST_AUDIOHOOK_TRIGGER_MODE) == AST_AUDIOHOOK_TRIGGER_READ) && (direction == AST_AUDIOHOOK_DIRECTION_READ)) {
+		ast_cond_signal(&audiohook->trigger);
+	} else if ((ast_test_flag(audiohook, AST_AUDIOHOOK_TRIGGER_MODE) == AST_AUDIOHOOK_TRIGGER_WRITE) && (direction == AST_AUDIOHOOK_DIRECTION_WRITE)) {
+		ast_cond_signal(&audiohook->trigger);
+	} else if (ast_test_flag(audiohook, AST_AUDIOHOOK_TRIGGER_SYNC)) {
+		ast_cond_signal(&audiohook->trigger);
+	}
+
+	return 0;
+}
+
+/*! \brief Read the next queued frame from a tap audiohook
+ * \param audiohook Audiohook structure, which must be locked
+ * \param direction Direction to read a frame for
+ * \return Returns the next queued frame, or NULL if none are queued
+ */
+struct ast_frame *ast_audiohook_tap_read_frame(struct ast_audiohook *audiohook, enum ast_audiohook_direction direction)
+{
+	int idx = (direction == AST_AUDIOHOOK_DIRECTION_READ ? 0 : 1);
+	struct ast_frame *frame;
+
+	if (!(audiohook->init_flags & AST_AUDIOHOOK_TAP)
+		|| direction == AST_AUDIOHOOK_DIRECTION_BOTH) {
+		return NULL;
+	}
+
+	frame = AST_LIST_REMOVE_HEAD(&audiohook->tap_frames[idx], frame_list);
+	if (frame) {
+		audiohook->tap_queue_samples[idx] -= frame->samples;
+	}
+
+	return frame;
+}
+
 /*! \brief Writes a frame into the audiohook structure
  * \param audiohook Audiohook structure
  * \param direction Direction the audio frame came from
@@ -173,6 +268,11 @@ int ast_audiohook_write_frame(struct ast_audiohook *audiohook, enum ast_audiohoo
 	int other_factory_ms;
 	int muteme = 0;
 
+	/* Taps bypass the factories entirely */
+	if (audiohook->init_flags & AST_AUDIOHOOK_TAP) {
+		return audiohook_tap_write_frame(audiohook, direction, frame);
+	}
+
 	/* Update last feeding time to be current */
 	*rwtime = ast_tvnow();
 
@@ -51,6 +51,9 @@
 
 #define MAX_AUTOMONS 1500
 
+/*! \brief Number of independent service threads channels are sharded across */
+#define AUTOSERVICE_SHARDS 8
+
 struct asent {
 	struct ast_channel *chan;
 	/*! This gets incremented each time autoservice gets started on the same
@@ -62,16 +65,39 @@ struct asent {
 	AST_LIST_ENTRY(asent) list;
 };
 
-static AST_LIST_HEAD_STATIC(aslist, asent);
-static ast_cond_t as_cond;
+/*!
+ * \brief One independently serviced slice of the autoserviced channels
+ *
+ * Each shard has its own list, lock, condition, and service thread so
+ * that a large autoservice population does not funnel through a single
+ * poll loop and a single global lock.
+ */
+struct autoservice_shard {
+	AST_LIST_HEAD(, asent) aslist;
+	ast_cond_t as_cond;
+	pthread_t asthread;
+	int as_chan_list_state;
+};
 
-static pthread_t asthread = AST_PTHREADT_NULL;
+static struct autoservice_shard shards[AUTOSERVICE_SHARDS];
 static volatile int asexit = 0;
 
-static int as_chan_list_state;
+/*!
+ * \internal
+ * \brief Select the shard a channel is serviced by
+ *
+ * A channel stays on the same shard for its whole lifetime since the
+ * address is stable.  The low bits of the address are dominated by the
+ * allocator's alignment, so shift them out before taking the modulus.
+ */
+static struct autoservice_shard *shard_for_channel(struct ast_channel *chan)
+{
+	return &shards[((uintptr_t) chan >> 9) % AUTOSERVICE_SHARDS];
+}
 
-static void *autoservice_run(void *ign)
+static void *autoservice_run(void *data)
 {
+	struct autoservice_shard *shard = data;
 	ast_callid callid = 0;
 
 	while (!asexit) {
@@ -81,17 +107,17 @@ static void *autoservice_run(void *ign)
 		int x = 0, ms = 50;
 		struct ast_frame *f = NULL;
 
-		AST_LIST_LOCK(&aslist);
+		AST_LIST_LOCK(&shard->aslist);
 
 		/* At this point, we know that no channels that have been removed are going
 		 * to get used again. */
-		as_chan_list_state++;
+		shard->as_chan_list_state++;
 
-		if (AST_LIST_EMPTY(&aslist)) {
-			ast_cond_wait(&as_cond, &aslist.lock);
+		if (AST_LIST_EMPTY(&shard->aslist)) {
+			ast_cond_wait(&shard->as_cond, &shard->aslist.lock);
 		}
 
-		AST_LIST_TRAVERSE(&aslist, as, list) {
+		AST_LIST_TRAVERSE(&shard->aslist, as, list) {
 			if (!ast_check_hangup(as->chan)) {
 				if (x < MAX_AUTOMONS) {
 					mons[x++] = as->chan;
@@ -101,7 +127,7 @@ static void *autoservice_run(void *ign)
 			}
 		}
 
-		AST_LIST_UNLOCK(&aslist);
+		AST_LIST_UNLOCK(&shard->aslist);
 
 		if (!x) {
 			/* If we don't sleep, this becomes a busy loop, which causes
@@ -127,7 +153,7 @@ static void *autoservice_run(void *ign)
 	}
 
 	ast_callid_threadassoc_change(0);
-	asthread = AST_PTHREADT_NULL;
+	shard->asthread = AST_PTHREADT_NULL;
 
 	return NULL;
 }
@@ -136,15 +162,16 @@ int ast_autoservice_start(struct ast_channel *chan)
 {
 	int res = 0;
 	struct asent *as;
+	struct autoservice_shard *shard = shard_for_channel(chan);
 
-	AST_LIST_LOCK(&aslist);
-	AST_LIST_TRAVERSE(&aslist, as, list) {
+	AST_LIST_LOCK(&shard->aslist);
+	AST_LIST_TRAVERSE(&shard->aslist, as, list) {
 		if (as->chan == chan) {
 			as->use_count++;
 			break;
 		}
 	}
-	AST_LIST_UNLOCK(&aslist);
+	AST_LIST_UNLOCK(&shard->aslist);
 
 	if (as) {
 		/* Entry exists, autoservice is already handling this channel */
@@ -165,29 +192,29 @@ int ast_autoservice_start(struct ast_channel *chan)
 	ast_channel_start_defer_frames(chan, 1);
 	ast_channel_unlock(chan);
 
-	AST_LIST_LOCK(&aslist);
+	AST_LIST_LOCK(&shard->aslist);
 
-	if (AST_LIST_EMPTY(&aslist) && asthread != AST_PTHREADT_NULL) {
-		ast_cond_signal(&as_cond);
+	if (AST_LIST_EMPTY(&shard->aslist) && shard->asthread != AST_PTHREADT_NULL) {
+		ast_cond_signal(&shard->as_cond);
 	}
 
-	AST_LIST_INSERT_HEAD(&aslist, as, list);
+	AST_LIST_INSERT_HEAD(&shard->aslist, as, list);
 
-	if (asthread == AST_PTHREADT_NULL) { /* need start the thread */
-		if (ast_pthread_create_background(&asthread, NULL, autoservice_run, NULL)) {
+	if (shard->asthread == AST_PTHREADT_NULL) { /* need start the thread */
+		if (ast_pthread_create_background(&shard->asthread, NULL, autoservice_run, shard)) {
 			ast_log(LOG_WARNING, "Unable to create autoservice thread :(\n");
 			/* There will only be a single member in the list at this point,
 			   the one we just added. */
-			AST_LIST_REMOVE(&aslist, as, list);
+			AST_LIST_REMOVE(&shard->aslist, as, list);
 			ast_free(as);
-			asthread = AST_PTHREADT_NULL;
+			shard->asthread = AST_PTHREADT_NULL;
 			res = -1;
 		} else {
-			pthread_kill(asthread, SIGURG);
+			pthread_kill(shard->asthread, SIGURG);
 		}
 	}
 
-	AST_LIST_UNLOCK(&aslist);
+	AST_LIST_UNLOCK(&shard->aslist);
 
 	return res;
 }
@@ -196,19 +223,20 @@ int ast_autoservice_stop(struct ast_channel *chan)
 {
 	int res = -1;
 	struct asent *as, *removed = NULL;
+	struct autoservice_shard *shard = shard_for_channel(chan);
 	int chan_list_state;
 
-	AST_LIST_LOCK(&aslist);
+	AST_LIST_LOCK(&shard->aslist);
 
 	/* Save the autoservice channel list state.  We _must_ verify that the channel
 	 * list has been rebuilt before we return.  Because, after we return, the channel
 	 * could get destroyed and we don't want our poor autoservice thread to step on
 	 * it after its gone! */
-	chan_list_state = as_chan_list_state;
+	chan_list_state = shard->as_chan_list_state;
 
 	/* Find the entry, but do not free it because it still can be in the
 	   autoservice thread array */
-	AST_LIST_TRAVERSE_SAFE_BEGIN(&aslist, as, list) {
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&shard->aslist, as, list) {
 		if (as->chan == chan) {
 			as->use_count--;
 			if (as->use_count < 1) {
@@ -220,18 +248,18 @@ int ast_autoservice_stop(struct ast_channel *chan)
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
 
-	if (removed && asthread != AST_PTHREADT_NULL) {
-		pthread_kill(asthread, SIGURG);
+	if (removed && shard->asthread != AST_PTHREADT_NULL) {
+		pthread_kill(shard->asthread, SIGURG);
 	}
 
-	AST_LIST_UNLOCK(&aslist);
+	AST_LIST_UNLOCK(&shard->aslist);
 
 	if (!removed) {
 		return 0;
 	}
 
 	/* Wait while autoservice thread rebuilds its list. */
-	while (chan_list_state == as_chan_list_state) {
+	while (chan_list_state == shard->as_chan_list_state) {
 		usleep(1000);
 	}
 
@@ -268,33 +296,45 @@ void ast_autoservice_chan_hangup_peer(struct ast_channel *chan, struct ast_chann
 int ast_autoservice_ignore(struct ast_channel *chan, enum ast_frame_type ftype)
 {
 	struct asent *as;
+	struct autoservice_shard *shard = shard_for_channel(chan);
 	int res = -1;
 
-	AST_LIST_LOCK(&aslist);
-	AST_LIST_TRAVERSE(&aslist, as, list) {
+	AST_LIST_LOCK(&shard->aslist);
+	AST_LIST_TRAVERSE(&shard->aslist, as, list) {
 		if (as->chan == chan) {
 			res = 0;
 			as->ignore_frame_types |= (1 << ftype);
 			break;
 		}
 	}
-	AST_LIST_UNLOCK(&aslist);
+	AST_LIST_UNLOCK(&shard->aslist);
 	return res;
 }
 
 static void autoservice_shutdown(void)
 {
-	pthread_t th = asthread;
+	int i;
+
 	asexit = 1;
-	if (th != AST_PTHREADT_NULL) {
-		ast_cond_signal(&as_cond);
-		pthread_kill(th, SIGURG);
-		pthread_join(th, NULL);
+	for (i = 0; i < AUTOSERVICE_SHARDS; i++) {
+		pthread_t th = shards[i].asthread;
+
+		if (th != AST_PTHREADT_NULL) {
+			ast_cond_signal(&shards[i].as_cond);
+			pthread_kill(th, SIGURG);
+			pthread_join(th, NULL);
+		}
 	}
 }
 
 void ast_autoservice_init(void)
 {
+	int i;
+
 	ast_register_cleanup(autoservice_shutdown);
-	ast_cond_init(&as_cond, NULL);
+	for (i = 0; i < AUTOSERVICE_SHARDS; i++) {
+		AST_LIST_HEAD_INIT(&shards[i].aslist);
+		ast_cond_init(&shards[i].as_cond, NULL);
+		shards[i].asthread = AST_PTHREADT_NULL;
+	}
 }
@@ -691,6 +691,9 @@ static void destroy_bridge(void *obj)
 
 	bridge->callid = 0;
 
+	ao2_cleanup(bridge->snapshot_channels);
+	bridge->snapshot_channels = NULL;
+
 	cleanup_video_mode(bridge);
 
 	stasis_cp_single_unsubscribe(bridge->topics);
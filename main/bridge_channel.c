@@ -951,10 +951,36 @@ static void bridge_frame_free(struct ast_frame *frame)
 	ast_frfree(frame);
 }
 
+/*!
+ * \internal
+ * \brief Put the coalesced wr_queue alert in flight if it is not already.
+ * \since 14.0.0
+ *
+ * \param bridge_channel Channel with frames waiting in its wr_queue.
+ *
+ * \note This function assumes bridge_channel is locked.
+ *
+ * \return Nothing
+ */
+static void bridge_channel_write_wr_queue_alert(struct ast_bridge_channel *bridge_channel)
+{
+	char nudge = 0;
+
+	if (bridge_channel->alert_armed) {
+		/* The channel thread is already scheduled to drain the queue. */
+		return;
+	}
+	if (write(bridge_channel->alert_pipe[1], &nudge, sizeof(nudge)) != sizeof(nudge)) {
+		ast_log(LOG_ERROR, "We couldn't write alert pipe for %p(%s)... something is VERY wrong\n",
+			bridge_channel, ast_channel_name(bridge_channel->chan));
+		return;
+	}
+	bridge_channel->alert_armed = 1;
+}
+
 int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
 {
 	struct ast_frame *dup;
-	char nudge = 0;
 
 	if (bridge_channel->suspended
 		/* Also defer DTMF frames. */
@@ -983,10 +1009,7 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 	}
 
 	AST_LIST_INSERT_TAIL(&bridge_channel->wr_queue, dup, frame_list);
-	if (write(bridge_channel->alert_pipe[1], &nudge, sizeof(nudge)) != sizeof(nudge)) {
-		ast_log(LOG_ERROR, "We couldn't write alert pipe for %p(%s)... something is VERY wrong\n",
-			bridge_channel, ast_channel_name(bridge_channel->chan));
-	}
+	bridge_channel_write_wr_queue_alert(bridge_channel);
 	ast_bridge_channel_unlock(bridge_channel);
 	return 0;
 }
@@ -1624,6 +1647,28 @@ void ast_bridge_channel_feature_digit_add(struct ast_bridge_channel *bridge_chan
 	}
 }
 
+/*!
+ * \internal
+ * \brief Rearm the coalesced wr_queue alert if frames are waiting.
+ * \since 14.0.0
+ *
+ * \param bridge_channel Channel that finished collecting a DTMF hook sequence.
+ *
+ * Bridge action frames deferred during DTMF collection do not keep an
+ * alert in flight, so once collection ends the alert must be put back
+ * for anything still in the queue.
+ *
+ * \return Nothing
+ */
+static void bridge_channel_rearm_wr_queue_alert(struct ast_bridge_channel *bridge_channel)
+{
+	ast_bridge_channel_lock(bridge_channel);
+	if (!AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
+		bridge_channel_write_wr_queue_alert(bridge_channel);
+	}
+	ast_bridge_channel_unlock(bridge_channel);
+}
+
 void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel, int digit)
 {
 	struct ast_bridge_features *features = bridge_channel->features;
@@ -1707,6 +1752,7 @@ void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel,
 			if (bridge_channel->chan && ast_check_hangup_locked(bridge_channel->chan)) {
 				ast_bridge_channel_kick(bridge_channel, 0);
 				bridge_channel->dtmf_hook_state.collected[0] = '\0';
+				bridge_channel_rearm_wr_queue_alert(bridge_channel);
 				return;
 			}
 
@@ -1715,6 +1761,7 @@ void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel,
 			   is already in the buffer */
 			dtmf_len = strlen(bridge_channel->dtmf_hook_state.collected);
 			if (!dtmf_len) {
+				bridge_channel_rearm_wr_queue_alert(bridge_channel);
 				return;
 			}
 		}
@@ -1732,6 +1779,7 @@ void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel,
 			bridge_channel->dtmf_hook_state.collected);
 	}
 	bridge_channel->dtmf_hook_state.collected[0] = '\0';
+	bridge_channel_rearm_wr_queue_alert(bridge_channel);
 
 	ast_test_suite_event_notify("FEATURE_DETECTION", "Result: fail");
 }
@@ -2077,6 +2125,9 @@ void bridge_channel_internal_pull(struct ast_bridge_channel *bridge_channel)
 	}
 	--bridge->num_channels;
 	AST_LIST_REMOVE(&bridge->channels, bridge_channel, entry);
+	/* Membership changed so snapshots may no longer share the cached list. */
+	ao2_cleanup(bridge->snapshot_channels);
+	bridge->snapshot_channels = NULL;
 
 	bridge_channel_dissolve_check(bridge_channel);
 	bridge->v_table->pull(bridge, bridge_channel);
@@ -2147,6 +2198,9 @@ int bridge_channel_internal_push_full(struct ast_bridge_channel *bridge_channel,
 	bridge_channel->just_joined = 1;
 	AST_LIST_INSERT_TAIL(&bridge->channels, bridge_channel, entry);
 	++bridge->num_channels;
+	/* Membership changed so snapshots may no longer share the cached list. */
+	ao2_cleanup(bridge->snapshot_channels);
+	bridge->snapshot_channels = NULL;
 	if (ast_test_flag(&bridge_channel->features->feature_flags, AST_BRIDGE_CHANNEL_FLAG_LONELY)) {
 		++bridge->num_lonely;
 	}
@@ -2274,6 +2328,38 @@ static void bridge_channel_read_wr_queue_alert(struct ast_bridge_channel *bridge
 	}
 }
 
+/*!
+ * \internal
+ * \brief Determine if the wr_queue has a frame that can be processed now.
+ * \since 14.0.0
+ *
+ * \param bridge_channel Channel whose wr_queue is checked.
+ *
+ * \note This function assumes bridge_channel is locked.
+ *
+ * \retval 0 if the queue is empty or holds only deferred frames.
+ * \retval non-zero if a frame is ready to be processed.
+ */
+static int bridge_channel_wr_queue_frame_ready(struct ast_bridge_channel *bridge_channel)
+{
+	struct ast_frame *fr;
+
+	if (!bridge_channel->dtmf_hook_state.collected[0]) {
+		return !AST_LIST_EMPTY(&bridge_channel->wr_queue);
+	}
+	AST_LIST_TRAVERSE(&bridge_channel->wr_queue, fr, frame_list) {
+		switch (fr->frametype) {
+		case AST_FRAME_BRIDGE_ACTION:
+		case AST_FRAME_BRIDGE_ACTION_SYNC:
+			/* These are deferred while DTMF is collected. */
+			break;
+		default:
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Handle bridge channel write frame to channel.
@@ -2290,13 +2376,14 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 
 	ast_bridge_channel_lock(bridge_channel);
 
-	/* It's not good to have unbalanced frames and alert_pipe alerts. */
+	/* It's not good to have an alert in flight without any frames. */
 	ast_assert(!AST_LIST_EMPTY(&bridge_channel->wr_queue));
 	if (AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
 		/* No frame, flush the alert pipe of excess alerts. */
 		ast_log(LOG_WARNING, "Weird.  No frame from bridge for %s to process?\n",
 			ast_channel_name(bridge_channel->chan));
 		bridge_channel_read_wr_queue_alert(bridge_channel);
+		bridge_channel->alert_armed = 0;
 		ast_bridge_channel_unlock(bridge_channel);
 		return;
 	}
@@ -2312,20 +2399,27 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 				break;
 			}
 		}
-		bridge_channel_read_wr_queue_alert(bridge_channel);
 		AST_LIST_REMOVE_CURRENT(frame_list);
 		break;
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
 
+	/*
+	 * The alert is coalesced so only swallow it once nothing more is
+	 * ready; that stops the poll loop waking for frames that cannot be
+	 * processed yet.  Ending DTMF collection rearms the alert for any
+	 * frames that were deferred.
+	 */
+	if (!bridge_channel_wr_queue_frame_ready(bridge_channel)) {
+		bridge_channel_read_wr_queue_alert(bridge_channel);
+		bridge_channel->alert_armed = 0;
+	}
+
 	ast_bridge_channel_unlock(bridge_channel);
 	if (!fr) {
-		/*
-		 * Wait some to reduce CPU usage from a tight loop
-		 * without any wait because we only have deferred
-		 * frames in the wr_queue.
-		 */
-		usleep(1);
+		/* Only deferred frames are in the wr_queue.  The alert was
+		 * swallowed above so we sleep until new work or the DTMF
+		 * interdigit timeout arrives instead of spinning. */
 		return;
 	}
 
@@ -2361,11 +2455,15 @@ static struct ast_frame *bridge_handle_dtmf(struct ast_bridge_channel *bridge_ch
 	/*
 	 * See if we are already matching a DTMF feature hook sequence or
 	 * if this DTMF matches the beginning of any DTMF feature hooks.
+	 * Checking the hook count first keeps channels without any DTMF
+	 * features (the usual case) from taking the container lock and
+	 * searching it for every digit.
 	 */
 	dtmf[0] = frame->subclass.integer;
 	dtmf[1] = '\0';
 	if (bridge_channel->dtmf_hook_state.collected[0]
-		|| (hook = ao2_find(features->dtmf_hooks, dtmf, OBJ_SEARCH_PARTIAL_KEY))) {
+		|| (ao2_container_count(features->dtmf_hooks)
+			&& (hook = ao2_find(features->dtmf_hooks, dtmf, OBJ_SEARCH_PARTIAL_KEY)))) {
 		enum ast_frame_type frametype = frame->frametype;
 
 		bridge_frame_free(frame);
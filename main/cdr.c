@@ -289,6 +289,9 @@ struct cdr_beitem {
 	char name[20];
 	char desc[80];
 	ast_cdrbe be;
+	/*! Optional framing callbacks bracketing each submitted batch */
+	ast_cdrbe_batch batch_begin;
+	ast_cdrbe_batch batch_end;
 	AST_RWLIST_ENTRY(cdr_beitem) list;
 	int suspended:1;
 };
@@ -315,6 +318,9 @@ static struct cdr_batch {
 /*! \brief The global sequence counter used for CDRs */
 static int global_cdr_sequence =  0;
 
+/*! \brief Taskprocessor for posting finalized records to the backends */
+static struct ast_taskprocessor *cdr_post_taskprocessor;
+
 /*! \brief Scheduler items */
 static struct ast_sched_context *sched;
 static int cdr_sched = -1;
@@ -1123,9 +1129,9 @@ static struct ast_cdr *cdr_object_create_public_records(struct cdr_object *cdr)
 			continue;
 		}
 
-		cdr_copy = ast_calloc(1, sizeof(*cdr_copy));
+		cdr_copy = ast_cdr_alloc();
 		if (!cdr_copy) {
-			ast_free(pub_cdr);
+			ast_cdr_free(pub_cdr);
 			return NULL;
 		}
 
@@ -2700,7 +2706,8 @@ int ast_cdr_backend_unsuspend(const char *name)
 	return success;
 }
 
-static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be)
+static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be,
+	ast_cdrbe_batch batch_begin, ast_cdrbe_batch batch_end)
 {
 	struct cdr_beitem *i = NULL;
 
@@ -2725,6 +2732,8 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 		return -1;
 
 	i->be = be;
+	i->batch_begin = batch_begin;
+	i->batch_end = batch_end;
 	ast_copy_string(i->name, name, sizeof(i->name));
 	ast_copy_string(i->desc, desc, sizeof(i->desc));
 
@@ -2736,12 +2745,18 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register(&be_list, name, desc, be);
+	return cdr_generic_register(&be_list, name, desc, be, NULL, NULL);
+}
+
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be,
+	ast_cdrbe_batch batch_begin, ast_cdrbe_batch batch_end)
+{
+	return cdr_generic_register(&be_list, name, desc, be, batch_begin, batch_end);
 }
 
 int ast_cdr_modifier_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be);
+	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be, NULL, NULL);
 }
 
 static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *name)
@@ -3201,13 +3216,74 @@ int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf,
 	return total;
 }
 
+/*
+ * Every dispatched call leg materializes a struct ast_cdr for the
+ * backends and frees it again moments later, so finalized records are
+ * parked on a freelist (chained through their own next pointers) and
+ * handed back out by ast_cdr_alloc() instead of churning the allocator.
+ * Records are parked with their variables already freed and are zeroed
+ * on the way out, so a recycled record is indistinguishable from a
+ * calloc'd one. The pool is bypassed when memory debugging is compiled
+ * in so allocations stay attributed to their owners.
+ */
+#if !defined(__AST_DEBUG_MALLOC)
+
+/*! \brief Maximum number of finalized CDR records kept for reuse */
+#define CDR_RECORD_POOL_SIZE 256
+
+static struct ast_cdr *cdr_record_pool;
+static int cdr_record_pool_size;
+AST_MUTEX_DEFINE_STATIC(cdr_record_pool_lock);
+
+/*! \brief Park a finalized record for reuse, or free it if the pool is full */
+static void cdr_record_release(struct ast_cdr *cdr)
+{
+	ast_mutex_lock(&cdr_record_pool_lock);
+	if (cdr_record_pool_size < CDR_RECORD_POOL_SIZE) {
+		cdr->next = cdr_record_pool;
+		cdr_record_pool = cdr;
+		++cdr_record_pool_size;
+		cdr = NULL;
+	}
+	ast_mutex_unlock(&cdr_record_pool_lock);
+
+	ast_free(cdr);
+}
+
+/*! \brief Release everything parked in the record pool */
+static void cdr_record_pool_flush(void)
+{
+	struct ast_cdr *cdr;
+
+	ast_mutex_lock(&cdr_record_pool_lock);
+	while ((cdr = cdr_record_pool)) {
+		cdr_record_pool = cdr->next;
+		ast_free(cdr);
+	}
+	cdr_record_pool_size = 0;
+	ast_mutex_unlock(&cdr_record_pool_lock);
+}
+
+#else
+
+static void cdr_record_release(struct ast_cdr *cdr)
+{
+	ast_free(cdr);
+}
+
+static void cdr_record_pool_flush(void)
+{
+}
+
+#endif	/* !defined(__AST_DEBUG_MALLOC) */
+
 void ast_cdr_free(struct ast_cdr *cdr)
 {
 	while (cdr) {
 		struct ast_cdr *next = cdr->next;
 
 		free_variables(&cdr->varshead);
-		ast_free(cdr);
+		cdr_record_release(cdr);
 		cdr = next;
 	}
 }
@@ -3216,6 +3292,20 @@ struct ast_cdr *ast_cdr_alloc(void)
 {
 	struct ast_cdr *x;
 
+#if !defined(__AST_DEBUG_MALLOC)
+	ast_mutex_lock(&cdr_record_pool_lock);
+	if ((x = cdr_record_pool)) {
+		cdr_record_pool = x->next;
+		--cdr_record_pool_size;
+	}
+	ast_mutex_unlock(&cdr_record_pool_lock);
+
+	if (x) {
+		memset(x, 0, sizeof(*x));
+		return x;
+	}
+#endif
+
 	x = ast_calloc(1, sizeof(*x));
 	return x;
 }
@@ -3515,11 +3605,38 @@ static int init_batch(void)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Run the batch framing callbacks of all active backends.
+ *
+ * Backends registered with \ref ast_cdr_register_batch() use these
+ * brackets to group the individual records of a batch into one flush
+ * (a single transaction or write) instead of one per record.
+ *
+ * \param ending Zero before the batch records are posted, non-zero after.
+ */
+static void post_batch_frame(int ending)
+{
+	struct cdr_beitem *i;
+
+	AST_RWLIST_RDLOCK(&be_list);
+	AST_RWLIST_TRAVERSE(&be_list, i, list) {
+		ast_cdrbe_batch callback = ending ? i->batch_end : i->batch_begin;
+
+		if (!i->suspended && callback) {
+			callback();
+		}
+	}
+	AST_RWLIST_UNLOCK(&be_list);
+}
+
 static void *do_batch_backend_process(void *data)
 {
 	struct cdr_batch_item *processeditem;
 	struct cdr_batch_item *batchitem = data;
 
+	post_batch_frame(0);
+
 	/* Push each CDR into storage mechanism(s) and free all the memory */
 	while (batchitem) {
 		post_cdr(batchitem->cdr);
@@ -3529,6 +3646,8 @@ static void *do_batch_backend_process(void *data)
 		ast_free(processeditem);
 	}
 
+	post_batch_frame(1);
+
 	return NULL;
 }
 
@@ -3594,6 +3713,24 @@ static void submit_unscheduled_batch(void)
 	ast_mutex_unlock(&cdr_pending_lock);
 }
 
+/*!
+ * \internal
+ * \brief Taskprocessor callback posting a finalized record to the backends.
+ *
+ * Backends often block on disk or database I/O, so simple mode posts
+ * records from this taskprocessor instead of the message router thread
+ * that runs the CDR state machine.  Using a single taskprocessor keeps
+ * the records arriving at the backends in dispatch order.
+ */
+static int post_cdr_task(void *data)
+{
+	struct ast_cdr *cdr = data;
+
+	post_cdr(cdr);
+	ast_cdr_free(cdr);
+	return 0;
+}
+
 static void cdr_detach(struct ast_cdr *cdr)
 {
 	struct cdr_batch_item *newtail;
@@ -3614,8 +3751,11 @@ static void cdr_detach(struct ast_cdr *cdr)
 
 	/* post stuff immediately if we are not in batch mode, this is legacy behaviour */
 	if (!ast_test_flag(&mod_cfg->general->settings, CDR_BATCHMODE)) {
-		post_cdr(cdr);
-		ast_cdr_free(cdr);
+		if (!cdr_post_taskprocessor
+			|| ast_taskprocessor_push(cdr_post_taskprocessor, post_cdr_task, cdr)) {
+			post_cdr(cdr);
+			ast_cdr_free(cdr);
+		}
 		return;
 	}
 
@@ -4133,6 +4273,9 @@ static void cdr_engine_shutdown(void)
 	ao2_callback(active_cdrs_by_channel, OBJ_NODATA, cdr_object_dispatch_all_cb,
 		NULL);
 	finalize_batch_mode();
+	/* Drains any queued simple mode posts before the backends go away */
+	ast_taskprocessor_unreference(cdr_post_taskprocessor);
+	cdr_post_taskprocessor = NULL;
 	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
 	ast_sched_context_destroy(sched);
 	sched = NULL;
@@ -4145,6 +4288,8 @@ static void cdr_engine_shutdown(void)
 	ao2_container_unregister("cdrs_by_channel");
 	ao2_ref(active_cdrs_by_channel, -1);
 	active_cdrs_by_channel = NULL;
+
+	cdr_record_pool_flush();
 }
 
 static void cdr_enable_batch_mode(struct ast_cdr_config *config)
@@ -4260,6 +4405,12 @@ int ast_cdr_engine_init(void)
 		return -1;
 	}
 
+	cdr_post_taskprocessor = ast_taskprocessor_get("cdr_engine", TPS_REF_DEFAULT);
+	if (!cdr_post_taskprocessor) {
+		ast_log(LOG_ERROR, "Unable to create CDR post taskprocessor.\n");
+		return -1;
+	}
+
 	ast_cli_register_multiple(cli_commands, ARRAY_LEN(cli_commands));
 	ast_register_cleanup(cdr_engine_cleanup);
 	ast_register_atexit(cdr_engine_shutdown);
@@ -529,6 +529,9 @@ enum ast_cel_event_type ast_cel_str_to_event_type(const char *name)
 	return AST_CEL_INVALID_VALUE;
 }
 
+/*! \brief Bit in the tracked event set corresponding to a CEL event type */
+#define CEL_EVENT_BIT(event_type)	((int64_t) 1 << (event_type))
+
 static int ast_cel_track_event(enum ast_cel_event_type et)
 {
 	RAII_VAR(struct cel_config *, cfg, ao2_global_obj_ref(cel_configs), ao2_cleanup);
@@ -537,7 +540,22 @@ static int ast_cel_track_event(enum ast_cel_event_type et)
 		return 0;
 	}
 
-	return (cfg->general->events & ((int64_t) 1 << et)) ? 1 : 0;
+	return (cfg->general->events & CEL_EVENT_BIT(et)) ? 1 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Get the set of events currently being tracked.
+ */
+static int64_t cel_tracked_events(void)
+{
+	RAII_VAR(struct cel_config *, cfg, ao2_global_obj_ref(cel_configs), ao2_cleanup);
+
+	if (!cfg || !cfg->general) {
+		return 0;
+	}
+
+	return cfg->general->events;
 }
 
 static int events_handler(const struct aco_option *opt, struct ast_variable *var, void *obj)
@@ -1005,15 +1023,20 @@ static void cel_channel_state_change(
 	is_hungup = ast_test_flag(&new_snapshot->flags, AST_FLAG_DEAD) ? 1 : 0;
 
 	if (!was_hungup && is_hungup) {
-		struct ast_json *extra;
+		/* Always pull the stashed dialstatus so the store does not
+		 * accumulate entries when HANGUP is not tracked. */
 		struct cel_dialstatus *dialstatus = get_dialstatus(new_snapshot->uniqueid);
 
-		extra = ast_json_pack("{s: i, s: s, s: s}",
-			"hangupcause", new_snapshot->hangupcause,
-			"hangupsource", new_snapshot->hangupsource,
-			"dialstatus", dialstatus ? dialstatus->dialstatus : "");
-		cel_report_event(new_snapshot, AST_CEL_HANGUP, NULL, extra, NULL);
-		ast_json_unref(extra);
+		if (ast_cel_track_event(AST_CEL_HANGUP)) {
+			struct ast_json *extra;
+
+			extra = ast_json_pack("{s: i, s: s, s: s}",
+				"hangupcause", new_snapshot->hangupcause,
+				"hangupsource", new_snapshot->hangupsource,
+				"dialstatus", dialstatus ? dialstatus->dialstatus : "");
+			cel_report_event(new_snapshot, AST_CEL_HANGUP, NULL, extra, NULL);
+			ast_json_unref(extra);
+		}
 		ao2_cleanup(dialstatus);
 		return;
 	}
@@ -1583,10 +1606,16 @@ static int create_subscriptions(void)
 
 /*!
  * \brief Create the Stasis message router and routes for CEL
+ *
+ * Routes are only registered for message types that can produce an
+ * event in the tracked event set, so disabled event types never
+ * materialize a message in the CEL taskprocessor at all.  The routes
+ * are rebuilt whenever the tracked event set changes.
  */
 static int create_routes(void)
 {
 	int ret = 0;
+	int64_t events = cel_tracked_events();
 
 	cel_state_router = stasis_message_router_create(cel_aggregation_topic);
 	if (!cel_state_router) {
@@ -1595,55 +1624,85 @@ static int create_routes(void)
 	stasis_message_router_set_congestion_limits(cel_state_router, -1,
 		6 * AST_TASKPROCESSOR_HIGH_WATER_LEVEL);
 
-	ret |= stasis_message_router_add(cel_state_router,
-		stasis_cache_update_type(),
-		cel_snapshot_update_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_channel_dial_type(),
-		cel_dial_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_channel_entered_bridge_type(),
-		cel_bridge_enter_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_channel_left_bridge_type(),
-		cel_bridge_leave_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_parked_call_type(),
-		cel_parking_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		cel_generic_type(),
-		cel_generic_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_blind_transfer_type(),
-		cel_blind_transfer_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_attended_transfer_type(),
-		cel_attended_transfer_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_call_pickup_type(),
-		cel_pickup_cb,
-		NULL);
-
-	ret |= stasis_message_router_add(cel_state_router,
-		ast_local_optimization_end_type(),
-		cel_local_cb,
-		NULL);
+	if (events & (CEL_EVENT_BIT(AST_CEL_CHANNEL_START)
+		| CEL_EVENT_BIT(AST_CEL_CHANNEL_END)
+		| CEL_EVENT_BIT(AST_CEL_ANSWER)
+		| CEL_EVENT_BIT(AST_CEL_HANGUP)
+		| CEL_EVENT_BIT(AST_CEL_APP_START)
+		| CEL_EVENT_BIT(AST_CEL_APP_END)
+		| CEL_EVENT_BIT(AST_CEL_LINKEDID_END))) {
+		ret |= stasis_message_router_add(cel_state_router,
+			stasis_cache_update_type(),
+			cel_snapshot_update_cb,
+			NULL);
+	}
+
+	/* The dial handler also stashes the dialstatus reported in the
+	 * HANGUP event's extra data. */
+	if (events & (CEL_EVENT_BIT(AST_CEL_FORWARD)
+		| CEL_EVENT_BIT(AST_CEL_HANGUP))) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_channel_dial_type(),
+			cel_dial_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_BRIDGE_ENTER)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_channel_entered_bridge_type(),
+			cel_bridge_enter_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_BRIDGE_EXIT)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_channel_left_bridge_type(),
+			cel_bridge_leave_cb,
+			NULL);
+	}
+
+	if (events & (CEL_EVENT_BIT(AST_CEL_PARK_START)
+		| CEL_EVENT_BIT(AST_CEL_PARK_END))) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_parked_call_type(),
+			cel_parking_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_USER_DEFINED)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			cel_generic_type(),
+			cel_generic_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_BLINDTRANSFER)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_blind_transfer_type(),
+			cel_blind_transfer_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_ATTENDEDTRANSFER)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_attended_transfer_type(),
+			cel_attended_transfer_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_PICKUP)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_call_pickup_type(),
+			cel_pickup_cb,
+			NULL);
+	}
+
+	if (events & CEL_EVENT_BIT(AST_CEL_LOCAL_OPTIMIZE)) {
+		ret |= stasis_message_router_add(cel_state_router,
+			ast_local_optimization_end_type(),
+			cel_local_cb,
+			NULL);
+	}
 
 	if (ret) {
 		ast_log(AST_LOG_ERROR, "Failed to register for Stasis messages\n");
@@ -1794,6 +1853,7 @@ int ast_cel_engine_init(void)
 int ast_cel_engine_reload(void)
 {
 	unsigned int was_enabled = ast_cel_check_enabled();
+	int64_t was_events = cel_tracked_events();
 	unsigned int is_enabled;
 
 	if (aco_process_config(&cel_cfg_info, 1) == ACO_PROCESS_ERROR) {
@@ -1808,6 +1868,12 @@ int ast_cel_engine_reload(void)
 		}
 	} else if (was_enabled && !is_enabled) {
 		destroy_routes();
+	} else if (is_enabled && was_events != cel_tracked_events()) {
+		/* The registered routes depend on the tracked event set. */
+		destroy_routes();
+		if (create_routes()) {
+			return -1;
+		}
 	}
 
 	ast_verb(3, "CEL logging %sabled.\n", is_enabled ? "en" : "dis");
@@ -1855,11 +1921,13 @@ void ast_cel_set_config(struct ast_cel_general_config *config)
 {
 	int was_enabled;
 	int is_enabled;
+	int64_t was_events;
 	struct ast_cel_general_config *cleanup_config;
 	struct cel_config *mod_cfg = ao2_global_obj_ref(cel_configs);
 
 	if (mod_cfg) {
 		was_enabled = ast_cel_check_enabled();
+		was_events = cel_tracked_events();
 
 		cleanup_config = mod_cfg->general;
 		ao2_bump(config);
@@ -1871,6 +1939,10 @@ void ast_cel_set_config(struct ast_cel_general_config *config)
 			create_routes();
 		} else if (was_enabled && !is_enabled) {
 			destroy_routes();
+		} else if (is_enabled && was_events != cel_tracked_events()) {
+			/* The registered routes depend on the tracked event set. */
+			destroy_routes();
+			create_routes();
 		}
 
 		ao2_ref(mod_cfg, -1);
@@ -40,6 +40,7 @@
 #include "asterisk/pbx.h"
 #include "asterisk/frame.h"
 #include "asterisk/mod_format.h"
+#include "asterisk/module.h"
 #include "asterisk/sched.h"
 #include "asterisk/channel.h"
 #include "asterisk/musiconhold.h"
@@ -69,10 +70,12 @@
 #include "asterisk/data.h"
 #include "asterisk/channel_internal.h"
 #include "asterisk/features.h"
+#include "asterisk/pickup.h"
 #include "asterisk/bridge.h"
 #include "asterisk/test.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/sdt.h"
 
 /*** DOCUMENTATION
  ***/
@@ -612,14 +615,11 @@ void ast_channel_unregister(const struct ast_channel_tech *tech)
 	AST_RWLIST_UNLOCK(&backends);
 }
 
-/*! \brief Get handle to channel driver based on name */
-const struct ast_channel_tech *ast_get_channel_tech(const char *name)
+static const struct ast_channel_tech *get_channel_tech_nolock(const char *name)
 {
 	struct chanlist *chanls;
 	const struct ast_channel_tech *ret = NULL;
 
-	AST_RWLIST_RDLOCK(&backends);
-
 	AST_RWLIST_TRAVERSE(&backends, chanls, list) {
 		if (!strcasecmp(name, chanls->tech->type)) {
 			ret = chanls->tech;
@@ -627,8 +627,26 @@ const struct ast_channel_tech *ast_get_channel_tech(const char *name)
 		}
 	}
 
+	return ret;
+}
+
+/*! \brief Get handle to channel driver based on name */
+const struct ast_channel_tech *ast_get_channel_tech(const char *name)
+{
+	const struct ast_channel_tech *ret;
+
+	AST_RWLIST_RDLOCK(&backends);
+	ret = get_channel_tech_nolock(name);
 	AST_RWLIST_UNLOCK(&backends);
 
+	if (!ret && !ast_module_load_for("channel", name)) {
+		/* A module declared to provide the technology was just
+		 * loaded, so it may be registered now. */
+		AST_RWLIST_RDLOCK(&backends);
+		ret = get_channel_tech_nolock(name);
+		AST_RWLIST_UNLOCK(&backends);
+	}
+
 	return ret;
 }
 
@@ -790,6 +808,160 @@ static int does_id_conflict(const char *uniqueid)
 	return 0;
 }
 
+/*!
+ * \brief Recycled channel resources.
+ *
+ * Every channel opens a timing source and creates a scheduler context
+ * when it is allocated and tears both down again when it is destroyed.
+ * At high call setup rates those two steps dominate the allocator and
+ * syscall cost of channel churn, so instead of rebuilding them for each
+ * call we keep small freelists of idle timers and empty scheduler
+ * contexts and hand them to the next channel as-is.
+ *
+ * Pooled timers are quiesced (rate zero, continuous mode off) before
+ * they are parked.  Scheduler contexts are only pooled when they have
+ * completely drained; one with anything still scheduled belongs to the
+ * dying channel and takes the normal destroy path.
+ *
+ * \note A pooled timer keeps a use count on the timing module that
+ * provided it until the pool is flushed at shutdown.
+ */
+#define CHANNEL_POOL_SIZE 32
+
+struct chan_pool_timer {
+	struct ast_timer *timer;
+	AST_LIST_ENTRY(chan_pool_timer) list;
+};
+
+struct chan_pool_sched {
+	struct ast_sched_context *sched;
+	AST_LIST_ENTRY(chan_pool_sched) list;
+};
+
+static AST_LIST_HEAD_STATIC(pool_timers, chan_pool_timer);
+static AST_LIST_HEAD_STATIC(pool_scheds, chan_pool_sched);
+static int pool_timers_size;
+static int pool_scheds_size;
+
+/*! \brief Get a timer for a new channel, recycled if possible */
+static struct ast_timer *channel_timer_get(void)
+{
+	struct chan_pool_timer *entry;
+	struct ast_timer *timer;
+
+	AST_LIST_LOCK(&pool_timers);
+	entry = AST_LIST_REMOVE_HEAD(&pool_timers, list);
+	if (entry) {
+		--pool_timers_size;
+	}
+	AST_LIST_UNLOCK(&pool_timers);
+
+	if (!entry) {
+		return ast_timer_open();
+	}
+	timer = entry->timer;
+	ast_free(entry);
+	return timer;
+}
+
+/*! \brief Park a dying channel's timer for reuse, or close it if the pool is full */
+static void channel_timer_put(struct ast_timer *timer)
+{
+	struct chan_pool_timer *entry;
+
+	/* Return the timer to its idle state before the next channel sees it */
+	ast_timer_set_rate(timer, 0);
+	ast_timer_disable_continuous(timer);
+
+	if (!(entry = ast_malloc(sizeof(*entry)))) {
+		ast_timer_close(timer);
+		return;
+	}
+	entry->timer = timer;
+
+	AST_LIST_LOCK(&pool_timers);
+	if (pool_timers_size < CHANNEL_POOL_SIZE) {
+		AST_LIST_INSERT_HEAD(&pool_timers, entry, list);
+		++pool_timers_size;
+		entry = NULL;
+	}
+	AST_LIST_UNLOCK(&pool_timers);
+
+	if (entry) {
+		ast_timer_close(timer);
+		ast_free(entry);
+	}
+}
+
+/*! \brief Get a scheduler context for a new channel, recycled if possible */
+static struct ast_sched_context *channel_sched_get(void)
+{
+	struct chan_pool_sched *entry;
+	struct ast_sched_context *sched;
+
+	AST_LIST_LOCK(&pool_scheds);
+	entry = AST_LIST_REMOVE_HEAD(&pool_scheds, list);
+	if (entry) {
+		--pool_scheds_size;
+	}
+	AST_LIST_UNLOCK(&pool_scheds);
+
+	if (!entry) {
+		return ast_sched_context_create();
+	}
+	sched = entry->sched;
+	ast_free(entry);
+	return sched;
+}
+
+/*! \brief Park a dying channel's scheduler context for reuse if it drained */
+static void channel_sched_put(struct ast_sched_context *sched)
+{
+	struct chan_pool_sched *entry;
+
+	if (ast_sched_wait(sched) != -1 || !(entry = ast_malloc(sizeof(*entry)))) {
+		ast_sched_context_destroy(sched);
+		return;
+	}
+	entry->sched = sched;
+
+	AST_LIST_LOCK(&pool_scheds);
+	if (pool_scheds_size < CHANNEL_POOL_SIZE) {
+		AST_LIST_INSERT_HEAD(&pool_scheds, entry, list);
+		++pool_scheds_size;
+		entry = NULL;
+	}
+	AST_LIST_UNLOCK(&pool_scheds);
+
+	if (entry) {
+		ast_sched_context_destroy(sched);
+		ast_free(entry);
+	}
+}
+
+/*! \brief Release everything parked in the channel resource pools */
+static void channel_pools_flush(void)
+{
+	struct chan_pool_timer *timer_entry;
+	struct chan_pool_sched *sched_entry;
+
+	AST_LIST_LOCK(&pool_timers);
+	while ((timer_entry = AST_LIST_REMOVE_HEAD(&pool_timers, list))) {
+		ast_timer_close(timer_entry->timer);
+		ast_free(timer_entry);
+	}
+	pool_timers_size = 0;
+	AST_LIST_UNLOCK(&pool_timers);
+
+	AST_LIST_LOCK(&pool_scheds);
+	while ((sched_entry = AST_LIST_REMOVE_HEAD(&pool_scheds, list))) {
+		ast_sched_context_destroy(sched_entry->sched);
+		ast_free(sched_entry);
+	}
+	pool_scheds_size = 0;
+	AST_LIST_UNLOCK(&pool_scheds);
+}
+
 /*! \brief Create a new channel structure */
 static struct ast_channel * attribute_malloc __attribute__((format(printf, 15, 0)))
 __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char *cid_name,
@@ -847,7 +1019,7 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	ast_channel_epfd_set(tmp, epoll_create(25));
 #endif
 
-	if (!(schedctx = ast_sched_context_create())) {
+	if (!(schedctx = channel_sched_get())) {
 		ast_log(LOG_WARNING, "Channel allocation failed: Unable to create schedule context\n");
 		return ast_channel_unref(tmp);
 	}
@@ -874,7 +1046,7 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 		}
 	}
 
-	if ((timer = ast_timer_open())) {
+	if ((timer = channel_timer_get())) {
 		ast_channel_timer_set(tmp, timer);
 		if (strcmp(ast_timer_get_name(ast_channel_timer(tmp)), "timerfd")) {
 			needqueue = 0;
@@ -992,6 +1164,9 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 
 	ao2_unlock(channels);
 
+	/* The initial state does not pass through ast_setstate() */
+	ast_pickup_state_changed(tmp);
+
 	if (endpoint) {
 		ast_endpoint_add_channel(endpoint, tmp);
 	}
@@ -1092,6 +1267,9 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 	unsigned int queued_voice_frames = 0;
 	AST_LIST_HEAD_NOLOCK(,ast_frame) frames;
 
+	ast_sdt_probe3(channel_queue_frame, ast_channel_name(chan),
+		fin->frametype, fin->subclass.integer);
+
 	ast_channel_lock(chan);
 
 	/*
@@ -1109,6 +1287,7 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 				 * frame in its place.
 				 */
 				AST_LIST_REMOVE(ast_channel_readq(chan), cur, frame_list);
+				ast_channel_readq(chan)->frames--;
 				ast_frfree(cur);
 
 				/*
@@ -1147,13 +1326,9 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 		}
 	}
 
-	/* Count how many frames exist on the queue */
-	AST_LIST_TRAVERSE(ast_channel_readq(chan), cur, frame_list) {
-		queued_frames++;
-		if (cur->frametype == AST_FRAME_VOICE) {
-			queued_voice_frames++;
-		}
-	}
+	/* The queue keeps cached depth counters so we need not walk it */
+	queued_frames = ast_channel_readq(chan)->frames;
+	queued_voice_frames = ast_channel_readq(chan)->voice_frames;
 
 	if ((queued_frames + new_frames > 128 || queued_voice_frames + new_voice_frames > 96)) {
 		int count = 0;
@@ -1167,6 +1342,10 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 					break;
 				}
 				AST_LIST_REMOVE_CURRENT(frame_list);
+				ast_channel_readq(chan)->frames--;
+				if (cur->frametype == AST_FRAME_VOICE) {
+					ast_channel_readq(chan)->voice_frames--;
+				}
 				ast_frfree(cur);
 			}
 		}
@@ -1182,6 +1361,8 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 		}
 		AST_LIST_APPEND_LIST(ast_channel_readq(chan), &frames, frame_list);
 	}
+	ast_channel_readq(chan)->frames += new_frames;
+	ast_channel_readq(chan)->voice_frames += new_voice_frames;
 
 	if (ast_channel_alert_writable(chan)) {
 		if (ast_channel_alert_write(chan)) {
@@ -1400,11 +1581,16 @@ struct ast_channel_iterator {
 	 * allocated iterator)
 	 */
 	struct ao2_iterator *active_iterator;
+	/* point-in-time snapshot container iterated by "all" iterators so
+	 * enumeration does not contend with the live channels container
+	 */
+	struct ao2_container *snapshot;
 };
 
 struct ast_channel_iterator *ast_channel_iterator_destroy(struct ast_channel_iterator *i)
 {
 	ao2_iterator_destroy(i->active_iterator);
+	ao2_cleanup(i->snapshot);
 	ast_free(i);
 
 	return NULL;
@@ -1458,7 +1644,19 @@ struct ast_channel_iterator *ast_channel_iterator_all_new(void)
 		return NULL;
 	}
 
-	i->simple_iterator = ao2_iterator_init(channels, 0);
+	/*
+	 * Iterate over a point-in-time snapshot of the channels container.
+	 * Cloning only bumps object references, so the live container is
+	 * held for one quick pass instead of being relocked around every
+	 * step of a potentially slow enumeration (CLI, AMI Status).
+	 */
+	i->snapshot = ao2_container_clone(channels, 0);
+	if (!i->snapshot) {
+		ast_free(i);
+		return NULL;
+	}
+
+	i->simple_iterator = ao2_iterator_init(i->snapshot, 0);
 	i->active_iterator = &i->simple_iterator;
 
 	return i;
@@ -1597,6 +1795,7 @@ struct ast_channel *ast_channel_release(struct ast_channel *chan)
 {
 	/* Safe, even if already unlinked. */
 	ao2_unlink(channels, chan);
+	ast_pickup_channel_removed(chan);
 	return ast_channel_unref(chan);
 }
 
@@ -2263,7 +2462,7 @@ static void ast_channel_destructor(void *obj)
 	}
 
 	if (ast_channel_sched(chan)) {
-		ast_sched_context_destroy(ast_channel_sched(chan));
+		channel_sched_put(ast_channel_sched(chan));
 	}
 
 	if (ast_channel_internal_is_finalized(chan)) {
@@ -2301,7 +2500,7 @@ static void ast_channel_destructor(void *obj)
 	/* Close pipes if appropriate */
 	ast_channel_internal_alertpipe_close(chan);
 	if (ast_channel_timer(chan)) {
-		ast_timer_close(ast_channel_timer(chan));
+		channel_timer_put(ast_channel_timer(chan));
 		ast_channel_timer_set(chan, NULL);
 	}
 #ifdef HAVE_EPOLL
@@ -2314,6 +2513,8 @@ static void ast_channel_destructor(void *obj)
 #endif
 	while ((f = AST_LIST_REMOVE_HEAD(ast_channel_readq(chan), frame_list)))
 		ast_frfree(f);
+	ast_channel_readq(chan)->frames = 0;
+	ast_channel_readq(chan)->voice_frames = 0;
 
 	/* loop over the variables list, freeing all data and deleting list items */
 	/* no need to lock the list, as the channel is already locked */
@@ -2413,6 +2614,7 @@ int ast_channel_datastore_inherit(struct ast_channel *from, struct ast_channel *
 				datastore2->data = datastore->info->duplicate ? datastore->info->duplicate(datastore->data) : NULL;
 				datastore2->inheritance = datastore->inheritance == DATASTORE_INHERIT_FOREVER ? DATASTORE_INHERIT_FOREVER : datastore->inheritance - 1;
 				AST_LIST_INSERT_TAIL(ast_channel_datastores(to), datastore2, entry);
+				ast_channel_internal_datastore_map_insert(to, datastore2);
 			}
 		}
 	}
@@ -2424,13 +2626,18 @@ int ast_channel_datastore_add(struct ast_channel *chan, struct ast_datastore *da
 	int res = 0;
 
 	AST_LIST_INSERT_HEAD(ast_channel_datastores(chan), datastore, entry);
+	ast_channel_internal_datastore_map_insert(chan, datastore);
 
 	return res;
 }
 
 int ast_channel_datastore_remove(struct ast_channel *chan, struct ast_datastore *datastore)
 {
-	return AST_LIST_REMOVE(ast_channel_datastores(chan), datastore, entry) ? 0 : -1;
+	if (!AST_LIST_REMOVE(ast_channel_datastores(chan), datastore, entry)) {
+		return -1;
+	}
+	ast_channel_internal_datastore_map_rebuild(chan);
+	return 0;
 }
 
 struct ast_datastore *ast_channel_datastore_find(struct ast_channel *chan, const struct ast_datastore_info *info, const char *uid)
@@ -2440,6 +2647,11 @@ struct ast_datastore *ast_channel_datastore_find(struct ast_channel *chan, const
 	if (info == NULL)
 		return NULL;
 
+	if (uid == NULL
+		&& !ast_channel_internal_datastore_map_find(chan, info, &datastore)) {
+		return datastore;
+	}
+
 	AST_LIST_TRAVERSE(ast_channel_datastores(chan), datastore, entry) {
 		if (datastore->info != info) {
 			continue;
@@ -2556,6 +2768,7 @@ void ast_channel_clear_softhangup(struct ast_channel *chan, int flag)
 		if (fr && fr->frametype == AST_FRAME_CONTROL &&
 				fr->subclass.integer == AST_CONTROL_END_OF_Q) {
 			AST_LIST_REMOVE(ast_channel_readq(chan), fr, frame_list);
+			ast_channel_readq(chan)->frames--;
 			ast_frfree(fr);
 		}
 	}
@@ -2680,6 +2893,7 @@ void ast_hangup(struct ast_channel *chan)
 	 */
 	ast_pbx_hangup_handler_run(chan);
 	ao2_unlink(channels, chan);
+	ast_pickup_channel_removed(chan);
 	ast_channel_lock(chan);
 
 	destroy_hooks(chan);
@@ -3115,10 +3329,14 @@ struct ast_channel *ast_waitfor_nandfds(struct ast_channel **c, int n, int *fds,
 	 */
 	max = 0;
 	for (x = 0; x < n; x++) {
-		for (y = 0; y < AST_MAX_FDS; y++) {
-			fdmap[max].fdno = y;  /* fd y is linked to this pfds */
+		int fd_count = ast_channel_internal_fd_count(c[x]);
+
+		for (y = 0; y < fd_count; y++) {
+			int fdno = ast_channel_internal_fd_which(c[x], y);
+
+			fdmap[max].fdno = fdno;  /* fd fdno is linked to this pfds */
 			fdmap[max].chan = x;  /* channel x is linked to this pfds */
-			max += ast_add_fd(&pfds[max], ast_channel_fd(c[x], y));
+			max += ast_add_fd(&pfds[max], ast_channel_fd(c[x], fdno));
 		}
 		CHECK_BLOCKING(c[x]);
 	}
@@ -3762,6 +3980,8 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio)
 	int prestate;
 	int cause = 0;
 
+	ast_sdt_probe1(channel_read_start, ast_channel_name(chan));
+
 	/* this function is very long so make sure there is only one return
 	 * point at the end (there are only two exceptions to this).
 	 */
@@ -3906,6 +4126,10 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio)
 					} else {
 						AST_LIST_INSERT_TAIL(ast_channel_deferred_readq(chan), f, frame_list);
 						AST_LIST_REMOVE_CURRENT(frame_list);
+						ast_channel_readq(chan)->frames--;
+						if (f->frametype == AST_FRAME_VOICE) {
+							ast_channel_readq(chan)->voice_frames--;
+						}
 					}
 				}
 			}
@@ -3922,6 +4146,10 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio)
 			}
 
 			AST_LIST_REMOVE_CURRENT(frame_list);
+			ast_channel_readq(chan)->frames--;
+			if (f->frametype == AST_FRAME_VOICE) {
+				ast_channel_readq(chan)->voice_frames--;
+			}
 			break;
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
@@ -4380,6 +4608,10 @@ done:
 		ast_channel_audiohooks_set(chan, NULL);
 	}
 	ast_channel_unlock(chan);
+
+	ast_sdt_probe2(channel_read_end, ast_channel_name(chan),
+		f ? f->frametype : 0);
+
 	return f;
 }
 
@@ -6136,11 +6368,13 @@ struct ast_channel *ast_request(const char *type, struct ast_format_cap *request
 	struct ast_channel *c;
 	int res;
 	int foo;
+	int retried = 0;
 
 	if (!cause)
 		cause = &foo;
 	*cause = AST_CAUSE_NOTDEFINED;
 
+retry:
 	if (AST_RWLIST_RDLOCK(&backends)) {
 		ast_log(LOG_WARNING, "Unable to lock technology backend list\n");
 		return NULL;
@@ -6226,9 +6460,17 @@ struct ast_channel *ast_request(const char *type, struct ast_format_cap *request
 		return c;
 	}
 
+	AST_RWLIST_UNLOCK(&backends);
+
+	if (!retried && !ast_module_load_for("channel", type)) {
+		/* A module declared to provide the technology was just
+		 * loaded, so it may be registered now. */
+		retried = 1;
+		goto retry;
+	}
+
 	ast_log(LOG_WARNING, "No channel type registered for '%s'\n", type);
 	*cause = AST_CAUSE_NOSUCHDRIVER;
-	AST_RWLIST_UNLOCK(&backends);
 
 	return NULL;
 }
@@ -6780,6 +7022,16 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 		ast_channel_name(clonechan), ast_channel_state(clonechan),
 		ast_channel_name(original), ast_channel_state(original));
 
+	/*
+	 * Every state, format, party and group change below would
+	 * otherwise publish its own snapshot to stasis, and with many
+	 * AMI/ARI consumers that storm is the dominant cost of a
+	 * masquerade.  Stage both channels so everyone gets a single
+	 * consolidated update per channel once the swap has settled.
+	 */
+	ast_channel_stage_snapshot(original);
+	ast_channel_stage_snapshot(clonechan);
+
 	/*
 	 * Remember the original read/write formats.  We turn off any
 	 * translation on either one
@@ -6846,6 +7098,12 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 				ast_log(LOG_WARNING, "write() failed: %s\n", strerror(errno));
 			}
 		}
+
+		/* The new channel inherited all of the old channel's frames. */
+		ast_channel_readq(original)->frames += ast_channel_readq(clonechan)->frames;
+		ast_channel_readq(original)->voice_frames += ast_channel_readq(clonechan)->voice_frames;
+		ast_channel_readq(clonechan)->frames = 0;
+		ast_channel_readq(clonechan)->voice_frames = 0;
 	}
 
 	/* Swap the raw formats */
@@ -6939,6 +7197,9 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	if (AST_LIST_FIRST(ast_channel_datastores(clonechan))) {
 		AST_LIST_APPEND_LIST(ast_channel_datastores(original), ast_channel_datastores(clonechan), entry);
 	}
+	/* The fixup/breakdown routines and the move invalidate both maps. */
+	ast_channel_internal_datastore_map_rebuild(original);
+	ast_channel_internal_datastore_map_rebuild(clonechan);
 
 	/* Move framehooks over */
 	ast_framehook_list_fixup(clonechan, original);
@@ -7051,6 +7312,12 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_set_flag(ast_channel_flags(clonechan), AST_FLAG_ZOMBIE);
 	ast_queue_frame(clonechan, &ast_null_frame);
 
+	/*
+	 * The clonechan is done changing.  Let its one staged snapshot
+	 * out now; the zombie must not reach its destructor still staged.
+	 */
+	ast_channel_stage_snapshot_done(clonechan);
+
 	ast_channel_unlock(original);
 	ast_channel_unlock(clonechan);
 
@@ -7143,6 +7410,7 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_channel_lock_both(original, clonechan);
 	ast_channel_masq_set(original, NULL);
 	ast_channel_masqr_set(clonechan, NULL);
+	ast_channel_stage_snapshot_done(original);
 	ast_channel_unlock(original);
 	ast_channel_unlock(clonechan);
 
@@ -7223,6 +7491,9 @@ int ast_setstate(struct ast_channel *chan, enum ast_channel_state state)
 
 	ast_channel_state_set(chan, state);
 
+	/* Keep the pickup candidate index in step with the state */
+	ast_pickup_state_changed(chan);
+
 	ast_publish_channel_state(chan);
 
 	/* We have to pass AST_DEVICE_UNKNOWN here because it is entirely possible that the channel driver
@@ -7951,6 +8222,8 @@ struct varshead *ast_channel_get_ari_vars(struct ast_channel *chan)
 
 static void channels_shutdown(void)
 {
+	channel_pools_flush();
+
 	free_external_channelvars(&ami_vars);
 	free_external_channelvars(&ari_vars);
 
@@ -7966,8 +8239,9 @@ static void channels_shutdown(void)
 
 int ast_channels_init(void)
 {
-	channels = ao2_container_alloc(NUM_CHANNEL_BUCKETS,
-			ast_channel_hash_cb, ast_channel_cmp_cb);
+	channels = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+			AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, NUM_CHANNEL_BUCKETS,
+			ast_channel_hash_cb, NULL, ast_channel_cmp_cb);
 	if (!channels) {
 		return -1;
 	}
@@ -10588,6 +10862,7 @@ int ast_channel_get_cc_agent_type(struct ast_channel *chan, char *agent_type, si
 void ast_channel_unlink(struct ast_channel *chan)
 {
 	ao2_unlink(channels, chan);
+	ast_pickup_channel_removed(chan);
 }
 
 struct ast_bridge *ast_channel_get_bridge(const struct ast_channel *chan)
@@ -58,6 +58,17 @@ struct ast_channel_id {
 	char unique_id[AST_MAX_UNIQUEID];	/*!< Unique Identifier */
 };
 
+/*!
+ * \brief Capacity of the inline channel datastore map.
+ *
+ * The map is an open-addressed index over the datastore info pointers so
+ * per-frame datastore lookups do not have to scan the datastore list.
+ * Must be a power of two.  When a channel carries more datastores than
+ * this, or two datastores share the same info, the map is marked invalid
+ * and lookups fall back to scanning the list.
+ */
+#define AST_CHAN_DATASTORE_MAP_SIZE 16
+
 /*!
  * \brief Main Channel structure associated with a channel.
  *
@@ -162,6 +173,7 @@ struct ast_channel {
 	struct timeval dtmf_tv;				/*!< The time that an in process digit began, or the last digit ended */
 	struct ast_hangup_handler_list hangup_handlers;/*!< Hangup handlers on the channel. */
 	struct ast_datastore_list datastores; /*!< Data stores on the channel */
+	struct ast_datastore *datastore_map[AST_CHAN_DATASTORE_MAP_SIZE]; /*!< Open-addressed index of datastores by info pointer */
 	struct ast_autochan_list autochans; /*!< Autochans on the channel */
 	unsigned long insmpl;				/*!< Track the read/written samples for monitor use */
 	unsigned long outsmpl;				/*!< Track the read/written samples for monitor use */
@@ -169,6 +181,12 @@ struct ast_channel {
 	int fds[AST_MAX_FDS];				/*!< File descriptors for channel -- Drivers will poll on
 							 *   these file descriptors, so at least one must be non -1.
 							 *   See \arg \ref AstFileDesc */
+	int fd_count;				/*!< Number of entries in fd_list */
+	int datastore_map_invalid;	/*!< TRUE if datastore_map cannot represent the datastore list */
+	char fd_list[AST_MAX_FDS];		/*!< Compact list of the fds slots currently in use.
+							 *   Maintained by ast_channel_internal_fd_set() so the
+							 *   pollfd build in ast_waitfor_nandfds() only visits
+							 *   slots that actually hold a descriptor. */
 	int softhangup;				/*!< Whether or not we have been hung up...  Do not set this value
 							 *   directly, use ast_softhangup() */
 	int fdno;					/*!< Which fd had an event detected on */
@@ -993,6 +1011,89 @@ struct ast_datastore_list *ast_channel_datastores(struct ast_channel *chan)
 {
 	return &chan->datastores;
 }
+
+/*! \brief Preferred starting slot in the datastore map for an info pointer */
+static unsigned int datastore_map_start(const struct ast_datastore_info *info)
+{
+	/* The low bits of the pointer are zeros from alignment. */
+	return ((unsigned int) ((uintptr_t) info >> 4)) & (AST_CHAN_DATASTORE_MAP_SIZE - 1);
+}
+
+/*!
+ * \internal
+ * \brief Place a datastore into the map.
+ * \retval 0 on success.
+ * \retval -1 if the map is full or already holds the datastore's info.
+ */
+static int datastore_map_insert(struct ast_channel *chan, struct ast_datastore *datastore)
+{
+	unsigned int slot = datastore_map_start(datastore->info);
+	unsigned int idx;
+
+	for (idx = 0; idx < AST_CHAN_DATASTORE_MAP_SIZE; idx++) {
+		if (!chan->datastore_map[slot]) {
+			chan->datastore_map[slot] = datastore;
+			return 0;
+		}
+		if (chan->datastore_map[slot]->info == datastore->info) {
+			/*
+			 * Duplicate info.  Which of the two a lookup returns is
+			 * defined by list order, which the map cannot honor.
+			 */
+			return -1;
+		}
+		slot = (slot + 1) & (AST_CHAN_DATASTORE_MAP_SIZE - 1);
+	}
+	return -1;
+}
+
+void ast_channel_internal_datastore_map_insert(struct ast_channel *chan, struct ast_datastore *datastore)
+{
+	if (chan->datastore_map_invalid) {
+		return;
+	}
+	if (datastore_map_insert(chan, datastore)) {
+		chan->datastore_map_invalid = 1;
+	}
+}
+
+void ast_channel_internal_datastore_map_rebuild(struct ast_channel *chan)
+{
+	struct ast_datastore *datastore;
+
+	memset(chan->datastore_map, 0, sizeof(chan->datastore_map));
+	chan->datastore_map_invalid = 0;
+	AST_LIST_TRAVERSE(&chan->datastores, datastore, entry) {
+		if (datastore_map_insert(chan, datastore)) {
+			chan->datastore_map_invalid = 1;
+			return;
+		}
+	}
+}
+
+int ast_channel_internal_datastore_map_find(struct ast_channel *chan,
+	const struct ast_datastore_info *info, struct ast_datastore **datastore)
+{
+	unsigned int slot = datastore_map_start(info);
+	unsigned int idx;
+
+	if (chan->datastore_map_invalid) {
+		return -1;
+	}
+	for (idx = 0; idx < AST_CHAN_DATASTORE_MAP_SIZE; idx++) {
+		if (!chan->datastore_map[slot]) {
+			/* Removals rebuild the map, so an empty slot ends the probe. */
+			break;
+		}
+		if (chan->datastore_map[slot]->info == info) {
+			*datastore = chan->datastore_map[slot];
+			return 0;
+		}
+		slot = (slot + 1) & (AST_CHAN_DATASTORE_MAP_SIZE - 1);
+	}
+	*datastore = NULL;
+	return 0;
+}
 struct ast_autochan_list *ast_channel_autochans(struct ast_channel *chan)
 {
 	return &chan->autochans;
@@ -1331,7 +1432,19 @@ void ast_channel_internal_alertpipe_swap(struct ast_channel *chan1, struct ast_c
 /* file descriptor array accessors */
 void ast_channel_internal_fd_set(struct ast_channel *chan, int which, int value)
 {
+	int i;
+
 	chan->fds[which] = value;
+
+	/* Rebuild the compact list of slots in use.  Descriptors change
+	 * hands at channel setup/teardown time, not per frame, so doing
+	 * the full scan here keeps the per-poll path scan free. */
+	chan->fd_count = 0;
+	for (i = 0; i < AST_MAX_FDS; i++) {
+		if (chan->fds[i] > -1) {
+			chan->fd_list[chan->fd_count++] = i;
+		}
+	}
 }
 void ast_channel_internal_fd_clear(struct ast_channel *chan, int which)
 {
@@ -1348,6 +1461,14 @@ int ast_channel_fd(const struct ast_channel *chan, int which)
 {
 	return chan->fds[which];
 }
+int ast_channel_internal_fd_count(const struct ast_channel *chan)
+{
+	return chan->fd_count;
+}
+int ast_channel_internal_fd_which(const struct ast_channel *chan, int idx)
+{
+	return chan->fd_list[idx];
+}
 int ast_channel_fd_isset(const struct ast_channel *chan, int which)
 {
 	return ast_channel_fd(chan, which) > -1;
@@ -54,6 +54,7 @@ struct ast_var_t *ast_var_assign(const char *name, const char *value)
 	ast_copy_string(var->name, name, name_len);
 	var->value = var->name + name_len;
 	ast_copy_string(var->value, value, value_len);
+	var->namehash = ast_str_hash(ast_var_name(var));
 
 	return var;
 }
@@ -90,10 +91,14 @@ const char *ast_var_value(const struct ast_var_t *var)
 
 char *ast_var_find(const struct varshead *head, const char *name)
 {
+	int hash = ast_str_hash(name);
 	struct ast_var_t *var;
 
+	/* The hash covers the name without inheritance underscores, so it can
+	 * only be used to reject entries whose stored name has none. */
 	AST_LIST_TRAVERSE(head, var, entries) {
-		if (!strcmp(name, var->name)) {
+		if ((var->namehash == hash || var->name[0] == '_')
+			&& !strcmp(name, var->name)) {
 			return var->value;
 		}
 	}
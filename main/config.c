@@ -39,6 +39,7 @@
 #include <libgen.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <math.h>	/* HUGE_VAL */
 #include <regex.h>
@@ -93,7 +94,11 @@ struct cache_file_include {
 struct cache_file_mtime {
 	AST_LIST_ENTRY(cache_file_mtime) list;
 	AST_LIST_HEAD_NOLOCK(includes, cache_file_include) includes;
+	/*! Unchanged-scan generation that last probed this entry. */
+	unsigned int scan_generation;
 	unsigned int has_exec:1;
+	/*! TRUE if the entry was unchanged when probed in scan_generation. */
+	unsigned int scan_unchanged:1;
 	/*! stat() file size */
 	unsigned long stat_size;
 	/*! stat() file modtime nanoseconds */
@@ -110,6 +115,16 @@ struct cache_file_mtime {
 /*! Cached file mtime list. */
 static AST_LIST_HEAD_STATIC(cfmtime_head, cache_file_mtime);
 
+/*!
+ * \brief Generation counter for unchanged-scans of the file mtime cache.
+ *
+ * A config tree frequently includes the same file from many places.
+ * Bumped when a load starts so that include probes within the scan can
+ * reuse the answer of an earlier probe of the same file instead of
+ * re-checking it.  Protected by the cfmtime_head lock.
+ */
+static unsigned int config_scan_generation;
+
 static int init_appendbuf(void *data)
 {
 	struct ast_str **str = data;
@@ -2019,6 +2034,85 @@ set_new_variable:
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Line source for config_text_file_load().
+ *
+ * The file is mapped read-only in one piece so line extraction is a
+ * memchr() over the mapping instead of buffered stdio reads.  When the
+ * mapping cannot be established (empty file, special filesystem) the
+ * reader falls back to fgets() on the already opened stream.
+ */
+struct config_file_reader {
+	FILE *f;
+	/*! Read-only mapping of the whole file.  NULL if using stdio. */
+	const char *map;
+	size_t map_len;
+	/*! Read offset of the next line in the mapping. */
+	size_t pos;
+};
+
+static void config_file_reader_init(struct config_file_reader *reader, FILE *f)
+{
+	struct stat st;
+	void *map;
+
+	reader->f = f;
+	reader->map = NULL;
+	reader->map_len = 0;
+	reader->pos = 0;
+
+	if (fstat(fileno(f), &st) || st.st_size <= 0) {
+		return;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (map == MAP_FAILED) {
+		return;
+	}
+	reader->map = map;
+	reader->map_len = st.st_size;
+}
+
+static void config_file_reader_close(struct config_file_reader *reader)
+{
+	if (reader->map) {
+		munmap((void *) reader->map, reader->map_len);
+		reader->map = NULL;
+	}
+	fclose(reader->f);
+	reader->f = NULL;
+}
+
+static int config_file_reader_eof(const struct config_file_reader *reader)
+{
+	return reader->map ? reader->pos >= reader->map_len : feof(reader->f);
+}
+
+/*! \brief Extract the next line, behaving exactly like fgets() */
+static char *config_file_reader_gets(struct config_file_reader *reader, char *buf, size_t size)
+{
+	const char *start;
+	const char *newline;
+	size_t len;
+
+	if (!reader->map) {
+		return fgets(buf, size, reader->f);
+	}
+	if (reader->pos >= reader->map_len) {
+		return NULL;
+	}
+	start = reader->map + reader->pos;
+	newline = memchr(start, '\n', reader->map_len - reader->pos);
+	len = newline ? (size_t) (newline - start) + 1 : reader->map_len - reader->pos;
+	if (len > size - 1) {
+		len = size - 1;
+	}
+	memcpy(buf, start, len);
+	buf[len] = '\0';
+	reader->pos += len;
+	return buf;
+}
+
 static struct ast_config *config_text_file_load(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked)
 {
 	char fn[256];
@@ -2029,6 +2123,7 @@ static struct ast_config *config_text_file_load(const char *database, const char
 #endif
 	char *new_buf, *comment_p, *process_buf;
 	FILE *f;
+	struct config_file_reader reader;
 	int lineno=0;
 	int comment = 0, nest[MAX_NESTED_COMMENTS];
 	struct ast_category *cat = NULL;
@@ -2120,6 +2215,11 @@ static struct ast_config *config_text_file_load(const char *database, const char
 				if (!ast_test_flag(&flags, CONFIG_FLAG_NOCACHE)) {
 					/* Find our cached entry for this configuration file */
 					AST_LIST_LOCK(&cfmtime_head);
+					if (cfg) {
+						/* A real load begins a new unchanged-scan; results
+						 * memoized during earlier scans are stale now. */
+						config_scan_generation++;
+					}
 					AST_LIST_TRAVERSE(&cfmtime_head, cfmtime, list) {
 						if (!strcmp(cfmtime->filename, fn) && !strcmp(cfmtime->who_asked, who_asked)) {
 							break;
@@ -2142,14 +2242,23 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					&& ast_test_flag(&flags, CONFIG_FLAG_FILEUNCHANGED)) {
 					int unchanged = 1;
 
-					/* File is unchanged, what about the (cached) includes (if any)? */
-					AST_LIST_TRAVERSE(&cfmtime->includes, cfinclude, list) {
-						if (!config_text_file_load(NULL, NULL, cfinclude->include,
-							NULL, flags, "", who_asked)) {
-							/* One change is enough to short-circuit and reload the whole shebang */
-							unchanged = 0;
-							break;
+					if (!cfg && cfmtime->scan_generation == config_scan_generation) {
+						/* This file was already probed during the current scan;
+						 * a tree including it from many places only pays for
+						 * the first probe. */
+						unchanged = cfmtime->scan_unchanged;
+					} else {
+						/* File is unchanged, what about the (cached) includes (if any)? */
+						AST_LIST_TRAVERSE(&cfmtime->includes, cfinclude, list) {
+							if (!config_text_file_load(NULL, NULL, cfinclude->include,
+								NULL, flags, "", who_asked)) {
+								/* One change is enough to short-circuit and reload the whole shebang */
+								unchanged = 0;
+								break;
+							}
 						}
+						cfmtime->scan_generation = config_scan_generation;
+						cfmtime->scan_unchanged = unchanged;
 					}
 
 					if (unchanged) {
@@ -2190,13 +2299,14 @@ static struct ast_config *config_text_file_load(const char *database, const char
 				ast_clear_flag(&flags, CONFIG_FLAG_FILEUNCHANGED);
 				ast_debug(1, "Parsing %s\n", fn);
 				ast_verb(2, "Parsing '%s': Found\n", fn);
-				while (!feof(f)) {
+				config_file_reader_init(&reader, f);
+				while (!config_file_reader_eof(&reader)) {
 					lineno++;
-					if (fgets(buf, sizeof(buf), f)) {
+					if (config_file_reader_gets(&reader, buf, sizeof(buf))) {
 						/* Skip lines that are too long */
 						if (strlen(buf) == sizeof(buf) - 1 && buf[sizeof(buf) - 1] != '\n') {
 							ast_log(LOG_WARNING, "Line %d too long, skipping. It begins with: %.32s...\n", lineno, buf);
-							while (fgets(buf, sizeof(buf), f)) {
+							while (config_file_reader_gets(&reader, buf, sizeof(buf))) {
 								if (strlen(buf) != sizeof(buf) - 1 || buf[sizeof(buf) - 1] == '\n') {
 									break;
 								}
@@ -2326,7 +2436,7 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					CB_RESET(comment_buffer, lline_buffer);
 				}
 
-				fclose(f);
+				config_file_reader_close(&reader);
 			} while (0);
 			if (comment) {
 				ast_log(LOG_WARNING,"Unterminated comment detected beginning on line %d\n", nest[comment - 1]);
@@ -285,6 +285,14 @@ int ast_unreal_answer(struct ast_channel *ast)
  * \param ast Channel writing a frame into the unreal channels.
  * \param p Unreal channel private.
  *
+ * \note When both halves sit in bridges that permit it, the bridging
+ * framework collapses the pair in place (by swapping a real channel
+ * into the peer bridge or merging the two bridges) so the real
+ * channels exchange media directly and the unreal pair is hung up.
+ * No masquerade is involved; frames only shuttle through the
+ * queue-frame pairs until the first media frame triggers the
+ * optimization or while the bridges prohibit it.
+ *
  * \note It is assumed that ast is locked.
  * \note It is assumed that p is locked.
  *
@@ -113,6 +113,7 @@ static int doexit;
 static int dosync;
 
 static void db_sync(void);
+static int db_execute_sql(const char *sql, int (*callback)(void *, int, char **, char **), void *arg);
 
 #define DEFINE_SQL_STATEMENT(stmt,sql) static sqlite3_stmt *stmt; \
 	const char stmt##_sql[] = sql;
@@ -256,6 +257,16 @@ static int db_open(void)
 		return -1;
 	}
 
+	/* Each commit of the rolling transaction happens with dblock held,
+	 * so in the default rollback-journal mode its fsync stalls every
+	 * ast_db_put/ast_db_get in the process.  In WAL mode a commit is an
+	 * append to the write-ahead log and the fsync is deferred to the
+	 * occasional checkpoint, keeping the lock hold times short. */
+	if (db_execute_sql("PRAGMA journal_mode=WAL", NULL, NULL)
+		|| db_execute_sql("PRAGMA synchronous=NORMAL", NULL, NULL)) {
+		ast_log(LOG_WARNING, "Unable to enable WAL journaling for '%s'; continuing with the default journal mode\n", dbname);
+	}
+
 	ast_mutex_unlock(&dblock);
 
 	return 0;
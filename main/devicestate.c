@@ -203,15 +203,32 @@ struct state_change {
 	char device[1];
 };
 
-/*! \brief The state change queue. State changes are queued
-	for processing by a separate thread */
-static AST_LIST_HEAD_STATIC(state_changes, state_change);
+/*! \brief Number of threads that process queued device state changes
+ *
+ * A device is always queued to the shard its name hashes to, so changes
+ * for any one device stay in order while a storm of changes for many
+ * devices spreads across the threads instead of serializing behind one.
+ */
+#define DEVSTATE_CHANGE_THREADS 4
+
+/*! \brief A shard of the state change queue with its own processing thread */
+struct state_change_shard {
+	/*! Queued changes for devices hashing to this shard */
+	AST_LIST_HEAD_NOLOCK(, state_change) changes;
+	/*! Protects the queue */
+	ast_mutex_t lock;
+	/*! Signaled when a change is queued */
+	ast_cond_t pending;
+	/*! The device state change notification thread draining this shard */
+	pthread_t thread;
+};
 
-/*! \brief The device state change notification thread */
-static pthread_t change_thread = AST_PTHREADT_NULL;
+/*! \brief The sharded state change queues. State changes are queued
+	for processing by a separate thread per shard */
+static struct state_change_shard state_change_shards[DEVSTATE_CHANGE_THREADS];
 
-/*! \brief Flag for the queue */
-static ast_cond_t change_pending;
+/*! \brief Set once the state change threads have been started */
+static int change_threads_running;
 static volatile int shuttingdown;
 
 struct stasis_subscription *devstate_message_sub;
@@ -496,18 +513,21 @@ int ast_devstate_changed_literal(enum ast_device_state state, enum ast_devstate_
 
 	if (state != AST_DEVICE_UNKNOWN) {
 		ast_publish_device_state(device, state, cachable);
-	} else if (change_thread == AST_PTHREADT_NULL || !(change = ast_calloc(1, sizeof(*change) + strlen(device)))) {
+	} else if (!change_threads_running || !(change = ast_calloc(1, sizeof(*change) + strlen(device)))) {
 		/* we could not allocate a change struct, or */
-		/* there is no background thread, so process the change now */
+		/* there are no background threads, so process the change now */
 		do_state_change(device, cachable);
 	} else {
-		/* queue the change */
+		/* queue the change to the shard handling this device */
+		struct state_change_shard *shard;
+
 		strcpy(change->device, device);
 		change->cachable = cachable;
-		AST_LIST_LOCK(&state_changes);
-		AST_LIST_INSERT_TAIL(&state_changes, change, list);
-		ast_cond_signal(&change_pending);
-		AST_LIST_UNLOCK(&state_changes);
+		shard = &state_change_shards[ast_str_case_hash(device) % DEVSTATE_CHANGE_THREADS];
+		ast_mutex_lock(&shard->lock);
+		AST_LIST_INSERT_TAIL(&shard->changes, change, list);
+		ast_cond_signal(&shard->pending);
+		ast_mutex_unlock(&shard->lock);
 	}
 
 	return 0;
@@ -542,19 +562,21 @@ int ast_device_state_changed(const char *fmt, ...)
 	return ast_devstate_changed_literal(AST_DEVICE_UNKNOWN, AST_DEVSTATE_CACHABLE, buf);
 }
 
-/*! \brief Go through the dev state change queue and update changes in the dev state thread */
+/*! \brief Go through a shard of the dev state change queue and update changes in the dev state thread */
 static void *do_devstate_changes(void *data)
 {
+	struct state_change_shard *shard = data;
 	struct state_change *next, *current;
 
 	while (!shuttingdown) {
 		/* This basically pops off any state change entries, resets the list back to NULL, unlocks, and processes each state change */
-		AST_LIST_LOCK(&state_changes);
-		if (AST_LIST_EMPTY(&state_changes))
-			ast_cond_wait(&change_pending, &state_changes.lock);
-		next = AST_LIST_FIRST(&state_changes);
-		AST_LIST_HEAD_INIT_NOLOCK(&state_changes);
-		AST_LIST_UNLOCK(&state_changes);
+		ast_mutex_lock(&shard->lock);
+		if (AST_LIST_EMPTY(&shard->changes)) {
+			ast_cond_wait(&shard->pending, &shard->lock);
+		}
+		next = AST_LIST_FIRST(&shard->changes);
+		AST_LIST_HEAD_INIT_NOLOCK(&shard->changes);
+		ast_mutex_unlock(&shard->lock);
 
 		/* Process each state change */
 		while ((current = next)) {
@@ -627,24 +649,48 @@ static void devstate_change_cb(void *data, struct stasis_subscription *sub, stru
 
 static void device_state_engine_cleanup(void)
 {
+	int i;
+
 	shuttingdown = 1;
-	AST_LIST_LOCK(&state_changes);
-	ast_cond_signal(&change_pending);
-	AST_LIST_UNLOCK(&state_changes);
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct state_change_shard *shard = &state_change_shards[i];
+
+		if (shard->thread == AST_PTHREADT_NULL) {
+			continue;
+		}
 
-	if (change_thread != AST_PTHREADT_NULL) {
-		pthread_join(change_thread, NULL);
+		ast_mutex_lock(&shard->lock);
+		ast_cond_signal(&shard->pending);
+		ast_mutex_unlock(&shard->lock);
+		pthread_join(shard->thread, NULL);
 	}
 }
 
-/*! \brief Initialize the device state engine in separate thread */
+/*! \brief Initialize the device state engine in separate threads */
 int ast_device_state_engine_init(void)
 {
-	ast_cond_init(&change_pending, NULL);
-	if (ast_pthread_create_background(&change_thread, NULL, do_devstate_changes, NULL) < 0) {
-		ast_log(LOG_ERROR, "Unable to start device state change thread.\n");
-		return -1;
+	int i;
+
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct state_change_shard *shard = &state_change_shards[i];
+
+		AST_LIST_HEAD_INIT_NOLOCK(&shard->changes);
+		ast_mutex_init(&shard->lock);
+		ast_cond_init(&shard->pending, NULL);
+		shard->thread = AST_PTHREADT_NULL;
+	}
+
+	for (i = 0; i < DEVSTATE_CHANGE_THREADS; i++) {
+		struct state_change_shard *shard = &state_change_shards[i];
+
+		if (ast_pthread_create_background(&shard->thread, NULL, do_devstate_changes, shard) < 0) {
+			ast_log(LOG_ERROR, "Unable to start device state change thread.\n");
+			shard->thread = AST_PTHREADT_NULL;
+			device_state_engine_cleanup();
+			return -1;
+		}
 	}
+	change_threads_running = 1;
 	ast_register_cleanup(device_state_engine_cleanup);
 
 	return 0;
@@ -490,17 +490,72 @@ static int begin_dial_channel(struct ast_dial_channel *channel, struct ast_chann
 	return res;
 }
 
+/*! \brief Arguments for dialing one appended channel in its own thread */
+struct begin_dial_args {
+	struct ast_dial_channel *channel;
+	struct ast_channel *chan;
+	int async;
+	const char *predial_string;
+	/*! Thread dialing the channel or AST_PTHREADT_NULL if dialed inline */
+	pthread_t thread;
+	int success;
+};
+
+static void *begin_dial_run(void *data)
+{
+	struct begin_dial_args *args = data;
+
+	args->success = begin_dial_channel(args->channel, args->chan, args->async,
+		args->predial_string, NULL);
+	return NULL;
+}
+
 /*! \brief Helper function that does the beginning dialing per dial structure */
 static int begin_dial(struct ast_dial *dial, struct ast_channel *chan, int async)
 {
 	struct ast_dial_channel *channel = NULL;
 	int success = 0;
+	int num_channels = 0;
 	char *predial_string = dial->options[AST_DIAL_OPTION_PREDIAL];
 
 	/* Iterate through channel list, requesting and calling each one */
 	AST_LIST_LOCK(&dial->channels);
 	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
-		success += begin_dial_channel(channel, chan, async, predial_string, NULL);
+		num_channels++;
+	}
+	if (num_channels > 1) {
+		struct begin_dial_args *args = ast_alloca(num_channels * sizeof(*args));
+		int i = 0;
+
+		/* Requesting and calling a device can block on DNS or realtime
+		 * lookups in the channel driver, so give each channel its own
+		 * thread and let the time before ringing starts be that of the
+		 * slowest channel instead of the sum of all of them.  Each thread
+		 * works on its own ast_dial_channel and only touches the shared
+		 * caller channel under its lock. */
+		AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+			args[i].channel = channel;
+			args[i].chan = chan;
+			args[i].async = async;
+			args[i].predial_string = predial_string;
+			args[i].success = 0;
+			if (ast_pthread_create(&args[i].thread, NULL, begin_dial_run, &args[i])) {
+				/* Dial this channel inline instead */
+				args[i].thread = AST_PTHREADT_NULL;
+				begin_dial_run(&args[i]);
+			}
+			i++;
+		}
+		for (i = 0; i < num_channels; i++) {
+			if (args[i].thread != AST_PTHREADT_NULL) {
+				pthread_join(args[i].thread, NULL);
+			}
+			success += args[i].success;
+		}
+	} else {
+		AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+			success += begin_dial_channel(channel, chan, async, predial_string, NULL);
+		}
 	}
 	AST_LIST_UNLOCK(&dial->channels);
 
@@ -47,6 +47,112 @@ AST_RWLIST_HEAD_STATIC(resolvers, ast_dns_resolver);
 
 static struct ast_sched_context *sched;
 
+/*! \brief Number of buckets in the DNS result cache */
+#define DNS_CACHE_BUCKETS 53
+
+/*! \brief Number of seconds to cache responses which carry no usable TTL, such as NXDOMAIN */
+#define DNS_CACHE_NEGATIVE_TTL 60
+
+/*! \brief Number of seconds between prunes of expired DNS cache entries */
+#define DNS_CACHE_PRUNE_INTERVAL 60
+
+/*! \brief A cached DNS result */
+struct dns_cache_entry {
+	/*! \brief Copy of the result, with generic records, which is replayed on a hit */
+	struct ast_dns_result *result;
+	/*! \brief When the entry was created */
+	struct timeval created;
+	/*! \brief When the entry lapses, based on the lowest record TTL */
+	struct timeval expiration;
+	/*! \brief Resource record type of the original query */
+	int rr_type;
+	/*! \brief Resource record class of the original query */
+	int rr_class;
+	/*! \brief The name that was resolved */
+	char name[0];
+};
+
+/*! \brief Key used when searching the DNS result cache */
+struct dns_cache_key {
+	/*! \brief The name being resolved */
+	const char *name;
+	/*! \brief Resource record type */
+	int rr_type;
+	/*! \brief Resource record class */
+	int rr_class;
+};
+
+/*! \brief Cache of results from resolvers which allow their results to be cached */
+static struct ao2_container *dns_cache;
+
+static struct ast_dns_result *dns_cache_lookup(const char *name, int rr_type, int rr_class);
+static void dns_cache_store(struct ast_dns_query *query);
+
+static void dns_cache_entry_destructor(void *obj)
+{
+	struct dns_cache_entry *entry = obj;
+
+	ast_dns_result_free(entry->result);
+}
+
+static int dns_cache_entry_hash(const void *obj, int flags)
+{
+	const struct dns_cache_entry *entry = obj;
+	const struct dns_cache_key *key = obj;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ast_str_case_hash(key->name);
+	case OBJ_SEARCH_OBJECT:
+		return ast_str_case_hash(entry->name);
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int dns_cache_entry_cmp(void *obj, void *arg, int flags)
+{
+	const struct dns_cache_entry *entry = obj;
+	const struct dns_cache_entry *other = arg;
+	const struct dns_cache_key *key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return (!strcasecmp(entry->name, key->name)
+			&& entry->rr_type == key->rr_type
+			&& entry->rr_class == key->rr_class) ? CMP_MATCH : 0;
+	case OBJ_SEARCH_OBJECT:
+		return (!strcasecmp(entry->name, other->name)
+			&& entry->rr_type == other->rr_type
+			&& entry->rr_class == other->rr_class) ? CMP_MATCH : 0;
+	default:
+		return 0;
+	}
+}
+
+/*! \brief AO2 callback function which matches expired cache entries */
+static int dns_cache_entry_expired(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+	struct timeval *now = arg;
+
+	return ast_tvcmp(entry->expiration, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*! \brief Scheduler callback which prunes expired entries from the cache */
+static int dns_cache_prune(const void *data)
+{
+	struct timeval now = ast_tvnow();
+
+	ao2_callback(dns_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK,
+		dns_cache_entry_expired, &now);
+
+	/* Reschedule at the same interval */
+	return 1;
+}
+
 struct ast_sched_context *ast_dns_get_sched(void)
 {
 	return sched;
@@ -339,6 +445,12 @@ int ast_dns_resolve(const char *name, int rr_type, int rr_class, struct ast_dns_
 		return -1;
 	}
 
+	/* If a sufficiently fresh answer is cached the resolver does not need to be consulted */
+	*result = dns_cache_lookup(name, rr_type, rr_class);
+	if (*result) {
+		return 0;
+	}
+
 	synchronous = ao2_alloc_options(sizeof(*synchronous), dns_synchronous_resolve_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!synchronous) {
 		return -1;
@@ -522,15 +634,213 @@ void ast_dns_resolver_completed(struct ast_dns_query *query)
 {
 	sort_result(ast_dns_query_get_rr_type(query), query->result);
 
+	dns_cache_store(query);
+
 	query->callback(query);
 }
 
+/*! \brief Callback used for queries which replay a cached result, nothing is needed on completion */
+static void dns_cache_replay_callback(const struct ast_dns_query *query)
+{
+}
+
+static struct ast_dns_result *dns_cache_lookup(const char *name, int rr_type, int rr_class)
+{
+	struct dns_cache_key key = {
+		.name = name,
+		.rr_type = rr_type,
+		.rr_class = rr_class,
+	};
+	struct ast_dns_resolver *resolver;
+	struct dns_cache_entry *entry;
+	struct ast_dns_query *query;
+	struct ast_dns_result *result = NULL;
+	const struct ast_dns_record *record;
+	int64_t elapsed;
+	unsigned int cacheable;
+
+	if (!dns_cache) {
+		return NULL;
+	}
+
+	/* If the resolver which would serve this query does not allow caching then the
+	 * cache can not answer on its behalf, even if another resolver populated it.
+	 */
+	AST_RWLIST_RDLOCK(&resolvers);
+	resolver = AST_RWLIST_FIRST(&resolvers);
+	cacheable = resolver ? resolver->cache_results : 0;
+	AST_RWLIST_UNLOCK(&resolvers);
+
+	if (!cacheable) {
+		return NULL;
+	}
+
+	entry = ao2_find(dns_cache, &key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return NULL;
+	}
+
+	if (ast_tvcmp(entry->expiration, ast_tvnow()) <= 0) {
+		ao2_unlink(dns_cache, entry);
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+
+	/* A throwaway query is used so the cached answer passes back through the same
+	 * record specific parsing and sorting a resolver provided answer would.
+	 */
+	query = dns_query_alloc(name, rr_type, rr_class, dns_cache_replay_callback, NULL);
+	if (!query) {
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+
+	elapsed = ast_tvdiff_sec(ast_tvnow(), entry->created);
+
+	if (ast_dns_resolver_set_result(query, entry->result->secure, entry->result->bogus,
+		entry->result->rcode, entry->result->canonical, entry->result->answer,
+		entry->result->answer_size)) {
+		goto finished;
+	}
+
+	for (record = ast_dns_result_get_records(entry->result); record;
+		record = ast_dns_record_get_next(record)) {
+		int ttl = record->ttl;
+
+		/* The remaining lifetime is provided so consumers scheduling their own
+		 * refreshes do not extend the record beyond what the backend gave us.
+		 */
+		if (ttl) {
+			ttl -= elapsed;
+			if (ttl < 1) {
+				ttl = 1;
+			}
+		}
+
+		if (ast_dns_resolver_add_record(query, record->rr_type, record->rr_class,
+			ttl, record->data_ptr, record->data_len)) {
+			goto finished;
+		}
+	}
+
+	sort_result(rr_type, query->result);
+
+	result = query->result;
+	query->result = NULL;
+
+finished:
+	ao2_ref(query, -1);
+	ao2_ref(entry, -1);
+
+	return result;
+}
+
+static void dns_cache_store(struct ast_dns_query *query)
+{
+	const struct ast_dns_result *result = query->result;
+	struct dns_cache_entry *entry;
+	const struct ast_dns_record *record;
+	struct dns_cache_key key;
+	char *buf_ptr;
+	int ttl;
+
+	if (!dns_cache || !result || !query->resolver->cache_results) {
+		return;
+	}
+
+	if (result->rcode == ns_r_nxdomain
+		|| (!result->rcode && AST_LIST_EMPTY(&result->records))) {
+		/* The authority SOA record which would provide the negative TTL is not
+		 * parsed by the core, so a conservative fixed lifetime is used instead.
+		 */
+		ttl = DNS_CACHE_NEGATIVE_TTL;
+	} else if (!result->rcode) {
+		ttl = ast_dns_result_get_lowest_ttl((struct ast_dns_result *) result);
+	} else {
+		/* Response codes such as SERVFAIL reflect transient problems and are not cached */
+		return;
+	}
+
+	if (!ttl) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(query->name) + 1,
+		dns_cache_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+
+	entry->rr_type = query->rr_type;
+	entry->rr_class = query->rr_class;
+	strcpy(entry->name, query->name); /* SAFE */
+	entry->created = ast_tvnow();
+	entry->expiration = ast_tvadd(entry->created, ast_samp2tv(ttl, 1));
+
+	entry->result = ast_calloc(1, sizeof(*entry->result)
+		+ strlen(result->canonical) + 1 + result->answer_size);
+	if (!entry->result) {
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	entry->result->secure = result->secure;
+	entry->result->bogus = result->bogus;
+	entry->result->rcode = result->rcode;
+
+	buf_ptr = entry->result->buf;
+	strcpy(buf_ptr, result->canonical); /* SAFE */
+	entry->result->canonical = buf_ptr;
+
+	buf_ptr += strlen(result->canonical) + 1;
+	memcpy(buf_ptr, result->answer, result->answer_size);
+	entry->result->answer = buf_ptr;
+	entry->result->answer_size = result->answer_size;
+
+	for (record = ast_dns_result_get_records(result); record;
+		record = ast_dns_record_get_next(record)) {
+		struct ast_dns_record *copy;
+
+		/* Only the raw record data is kept, a hit replays it through the record
+		 * specific allocators for the benefiting query.
+		 */
+		copy = ast_calloc(1, sizeof(*copy) + record->data_len);
+		if (!copy) {
+			ao2_ref(entry, -1);
+			return;
+		}
+
+		copy->rr_type = record->rr_type;
+		copy->rr_class = record->rr_class;
+		copy->ttl = record->ttl;
+		copy->data_len = record->data_len;
+		copy->data_ptr = copy->data;
+		memcpy(copy->data_ptr, record->data_ptr, record->data_len);
+
+		AST_LIST_INSERT_TAIL(&entry->result->records, copy, list);
+	}
+
+	key.name = entry->name;
+	key.rr_type = entry->rr_type;
+	key.rr_class = entry->rr_class;
+
+	ao2_wrlock(dns_cache);
+	ao2_find(dns_cache, &key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(dns_cache, entry, OBJ_NOLOCK);
+	ao2_unlock(dns_cache);
+
+	ao2_ref(entry, -1);
+}
+
 static void dns_shutdown(void)
 {
 	if (sched) {
 		ast_sched_context_destroy(sched);
 		sched = NULL;
 	}
+
+	ao2_cleanup(dns_cache);
+	dns_cache = NULL;
 }
 
 int ast_dns_resolver_register(struct ast_dns_resolver *resolver)
@@ -573,6 +883,17 @@ int ast_dns_resolver_register(struct ast_dns_resolver *resolver)
 			return -1;
 		}
 
+		/* The result cache lives alongside the scheduler. If it can not be
+		 * created resolution simply proceeds without caching.
+		 */
+		dns_cache = ao2_container_alloc(DNS_CACHE_BUCKETS, dns_cache_entry_hash,
+			dns_cache_entry_cmp);
+		if (dns_cache
+			&& ast_sched_add(sched, DNS_CACHE_PRUNE_INTERVAL * 1000, dns_cache_prune, NULL) < 0) {
+			ao2_cleanup(dns_cache);
+			dns_cache = NULL;
+		}
+
 		ast_register_cleanup(dns_shutdown);
 	}
 
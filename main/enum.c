@@ -72,6 +72,7 @@
 
 #include "asterisk/enum.h"
 #include "asterisk/dns.h"
+#include "asterisk/dns_core.h"
 #include "asterisk/channel.h"
 #include "asterisk/config.h"
 #include "asterisk/utils.h"
@@ -633,6 +634,52 @@ static int enum_callback(void *context, unsigned char *answer, int len, unsigned
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Perform the NAPTR lookup through the core DNS resolver.
+ *
+ * Going through ast_dns_resolve() lets repeated lookups of the same
+ * domain be answered from the resolver result cache, so an ENUM-routed
+ * call setup does not pay a blocking res_search() round trip when the
+ * answer is still fresh.
+ *
+ * \retval -2 if the core resolver is unavailable and the caller should
+ *            fall back to ast_search_dns()
+ * \retval -1 if the domain did not resolve
+ * \retval 0 if the answer contained no NAPTR records
+ * \retval 1 if NAPTR records were delivered to enum_callback()
+ */
+static int enum_dns_resolve_naptr(struct enum_context *context, const char *domain)
+{
+	struct ast_dns_result *result = NULL;
+	const struct ast_dns_record *dns_record;
+	int ret = 0;
+
+	if (ast_dns_resolve(domain, T_NAPTR, C_IN, &result) || !result) {
+		return -2;
+	}
+
+	if (ast_dns_result_get_rcode(result) != ns_r_noerror) {
+		ast_dns_result_free(result);
+		return -1;
+	}
+
+	for (dns_record = ast_dns_result_get_records(result); dns_record;
+		dns_record = ast_dns_record_get_next(dns_record)) {
+		if (enum_callback(context, (unsigned char *) ast_dns_record_get_data(dns_record),
+			ast_dns_record_get_data_size(dns_record), NULL) < 0) {
+			ast_log(LOG_WARNING, "Failed to parse result\n");
+			ret = -1;
+			break;
+		}
+		ret = 1;
+	}
+
+	ast_dns_result_free(result);
+
+	return ret;
+}
+
 /* ENUM lookup */
 int ast_get_enum(struct ast_channel *chan, const char *number, char *dst, int dstlen, char *tech, int techlen, char* suffix, char* options, unsigned int record, struct enum_context **argcontext)
 {
@@ -860,7 +907,11 @@ int ast_get_enum(struct ast_channel *chan, const char *number, char *dst, int ds
 
 	strncat(tmp,apex,spaceleft);
 	time_start = ast_tvnow();
-	ret = ast_search_dns(context, tmp, C_IN, T_NAPTR, enum_callback);
+	ret = enum_dns_resolve_naptr(context, tmp);
+	if (ret == -2) {
+		/* No resolver is registered with the core; take the old libc path. */
+		ret = ast_search_dns(context, tmp, C_IN, T_NAPTR, enum_callback);
+	}
 	time_end = ast_tvnow();
 
 	ast_debug(2, "profiling: %s, %s, %" PRIi64 " ms\n",
@@ -21,6 +21,17 @@
  * \brief Internal generic event system
  *
  * \author Russell Bryant <russell@digium.com>
+ *
+ * \note This file now only implements the binary ast_event format used to
+ *       carry events between cluster nodes (res_corosync).  The old
+ *       intra-server subscription bus, which matched every event against
+ *       the IE values of every subscription, is gone.  Local distribution
+ *       happens over Stasis instead: entity-keyed topic pools (for example
+ *       ast_device_state_topic() and ast_mwi_topic()) deliver an event
+ *       directly to the parties interested in that device or mailbox, and
+ *       subscriber dispatch is filtered by message type, so distribution
+ *       cost scales with the interested parties rather than the total
+ *       subscriber count.
  */
 
 /*** MODULEINFO
@@ -399,12 +410,54 @@ int ast_event_append_ie_raw(struct ast_event **event, enum ast_event_ie_type ie_
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Append an IE to an event that is known to have room for it
+ *
+ * ast_event_new() sizes its allocation for every IE up front, so its
+ * append path can write in place instead of growing the event by one
+ * realloc per IE the way ast_event_append_ie_raw() must for callers
+ * extending an arbitrary event.
+ */
+static void event_append_ie_noalloc(struct ast_event *event, enum ast_event_ie_type ie_type,
+	const void *data, size_t data_len)
+{
+	struct ast_event_ie *ie;
+	uint16_t event_len;
+
+	event_len = ntohs(event->event_len);
+
+	ie = (struct ast_event_ie *) ( ((char *) event) + event_len );
+	ie->ie_type = htons(ie_type);
+	ie->ie_payload_len = htons(data_len);
+	memcpy(ie->ie_payload, data, data_len);
+
+	event->event_len = htons(event_len + sizeof(*ie) + data_len);
+}
+
+static void event_append_ie_str_noalloc(struct ast_event *event, enum ast_event_ie_type ie_type,
+	const char *str)
+{
+	struct ast_event_ie_str_payload *str_payload;
+	size_t payload_len;
+
+	payload_len = sizeof(*str_payload) + strlen(str);
+	str_payload = ast_alloca(payload_len);
+
+	strcpy(str_payload->str, str);
+	str_payload->hash = ast_str_hash(str);
+
+	event_append_ie_noalloc(event, ie_type, str_payload, payload_len);
+}
+
 struct ast_event *ast_event_new(enum ast_event_type type, ...)
 {
 	va_list ap;
 	struct ast_event *event;
 	enum ast_event_ie_type ie_type;
 	struct ast_event_ie_val *ie_val;
+	/* Room for the event header plus the entity ID appended at the end */
+	size_t alloc_len = sizeof(*event) + sizeof(struct ast_event_ie) + sizeof(ast_eid_default);
 	AST_LIST_HEAD_NOLOCK_STATIC(ie_vals, ast_event_ie_val);
 
 	/* Invalid type */
@@ -429,14 +482,19 @@ struct ast_event *ast_event_new(enum ast_event_type type, ...)
 		switch (ie_value->ie_pltype) {
 		case AST_EVENT_IE_PLTYPE_UINT:
 			ie_value->payload.uint = va_arg(ap, uint32_t);
+			alloc_len += sizeof(struct ast_event_ie) + sizeof(uint32_t);
 			insert = 1;
 			break;
 		case AST_EVENT_IE_PLTYPE_BITFLAGS:
 			ie_value->payload.uint = va_arg(ap, uint32_t);
+			alloc_len += sizeof(struct ast_event_ie) + sizeof(uint32_t);
 			insert = 1;
 			break;
 		case AST_EVENT_IE_PLTYPE_STR:
 			ie_value->payload.str = va_arg(ap, const char *);
+			alloc_len += sizeof(struct ast_event_ie)
+				+ sizeof(struct ast_event_ie_str_payload)
+				+ strlen(ie_value->payload.str);
 			insert = 1;
 			break;
 		case AST_EVENT_IE_PLTYPE_RAW:
@@ -446,6 +504,7 @@ struct ast_event *ast_event_new(enum ast_event_type type, ...)
 			ie_value->payload.raw = ast_alloca(datalen);
 			memcpy(ie_value->payload.raw, data, datalen);
 			ie_value->raw_datalen = datalen;
+			alloc_len += sizeof(struct ast_event_ie) + datalen;
 			insert = 1;
 			break;
 		}
@@ -462,7 +521,13 @@ struct ast_event *ast_event_new(enum ast_event_type type, ...)
 	}
 	va_end(ap);
 
-	if (!(event = ast_calloc(1, sizeof(*event)))) {
+	/*
+	 * The first pass totalled what every IE will occupy, so one
+	 * allocation covers the whole event rather than growing it with
+	 * a realloc per IE.  That keeps a CEL or corosync event to a
+	 * single trip to the allocator.
+	 */
+	if (!(event = ast_calloc(1, alloc_len))) {
 		return NULL;
 	}
 
@@ -472,33 +537,31 @@ struct ast_event *ast_event_new(enum ast_event_type type, ...)
 	AST_LIST_TRAVERSE(&ie_vals, ie_val, entry) {
 		switch (ie_val->ie_pltype) {
 		case AST_EVENT_IE_PLTYPE_STR:
-			ast_event_append_ie_str(&event, ie_val->ie_type, ie_val->payload.str);
+			event_append_ie_str_noalloc(event, ie_val->ie_type, ie_val->payload.str);
 			break;
 		case AST_EVENT_IE_PLTYPE_UINT:
-			ast_event_append_ie_uint(&event, ie_val->ie_type, ie_val->payload.uint);
-			break;
 		case AST_EVENT_IE_PLTYPE_BITFLAGS:
-			ast_event_append_ie_bitflags(&event, ie_val->ie_type, ie_val->payload.uint);
+		{
+			uint32_t data = htonl(ie_val->payload.uint);
+
+			event_append_ie_noalloc(event, ie_val->ie_type, &data, sizeof(data));
 			break;
+		}
 		case AST_EVENT_IE_PLTYPE_RAW:
-			ast_event_append_ie_raw(&event, ie_val->ie_type,
+			event_append_ie_noalloc(event, ie_val->ie_type,
 					ie_val->payload.raw, ie_val->raw_datalen);
 			break;
 		case AST_EVENT_IE_PLTYPE_EXISTS:
 		case AST_EVENT_IE_PLTYPE_UNKNOWN:
 			break;
 		}
-
-		/* realloc inside one of the append functions failed */
-		if (!event) {
-			return NULL;
-		}
 	}
 
 	if (!ast_event_get_ie_raw(event, AST_EVENT_IE_EID)) {
 		/* If the event is originating on this server, add the server's
-		 * entity ID to the event. */
-		ast_event_append_eid(&event);
+		 * entity ID to the event.  Space for it was reserved above. */
+		event_append_ie_noalloc(event, AST_EVENT_IE_EID,
+				&ast_eid_default, sizeof(ast_eid_default));
 	}
 
 	return event;
@@ -32,6 +32,10 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#ifdef HAVE_FMEMOPEN
+#include <sys/mman.h>
+#endif
+#include <fcntl.h>
 #include <math.h>
 
 #include "asterisk/_private.h"	/* declare ast_file_init() */
@@ -71,6 +75,621 @@ static AST_RWLIST_HEAD_STATIC(formats, ast_format_def);
 STASIS_MESSAGE_TYPE_DEFN(ast_format_register_type);
 STASIS_MESSAGE_TYPE_DEFN(ast_format_unregister_type);
 
+/*! \brief The number of buckets for the sound file stat() result cache */
+#define STAT_CACHE_BUCKETS 563
+
+/*!
+ * \brief A cached stat() result, positive or negative, for one candidate path.
+ *
+ * Resolving a single prompt probes every extension of every registered
+ * format in up to four language locations, so a busy IVR repeats the same
+ * dozen or more stat() calls for every caller hearing the same menu. Both
+ * hits and misses are trusted for ast_option_statcache_ms and the cache is
+ * flushed for paths Asterisk itself writes, deletes, renames or copies.
+ */
+struct stat_cache_entry {
+	/*! When the stat() was performed */
+	struct timeval when;
+	/*! Zero if the stat() failed */
+	int exists;
+	/*! The stat() result when the file existed */
+	struct stat st;
+	/*! The path that was handed to stat() */
+	char fn[0];
+};
+
+static struct ao2_container *stat_cache;
+
+static int stat_cache_hash(const void *obj, const int flags)
+{
+	const char *fn = (flags & OBJ_KEY) ? obj : ((const struct stat_cache_entry *) obj)->fn;
+	return ast_str_hash(fn);
+}
+
+static int stat_cache_cmp(void *obj, void *arg, int flags)
+{
+	struct stat_cache_entry *entry = obj;
+	const char *fn = (flags & OBJ_KEY) ? arg : ((struct stat_cache_entry *) arg)->fn;
+	return strcmp(entry->fn, fn) ? 0 : CMP_MATCH;
+}
+
+/*! \brief stat() by way of the cache, honoring the configured TTL */
+static int stat_cached(const char *fn, struct stat *st)
+{
+	struct stat_cache_entry *entry;
+	int res;
+
+	if (!ast_option_statcache_ms || !stat_cache) {
+		return stat(fn, st);
+	}
+
+	entry = ao2_find(stat_cache, fn, OBJ_KEY);
+	if (entry) {
+		if (ast_tvdiff_ms(ast_tvnow(), entry->when) < ast_option_statcache_ms) {
+			if (entry->exists) {
+				*st = entry->st;
+				res = 0;
+			} else {
+				res = -1;
+			}
+			ao2_ref(entry, -1);
+			return res;
+		}
+
+		/* Expired; drop it and fall through to a real stat() */
+		ao2_unlink(stat_cache, entry);
+		ao2_ref(entry, -1);
+	}
+
+	res = stat(fn, st);
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(fn) + 1,
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return res;
+	}
+
+	entry->when = ast_tvnow();
+	entry->exists = !res;
+	if (!res) {
+		entry->st = *st;
+	}
+	strcpy(entry->fn, fn); /* safe */
+	ao2_link(stat_cache, entry);
+	ao2_ref(entry, -1);
+
+	return res;
+}
+
+/*! \brief Forget anything cached about the given path */
+static void stat_cache_invalidate(const char *fn)
+{
+	if (stat_cache) {
+		ao2_find(stat_cache, fn, OBJ_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE);
+	}
+}
+
+#ifdef HAVE_FMEMOPEN
+
+/*! \brief The number of buckets for the shared sound file data cache */
+#define MMAP_CACHE_BUCKETS 563
+
+/*!
+ * \brief A complete sound file mapped into memory, shared by its readers.
+ *
+ * When many callers hear the same announcement, each of their streams
+ * otherwise opens and reads the file independently. Instead the file is
+ * mapped once and every stream gets a private fmemopen() FILE over the
+ * shared bytes, so the format modules are none the wiser. Streams hold a
+ * reference, so evicting or invalidating an entry never pulls the mapping
+ * out from under a caller still listening to it.
+ */
+struct mmap_cache_entry {
+	/*! The mapping itself, \c len bytes long */
+	void *data;
+	/*! Size of the mapping and of the file when it was mapped */
+	size_t len;
+	/*! Modification time of the file when it was mapped */
+	time_t mtime;
+	/*! When the entry was last handed to a new stream, for LRU eviction */
+	struct timeval last_used;
+	/*! The path that was mapped */
+	char fn[0];
+};
+
+static struct ao2_container *mmap_cache;
+
+/*! \brief Bytes currently linked in \c mmap_cache; protected by its container lock */
+static size_t mmap_cache_bytes;
+
+static void mmap_cache_entry_dtor(void *obj)
+{
+	struct mmap_cache_entry *entry = obj;
+
+	munmap(entry->data, entry->len);
+}
+
+static int mmap_cache_hash(const void *obj, const int flags)
+{
+	const char *fn = (flags & OBJ_KEY) ? obj : ((const struct mmap_cache_entry *) obj)->fn;
+	return ast_str_hash(fn);
+}
+
+static int mmap_cache_cmp(void *obj, void *arg, int flags)
+{
+	struct mmap_cache_entry *entry = obj;
+	const char *fn = (flags & OBJ_KEY) ? arg : ((struct mmap_cache_entry *) arg)->fn;
+	return strcmp(entry->fn, fn) ? 0 : CMP_MATCH;
+}
+
+static int mmap_cache_oldest_cb(void *obj, void *arg, int flags)
+{
+	struct mmap_cache_entry *entry = obj;
+	struct mmap_cache_entry **oldest = arg;
+
+	if (!*oldest || ast_tvcmp(entry->last_used, (*oldest)->last_used) < 0) {
+		*oldest = entry;
+	}
+	return 0;
+}
+
+/*! \brief Drop least recently used mappings until within budget; the container must be locked */
+static void mmap_cache_evict(size_t budget)
+{
+	while (mmap_cache_bytes > budget) {
+		struct mmap_cache_entry *oldest = NULL;
+
+		ao2_callback(mmap_cache, OBJ_NOLOCK | OBJ_NODATA, mmap_cache_oldest_cb, &oldest);
+		if (!oldest) {
+			break;
+		}
+		mmap_cache_bytes -= oldest->len;
+		ao2_unlink_flags(mmap_cache, oldest, OBJ_NOLOCK);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Produce a FILE reading the given file out of the shared data cache.
+ *
+ * \param fn The path to serve, which the caller has already stat()ed
+ * \param st That stat() result, used to size and validate the mapping
+ * \param entry_ref On success, a reference the stream must hold while the
+ *        FILE is open and release (ao2_cleanup) after closing it
+ *
+ * \retval NULL the cache is disabled or unusable for this file; the caller
+ *         should fall back to a plain fopen()
+ */
+static FILE *mmap_cache_open(const char *fn, const struct stat *st, void **entry_ref)
+{
+	struct mmap_cache_entry *entry;
+	size_t budget;
+	FILE *f;
+
+	*entry_ref = NULL;
+
+	if (!ast_option_mmapcache || !mmap_cache) {
+		return NULL;
+	}
+
+	budget = (size_t) ast_option_mmapcache * 1024 * 1024;
+	if (st->st_size <= 0 || (size_t) st->st_size > budget) {
+		return NULL;
+	}
+
+	ao2_lock(mmap_cache);
+	entry = ao2_find(mmap_cache, fn, OBJ_KEY | OBJ_NOLOCK);
+	if (entry && (entry->len != (size_t) st->st_size || entry->mtime != st->st_mtime)) {
+		/* The file changed since it was mapped. Current listeners keep the
+		 * old copy alive through their references; new ones get a fresh map. */
+		mmap_cache_bytes -= entry->len;
+		ao2_unlink_flags(mmap_cache, entry, OBJ_NOLOCK);
+		ao2_ref(entry, -1);
+		entry = NULL;
+	}
+
+	if (entry) {
+		entry->last_used = ast_tvnow();
+		ao2_unlock(mmap_cache);
+	} else {
+		void *data;
+		int fd;
+
+		ao2_unlock(mmap_cache);
+
+		fd = open(fn, O_RDONLY);
+		if (fd < 0) {
+			return NULL;
+		}
+		data = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			return NULL;
+		}
+
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(fn) + 1,
+			mmap_cache_entry_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!entry) {
+			munmap(data, st->st_size);
+			return NULL;
+		}
+		entry->data = data;
+		entry->len = st->st_size;
+		entry->mtime = st->st_mtime;
+		strcpy(entry->fn, fn); /* safe */
+
+		ao2_lock(mmap_cache);
+		entry->last_used = ast_tvnow();
+		ao2_link_flags(mmap_cache, entry, OBJ_NOLOCK);
+		mmap_cache_bytes += entry->len;
+		mmap_cache_evict(budget);
+		ao2_unlock(mmap_cache);
+	}
+
+	f = fmemopen(entry->data, entry->len, "r");
+	if (!f) {
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+
+	*entry_ref = entry;
+	return f;
+}
+
+#endif /* HAVE_FMEMOPEN */
+
+/*! \brief The number of dedicated threads flushing deferred recording writes */
+#define WRITE_BEHIND_THREADS 2
+
+/*!
+ * \brief Deferred write bookkeeping for one recording stream.
+ *
+ * When record_write_behind is set in asterisk.conf, ast_writestream() copies
+ * each frame onto a queue drained by a dedicated writer thread instead of
+ * pushing it through the format module (and stdio, and the disk) in the
+ * thread handling the call's audio. Each queued frame holds a reference on
+ * its stream, so the file cannot be finalized out from under pending writes,
+ * and a stream's frames all land on the same queue, so they reach the disk
+ * in the order they were recorded.
+ *
+ * All of the counters here are protected by the lock of the queue the
+ * stream was assigned to.
+ */
+struct write_behind_state {
+	/*! Which of the write_behind_queues this stream's frames go to */
+	int queue_idx;
+	/*! Bytes of frame data queued and not yet written */
+	int queued;
+	/*! Frames queued and not yet written */
+	int pending;
+	/*! Set when a deferred write failed, to be reported on the next write */
+	int failed;
+	/*! Signaled whenever a deferred write for this stream completes */
+	ast_cond_t complete;
+};
+
+struct write_behind_task {
+	/*! The stream to write to; the task owns a reference */
+	struct ast_filestream *fs;
+	/*! A private copy of the frame to write */
+	struct ast_frame *f;
+	AST_LIST_ENTRY(write_behind_task) list;
+};
+
+struct write_behind_queue {
+	ast_mutex_t lock;
+	ast_cond_t wakeup;
+	pthread_t thread;
+	AST_LIST_HEAD_NOLOCK(, write_behind_task) tasks;
+};
+
+static struct write_behind_queue write_behind_queues[WRITE_BEHIND_THREADS];
+
+/*! \brief Nonzero once the writer threads are up; they stay up until shutdown */
+static int write_behind_running;
+
+/*! \brief Tells the writer threads to exit once their queues are empty */
+static int write_behind_stop;
+
+static int writestream_process(struct ast_filestream *fs, struct ast_frame *f);
+
+static void *write_behind_thread(void *data)
+{
+	struct write_behind_queue *q = data;
+
+	for (;;) {
+		struct write_behind_task *task;
+		struct write_behind_state *wb;
+		int res;
+
+		ast_mutex_lock(&q->lock);
+		while (!(task = AST_LIST_REMOVE_HEAD(&q->tasks, list))) {
+			if (write_behind_stop) {
+				ast_mutex_unlock(&q->lock);
+				return NULL;
+			}
+			ast_cond_wait(&q->wakeup, &q->lock);
+		}
+		ast_mutex_unlock(&q->lock);
+
+		res = writestream_process(task->fs, task->f);
+
+		ast_mutex_lock(&q->lock);
+		wb = task->fs->write_behind;
+		wb->queued -= task->f->datalen;
+		wb->pending--;
+		if (res < 0) {
+			wb->failed = 1;
+		}
+		ast_cond_broadcast(&wb->complete);
+		ast_mutex_unlock(&q->lock);
+
+		ast_frfree(task->f);
+		ao2_ref(task->fs, -1);
+		ast_free(task);
+	}
+
+	return NULL;
+}
+
+/*! \brief Hand the stream's writes off to the writer threads; on failure it simply stays synchronous */
+static void write_behind_attach(struct ast_filestream *fs)
+{
+	static int round_robin;
+	struct write_behind_state *wb;
+
+	if (!write_behind_running) {
+		return;
+	}
+
+	wb = ast_calloc(1, sizeof(*wb));
+	if (!wb) {
+		return;
+	}
+	ast_cond_init(&wb->complete, NULL);
+	wb->queue_idx = (unsigned int) ast_atomic_fetchadd_int(&round_robin, +1) % WRITE_BEHIND_THREADS;
+	fs->write_behind = wb;
+}
+
+/*! \brief Queue a copy of the frame for the stream's writer thread */
+static int write_behind_enqueue(struct ast_filestream *fs, struct ast_frame *f)
+{
+	struct write_behind_state *wb = fs->write_behind;
+	struct write_behind_queue *q = &write_behind_queues[wb->queue_idx];
+	struct write_behind_task *task;
+	int budget = ast_option_recwritebehind * 1024;
+
+	if (!(task = ast_calloc(1, sizeof(*task)))) {
+		return -1;
+	}
+	if (!(task->f = ast_frdup(f))) {
+		ast_free(task);
+		return -1;
+	}
+	task->fs = ao2_bump(fs);
+
+	ast_mutex_lock(&q->lock);
+	if (wb->failed) {
+		/* Surface the earlier deferred failure now, as if this write failed */
+		wb->failed = 0;
+		ast_mutex_unlock(&q->lock);
+		ast_frfree(task->f);
+		ao2_ref(task->fs, -1);
+		ast_free(task);
+		return -1;
+	}
+	while (wb->queued >= budget && !write_behind_stop) {
+		/* The recorder has outrun the disk; block here, as a direct write would */
+		ast_cond_wait(&wb->complete, &q->lock);
+	}
+	wb->queued += task->f->datalen;
+	wb->pending++;
+	AST_LIST_INSERT_TAIL(&q->tasks, task, list);
+	ast_cond_signal(&q->wakeup);
+	ast_mutex_unlock(&q->lock);
+
+	return 0;
+}
+
+/*!
+ * \brief Wait for every deferred write queued for the stream to finish.
+ *
+ * Anything that observes or moves the stream's file position (seek, tell,
+ * truncate, close) must drain first so it sees the file as the recorder
+ * left it. Harmless and cheap for streams with no deferred writes.
+ */
+static void write_behind_drain(struct ast_filestream *fs)
+{
+	struct write_behind_state *wb = fs->write_behind;
+	struct write_behind_queue *q;
+
+	if (!wb) {
+		return;
+	}
+	q = &write_behind_queues[wb->queue_idx];
+
+	ast_mutex_lock(&q->lock);
+	while (wb->pending) {
+		ast_cond_wait(&wb->complete, &q->lock);
+	}
+	ast_mutex_unlock(&q->lock);
+}
+
+static int write_behind_init(void)
+{
+	int i;
+
+	for (i = 0; i < WRITE_BEHIND_THREADS; i++) {
+		struct write_behind_queue *q = &write_behind_queues[i];
+
+		ast_mutex_init(&q->lock);
+		ast_cond_init(&q->wakeup, NULL);
+		if (ast_pthread_create_background(&q->thread, NULL, write_behind_thread, q)) {
+			while (--i >= 0) {
+				ast_mutex_lock(&write_behind_queues[i].lock);
+				write_behind_stop = 1;
+				ast_cond_signal(&write_behind_queues[i].wakeup);
+				ast_mutex_unlock(&write_behind_queues[i].lock);
+				pthread_join(write_behind_queues[i].thread, NULL);
+			}
+			return -1;
+		}
+	}
+	write_behind_running = 1;
+
+	return 0;
+}
+
+static void write_behind_shutdown(void)
+{
+	int i;
+
+	if (!write_behind_running) {
+		return;
+	}
+
+	/* The threads drain whatever is still queued before exiting */
+	for (i = 0; i < WRITE_BEHIND_THREADS; i++) {
+		ast_mutex_lock(&write_behind_queues[i].lock);
+		write_behind_stop = 1;
+		ast_cond_signal(&write_behind_queues[i].wakeup);
+		ast_mutex_unlock(&write_behind_queues[i].lock);
+	}
+	for (i = 0; i < WRITE_BEHIND_THREADS; i++) {
+		pthread_join(write_behind_queues[i].thread, NULL);
+	}
+	write_behind_running = 0;
+}
+
+/*! \brief Most prefetch hints allowed to sit unserviced before new ones are dropped */
+#define STREAM_PREFETCH_MAX_PENDING 32
+
+/*!
+ * \brief One queued ast_stream_prefetch() hint.
+ *
+ * Playlist players hand the next prompt's name over before the current one
+ * finishes, and a single background thread resolves the file and pulls it
+ * into the shared sound cache (or at least the OS page cache), so the open
+ * at the seam between prompts does not wait on the disk. The hints are
+ * purely advisory: if the thread never got started, the queue is backed up
+ * or the file cannot be found, the hint is dropped and playback simply
+ * opens the file the slow way, as it always has.
+ */
+struct stream_prefetch_task {
+	AST_LIST_ENTRY(stream_prefetch_task) list;
+	/*! Preferred language for the lookup.  (Stored in filename[]) */
+	const char *preflang;
+	/*! The name to resolve, as given to ast_streamfile() */
+	char filename[0];
+};
+
+static struct {
+	ast_mutex_t lock;
+	ast_cond_t wakeup;
+	pthread_t thread;
+	int pending;
+	AST_LIST_HEAD_NOLOCK(, stream_prefetch_task) tasks;
+} stream_prefetch_queue;
+
+/*! \brief Nonzero once the prefetch thread is up; it stays up until shutdown */
+static int stream_prefetch_running;
+
+/*! \brief Tells the prefetch thread to exit */
+static int stream_prefetch_stop;
+
+static void stream_prefetch_run(const char *filename, const char *preflang);
+
+static void *stream_prefetch_thread(void *data)
+{
+	for (;;) {
+		struct stream_prefetch_task *task;
+
+		ast_mutex_lock(&stream_prefetch_queue.lock);
+		while (!(task = AST_LIST_REMOVE_HEAD(&stream_prefetch_queue.tasks, list))) {
+			if (stream_prefetch_stop) {
+				ast_mutex_unlock(&stream_prefetch_queue.lock);
+				return NULL;
+			}
+			ast_cond_wait(&stream_prefetch_queue.wakeup, &stream_prefetch_queue.lock);
+		}
+		stream_prefetch_queue.pending--;
+		ast_mutex_unlock(&stream_prefetch_queue.lock);
+
+		stream_prefetch_run(task->filename, task->preflang);
+		ast_free(task);
+	}
+
+	return NULL;
+}
+
+void ast_stream_prefetch(const char *filename, const char *preflang)
+{
+	struct stream_prefetch_task *task;
+	size_t name_len;
+
+	if (!stream_prefetch_running || ast_strlen_zero(filename)) {
+		return;
+	}
+	if (preflang == NULL) {
+		preflang = "";
+	}
+
+	name_len = strlen(filename) + 1;
+	task = ast_calloc(1, sizeof(*task) + name_len + strlen(preflang) + 1);
+	if (!task) {
+		return;
+	}
+	strcpy(task->filename, filename); /* safe */
+	task->preflang = task->filename + name_len;
+	strcpy(task->filename + name_len, preflang); /* safe */
+
+	ast_mutex_lock(&stream_prefetch_queue.lock);
+	if (stream_prefetch_queue.pending >= STREAM_PREFETCH_MAX_PENDING) {
+		/* The disk has fallen far behind; this is only a hint, so drop it */
+		ast_mutex_unlock(&stream_prefetch_queue.lock);
+		ast_free(task);
+		return;
+	}
+	stream_prefetch_queue.pending++;
+	AST_LIST_INSERT_TAIL(&stream_prefetch_queue.tasks, task, list);
+	ast_cond_signal(&stream_prefetch_queue.wakeup);
+	ast_mutex_unlock(&stream_prefetch_queue.lock);
+}
+
+static int stream_prefetch_init(void)
+{
+	ast_mutex_init(&stream_prefetch_queue.lock);
+	ast_cond_init(&stream_prefetch_queue.wakeup, NULL);
+	if (ast_pthread_create_background(&stream_prefetch_queue.thread, NULL,
+			stream_prefetch_thread, NULL)) {
+		return -1;
+	}
+	stream_prefetch_running = 1;
+
+	return 0;
+}
+
+static void stream_prefetch_shutdown(void)
+{
+	struct stream_prefetch_task *task;
+
+	if (!stream_prefetch_running) {
+		return;
+	}
+
+	ast_mutex_lock(&stream_prefetch_queue.lock);
+	stream_prefetch_stop = 1;
+	ast_cond_signal(&stream_prefetch_queue.wakeup);
+	ast_mutex_unlock(&stream_prefetch_queue.lock);
+	pthread_join(stream_prefetch_queue.thread, NULL);
+	stream_prefetch_running = 0;
+
+	while ((task = AST_LIST_REMOVE_HEAD(&stream_prefetch_queue.tasks, list))) {
+		ast_free(task);
+	}
+	stream_prefetch_queue.pending = 0;
+}
+
 static struct ast_json *json_array_from_list(const char *list, const char *sep)
 {
 	RAII_VAR(struct ast_json *, array, ast_json_array_create(), ast_json_unref);
@@ -207,6 +826,22 @@ int ast_stopstream(struct ast_channel *tmp)
 }
 
 int ast_writestream(struct ast_filestream *fs, struct ast_frame *f)
+{
+	if (fs->write_behind) {
+		return write_behind_enqueue(fs, f);
+	}
+	return writestream_process(fs, f);
+}
+
+/*!
+ * \internal
+ * \brief Push one frame through the format module, translating if needed.
+ *
+ * Called either directly from ast_writestream() or, for streams with
+ * write-behind enabled, from a writer thread, which is then the only
+ * thread touching the stream's translator and file position.
+ */
+static int writestream_process(struct ast_filestream *fs, struct ast_frame *f)
 {
 	int res = -1;
 	if (f->frametype == AST_FRAME_VIDEO) {
@@ -398,6 +1033,14 @@ static void filestream_destructor(void *arg)
 	if (f->f) {
 		fclose(f->f);
 	}
+	ao2_cleanup(f->sound_cache_entry);
+	if (f->write_behind) {
+		struct write_behind_state *wb = f->write_behind;
+
+		/* Queued writes hold stream references, so none can be pending here */
+		ast_cond_destroy(&wb->complete);
+		ast_free(wb);
+	}
 
 	if (f->realfilename && f->filename) {
 		pid = ast_safe_fork(0);
@@ -488,14 +1131,15 @@ enum file_action {
 	ACTION_DELETE,	/* delete file, return 0 on success, -1 on error */
 	ACTION_RENAME,	/* rename file. return 0 on success, -1 on error */
 	ACTION_OPEN,
-	ACTION_COPY	/* copy file. return 0 on success, -1 on error */
+	ACTION_COPY,	/* copy file. return 0 on success, -1 on error */
+	ACTION_PREFETCH	/* warm file into the sound/page cache, return 1 if warmed */
 };
 
 /*!
  * \internal
  * \brief perform various actions on a file. Second argument
  * \note arg2 depends on the command:
- *	unused for DELETE
+ *	unused for DELETE and PREFETCH
  *  optional ast_format_cap holding all the formats found for a file, for EXISTS.
  *	destination file name (const char *) for COPY and RENAME
  *	struct ast_channel * for OPEN
@@ -522,12 +1166,19 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 		stringp = ast_strdupa(f->exts);	/* this is in the stack so does not need to be freed */
 		while ( (ext = strsep(&stringp, "|")) ) {
 			struct stat st;
+			int stat_res;
 			char *fn = build_filename(filename, ext);
 
 			if (fn == NULL)
 				continue;
 
-			if ( stat(fn, &st) ) { /* file not existent */
+			if (action == ACTION_EXISTS || action == ACTION_OPEN || action == ACTION_PREFETCH) {
+				stat_res = stat_cached(fn, &st);
+			} else {
+				/* destructive actions must see the filesystem as it is */
+				stat_res = stat(fn, &st);
+			}
+			if (stat_res) { /* file not existent */
 				ast_free(fn);
 				continue;
 			}
@@ -536,8 +1187,9 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 			 */
 			if (action == ACTION_OPEN) {
 				struct ast_channel *chan = (struct ast_channel *)arg2;
-				FILE *bfile;
+				FILE *bfile = NULL;
 				struct ast_filestream *s;
+				void *cache_ref = NULL;
 
 				if ((ast_format_cmp(ast_channel_writeformat(chan), f->format) == AST_FORMAT_CMP_NOT_EQUAL) &&
 				     !(((ast_format_get_type(f->format) == AST_MEDIA_TYPE_AUDIO) && fmt) ||
@@ -545,16 +1197,23 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 					ast_free(fn);
 					continue;	/* not a supported format */
 				}
-				if ( (bfile = fopen(fn, "r")) == NULL) {
+#ifdef HAVE_FMEMOPEN
+				bfile = mmap_cache_open(fn, &st, &cache_ref);
+#endif
+				if (!bfile && (bfile = fopen(fn, "r")) == NULL) {
 					ast_free(fn);
 					continue;	/* cannot open file */
 				}
 				s = get_filestream(f, bfile);
 				if (!s) {
 					fclose(bfile);
+					ao2_cleanup(cache_ref);
 					ast_free(fn);	/* cannot allocate descriptor */
 					continue;
 				}
+				/* the stream owns the reference to the shared data, if any,
+				 * and lets go of it after the FILE is closed */
+				s->sound_cache_entry = cache_ref;
 				if (open_wrapper(s)) {
 					ast_free(fn);
 					ast_closestream(s);
@@ -594,9 +1253,37 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				res = 1; /* file does exist and format it exists in is returned in arg2 */
 				break;
 
+			case ACTION_PREFETCH:
+			{
+				int fd;
+#ifdef HAVE_FMEMOPEN
+				void *cache_ref = NULL;
+				FILE *bfile = mmap_cache_open(fn, &st, &cache_ref);
+
+				if (bfile) {
+					/* The mapping now sits in the shared cache for the
+					 * stream that is about to open this file */
+					fclose(bfile);
+					ao2_cleanup(cache_ref);
+					res = 1;
+					break;
+				}
+#endif
+				fd = open(fn, O_RDONLY);
+				if (fd >= 0) {
+#ifdef POSIX_FADV_WILLNEED
+					posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+					close(fd);
+					res = 1;
+				}
+				break;
+			}
+
 			case ACTION_DELETE:
 				if ( (res = unlink(fn)) )
 					ast_log(LOG_WARNING, "unlink(%s) failed: %s\n", fn, strerror(errno));
+				stat_cache_invalidate(fn);
 				break;
 
 			case ACTION_RENAME:
@@ -610,6 +1297,8 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 						ast_log(LOG_WARNING, "%s(%s,%s) failed: %s\n",
 							action == ACTION_COPY ? "copy" : "rename",
 							 fn, nfn, strerror(errno));
+					stat_cache_invalidate(fn);
+					stat_cache_invalidate(nfn);
 					ast_free(nfn);
 				}
 			    }
@@ -735,6 +1424,34 @@ static int fileexists_core(const char *filename, const char *fmt, const char *pr
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Resolve a prefetch hint and warm the file, from the prefetch thread.
+ *
+ * Resolution follows the same language fallback as ast_openstream_full(),
+ * so the file warmed is the one a subsequent ast_streamfile() will open.
+ * Which format the channel will pick cannot be known here, so every format
+ * the file exists in is warmed; prompts are rarely installed in more than
+ * one.
+ */
+static void stream_prefetch_run(const char *filename, const char *preflang)
+{
+	char *buf;
+	int buflen;
+
+	buflen = strlen(preflang) + strlen(filename) + 4;
+	buf = ast_malloc(buflen);
+	if (!buf) {
+		return;
+	}
+
+	if (fileexists_core(filename, NULL, preflang, buf, buflen, NULL)) {
+		filehelper(buf, NULL, NULL, ACTION_PREFETCH);
+	}
+
+	ast_free(buf);
+}
+
 struct ast_filestream *ast_openstream(struct ast_channel *chan, const char *filename, const char *preflang)
 {
 	return ast_openstream_full(chan, filename, preflang, 0);
@@ -1020,16 +1737,19 @@ int ast_playstream(struct ast_filestream *s)
 
 int ast_seekstream(struct ast_filestream *fs, off_t sample_offset, int whence)
 {
+	write_behind_drain(fs);
 	return fs->fmt->seek(fs, sample_offset, whence);
 }
 
 int ast_truncstream(struct ast_filestream *fs)
 {
+	write_behind_drain(fs);
 	return fs->fmt->trunc(fs);
 }
 
 off_t ast_tellstream(struct ast_filestream *fs)
 {
+	write_behind_drain(fs);
 	return fs->fmt->tell(fs);
 }
 
@@ -1057,6 +1777,9 @@ int ast_closestream(struct ast_filestream *f)
 	if (f == NULL) {
 		return 0;
 	}
+	/* Wait out any deferred writes so the file is complete when callers
+	 * (post-recording commands, voicemail delivery) go on to use it. */
+	write_behind_drain(f);
 	filestream_close(f);
 	ao2_ref(f, -1);
 	return 0;
@@ -1461,6 +2184,14 @@ struct ast_filestream *ast_writefile(const char *filename, const char *type, con
 			fs->vfs = NULL;
 			/* If truncated, we'll be at the beginning; if not truncated, then append */
 			f->seek(fs, 0, SEEK_END);
+			if (ast_option_recwritebehind) {
+				write_behind_attach(fs);
+			}
+			/* A fresh recording may now exist where a lookup recently missed */
+			stat_cache_invalidate(fn);
+			if (orig_fn) {
+				stat_cache_invalidate(orig_fn);
+			}
 		} else if (errno != EEXIST) {
 			ast_log(LOG_WARNING, "Unable to open file %s: %s\n", fn, strerror(errno));
 			if (orig_fn)
@@ -1795,6 +2526,42 @@ int ast_stream_and_wait(struct ast_channel *chan, const char *file, const char *
 	return res;
 }
 
+int ast_stream_and_wait_files(struct ast_channel *chan, const char * const *files,
+	size_t count, const char *preflang, const char *digits, int audiofd, int ctrlfd)
+{
+	size_t i;
+	int res = 0;
+
+	/* Resolve the whole sequence before any audio is played. This warms
+	 * the format/language search for every file in the sequence, and a
+	 * missing prompt is reported here, before playback starts, rather
+	 * than part way through the sequence. */
+	for (i = 0; i < count; i++) {
+		if (!ast_fileexists(files[i], NULL, preflang)) {
+			ast_log(LOG_WARNING, "File %s does not exist in any format\n",
+				!ast_strlen_zero(files[i]) ? files[i] : "(empty)");
+		}
+	}
+
+	for (i = 0; i < count && !res; i++) {
+		if (!ast_fileexists(files[i], NULL, preflang)) {
+			/* already reported above; skip it like a failed
+			 * ast_streamfile() and keep going */
+			continue;
+		}
+		if (!ast_streamfile(chan, files[i], preflang)) {
+			if (audiofd > -1 && ctrlfd > -1) {
+				res = ast_waitstream_full(chan, digits, audiofd, ctrlfd);
+			} else {
+				res = ast_waitstream(chan, digits);
+			}
+		}
+		ast_stopstream(chan);
+	}
+
+	return res;
+}
+
 char *ast_format_str_reduce(char *fmts)
 {
 	struct ast_format_def *f;
@@ -1926,15 +2693,34 @@ static struct ast_cli_entry cli_file[] = {
 
 static void file_shutdown(void)
 {
+	stream_prefetch_shutdown();
+	write_behind_shutdown();
 	ast_cli_unregister_multiple(cli_file, ARRAY_LEN(cli_file));
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_unregister_type);
+	ao2_cleanup(stat_cache);
+	stat_cache = NULL;
+#ifdef HAVE_FMEMOPEN
+	ao2_cleanup(mmap_cache);
+	mmap_cache = NULL;
+	mmap_cache_bytes = 0;
+#endif
 }
 
 int ast_file_init(void)
 {
 	STASIS_MESSAGE_TYPE_INIT(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_INIT(ast_format_unregister_type);
+	stat_cache = ao2_container_alloc(STAT_CACHE_BUCKETS, stat_cache_hash, stat_cache_cmp);
+#ifdef HAVE_FMEMOPEN
+	mmap_cache = ao2_container_alloc(MMAP_CACHE_BUCKETS, mmap_cache_hash, mmap_cache_cmp);
+#endif
+	if (write_behind_init()) {
+		ast_log(LOG_WARNING, "Unable to start recording writer threads; writes will happen in the calling thread\n");
+	}
+	if (stream_prefetch_init()) {
+		ast_log(LOG_WARNING, "Unable to start sound prefetch thread; prefetch hints will be ignored\n");
+	}
 	ast_cli_register_multiple(cli_file, ARRAY_LEN(cli_file));
 	ast_register_cleanup(file_shutdown);
 	return 0;
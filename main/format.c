@@ -32,6 +32,7 @@
 #include "asterisk/logger.h"
 #include "asterisk/codec.h"
 #include "asterisk/format.h"
+#include "asterisk/format_cache.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/strings.h"
 #include "asterisk/module.h"
@@ -62,6 +63,40 @@ struct format_interface {
 /*! \brief Container for registered format interfaces */
 static struct ao2_container *interfaces;
 
+/*! \brief Number of buckets to use for cached fmtp parses (should be prime for performance reasons) */
+#define FMTP_CACHE_BUCKETS 53
+
+/*! \brief Maximum number of cached fmtp parses retained at once */
+#define FMTP_CACHE_MAX_SIZE 512
+
+/*! \brief Structure for a cached fmtp parse */
+struct fmtp_cache_entry {
+	/*! \brief Format the attribute line was parsed against */
+	struct ast_format *base;
+	/*! \brief The immutable parsed result */
+	struct ast_format *parsed;
+	/*! \brief The raw fmtp attribute line */
+	char attributes[0];
+};
+
+/*! \brief Key used when searching the fmtp cache */
+struct fmtp_cache_key {
+	/*! \brief Format the attribute line is to be parsed against */
+	const struct ast_format *base;
+	/*! \brief The raw fmtp attribute line */
+	const char *attributes;
+};
+
+/*!
+ * \brief Container of cached fmtp parses
+ *
+ * The same devices send the same fmtp lines in every negotiation, so parsed
+ * attribute sets are interned keyed on the base format and the raw attribute
+ * string. Repeated negotiations then share one immutable parsed format,
+ * which also lets ast_format_cmp succeed on pointer equality.
+ */
+static struct ao2_container *fmtp_cache;
+
 static int format_interface_hash(const void *obj, int flags)
 {
 	const struct format_interface *format_interface;
@@ -110,9 +145,63 @@ static int format_interface_cmp(void *obj, void *arg, int flags)
 	return CMP_MATCH;
 }
 
+static void fmtp_cache_entry_destructor(void *obj)
+{
+	struct fmtp_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->base);
+	ao2_cleanup(entry->parsed);
+}
+
+static int fmtp_cache_hash(const void *obj, int flags)
+{
+	const struct fmtp_cache_entry *entry;
+	const struct fmtp_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return ast_str_hash(key->attributes);
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		return ast_str_hash(entry->attributes);
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int fmtp_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct fmtp_cache_entry *left = obj;
+	const struct fmtp_cache_entry *right = arg;
+	const struct fmtp_cache_key *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		if (left->base != right->base || strcmp(left->attributes, right->attributes)) {
+			return 0;
+		}
+		break;
+	case OBJ_SEARCH_KEY:
+		if (left->base != right_key->base || strcmp(left->attributes, right_key->attributes)) {
+			return 0;
+		}
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
 /*! \brief Function called when the process is shutting down */
 static void format_shutdown(void)
 {
+	ao2_cleanup(fmtp_cache);
+	fmtp_cache = NULL;
 	ao2_cleanup(interfaces);
 	interfaces = NULL;
 }
@@ -125,6 +214,14 @@ int ast_format_init(void)
 		return -1;
 	}
 
+	fmtp_cache = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_MUTEX, FMTP_CACHE_BUCKETS, fmtp_cache_hash,
+		fmtp_cache_cmp);
+	if (!fmtp_cache) {
+		ao2_cleanup(interfaces);
+		interfaces = NULL;
+		return -1;
+	}
+
 	ast_register_cleanup(format_shutdown);
 
 	return 0;
@@ -170,6 +267,11 @@ void *ast_format_get_attribute_data(const struct ast_format *format)
 	return format->attribute_data;
 }
 
+int ast_format_has_attribute_interface(const struct ast_format *format)
+{
+	return format->interface ? 1 : 0;
+}
+
 void ast_format_set_attribute_data(struct ast_format *format, void *attribute_data)
 {
 	format->attribute_data = attribute_data;
@@ -191,6 +293,27 @@ struct ast_format *ast_format_create_named(const char *format_name, struct ast_c
 {
 	struct ast_format *format;
 	struct format_interface *format_interface;
+	const struct ast_format_interface *interface = NULL;
+
+	format_interface = ao2_find(interfaces, codec->name, OBJ_SEARCH_KEY);
+	if (format_interface) {
+		interface = format_interface->interface;
+		ao2_ref(format_interface, -1);
+	} else {
+		/* Without an attribute interface every format for this codec is
+		 * identical and immutable, so hand out the cached format instead
+		 * of a duplicate. Keeping a single canonical object lets
+		 * ast_format_cmp succeed on pointer equality alone.
+		 */
+		struct ast_format *cached = ast_format_cache_get(format_name);
+
+		if (cached) {
+			if (cached->codec == codec && !cached->interface && !cached->attribute_data) {
+				return cached;
+			}
+			ao2_ref(cached, -1);
+		}
+	}
 
 	format = ao2_t_alloc_options(sizeof(*format), format_destroy,
 		AO2_ALLOC_OPT_LOCK_NOLOCK, S_OR(codec->description, ""));
@@ -199,20 +322,24 @@ struct ast_format *ast_format_create_named(const char *format_name, struct ast_c
 	}
 	format->name = format_name;
 	format->codec = ao2_bump(codec);
-
-	format_interface = ao2_find(interfaces, codec->name, OBJ_SEARCH_KEY);
-	if (format_interface) {
-		format->interface = format_interface->interface;
-		ao2_ref(format_interface, -1);
-	}
+	format->interface = interface;
 
 	return format;
 }
 
 struct ast_format *ast_format_clone(const struct ast_format *format)
 {
-	struct ast_format *cloned = ast_format_create_named(format->name, format->codec);
+	struct ast_format *cloned;
 
+	/* A format without an attribute interface carries no state beyond its
+	 * codec and is immutable, so a clone would be indistinguishable from
+	 * the original; keep the canonical object instead of duplicating it.
+	 */
+	if (!format->interface) {
+		return ao2_bump((struct ast_format *) format);
+	}
+
+	cloned = ast_format_create_named(format->name, format->codec);
 	if (!cloned) {
 		return NULL;
 	}
@@ -248,7 +375,13 @@ enum ast_format_cmp_res ast_format_cmp(const struct ast_format *format1, const s
 
 	interface = format1->interface ? format1->interface : format2->interface;
 
-	if (interface && interface->format_cmp) {
+	/* The attribute comparison only matters when attributes are actually
+	 * present; every interface treats a format without attribute data as a
+	 * wildcard, so two bare formats of the same codec are equal without
+	 * consulting it.
+	 */
+	if (interface && interface->format_cmp
+		&& (format1->attribute_data || format2->attribute_data)) {
 		return interface->format_cmp(format1, format2);
 	}
 
@@ -318,6 +451,12 @@ const void *ast_format_attribute_get(const struct ast_format *format, const char
 struct ast_format *ast_format_parse_sdp_fmtp(const struct ast_format *format, const char *attributes)
 {
 	const struct ast_format_interface *interface = format->interface;
+	struct fmtp_cache_key key = {
+		.base = format,
+		.attributes = attributes,
+	};
+	struct fmtp_cache_entry *entry;
+	struct ast_format *parsed;
 
 	if (!interface) {
 		struct format_interface *format_interface = ao2_find(interfaces, format->codec->name, OBJ_SEARCH_KEY);
@@ -331,7 +470,41 @@ struct ast_format *ast_format_parse_sdp_fmtp(const struct ast_format *format, co
 		return ao2_bump((struct ast_format*)format);
 	}
 
-	return interface->format_parse_sdp_fmtp(format, attributes);
+	if (fmtp_cache) {
+		entry = ao2_find(fmtp_cache, &key, OBJ_SEARCH_KEY);
+		if (entry) {
+			parsed = ao2_bump(entry->parsed);
+			ao2_ref(entry, -1);
+			return parsed;
+		}
+	}
+
+	parsed = interface->format_parse_sdp_fmtp(format, attributes);
+
+	if (fmtp_cache && parsed && parsed != format) {
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(attributes) + 1,
+			fmtp_cache_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (entry) {
+			entry->base = ao2_bump((struct ast_format *)format);
+			entry->parsed = ao2_bump(parsed);
+			strcpy(entry->attributes, attributes); /* Safe */
+
+			ao2_lock(fmtp_cache);
+			/* Identical fmtp lines repeat from the same devices all day
+			 * while genuinely distinct lines are few, so when the cache
+			 * does fill up it is cheapest to empty it entirely and let
+			 * the popular lines repopulate it. */
+			if (ao2_container_count(fmtp_cache) >= FMTP_CACHE_MAX_SIZE) {
+				ao2_callback(fmtp_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+					NULL, NULL);
+			}
+			ao2_link_flags(fmtp_cache, entry, OBJ_NOLOCK);
+			ao2_unlock(fmtp_cache);
+			ao2_ref(entry, -1);
+		}
+	}
+
+	return parsed;
 }
 
 void ast_format_generate_sdp_fmtp(const struct ast_format *format, unsigned int payload, struct ast_str **str)
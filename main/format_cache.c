@@ -486,7 +486,7 @@ int ast_format_cache_set(struct ast_format *format)
 struct ast_format *__ast_format_cache_get(const char *name,
 	const char *tag, const char *file, int line, const char *func)
 {
-	if (ast_strlen_zero(name)) {
+	if (!formats || ast_strlen_zero(name)) {
 		return NULL;
 	}
 
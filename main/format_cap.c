@@ -50,6 +50,9 @@ struct format_cap_framed {
 	AST_LIST_ENTRY(format_cap_framed) entry;
 };
 
+/*! \brief Number of codec identifiers the compatibility fast path can track */
+#define FORMAT_CAP_BITS 128
+
 /*! \brief Format capabilities structure, holds formats + preference order + etc */
 struct ast_format_cap {
 	/*! \brief Vector of formats, indexed using the codec identifier */
@@ -58,6 +61,12 @@ struct ast_format_cap {
 	AST_VECTOR(, struct format_cap_framed *) preference_order;
 	/*! \brief Global framing size, applies to all formats if no framing present on format */
 	unsigned int framing;
+	/*! \brief Bitset of codec identifiers present, for cheap intersection tests */
+	uint64_t codec_bits[FORMAT_CAP_BITS / 64];
+	/*! \brief Number of formats whose codec identifier the bitset cannot track */
+	unsigned int high_ids;
+	/*! \brief Number of formats whose comparisons involve an attribute interface */
+	unsigned int attr_formats;
 };
 
 /*! \brief Linked list for formats */
@@ -138,6 +147,82 @@ void ast_format_cap_set_framing(struct ast_format_cap *cap, unsigned int framing
 	cap->framing = framing;
 }
 
+/*! \brief Account for a format entering the capabilities structure */
+static void format_cap_bits_add(struct ast_format_cap *cap, struct ast_format *format)
+{
+	unsigned int id = ast_format_get_codec_id(format);
+
+	if (id < FORMAT_CAP_BITS) {
+		cap->codec_bits[id / 64] |= (uint64_t) 1 << (id % 64);
+	} else {
+		cap->high_ids++;
+	}
+	if (ast_format_has_attribute_interface(format)) {
+		cap->attr_formats++;
+	}
+}
+
+/*!
+ * \brief Account for a format leaving the capabilities structure
+ *
+ * \param last Nonzero if no other format with the same codec identifier remains
+ */
+static void format_cap_bits_remove(struct ast_format_cap *cap, struct ast_format *format, int last)
+{
+	unsigned int id = ast_format_get_codec_id(format);
+
+	if (id < FORMAT_CAP_BITS) {
+		if (last) {
+			cap->codec_bits[id / 64] &= ~((uint64_t) 1 << (id % 64));
+		}
+	} else {
+		cap->high_ids--;
+	}
+	if (ast_format_has_attribute_interface(format)) {
+		cap->attr_formats--;
+	}
+}
+
+/*! \brief Determine from the bitset alone that the format's codec is absent */
+static int format_cap_id_absent(const struct ast_format_cap *cap, const struct ast_format *format)
+{
+	unsigned int id = ast_format_get_codec_id(format);
+
+	if (id >= FORMAT_CAP_BITS) {
+		/* The bitset cannot speak for this codec */
+		return 0;
+	}
+	return !(cap->codec_bits[id / 64] & ((uint64_t) 1 << (id % 64)));
+}
+
+/*!
+ * \internal
+ * \brief Try to decide whether two caps intersect using the codec bitsets alone.
+ *
+ * \retval 0 the caps cannot share a compatible format
+ * \retval 1 the caps definitely share a compatible format
+ * \retval -1 undecidable here; the caller must walk the formats
+ */
+static int format_cap_intersect_fast(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2)
+{
+	uint64_t common = 0;
+	int x;
+
+	for (x = 0; x < ARRAY_LEN(cap1->codec_bits); x++) {
+		common |= cap1->codec_bits[x] & cap2->codec_bits[x];
+	}
+
+	if (!common) {
+		/* Codecs the bitset could not track may still intersect */
+		return (cap1->high_ids && cap2->high_ids) ? -1 : 0;
+	}
+	if (cap1->attr_formats || cap2->attr_formats) {
+		/* A codec is shared, but attributes decide actual compatibility */
+		return -1;
+	}
+	return 1;
+}
+
 /*! \brief Destructor for format capabilities framed structure */
 static void format_cap_framed_destroy(void *obj)
 {
@@ -167,6 +252,8 @@ static inline int format_cap_framed_init(struct format_cap_framed *framed, struc
 	/* This takes the allocation reference */
 	AST_VECTOR_APPEND(&cap->preference_order, framed);
 
+	format_cap_bits_add(cap, format);
+
 	cap->framing = MIN(cap->framing, framing ? framing : ast_format_get_default_ms(format));
 
 	return 0;
@@ -290,6 +377,13 @@ static int format_cap_replace(struct ast_format_cap *cap, struct ast_format *for
 		framed = AST_VECTOR_GET(&cap->preference_order, i);
 
 		if (ast_format_get_codec_id(format) == ast_format_get_codec_id(framed->format)) {
+			/* Same codec, but the attribute accounting may change */
+			if (ast_format_has_attribute_interface(framed->format)) {
+				cap->attr_formats--;
+			}
+			if (ast_format_has_attribute_interface(format)) {
+				cap->attr_formats++;
+			}
 			ao2_t_replace(framed->format, format, "replacing with new format");
 			framed->framing = framing;
 			return 0;
@@ -509,6 +603,7 @@ int ast_format_cap_remove(struct ast_format_cap *cap, struct ast_format *format)
 		}
 
 		AST_LIST_REMOVE_CURRENT(entry);
+		format_cap_bits_remove(cap, framed->format, AST_LIST_EMPTY(list));
 		FORMAT_CAP_FRAMED_ELEM_CLEANUP(framed);
 		break;
 	}
@@ -535,6 +630,7 @@ void ast_format_cap_remove_by_type(struct ast_format_cap *cap, enum ast_media_ty
 			AST_LIST_REMOVE_CURRENT(entry);
 			AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, framed->format,
 				FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP);
+			format_cap_bits_remove(cap, framed->format, AST_LIST_EMPTY(list));
 			ao2_ref(framed, -1);
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
@@ -549,7 +645,8 @@ struct ast_format *ast_format_cap_get_compatible_format(const struct ast_format_
 
 	ast_assert(format != NULL);
 
-	if (ast_format_get_codec_id(format) >= AST_VECTOR_SIZE(&cap->formats)) {
+	if (format_cap_id_absent(cap, format)
+		|| ast_format_get_codec_id(format) >= AST_VECTOR_SIZE(&cap->formats)) {
 		return NULL;
 	}
 
@@ -585,7 +682,8 @@ enum ast_format_cmp_res ast_format_cap_iscompatible_format(const struct ast_form
 
 	ast_assert(format != NULL);
 
-	if (ast_format_get_codec_id(format) >= AST_VECTOR_SIZE(&cap->formats)) {
+	if (format_cap_id_absent(cap, format)
+		|| ast_format_get_codec_id(format) >= AST_VECTOR_SIZE(&cap->formats)) {
 		return AST_FORMAT_CMP_NOT_EQUAL;
 	}
 
@@ -628,6 +726,10 @@ int ast_format_cap_get_compatible(const struct ast_format_cap *cap1, const struc
 {
 	int idx, res = 0;
 
+	if (!format_cap_intersect_fast(cap1, cap2)) {
+		return 0;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 		struct ast_format *format;
@@ -652,6 +754,16 @@ int ast_format_cap_iscompatible(const struct ast_format_cap *cap1, const struct
 {
 	int idx;
 
+	switch (format_cap_intersect_fast(cap1, cap2)) {
+	case 0:
+		return 0;
+	case 1:
+		return 1;
+	default:
+		/* The bitsets cannot decide; compare the formats themselves */
+		break;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 
@@ -57,16 +57,53 @@ AST_THREADSTORAGE_CUSTOM(frame_cache, NULL, frame_cache_cleanup);
  * the same thread that allocates the frame will be the one freeing them, so
  * sometimes a thread will never have any frames in its cache, or the cache
  * will never be pulled from.  For the latter case, we limit the maximum size.
+ *
+ * The cache is deep enough to ride out a scheduling hiccup's worth of
+ * 20ms voice frames without falling back to the heap.
  */
-#define FRAME_CACHE_MAX_SIZE	10
+#define FRAME_CACHE_MAX_SIZE	32
+
+/*!
+ * \brief Largest data buffer the frame cache will hold on to
+ *
+ * Sized to cover the largest buffer a channel driver receives media
+ * into (res_rtp_asterisk reads into 8192 byte buffers plus
+ * AST_FRIENDLY_OFFSET of headroom).
+ */
+#define FRAME_CACHE_MAX_DATA_LEN	(8192 + AST_FRIENDLY_OFFSET)
+
+/*!
+ * \brief Total bytes of data buffers a thread's frame cache may retain
+ *
+ * Bounds what an idle thread can hoard now that individual buffers may
+ * be as large as FRAME_CACHE_MAX_DATA_LEN.
+ */
+#define FRAME_CACHE_MAX_DATA_BYTES	65536
 
 /*! \brief This is just so ast_frames, a list head struct for holding a list of
  *  ast_frame structures, is defined. */
 AST_LIST_HEAD_NOLOCK(ast_frames, ast_frame);
 
+/*!
+ * \brief Overlay used to link a freed frame data buffer into the cache
+ *
+ * Laid over the front of the buffer itself, so a buffer is only cached
+ * when its capacity can hold this struct.  The recorded capacity is the
+ * offset plus datalen at free time, a safe lower bound of the original
+ * allocation.
+ */
+struct frame_data_cached {
+	AST_LIST_ENTRY(frame_data_cached) list;
+	size_t cap;
+};
+
 struct ast_frame_cache {
 	struct ast_frames list;
 	size_t size;
+	/*! Freed frame data buffers for reuse by ast_frisolate() */
+	AST_LIST_HEAD_NOLOCK(, frame_data_cached) data_list;
+	/*! Total capacity of the buffers on data_list */
+	size_t data_bytes;
 };
 #endif
 
@@ -106,14 +143,73 @@ static void frame_cache_cleanup(void *data)
 {
 	struct ast_frame_cache *frames = data;
 	struct ast_frame *f;
+	struct frame_data_cached *cached;
 
 	while ((f = AST_LIST_REMOVE_HEAD(&frames->list, frame_list)))
 		ast_free(f);
 
+	while ((cached = AST_LIST_REMOVE_HEAD(&frames->data_list, list)))
+		ast_free(cached);
+
 	ast_free(frames);
 }
 #endif
 
+/*!
+ * \internal
+ * \brief Allocate a frame data buffer, reusing a cached one when possible.
+ *
+ * Buffers freed with a frame end up in the per-thread cache (see
+ * __frame_free()), so steady-state voice paths recycle the same few
+ * buffers instead of hitting the allocator once per frame.
+ */
+static void *frame_data_alloc(size_t len)
+{
+#if !defined(LOW_MEMORY)
+	struct ast_frame_cache *frames;
+
+	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
+		struct frame_data_cached *cached;
+
+		AST_LIST_TRAVERSE_SAFE_BEGIN(&frames->data_list, cached, list) {
+			if (cached->cap >= len) {
+				AST_LIST_REMOVE_CURRENT(list);
+				frames->data_bytes -= cached->cap;
+				return cached;
+			}
+		}
+		AST_LIST_TRAVERSE_SAFE_END;
+	}
+#endif
+
+	return ast_malloc(len);
+}
+
+void *ast_frame_data_alloc(size_t len)
+{
+	return frame_data_alloc(len);
+}
+
+void ast_frame_data_free(void *data, size_t len)
+{
+#if !defined(LOW_MEMORY)
+	struct ast_frame_cache *frames;
+
+	if (sizeof(struct frame_data_cached) <= len && len <= FRAME_CACHE_MAX_DATA_LEN
+		&& (frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))
+		&& frames->data_bytes + len <= FRAME_CACHE_MAX_DATA_BYTES) {
+		struct frame_data_cached *cached = data;
+
+		cached->cap = len;
+		AST_LIST_INSERT_HEAD(&frames->data_list, cached, list);
+		frames->data_bytes += len;
+		return;
+	}
+#endif
+
+	ast_free(data);
+}
+
 static void __frame_free(struct ast_frame *fr, int cache)
 {
 	if (!fr->mallocd)
@@ -136,6 +232,25 @@ static void __frame_free(struct ast_frame *fr, int cache)
 			return;
 		}
 	}
+
+	if (cache && (fr->mallocd & AST_MALLOCD_DATA) && fr->data.ptr) {
+		/* Return the data buffer to the per-thread cache for reuse by
+		 * ast_frisolate() rather than handing it back to the heap. */
+		struct ast_frame_cache *frames;
+		size_t cap = fr->offset + fr->datalen;
+
+		if (sizeof(struct frame_data_cached) <= cap && cap <= FRAME_CACHE_MAX_DATA_LEN
+			&& (frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))
+			&& frames->data_bytes + cap <= FRAME_CACHE_MAX_DATA_BYTES) {
+			struct frame_data_cached *cached = (void *) (fr->data.ptr - fr->offset);
+
+			cached->cap = cap;
+			AST_LIST_INSERT_HEAD(&frames->data_list, cached, list);
+			frames->data_bytes += cap;
+			fr->mallocd &= ~AST_MALLOCD_DATA;
+			fr->data.ptr = NULL;
+		}
+	}
 #endif
 
 	if (fr->mallocd & AST_MALLOCD_DATA) {
@@ -245,7 +360,7 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 			out->mallocd = AST_MALLOCD_HDR | AST_MALLOCD_SRC;
 			return out;
 		}
-		if (!(newdata = ast_malloc(fr->datalen + AST_FRIENDLY_OFFSET))) {
+		if (!(newdata = frame_data_alloc(fr->datalen + AST_FRIENDLY_OFFSET))) {
 			if (out->src != fr->src) {
 				ast_free((void *) out->src);
 			}
@@ -644,9 +759,151 @@ void ast_frame_dump(const char *name, struct ast_frame *f, char *prefix)
 			    term_color(cn, name, COLOR_YELLOW, COLOR_BLACK, sizeof(cn)));
 }
 
+/*!
+ * \internal
+ * \brief Saturated slinear gain kernels.
+ *
+ * Volume adjustment runs per frame for VOLUME(), audiohook volume and
+ * conference talker/listener gain, so the per-sample multiply/divide is
+ * worth vectorizing.  A positive adjustment is a saturating 16-bit
+ * multiply, which maps onto widening multiply plus saturating pack on
+ * x86 and ARM.  A negative adjustment is a truncating integer divide;
+ * there is no packed integer division, but double precision division is
+ * exact for any 16-bit dividend/divisor pair, so the SSE2 divide kernel
+ * goes through doubles and truncates.  The kernels are selected once for
+ * the running CPU and fall back to the scalar helpers from utils.h.
+ */
+typedef void (*slin_gain_fn)(short *data, unsigned int samples, short gain);
+
+static void slin_gain_multiply_scalar(short *data, unsigned int samples, short gain)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_multiply(&data[i], &gain);
+	}
+}
+
+static void slin_gain_divide_scalar(short *data, unsigned int samples, short gain)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; ++i) {
+		ast_slinear_saturated_divide(&data[i], &gain);
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#define SLIN_GAIN_HAVE_X86_KERNELS 1
+
+#include <immintrin.h>
+
+static __attribute__((target("sse2"))) void slin_gain_multiply_sse2(short *data, unsigned int samples, short gain)
+{
+	__m128i g = _mm_set1_epi16(gain);
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i v = _mm_loadu_si128((__m128i *) &data[i]);
+		__m128i lo = _mm_mullo_epi16(v, g);
+		__m128i hi = _mm_mulhi_epi16(v, g);
+
+		/* Interleave to the full 32-bit products, then pack with
+		 * signed saturation back to 16 bits. */
+		_mm_storeu_si128((__m128i *) &data[i],
+			_mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi)));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_multiply(&data[i], &gain);
+	}
+}
+
+static __attribute__((target("sse2"))) void slin_gain_divide_sse2(short *data, unsigned int samples, short gain)
+{
+	__m128d g = _mm_set1_pd(gain);
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		__m128i v = _mm_loadu_si128((__m128i *) &data[i]);
+		__m128i sign = _mm_srai_epi16(v, 15);
+		__m128i v01 = _mm_unpacklo_epi16(v, sign);
+		__m128i v23 = _mm_unpackhi_epi16(v, sign);
+		__m128i q01;
+		__m128i q23;
+
+		q01 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(v01), g));
+		q01 = _mm_unpacklo_epi64(q01,
+			_mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(v01, 8)), g)));
+		q23 = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(v23), g));
+		q23 = _mm_unpacklo_epi64(q23,
+			_mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(v23, 8)), g)));
+		_mm_storeu_si128((__m128i *) &data[i], _mm_packs_epi32(q01, q23));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_divide(&data[i], &gain);
+	}
+}
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+#define SLIN_GAIN_HAVE_NEON_KERNELS 1
+
+#include <arm_neon.h>
+
+static void slin_gain_multiply_neon(short *data, unsigned int samples, short gain)
+{
+	int16x4_t g = vdup_n_s16(gain);
+	unsigned int i = 0;
+
+	for (; i + 8 <= samples; i += 8) {
+		int16x8_t v = vld1q_s16(&data[i]);
+
+		/* Widening multiply, then saturating narrow back to 16 bits */
+		vst1q_s16(&data[i], vcombine_s16(
+			vqmovn_s32(vmull_s16(vget_low_s16(v), g)),
+			vqmovn_s32(vmull_s16(vget_high_s16(v), g))));
+	}
+	for (; i < samples; ++i) {
+		ast_slinear_saturated_multiply(&data[i], &gain);
+	}
+}
+
+#endif
+
+/*! \brief Kernel used to amplify a frame in ast_frame_adjust_volume() */
+static slin_gain_fn slin_gain_multiply;
+
+/*! \brief Kernel used to attenuate a frame in ast_frame_adjust_volume() */
+static slin_gain_fn slin_gain_divide;
+
+/*!
+ * \internal
+ * \brief Select the gain kernels the running CPU supports.
+ *
+ * \note Idempotent, so the unsynchronized first-use race is harmless.
+ */
+static void slin_gain_select(void)
+{
+	slin_gain_fn multiply = slin_gain_multiply_scalar;
+	slin_gain_fn divide = slin_gain_divide_scalar;
+
+#if defined(SLIN_GAIN_HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		multiply = slin_gain_multiply_sse2;
+		divide = slin_gain_divide_sse2;
+	}
+#elif defined(SLIN_GAIN_HAVE_NEON_KERNELS)
+	multiply = slin_gain_multiply_neon;
+#endif
+
+	slin_gain_divide = divide;
+	slin_gain_multiply = multiply;
+}
+
 int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 {
-	int count;
 	short *fdata = f->data.ptr;
 	short adjust_value = abs(adjustment);
 
@@ -658,12 +915,16 @@ int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 		return 0;
 	}
 
-	for (count = 0; count < f->samples; count++) {
-		if (adjustment > 0) {
-			ast_slinear_saturated_multiply(&fdata[count], &adjust_value);
-		} else if (adjustment < 0) {
-			ast_slinear_saturated_divide(&fdata[count], &adjust_value);
+	if (adjustment > 0) {
+		if (!slin_gain_multiply) {
+			slin_gain_select();
+		}
+		slin_gain_multiply(fdata, f->samples, adjust_value);
+	} else {
+		if (!slin_gain_divide) {
+			slin_gain_select();
 		}
+		slin_gain_divide(fdata, f->samples, adjust_value);
 	}
 
 	return 0;
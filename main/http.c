@@ -49,6 +49,10 @@
 #include <sys/stat.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <netinet/tcp.h>	/* TCP_CORK */
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "asterisk/paths.h"	/* use ast_config_AST_DATA_DIR */
 #include "asterisk/cli.h"
@@ -319,7 +323,7 @@ static int static_callback(struct ast_tcptls_session_instance *ser,
 		}
 	}
 
-	http_header = ast_str_create(255);
+	http_header = ast_str_pool_get(255);
 	if (!http_header) {
 		ast_http_request_close_on_completion(ser);
 		ast_http_error(ser, 500, "Server Error", "Out of memory");
@@ -366,7 +370,7 @@ static int httpstatus_callback(struct ast_tcptls_session_instance *ser,
 		return 0;
 	}
 
-	out = ast_str_create(512);
+	out = ast_str_pool_get(512);
 	if (!out) {
 		ast_http_request_close_on_completion(ser);
 		ast_http_error(ser, 500, "Server Error", "Out of memory");
@@ -450,14 +454,18 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	struct ast_tm tm;
 	char timebuf[80];
 	int content_length = 0;
+	off_t fd_length = 0;
 	int close_connection;
-	struct ast_str *server_header_field = ast_str_create(MAX_SERVER_NAME_LENGTH);
+	struct ast_str *server_header_field = ast_str_pool_get(MAX_SERVER_NAME_LENGTH);
+#ifdef TCP_CORK
+	int corked = 0;
+#endif
 
 	if (!ser || !ser->f || !server_header_field) {
 		/* The connection is not open. */
-		ast_free(http_header);
-		ast_free(out);
-		ast_free(server_header_field);
+		ast_str_pool_put(http_header);
+		ast_str_pool_put(out);
+		ast_str_pool_put(server_header_field);
 		return;
 	}
 
@@ -498,10 +506,21 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	}
 
 	if (fd) {
-		content_length += lseek(fd, 0, SEEK_END);
+		fd_length = lseek(fd, 0, SEEK_END);
 		lseek(fd, 0, SEEK_SET);
+		content_length += fd_length;
 	}
 
+#ifdef TCP_CORK
+	if (!ser->ssl) {
+		int on = 1;
+
+		/* Hold the header back until the body has been written so
+		 * both leave in full frames despite TCP_NODELAY. */
+		corked = !setsockopt(ser->fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+	}
+#endif
+
 	/* send http header */
 	fprintf(ser->f,
 		"HTTP/1.1 %d %s\r\n"
@@ -531,22 +550,75 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 		}
 
 		if (fd) {
-			char buf[256];
-			int len;
+			int copied = 0;
 
-			while ((len = read(fd, buf, sizeof(buf))) > 0) {
-				if (fwrite(buf, len, 1, ser->f) != 1) {
-					ast_log(LOG_WARNING, "fwrite() failed: %s\n", strerror(errno));
+#ifdef __linux__
+			if (!ser->ssl) {
+				/* The kernel can copy the file straight to the socket.
+				 * TLS content must pass through SSL_write() instead. */
+				off_t offset = 0;
+
+				if (fflush(ser->f)) {
+					ast_log(LOG_WARNING, "fflush() failed: %s\n", strerror(errno));
 					close_connection = 1;
-					break;
+				} else {
+					while (offset < fd_length) {
+						ssize_t sent;
+
+						sent = sendfile(ser->fd, fd, &offset, fd_length - offset);
+						if (sent < 0) {
+							if (errno == EINTR) {
+								continue;
+							}
+							if (errno == EAGAIN
+								&& ast_wait_for_output(ser->fd, session_inactivity) > 0) {
+								continue;
+							}
+							ast_log(LOG_WARNING, "sendfile() failed: %s\n", strerror(errno));
+							close_connection = 1;
+							break;
+						}
+						if (!sent) {
+							/* The file shrank under us; give up on the session
+							 * rather than sending a short body as complete. */
+							ast_log(LOG_WARNING, "File shrank while sending; closing session\n");
+							close_connection = 1;
+							break;
+						}
+					}
+				}
+				copied = 1;
+			}
+#endif
+			if (!copied) {
+				char buf[8192];
+				int len;
+
+				while ((len = read(fd, buf, sizeof(buf))) > 0) {
+					if (fwrite(buf, len, 1, ser->f) != 1) {
+						ast_log(LOG_WARNING, "fwrite() failed: %s\n", strerror(errno));
+						close_connection = 1;
+						break;
+					}
 				}
 			}
 		}
 	}
 
-	ast_free(http_header);
-	ast_free(out);
-	ast_free(server_header_field);
+#ifdef TCP_CORK
+	if (corked) {
+		int off = 0;
+
+		/* Move anything still in the stdio buffer into the kernel,
+		 * then release the cork so the response leaves immediately. */
+		fflush(ser->f);
+		setsockopt(ser->fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+	}
+#endif
+
+	ast_str_pool_put(http_header);
+	ast_str_pool_put(out);
+	ast_str_pool_put(server_header_field);
 
 	if (close_connection) {
 		ast_debug(1, "HTTP closing session.  status_code:%d\n", status_code);
@@ -560,13 +632,13 @@ void ast_http_create_response(struct ast_tcptls_session_instance *ser, int statu
 	const char *status_title, struct ast_str *http_header_data, const char *text)
 {
 	char server_name[MAX_SERVER_NAME_LENGTH];
-	struct ast_str *server_address = ast_str_create(MAX_SERVER_NAME_LENGTH);
-	struct ast_str *out = ast_str_create(MAX_CONTENT_LENGTH);
+	struct ast_str *server_address = ast_str_pool_get(MAX_SERVER_NAME_LENGTH);
+	struct ast_str *out = ast_str_pool_get(MAX_CONTENT_LENGTH);
 
 	if (!http_header_data || !server_address || !out) {
-		ast_free(http_header_data);
-		ast_free(server_address);
-		ast_free(out);
+		ast_str_pool_put(http_header_data);
+		ast_str_pool_put(server_address);
+		ast_str_pool_put(out);
 		if (ser && ser->f) {
 			ast_debug(1, "HTTP closing session. OOM.\n");
 			ast_tcptls_close_session_file(ser);
@@ -599,7 +671,7 @@ void ast_http_create_response(struct ast_tcptls_session_instance *ser, int statu
 	            text ? text : "",
 	            ast_str_buffer(server_address));
 
-	ast_free(server_address);
+	ast_str_pool_put(server_address);
 
 	ast_http_send(ser,
 	              AST_HTTP_UNKNOWN,
@@ -617,7 +689,7 @@ void ast_http_auth(struct ast_tcptls_session_instance *ser, const char *realm,
 {
 	int status_code = 401;
 	char *status_title = "Unauthorized";
-	struct ast_str *http_header_data = ast_str_create(DEFAULT_RESPONSE_HEADER_LENGTH);
+	struct ast_str *http_header_data = ast_str_pool_get(DEFAULT_RESPONSE_HEADER_LENGTH);
 
 	if (http_header_data) {
 		ast_str_set(&http_header_data,
@@ -640,7 +712,7 @@ void ast_http_auth(struct ast_tcptls_session_instance *ser, const char *realm,
 void ast_http_error(struct ast_tcptls_session_instance *ser, int status_code,
 	const char *status_title, const char *text)
 {
-	struct ast_str *http_header_data = ast_str_create(DEFAULT_RESPONSE_HEADER_LENGTH);
+	struct ast_str *http_header_data = ast_str_pool_get(DEFAULT_RESPONSE_HEADER_LENGTH);
 
 	if (http_header_data) {
 		ast_str_set(&http_header_data, 0, "Content-type: text/html\r\n");
@@ -653,6 +725,180 @@ void ast_http_error(struct ast_tcptls_session_instance *ser, int status_code,
 	                         text);
 }
 
+/*!
+ * \brief Path-segment trie over the registered URI handlers.
+ *
+ * Handler URIs are split on '/' and inserted into a trie so a request is
+ * matched with a single descent over its path segments instead of a prefix
+ * comparison against every registered handler.  The deepest visited node
+ * holding a handler that either consumed the whole request or allows a
+ * subtree wins, which preserves the longest-prefix-first semantics of the
+ * sorted handler list.  Within a node, more recent registrations of the
+ * same path hide older ones, as in the list.  The trie is protected by the
+ * same lock as the handler list, which is kept for iteration and cleanup.
+ */
+struct http_uri_trie_handler {
+	struct ast_http_uri *urih;
+	struct http_uri_trie_handler *next;
+};
+
+struct http_uri_trie_node {
+	struct http_uri_trie_node *sibling;
+	struct http_uri_trie_node *child;
+	struct http_uri_trie_handler *handlers;
+	char segment[0];
+};
+
+static struct http_uri_trie_node *uri_trie_root;
+
+static struct http_uri_trie_node *uri_trie_node_alloc(const char *segment, size_t len)
+{
+	struct http_uri_trie_node *node = ast_calloc(1, sizeof(*node) + len + 1);
+
+	if (!node) {
+		return NULL;
+	}
+	memcpy(node->segment, segment, len);
+	return node;
+}
+
+/*! \brief Insert a handler into the trie.  Called with the uris list write locked. */
+static int uri_trie_insert(struct ast_http_uri *urih)
+{
+	struct http_uri_trie_node *node;
+	struct http_uri_trie_handler *handler;
+	const char *p = urih->uri;
+
+	if (!uri_trie_root && !(uri_trie_root = uri_trie_node_alloc("", 0))) {
+		return -1;
+	}
+	node = uri_trie_root;
+
+	while (*p) {
+		const char *next = strchr(p, '/');
+		size_t len = next ? (size_t) (next - p) : strlen(p);
+		struct http_uri_trie_node *child;
+
+		for (child = node->child; child; child = child->sibling) {
+			if (!strncasecmp(child->segment, p, len) && !child->segment[len]) {
+				break;
+			}
+		}
+		if (!child) {
+			child = uri_trie_node_alloc(p, len);
+			if (!child) {
+				return -1;
+			}
+			child->sibling = node->child;
+			node->child = child;
+		}
+		node = child;
+		p = next ? next + 1 : p + len;
+	}
+
+	handler = ast_calloc(1, sizeof(*handler));
+	if (!handler) {
+		return -1;
+	}
+	handler->urih = urih;
+	handler->next = node->handlers;
+	node->handlers = handler;
+	return 0;
+}
+
+/*!
+ * \brief Remove a handler from the trie, pruning nodes left empty.
+ *
+ * Called with the uris list write locked.
+ *
+ * \retval non-zero if \a node itself became empty and can be freed by the caller.
+ */
+static int uri_trie_remove(struct http_uri_trie_node *node, const char *p,
+	struct ast_http_uri *urih)
+{
+	if (*p) {
+		const char *next = strchr(p, '/');
+		size_t len = next ? (size_t) (next - p) : strlen(p);
+		struct http_uri_trie_node **child_prev;
+
+		for (child_prev = &node->child; *child_prev; child_prev = &(*child_prev)->sibling) {
+			if (!strncasecmp((*child_prev)->segment, p, len) && !(*child_prev)->segment[len]) {
+				break;
+			}
+		}
+		if (*child_prev) {
+			struct http_uri_trie_node *child = *child_prev;
+
+			if (uri_trie_remove(child, next ? next + 1 : p + len, urih)) {
+				*child_prev = child->sibling;
+				ast_free(child);
+			}
+		}
+	} else {
+		struct http_uri_trie_handler **handler_prev;
+
+		for (handler_prev = &node->handlers; *handler_prev; handler_prev = &(*handler_prev)->next) {
+			if ((*handler_prev)->urih == urih) {
+				struct http_uri_trie_handler *handler = *handler_prev;
+
+				*handler_prev = handler->next;
+				ast_free(handler);
+				break;
+			}
+		}
+	}
+	return !node->handlers && !node->child;
+}
+
+static void uri_trie_unlink(struct ast_http_uri *urih)
+{
+	if (uri_trie_root && uri_trie_remove(uri_trie_root, urih->uri, urih)) {
+		ast_free(uri_trie_root);
+		uri_trie_root = NULL;
+	}
+}
+
+/*!
+ * \brief Match a request against the trie with one descent.
+ *
+ * Called with the uris list read locked.  On a match, \a remainder is set
+ * to the part of \a uri following the matched handler prefix (with the
+ * separating '/' consumed), which is what the handler callback expects.
+ */
+static struct ast_http_uri *uri_trie_match(char *uri, char **remainder)
+{
+	struct http_uri_trie_node *node = uri_trie_root;
+	struct ast_http_uri *best = NULL;
+	char *p = uri;
+
+	while (node && *p) {
+		char *next = strchr(p, '/');
+		size_t len = next ? (size_t) (next - p) : strlen(p);
+		struct http_uri_trie_node *child;
+		struct http_uri_trie_handler *handler;
+
+		for (child = node->child; child; child = child->sibling) {
+			if (!strncasecmp(child->segment, p, len) && !child->segment[len]) {
+				break;
+			}
+		}
+		if (!child) {
+			break;
+		}
+		node = child;
+		p = next ? next + 1 : p + len;
+		for (handler = node->handlers; handler; handler = handler->next) {
+			if (!*p || handler->urih->has_subtree) {
+				best = handler->urih;
+				*remainder = p;
+				break;
+			}
+		}
+	}
+
+	return best;
+}
+
 /*!
  * \brief Link the new uri into the list.
  *
@@ -660,7 +906,8 @@ void ast_http_error(struct ast_tcptls_session_instance *ser, int status_code,
  * the string, not alphabetically. Duplicate entries are not replaced,
  * but the insertion order (using <= and not just <) makes sure that
  * more recent insertions hide older ones.
- * On a lookup, we just scan the list and stop at the first matching entry.
+ * Request matching goes through the trie above; the sorted list is kept
+ * for iteration and bulk cleanup.
  */
 int ast_http_uri_link(struct ast_http_uri *urih)
 {
@@ -671,6 +918,11 @@ int ast_http_uri_link(struct ast_http_uri *urih)
 
 	urih->prefix = prefix;
 
+	if (uri_trie_insert(urih)) {
+		AST_RWLIST_UNLOCK(&uris);
+		return -1;
+	}
+
 	if ( AST_RWLIST_EMPTY(&uris) || strlen(AST_RWLIST_FIRST(&uris)->uri) <= len ) {
 		AST_RWLIST_INSERT_HEAD(&uris, urih, entry);
 		AST_RWLIST_UNLOCK(&uris);
@@ -697,6 +949,7 @@ int ast_http_uri_link(struct ast_http_uri *urih)
 void ast_http_uri_unlink(struct ast_http_uri *urih)
 {
 	AST_RWLIST_WRLOCK(&uris);
+	uri_trie_unlink(urih);
 	AST_RWLIST_REMOVE(&uris, urih, entry);
 	AST_RWLIST_UNLOCK(&uris);
 }
@@ -708,6 +961,7 @@ void ast_http_uri_unlink_all_with_key(const char *key)
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&uris, urih, entry) {
 		if (!strcmp(urih->key, key)) {
 			AST_RWLIST_REMOVE_CURRENT(entry);
+			uri_trie_unlink(urih);
 			if (urih->dmallocd) {
 				ast_free(urih->data);
 			}
@@ -1394,7 +1648,6 @@ struct ast_variable *ast_http_get_post_vars(
 static int handle_uri(struct ast_tcptls_session_instance *ser, char *uri,
 	enum ast_http_method method, struct ast_variable *headers)
 {
-	char *c;
 	int res = 0;
 	char *params = uri;
 	struct ast_http_uri *urih = NULL;
@@ -1431,7 +1684,7 @@ static int handle_uri(struct ast_tcptls_session_instance *ser, char *uri,
 	AST_RWLIST_RDLOCK(&uri_redirects);
 	AST_RWLIST_TRAVERSE(&uri_redirects, redirect, entry) {
 		if (!strcasecmp(uri, redirect->target)) {
-			struct ast_str *http_header = ast_str_create(128);
+			struct ast_str *http_header = ast_str_pool_get(128);
 
 			if (!http_header) {
 				ast_http_request_close_on_completion(ser);
@@ -1452,24 +1705,9 @@ static int handle_uri(struct ast_tcptls_session_instance *ser, char *uri,
 	l = strlen(prefix);
 	if (!strncasecmp(uri, prefix, l) && uri[l] == '/') {
 		uri += l + 1;
-		/* scan registered uris to see if we match one. */
+		/* match the request against the registered uri trie. */
 		AST_RWLIST_RDLOCK(&uris);
-		AST_RWLIST_TRAVERSE(&uris, urih, entry) {
-			l = strlen(urih->uri);
-			c = uri + l;	/* candidate */
-			ast_debug(2, "match request [%s] with handler [%s] len %d\n", uri, urih->uri, l);
-			if (strncasecmp(urih->uri, uri, l) /* no match */
-			    || (*c && *c != '/')) { /* substring */
-				continue;
-			}
-			if (*c == '/') {
-				c++;
-			}
-			if (!*c || urih->has_subtree) {
-				uri = c;
-				break;
-			}
-		}
+		urih = uri_trie_match(uri, &uri);
 		AST_RWLIST_UNLOCK(&uris);
 	}
 	if (urih) {
@@ -95,8 +95,167 @@ struct playtones_item {
 	int init_v3_2;
 	int modulate;
 	int duration;
+	/*! \brief shared rendered samples for this tone, or NULL to synthesize in-line */
+	struct tone_pcm *pcm;
 };
 
+/*! \brief One shared rendered cycle of a distinct tone definition.
+ *
+ * Tone frequencies are whole numbers of Hz, so a whole number of cycles
+ * of any tone fits in one second of samples and a table holding them
+ * can be replayed endlessly. Every channel playing the same tone at the
+ * same volume shares one table instead of running its own resonator.
+ */
+struct tone_pcm {
+	/*! \brief first frequency of the tone */
+	int freq1;
+	/*! \brief second frequency of the tone */
+	int freq2;
+	/*! \brief non-zero if freq2 modulates freq1 */
+	int modulate;
+	/*! \brief volume the samples were rendered at */
+	int vol;
+	/*! \brief number of samples in the table, a whole number of tone cycles */
+	int len;
+	/*! \brief rendered signed linear samples */
+	short samples[0];
+};
+
+/*! \brief number of buckets for the rendered tone table cache */
+#define TONE_PCM_BUCKETS 53
+
+/*! \brief render at least this many samples so short cycles are not copied a few samples at a time */
+#define TONE_PCM_MIN_LEN 160
+
+/*! \brief rendered tone tables, shared by all channels playing the same tone */
+static struct ao2_container *tone_pcm_cache;
+
+static int tone_pcm_hash(const void *obj, const int flags)
+{
+	const struct tone_pcm *pcm = obj;
+
+	return pcm->freq1 + pcm->freq2;
+}
+
+static int tone_pcm_cmp(void *obj, void *arg, int flags)
+{
+	struct tone_pcm *pcm = obj;
+	struct tone_pcm *other = arg;
+
+	return (pcm->freq1 == other->freq1 && pcm->freq2 == other->freq2
+		&& pcm->modulate == other->modulate && pcm->vol == other->vol)
+		? CMP_MATCH | CMP_STOP : 0;
+}
+
+static unsigned int tone_gcd(unsigned int a, unsigned int b)
+{
+	while (b) {
+		unsigned int t = a % b;
+
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*! \brief Get the shared rendered table for a tone, rendering it on first use.
+ * \param freq1 first frequency of the tone, in Hz
+ * \param freq2 second frequency of the tone, in Hz
+ * \param vol volume the tone is played at
+ * \param pi tone parameters the table is rendered from
+ * \return a reffed tone table, or NULL if the tone must be synthesized in-line
+ */
+static struct tone_pcm *tone_pcm_get(unsigned int freq1, unsigned int freq2, int vol, const struct playtones_item *pi)
+{
+	struct tone_pcm search = {
+		.freq1 = freq1,
+		.freq2 = freq2,
+		.modulate = pi->modulate,
+		.vol = vol,
+	};
+	struct tone_pcm *pcm;
+	int v1_1, v2_1, v3_1;
+	int v1_2, v2_2, v3_2;
+	int len;
+	int x;
+
+	if (!tone_pcm_cache) {
+		return NULL;
+	}
+
+	ao2_lock(tone_pcm_cache);
+	if ((pcm = ao2_find(tone_pcm_cache, &search, OBJ_POINTER | OBJ_NOLOCK))) {
+		ao2_unlock(tone_pcm_cache);
+		return pcm;
+	}
+
+	/* one second always holds a whole number of cycles; shrink that to
+	 * the smallest whole number of cycles, then render at least a
+	 * frame's worth */
+	len = 8000 / tone_gcd(tone_gcd(freq1, freq2), 8000);
+	len *= (TONE_PCM_MIN_LEN + len - 1) / len;
+
+	if (!(pcm = ao2_alloc(sizeof(*pcm) + len * sizeof(pcm->samples[0]), NULL))) {
+		ao2_unlock(tone_pcm_cache);
+		return NULL;
+	}
+	pcm->freq1 = freq1;
+	pcm->freq2 = freq2;
+	pcm->modulate = pi->modulate;
+	pcm->vol = vol;
+	pcm->len = len;
+
+	/* run the same resonator the in-line generator loop uses, so the
+	 * table holds exactly what would have been synthesized */
+	v1_1 = 0;
+	v2_1 = pi->init_v2_1;
+	v3_1 = pi->init_v3_1;
+	v1_2 = 0;
+	v2_2 = pi->init_v2_2;
+	v3_2 = pi->init_v3_2;
+
+	for (x = 0; x < len; x++) {
+		v1_1 = v2_1;
+		v2_1 = v3_1;
+		v3_1 = (pi->fac1 * v2_1 >> 15) - v1_1;
+
+		v1_2 = v2_2;
+		v2_2 = v3_2;
+		v3_2 = (pi->fac2 * v2_2 >> 15) - v1_2;
+		if (pi->modulate) {
+			int p;
+			p = v3_2 - 32768;
+			if (p < 0) {
+				p = -p;
+			}
+			p = ((p * 9) / 10) + 1;
+			pcm->samples[x] = (v3_1 * p) >> 15;
+		} else {
+			pcm->samples[x] = v3_1 + v3_2;
+		}
+	}
+
+	ao2_link_flags(tone_pcm_cache, pcm, OBJ_NOLOCK);
+	ao2_unlock(tone_pcm_cache);
+
+	return pcm;
+}
+
+/*! \brief Free a tone item list along with the tone table refs it holds. */
+static void playtones_items_free(struct playtones_item *items, int nitems)
+{
+	int x;
+
+	if (!items) {
+		return;
+	}
+
+	for (x = 0; x < nitems; x++) {
+		ao2_cleanup(items[x].pcm);
+	}
+	ast_free(items);
+}
+
 struct playtones_def {
 	int vol;
 	int reppos;
@@ -119,6 +278,8 @@ struct playtones_state {
 	int npos;
 	int oldnpos;
 	int pos;
+	/*! \brief read position in the current item's shared tone table */
+	int tpos;
 	struct ast_format *origwfmt;
 	struct ast_frame f;
 	unsigned char offset[AST_FRIENDLY_OFFSET];
@@ -134,7 +295,7 @@ static void playtones_release(struct ast_channel *chan, void *params)
 	}
 
 	ao2_cleanup(ps->origwfmt);
-	ast_free(ps->items);
+	playtones_items_free(ps->items, ps->nitems);
 
 	ast_free(ps);
 }
@@ -199,27 +360,47 @@ static int playtones_generator(struct ast_channel *chan, void *data, int len, in
 		ps->v1_2 = 0;
 		ps->v2_2 = pi->init_v2_2;
 		ps->v3_2 = pi->init_v3_2;
+		ps->tpos = 0;
 		ps->oldnpos = ps->npos;
 	}
 
-	for (x = 0; x < samples; x++) {
-		ps->v1_1 = ps->v2_1;
-		ps->v2_1 = ps->v3_1;
-		ps->v3_1 = (pi->fac1 * ps->v2_1 >> 15) - ps->v1_1;
+	if (pi->pcm) {
+		/* the tone was rendered once up front; copy out of the shared
+		 * table instead of synthesizing the samples again */
+		x = 0;
+		while (x < samples) {
+			int chunk = samples - x;
 
-		ps->v1_2 = ps->v2_2;
-		ps->v2_2 = ps->v3_2;
-		ps->v3_2 = (pi->fac2 * ps->v2_2 >> 15) - ps->v1_2;
-		if (pi->modulate) {
-			int p;
-			p = ps->v3_2 - 32768;
-			if (p < 0) {
-				p = -p;
+			if (chunk > pi->pcm->len - ps->tpos) {
+				chunk = pi->pcm->len - ps->tpos;
+			}
+			memcpy(&ps->data[x], &pi->pcm->samples[ps->tpos], chunk * sizeof(ps->data[0]));
+			x += chunk;
+			ps->tpos += chunk;
+			if (ps->tpos == pi->pcm->len) {
+				ps->tpos = 0;
+			}
+		}
+	} else {
+		for (x = 0; x < samples; x++) {
+			ps->v1_1 = ps->v2_1;
+			ps->v2_1 = ps->v3_1;
+			ps->v3_1 = (pi->fac1 * ps->v2_1 >> 15) - ps->v1_1;
+
+			ps->v1_2 = ps->v2_2;
+			ps->v2_2 = ps->v3_2;
+			ps->v3_2 = (pi->fac2 * ps->v2_2 >> 15) - ps->v1_2;
+			if (pi->modulate) {
+				int p;
+				p = ps->v3_2 - 32768;
+				if (p < 0) {
+					p = -p;
+				}
+				p = ((p * 9) / 10) + 1;
+				ps->data[x] = (ps->v3_1 * p) >> 15;
+			} else {
+				ps->data[x] = ps->v3_1 + ps->v3_2;
 			}
-			p = ((p * 9) / 10) + 1;
-			ps->data[x] = (ps->v3_1 * p) >> 15;
-		} else {
-			ps->data[x] = ps->v3_1 + ps->v3_2;
 		}
 	}
 
@@ -372,7 +553,7 @@ int ast_playtones_start(struct ast_channel *chan, int vol, const char *playlst,
 
 		new_items = ast_realloc(d.items, (d.nitems + 1) * sizeof(*d.items));
 		if (!new_items) {
-			ast_free(d.items);
+			playtones_items_free(d.items, d.nitems);
 			return -1;
 		}
 		d.items = new_items;
@@ -388,6 +569,10 @@ int ast_playtones_start(struct ast_channel *chan, int vol, const char *playlst,
 		d.items[d.nitems].duration = tone_data.time;
 		d.items[d.nitems].modulate = tone_data.modulate;
 
+		/* share one rendered table with every channel playing this tone */
+		d.items[d.nitems].pcm = tone_pcm_get(tone_data.freq1, tone_data.freq2,
+			d.vol, &d.items[d.nitems]);
+
 		d.nitems++;
 	}
 
@@ -397,7 +582,7 @@ int ast_playtones_start(struct ast_channel *chan, int vol, const char *playlst,
 	}
 
 	if (ast_activate_generator(chan, &playtones, &d)) {
-		ast_free(d.items);
+		playtones_items_free(d.items, d.nitems);
 		return -1;
 	}
 
@@ -1166,6 +1351,10 @@ static void indications_shutdown(void)
 		ao2_ref(ast_tone_zones, -1);
 		ast_tone_zones = NULL;
 	}
+	if (tone_pcm_cache) {
+		ao2_ref(tone_pcm_cache, -1);
+		tone_pcm_cache = NULL;
+	}
 }
 
 /*! \brief Load indications module */
@@ -1176,6 +1365,12 @@ int ast_indications_init(void)
 		return -1;
 	}
 
+	if (!(tone_pcm_cache = ao2_container_alloc(TONE_PCM_BUCKETS,
+			tone_pcm_hash, tone_pcm_cmp))) {
+		indications_shutdown();
+		return -1;
+	}
+
 	if (load_indications(0)) {
 		indications_shutdown();
 		return -1;
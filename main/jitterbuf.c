@@ -551,6 +551,7 @@ static enum jb_return_code _jb_get(jitterbuf *jb, jb_frame *frameout, long now,
 {
 	jb_frame *frame;
 	long diff;
+	long shrink_delay;
 	static int dbg_cnt = 0;
 
 	/* get jitter info */
@@ -643,12 +644,16 @@ static enum jb_return_code _jb_get(jitterbuf *jb, jb_frame *frameout, long now,
 		}
 
 		/* we want to shrink; shrink at 1 frame / 500ms */
+		/* if we are over target by more than twice target_extra, shrink at an
+		 * accelerated 1 frame / JB_ADJUST_ACCEL_DELAY ms, so the delay a jitter
+		 * spike left behind is released quickly once the spike has passed */
 		/* unless we don't have a frame, then shrink 1 frame */
 		/* every 80ms (though perhaps we can shrink even faster */
 		/* in this case) */
+		shrink_delay = (diff < -2 * jb->info.conf.target_extra) ? JB_ADJUST_ACCEL_DELAY : 500;
 		if (diff < -jb->info.conf.target_extra &&
 			((!frame && jb->info.last_adjustment + 80 < now) ||
-			(jb->info.last_adjustment + 500 < now))) {
+			(jb->info.last_adjustment + shrink_delay < now))) {
 
 			jb->info.last_adjustment = now;
 			jb->info.cnt_contig_interp = 0;
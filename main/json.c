@@ -709,6 +709,18 @@ int ast_json_dump_str_format(struct ast_json *root, struct ast_str **dst, enum a
 	return json_dump_callback((json_t *)root, write_to_ast_str, dst, dump_flags(format));
 }
 
+int ast_json_dump_callback_format(struct ast_json *root, ast_json_dump_chunk_cb callback, void *data, enum ast_json_encoding_format format)
+{
+	/* Jansson's json_dump*, even though it's a read operation, isn't
+	 * thread safe for concurrent reads. Locking is necessary.
+	 * See http://www.digip.org/jansson/doc/2.4/portability.html#thread-safety. */
+	SCOPED_JSON_LOCK(root);
+	if (!root || !callback) {
+		return -1;
+	}
+	return json_dump_callback((json_t *)root, callback, data, dump_flags(format));
+}
+
 
 int ast_json_dump_file_format(struct ast_json *root, FILE *output, enum ast_json_encoding_format format)
 {
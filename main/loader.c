@@ -36,6 +36,7 @@
 #include "asterisk/_private.h"
 #include "asterisk/paths.h"	/* use ast_config_AST_MODULE_DIR */
 #include <dirent.h>
+#include <fcntl.h>
 
 #include "asterisk/dlinkedlists.h"
 #include "asterisk/module.h"
@@ -172,6 +173,25 @@ static int do_full_reload = 0;
 
 static AST_DLLIST_HEAD_STATIC(reload_queue, reload_queue_item);
 
+/*!
+ * \brief A resource declared by a module that has not been loaded yet.
+ *
+ * Populated from the lazy-* sections of AST_MODULE_CONFIG so a lookup of
+ * an application, function, or channel technology that is not registered
+ * can load the module declared to provide it.
+ */
+struct lazy_module {
+	AST_LIST_ENTRY(lazy_module) entry;
+	/*! Kind of resource provided ("application", "function", "channel") */
+	const char *type;
+	/*! Module providing the resource.  Points into name[] storage. */
+	char *module;
+	/*! Name of the provided resource */
+	char name[0];
+};
+
+static AST_LIST_HEAD_STATIC(lazy_modules, lazy_module);
+
 /* when dynamic modules are being loaded, ast_module_register() will
    need to know what filename the module was loaded from while it
    is being registered
@@ -578,6 +598,16 @@ static struct ast_module *load_dynamic_module(const char *resource_in, unsigned
 		return MODULE_LOCAL_ONLY;
 	}
 
+	if (wants_global) {
+		/* we opened the module with RTLD_LAZY | RTLD_GLOBAL above, which is
+		   exactly how a global-symbol module needs to stay resident, so there
+		   is no point in closing it and paying for a second dlopen(); just
+		   adopt the handle we already have */
+		mod->lib = lib;
+		resource_being_loaded = NULL;
+		return mod;
+	}
+
 	logged_dlclose(resource_in, lib);
 	resource_being_loaded = NULL;
 
@@ -589,7 +619,7 @@ static struct ast_module *load_dynamic_module(const char *resource_in, unsigned
 	if (missing_so)
 		strcat(resource_being_loaded->resource, ".so");
 
-	if (!(lib = dlopen(fn, wants_global ? RTLD_LAZY | RTLD_GLOBAL : RTLD_NOW | RTLD_LOCAL))) {
+	if (!(lib = dlopen(fn, RTLD_NOW | RTLD_LOCAL))) {
 		ast_log(LOG_WARNING, "Error loading module '%s': %s\n", resource_in, dlerror());
 		ast_free(resource_being_loaded);
 		return NULL;
@@ -610,8 +640,15 @@ static struct ast_module *load_dynamic_module(const char *resource_in, unsigned
 int modules_shutdown(void)
 {
 	struct ast_module *mod;
+	struct lazy_module *lazy;
 	int somethingchanged = 1, final = 0;
 
+	AST_LIST_LOCK(&lazy_modules);
+	while ((lazy = AST_LIST_REMOVE_HEAD(&lazy_modules, entry))) {
+		ast_free(lazy);
+	}
+	AST_LIST_UNLOCK(&lazy_modules);
+
 	AST_DLLIST_LOCK(&module_list);
 
 	/*!\note Some resources, like timers, are started up dynamically, and thus
@@ -1127,6 +1164,44 @@ int ast_load_resource(const char *resource_name)
 	return res;
 }
 
+int ast_module_load_for(const char *type, const char *name)
+{
+	struct lazy_module *lazy;
+	char *module = NULL;
+
+	if (AST_LIST_EMPTY(&lazy_modules)) {
+		return -1;
+	}
+
+	AST_LIST_LOCK(&lazy_modules);
+	AST_LIST_TRAVERSE(&lazy_modules, lazy, entry) {
+		if (!strcasecmp(lazy->type, type) && !strcasecmp(lazy->name, name)) {
+			module = ast_strdupa(lazy->module);
+			break;
+		}
+	}
+	if (module) {
+		/* Remove every resource the module declared so it gets exactly
+		 * one load attempt, whether or not that attempt succeeds. */
+		AST_LIST_TRAVERSE_SAFE_BEGIN(&lazy_modules, lazy, entry) {
+			if (!resource_name_match(lazy->module, module)) {
+				AST_LIST_REMOVE_CURRENT(entry);
+				ast_free(lazy);
+			}
+		}
+		AST_LIST_TRAVERSE_SAFE_END;
+	}
+	AST_LIST_UNLOCK(&lazy_modules);
+
+	if (!module) {
+		return -1;
+	}
+
+	ast_verb(1, "Loading %s on demand for %s '%s'\n", module, type, name);
+
+	return ast_load_resource(module) ? -1 : 0;
+}
+
 struct load_order_entry {
 	char *resource;
 	int required;
@@ -1158,6 +1233,114 @@ static struct load_order_entry *add_to_load_order(const char *resource, struct l
 	return order;
 }
 
+#ifdef LOADABLE_MODULES
+
+/*! \brief Number of threads used to pull module files into the page cache. */
+#define PREFETCH_THREADS 4
+
+struct module_prefetch {
+	/*! Next index in \c files to be claimed by a worker. */
+	int next;
+	/*! Workers still running; the last one out frees the structure. */
+	int remaining;
+	/*! Number of entries in \c files. */
+	int count;
+	/*! Full paths of the module files to warm up. */
+	char *files[0];
+};
+
+static void prefetch_destroy(struct module_prefetch *prefetch)
+{
+	int idx;
+
+	for (idx = 0; idx < prefetch->count; idx++) {
+		ast_free(prefetch->files[idx]);
+	}
+	ast_free(prefetch);
+}
+
+static void *prefetch_thread(void *data)
+{
+	struct module_prefetch *prefetch = data;
+	char buf[65536];
+	int idx;
+
+	while ((idx = ast_atomic_fetchadd_int(&prefetch->next, +1)) < prefetch->count) {
+		int fd = open(prefetch->files[idx], O_RDONLY);
+
+		if (fd < 0) {
+			continue;
+		}
+		/* We only care about the side effect of the file's pages becoming
+		   resident, so the data itself is thrown away. */
+		while (read(fd, buf, sizeof(buf)) > 0) {
+		}
+		close(fd);
+	}
+
+	if (ast_atomic_fetchadd_int(&prefetch->remaining, -1) == 1) {
+		prefetch_destroy(prefetch);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Start reading the files in the load order into the page cache.
+ *
+ * The loader itself is serialized by the module registration handshake
+ * (see ast_module_register()), so each dlopen() normally stalls on disk
+ * for its module in turn. Warming the cache from a few background
+ * threads overlaps that I/O with the sequential load; the workers clean
+ * up after themselves, so there is no need to wait for them.
+ */
+static void prefetch_module_files(struct load_order *load_order)
+{
+	struct module_prefetch *prefetch;
+	struct load_order_entry *order;
+	pthread_t thread;
+	int count = 0, threads, i;
+
+	AST_LIST_TRAVERSE(load_order, order, entry) {
+		count++;
+	}
+
+	if (!count || !(prefetch = ast_calloc(1, sizeof(*prefetch) + count * sizeof(char *)))) {
+		return;
+	}
+
+	AST_LIST_TRAVERSE(load_order, order, entry) {
+		if (ast_asprintf(&prefetch->files[prefetch->count], "%s/%s%s",
+			ast_config_AST_MODULE_DIR, order->resource,
+			strcasecmp(order->resource + strlen(order->resource) - 3, ".so") ? ".so" : "") < 0) {
+			continue;
+		}
+		prefetch->count++;
+	}
+
+	if (!prefetch->count) {
+		ast_free(prefetch);
+		return;
+	}
+
+	threads = MIN(PREFETCH_THREADS, prefetch->count);
+	prefetch->remaining = threads;
+
+	for (i = 0; i < threads; i++) {
+		if (ast_pthread_create_detached_background(&thread, NULL, prefetch_thread, prefetch)) {
+			/* Account for the worker that will never run; if none started at
+			   all, the cleanup falls to us. */
+			if (ast_atomic_fetchadd_int(&prefetch->remaining, -1) == 1) {
+				prefetch_destroy(prefetch);
+			}
+			break;
+		}
+	}
+}
+
+#endif
+
 static int mod_load_cmp(void *a, void *b)
 {
 	struct ast_module *a_mod = (struct ast_module *) a;
@@ -1426,6 +1609,50 @@ int load_modules(unsigned int preload_only)
 		AST_LIST_TRAVERSE_SAFE_END;
 	}
 
+	/* modules may be declared in the lazy-* sections along with the
+	   resources they provide; those modules are not loaded now, but on
+	   the first lookup of a resource they declared */
+	if (!preload_only) {
+		static const struct {
+			const char *section;
+			const char *type;
+		} lazy_sections[] = {
+			{ "lazy-applications", "application" },
+			{ "lazy-functions", "function" },
+			{ "lazy-channels", "channel" },
+		};
+		struct lazy_module *lazy;
+		int idx;
+
+		for (idx = 0; idx < ARRAY_LEN(lazy_sections); idx++) {
+			for (v = ast_variable_browse(cfg, lazy_sections[idx].section); v; v = v->next) {
+				int name_len = strlen(v->name) + 1;
+
+				lazy = ast_calloc(1, sizeof(*lazy) + name_len + strlen(v->value) + 1);
+				if (!lazy) {
+					continue;
+				}
+				lazy->type = lazy_sections[idx].type;
+				strcpy(lazy->name, v->name); /* safe */
+				lazy->module = lazy->name + name_len;
+				strcpy(lazy->module, v->value); /* safe */
+				AST_LIST_LOCK(&lazy_modules);
+				AST_LIST_INSERT_TAIL(&lazy_modules, lazy, entry);
+				AST_LIST_UNLOCK(&lazy_modules);
+
+				/* a lazily loaded module must not also load at startup */
+				AST_LIST_TRAVERSE_SAFE_BEGIN(&load_order, order, entry) {
+					if (!resource_name_match(order->resource, v->value)) {
+						AST_LIST_REMOVE_CURRENT(entry);
+						ast_free(order->resource);
+						ast_free(order);
+					}
+				}
+				AST_LIST_TRAVERSE_SAFE_END;
+			}
+		}
+	}
+
 	/* we are done with the config now, all the information we need is in the
 	   load_order list */
 	ast_config_destroy(cfg);
@@ -1437,6 +1664,13 @@ int load_modules(unsigned int preload_only)
 	if (load_count)
 		ast_log(LOG_NOTICE, "%u modules will be loaded.\n", load_count);
 
+#ifdef LOADABLE_MODULES
+	/* start pulling the module files into the page cache while the passes
+	   below load sequentially, so dlopen() finds the pages already resident
+	   instead of stalling on disk for each module in turn */
+	prefetch_module_files(&load_order);
+#endif
+
 	/* first, load only modules that provide global symbols */
 	if ((res = load_resource_list(&load_order, 1, &modulecount)) < 0) {
 		goto done;
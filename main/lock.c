@@ -36,8 +36,12 @@ static void __attribute__((constructor)) __mtx_init(void)
 }
 #endif
 
+#include <inttypes.h>
+
 #include "asterisk/utils.h"
 #include "asterisk/lock.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/strings.h"
 
 /* Allow direct use of pthread_mutex_* / pthread_cond_* */
 #undef pthread_mutex_init
@@ -129,6 +133,282 @@ static inline void delete_reentrancy_cs(struct ast_lock_track **plt)
 
 #endif /* DEBUG_THREADS */
 
+/*
+ * Sampled lock contention profiler
+ *
+ * Unlike DEBUG_THREADS tracking, this is cheap enough to leave on in
+ * production: the uncontended path only gains a pthread_mutex_trylock,
+ * and on the contended path one in every LOCK_PROF_SAMPLE_INTERVAL
+ * acquisitions per thread is timed with the monotonic clock and rolled
+ * up by acquiring call site into a small per-thread open addressed
+ * table.  Owner threads update their own tables without locking; the
+ * global lock below only guards the table list and the totals inherited
+ * from exited threads.  "core show lock contention" merges everything
+ * into one report.
+ */
+
+/*! \brief One of every this many contended acquisitions per thread is timed */
+#define LOCK_PROF_SAMPLE_INTERVAL 64
+
+/*! \brief Distinct acquiring call sites tracked per thread */
+#define LOCK_PROF_SLOTS 64
+
+struct lock_prof_entry {
+	/*! Lock name as stringified at the acquiring call site */
+	const char *name;
+	/*! Acquiring call site */
+	const char *file;
+	int lineno;
+	unsigned int samples;
+	uint64_t wait_total_ns;
+	uint64_t wait_max_ns;
+};
+
+struct lock_prof_buf {
+	AST_LIST_ENTRY(lock_prof_buf) entry;
+	/*! Contended acquisitions since the last sample was taken */
+	unsigned int contended;
+	/*! Samples discarded because all slots were occupied */
+	unsigned int dropped;
+	struct lock_prof_entry entries[LOCK_PROF_SLOTS];
+};
+
+/*! \brief Guards lock_prof_bufs and lock_prof_finished; intentionally not an ast_mutex_t */
+static pthread_mutex_t lock_prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static AST_LIST_HEAD_NOLOCK_STATIC(lock_prof_bufs, lock_prof_buf);
+/*! \brief Accumulated counters of threads that have exited */
+static struct lock_prof_buf lock_prof_finished;
+static pthread_key_t lock_prof_key;
+static pthread_once_t lock_prof_once = PTHREAD_ONCE_INIT;
+static int lock_prof_key_ok;
+
+/*! \brief Sentinel stored while a thread's buffer allocation is in flight */
+#define LOCK_PROF_BUF_PENDING ((struct lock_prof_buf *) 1)
+
+static struct lock_prof_entry *lock_prof_find_entry(struct lock_prof_buf *buf,
+	const char *name, const char *file, int lineno)
+{
+	unsigned int start = ((unsigned int) (uintptr_t) file + (unsigned int) lineno)
+		% LOCK_PROF_SLOTS;
+	unsigned int i;
+
+	for (i = 0; i < LOCK_PROF_SLOTS; i++) {
+		struct lock_prof_entry *entry = &buf->entries[(start + i) % LOCK_PROF_SLOTS];
+
+		if (!entry->file) {
+			entry->name = name;
+			entry->file = file;
+			entry->lineno = lineno;
+			return entry;
+		}
+		if (entry->file == file && entry->lineno == lineno) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void lock_prof_merge(struct lock_prof_buf *dst, const struct lock_prof_entry *src)
+{
+	struct lock_prof_entry *entry;
+
+	entry = lock_prof_find_entry(dst, src->name, src->file, src->lineno);
+	if (!entry) {
+		dst->dropped++;
+		return;
+	}
+	entry->samples += src->samples;
+	entry->wait_total_ns += src->wait_total_ns;
+	if (src->wait_max_ns > entry->wait_max_ns) {
+		entry->wait_max_ns = src->wait_max_ns;
+	}
+}
+
+static void lock_prof_buf_destroy(void *data)
+{
+	struct lock_prof_buf *buf = data;
+	unsigned int i;
+
+	if (buf == LOCK_PROF_BUF_PENDING) {
+		return;
+	}
+
+	pthread_mutex_lock(&lock_prof_lock);
+	AST_LIST_REMOVE(&lock_prof_bufs, buf, entry);
+	for (i = 0; i < LOCK_PROF_SLOTS; i++) {
+		if (buf->entries[i].file) {
+			lock_prof_merge(&lock_prof_finished, &buf->entries[i]);
+		}
+	}
+	lock_prof_finished.dropped += buf->dropped;
+	pthread_mutex_unlock(&lock_prof_lock);
+
+	ast_std_free(buf);
+}
+
+static void lock_prof_key_init(void)
+{
+	lock_prof_key_ok = !pthread_key_create(&lock_prof_key, lock_prof_buf_destroy);
+}
+
+static struct lock_prof_buf *lock_prof_buf_get(void)
+{
+	struct lock_prof_buf *buf;
+
+	if (pthread_once(&lock_prof_once, lock_prof_key_init) || !lock_prof_key_ok) {
+		return NULL;
+	}
+	buf = pthread_getspecific(lock_prof_key);
+	if (buf == LOCK_PROF_BUF_PENDING) {
+		return NULL;
+	}
+	if (buf) {
+		return buf;
+	}
+
+	/* The allocator may take contended locks of its own, so park a
+	 * sentinel before calling it to cut off the recursion. */
+	pthread_setspecific(lock_prof_key, LOCK_PROF_BUF_PENDING);
+	buf = ast_std_calloc(1, sizeof(*buf));
+	if (!buf) {
+		pthread_setspecific(lock_prof_key, NULL);
+		return NULL;
+	}
+	pthread_setspecific(lock_prof_key, buf);
+
+	pthread_mutex_lock(&lock_prof_lock);
+	AST_LIST_INSERT_TAIL(&lock_prof_bufs, buf, entry);
+	pthread_mutex_unlock(&lock_prof_lock);
+
+	return buf;
+}
+
+#if !defined(DETECT_DEADLOCKS) || !defined(DEBUG_THREADS)
+/*!
+ * \internal
+ * \brief Acquire a mutex that a trylock just found contended.
+ *
+ * Every LOCK_PROF_SAMPLE_INTERVAL'th contended acquisition per thread
+ * is timed and charged to the acquiring call site.
+ */
+static int lock_prof_contended_lock(pthread_mutex_t *mutex, const char *mutex_name,
+	const char *filename, int lineno)
+{
+	struct lock_prof_buf *buf = lock_prof_buf_get();
+	struct timespec begin;
+	struct timespec end;
+	uint64_t wait_ns;
+	int res;
+
+	if (!buf || ++buf->contended % LOCK_PROF_SAMPLE_INTERVAL) {
+		return pthread_mutex_lock(mutex);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	res = pthread_mutex_lock(mutex);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (!res) {
+		wait_ns = (uint64_t) (end.tv_sec - begin.tv_sec) * 1000000000
+			+ (uint64_t) end.tv_nsec - (uint64_t) begin.tv_nsec;
+		lock_prof_merge(buf, &(struct lock_prof_entry) {
+			.name = mutex_name,
+			.file = filename,
+			.lineno = lineno,
+			.samples = 1,
+			.wait_total_ns = wait_ns,
+			.wait_max_ns = wait_ns,
+		});
+	}
+	return res;
+}
+#endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
+
+static int lock_prof_entry_cmp(const void *a, const void *b)
+{
+	const struct lock_prof_entry *left = a;
+	const struct lock_prof_entry *right = b;
+
+	/* Sort by total wait, descending, with empty slots last. */
+	if (left->wait_total_ns < right->wait_total_ns) {
+		return 1;
+	}
+	if (left->wait_total_ns > right->wait_total_ns) {
+		return -1;
+	}
+	return 0;
+}
+
+struct ast_str *ast_lock_contention_report(void)
+{
+	struct lock_prof_buf *merged;
+	struct lock_prof_buf *buf;
+	struct ast_str *str;
+	unsigned int i;
+
+	merged = ast_std_calloc(1, sizeof(*merged));
+	if (!merged) {
+		return NULL;
+	}
+
+	/* Owner threads update their buffers without locking, so an entry
+	 * may be read here while it is being bumped.  A torn read skews at
+	 * most one line of a diagnostic report and is accepted. */
+	pthread_mutex_lock(&lock_prof_lock);
+	for (i = 0; i < LOCK_PROF_SLOTS; i++) {
+		if (lock_prof_finished.entries[i].file) {
+			lock_prof_merge(merged, &lock_prof_finished.entries[i]);
+		}
+	}
+	merged->dropped += lock_prof_finished.dropped;
+	AST_LIST_TRAVERSE(&lock_prof_bufs, buf, entry) {
+		for (i = 0; i < LOCK_PROF_SLOTS; i++) {
+			if (buf->entries[i].file) {
+				lock_prof_merge(merged, &buf->entries[i]);
+			}
+		}
+		merged->dropped += buf->dropped;
+	}
+	pthread_mutex_unlock(&lock_prof_lock);
+
+	str = ast_str_create(1024);
+	if (!str) {
+		ast_std_free(merged);
+		return NULL;
+	}
+
+	qsort(merged->entries, LOCK_PROF_SLOTS, sizeof(merged->entries[0]),
+		lock_prof_entry_cmp);
+
+	ast_str_append(&str, 0,
+		"Sampled lock contention: 1 of every %d contended acquisitions per thread\n"
+		"%-30s %-30s %8s %10s %10s\n",
+		LOCK_PROF_SAMPLE_INTERVAL,
+		"Lock", "Caller", "Samples", "Avg (us)", "Max (us)");
+	for (i = 0; i < LOCK_PROF_SLOTS; i++) {
+		struct lock_prof_entry *entry = &merged->entries[i];
+		const char *file;
+
+		if (!entry->samples) {
+			continue;
+		}
+		file = strrchr(entry->file, '/');
+		file = file ? file + 1 : entry->file;
+		ast_str_append(&str, 0, "%-30.30s %24.24s:%-5d %8u %10" PRIu64 " %10" PRIu64 "\n",
+			entry->name, file, entry->lineno, entry->samples,
+			entry->wait_total_ns / entry->samples / 1000,
+			entry->wait_max_ns / 1000);
+	}
+	if (merged->dropped) {
+		ast_str_append(&str, 0,
+			"%u samples were dropped because more than %d call sites contended.\n",
+			merged->dropped, LOCK_PROF_SLOTS);
+	}
+
+	ast_std_free(merged);
+
+	return str;
+}
+
 int __ast_pthread_mutex_init(int tracking, const char *filename, int lineno, const char *func,
 						const char *mutex_name, ast_mutex_t *t)
 {
@@ -317,9 +597,12 @@ int __ast_pthread_mutex_lock(const char *filename, int lineno, const char *func,
 	ast_mark(mtx_prof, 1);
 	res = pthread_mutex_trylock(&t->mutex);
 	ast_mark(mtx_prof, 0);
-	if (res)
+#else
+	res = pthread_mutex_trylock(&t->mutex);
 #endif
-	res = pthread_mutex_lock(&t->mutex);
+	if (res) {
+		res = lock_prof_contended_lock(&t->mutex, mutex_name, filename, lineno);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
 #ifdef DEBUG_THREADS
@@ -98,6 +98,7 @@ static struct {
 	unsigned int queue_log_to_file:1;
 	unsigned int queue_adaptive_realtime:1;
 	unsigned int queue_log_realtime_use_gmt:1;
+	unsigned int queue_log_fsync:1;
 } logfiles = { 1 };
 
 static char hostname[MAXHOSTNAMELEN];
@@ -151,6 +152,7 @@ static AST_RWLIST_HEAD_STATIC(logchannels, logchannel);
 enum logmsgtypes {
 	LOGMSG_NORMAL = 0,
 	LOGMSG_VERBOSE,
+	LOGMSG_QUEUELOG,
 };
 
 struct logmsg {
@@ -160,6 +162,9 @@ struct logmsg {
 	int line;
 	int lwp;
 	ast_callid callid;
+	/*! Time the message was generated; rendered into \c date off the
+	 *  caller's thread. */
+	struct timeval created;
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(date);
 		AST_STRING_FIELD(file);
@@ -181,6 +186,15 @@ static pthread_t logthread = AST_PTHREADT_NULL;
 static ast_cond_t logcond;
 static int close_logger_thread = 0;
 
+/*! \brief Maximum number of messages the logger thread may fall behind before
+ *         new messages are discarded instead of queued. */
+#define LOGMSGS_HIGH_WATER 10000
+
+/*! Number of messages currently queued for the logger thread (protected by \ref logmsgs lock) */
+static int logmsgs_queued;
+/*! Number of messages discarded since the logger thread last drained the queue (protected by \ref logmsgs lock) */
+static unsigned int logmsgs_dropped;
+
 static FILE *qlog;
 
 /*! \brief Logging channels used in the Asterisk logging system
@@ -698,6 +712,9 @@ static int init_logger_chain(const char *altconf)
 	if ((s = ast_variable_retrieve(cfg, "general", "queue_log_realtime_use_gmt"))) {
 		logfiles.queue_log_realtime_use_gmt = ast_true(s);
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "queue_log_fsync"))) {
+		logfiles.queue_log_fsync = ast_true(s);
+	}
 	if ((s = ast_variable_retrieve(cfg, "general", "exec_after_rotate"))) {
 		ast_copy_string(exec_after_rotate, s, sizeof(exec_after_rotate));
 	}
@@ -855,14 +872,48 @@ void ast_queue_log(const char *queuename, const char *callid, const char *agent,
 	}
 
 	if (qlog) {
+		struct logmsg *logmsg = NULL;
+
 		va_start(ap, fmt);
 		qlog_len = snprintf(qlog_msg, sizeof(qlog_msg), "%ld|%s|%s|%s|%s|", (long)time(NULL), callid, queuename, agent, event);
 		vsnprintf(qlog_msg + qlog_len, sizeof(qlog_msg) - qlog_len, fmt, ap);
 		va_end(ap);
+
+		/* Hand the entry to the logger thread so the disk write does not
+		 * happen in the call path; the thread flushes once per batch. */
+		if (logthread != AST_PTHREADT_NULL
+			&& (logmsg = ast_calloc_with_stringfields(1, struct logmsg, strlen(qlog_msg) + 1))) {
+			logmsg->type = LOGMSG_QUEUELOG;
+			ast_string_field_set(logmsg, message, qlog_msg);
+
+			AST_LIST_LOCK(&logmsgs);
+			if (close_logger_thread) {
+				/* Logger is shutting down; write the entry out ourselves below. */
+				logmsg_free(logmsg);
+				logmsg = NULL;
+			} else {
+				/* Queue log entries are accounting data, so unlike regular log
+				 * messages they are never discarded at the high water mark. */
+				if (AST_LIST_EMPTY(&logmsgs)) {
+					ast_cond_signal(&logcond);
+				}
+				AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
+				logmsgs_queued++;
+			}
+			AST_LIST_UNLOCK(&logmsgs);
+
+			if (logmsg) {
+				return;
+			}
+		}
+
 		AST_RWLIST_RDLOCK(&logchannels);
 		if (qlog) {
 			fprintf(qlog, "%s\n", qlog_msg);
 			fflush(qlog);
+			if (logfiles.queue_log_fsync) {
+				fsync(fileno(qlog));
+			}
 		}
 		AST_RWLIST_UNLOCK(&logchannels);
 	}
@@ -1483,11 +1534,65 @@ static struct sigaction handle_SIGXFSZ = {
 };
 
 /*! \brief Print a normal log message to the channels */
+/*! Whether queue log entries have been written since the last batch flush (logger thread only) */
+static int qlog_pending;
+
+/*!
+ * \internal
+ * \brief Write one deferred queue log entry.
+ *
+ * The stdio buffer is not flushed here; logger_print_queuelog_flush() pushes
+ * a whole drained batch to disk at once.
+ */
+static void logger_print_queuelog(struct logmsg *logmsg)
+{
+	AST_RWLIST_RDLOCK(&logchannels);
+	if (qlog) {
+		fprintf(qlog, "%s\n", logmsg->message);
+		qlog_pending = 1;
+	}
+	AST_RWLIST_UNLOCK(&logchannels);
+}
+
+/*!
+ * \internal
+ * \brief Push a drained batch of queue log entries to disk with a single flush.
+ */
+static void logger_print_queuelog_flush(void)
+{
+	if (!qlog_pending) {
+		return;
+	}
+	qlog_pending = 0;
+
+	AST_RWLIST_RDLOCK(&logchannels);
+	if (qlog) {
+		fflush(qlog);
+		if (logfiles.queue_log_fsync) {
+			fsync(fileno(qlog));
+		}
+	}
+	AST_RWLIST_UNLOCK(&logchannels);
+}
+
 static void logger_print_normal(struct logmsg *logmsg)
 {
 	struct logchannel *chan = NULL;
 	char buf[BUFSIZ];
 	int level = 0;
+	struct ast_tm tm;
+	char datestring[256];
+
+	if (logmsg->type == LOGMSG_QUEUELOG) {
+		logger_print_queuelog(logmsg);
+		return;
+	}
+
+	/* Render the deferred date/time; normally only the logger thread gets
+	 * this far, so the formatting cost is not borne by ast_log() callers. */
+	ast_localtime(&logmsg->created, &tm, NULL);
+	ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
+	ast_string_field_set(logmsg, date, datestring);
 
 	AST_RWLIST_RDLOCK(&logchannels);
 	if (!AST_RWLIST_EMPTY(&logchannels)) {
@@ -1589,6 +1694,7 @@ static void logger_print_normal(struct logmsg *logmsg)
 static void *logger_thread(void *data)
 {
 	struct logmsg *next = NULL, *msg = NULL;
+	unsigned int dropped;
 
 	for (;;) {
 		/* We lock the message list, and see if any message exists... if not we wait on the condition to be signalled */
@@ -1603,6 +1709,9 @@ static void *logger_thread(void *data)
 		}
 		next = AST_LIST_FIRST(&logmsgs);
 		AST_LIST_HEAD_INIT_NOLOCK(&logmsgs);
+		logmsgs_queued = 0;
+		dropped = logmsgs_dropped;
+		logmsgs_dropped = 0;
 		AST_LIST_UNLOCK(&logmsgs);
 
 		/* Otherwise go through and process each message in the order added */
@@ -1616,6 +1725,15 @@ static void *logger_thread(void *data)
 			/* Free the data since we are done */
 			logmsg_free(msg);
 		}
+
+		/* One flush (and fsync, if so configured) covers the whole batch */
+		logger_print_queuelog_flush();
+
+		/* The queue just drained, so there is room to report the overflow */
+		if (dropped) {
+			ast_log(LOG_WARNING, "Logger queue exceeded %d messages; %u message%s discarded\n",
+				LOGMSGS_HIGH_WATER, dropped, ESS(dropped));
+		}
 	}
 
 	return NULL;
@@ -1860,10 +1978,8 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 {
 	struct logmsg *logmsg = NULL;
 	struct ast_str *buf = NULL;
-	struct ast_tm tm;
 	struct timeval now = ast_tvnow();
 	int res = 0;
-	char datestring[256];
 
 	if (level == __LOG_VERBOSE && ast_opt_remote && ast_opt_exec) {
 		return;
@@ -1915,10 +2031,9 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 		logmsg->callid = callid;
 	}
 
-	/* Create our date/time */
-	ast_localtime(&now, &tm, NULL);
-	ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
-	ast_string_field_set(logmsg, date, datestring);
+	/* Stash the timestamp; rendering it into a string is deferred until the
+	 * message is printed so that callers do not pay for it. */
+	logmsg->created = now;
 
 	/* Copy over data */
 	logmsg->level = level;
@@ -1935,9 +2050,21 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 		if (close_logger_thread) {
 			/* Logger is either closing or closed.  We cannot log this message. */
 			logmsg_free(logmsg);
+		} else if (logmsgs_queued >= LOGMSGS_HIGH_WATER) {
+			/* The logger thread has fallen too far behind; discard the
+			 * message and have the logger thread report the tally once
+			 * it catches up. */
+			logmsgs_dropped++;
+			logmsg_free(logmsg);
 		} else {
+			if (AST_LIST_EMPTY(&logmsgs)) {
+				/* Only the transition from empty needs the signal; if
+				 * messages are already queued the logger thread is awake
+				 * or will recheck the list before waiting. */
+				ast_cond_signal(&logcond);
+			}
 			AST_LIST_INSERT_TAIL(&logmsgs, logmsg, list);
-			ast_cond_signal(&logcond);
+			logmsgs_queued++;
 		}
 		AST_LIST_UNLOCK(&logmsgs);
 	} else {
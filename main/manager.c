@@ -99,6 +99,8 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/translate.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/sched.h"
 
 /*** DOCUMENTATION
 	<manager name="Ping" language="en_US">
@@ -1448,6 +1450,8 @@ static int webmanager_enabled = 0;
 static int manager_debug = 0;	/*!< enable some debugging code in the manager */
 static int authtimeout;
 static int authlimit;
+static int originateratelimit;	/*!< max async originates dispatched per second, 0 is unlimited */
+static int originatepoolsize;	/*!< max threads running async originates */
 static char *manager_channelvars;
 
 #define DEFAULT_REALM		"asterisk"
@@ -1633,6 +1637,19 @@ static AST_RWLIST_HEAD_STATIC(users, ast_manager_user);
 /*! \brief list of actions registered */
 static AST_RWLIST_HEAD_STATIC(actions, manager_action);
 
+/*! \brief Number of buckets for the registered actions hash */
+#define ACTION_BUCKETS 53
+
+/*!
+ * \brief Registered actions indexed by name.
+ *
+ * Holds the same objects as \ref actions so that dispatching an inbound
+ * action is a hash lookup instead of a walk of the sorted list.  The
+ * sorted list is kept for the CLI and ListCommands, which want the
+ * actions in alphabetical order.
+ */
+static struct ao2_container *registered_actions;
+
 /*! \brief list of hooks registered */
 static AST_RWLIST_HEAD_STATIC(manager_hooks, manager_custom_hook);
 
@@ -1653,6 +1670,7 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters);
 
 static int match_filter(struct mansession *s, char *eventdata);
+static int any_manager_interest(struct ao2_container *sessions, int category);
 
 /*!
  * @{ \brief Define AMI message types.
@@ -1660,6 +1678,46 @@ static int match_filter(struct mansession *s, char *eventdata);
 STASIS_MESSAGE_TYPE_DEFN(ast_manager_get_generic_type);
 /*! @} */
 
+static int action_hash_fn(const void *obj, const int flags)
+{
+	const struct manager_action *act = obj;
+	const char *key = obj;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ast_str_case_hash(key);
+	case OBJ_SEARCH_OBJECT:
+		return ast_str_case_hash(act->action);
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int action_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct manager_action *object_left = obj;
+	const struct manager_action *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->action;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(object_left->action, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+	if (cmp) {
+		return 0;
+	}
+	return CMP_MATCH;
+}
+
 /*!
  * \internal
  * \brief Find a registered action object.
@@ -1670,13 +1728,18 @@ STASIS_MESSAGE_TYPE_DEFN(ast_manager_get_generic_type);
  */
 static struct manager_action *action_find(const char *name)
 {
-	struct manager_action *act;
+	struct manager_action *act = NULL;
 
 	AST_RWLIST_RDLOCK(&actions);
-	AST_RWLIST_TRAVERSE(&actions, act, list) {
-		if (!strcasecmp(name, act->action)) {
-			ao2_t_ref(act, +1, "found action object");
-			break;
+	if (registered_actions) {
+		act = ao2_t_find(registered_actions, name, OBJ_SEARCH_KEY,
+			"found action object");
+	} else {
+		AST_RWLIST_TRAVERSE(&actions, act, list) {
+			if (!strcasecmp(name, act->action)) {
+				ao2_t_ref(act, +1, "found action object");
+				break;
+			}
 		}
 	}
 	AST_RWLIST_UNLOCK(&actions);
@@ -1847,6 +1910,13 @@ static void manager_generic_msg_cb(void *data, struct stasis_subscription *sub,
 	type = ast_json_string_get(ast_json_object_get(payload->json, "type"));
 	event = ast_json_object_get(payload->json, "event");
 
+	/* The class is known before any text is built, so find out whether
+	 * rendering the JSON blob is needed at all. */
+	if (!any_manager_interest(sessions, class_type)) {
+		ao2_cleanup(sessions);
+		return;
+	}
+
 	event_buffer = ast_manager_str_from_json_object(event, NULL);
 	if (!event_buffer) {
 		ast_log(AST_LOG_WARNING, "Error while creating payload for event %s\n", type);
@@ -2148,10 +2218,64 @@ static struct mansession_session *unref_mansession(struct mansession_session *s)
 	return NULL;
 }
 
+/*!
+ * A precompiled session event filter.
+ *
+ * Patterns without any regex metacharacters - the common
+ * "Event: Newchannel" style - are matched with a plain substring
+ * search instead of being fed to regexec() for every event.
+ */
+struct event_filter {
+	int is_literal;	/*!< if non-zero, match pattern_text with strstr() */
+	regex_t regex;	/*!< compiled pattern; only valid when is_literal is zero */
+	char pattern_text[0];	/*!< original pattern; only stored for literals */
+};
+
 static void event_filter_destructor(void *obj)
 {
-	regex_t *regex_filter = obj;
-	regfree(regex_filter);
+	struct event_filter *filter = obj;
+
+	if (!filter->is_literal) {
+		regfree(&filter->regex);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Check whether an event of the given class could reach anybody.
+ *
+ * Used to skip formatting and queueing events nobody is subscribed to.
+ * Shutdown events always count as interesting because process_events()
+ * acts on them regardless of permissions, as does any registered hook,
+ * which receives every event.
+ */
+static int any_manager_interest(struct ao2_container *sessions, int category)
+{
+	struct ao2_iterator iter;
+	struct mansession_session *session;
+	int wanted = 0;
+
+	if (!sessions || category == EVENT_FLAG_SHUTDOWN
+		|| !AST_RWLIST_EMPTY(&manager_hooks)) {
+		return 1;
+	}
+
+	iter = ao2_iterator_init(sessions, 0);
+	while (!wanted && (session = ao2_iterator_next(&iter))) {
+		ao2_lock(session);
+		/* An unauthenticated session's permissions are not known yet,
+		 * so assume it could subscribe to anything. */
+		if (!session->authenticated
+			|| ((session->readperm & category) == category
+				&& (session->send_events & category) == category)) {
+			wanted = 1;
+		}
+		ao2_unlock(session);
+		unref_mansession(session);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return wanted;
 }
 
 static void session_destructor(void *obj)
@@ -2219,11 +2343,55 @@ static struct mansession_session *build_mansession(const struct ast_sockaddr *ad
 	return newsession;
 }
 
+/*!
+ * \internal
+ * \brief Hash a session on its manager id.
+ *
+ * AMI socket sessions all have managerid 0 and share a bucket; the hash
+ * exists so that HTTP sessions, which are looked up by id on every
+ * request, resolve without scanning the container.
+ */
+static int mansession_hash_fn(const void *obj, const int flags)
+{
+	if (flags & OBJ_KEY) {
+		return *(const uint32_t *) obj;
+	} else {
+		const struct mansession_session *s = obj;
+
+		return s->managerid;
+	}
+}
+
 static int mansession_cmp_fn(void *obj, void *arg, int flags)
 {
 	struct mansession_session *s = obj;
-	char *str = arg;
-	return !strcasecmp(s->username, str) ? CMP_MATCH : 0;
+
+	if (flags & OBJ_KEY) {
+		return s->managerid == *(uint32_t *) arg ? CMP_MATCH : 0;
+	}
+	/* Without OBJ_KEY the whole container is traversed and the argument
+	 * is a username, as used by check_manager_session_inuse(). */
+	return !strcasecmp(s->username, (char *) arg) ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Re-link a session whose managerid has changed.
+ *
+ * The sessions container is hashed on managerid, so a session must be
+ * re-linked after its id is assigned or rotated for hashed lookups to
+ * find it.  Must not be called with the session locked.
+ */
+static void mansession_relink(struct mansession_session *session)
+{
+	struct ao2_container *sessions;
+
+	sessions = ao2_global_obj_ref(mgr_sessions);
+	if (sessions) {
+		ao2_unlink(sessions, session);
+		ao2_link(sessions, session);
+		ao2_ref(sessions, -1);
+	}
 }
 
 static void session_destroy(struct mansession_session *s)
@@ -3353,7 +3521,7 @@ static int authenticate(struct mansession *s, const struct message *m)
 	const char *password = astman_get_header(m, "Secret");
 	int error = -1;
 	struct ast_manager_user *user = NULL;
-	regex_t *regex_filter;
+	struct event_filter *regex_filter;
 	struct ao2_iterator filter_iter;
 
 	if (ast_strlen_zero(username)) {	/* missing username */
@@ -5083,6 +5251,7 @@ action_command_cleanup:
 
 /*! \brief helper function for originate */
 struct fast_originate_helper {
+	AST_LIST_ENTRY(fast_originate_helper) list;
 	int timeout;
 	struct ast_format_cap *cap;				/*!< Codecs used for a call */
 	int early_media;
@@ -5120,7 +5289,28 @@ static void destroy_fast_originate_helper(struct fast_originate_helper *doomed)
 	ast_free(doomed);
 }
 
-static void *fast_originate(void *data)
+/*! \brief Thread pool running asynchronous originates */
+static struct ast_threadpool *originate_pool;
+
+/*! \brief Scheduler driving the originate pacing timer */
+static struct ast_sched_context *originate_sched;
+
+/*! \brief Originates waiting for a dispatch slot.  Holds the pacing state. */
+static AST_LIST_HEAD_STATIC(pending_originates, fast_originate_helper);
+
+/*! \brief Number of originates in \ref pending_originates */
+static int pending_originates_cnt;
+
+/*! \brief When the next originate may be dispatched */
+static struct timeval next_originate_time;
+
+/*! \brief Whether a pacing timer is currently scheduled */
+static int originate_dispatch_scheduled;
+
+/*! \brief Upper bound on queued originates; excess requests are refused */
+#define MAX_PENDING_ORIGINATES 10000
+
+static int fast_originate(void *data)
 {
 	struct fast_originate_helper *in = data;
 	int res;
@@ -5195,7 +5385,96 @@ static void *fast_originate(void *data)
 		ast_channel_unref(chan);
 	}
 	destroy_fast_originate_helper(in);
-	return NULL;
+	return 0;
+}
+
+static int originate_dispatch_cb(const void *data);
+
+/*!
+ * \internal
+ * \brief Dispatch queued originates that fit within the configured rate.
+ *
+ * Dispatching paces itself against \ref next_originate_time, advancing it by
+ * one slot (1/originateratelimit seconds) per originate handed to the thread
+ * pool.  When the queue is throttled, a one-shot timer is armed for the next
+ * available slot.
+ */
+static void originate_dispatch(void)
+{
+	struct fast_originate_helper *fast;
+	struct timeval now;
+
+	AST_LIST_LOCK(&pending_originates);
+	while ((fast = AST_LIST_FIRST(&pending_originates))) {
+		now = ast_tvnow();
+		if (originateratelimit && ast_tvcmp(next_originate_time, now) > 0) {
+			int delay = ast_tvdiff_ms(next_originate_time, now);
+
+			if (!originate_dispatch_scheduled
+				&& ast_sched_add(originate_sched, delay ? delay : 1,
+					originate_dispatch_cb, NULL) >= 0) {
+				originate_dispatch_scheduled = 1;
+			}
+			break;
+		}
+		AST_LIST_REMOVE_HEAD(&pending_originates, list);
+		pending_originates_cnt--;
+		if (originateratelimit) {
+			next_originate_time = ast_tvadd(
+				ast_tvcmp(next_originate_time, now) > 0 ? next_originate_time : now,
+				ast_samp2tv(1, originateratelimit));
+		}
+		if (ast_threadpool_push(originate_pool, fast_originate, fast)) {
+			ast_log(LOG_WARNING, "Failed to dispatch queued originate to %s/%s\n",
+				fast->tech, fast->data);
+			destroy_fast_originate_helper(fast);
+		}
+	}
+	AST_LIST_UNLOCK(&pending_originates);
+}
+
+/*! \brief Pacing timer callback */
+static int originate_dispatch_cb(const void *data)
+{
+	AST_LIST_LOCK(&pending_originates);
+	originate_dispatch_scheduled = 0;
+	AST_LIST_UNLOCK(&pending_originates);
+
+	originate_dispatch();
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hand an asynchronous originate to the originate engine.
+ *
+ * Without a rate limit the request goes straight to the thread pool;
+ * otherwise it is queued and the pacing timer dispatches it.  Completion is
+ * reported through the usual OriginateResponse event either way.
+ *
+ * \retval 0 the originate was accepted.
+ * \retval -1 the originate could not be accepted and must be destroyed by
+ *            the caller.
+ */
+static int originate_enqueue(struct fast_originate_helper *fast)
+{
+	if (!originateratelimit) {
+		return ast_threadpool_push(originate_pool, fast_originate, fast);
+	}
+
+	AST_LIST_LOCK(&pending_originates);
+	if (pending_originates_cnt >= MAX_PENDING_ORIGINATES) {
+		AST_LIST_UNLOCK(&pending_originates);
+		ast_log(LOG_WARNING, "Refusing originate to %s/%s: %d originates already queued\n",
+			fast->tech, fast->data, MAX_PENDING_ORIGINATES);
+		return -1;
+	}
+	AST_LIST_INSERT_TAIL(&pending_originates, fast, list);
+	pending_originates_cnt++;
+	AST_LIST_UNLOCK(&pending_originates);
+
+	originate_dispatch();
+	return 0;
 }
 
 static int aocmessage_get_unit_entry(const struct message *m, struct ast_aoc_unit_entry *entry, unsigned int entry_num)
@@ -5457,7 +5736,6 @@ static int action_originate(struct mansession *s, const struct message *m)
 	char tmp[256];
 	char tmp2[256];
 	struct ast_format_cap *cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
-	pthread_t th;
 	int bridge_early = 0;
 
 	if (!cap) {
@@ -5603,7 +5881,7 @@ static int action_originate(struct mansession *s, const struct message *m)
 			fast->timeout = to;
 			fast->early_media = bridge_early;
 			fast->priority = pi;
-			if (ast_pthread_create_detached(&th, NULL, fast_originate, fast)) {
+			if (originate_enqueue(fast)) {
 				destroy_fast_originate_helper(fast);
 				res = -1;
 			} else {
@@ -5774,13 +6052,25 @@ static int action_timeout(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Test one precompiled filter against an event string.
+ */
+static int event_filter_matches(struct event_filter *filter, const char *eventdata)
+{
+	if (filter->is_literal) {
+		return strstr(eventdata, filter->pattern_text) != NULL;
+	}
+	return !regexec(&filter->regex, eventdata, 0, NULL, 0);
+}
+
 static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
+	struct event_filter *regex_filter = obj;
 	const char *eventdata = arg;
 	int *result = data;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (event_filter_matches(regex_filter, eventdata)) {
 		*result = 1;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -5790,11 +6080,11 @@ static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 
 static int blackfilter_cmp_fn(void *obj, void *arg, void *data, int flags)
 {
-	regex_t *regex_filter = obj;
+	struct event_filter *regex_filter = obj;
 	const char *eventdata = arg;
 	int *result = data;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
+	if (event_filter_matches(regex_filter, eventdata)) {
 		*result = 0;
 		return (CMP_MATCH | CMP_STOP);
 	}
@@ -5859,12 +6149,9 @@ static int action_filter(struct mansession *s, const struct message *m)
  *
  */
 static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters) {
-	regex_t *new_filter = ao2_t_alloc(sizeof(*new_filter), event_filter_destructor, "event_filter allocation");
+	struct event_filter *new_filter;
 	int is_blackfilter;
-
-	if (!new_filter) {
-		return FILTER_ALLOC_FAILED;
-	}
+	int is_literal;
 
 	if (filter_pattern[0] == '!') {
 		is_blackfilter = 1;
@@ -5873,7 +6160,21 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 		is_blackfilter = 0;
 	}
 
-	if (regcomp(new_filter, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
+	/* A pattern with no regex metacharacters matches exactly the events
+	 * an unanchored regexec() would match, so keep it as plain text. */
+	is_literal = !strpbrk(filter_pattern, ".^$*+?()[]{}|\\");
+
+	new_filter = ao2_t_alloc(sizeof(*new_filter)
+		+ (is_literal ? strlen(filter_pattern) + 1 : 0),
+		event_filter_destructor, "event_filter allocation");
+	if (!new_filter) {
+		return FILTER_ALLOC_FAILED;
+	}
+
+	new_filter->is_literal = is_literal;
+	if (is_literal) {
+		strcpy(new_filter->pattern_text, filter_pattern); /* Safe */
+	} else if (regcomp(&new_filter->regex, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
 		ao2_t_ref(new_filter, -1, "failed to make regex");
 		return FILTER_COMPILE_FAIL;
 	}
@@ -5914,10 +6215,43 @@ static int match_filter(struct mansession *s, char *eventdata)
 	return result;
 }
 
+/*! Number of events a session may fall behind before we consider skipping ahead */
+#define EVENT_BACKLOG_LIMIT	5000
+
+/*! Age an event must reach before a backlogged session may skip over it */
+#define EVENT_BACKLOG_AGE	5
+
+/*!
+ * \internal
+ * \brief Number of queued events between the given event and the queue tail.
+ */
+static unsigned int event_backlog(struct eventqent *e)
+{
+	unsigned int latest;
+
+	AST_RWLIST_RDLOCK(&all_events);
+	/* The list is kept non-empty, so there is always a tail. */
+	latest = AST_RWLIST_LAST(&all_events)->seq;
+	AST_RWLIST_UNLOCK(&all_events);
+	return latest - e->seq;
+}
+
 /*!
  * Send any applicable events to the client listening on this socket.
  * Wait only for a finite time on each event, and drop all events whether
  * they are successfully sent or not.
+ *
+ * The socket writes are done with the session lock released so that a
+ * consumer draining slowly cannot block manager_event() producers, which
+ * take the session lock briefly to wake us.  Only the session's own
+ * thread delivers events or advances last_ev, so dropping the lock
+ * around the write cannot interleave output or race the queue position.
+ *
+ * A session that keeps accepting data too slowly to drain the queue is
+ * skipped ahead to the newest event once it is more than
+ * EVENT_BACKLOG_LIMIT events behind and is still sending events older
+ * than EVENT_BACKLOG_AGE seconds; the skip is logged.  Merely bursty
+ * sessions never trip both conditions at once.
  */
 static int process_events(struct mansession *s)
 {
@@ -5936,11 +6270,28 @@ static int process_events(struct mansession *s)
 			    (s->session->readperm & eqe->category) == eqe->category &&
 			    (s->session->send_events & eqe->category) == eqe->category) {
 					if (match_filter(s, eqe->eventdata)) {
-						if (send_string(s, eqe->eventdata) < 0)
+						int res;
+
+						ao2_unlock(s->session);
+						res = send_string(s, eqe->eventdata);
+						ao2_lock(s->session);
+						if (res < 0)
 							ret = -1;	/* don't send more */
 					}
 			}
 			s->session->last_ev = eqe;
+			if (!ret && event_backlog(eqe) > EVENT_BACKLOG_LIMIT
+				&& ast_tvdiff_sec(ast_tvnow(), eqe->tv) > EVENT_BACKLOG_AGE) {
+				struct eventqent *latest = grab_last();
+
+				ast_log(LOG_WARNING,
+					"Manager session from %s is lagging; skipping %u queued events\n",
+					ast_sockaddr_stringify_addr(&s->session->addr),
+					latest->seq - eqe->seq);
+				ast_atomic_fetchadd_int(&eqe->usecount, -1);
+				eqe = latest;
+				s->session->last_ev = eqe;
+			}
 		}
 	}
 	ao2_unlock(s->session);
@@ -6817,6 +7168,12 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 	struct ast_str *buf;
 	int i;
 
+	/* Before formatting anything, make sure somebody can receive this
+	 * event at all. */
+	if (!any_manager_interest(sessions, category)) {
+		return 0;
+	}
+
 	buf = ast_str_thread_get(&manager_event_buf, MANAGER_EVENT_BUF_INITSIZE);
 	if (!buf) {
 		return -1;
@@ -6957,6 +7314,9 @@ int ast_manager_unregister(const char *action)
 		}
 	}
 	AST_RWLIST_TRAVERSE_SAFE_END;
+	if (cur && registered_actions) {
+		ao2_t_unlink(registered_actions, cur, "action object removed from hash");
+	}
 	AST_RWLIST_UNLOCK(&actions);
 
 	if (cur) {
@@ -7035,6 +7395,14 @@ static int ast_manager_register_struct(struct manager_action *act)
 		prev = cur;
 	}
 
+	if (!registered_actions) {
+		registered_actions = ao2_t_container_alloc(ACTION_BUCKETS,
+			action_hash_fn, action_cmp_fn, "Registered actions hash");
+	}
+	if (registered_actions) {
+		ao2_t_link(registered_actions, act, "action object added to hash");
+	}
+
 	ao2_t_ref(act, +1, "action object added to list");
 	act->registered = 1;
 	if (prev) {
@@ -7170,7 +7538,6 @@ static struct mansession_session *find_session(uint32_t ident, int incinuse)
 {
 	struct ao2_container *sessions;
 	struct mansession_session *session;
-	struct ao2_iterator i;
 
 	if (ident == 0) {
 		return NULL;
@@ -7180,18 +7547,21 @@ static struct mansession_session *find_session(uint32_t ident, int incinuse)
 	if (!sessions) {
 		return NULL;
 	}
-	i = ao2_iterator_init(sessions, 0);
+	/* The container is hashed on managerid so this is a bucket lookup,
+	 * not a scan. */
+	session = ao2_find(sessions, &ident, OBJ_KEY);
 	ao2_ref(sessions, -1);
-	while ((session = ao2_iterator_next(&i))) {
-		ao2_lock(session);
-		if (session->managerid == ident && !session->needdestroy) {
-			ast_atomic_fetchadd_int(&session->inuse, incinuse ? 1 : 0);
-			break;
-		}
+	if (!session) {
+		return NULL;
+	}
+
+	ao2_lock(session);
+	if (session->needdestroy) {
 		ao2_unlock(session);
 		unref_mansession(session);
+		return NULL;
 	}
-	ao2_iterator_destroy(&i);
+	ast_atomic_fetchadd_int(&session->inuse, incinuse ? 1 : 0);
 
 	return session;
 }
@@ -7256,66 +7626,34 @@ int astman_is_authed(uint32_t ident)
 
 int astman_verify_session_readpermissions(uint32_t ident, int perm)
 {
-	int result = 0;
+	int result;
 	struct mansession_session *session;
-	struct ao2_container *sessions;
-	struct ao2_iterator i;
 
-	if (ident == 0) {
+	if (!(session = find_session(ident, 0))) {
 		return 0;
 	}
 
-	sessions = ao2_global_obj_ref(mgr_sessions);
-	if (!sessions) {
-		return 0;
-	}
-	i = ao2_iterator_init(sessions, 0);
-	ao2_ref(sessions, -1);
-	while ((session = ao2_iterator_next(&i))) {
-		ao2_lock(session);
-		if ((session->managerid == ident) && (session->readperm & perm)) {
-			result = 1;
-			ao2_unlock(session);
-			unref_mansession(session);
-			break;
-		}
-		ao2_unlock(session);
-		unref_mansession(session);
-	}
-	ao2_iterator_destroy(&i);
+	result = (session->readperm & perm) ? 1 : 0;
+
+	ao2_unlock(session);
+	unref_mansession(session);
 
 	return result;
 }
 
 int astman_verify_session_writepermissions(uint32_t ident, int perm)
 {
-	int result = 0;
+	int result;
 	struct mansession_session *session;
-	struct ao2_container *sessions;
-	struct ao2_iterator i;
 
-	if (ident == 0) {
+	if (!(session = find_session(ident, 0))) {
 		return 0;
 	}
 
-	sessions = ao2_global_obj_ref(mgr_sessions);
-	if (!sessions) {
-		return 0;
-	}
-	i = ao2_iterator_init(sessions, 0);
-	ao2_ref(sessions, -1);
-	while ((session = ao2_iterator_next(&i))) {
-		ao2_lock(session);
-		if ((session->managerid == ident) && (session->writeperm & perm)) {
-			result = 1;
-			ao2_unlock(session);
-			unref_mansession(session);
-			break;
-		}
-		ao2_unlock(session);
-		unref_mansession(session);
-	}
-	ao2_iterator_destroy(&i);
+	result = (session->writeperm & perm) ? 1 : 0;
+
+	ao2_unlock(session);
+	unref_mansession(session);
 
 	return result;
 }
@@ -7654,11 +7992,17 @@ static int generic_http_callback(struct ast_tcptls_session_instance *ser,
 		}
 		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
+		ao2_unlock(session);
+
+		/* The session was linked before the id it is hashed on was
+		 * assigned, so put it in the right bucket. */
+		mansession_relink(session);
+	} else {
+		ao2_unlock(session);
 	}
-	ao2_unlock(session);
 
-	http_header = ast_str_create(128);
-	out = ast_str_create(2048);
+	http_header = ast_str_pool_get(128);
+	out = ast_str_pool_get(2048);
 
 	ast_mutex_init(&s.lock);
 
@@ -7812,8 +8156,8 @@ generic_callback_out:
 	if (method == AST_HTTP_POST && params) {
 		ast_variables_destroy(params);
 	}
-	ast_free(http_header);
-	ast_free(out);
+	ast_str_pool_put(http_header);
+	ast_str_pool_put(out);
 
 	if (session) {
 		if (blastaway) {
@@ -7852,6 +8196,7 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 	struct ast_http_digest d = { NULL, };
 	struct ast_manager_user *user = NULL;
 	int stale = 0;
+	int new_session = 0;
 	char resp_hash[256]="";
 	/* Cache for user data */
 	char u_username[80];
@@ -7978,6 +8323,7 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 		}
 		session->noncetime = session->sessionstart = time_now;
 		session->authenticated = 1;
+		new_session = 1;
 	} else if (stale) {
 		/*
 		 * Session found, but nonce is stale.
@@ -8010,6 +8356,8 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 			nonce = session->managerid = ast_random();
 			session->noncetime = time_now;
 			ao2_unlock(session);
+			/* Re-bucket the session under the rotated nonce */
+			mansession_relink(session);
 			stale = 1;
 			goto out_401;
 		} else {
@@ -8022,6 +8370,12 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 	session->sessiontimeout = time(NULL) + (httptimeout > 5 ? httptimeout : 5);
 	ao2_unlock(session);
 
+	if (new_session) {
+		/* The session was linked before the nonce it is hashed on was
+		 * assigned, so put it in the right bucket. */
+		mansession_relink(session);
+	}
+
 	ast_mutex_init(&s.lock);
 	s.session = session;
 	s.fd = mkstemp(template);	/* create a temporary file for command output */
@@ -8087,8 +8441,8 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 
 	result_size = ftell(s.f); /* Calculate approx. size of result */
 
-	http_header = ast_str_create(80);
-	out = ast_str_create(result_size * 2 + 512);
+	http_header = ast_str_pool_get(80);
+	out = ast_str_pool_get(result_size * 2 + 512);
 	if (http_header == NULL || out == NULL) {
 		ast_http_request_close_on_completion(ser);
 		ast_http_error(ser, 500, "Server Error", "Internal Server Error (ast_str_create() out of memory)");
@@ -8133,8 +8487,8 @@ auth_callback_out:
 		ast_variables_destroy(params);
 	}
 
-	ast_free(http_header);
-	ast_free(out);
+	ast_str_pool_put(http_header);
+	ast_str_pool_put(out);
 
 	ao2_lock(session);
 	if (session->f) {
@@ -8719,6 +9073,24 @@ static void manager_shutdown(void)
 	ast_custom_function_unregister(&managerclient_function);
 	ast_cli_unregister_multiple(cli_manager, ARRAY_LEN(cli_manager));
 
+	if (originate_sched) {
+		ast_sched_context_destroy(originate_sched);
+		originate_sched = NULL;
+	}
+	if (originate_pool) {
+		struct fast_originate_helper *fast;
+
+		AST_LIST_LOCK(&pending_originates);
+		while ((fast = AST_LIST_REMOVE_HEAD(&pending_originates, list))) {
+			pending_originates_cnt--;
+			destroy_fast_originate_helper(fast);
+		}
+		AST_LIST_UNLOCK(&pending_originates);
+
+		ast_threadpool_shutdown(originate_pool);
+		originate_pool = NULL;
+	}
+
 #ifdef AST_XML_DOCS
 	ao2_t_global_obj_release(event_docs, "Dispose of event_docs");
 #endif
@@ -8752,6 +9124,9 @@ static void manager_shutdown(void)
 
 	ao2_global_obj_release(mgr_sessions);
 
+	ao2_t_cleanup(registered_actions, "Dispose of registered actions hash");
+	registered_actions = NULL;
+
 	while ((user = AST_LIST_REMOVE_HEAD(&users, list))) {
 		manager_free_user(user);
 	}
@@ -8834,6 +9209,8 @@ static void manager_set_defaults(void)
 	broken_events_action = 0;
 	authtimeout = 30;
 	authlimit = 50;
+	originateratelimit = 0;
+	originatepoolsize = 50;
 	manager_debug = 0;		/* Debug disabled by default */
 
 	/* default values */
@@ -8946,7 +9323,7 @@ static int __init_manager(int reload, int by_external_config)
 #endif
 
 		/* If you have a NULL hash fn, you only need a single bucket */
-		sessions = ao2_container_alloc(1, NULL, mansession_cmp_fn);
+		sessions = ao2_container_alloc(37, mansession_hash_fn, mansession_cmp_fn);
 		if (!sessions) {
 			return -1;
 		}
@@ -9047,6 +9424,22 @@ static int __init_manager(int reload, int by_external_config)
 			} else {
 				authlimit = limit;
 			}
+		} else if (!strcasecmp(var->name, "originateratelimit")) {
+			int limit = atoi(var->value);
+
+			if (limit < 0) {
+				ast_log(LOG_WARNING, "Invalid originateratelimit value '%s', using default value\n", var->value);
+			} else {
+				originateratelimit = limit;
+			}
+		} else if (!strcasecmp(var->name, "originatepoolsize")) {
+			int limit = atoi(var->value);
+
+			if (limit < 1) {
+				ast_log(LOG_WARNING, "Invalid originatepoolsize value '%s', using default value\n", var->value);
+			} else {
+				originatepoolsize = limit;
+			}
 		} else if (!strcasecmp(var->name, "channelvars")) {
 			load_channelvars(var);
 		} else {
@@ -9055,6 +9448,30 @@ static int __init_manager(int reload, int by_external_config)
 		}
 	}
 
+	/* The originate engine is created once, after the pool size option has
+	 * been read; resizing the pool requires a restart. */
+	if (!originate_pool) {
+		struct ast_threadpool_options pool_options = {
+			.version = AST_THREADPOOL_OPTIONS_VERSION,
+			.idle_timeout = 60,
+			.auto_increment = 5,
+			.initial_size = 0,
+			.max_size = originatepoolsize,
+		};
+
+		originate_sched = ast_sched_context_create();
+		if (!originate_sched || ast_sched_start_thread(originate_sched)) {
+			ast_log(LOG_ERROR, "Failed to create the originate scheduler thread\n");
+			return -1;
+		}
+
+		originate_pool = ast_threadpool_create("ami-originate", NULL, &pool_options);
+		if (!originate_pool) {
+			ast_log(LOG_ERROR, "Failed to create the originate thread pool\n");
+			return -1;
+		}
+	}
+
 	if (manager_enabled && !subscribed) {
 		if (subscribe_all() != 0) {
 			ast_log(LOG_ERROR, "Manager subscription error\n");
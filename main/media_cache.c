@@ -49,6 +49,61 @@
 /*! Our one and only container holding media items */
 static struct ao2_container *media_cache;
 
+/*!
+ * \brief An in-flight retrieval of a URI
+ *
+ * Only one retrieval per URI runs at a time; concurrent callers wait on
+ * \c cond for the first retrieval to finish instead of issuing duplicate
+ * requests to the remote server.  The list and all fields are protected
+ * by the \c media_cache container lock.
+ */
+struct media_cache_fetch {
+	/*! Signalled when the retrieval has completed */
+	ast_cond_t cond;
+	/*! Set when the retrieval has completed */
+	int complete;
+	/*! Result of the retrieval; 0 on success, -1 on failure */
+	int result;
+	/*! Next in-flight retrieval */
+	AST_LIST_ENTRY(media_cache_fetch) list;
+	/*! The URI being retrieved */
+	char uri[0];
+};
+
+/*! In-flight retrievals, protected by the \c media_cache container lock */
+static AST_LIST_HEAD_NOLOCK_STATIC(fetches, media_cache_fetch);
+
+/*!
+ * \internal
+ * \brief Destructor for an in-flight retrieval record
+ */
+static void media_cache_fetch_destructor(void *obj)
+{
+	struct media_cache_fetch *fetch = obj;
+
+	ast_cond_destroy(&fetch->cond);
+}
+
+/*!
+ * \internal
+ * \brief Find an in-flight retrieval of \c uri, bumping its reference
+ *
+ * \note Must be called with the \c media_cache container lock held
+ */
+static struct media_cache_fetch *media_cache_fetch_find(const char *uri)
+{
+	struct media_cache_fetch *fetch;
+
+	AST_LIST_TRAVERSE(&fetches, fetch, list) {
+		if (!strcmp(fetch->uri, uri)) {
+			ao2_ref(fetch, +1);
+			return fetch;
+		}
+	}
+
+	return NULL;
+}
+
 /*!
  * \internal
  * \brief Hashing function for file metadata
@@ -211,55 +266,105 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	char *file_path, size_t len)
 {
 	struct ast_bucket_file *bucket_file;
+	struct media_cache_fetch *fetch;
 	char *ext;
-	SCOPED_AO2LOCK(media_lock, media_cache);
 
 	if (ast_strlen_zero(uri)) {
 		return -1;
 	}
 
-	/* First, retrieve from the ao2 cache here. If we find a bucket_file
-	 * matching the requested URI, ask the appropriate backend if it is
-	 * stale. If not; return it.
-	 */
-	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
-	if (bucket_file) {
-		if (!ast_bucket_file_is_stale(bucket_file)) {
-			ast_copy_string(file_path, bucket_file->path, len);
-			if ((ext = strrchr(file_path, '.'))) {
-				*ext = '\0';
+	ao2_lock(media_cache);
+
+	for (;;) {
+		/* First, retrieve from the ao2 cache here. If we find a bucket_file
+		 * matching the requested URI, ask the appropriate backend if it is
+		 * stale. If not; return it.
+		 */
+		bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (bucket_file) {
+			if (!ast_bucket_file_is_stale(bucket_file)) {
+				ast_copy_string(file_path, bucket_file->path, len);
+				if ((ext = strrchr(file_path, '.'))) {
+					*ext = '\0';
+				}
+				ao2_ref(bucket_file, -1);
+				ao2_unlock(media_cache);
+
+				ast_debug(5, "Returning media at local file: %s\n", file_path);
+				return 0;
 			}
+
+			/* Stale! Remove the item completely, as we're going to replace it next */
+			ao2_unlink_flags(media_cache, bucket_file, OBJ_NOLOCK);
+			ast_bucket_file_delete(bucket_file);
 			ao2_ref(bucket_file, -1);
+		}
 
-			ast_debug(5, "Returning media at local file: %s\n", file_path);
-			return 0;
+		if (!(fetch = media_cache_fetch_find(uri))) {
+			break;
 		}
 
-		/* Stale! Remove the item completely, as we're going to replace it next */
-		ao2_unlink_flags(media_cache, bucket_file, OBJ_NOLOCK);
-		ast_bucket_file_delete(bucket_file);
-		ao2_ref(bucket_file, -1);
+		/* Someone else is already retrieving this URI.  Wait for their
+		 * retrieval instead of stampeding the server with a duplicate
+		 * request, then pick the result up out of the cache.
+		 */
+		while (!fetch->complete) {
+			ast_cond_wait(&fetch->cond, ao2_object_get_lockaddr(media_cache));
+		}
+		if (fetch->result) {
+			ao2_ref(fetch, -1);
+			ao2_unlock(media_cache);
+			return -1;
+		}
+		ao2_ref(fetch, -1);
+	}
+
+	fetch = ao2_alloc_options(sizeof(*fetch) + strlen(uri) + 1,
+		media_cache_fetch_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!fetch) {
+		ao2_unlock(media_cache);
+		return -1;
 	}
+	ast_cond_init(&fetch->cond, NULL);
+	strcpy(fetch->uri, uri); /* Safe */
+	ao2_ref(fetch, +1);
+	AST_LIST_INSERT_TAIL(&fetches, fetch, list);
 
 	/* Either this is new or the resource is stale; do a full retrieve
-	 * from the appropriate bucket_file backend
+	 * from the appropriate bucket_file backend.  Drop the container lock
+	 * for the duration so other URIs can be served while the backend
+	 * downloads.
 	 */
+	ao2_unlock(media_cache);
+
 	bucket_file = ast_bucket_file_retrieve(uri);
+
+	ao2_lock(media_cache);
+
+	if (bucket_file) {
+		/* We can manipulate the 'immutable' bucket_file here, as we haven't
+		 * let anyone know of its existence yet
+		 */
+		bucket_file_update_path(bucket_file, preferred_file_name);
+		media_cache_item_sync_to_astdb(bucket_file);
+		ast_copy_string(file_path, bucket_file->path, len);
+		if ((ext = strrchr(file_path, '.'))) {
+			*ext = '\0';
+		}
+		ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
+	}
+
+	fetch->complete = 1;
+	fetch->result = bucket_file ? 0 : -1;
+	AST_LIST_REMOVE(&fetches, fetch, list);
+	ast_cond_broadcast(&fetch->cond);
+	ao2_unlock(media_cache);
+	ao2_ref(fetch, -2);
+
 	if (!bucket_file) {
 		ast_debug(2, "Failed to obtain media at '%s'\n", uri);
 		return -1;
 	}
-
-	/* We can manipulate the 'immutable' bucket_file here, as we haven't
-	 * let anyone know of its existence yet
-	 */
-	bucket_file_update_path(bucket_file, preferred_file_name);
-	media_cache_item_sync_to_astdb(bucket_file);
-	ast_copy_string(file_path, bucket_file->path, len);
-	if ((ext = strrchr(file_path, '.'))) {
-		*ext = '\0';
-	}
-	ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
 	ao2_ref(bucket_file, -1);
 
 	ast_debug(5, "Returning media at local file: %s\n", file_path);
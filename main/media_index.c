@@ -516,10 +516,17 @@ static int process_file(struct ast_media_index *index, const char *variant_str,
 	return 0;
 }
 
-/*! \brief internal function for updating the index, recursive */
+/*! \brief internal function for updating the index, recursive
+ *
+ * When \a cache is non-NULL a manifest of the scan is written to it: a
+ * \c D line recording each directory and its modification time and an
+ * \c F line for every regular file found, so that a later call can
+ * rebuild the index without walking the tree.
+ */
 static int media_index_update(struct ast_media_index *index,
 	const char *variant,
-	const char *subdir)
+	const char *subdir,
+	FILE *cache)
 {
 	struct dirent* dent;
 	DIR* srcdir;
@@ -539,6 +546,20 @@ static int media_index_update(struct ast_media_index *index,
 		ast_str_append(&index_dir, 0, "/%s", subdir);
 	}
 
+	if (cache) {
+		struct stat st;
+
+		/* Take the directory's mtime before reading it; anything added
+		 * during or after the scan then makes the manifest look stale
+		 * rather than silently missing it. */
+		if (stat(ast_str_buffer(index_dir), &st) < 0) {
+			ast_log(LOG_WARNING, "Failed to stat %s: %s\n", ast_str_buffer(index_dir), strerror(errno));
+			return -1;
+		}
+		fprintf(cache, "D %ld %s\n", (long) st.st_mtime,
+			ast_strlen_zero(subdir) ? "." : subdir);
+	}
+
 	srcdir = opendir(ast_str_buffer(index_dir));
 	if (srcdir == NULL) {
 		ast_log(LOG_ERROR, "Failed to open %s: %s\n", ast_str_buffer(index_dir), strerror(errno));
@@ -562,11 +583,11 @@ static int media_index_update(struct ast_media_index *index,
 
 		if (S_ISDIR(st.st_mode)) {
 			if (ast_strlen_zero(subdir)) {
-				res = media_index_update(index, variant, dent->d_name);
+				res = media_index_update(index, variant, dent->d_name, cache);
 			} else {
 				RAII_VAR(struct ast_str *, new_subdir, ast_str_create(64), ast_free);
 				ast_str_set(&new_subdir, 0, "%s/%s", subdir, dent->d_name);
-				res = media_index_update(index, variant, ast_str_buffer(new_subdir));
+				res = media_index_update(index, variant, ast_str_buffer(new_subdir), cache);
 			}
 
 			if (res) {
@@ -579,6 +600,17 @@ static int media_index_update(struct ast_media_index *index,
 			continue;
 		}
 
+		if (cache) {
+			/* Every regular file is recorded, even ones no loaded format
+			 * can handle yet, so a replay after more formats register
+			 * still sees them. */
+			if (ast_strlen_zero(subdir)) {
+				fprintf(cache, "F %s\n", dent->d_name);
+			} else {
+				fprintf(cache, "F %s/%s\n", subdir, dent->d_name);
+			}
+		}
+
 		if (process_file(index, variant, subdir, dent->d_name)) {
 			res = -1;
 			break;
@@ -592,6 +624,153 @@ static int media_index_update(struct ast_media_index *index,
 int ast_media_index_update(struct ast_media_index *index,
 	const char *variant)
 {
-	return media_index_update(index, variant, NULL);
+	return media_index_update(index, variant, NULL, NULL);
+}
+
+/*! \brief First line of a manifest cache file, followed by the format version */
+#define MEDIA_CACHE_SIGNATURE "ASTMEDIAINDEX"
+
+/*! \brief Version of the manifest cache format this code reads and writes */
+#define MEDIA_CACHE_VERSION 1
+
+/*!
+ * \internal
+ * \brief Rebuild the index for \a variant from a manifest cache file
+ *
+ * The first pass checks every recorded directory against its current
+ * modification time; only when all of them are unchanged does the second
+ * pass feed the recorded files through process_file(), exactly as a real
+ * scan would. Nothing is added to the index by a stale or corrupt cache.
+ *
+ * \retval 0 the index was rebuilt from the manifest
+ * \retval 1 the cache is missing, stale, or corrupt; a full scan is needed
+ * \retval -1 failure while processing a recorded file
+ */
+static int media_index_replay_cache(struct ast_media_index *index, const char *variant, const char *cache_file)
+{
+	FILE *cache;
+	char line[PATH_MAX + 32];
+	int version;
+	int res = 0;
+
+	cache = fopen(cache_file, "r");
+	if (!cache) {
+		return 1;
+	}
+
+	if (!fgets(line, sizeof(line), cache)
+		|| sscanf(line, MEDIA_CACHE_SIGNATURE " %d", &version) != 1
+		|| version != MEDIA_CACHE_VERSION) {
+		fclose(cache);
+		return 1;
+	}
+
+	/* pass one: every directory in the manifest must be unmodified */
+	while (fgets(line, sizeof(line), cache)) {
+		long mtime;
+		int offset;
+		struct stat st;
+		RAII_VAR(struct ast_str *, dir_path, NULL, ast_free);
+
+		ast_trim_blanks(line);
+		if (line[0] != 'D') {
+			continue;
+		}
+
+		if (sscanf(line, "D %ld %n", &mtime, &offset) != 1 || !line[offset]) {
+			fclose(cache);
+			return 1;
+		}
+
+		dir_path = ast_str_create(64);
+		if (!dir_path) {
+			fclose(cache);
+			return -1;
+		}
+
+		ast_str_set(&dir_path, 0, "%s", index->base_dir);
+		if (!ast_strlen_zero(variant)) {
+			ast_str_append(&dir_path, 0, "/%s", variant);
+		}
+		if (strcmp(line + offset, ".")) {
+			ast_str_append(&dir_path, 0, "/%s", line + offset);
+		}
+
+		if (stat(ast_str_buffer(dir_path), &st) < 0
+			|| !S_ISDIR(st.st_mode)
+			|| (long) st.st_mtime != mtime) {
+			fclose(cache);
+			return 1;
+		}
+	}
+
+	/* pass two: replay the recorded files into the index */
+	rewind(cache);
+	while (fgets(line, sizeof(line), cache)) {
+		char *filename;
+
+		ast_trim_blanks(line);
+		if (line[0] != 'F' || line[1] != ' ') {
+			continue;
+		}
+
+		filename = strrchr(line + 2, '/');
+		if (filename) {
+			*filename++ = '\0';
+			res = process_file(index, variant, line + 2, filename);
+		} else {
+			res = process_file(index, variant, NULL, line + 2);
+		}
+
+		if (res) {
+			res = -1;
+			break;
+		}
+	}
+
+	fclose(cache);
+	return res;
+}
+
+int ast_media_index_update_cached(struct ast_media_index *index,
+	const char *variant, const char *cache_file)
+{
+	FILE *cache = NULL;
+	char tmp_file[PATH_MAX];
+	int res;
+
+	if (ast_strlen_zero(cache_file)) {
+		return media_index_update(index, variant, NULL, NULL);
+	}
+
+	res = media_index_replay_cache(index, variant, cache_file);
+	if (res <= 0) {
+		return res;
+	}
+
+	/* the cache could not be used; do a full scan and record a fresh
+	 * manifest along the way (failure to write one is not fatal, it
+	 * just means the next update scans again) */
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", cache_file);
+	cache = fopen(tmp_file, "w");
+	if (cache) {
+		fprintf(cache, MEDIA_CACHE_SIGNATURE " %d\n", MEDIA_CACHE_VERSION);
+	} else {
+		ast_debug(1, "Could not create media index cache '%s': %s\n", tmp_file, strerror(errno));
+	}
+
+	res = media_index_update(index, variant, NULL, cache);
+
+	if (cache) {
+		fclose(cache);
+		if (res) {
+			unlink(tmp_file);
+		} else if (rename(tmp_file, cache_file)) {
+			ast_debug(1, "Could not install media index cache '%s': %s\n", cache_file, strerror(errno));
+			unlink(tmp_file);
+		}
+	}
+
+	return res;
 }
 
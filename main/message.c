@@ -41,6 +41,7 @@
 #include "asterisk/app.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/message.h"
+#include "asterisk/channel_internal.h"
 
 /*** DOCUMENTATION
 	<function name="MESSAGE" language="en_US">
@@ -753,6 +754,7 @@ static void chan_cleanup(struct ast_channel *chan)
 	while ((ds = AST_LIST_REMOVE_HEAD(ast_channel_datastores(chan), entry))) {
 		ast_datastore_free(ds);
 	}
+	ast_channel_internal_datastore_map_rebuild(chan);
 
 	/*
 	 * Destroy all channel variables.
@@ -768,6 +770,8 @@ static void chan_cleanup(struct ast_channel *chan)
 	while ((cur = AST_LIST_REMOVE_HEAD(ast_channel_readq(chan), frame_list))) {
 		ast_frfree(cur);
 	}
+	ast_channel_readq(chan)->frames = 0;
+	ast_channel_readq(chan)->voice_frames = 0;
 
 	/*
 	 * Restore msg datastore.
@@ -1492,7 +1496,7 @@ int ast_msg_init(void)
 {
 	int res;
 
-	msg_q_tp = ast_taskprocessor_get("ast_msg_queue", TPS_REF_DEFAULT);
+	msg_q_tp = ast_taskprocessor_get_pooled("ast_msg_queue", TPS_REF_DEFAULT);
 	if (!msg_q_tp) {
 		return -1;
 	}
@@ -29,6 +29,8 @@
 
 #include "asterisk.h"
 
+#include <fcntl.h>
+
 #include "asterisk/config.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/utils.h"
@@ -659,3 +661,177 @@ void _ast_sockaddr_from_sin(struct ast_sockaddr *addr, const struct sockaddr_in
 
 	addr->len = sizeof(*sin);
 }
+
+/*! \brief A listener socket kept open across a restart exec(). */
+struct handoff_listener {
+	AST_LIST_ENTRY(handoff_listener) entry;
+	int fd;
+	/*! Stringified address the descriptor is bound to */
+	char addr[0];
+};
+
+/*! Listeners registered by subsystems in this process. */
+static AST_LIST_HEAD_STATIC(registered_listeners, handoff_listener);
+
+/*! Listeners inherited from the previous process, not yet claimed. */
+static AST_LIST_HEAD_STATIC(inherited_listeners, handoff_listener);
+
+/*!
+ * \brief Environment variable carrying the listener manifest across the
+ * restart exec(), as semicolon separated "fd/address" entries.
+ */
+#define LISTENER_HANDOFF_VAR "AST_LISTENER_FDS"
+
+static struct handoff_listener *handoff_listener_alloc(int fd, const char *addr)
+{
+	struct handoff_listener *listener;
+
+	listener = ast_calloc(1, sizeof(*listener) + strlen(addr) + 1);
+	if (!listener) {
+		return NULL;
+	}
+	listener->fd = fd;
+	strcpy(listener->addr, addr); /* safe */
+
+	return listener;
+}
+
+/*!
+ * \internal
+ * \brief Parse the manifest left by the previous process, once.
+ *
+ * Must be called with inherited_listeners locked.
+ */
+static void inherited_listeners_parse(void)
+{
+	static int parsed;
+	struct handoff_listener *listener;
+	char *manifest;
+	char *item;
+
+	if (parsed) {
+		return;
+	}
+	parsed = 1;
+
+	manifest = getenv(LISTENER_HANDOFF_VAR);
+	if (!manifest) {
+		return;
+	}
+	manifest = ast_strdupa(manifest);
+	unsetenv(LISTENER_HANDOFF_VAR);
+
+	while ((item = strsep(&manifest, ";"))) {
+		char *addr = item;
+		char *fd_str = strsep(&addr, "/");
+		int fd;
+
+		if (ast_strlen_zero(fd_str) || ast_strlen_zero(addr)
+			|| sscanf(fd_str, "%30d", &fd) != 1) {
+			continue;
+		}
+		listener = handoff_listener_alloc(fd, addr);
+		if (!listener) {
+			close(fd);
+			continue;
+		}
+		AST_LIST_INSERT_TAIL(&inherited_listeners, listener, entry);
+	}
+}
+
+int ast_listener_fd_register(int fd, const struct ast_sockaddr *addr)
+{
+	struct handoff_listener *listener;
+
+	listener = handoff_listener_alloc(fd, ast_sockaddr_stringify(addr));
+	if (!listener) {
+		return -1;
+	}
+
+	AST_LIST_LOCK(&registered_listeners);
+	AST_LIST_INSERT_TAIL(&registered_listeners, listener, entry);
+	AST_LIST_UNLOCK(&registered_listeners);
+
+	return 0;
+}
+
+void ast_listener_fd_unregister(int fd)
+{
+	struct handoff_listener *listener;
+
+	AST_LIST_LOCK(&registered_listeners);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&registered_listeners, listener, entry) {
+		if (listener->fd == fd) {
+			AST_LIST_REMOVE_CURRENT(entry);
+			ast_free(listener);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&registered_listeners);
+}
+
+int ast_listener_fd_acquire(const struct ast_sockaddr *addr)
+{
+	struct handoff_listener *listener;
+	const char *addr_str = ast_sockaddr_stringify(addr);
+	int fd = -1;
+
+	AST_LIST_LOCK(&inherited_listeners);
+	inherited_listeners_parse();
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&inherited_listeners, listener, entry) {
+		if (!strcmp(listener->addr, addr_str)) {
+			AST_LIST_REMOVE_CURRENT(entry);
+			fd = listener->fd;
+			ast_free(listener);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&inherited_listeners);
+
+	return fd;
+}
+
+void ast_listener_handoff_prepare(void)
+{
+	struct handoff_listener *listener;
+	struct ast_str *manifest = ast_str_create(128);
+
+	if (!manifest) {
+		return;
+	}
+
+	AST_LIST_LOCK(&registered_listeners);
+	AST_LIST_TRAVERSE(&registered_listeners, listener, entry) {
+		int flags = fcntl(listener->fd, F_GETFD);
+
+		if (flags == -1
+			|| fcntl(listener->fd, F_SETFD, flags & ~FD_CLOEXEC) == -1) {
+			continue;
+		}
+		ast_str_append(&manifest, 0, "%s%d/%s",
+			ast_str_strlen(manifest) ? ";" : "", listener->fd, listener->addr);
+	}
+	AST_LIST_UNLOCK(&registered_listeners);
+
+	if (ast_str_strlen(manifest)) {
+		setenv(LISTENER_HANDOFF_VAR, ast_str_buffer(manifest), 1);
+	}
+	ast_free(manifest);
+}
+
+void ast_listener_handoff_complete(void)
+{
+	struct handoff_listener *listener;
+
+	AST_LIST_LOCK(&inherited_listeners);
+	inherited_listeners_parse();
+	while ((listener = AST_LIST_REMOVE_HEAD(&inherited_listeners, entry))) {
+		ast_debug(1, "Closing unclaimed inherited listener for %s\n",
+			listener->addr);
+		close(listener->fd);
+		ast_free(listener);
+	}
+	AST_LIST_UNLOCK(&inherited_listeners);
+}
@@ -291,6 +291,7 @@ struct ast_context {
 	char *registrar;			/*!< Registrar -- make sure you malloc this, as the registrar may have to survive module unloads */
 	int refcount;                   /*!< each module that would have created this context should inc/dec this as appropriate */
 	int autohints;                  /*!< Whether autohints support is enabled or not */
+	int cidmatch_extens;            /*!< Number of extensions in this context with a CID match requirement */
 	ast_mutex_t macrolock;			/*!< A lock to implement "exclusive" macros - held whilst a call is executing in the macro */
 	char name[0];				/*!< Name of the context */
 };
@@ -311,6 +312,14 @@ struct ast_state_cb {
 	AST_LIST_ENTRY(ast_state_cb) entry;
 };
 
+/*! \brief Cached state of a single device within a hint */
+struct hint_devstate {
+	/*! The last known state of the device */
+	enum ast_device_state state;
+	/*! The device name */
+	char *device;
+};
+
 /*!
  * \brief Structure for dial plan hints
  *
@@ -341,6 +350,10 @@ struct ast_hint {
 	char exten_name[AST_MAX_EXTENSION];/*!< Extension of destroyed hint extension. */
 
 	AST_VECTOR(, char *) devices; /*!< Devices associated with the hint */
+
+	/*! Cached per device states used for incremental aggregation, protected by the hint lock */
+	AST_VECTOR(, struct hint_devstate) devstates;
+	char *devstates_app; /*!< The hint app string the cached device states were parsed from */
 };
 
 STASIS_MESSAGE_TYPE_DEFN_LOCAL(hint_change_message_type);
@@ -2417,6 +2430,7 @@ struct fake_context /* this struct is purely for matching in the hashtab */
 	const char *registrar;
 	int refcount;
 	int autohints;
+	int cidmatch_extens;
 	ast_mutex_t macrolock;
 	char name[256];
 };
@@ -2588,6 +2602,49 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 		}
 	} while (0);
 
+	/*
+	 * Fast path for the common case: the dialed string names an exact
+	 * (non-pattern) extension.  Non-pattern extens always sort ahead of
+	 * patterns (see ext_cmp) and only one clean extension name can be
+	 * strcmp-equal to the dialed string, so a root_table hit here is the
+	 * same extension either matcher below would settle on first.  The
+	 * path is skipped when the context holds CID-qualified extensions,
+	 * since one of those with the same name would take precedence, and
+	 * on a priority/label miss we still fall through because a pattern
+	 * may supply the missing priority.  With large generated dialplans
+	 * this turns the typical call-setup lookup into a hash probe instead
+	 * of a trie walk or a scan of the full extension list.
+	 */
+	if (!ast_strlen_zero(exten) && exten[0] != '_'
+		&& !tmp->cidmatch_extens && tmp->root_table
+		&& (action == E_MATCH || action == E_SPAWN || action == E_FINDLABEL)) {
+		struct ast_exten ex = {
+			.exten = (char *) exten,
+			.matchcid = AST_EXT_MATCHCID_OFF,
+		};
+
+		eroot = ast_hashtab_lookup(tmp->root_table, &ex);
+		if (eroot) {
+			if (q->status < STATUS_NO_PRIORITY) {
+				q->status = STATUS_NO_PRIORITY;
+			}
+			e = NULL;
+			if (action == E_FINDLABEL && label) {
+				if (q->status < STATUS_NO_LABEL) {
+					q->status = STATUS_NO_LABEL;
+				}
+				e = ast_hashtab_lookup(eroot->peer_label_table, &pattern);
+			} else {
+				e = ast_hashtab_lookup(eroot->peer_table, &pattern);
+			}
+			if (e) {	/* found a valid match */
+				q->status = STATUS_SUCCESS;
+				q->foundcontext = context;
+				return e;
+			}
+		}
+	}
+
 	if (extenpatternmatchnew) {
 		new_find_extension(exten, &score, tmp->pattern_tree, 0, 0, callerid, label, action);
 		eroot = score.exten;
@@ -3083,6 +3140,151 @@ static int ast_extension_state3(struct ast_str *hint_app, struct ao2_container *
 	return ast_devstate_to_extenstate(ast_devstate_aggregate_result(&agg));
 }
 
+/*!
+ * \internal
+ * \brief Clear the cached device states of a hint
+ *
+ * \pre hint is locked
+ */
+static void hint_devstate_cache_clear(struct ast_hint *hint)
+{
+	while (AST_VECTOR_SIZE(&hint->devstates) > 0) {
+		struct hint_devstate devstate = AST_VECTOR_GET(&hint->devstates, 0);
+
+		ast_free(devstate.device);
+		AST_VECTOR_REMOVE_UNORDERED(&hint->devstates, 0);
+	}
+	ast_free(hint->devstates_app);
+	hint->devstates_app = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Compute hint device state with a full walk and rebuild the cache from it
+ *
+ * \param hint The hint being evaluated
+ * \param hint_app String containing the hint app (clobbered, as with ast_extension_state3)
+ * \param device_state_info Optional container to fill in with the device state information
+ */
+static int hint_devstate_rebuild(struct ast_hint *hint, struct ast_str *hint_app,
+	struct ao2_container *device_state_info)
+{
+	struct ao2_container *capture = device_state_info ?: alloc_device_state_info();
+	char *app_copy = ast_strdup(ast_str_buffer(hint_app));
+	struct ast_device_state_info *info;
+	struct ao2_iterator iter;
+	int state;
+
+	state = ast_extension_state3(hint_app, capture);
+
+	if (!capture || !app_copy) {
+		/* Without these the cache can not be maintained, but the state is still valid */
+		ast_free(app_copy);
+		if (capture && capture != device_state_info) {
+			ao2_ref(capture, -1);
+		}
+		return state;
+	}
+
+	ao2_lock(hint);
+	hint_devstate_cache_clear(hint);
+	hint->devstates_app = app_copy;
+	iter = ao2_iterator_init(capture, 0);
+	for (; (info = ao2_iterator_next(&iter)); ao2_ref(info, -1)) {
+		struct hint_devstate devstate = {
+			.state = info->device_state,
+			.device = ast_strdup(info->device_name),
+		};
+
+		if (!devstate.device || AST_VECTOR_APPEND(&hint->devstates, devstate)) {
+			/* An incomplete cache would produce wrong aggregates so it is dropped */
+			ast_free(devstate.device);
+			hint_devstate_cache_clear(hint);
+			ao2_ref(info, -1);
+			break;
+		}
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_unlock(hint);
+
+	if (capture != device_state_info) {
+		ao2_ref(capture, -1);
+	}
+
+	return state;
+}
+
+/*!
+ * \internal
+ * \brief Compute hint device state using the cached per device states
+ *
+ * The full walk of ast_device_state() across every device in the hint is only
+ * performed when the cache does not yet reflect the current device list.  A
+ * change to a single device otherwise refreshes just that device's
+ * contribution and folds the cached states back together, so one device flap
+ * no longer queries every other device the hint watches.
+ *
+ * \param hint The hint being evaluated
+ * \param hint_app String containing the hint app (clobbered, as with ast_extension_state3)
+ * \param device_state_info Optional container to fill in with the device state information
+ * \param changed_device Device whose state change triggered this evaluation, or NULL to force a full walk
+ */
+static int hint_devstate_evaluate(struct ast_hint *hint, struct ast_str *hint_app,
+	struct ao2_container *device_state_info, const char *changed_device)
+{
+	struct ast_devstate_aggregate agg;
+	enum ast_device_state changed_state;
+	int valid = 0;
+	size_t i;
+
+	if (changed_device) {
+		ao2_lock(hint);
+		valid = hint->devstates_app
+			&& !strcmp(hint->devstates_app, ast_str_buffer(hint_app));
+		ao2_unlock(hint);
+	}
+
+	if (!valid) {
+		return hint_devstate_rebuild(hint, hint_app, device_state_info);
+	}
+
+	/* Only the changed device needs to be asked for its current state */
+	changed_state = ast_device_state(changed_device);
+
+	ao2_lock(hint);
+	if (!hint->devstates_app
+		|| strcmp(hint->devstates_app, ast_str_buffer(hint_app))) {
+		/* The device list changed while the device state was being queried */
+		ao2_unlock(hint);
+		return hint_devstate_rebuild(hint, hint_app, device_state_info);
+	}
+
+	ast_devstate_aggregate_init(&agg);
+	for (i = 0; i < AST_VECTOR_SIZE(&hint->devstates); i++) {
+		struct hint_devstate *devstate = AST_VECTOR_GET_ADDR(&hint->devstates, i);
+
+		if (!strcasecmp(devstate->device, changed_device)) {
+			devstate->state = changed_state;
+		}
+		ast_devstate_aggregate_add(&agg, devstate->state);
+		if (device_state_info) {
+			struct ast_device_state_info *obj;
+
+			obj = ao2_alloc_options(sizeof(*obj) + strlen(devstate->device), device_state_info_dt, AO2_ALLOC_OPT_LOCK_NOLOCK);
+			/* if failed we cannot add this device */
+			if (obj) {
+				obj->device_state = devstate->state;
+				strcpy(obj->device_name, devstate->device); /* SAFE */
+				ao2_link(device_state_info, obj);
+				ao2_ref(obj, -1);
+			}
+		}
+	}
+	ao2_unlock(hint);
+
+	return ast_devstate_to_extenstate(ast_devstate_aggregate_result(&agg));
+}
+
 /*! \brief Check state of extension by using hints */
 static int ast_extension_state2(struct ast_exten *e, struct ao2_container *device_state_info)
 {
@@ -3334,7 +3536,8 @@ static void get_device_state_causing_channels(struct ao2_container *c)
 	ao2_iterator_destroy(&iter);
 }
 
-static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app)
+static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app,
+	const char *changed_device)
 {
 	struct ao2_iterator cb_iter;
 	struct ast_state_cb *state_cb;
@@ -3377,7 +3580,7 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 	 */
 	device_state_info = alloc_device_state_info();
 
-	state = ast_extension_state3(*hint_app, device_state_info);
+	state = hint_devstate_evaluate(hint, *hint_app, device_state_info, changed_device);
 	same_state = state == hint->laststate;
 	if (same_state && (~state & AST_EXTENSION_RINGING)) {
 		ao2_cleanup(device_state_info);
@@ -3518,7 +3721,8 @@ static int handle_hint_change_message_type(struct stasis_message *msg, enum ast_
 
 	switch (reason) {
 	case AST_HINT_UPDATE_DEVICE:
-		device_state_notify_callbacks(hint, &hint_app);
+		/* The hint itself changed so the cached device list can not be trusted */
+		device_state_notify_callbacks(hint, &hint_app, NULL);
 		break;
 	case AST_HINT_UPDATE_PRESENCE:
 		{
@@ -3553,7 +3757,6 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	struct ast_device_state_message *dev_state;
 	struct ast_str *hint_app;
 	struct ast_hintdevice *device;
-	struct ast_hintdevice *cmpdevice;
 	struct ao2_iterator *dev_iter;
 	struct ao2_iterator auto_iter;
 	struct ast_autohint *autohint;
@@ -3585,21 +3788,21 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	cmpdevice = ast_alloca(sizeof(*cmpdevice) + strlen(dev_state->device));
-	strcpy(cmpdevice->hintdevice, dev_state->device);
-
 	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
 
-	/* Initially we find all hints for the device and notify them */
+	/* The hintdevices container is a reverse index hashed on the device name, so
+	 * this jumps directly to the hints watching the device rather than scanning
+	 * the hints container.
+	 */
 	dev_iter = ao2_t_callback(hintdevices,
-		OBJ_SEARCH_OBJECT | OBJ_MULTIPLE,
+		OBJ_SEARCH_KEY | OBJ_MULTIPLE,
 		hintdevice_cmp_multiple,
-		cmpdevice,
+		(char *) dev_state->device,
 		"find devices in container");
 	if (dev_iter) {
 		for (; (device = ao2_iterator_next(dev_iter)); ao2_t_ref(device, -1, "Next device")) {
 			if (device->hint) {
-				device_state_notify_callbacks(device->hint, &hint_app);
+				device_state_notify_callbacks(device->hint, &hint_app, dev_state->device);
 			}
 		}
 		ao2_iterator_destroy(dev_iter);
@@ -3884,6 +4087,8 @@ static void destroy_hint(void *obj)
 		ast_free(device);
 	}
 	AST_VECTOR_FREE(&hint->devices);
+	hint_devstate_cache_clear(hint);
+	AST_VECTOR_FREE(&hint->devstates);
 	ast_free(hint->last_presence_subtype);
 	ast_free(hint->last_presence_message);
 }
@@ -3946,6 +4151,7 @@ static int ast_add_hint(struct ast_exten *e)
 		return -1;
 	}
 	AST_VECTOR_INIT(&hint_new->devices, 8);
+	AST_VECTOR_INIT(&hint_new->devstates, 8);
 
 	/* Initialize new hint. */
 	hint_new->callbacks = ao2_container_alloc(1, NULL, hint_id_cmp);
@@ -4961,6 +5167,8 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 			exten2 = ast_hashtab_remove_this_object(con->root_table, exten);
 			if (!exten2)
 				ast_log(LOG_ERROR,"Trying to delete the exten %s from context %s, but could not remove from the root_table\n", extension, con->name);
+			else if (exten2->matchcid == AST_EXT_MATCHCID_ON)
+				con->cidmatch_extens--;
 			if (con->pattern_tree) {
 				struct match_char *x = add_exten_to_pattern_tree(con, exten, 1);
 
@@ -5002,6 +5210,8 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 						ast_log(LOG_ERROR, "Did not remove this exten (%s) from the "
 							"context root_table (%s) (priority %d)\n",
 							exten->name, con->name, priority);
+					} else if (exten3->matchcid == AST_EXT_MATCHCID_ON) {
+						con->cidmatch_extens--;
 					}
 					if (con->pattern_tree) {
 						struct match_char *x = add_exten_to_pattern_tree(con, exten, 1);
@@ -6425,6 +6635,22 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	 * there are already other code paths that use this order
 	 */
 
+	/*
+	 * Build the pattern match tries for the new contexts while they are
+	 * still private to the caller and no locks are needed.  They would
+	 * otherwise be built on demand: some inside the locked window below
+	 * when restoring hints, the rest by the first call to route through
+	 * each context after the reload, with every other caller blocked on
+	 * the contexts lock while a large context's trie is constructed.
+	 */
+	iter = ast_hashtab_start_traversal(exttable);
+	while ((tmp = ast_hashtab_next(iter))) {
+		if (!tmp->pattern_tree && tmp->root_table) {
+			create_match_char_tree(tmp);
+		}
+	}
+	ast_hashtab_end_traversal(iter);
+
 	begintime = ast_tvnow();
 	ast_mutex_lock(&context_merge_lock);/* Serialize ast_merge_contexts_and_delete */
 	ast_wrlock_contexts();
@@ -7347,7 +7573,11 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 		if (!tmp2) {
 			/* hmmm, not in the trie; */
 			add_exten_to_pattern_tree(con, tmp, 0);
-			ast_hashtab_insert_safe(con->root_table, tmp); /* for the sake of completeness */
+			/* for the sake of completeness */
+			if (ast_hashtab_insert_safe(con->root_table, tmp)
+				&& tmp->matchcid == AST_EXT_MATCHCID_ON) {
+				con->cidmatch_extens++;
+			}
 		}
 	}
 	res = 0; /* some compilers will think it is uninitialized otherwise */
@@ -7378,6 +7608,9 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 				}
 
 				ast_hashtab_remove_this_object(con->root_table, tmp);
+				if (tmp->matchcid == AST_EXT_MATCHCID_ON) {
+					con->cidmatch_extens--;
+				}
 			}
 
 			if (tmp->datad) {
@@ -7431,7 +7664,10 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 			ast_hashtab_insert_safe(tmp->peer_label_table, tmp);
 		}
 		ast_hashtab_insert_safe(tmp->peer_table, tmp);
-		ast_hashtab_insert_safe(con->root_table, tmp);
+		if (ast_hashtab_insert_safe(con->root_table, tmp)
+			&& tmp->matchcid == AST_EXT_MATCHCID_ON) {
+			con->cidmatch_extens++;
+		}
 
 		if (lock_context) {
 			ast_unlock_context(con);
@@ -8155,7 +8391,6 @@ static void presence_state_cb(void *unused, struct stasis_subscription *sub, str
 	struct ast_presence_state_message *presence_state;
 	struct ast_str *hint_app = NULL;
 	struct ast_hintdevice *device;
-	struct ast_hintdevice *cmpdevice;
 	struct ao2_iterator *dev_iter;
 
 	if (stasis_message_type(msg) != ast_presence_state_message_type()) {
@@ -8174,14 +8409,11 @@ static void presence_state_cb(void *unused, struct stasis_subscription *sub, str
 		return;
 	}
 
-	cmpdevice = ast_alloca(sizeof(*cmpdevice) + strlen(presence_state->provider));
-	strcpy(cmpdevice->hintdevice, presence_state->provider);
-
 	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
 	dev_iter = ao2_t_callback(hintdevices,
-		OBJ_POINTER | OBJ_MULTIPLE,
+		OBJ_SEARCH_KEY | OBJ_MULTIPLE,
 		hintdevice_cmp_multiple,
-		cmpdevice,
+		(char *) presence_state->provider,
 		"find devices in container");
 	if (!dev_iter) {
 		ast_mutex_unlock(&context_merge_lock);
@@ -30,17 +30,39 @@
 #include "asterisk.h"
 
 #include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/cli.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/manager.h"
 #include "asterisk/module.h"
 #include "asterisk/pbx.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/strings.h"
 #include "asterisk/term.h"
+#include "asterisk/threadstorage.h"
 #include "asterisk/utils.h"
 #include "asterisk/xmldoc.h"
 #include "pbx_private.h"
 
+/*** DOCUMENTATION
+	<manager name="DialplanProfile" language="en_US">
+		<synopsis>
+			List dialplan execution profile statistics.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+		</syntax>
+		<description>
+			<para>Reports the cumulative execution count and duration of every
+			(context, extension, application) combination executed since startup or
+			the last <literal>dialplan profile clear</literal>, as a series of
+			<literal>DialplanProfileEntry</literal> events followed by a
+			<literal>DialplanProfileComplete</literal> event. Times are reported
+			in microseconds.</para>
+		</description>
+	</manager>
+ ***/
+
 /*! \brief ast_app: A registered application */
 struct ast_app {
 	int (*execute)(struct ast_channel *chan, const char *data);
@@ -59,6 +81,292 @@ struct ast_app {
 	char name[0];				/*!< Name of the application */
 };
 
+/*! \brief Number of buckets for the profile containers (should be prime) */
+#define PBX_PROFILE_BUCKETS 563
+
+/*! \brief Application executions between merges of a thread's buckets into the aggregate */
+#define PBX_PROFILE_FLUSH_INTERVAL 256
+
+/*! \brief Cumulative execution statistics for one (context, extension, application) */
+struct pbx_profile_bucket {
+	/*! Number of invocations */
+	uint64_t count;
+	/*! Cumulative execution time in microseconds */
+	uint64_t total_us;
+	/*! Longest single execution in microseconds */
+	uint64_t max_us;
+	/*! Offset of the extension within key */
+	uint16_t exten_off;
+	/*! Offset of the application within key */
+	uint16_t app_off;
+	/*! Packed "context\0extension\0application\0" */
+	char key[0];
+};
+
+/*! \brief Search key for the profile containers */
+struct pbx_profile_key {
+	const char *context;
+	const char *exten;
+	const char *app;
+};
+
+/*! \brief Per-thread profile buckets, written without any locking */
+struct pbx_profile_store {
+	/*! Buckets accumulated by this thread since its last merge */
+	struct ao2_container *buckets;
+	/*! Application executions since the last merge */
+	unsigned int pending;
+};
+
+/*!
+ * \brief Aggregated profile buckets from all threads
+ *
+ * Threads record into their own unlocked buckets and merge them here every
+ * \ref PBX_PROFILE_FLUSH_INTERVAL executions and when the thread exits, so
+ * the per-execution cost is a monotonic clock pair and one unlocked hash
+ * lookup. Figures shown on demand therefore trail the live threads by at
+ * most one merge interval each.
+ */
+static struct ao2_container *pbx_profile_aggregate;
+
+static int pbx_profile_hash_triple(const char *context, const char *exten, const char *app)
+{
+	return ast_str_hash(context) + 33 * ast_str_hash(exten) + 33 * 33 * ast_str_hash(app);
+}
+
+static int pbx_profile_hash(const void *obj, int flags)
+{
+	const struct pbx_profile_bucket *bucket;
+	const struct pbx_profile_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return pbx_profile_hash_triple(key->context, key->exten, key->app);
+	case OBJ_SEARCH_OBJECT:
+		bucket = obj;
+		return pbx_profile_hash_triple(bucket->key, bucket->key + bucket->exten_off,
+			bucket->key + bucket->app_off);
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int pbx_profile_cmp(void *obj, void *arg, int flags)
+{
+	const struct pbx_profile_bucket *left = obj;
+	const struct pbx_profile_bucket *right = arg;
+	const struct pbx_profile_key *right_key = arg;
+	struct pbx_profile_key key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		key.context = right->key;
+		key.exten = right->key + right->exten_off;
+		key.app = right->key + right->app_off;
+		right_key = &key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (strcmp(left->key, right_key->context)
+			|| strcmp(left->key + left->exten_off, right_key->exten)
+			|| strcmp(left->key + left->app_off, right_key->app)) {
+			return 0;
+		}
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
+static struct pbx_profile_bucket *pbx_profile_bucket_alloc(const char *context,
+	const char *exten, const char *app)
+{
+	size_t context_len = strlen(context) + 1;
+	size_t exten_len = strlen(exten) + 1;
+	struct pbx_profile_bucket *bucket;
+
+	bucket = ao2_alloc_options(sizeof(*bucket) + context_len + exten_len + strlen(app) + 1,
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!bucket) {
+		return NULL;
+	}
+
+	bucket->exten_off = context_len;
+	bucket->app_off = context_len + exten_len;
+	strcpy(bucket->key, context); /* Safe */
+	strcpy(bucket->key + bucket->exten_off, exten); /* Safe */
+	strcpy(bucket->key + bucket->app_off, app); /* Safe */
+
+	return bucket;
+}
+
+/*! \brief Merge a thread's buckets into the aggregate and zero them for reuse */
+static void pbx_profile_flush(struct pbx_profile_store *store)
+{
+	struct ao2_iterator iter;
+	struct pbx_profile_bucket *bucket;
+
+	if (!pbx_profile_aggregate || !store->buckets) {
+		return;
+	}
+
+	ao2_lock(pbx_profile_aggregate);
+	iter = ao2_iterator_init(store->buckets, 0);
+	while ((bucket = ao2_iterator_next(&iter))) {
+		struct pbx_profile_bucket *aggregate;
+
+		if (!bucket->count) {
+			ao2_ref(bucket, -1);
+			continue;
+		}
+
+		aggregate = ao2_find(pbx_profile_aggregate, bucket, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+		if (!aggregate) {
+			aggregate = pbx_profile_bucket_alloc(bucket->key,
+				bucket->key + bucket->exten_off, bucket->key + bucket->app_off);
+			if (!aggregate) {
+				ao2_ref(bucket, -1);
+				continue;
+			}
+			ao2_link_flags(pbx_profile_aggregate, aggregate, OBJ_NOLOCK);
+		}
+
+		aggregate->count += bucket->count;
+		aggregate->total_us += bucket->total_us;
+		if (bucket->max_us > aggregate->max_us) {
+			aggregate->max_us = bucket->max_us;
+		}
+		ao2_ref(aggregate, -1);
+
+		bucket->count = 0;
+		bucket->total_us = 0;
+		bucket->max_us = 0;
+		ao2_ref(bucket, -1);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_unlock(pbx_profile_aggregate);
+
+	store->pending = 0;
+}
+
+static void pbx_profile_store_cleanup(void *data)
+{
+	struct pbx_profile_store *store = data;
+
+	pbx_profile_flush(store);
+	ao2_cleanup(store->buckets);
+	ast_free(store);
+}
+
+AST_THREADSTORAGE_CUSTOM(pbx_profile_storage, NULL, pbx_profile_store_cleanup);
+
+/*! \brief Record one application execution in this thread's buckets */
+static void pbx_profile_record(const char *context, const char *exten, const char *app,
+	int64_t elapsed_us)
+{
+	struct pbx_profile_key key = {
+		.context = context,
+		.exten = exten,
+		.app = app,
+	};
+	struct pbx_profile_store *store;
+	struct pbx_profile_bucket *bucket;
+
+	if (!pbx_profile_aggregate) {
+		return;
+	}
+
+	store = ast_threadstorage_get(&pbx_profile_storage, sizeof(*store));
+	if (!store) {
+		return;
+	}
+
+	if (!store->buckets) {
+		store->buckets = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK,
+			PBX_PROFILE_BUCKETS, pbx_profile_hash, pbx_profile_cmp);
+		if (!store->buckets) {
+			return;
+		}
+	}
+
+	bucket = ao2_find(store->buckets, &key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!bucket) {
+		bucket = pbx_profile_bucket_alloc(context, exten, app);
+		if (!bucket) {
+			return;
+		}
+		ao2_link_flags(store->buckets, bucket, OBJ_NOLOCK);
+	}
+
+	bucket->count++;
+	bucket->total_us += elapsed_us;
+	if ((uint64_t) elapsed_us > bucket->max_us) {
+		bucket->max_us = elapsed_us;
+	}
+	ao2_ref(bucket, -1);
+
+	if (++store->pending >= PBX_PROFILE_FLUSH_INTERVAL) {
+		pbx_profile_flush(store);
+	}
+}
+
+static int pbx_profile_sort_cmp(const void *obj_left, const void *obj_right)
+{
+	const struct pbx_profile_bucket *left = *(struct pbx_profile_bucket * const *) obj_left;
+	const struct pbx_profile_bucket *right = *(struct pbx_profile_bucket * const *) obj_right;
+
+	/* Descending by cumulative time */
+	return (left->total_us < right->total_us) - (left->total_us > right->total_us);
+}
+
+/*!
+ * \brief Snapshot the aggregate as an array of bucket references sorted by cumulative time
+ *
+ * \retval NULL when there is nothing to report, with \a count set to zero
+ */
+static struct pbx_profile_bucket **pbx_profile_snapshot(size_t *count)
+{
+	struct pbx_profile_bucket **buckets;
+	struct pbx_profile_bucket *bucket;
+	struct ao2_iterator iter;
+	size_t num;
+
+	*count = 0;
+	if (!pbx_profile_aggregate || !(num = ao2_container_count(pbx_profile_aggregate))) {
+		return NULL;
+	}
+
+	buckets = ast_malloc(num * sizeof(*buckets));
+	if (!buckets) {
+		return NULL;
+	}
+
+	iter = ao2_iterator_init(pbx_profile_aggregate, 0);
+	while (*count < num && (bucket = ao2_iterator_next(&iter))) {
+		buckets[(*count)++] = bucket;
+	}
+	ao2_iterator_destroy(&iter);
+
+	qsort(buckets, *count, sizeof(*buckets), pbx_profile_sort_cmp);
+
+	return buckets;
+}
+
+static void pbx_profile_snapshot_free(struct pbx_profile_bucket **buckets, size_t count)
+{
+	size_t idx;
+
+	for (idx = 0; idx < count; idx++) {
+		ao2_ref(buckets[idx], -1);
+	}
+	ast_free(buckets);
+}
+
 /*!
  * \brief Registered applications container.
  *
@@ -96,6 +404,14 @@ struct ast_app *pbx_findapp(const char *app)
 	ret = pbx_findapp_nolock(app);
 	AST_RWLIST_UNLOCK(&apps);
 
+	if (!ret && !ast_module_load_for("application", app)) {
+		/* A module declared to provide the application was just
+		 * loaded, so it may be registered now. */
+		AST_RWLIST_RDLOCK(&apps);
+		ret = pbx_findapp_nolock(app);
+		AST_RWLIST_UNLOCK(&apps);
+	}
+
 	return ret;
 }
 
@@ -467,6 +783,7 @@ int pbx_exec(struct ast_channel *c,	/*!< Channel */
 	struct ast_module_user *u = NULL;
 	const char *saved_c_appl;
 	const char *saved_c_data;
+	struct timeval start;
 
 	/* save channel values */
 	saved_c_appl= ast_channel_appl(c);
@@ -480,28 +797,184 @@ int pbx_exec(struct ast_channel *c,	/*!< Channel */
 
 	if (app->module)
 		u = __ast_module_user_add(app->module, c);
+	start = ast_tvnow();
 	res = app->execute(c, S_OR(data, ""));
 	if (app->module && u)
 		__ast_module_user_remove(app->module, u);
 	/* restore channel values */
 	ast_channel_appl_set(c, saved_c_appl);
 	ast_channel_data_set(c, saved_c_data);
+
+	pbx_profile_record(ast_channel_context(c), ast_channel_exten(c), app->name,
+		ast_tvdiff_us(ast_tvnow(), start));
+
 	return res;
 }
 
+static char *handle_show_profile(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define PROFILE_FORMAT "%-20.20s %-20.20s %-20.20s %10s %12s %10s %10s\n"
+	struct pbx_profile_bucket **buckets;
+	size_t count;
+	size_t shown = 25;
+	size_t idx;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "dialplan show profile";
+		e->usage =
+			"Usage: dialplan show profile [count]\n"
+			"       Show cumulative dialplan application execution statistics,\n"
+			"       sorted by cumulative execution time. Up to 'count' entries\n"
+			"       are shown (default 25).\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc > 4) {
+		return CLI_SHOWUSAGE;
+	}
+	if (a->argc == 4) {
+		if (sscanf(a->argv[3], "%30zu", &shown) != 1 || !shown) {
+			return CLI_SHOWUSAGE;
+		}
+	}
+
+	buckets = pbx_profile_snapshot(&count);
+	if (!count) {
+		ast_cli(a->fd, "No dialplan applications have been profiled\n");
+		return CLI_SUCCESS;
+	}
+
+	ast_cli(a->fd, PROFILE_FORMAT, "Context", "Extension", "Application",
+		"Count", "Total(ms)", "Avg(ms)", "Max(ms)");
+	if (shown > count) {
+		shown = count;
+	}
+	for (idx = 0; idx < shown; idx++) {
+		struct pbx_profile_bucket *bucket = buckets[idx];
+		char count_str[24], total_str[24], avg_str[24], max_str[24];
+
+		snprintf(count_str, sizeof(count_str), "%" PRIu64, bucket->count);
+		snprintf(total_str, sizeof(total_str), "%.3f", bucket->total_us / 1000.0);
+		snprintf(avg_str, sizeof(avg_str), "%.3f",
+			bucket->total_us / 1000.0 / bucket->count);
+		snprintf(max_str, sizeof(max_str), "%.3f", bucket->max_us / 1000.0);
+		ast_cli(a->fd, PROFILE_FORMAT, bucket->key,
+			bucket->key + bucket->exten_off, bucket->key + bucket->app_off,
+			count_str, total_str, avg_str, max_str);
+	}
+	ast_cli(a->fd, "%zu of %zu profile entr%s shown\n", shown, count,
+		count == 1 ? "y" : "ies");
+
+	pbx_profile_snapshot_free(buckets, count);
+
+	return CLI_SUCCESS;
+#undef PROFILE_FORMAT
+}
+
+static char *handle_profile_clear(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "dialplan profile clear";
+		e->usage =
+			"Usage: dialplan profile clear\n"
+			"       Discard all aggregated dialplan execution statistics.\n"
+			"       Figures a thread has not yet merged are unaffected.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (pbx_profile_aggregate) {
+		ao2_callback(pbx_profile_aggregate, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
+			NULL, NULL);
+	}
+	ast_cli(a->fd, "Dialplan execution profile cleared\n");
+
+	return CLI_SUCCESS;
+}
+
+static int manager_dialplan_profile(struct mansession *s, const struct message *m)
+{
+	const char *action_id = astman_get_header(m, "ActionID");
+	struct pbx_profile_bucket **buckets;
+	size_t count;
+	size_t idx;
+
+	astman_send_listack(s, m, "Dialplan profile will follow", "start");
+
+	buckets = pbx_profile_snapshot(&count);
+	for (idx = 0; idx < count; idx++) {
+		struct pbx_profile_bucket *bucket = buckets[idx];
+
+		astman_append(s, "Event: DialplanProfileEntry\r\n");
+		if (!ast_strlen_zero(action_id)) {
+			astman_append(s, "ActionID: %s\r\n", action_id);
+		}
+		astman_append(s,
+			"Context: %s\r\n"
+			"Extension: %s\r\n"
+			"Application: %s\r\n"
+			"Count: %" PRIu64 "\r\n"
+			"TotalTime: %" PRIu64 "\r\n"
+			"AvgTime: %" PRIu64 "\r\n"
+			"MaxTime: %" PRIu64 "\r\n"
+			"\r\n",
+			bucket->key,
+			bucket->key + bucket->exten_off,
+			bucket->key + bucket->app_off,
+			bucket->count,
+			bucket->total_us,
+			bucket->total_us / bucket->count,
+			bucket->max_us);
+	}
+	if (buckets) {
+		pbx_profile_snapshot_free(buckets, count);
+	}
+
+	astman_send_list_complete_start(s, m, "DialplanProfileComplete", count);
+	astman_send_list_complete_end(s);
+
+	return 0;
+}
+
 static struct ast_cli_entry app_cli[] = {
 	AST_CLI_DEFINE(handle_show_applications, "Shows registered dialplan applications"),
 	AST_CLI_DEFINE(handle_show_application, "Describe a specific dialplan application"),
+	AST_CLI_DEFINE(handle_show_profile, "Show dialplan execution statistics"),
+	AST_CLI_DEFINE(handle_profile_clear, "Clear dialplan execution statistics"),
 };
 
 static void unload_pbx_app(void)
 {
+	struct ao2_container *aggregate = pbx_profile_aggregate;
+
+	ast_manager_unregister("DialplanProfile");
 	ast_cli_unregister_multiple(app_cli, ARRAY_LEN(app_cli));
+
+	/* Stop recorders before dropping the container they merge into. */
+	pbx_profile_aggregate = NULL;
+	ao2_cleanup(aggregate);
 }
 
 int load_pbx_app(void)
 {
+	pbx_profile_aggregate = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_MUTEX,
+		PBX_PROFILE_BUCKETS, pbx_profile_hash, pbx_profile_cmp);
+	if (!pbx_profile_aggregate) {
+		return -1;
+	}
+
 	ast_cli_register_multiple(app_cli, ARRAY_LEN(app_cli));
+	ast_manager_register_xml_core("DialplanProfile", EVENT_FLAG_REPORTING,
+		manager_dialplan_profile);
 	ast_register_cleanup(unload_pbx_app);
 
 	return 0;
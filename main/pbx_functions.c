@@ -267,6 +267,14 @@ struct ast_custom_function *ast_custom_function_find(const char *name)
 	acf = ast_custom_function_find_nolock(name);
 	AST_RWLIST_UNLOCK(&acf_root);
 
+	if (!acf && !ast_module_load_for("function", name)) {
+		/* A module declared to provide the function was just
+		 * loaded, so it may be registered now. */
+		AST_RWLIST_RDLOCK(&acf_root);
+		acf = ast_custom_function_find_nolock(name);
+		AST_RWLIST_UNLOCK(&acf_root);
+	}
+
 	return acf;
 }
 
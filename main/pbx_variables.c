@@ -32,6 +32,7 @@
 #include "asterisk/_private.h"
 #include "asterisk/app.h"
 #include "asterisk/ast_expr.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/chanvars.h"
 #include "asterisk/cli.h"
 #include "asterisk/linkedlists.h"
@@ -108,6 +109,147 @@
 AST_RWLOCK_DEFINE_STATIC(globalslock);
 static struct varshead globals = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
 
+/*! \brief Number of buckets for the expression result cache */
+#define EXPR_CACHE_BUCKETS 101
+
+/*! \brief Cap on cached expression results; the cache is flushed when hit */
+#define EXPR_CACHE_MAX_ENTRIES 1024
+
+/*! \brief Expressions longer than this are not worth caching */
+#define EXPR_CACHE_MAX_LEN 128
+
+/*!
+ * \brief Memoized result of a $[ ] expression evaluation.
+ *
+ * Expression evaluation runs a flex/bison parser from scratch on every
+ * $[ ] encountered, and dialer dialplans evaluate the same few
+ * substituted expressions ("1 = 1" and friends) millions of times.
+ * Evaluation is a pure computation except when the expression invokes a
+ * dialplan function, so results of function-free expressions can be
+ * replayed from a hash keyed on the substituted expression text.
+ */
+struct expr_cache_entry {
+	/*! Result text; points into buf[] after the expression */
+	const char *result;
+	/*! Length of the result text */
+	int result_len;
+	/*! Expression text followed by the result text */
+	char buf[0];
+};
+
+static struct ao2_container *expr_cache;
+
+static int expr_cache_hash(const void *obj, const int flags)
+{
+	const struct expr_cache_entry *entry = obj;
+	const char *key = obj;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return ast_str_hash(key);
+	case OBJ_SEARCH_OBJECT:
+		return ast_str_hash(entry->buf);
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int expr_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct expr_cache_entry *object_left = obj;
+	const struct expr_cache_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->buf;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcmp(object_left->buf, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+	if (cmp) {
+		return 0;
+	}
+	return CMP_MATCH | CMP_STOP;
+}
+
+/*!
+ * \internal
+ * \brief Decide if an expression's result can be memoized.
+ *
+ * A parenthesis means a possible function call, and custom functions
+ * read channel state or have side effects, so anything containing one
+ * is evaluated fresh every time.
+ */
+static int expr_cache_usable(const char *expr)
+{
+	return expr_cache && *expr && !strchr(expr, '(')
+		&& strlen(expr) <= EXPR_CACHE_MAX_LEN;
+}
+
+/*!
+ * \internal
+ * \brief Replay a cached expression result.
+ *
+ * \return Length written into buf, or -1 if not cached or buf is too
+ * small to hold the result without truncation.
+ */
+static int expr_cache_get(const char *expr, char *buf, int length)
+{
+	struct expr_cache_entry *entry;
+	int res = -1;
+
+	entry = ao2_find(expr_cache, expr, OBJ_SEARCH_KEY);
+	if (entry) {
+		if (entry->result_len < length) {
+			memcpy(buf, entry->result, entry->result_len + 1);
+			res = entry->result_len;
+		}
+		ao2_ref(entry, -1);
+	}
+
+	return res;
+}
+
+static void expr_cache_put(const char *expr, const char *result, int result_len)
+{
+	struct expr_cache_entry *entry;
+	size_t expr_len = strlen(expr);
+
+	entry = ao2_find(expr_cache, expr, OBJ_SEARCH_KEY);
+	if (entry) {
+		/* Another thread beat us to it. */
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	if (ao2_container_count(expr_cache) >= EXPR_CACHE_MAX_ENTRIES) {
+		/* Keep the cache bounded; dropping it all is cheap and the hot
+		 * expressions repopulate it immediately. */
+		ao2_callback(expr_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
+			NULL, NULL);
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + expr_len + result_len + 2,
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->buf, expr); /* Safe */
+	entry->result = entry->buf + expr_len + 1;
+	memcpy(entry->buf + expr_len + 1, result, result_len + 1);
+	entry->result_len = result_len;
+
+	ao2_link(expr_cache, entry);
+	ao2_ref(entry, -1);
+}
+
 /*!
  * \brief extract offset:length from variable name.
  * \return 1 if there is a offset:length part, which is
@@ -357,20 +499,24 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 		}
 	}
 	/* if not found, look into chanvars or global vars */
-	for (i = 0; s == &not_found && i < ARRAY_LEN(places); i++) {
-		struct ast_var_t *variables;
-		if (!places[i])
-			continue;
-		if (places[i] == &globals)
-			ast_rwlock_rdlock(&globalslock);
-		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(ast_var_name(variables), var)) {
-				s = ast_var_value(variables);
-				break;
+	if (s == &not_found) {
+		int varhash = ast_str_hash(var);
+
+		for (i = 0; s == &not_found && i < ARRAY_LEN(places); i++) {
+			struct ast_var_t *variables;
+			if (!places[i])
+				continue;
+			if (places[i] == &globals)
+				ast_rwlock_rdlock(&globalslock);
+			AST_LIST_TRAVERSE(places[i], variables, entries) {
+				if (variables->namehash == varhash && !strcmp(ast_var_name(variables), var)) {
+					s = ast_var_value(variables);
+					break;
+				}
 			}
+			if (places[i] == &globals)
+				ast_rwlock_unlock(&globalslock);
 		}
-		if (places[i] == &globals)
-			ast_rwlock_unlock(&globalslock);
 	}
 	if (s == &not_found || s == NULL) {
 		ast_debug(5, "Result of '%s' is NULL\n", var);
@@ -404,16 +550,16 @@ void ast_str_substitute_variables_full(struct ast_str **buf, ssize_t maxlen, str
 	const char *vars, *vare;
 	char *finalvars;
 	int pos, brackets, needsub, len;
-	struct ast_str *substr1 = ast_str_create(16), *substr2 = NULL, *substr3 = ast_str_create(16);
+	struct ast_str *substr1 = NULL, *substr2 = NULL, *substr3 = NULL;
 
 	ast_str_reset(*buf);
 	whereweare = templ;
 	while (!ast_strlen_zero(whereweare)) {
 		/* reset our buffer */
-		ast_str_reset(substr3);
+		if (substr3) {
+			ast_str_reset(substr3);
+		}
 
-		/* Assume we're copying the whole remaining string */
-		pos = strlen(whereweare);
 		nextvar = NULL;
 		nextexp = NULL;
 		nextthing = strchr(whereweare, '$');
@@ -430,6 +576,9 @@ void ast_str_substitute_variables_full(struct ast_str **buf, ssize_t maxlen, str
 			default:
 				pos = 1;
 			}
+		} else {
+			/* Copy the whole remaining string */
+			pos = strlen(whereweare);
 		}
 
 		if (pos) {
@@ -440,6 +589,17 @@ void ast_str_substitute_variables_full(struct ast_str **buf, ssize_t maxlen, str
 			whereweare += pos;
 		}
 
+		if (nextvar || nextexp) {
+			/* Created on demand so that templates without any
+			 * substitutions cost no allocations at all */
+			if (!substr1) {
+				substr1 = ast_str_create(16);
+			}
+			if (!substr3) {
+				substr3 = ast_str_create(16);
+			}
+		}
+
 		if (nextvar) {
 			/* We have a variable.  Find the start and end, and determine
 			   if we are going to have to recursively call ourselves on the
@@ -599,8 +759,6 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 	*cp2 = 0; /* just in case nothing ends up there */
 	whereweare = cp1;
 	while (!ast_strlen_zero(whereweare) && count) {
-		/* Assume we're copying the whole remaining string */
-		pos = strlen(whereweare);
 		nextvar = NULL;
 		nextexp = NULL;
 		nextthing = strchr(whereweare, '$');
@@ -617,6 +775,9 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 			default:
 				pos = 1;
 			}
+		} else {
+			/* Copy the whole remaining string */
+			pos = strlen(whereweare);
 		}
 
 		if (pos) {
@@ -769,9 +930,20 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 				vars = var;
 			}
 
-			length = ast_expr(vars, cp2, count, c);
+			if (expr_cache_usable(vars)) {
+				length = expr_cache_get(vars, cp2, count);
+				if (length < 0) {
+					length = ast_expr(vars, cp2, count, c);
+					if (length > 0 && length < count && length == (int) strlen(cp2)) {
+						/* Not truncated; safe to replay later. */
+						expr_cache_put(vars, cp2, length);
+					}
+				}
+			} else {
+				length = ast_expr(vars, cp2, count, c);
+			}
 
-			if (length) {
+			if (length > 0) {
 				ast_debug(1, "Expression result is '%s'\n", cp2);
 				count -= length;
 				cp2 += length;
@@ -954,11 +1126,14 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 	struct ast_var_t *variables;
 	const char *ret = NULL;
 	int i;
+	int namehash;
 	struct varshead *places[2] = { NULL, &globals };
 
 	if (!name)
 		return NULL;
 
+	namehash = ast_str_hash(name);
+
 	if (chan) {
 		ast_channel_lock(chan);
 		places[0] = ast_channel_varshead(chan);
@@ -970,7 +1145,7 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
 		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(name, ast_var_name(variables))) {
+			if (variables->namehash == namehash && !strcmp(name, ast_var_name(variables))) {
 				ret = ast_var_value(variables);
 				break;
 			}
@@ -1025,6 +1200,7 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 	struct ast_var_t *newvariable;
 	struct varshead *headp;
 	const char *nametail = name;
+	int namehash;
 	/*! True if the old value was not an empty string. */
 	int old_value_existed = 0;
 
@@ -1048,9 +1224,11 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 		if (*nametail == '_')
 			nametail++;
 	}
+	namehash = ast_str_hash(nametail);
 
 	AST_LIST_TRAVERSE_SAFE_BEGIN(headp, newvariable, entries) {
-		if (strcmp(ast_var_name(newvariable), nametail) == 0) {
+		if (newvariable->namehash == namehash
+			&& strcmp(ast_var_name(newvariable), nametail) == 0) {
 			/* there is already such a variable, delete it */
 			AST_LIST_REMOVE_CURRENT(entries);
 			old_value_existed = !ast_strlen_zero(ast_var_value(newvariable));
@@ -1163,12 +1341,17 @@ static void unload_pbx_variables(void)
 	ast_unregister_application("Set");
 	ast_unregister_application("MSet");
 	pbx_builtin_clear_globals();
+	ao2_cleanup(expr_cache);
+	expr_cache = NULL;
 }
 
 int load_pbx_variables(void)
 {
 	int res = 0;
 
+	expr_cache = ao2_container_alloc(EXPR_CACHE_BUCKETS, expr_cache_hash,
+		expr_cache_cmp);
+
 	res |= ast_cli_register_multiple(vars_cli, ARRAY_LEN(vars_cli));
 	res |= ast_register_application2("Set", pbx_builtin_setvar, NULL, NULL, NULL);
 	res |= ast_register_application2("MSet", pbx_builtin_setvar_multiple, NULL, NULL, NULL);
@@ -74,6 +74,63 @@ static const struct ast_datastore_info pickup_active = {
 	.type = "pickup-active",
 };
 
+/*!
+ * Index of channels that might currently be picked up.
+ *
+ * Scanning the whole channels container on every pickup attempt is
+ * O(total channels); with many established calls a pickup can race its
+ * own timeout before it even finds the ringing target.  The channel
+ * core keeps this index current from state changes, so scans are
+ * proportional to the number of channels in a pickupable state instead.
+ *
+ * Membership is deliberately a superset of ast_can_pickup(): only the
+ * channel state is tracked because that is the one cheap, reliable
+ * hook.  Consumers must still verify ast_can_pickup() with the channel
+ * locked before acting on a candidate.
+ */
+static struct ao2_container *pickup_candidates;
+
+static int pickup_candidate_cmp(void *obj, void *arg, int flags)
+{
+	return obj == arg ? CMP_MATCH | CMP_STOP : 0;
+}
+
+void ast_pickup_state_changed(struct ast_channel *chan)
+{
+	if (!pickup_candidates) {
+		return;
+	}
+
+	switch (ast_channel_state(chan)) {
+	case AST_STATE_DOWN:
+	case AST_STATE_RING:
+	case AST_STATE_RINGING:
+		/* Unlink first so repeated ring state changes never link twice. */
+		ao2_unlink(pickup_candidates, chan);
+		if (!ast_test_flag(ast_channel_flags(chan), AST_FLAG_ZOMBIE)) {
+			ao2_link(pickup_candidates, chan);
+		}
+		break;
+	default:
+		ao2_unlink(pickup_candidates, chan);
+		break;
+	}
+}
+
+void ast_pickup_channel_removed(struct ast_channel *chan)
+{
+	if (!pickup_candidates) {
+		return;
+	}
+
+	ao2_unlink(pickup_candidates, chan);
+}
+
+struct ao2_iterator ast_pickup_candidates_iterator(void)
+{
+	return ao2_iterator_init(pickup_candidates, 0);
+}
+
 int ast_can_pickup(struct ast_channel *chan)
 {
 	if (!ast_channel_pbx(chan) && !ast_channel_masq(chan) && !ast_test_flag(ast_channel_flags(chan), AST_FLAG_ZOMBIE)
@@ -140,8 +197,18 @@ struct ast_channel *ast_pickup_find_by_group(struct ast_channel *chan)
 		return NULL;
 	}
 
-	/* Find all candidate targets by group. */
-	ast_channel_callback(find_channel_by_group, chan, candidates, 0);
+	/* Find all candidate targets by group among the ringing channels. */
+	{
+		struct ao2_iterator iter;
+		struct ast_channel *candidate;
+
+		iter = ast_pickup_candidates_iterator();
+		while ((candidate = ao2_iterator_next(&iter))) {
+			find_channel_by_group(candidate, chan, candidates, 0);
+			ast_channel_unref(candidate);
+		}
+		ao2_iterator_destroy(&iter);
+	}
 
 	/* Find the oldest pickup target candidate */
 	target = NULL;
@@ -396,10 +463,18 @@ pickup_failed:
 static void pickup_shutdown(void)
 {
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_call_pickup_type);
+	ao2_cleanup(pickup_candidates);
+	pickup_candidates = NULL;
 }
 
 int ast_pickup_init(void)
 {
+	pickup_candidates = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_MUTEX, 1,
+		NULL, pickup_candidate_cmp);
+	if (!pickup_candidates) {
+		return -1;
+	}
+
 	STASIS_MESSAGE_TYPE_INIT(ast_call_pickup_type);
 	ast_register_cleanup(pickup_shutdown);
 
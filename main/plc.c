@@ -38,6 +38,7 @@
 
 #include <math.h>
 
+#include "asterisk/lock.h"
 #include "asterisk/plc.h"
 
 #if !defined(FALSE)
@@ -57,6 +58,171 @@
 
 #define ms_to_samples(t)	    (((t)*DEFAULT_SAMPLE_RATE)/1000)
 
+/*! Limit on how many channels may run the full AMDF pitch search at once.
+    The search only runs as an erasure starts, but on a lossy trunk many
+    channels hit that point together, spiking CPU exactly when the network
+    is already struggling.  Channels over the limit degrade gracefully:
+    they reuse their pitch estimate from the previous erasure, or settle
+    for a coarse search over a quarter of the correlation span. */
+#define PLC_MAX_CONCURRENT_PITCH_SEARCHES 8
+
+/*! Reduced AMDF span used when over the concurrent search limit */
+#define CORRELATION_SPAN_COARSE     (CORRELATION_SPAN / 4)
+
+static int pitch_searches_in_flight = 0;
+
+/*!
+ * \internal
+ * \brief Vectorized kernels for the AMDF search and the OLA fill.
+ *
+ * The AMDF inner sum and the decaying fill-in multiply are straight-line
+ * array math, so both get SIMD kernels selected once for the running CPU
+ * with scalar fallbacks, following the pattern of the softmix mixing and
+ * frame gain kernels.  The fill kernel truncates toward zero exactly as
+ * the scalar int16_t conversion does, so output is unchanged.
+ */
+typedef int (*plc_amdf_acc_fn)(const int16_t a[], const int16_t b[], int len);
+typedef void (*plc_ola_fill_fn)(const float pitchbuf[], const float gains[], int16_t amp[], int len);
+
+static int plc_amdf_acc_scalar(const int16_t a[], const int16_t b[], int len)
+{
+	int j;
+	int acc;
+
+	acc = 0;
+	for (j = 0; j < len; j++)
+		acc += abs(a[j] - b[j]);
+	return acc;
+}
+
+static void plc_ola_fill_scalar(const float pitchbuf[], const float gains[], int16_t amp[], int len)
+{
+	int j;
+
+	for (j = 0; j < len; j++)
+		amp[j] = pitchbuf[j]*gains[j];
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#define PLC_HAVE_X86_KERNELS 1
+
+#include <immintrin.h>
+
+static __attribute__((target("sse2"))) int plc_amdf_acc_sse2(const int16_t a[], const int16_t b[], int len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+	int j = 0;
+	int tail;
+
+	for (; j + 8 <= len; j += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *) &a[j]);
+		__m128i y = _mm_loadu_si128((const __m128i *) &b[j]);
+		/* max - min is |x - y| as an unsigned 16 bit value */
+		__m128i d = _mm_sub_epi16(_mm_max_epi16(x, y), _mm_min_epi16(x, y));
+
+		acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(d, zero),
+			_mm_unpackhi_epi16(d, zero)));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	tail = _mm_cvtsi128_si32(acc);
+	for (; j < len; j++)
+		tail += abs(a[j] - b[j]);
+	return tail;
+}
+
+static __attribute__((target("sse2"))) void plc_ola_fill_sse2(const float pitchbuf[], const float gains[], int16_t amp[], int len)
+{
+	int j = 0;
+
+	for (; j + 4 <= len; j += 4) {
+		__m128i q = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&pitchbuf[j]),
+			_mm_loadu_ps(&gains[j])));
+
+		_mm_storel_epi64((__m128i *) &amp[j], _mm_packs_epi32(q, q));
+	}
+	for (; j < len; j++)
+		amp[j] = pitchbuf[j]*gains[j];
+}
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+#define PLC_HAVE_NEON_KERNELS 1
+
+#include <arm_neon.h>
+
+static int plc_amdf_acc_neon(const int16_t a[], const int16_t b[], int len)
+{
+	int32x4_t acc = vdupq_n_s32(0);
+	int32x2_t d;
+	int j = 0;
+	int tail;
+
+	for (; j + 8 <= len; j += 8) {
+		int16x8_t x = vld1q_s16(&a[j]);
+		int16x8_t y = vld1q_s16(&b[j]);
+
+		acc = vabal_s16(acc, vget_low_s16(x), vget_low_s16(y));
+		acc = vabal_s16(acc, vget_high_s16(x), vget_high_s16(y));
+	}
+	d = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	d = vpadd_s32(d, d);
+	tail = vget_lane_s32(d, 0);
+	for (; j < len; j++)
+		tail += abs(a[j] - b[j]);
+	return tail;
+}
+
+static void plc_ola_fill_neon(const float pitchbuf[], const float gains[], int16_t amp[], int len)
+{
+	int j = 0;
+
+	for (; j + 4 <= len; j += 4) {
+		int32x4_t q = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&pitchbuf[j]),
+			vld1q_f32(&gains[j])));
+
+		vst1_s16(&amp[j], vqmovn_s32(q));
+	}
+	for (; j < len; j++)
+		amp[j] = pitchbuf[j]*gains[j];
+}
+
+#endif
+
+/*! \brief Kernel used for the AMDF inner accumulation */
+static plc_amdf_acc_fn plc_amdf_acc;
+
+/*! \brief Kernel used for the decaying pitch cycle fill */
+static plc_ola_fill_fn plc_ola_fill;
+
+/*!
+ * \internal
+ * \brief Select the PLC kernels the running CPU supports.
+ *
+ * \note Idempotent, so the unsynchronized first-use race is harmless.
+ */
+static void plc_select_kernels(void)
+{
+	plc_amdf_acc_fn amdf = plc_amdf_acc_scalar;
+	plc_ola_fill_fn fill = plc_ola_fill_scalar;
+
+#if defined(PLC_HAVE_X86_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		amdf = plc_amdf_acc_sse2;
+		fill = plc_ola_fill_sse2;
+	}
+#elif defined(PLC_HAVE_NEON_KERNELS)
+	amdf = plc_amdf_acc_neon;
+	fill = plc_ola_fill_neon;
+#endif
+
+	plc_ola_fill = fill;
+	plc_amdf_acc = amdf;
+}
+
 static inline int16_t fsaturate(double damp)
 {
 	if (damp > 32767.0)
@@ -106,7 +272,6 @@ static void normalise_history(plc_state_t *s)
 static int __inline__ amdf_pitch(int min_pitch, int max_pitch, int16_t amp[], int len)
 {
 	int i;
-	int j;
 	int acc;
 	int min_acc;
 	int pitch;
@@ -114,9 +279,7 @@ static int __inline__ amdf_pitch(int min_pitch, int max_pitch, int16_t amp[], in
 	pitch = min_pitch;
 	min_acc = INT_MAX;
 	for (i = max_pitch; i <= min_pitch; i++) {
-		acc = 0;
-		for (j = 0; j < len; j++)
-			acc += abs(amp[i + j] - amp[j]);
+		acc = plc_amdf_acc(amp + i, amp, len);
 		if (acc < min_acc) {
 			min_acc = acc;
 			pitch = i;
@@ -186,7 +349,14 @@ int plc_fillin(plc_state_t *s, int16_t amp[], int len)
 		/* As the gap in real speech starts we need to assess the last known pitch,
 		and prepare the synthetic data we will use for fill-in */
 		normalise_history(s);
-		s->pitch = amdf_pitch(PLC_PITCH_MIN, PLC_PITCH_MAX, s->history + PLC_HISTORY_LEN - CORRELATION_SPAN - PLC_PITCH_MIN, CORRELATION_SPAN);
+		if (ast_atomic_fetchadd_int(&pitch_searches_in_flight, +1) < PLC_MAX_CONCURRENT_PITCH_SEARCHES) {
+			s->pitch = amdf_pitch(PLC_PITCH_MIN, PLC_PITCH_MAX, s->history + PLC_HISTORY_LEN - CORRELATION_SPAN - PLC_PITCH_MIN, CORRELATION_SPAN);
+		} else if (!s->pitch) {
+			/* Too many searches running - settle for a coarse estimate */
+			s->pitch = amdf_pitch(PLC_PITCH_MIN, PLC_PITCH_MAX, s->history + PLC_HISTORY_LEN - CORRELATION_SPAN_COARSE - PLC_PITCH_MIN, CORRELATION_SPAN_COARSE);
+		}
+		/* else: reuse the pitch estimate from the previous erasure */
+		ast_atomic_fetchadd_int(&pitch_searches_in_flight, -1);
 		/* We overlap a 1/4 wavelength */
 		pitch_overlap = s->pitch >> 2;
 		/* Cook up a single cycle of pitch, using a single of the real signal with 1/4
@@ -224,10 +394,26 @@ int plc_fillin(plc_state_t *s, int16_t amp[], int len)
 		gain = 1.0 - s->missing_samples*ATTENUATION_INCREMENT;
 		i = 0;
 	}
-	for ( ; gain > 0.0 && i < len; i++) {
-		amp[i] = s->pitchbuf[s->pitch_offset] * gain;
-		gain -= ATTENUATION_INCREMENT;
-		if (++s->pitch_offset >= s->pitch)
+	/* Fill one contiguous run of the pitch cycle at a time.  The gain
+	   ramp is stepped serially first, exactly as the old per-sample
+	   update did, so the vectorized multiply produces identical
+	   output. */
+	while (gain > 0.0 && i < len) {
+		float gains[PLC_PITCH_MIN];
+		int run;
+		int k;
+
+		run = len - i;
+		if (run > s->pitch - s->pitch_offset)
+			run = s->pitch - s->pitch_offset;
+		for (k = 0; k < run && gain > 0.0; k++) {
+			gains[k] = gain;
+			gain -= ATTENUATION_INCREMENT;
+		}
+		plc_ola_fill(&s->pitchbuf[s->pitch_offset], gains, &amp[i], k);
+		i += k;
+		s->pitch_offset += k;
+		if (s->pitch_offset >= s->pitch)
 			s->pitch_offset = 0;
 	}
 	for ( ; i < len; i++)
@@ -241,6 +427,8 @@ int plc_fillin(plc_state_t *s, int16_t amp[], int len)
 
 plc_state_t *plc_init(plc_state_t *s)
 {
+	if (!plc_amdf_acc)
+		plc_select_kernels();
 	memset(s, 0, sizeof(*s));
 	return s;
 }
@@ -602,6 +602,8 @@ int ast_rtp_codecs_payloads_initialize(struct ast_rtp_codecs *codecs)
 	int res;
 
 	codecs->framing = 0;
+	codecs->payload_code_rx_cache = -1;
+	codecs->payload_code_tx_cache = -1;
 	ast_rwlock_init(&codecs->codecs_lock);
 	res = AST_VECTOR_INIT(&codecs->payload_mapping_rx, AST_RTP_MAX_PT);
 	res |= AST_VECTOR_INIT(&codecs->payload_mapping_tx, AST_RTP_MAX_PT);
@@ -1379,44 +1381,83 @@ static int rtp_codecs_assign_payload_code_rx(struct ast_rtp_codecs *codecs, int
 	return payload;
 }
 
-int ast_rtp_codecs_payload_code(struct ast_rtp_codecs *codecs, int asterisk_format, struct ast_format *format, int code)
+/*!
+ * \internal
+ * \brief Test if a payload mapping entry describes the given format or code.
+ *
+ * \param type Mapping entry to test.
+ * \param asterisk_format Non-zero if the given Asterisk format is present
+ * \param format Asterisk format to look for
+ * \param code The format to look for
+ * \param primary_only Non-zero to accept only primary mappings.
+ *
+ * \retval 0 if not matched.
+ * \retval 1 if matched.
+ */
+static int payload_mapping_code_matches(struct ast_rtp_payload_type *type,
+	int asterisk_format, const struct ast_format *format, int code, int primary_only)
+{
+	if (primary_only && !type->primary_mapping) {
+		return 0;
+	}
+	if (!asterisk_format) {
+		return !type->asterisk_format && type->rtp_code == code;
+	}
+	return type->asterisk_format
+		&& ast_format_cmp(format, type->format) == AST_FORMAT_CMP_EQUAL;
+}
+
+/*!
+ * \internal
+ * \brief Look up a payload by format/code in a payload mapping vector.
+ *
+ * \note It is assumed that codecs is at least read locked before calling.
+ *
+ * The cached index of the previous successful lookup is probed first and
+ * re-validated against the current mapping, which keeps repeated lookups
+ * for the same stream (one per forwarded packet on the bridged path) from
+ * rescanning the vector.  The cache is a hint written under the read lock;
+ * a torn or stale value merely fails validation and falls back to the scan.
+ *
+ * \retval Numerical payload type
+ * \retval -1 if not found.
+ */
+static int payload_mapping_code_find(struct ast_rtp_codecs *codecs,
+	struct ast_rtp_payload_type_vector *mapping, int *cache,
+	int asterisk_format, const struct ast_format *format, int code, int primary_only)
 {
 	struct ast_rtp_payload_type *type;
 	int idx;
-	int payload = -1;
-
-	ast_rwlock_rdlock(&static_RTP_PT_lock);
-	if (!asterisk_format) {
-		ast_rwlock_rdlock(&codecs->codecs_lock);
-		for (idx = 0; idx < AST_VECTOR_SIZE(&codecs->payload_mapping_rx); ++idx) {
-			type = AST_VECTOR_GET(&codecs->payload_mapping_rx, idx);
-			if (!type) {
-				continue;
-			}
 
-			if (!type->asterisk_format
-				&& type->primary_mapping
-				&& type->rtp_code == code) {
-				payload = idx;
-				break;
-			}
+	idx = *cache;
+	if (0 <= idx && idx < AST_VECTOR_SIZE(mapping)) {
+		type = AST_VECTOR_GET(mapping, idx);
+		if (type && payload_mapping_code_matches(type, asterisk_format, format, code,
+			primary_only)) {
+			return idx;
 		}
-		ast_rwlock_unlock(&codecs->codecs_lock);
-	} else if (format) {
-		ast_rwlock_rdlock(&codecs->codecs_lock);
-		for (idx = 0; idx < AST_VECTOR_SIZE(&codecs->payload_mapping_rx); ++idx) {
-			type = AST_VECTOR_GET(&codecs->payload_mapping_rx, idx);
-			if (!type) {
-				continue;
-			}
+	}
 
-			if (type->asterisk_format
-				&& type->primary_mapping
-				&& ast_format_cmp(format, type->format) == AST_FORMAT_CMP_EQUAL) {
-				payload = idx;
-				break;
-			}
+	for (idx = 0; idx < AST_VECTOR_SIZE(mapping); ++idx) {
+		type = AST_VECTOR_GET(mapping, idx);
+		if (type && payload_mapping_code_matches(type, asterisk_format, format, code,
+			primary_only)) {
+			*cache = idx;
+			return idx;
 		}
+	}
+	return -1;
+}
+
+int ast_rtp_codecs_payload_code(struct ast_rtp_codecs *codecs, int asterisk_format, struct ast_format *format, int code)
+{
+	int payload = -1;
+
+	ast_rwlock_rdlock(&static_RTP_PT_lock);
+	if (!asterisk_format || format) {
+		ast_rwlock_rdlock(&codecs->codecs_lock);
+		payload = payload_mapping_code_find(codecs, &codecs->payload_mapping_rx,
+			&codecs->payload_code_rx_cache, asterisk_format, format, code, 1);
 		ast_rwlock_unlock(&codecs->codecs_lock);
 	}
 
@@ -1431,39 +1472,12 @@ int ast_rtp_codecs_payload_code(struct ast_rtp_codecs *codecs, int asterisk_form
 
 int ast_rtp_codecs_payload_code_tx(struct ast_rtp_codecs *codecs, int asterisk_format, const struct ast_format *format, int code)
 {
-	struct ast_rtp_payload_type *type;
-	int idx;
 	int payload = -1;
 
-	if (!asterisk_format) {
-		ast_rwlock_rdlock(&codecs->codecs_lock);
-		for (idx = 0; idx < AST_VECTOR_SIZE(&codecs->payload_mapping_tx); ++idx) {
-			type = AST_VECTOR_GET(&codecs->payload_mapping_tx, idx);
-			if (!type) {
-				continue;
-			}
-
-			if (!type->asterisk_format
-				&& type->rtp_code == code) {
-				payload = idx;
-				break;
-			}
-		}
-		ast_rwlock_unlock(&codecs->codecs_lock);
-	} else if (format) {
+	if (!asterisk_format || format) {
 		ast_rwlock_rdlock(&codecs->codecs_lock);
-		for (idx = 0; idx < AST_VECTOR_SIZE(&codecs->payload_mapping_tx); ++idx) {
-			type = AST_VECTOR_GET(&codecs->payload_mapping_tx, idx);
-			if (!type) {
-				continue;
-			}
-
-			if (type->asterisk_format
-				&& ast_format_cmp(format, type->format) == AST_FORMAT_CMP_EQUAL) {
-				payload = idx;
-				break;
-			}
-		}
+		payload = payload_mapping_code_find(codecs, &codecs->payload_mapping_tx,
+			&codecs->payload_code_tx_cache, asterisk_format, format, code, 0);
 		ast_rwlock_unlock(&codecs->codecs_lock);
 	}
 
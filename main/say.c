@@ -50,6 +50,7 @@
 #include "asterisk/channel.h"
 #include "asterisk/say.h"
 #include "asterisk/lock.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/localtime.h"
 #include "asterisk/utils.h"
 #include "asterisk/app.h"
@@ -558,17 +559,84 @@ static int say_number_full(struct ast_channel *chan, int num, const char *ints,
 	return ast_say_number_full_en(chan, num, ints, language, audiofd, ctrlfd);
 }
 
-/*! \brief  ast_say_number_full_en: English syntax
-	\note This is the default syntax, if no other syntax defined in this file is used */
-static int ast_say_number_full_en(struct ast_channel *chan, int num, const char *ints, const char *language, int audiofd, int ctrlfd)
+/*! \brief number of buckets for the number prompt plan cache */
+#define SAY_NUM_PLAN_BUCKETS 53
+
+/*! \brief maximum number of cached number prompt plans */
+#define SAY_NUM_PLAN_ENTRIES 512
+
+/*! \brief maximum files in a number prompt plan, enough for any 32 bit number */
+#define SAY_NUM_PLAN_FILES 16
+
+/*! \brief maximum length of a file name in a number prompt plan */
+#define SAY_NUM_PLAN_FILE_LEN 16
+
+/*! \brief cached prompt file sequence for a spoken number */
+struct say_number_plan {
+	/*! \brief the number the plan speaks */
+	int num;
+	/*! \brief last time the plan was used, for LRU eviction */
+	struct timeval when;
+	/*! \brief number of prompt files in the plan */
+	int file_count;
+	/*! \brief prompt files, in playback order */
+	char files[SAY_NUM_PLAN_FILES][SAY_NUM_PLAN_FILE_LEN];
+};
+
+/*! \brief cache of prompt plans for the default (English) number syntax */
+static struct ao2_container *say_number_plans;
+AST_MUTEX_DEFINE_STATIC(say_number_plans_lock);
+
+static int say_number_plan_hash(const void *obj, const int flags)
+{
+	return (flags & OBJ_KEY) ? *(const int *) obj : ((const struct say_number_plan *) obj)->num;
+}
+
+static int say_number_plan_cmp(void *obj, void *arg, int flags)
+{
+	struct say_number_plan *plan = obj;
+	int num = (flags & OBJ_KEY) ? *(int *) arg : ((struct say_number_plan *) arg)->num;
+
+	return (plan->num == num) ? CMP_MATCH | CMP_STOP : 0;
+}
+
+static void say_number_plans_shutdown(void)
+{
+	ao2_cleanup(say_number_plans);
+	say_number_plans = NULL;
+}
+
+/*! \brief Get the plan cache container, creating it on first use. */
+static struct ao2_container *say_number_plans_get(void)
+{
+	ast_mutex_lock(&say_number_plans_lock);
+	if (!say_number_plans) {
+		say_number_plans = ao2_container_alloc(SAY_NUM_PLAN_BUCKETS, say_number_plan_hash, say_number_plan_cmp);
+		if (say_number_plans) {
+			ast_register_cleanup(say_number_plans_shutdown);
+		}
+	}
+	ast_mutex_unlock(&say_number_plans_lock);
+	return say_number_plans;
+}
+
+static int say_number_plan_append(struct say_number_plan *plan, const char *fn)
+{
+	if (plan->file_count == ARRAY_LEN(plan->files)) {
+		return -1;
+	}
+	ast_copy_string(plan->files[plan->file_count], fn, sizeof(plan->files[0]));
+	plan->file_count++;
+	return 0;
+}
+
+/*! \brief Build the prompt file sequence for \a num using the English syntax. */
+static int say_number_plan_build_en(struct say_number_plan *plan, int num)
 {
-	int res = 0;
 	int playh = 0;
 	char fn[256] = "";
-	if (!num)
-		return ast_say_digits_full(chan, 0, ints, language, audiofd, ctrlfd);
 
-	while (!res && (num || playh)) {
+	while (num || playh) {
 		if (num < 0) {
 			ast_copy_string(fn, "digits/minus", sizeof(fn));
 			if ( num > INT_MIN ) {
@@ -585,42 +653,129 @@ static int ast_say_number_full_en(struct ast_channel *chan, int num, const char
 		} else	if (num < 100) {
 			snprintf(fn, sizeof(fn), "digits/%d", (num /10) * 10);
 			num %= 10;
-		} else {
-			if (num < 1000){
-				snprintf(fn, sizeof(fn), "digits/%d", (num/100));
-				playh++;
-				num %= 100;
-			} else {
-				if (num < 1000000) { /* 1,000,000 */
-					res = ast_say_number_full_en(chan, num / 1000, ints, language, audiofd, ctrlfd);
-					if (res)
-						return res;
-					num %= 1000;
-					snprintf(fn, sizeof(fn), "digits/thousand");
-				} else {
-					if (num < 1000000000) {	/* 1,000,000,000 */
-						res = ast_say_number_full_en(chan, num / 1000000, ints, language, audiofd, ctrlfd);
-						if (res)
-							return res;
-						num %= 1000000;
-						ast_copy_string(fn, "digits/million", sizeof(fn));
-					} else {
-						ast_debug(1, "Number '%d' is too big for me\n", num);
-						res = -1;
-					}
-				}
+		} else if (num < 1000) {
+			snprintf(fn, sizeof(fn), "digits/%d", (num/100));
+			playh++;
+			num %= 100;
+		} else if (num < 1000000) { /* 1,000,000 */
+			if (say_number_plan_build_en(plan, num / 1000)) {
+				return -1;
 			}
-		}
-		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
-				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
-				else
-					res = ast_waitstream(chan, ints);
+			num %= 1000;
+			snprintf(fn, sizeof(fn), "digits/thousand");
+		} else if (num < 1000000000) {	/* 1,000,000,000 */
+			if (say_number_plan_build_en(plan, num / 1000000)) {
+				return -1;
 			}
-			ast_stopstream(chan);
+			num %= 1000000;
+			ast_copy_string(fn, "digits/million", sizeof(fn));
+		} else {
+			ast_debug(1, "Number '%d' is too big for me\n", num);
+			return -1;
+		}
+		if (say_number_plan_append(plan, fn)) {
+			return -1;
 		}
 	}
+	return 0;
+}
+
+static int say_number_plan_oldest_cb(void *obj, void *arg, int flags)
+{
+	struct say_number_plan *plan = obj;
+	struct say_number_plan **oldest = arg;
+
+	if (!*oldest || ast_tvcmp(plan->when, (*oldest)->when) < 0) {
+		*oldest = plan;
+	}
+	return 0;
+}
+
+/*! \brief Find the cached plan for \a num, refreshing its LRU position. */
+static struct say_number_plan *say_number_plan_find(int num)
+{
+	struct ao2_container *plans = say_number_plans_get();
+	struct say_number_plan *plan;
+
+	if (!plans) {
+		return NULL;
+	}
+
+	ao2_lock(plans);
+	if ((plan = ao2_find(plans, &num, OBJ_KEY | OBJ_NOLOCK))) {
+		plan->when = ast_tvnow();
+	}
+	ao2_unlock(plans);
+
+	return plan;
+}
+
+/*! \brief Cache a built plan, evicting the least recently used entry if full. */
+static void say_number_plan_cache(const struct say_number_plan *plan)
+{
+	struct ao2_container *plans = say_number_plans_get();
+	struct say_number_plan *entry;
+
+	if (!plans) {
+		return;
+	}
+
+	if (!(entry = ao2_alloc(sizeof(*entry), NULL))) {
+		return;
+	}
+	*entry = *plan;
+	entry->when = ast_tvnow();
+
+	ao2_lock(plans);
+	if (ao2_container_count(plans) >= SAY_NUM_PLAN_ENTRIES) {
+		struct say_number_plan *oldest = NULL;
+
+		ao2_callback(plans, OBJ_NOLOCK | OBJ_NODATA, say_number_plan_oldest_cb, &oldest);
+		if (oldest) {
+			ao2_unlink_flags(plans, oldest, OBJ_NOLOCK);
+		}
+	}
+	ao2_link_flags(plans, entry, OBJ_NOLOCK);
+	ao2_unlock(plans);
+
+	ao2_ref(entry, -1);
+}
+
+/*! \brief  ast_say_number_full_en: English syntax
+	\note This is the default syntax, if no other syntax defined in this file is used
+
+	The prompt file sequence only depends on the number, so sequences are
+	cached and the whole sequence is handed to the batch streaming API,
+	which resolves every file before playback starts. */
+static int ast_say_number_full_en(struct ast_channel *chan, int num, const char *ints, const char *language, int audiofd, int ctrlfd)
+{
+	struct say_number_plan built;
+	struct say_number_plan *plan;
+	const char *files[SAY_NUM_PLAN_FILES];
+	int i;
+	int res;
+
+	if (!num)
+		return ast_say_digits_full(chan, 0, ints, language, audiofd, ctrlfd);
+
+	if (!(plan = say_number_plan_find(num))) {
+		memset(&built, 0, sizeof(built));
+		built.num = num;
+		if (say_number_plan_build_en(&built, num)) {
+			return -1;
+		}
+		say_number_plan_cache(&built);
+		plan = &built;
+	}
+
+	for (i = 0; i < plan->file_count; i++) {
+		files[i] = plan->files[i];
+	}
+	res = ast_stream_and_wait_files(chan, files, plan->file_count, language, ints, audiofd, ctrlfd);
+
+	if (plan != &built) {
+		ao2_ref(plan, -1);
+	}
 	return res;
 }
 
@@ -46,6 +46,7 @@
 #include "asterisk/lock.h"
 #include "asterisk/utils.h"
 #include "asterisk/heap.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/threadstorage.h"
 
 /*!
@@ -76,8 +77,14 @@ struct sched_id {
 	AST_LIST_ENTRY(sched_id) list;
 };
 
+struct sched_wheel_slot;
+
 struct sched {
 	AST_LIST_ENTRY(sched) list;
+	/*! Links in a timing-wheel slot if the context uses a wheel. */
+	AST_DLLIST_ENTRY(sched) wheel_links;
+	/*! Wheel slot currently holding this entry.  NULL if not queued. */
+	struct sched_wheel_slot *wheel_slot;
 	/*! The ID that has been popped off the scheduler context's queue */
 	struct sched_id *sched_id;
 	struct timeval when;          /*!< Absolute time event should take place */
@@ -109,6 +116,39 @@ struct sched_thread {
 	unsigned int stop:1;
 };
 
+/*! Number of index bits per timing-wheel level. */
+#define WHEEL_BITS	8
+/*! Number of slots in each timing-wheel level. */
+#define WHEEL_SLOTS	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SLOTS - 1)
+/*! Number of wheel levels.  Four levels at 1ms ticks cover ~49 days. */
+#define WHEEL_LEVELS	4
+
+/*! A slot of the hierarchical timing wheel. */
+struct sched_wheel_slot {
+	AST_DLLIST_HEAD_NOLOCK(, sched) list;
+};
+
+/*!
+ * \brief Hierarchical timing-wheel queue backend.
+ *
+ * \details Level 0 resolves single 1ms ticks; each higher level
+ * covers WHEEL_SLOTS times the span of the one below it.  Entries
+ * on higher levels cascade down a level whenever the level below
+ * wraps.  Insert and delete are O(1), which is what matters for
+ * the RTP/SIP/IAX2 retransmit style timers that are nearly always
+ * cancelled before they fire.
+ */
+struct sched_wheel {
+	/*! Time from which wheel ticks are counted. */
+	struct timeval epoch;
+	/*! Absolute tick (ms since epoch) of the level 0 cursor. */
+	int64_t ticks;
+	/*! Number of entries queued on the wheel. */
+	size_t count;
+	struct sched_wheel_slot slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
 struct ast_sched_context {
 	ast_mutex_t lock;
 	unsigned int eventcnt;                  /*!< Number of events processed */
@@ -116,6 +156,8 @@ struct ast_sched_context {
 	/*! Next tie breaker in case events expire at the same time. */
 	unsigned int tie_breaker;
 	struct ast_heap *sched_heap;
+	/*! Timing-wheel queue.  NULL when the context uses the heap. */
+	struct sched_wheel *wheel;
 	struct sched_thread *sched_thread;
 	/*! The scheduled task that is currently executing */
 	struct sched *currently_executing;
@@ -130,6 +172,219 @@ struct ast_sched_context {
 	int id_queue_size;
 };
 
+/*!
+ * \internal
+ * \brief Absolute wheel tick (ms since the wheel epoch) of a time.
+ */
+static int64_t wheel_abs_tick(const struct sched_wheel *wheel, struct timeval when)
+{
+	return ast_tvdiff_ms(when, wheel->epoch);
+}
+
+/*!
+ * \internal
+ * \brief Queue an entry on the wheel level covering its expiration delta.
+ */
+static void wheel_insert(struct sched_wheel *wheel, struct sched *s)
+{
+	int64_t tick = wheel_abs_tick(wheel, s->when);
+	int64_t delta;
+	int level;
+	struct sched_wheel_slot *slot;
+
+	if (tick < wheel->ticks) {
+		/* Already due.  Park it on the current cursor slot. */
+		tick = wheel->ticks;
+	}
+	delta = tick - wheel->ticks;
+	for (level = 0; level < WHEEL_LEVELS - 1; ++level) {
+		if (delta < ((int64_t) 1 << (WHEEL_BITS * (level + 1)))) {
+			break;
+		}
+	}
+
+	slot = &wheel->slots[level][(tick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	AST_DLLIST_INSERT_TAIL(&slot->list, s, wheel_links);
+	s->wheel_slot = slot;
+	++wheel->count;
+}
+
+/*!
+ * \internal
+ * \brief Remove an entry from the wheel if it is queued.
+ */
+static void wheel_remove(struct sched_wheel *wheel, struct sched *s)
+{
+	if (!s->wheel_slot) {
+		return;
+	}
+	AST_DLLIST_REMOVE(&s->wheel_slot->list, s, wheel_links);
+	s->wheel_slot = NULL;
+	--wheel->count;
+}
+
+/*!
+ * \internal
+ * \brief Cascade higher wheel levels down after a level wrap.
+ *
+ * \note Called with wheel->ticks a multiple of WHEEL_SLOTS.
+ */
+static void wheel_cascade(struct sched_wheel *wheel)
+{
+	int level;
+
+	for (level = 1; level < WHEEL_LEVELS; ++level) {
+		int idx = (wheel->ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+		struct sched_wheel_slot *slot = &wheel->slots[level][idx];
+		struct sched *s;
+
+		while ((s = AST_DLLIST_REMOVE_HEAD(&slot->list, wheel_links))) {
+			s->wheel_slot = NULL;
+			--wheel->count;
+			wheel_insert(wheel, s);
+		}
+		if (idx) {
+			break;
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Pop the next entry due at or before the target tick.
+ *
+ * \details Advances the wheel cursor toward the target, cascading
+ * higher levels as lower levels wrap.
+ *
+ * \retval entry-ptr of a due entry, dequeued from the wheel.
+ * \retval NULL when nothing (more) is due.
+ */
+static struct sched *wheel_pop_due(struct sched_wheel *wheel, int64_t target)
+{
+	for (;;) {
+		struct sched_wheel_slot *slot = &wheel->slots[0][wheel->ticks & WHEEL_MASK];
+		struct sched *s = AST_DLLIST_REMOVE_HEAD(&slot->list, wheel_links);
+
+		if (s) {
+			s->wheel_slot = NULL;
+			--wheel->count;
+			return s;
+		}
+		if (wheel->ticks >= target) {
+			return NULL;
+		}
+		if (!wheel->count) {
+			/* Nothing queued anywhere; jump the cursor forward. */
+			wheel->ticks = target;
+			return NULL;
+		}
+		++wheel->ticks;
+		if (!(wheel->ticks & WHEEL_MASK)) {
+			wheel_cascade(wheel);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Earliest tick at which a queued entry could be due.
+ *
+ * \details Exact for entries on level 0; for higher levels the
+ * containing slot's lower boundary is returned, which is never
+ * later than any entry in it.  A runq at that time cascades the
+ * slot down and the next wait is then exact.
+ *
+ * \retval earliest tick.
+ * \retval -1 if the wheel is empty.
+ */
+static int64_t wheel_next_tick(const struct sched_wheel *wheel)
+{
+	int level;
+	int off;
+
+	if (!wheel->count) {
+		return -1;
+	}
+	for (off = 0; off < WHEEL_SLOTS; ++off) {
+		int64_t tick = wheel->ticks + off;
+
+		if (!AST_DLLIST_EMPTY(&wheel->slots[0][tick & WHEEL_MASK].list)) {
+			return tick;
+		}
+	}
+	for (level = 1; level < WHEEL_LEVELS; ++level) {
+		int64_t cur = wheel->ticks >> (WHEEL_BITS * level);
+
+		/* Offset WHEEL_SLOTS is the cursor's own slot: a delta just
+		 * under a full level period aliases onto it, due one period
+		 * from now, so its boundary lies ahead, not behind. */
+		for (off = 1; off <= WHEEL_SLOTS; ++off) {
+			if (!AST_DLLIST_EMPTY(&wheel->slots[level][(cur + off) & WHEEL_MASK].list)) {
+				return (cur + off) << (WHEEL_BITS * level);
+			}
+		}
+	}
+	/* Unreachable while count is accurate. */
+	return wheel->ticks;
+}
+
+/*!
+ * \internal
+ * \brief Number of entries queued on the context.
+ */
+static size_t sched_queue_size(const struct ast_sched_context *con)
+{
+	return con->wheel ? con->wheel->count : ast_heap_size(con->sched_heap);
+}
+
+/*! State to walk all queued entries of a context regardless of backend. */
+struct sched_qiter {
+	/*! Next heap index to visit.  (Heap backend.) */
+	size_t heap_idx;
+	/*! Wheel level of cur.  (Wheel backend.) */
+	int level;
+	/*! Wheel slot of cur.  (Wheel backend.) */
+	int slot;
+	/*! Last entry returned.  NULL before the first call. */
+	struct sched *cur;
+};
+
+/*!
+ * \internal
+ * \brief Visit the next queued entry of the context.
+ *
+ * \details Iterate from a zero-initialized sched_qiter.  The
+ * context must stay locked and unmodified for the whole walk.
+ *
+ * \retval entry-ptr of the next queued entry.
+ * \retval NULL when all entries have been visited.
+ */
+static struct sched *sched_qiter_next(struct ast_sched_context *con, struct sched_qiter *iter)
+{
+	if (!con->wheel) {
+		iter->cur = ast_heap_peek(con->sched_heap, ++iter->heap_idx);
+		return iter->cur;
+	}
+
+	if (iter->cur) {
+		iter->cur = AST_DLLIST_NEXT(iter->cur, wheel_links);
+		if (iter->cur) {
+			return iter->cur;
+		}
+		++iter->slot;
+	}
+	for (; iter->level < WHEEL_LEVELS; ++iter->level, iter->slot = 0) {
+		for (; iter->slot < WHEEL_SLOTS; ++iter->slot) {
+			iter->cur = AST_DLLIST_FIRST(
+				&con->wheel->slots[iter->level][iter->slot].list);
+			if (iter->cur) {
+				return iter->cur;
+			}
+		}
+	}
+	return NULL;
+}
+
 static void *sched_run(void *data)
 {
 	struct ast_sched_context *con = data;
@@ -234,7 +489,7 @@ static int sched_time_cmp(void *va, void *vb)
 	return cmp;
 }
 
-struct ast_sched_context *ast_sched_context_create(void)
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend)
 {
 	struct ast_sched_context *tmp;
 
@@ -247,7 +502,13 @@ struct ast_sched_context *ast_sched_context_create(void)
 
 	AST_LIST_HEAD_INIT_NOLOCK(&tmp->id_queue);
 
-	if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
+	if (backend == AST_SCHED_BACKEND_WHEEL) {
+		if (!(tmp->wheel = ast_calloc(1, sizeof(*tmp->wheel)))) {
+			ast_sched_context_destroy(tmp);
+			return NULL;
+		}
+		tmp->wheel->epoch = ast_tvnow();
+	} else if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
 			offsetof(struct sched, __heap_index)))) {
 		ast_sched_context_destroy(tmp);
 		return NULL;
@@ -256,6 +517,11 @@ struct ast_sched_context *ast_sched_context_create(void)
 	return tmp;
 }
 
+struct ast_sched_context *ast_sched_context_create(void)
+{
+	return ast_sched_context_create_backend(AST_SCHED_BACKEND_HEAP);
+}
+
 static void sched_free(struct sched *task)
 {
 	/* task->sched_id will be NULL most of the time, but when the
@@ -291,6 +557,19 @@ void ast_sched_context_destroy(struct ast_sched_context *con)
 		con->sched_heap = NULL;
 	}
 
+	if (con->wheel) {
+		struct sched_qiter iter = { 0, };
+
+		while ((s = sched_qiter_next(con, &iter))) {
+			wheel_remove(con->wheel, s);
+			sched_free(s);
+			/* The entry is gone; restart the walk from its slot. */
+			iter.cur = NULL;
+		}
+		ast_free(con->wheel);
+		con->wheel = NULL;
+	}
+
 	while ((sid = AST_LIST_REMOVE_HEAD(&con->id_queue, list))) {
 		ast_free(sid);
 	}
@@ -407,20 +686,38 @@ static struct sched *sched_alloc(struct ast_sched_context *con)
 
 void ast_sched_clean_by_callback(struct ast_sched_context *con, ast_sched_cb match, ast_sched_cb cleanup_cb)
 {
-	int i = 1;
 	struct sched *current;
 
 	ast_mutex_lock(&con->lock);
-	while ((current = ast_heap_peek(con->sched_heap, i))) {
-		if (current->callback != match) {
-			i++;
-			continue;
+	if (con->wheel) {
+		struct sched_qiter iter = { 0, };
+
+		while ((current = sched_qiter_next(con, &iter))) {
+			if (current->callback != match) {
+				continue;
+			}
+
+			wheel_remove(con->wheel, current);
+
+			cleanup_cb(current->data);
+			sched_release(con, current);
+			/* The entry is gone; restart the walk from its slot. */
+			iter.cur = NULL;
 		}
+	} else {
+		int i = 1;
 
-		ast_heap_remove(con->sched_heap, current);
+		while ((current = ast_heap_peek(con->sched_heap, i))) {
+			if (current->callback != match) {
+				i++;
+				continue;
+			}
 
-		cleanup_cb(current->data);
-		sched_release(con, current);
+			ast_heap_remove(con->sched_heap, current);
+
+			cleanup_cb(current->data);
+			sched_release(con, current);
+		}
 	}
 	ast_mutex_unlock(&con->lock);
 }
@@ -437,7 +734,17 @@ int ast_sched_wait(struct ast_sched_context *con)
 	DEBUG(ast_debug(1, "ast_sched_wait()\n"));
 
 	ast_mutex_lock(&con->lock);
-	if ((s = ast_heap_peek(con->sched_heap, 1))) {
+	if (con->wheel) {
+		int64_t tick = wheel_next_tick(con->wheel);
+
+		if (tick < 0) {
+			ms = -1;
+		} else {
+			int64_t diff = tick - wheel_abs_tick(con->wheel, ast_tvnow());
+
+			ms = diff < 0 ? 0 : (diff > INT_MAX ? INT_MAX : diff);
+		}
+	} else if ((s = ast_heap_peek(con->sched_heap, 1))) {
 		ms = ast_tvdiff_ms(s->when, ast_tvnow());
 		if (ms < 0) {
 			ms = 0;
@@ -460,13 +767,19 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 {
 	size_t size;
 
-	size = ast_heap_size(con->sched_heap);
+	size = sched_queue_size(con);
 
-	/* Record the largest the scheduler heap became for reporting purposes. */
+	/* Record the largest the scheduler queue became for reporting purposes. */
 	if (con->highwater <= size) {
 		con->highwater = size + 1;
 	}
 
+	if (con->wheel) {
+		/* Wheel slots are FIFO so ties break on insertion order. */
+		wheel_insert(con->wheel, s);
+		return;
+	}
+
 	/* Determine the tie breaker value for the new entry. */
 	if (size) {
 		++con->tie_breaker;
@@ -574,13 +887,10 @@ int ast_sched_add(struct ast_sched_context *con, int when, ast_sched_cb callback
 
 static struct sched *sched_find(struct ast_sched_context *con, int id)
 {
-	int x;
-	size_t heap_size;
-
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		struct sched *cur = ast_heap_peek(con->sched_heap, x);
+	struct sched_qiter iter = { 0, };
+	struct sched *cur;
 
+	while ((cur = sched_qiter_next(con, &iter))) {
 		if (cur->sched_id->id == id) {
 			return cur;
 		}
@@ -631,7 +941,9 @@ int _ast_sched_del(struct ast_sched_context *con, int id, const char *file, int
 
 	s = sched_find(con, id);
 	if (s) {
-		if (!ast_heap_remove(con->sched_heap, s)) {
+		if (con->wheel) {
+			wheel_remove(con->wheel, s);
+		} else if (!ast_heap_remove(con->sched_heap, s)) {
 			ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
 		}
 		sched_release(con, s);
@@ -672,19 +984,17 @@ int _ast_sched_del(struct ast_sched_context *con, int id, const char *file, int
 
 void ast_sched_report(struct ast_sched_context *con, struct ast_str **buf, struct ast_cb_names *cbnames)
 {
-	int i, x;
+	int i;
 	struct sched *cur;
+	struct sched_qiter iter = { 0, };
 	int countlist[cbnames->numassocs + 1];
-	size_t heap_size;
 
 	memset(countlist, 0, sizeof(countlist));
-	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, ast_heap_size(con->sched_heap));
+	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, sched_queue_size(con));
 
 	ast_mutex_lock(&con->lock);
 
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		cur = ast_heap_peek(con->sched_heap, x);
+	while ((cur = sched_qiter_next(con, &iter))) {
 		/* match the callback to the cblist */
 		for (i = 0; i < cbnames->numassocs; i++) {
 			if (cur->callback == cbnames->cblist[i]) {
@@ -712,22 +1022,19 @@ void ast_sched_dump(struct ast_sched_context *con)
 {
 	struct sched *q;
 	struct timeval when = ast_tvnow();
-	int x;
-	size_t heap_size;
+	struct sched_qiter iter = { 0, };
 #ifdef SCHED_MAX_CACHE
-	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n", ast_heap_size(con->sched_heap), con->eventcnt - 1, con->schedccnt, con->highwater);
+	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n", sched_queue_size(con), con->eventcnt - 1, con->schedccnt, con->highwater);
 #else
-	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n", ast_heap_size(con->sched_heap), con->eventcnt - 1, con->highwater);
+	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n", sched_queue_size(con), con->eventcnt - 1, con->highwater);
 #endif
 
 	ast_debug(1, "=============================================================\n");
 	ast_debug(1, "|ID    Callback          Data              Time  (sec:ms)   |\n");
 	ast_debug(1, "+-----+-----------------+-----------------+-----------------+\n");
 	ast_mutex_lock(&con->lock);
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
+	while ((q = sched_qiter_next(con, &iter))) {
 		struct timeval delta;
-		q = ast_heap_peek(con->sched_heap, x);
 		delta = ast_tvsub(q->when, when);
 		ast_debug(1, "|%.4d | %-15p | %-15p | %.6ld : %.6ld |\n",
 			q->sched_id->id,
@@ -740,6 +1047,28 @@ void ast_sched_dump(struct ast_sched_context *con)
 	ast_debug(1, "=============================================================\n");
 }
 
+/*!
+ * \internal
+ * \brief Dequeue the next entry expiring before the given time.
+ *
+ * \retval entry-ptr of a due entry, removed from the queue.
+ * \retval NULL when nothing (more) is due.
+ */
+static struct sched *sched_pop_due(struct ast_sched_context *con, struct timeval when)
+{
+	struct sched *current;
+
+	if (con->wheel) {
+		return wheel_pop_due(con->wheel, wheel_abs_tick(con->wheel, when) - 1);
+	}
+
+	current = ast_heap_peek(con->sched_heap, 1);
+	if (!current || ast_tvcmp(current->when, when) != -1) {
+		return NULL;
+	}
+	return ast_heap_pop(con->sched_heap);
+}
+
 /*! \brief
  * Launch all events which need to be run at this time.
  */
@@ -754,19 +1083,13 @@ int ast_sched_runq(struct ast_sched_context *con)
 
 	ast_mutex_lock(&con->lock);
 
+	/* schedule all events which are going to expire within 1ms.
+	 * We only care about millisecond accuracy anyway, so this will
+	 * help us get more than one event at one time if they are very
+	 * close together.
+	 */
 	when = ast_tvadd(ast_tvnow(), ast_tv(0, 1000));
-	for (numevents = 0; (current = ast_heap_peek(con->sched_heap, 1)); numevents++) {
-		/* schedule all events which are going to expire within 1ms.
-		 * We only care about millisecond accuracy anyway, so this will
-		 * help us get more than one event at one time if they are very
-		 * close together.
-		 */
-		if (ast_tvcmp(current->when, when) != -1) {
-			break;
-		}
-
-		current = ast_heap_pop(con->sched_heap);
-
+	for (numevents = 0; (current = sched_pop_due(con, when)); numevents++) {
 		/*
 		 * At this point, the schedule queue is still intact.  We
 		 * have removed the first event and the rest is still there,
@@ -34,19 +34,21 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/slinfactory.h"
 #include "asterisk/translate.h"
+#include "asterisk/utils.h"
 #include "asterisk/astobj2.h"
 
+/*! \brief Initial ring capacity in samples, enough for several 20ms frames at 8kHz */
+#define SLINFACTORY_INITIAL_RING_SIZE 1024
+
 void ast_slinfactory_init(struct ast_slinfactory *sf)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	sf->output_format = ao2_bump(ast_format_slin);
 }
 
 int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_format *slin_out)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	if (!ast_format_cache_is_slinear(slin_out)) {
 		return -1;
 	}
@@ -57,16 +59,14 @@ int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_form
 
 void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 {
-	struct ast_frame *f;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((f = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-		ast_frfree(f);
-	}
+	ast_free(sf->ring);
+	sf->ring = NULL;
+	sf->ring_size = sf->ring_head = sf->size = 0;
 
 	ao2_cleanup(sf->output_format);
 	sf->output_format = NULL;
@@ -74,10 +74,75 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 	sf->format = NULL;
 }
 
+/*!
+ * \internal
+ * \brief Ensure the ring can hold the currently queued samples plus \a samples more
+ *
+ * The ring is grown by doubling so its size remains a power of two, which lets
+ * all index arithmetic be simple masking. Queued samples are unwrapped to the
+ * front of the new ring while growing.
+ *
+ * \retval 0 success
+ * \retval -1 allocation failure
+ */
+static int slinfactory_ensure_space(struct ast_slinfactory *sf, unsigned int samples)
+{
+	unsigned int needed = sf->size + samples;
+	unsigned int new_size;
+	unsigned int head_to_end;
+	short *new_ring;
+
+	if (sf->ring && needed <= sf->ring_size) {
+		return 0;
+	}
+
+	new_size = sf->ring_size ? sf->ring_size : SLINFACTORY_INITIAL_RING_SIZE;
+	while (new_size < needed) {
+		new_size <<= 1;
+	}
+
+	if (!(new_ring = ast_malloc(new_size * sizeof(*new_ring)))) {
+		return -1;
+	}
+
+	if (sf->size) {
+		head_to_end = MIN(sf->size, sf->ring_size - sf->ring_head);
+		memcpy(new_ring, sf->ring + sf->ring_head, head_to_end * sizeof(*new_ring));
+		if (head_to_end < sf->size) {
+			memcpy(new_ring + head_to_end, sf->ring, (sf->size - head_to_end) * sizeof(*new_ring));
+		}
+	}
+
+	ast_free(sf->ring);
+	sf->ring = new_ring;
+	sf->ring_size = new_size;
+	sf->ring_head = 0;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Copy samples into the ring, wrapping at most once
+ * \pre The ring has space for the samples, see slinfactory_ensure_space()
+ */
+static void slinfactory_ring_write(struct ast_slinfactory *sf, const short *data, unsigned int samples)
+{
+	unsigned int tail = (sf->ring_head + sf->size) & (sf->ring_size - 1);
+	unsigned int chunk = MIN(samples, sf->ring_size - tail);
+
+	memcpy(sf->ring + tail, data, chunk * sizeof(*data));
+	if (chunk < samples) {
+		memcpy(sf->ring, data + chunk, (samples - chunk) * sizeof(*data));
+	}
+
+	sf->size += samples;
+}
+
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 {
-	struct ast_frame *begin_frame = f, *duped_frame = NULL, *frame_ptr;
-	unsigned int x = 0;
+	struct ast_frame *begin_frame = f, *frame_ptr;
+	unsigned int total = 0;
 
 	/* In some cases, we can be passed a frame which has no data in it, but
 	 * which has a positive number of samples defined. Once such situation is
@@ -102,97 +167,69 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 					ast_format_get_codec_id(f->subclass.format),
 					ast_format_get_name(sf->output_format),
 					ast_format_get_codec_id(sf->output_format));
-				return 0;
+				return -1;
 			}
 			ao2_replace(sf->format, f->subclass.format);
 		}
 
 		if (!(begin_frame = ast_translate(sf->trans, f, 0))) {
-			return 0;
+			return -1;
 		}
+	} else if (sf->trans) {
+		ast_translator_free_path(sf->trans);
+		sf->trans = NULL;
+	}
 
-		if (!(duped_frame = ast_frisolate(begin_frame))) {
-			return 0;
+	/* if the frame was translated, the translator may have returned multiple
+	   frames, so process each of them
+	*/
+	for (frame_ptr = begin_frame; frame_ptr; frame_ptr = AST_LIST_NEXT(frame_ptr, frame_list)) {
+		if (frame_ptr->data.ptr) {
+			total += frame_ptr->samples;
 		}
+	}
 
-		if (duped_frame != begin_frame) {
+	if (slinfactory_ensure_space(sf, total)) {
+		if (begin_frame != f) {
 			ast_frfree(begin_frame);
 		}
-	} else {
-		if (sf->trans) {
-			ast_translator_free_path(sf->trans);
-			sf->trans = NULL;
-		}
-		if (!(duped_frame = ast_frdup(f)))
-			return 0;
+		return -1;
 	}
 
-	AST_LIST_TRAVERSE(&sf->queue, frame_ptr, frame_list) {
-		x++;
+	/* The samples are copied straight into the ring, so the frames themselves
+	 * are never queued and no per-frame duplication takes place. */
+	for (frame_ptr = begin_frame; frame_ptr; frame_ptr = AST_LIST_NEXT(frame_ptr, frame_list)) {
+		if (frame_ptr->data.ptr) {
+			slinfactory_ring_write(sf, frame_ptr->data.ptr, frame_ptr->samples);
+		}
 	}
 
-	/* if the frame was translated, the translator may have returned multiple
-	   frames, so process each of them
-	*/
-	for (begin_frame = duped_frame; begin_frame; begin_frame = AST_LIST_NEXT(begin_frame, frame_list)) {
-		AST_LIST_INSERT_TAIL(&sf->queue, begin_frame, frame_list);
-		sf->size += begin_frame->samples;
+	if (begin_frame != f) {
+		ast_frfree(begin_frame);
 	}
 
-	return x;
+	return 0;
 }
 
 int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples)
 {
-	struct ast_frame *frame_ptr;
-	unsigned int sofar = 0, ineed, remain;
-	short *frame_data, *offset = buf;
-
-	while (sofar < samples) {
-		ineed = samples - sofar;
-
-		if (sf->holdlen) {
-			if (sf->holdlen <= ineed) {
-				memcpy(offset, sf->offset, sf->holdlen * sizeof(*offset));
-				sofar += sf->holdlen;
-				offset += sf->holdlen;
-				sf->holdlen = 0;
-				sf->offset = sf->hold;
-			} else {
-				remain = sf->holdlen - ineed;
-				memcpy(offset, sf->offset, ineed * sizeof(*offset));
-				sofar += ineed;
-				sf->offset += ineed;
-				sf->holdlen = remain;
-			}
-			continue;
-		}
+	unsigned int sofar = MIN(samples, sf->size);
+	unsigned int chunk;
 
-		if ((frame_ptr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-			frame_data = frame_ptr->data.ptr;
-
-			if (frame_ptr->samples <= ineed) {
-				memcpy(offset, frame_data, frame_ptr->samples * sizeof(*offset));
-				sofar += frame_ptr->samples;
-				offset += frame_ptr->samples;
-			} else {
-				remain = frame_ptr->samples - ineed;
-				memcpy(offset, frame_data, ineed * sizeof(*offset));
-				sofar += ineed;
-				frame_data += ineed;
-				if (remain > (AST_SLINFACTORY_MAX_HOLD - sf->holdlen)) {
-					remain = AST_SLINFACTORY_MAX_HOLD - sf->holdlen;
-				}
-				memcpy(sf->hold, frame_data, remain * sizeof(*offset));
-				sf->holdlen = remain;
-			}
-			ast_frfree(frame_ptr);
-		} else {
-			break;
-		}
+	if (!sofar) {
+		return 0;
+	}
+
+	/* At most two copies: up to the end of the ring, then the wrapped remainder */
+	chunk = MIN(sofar, sf->ring_size - sf->ring_head);
+	memcpy(buf, sf->ring + sf->ring_head, chunk * sizeof(*buf));
+	if (chunk < sofar) {
+		memcpy(buf + chunk, sf->ring, (sofar - chunk) * sizeof(*buf));
 	}
 
+	sf->ring_head = (sf->ring_head + sofar) & (sf->ring_size - 1);
 	sf->size -= sofar;
+
 	return sofar;
 }
 
@@ -203,18 +240,13 @@ unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf)
 
 void ast_slinfactory_flush(struct ast_slinfactory *sf)
 {
-	struct ast_frame *fr = NULL;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((fr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list)))
-		ast_frfree(fr);
-
-	sf->size = sf->holdlen = 0;
-	sf->offset = sf->hold;
+	/* The ring itself is kept so it does not need to grow again */
+	sf->ring_head = sf->size = 0;
 
 	return;
 }
@@ -48,24 +48,36 @@ struct ast_smoother {
 	unsigned int opt_needs_swap:1;
 	struct ast_frame f;
 	struct timeval delivery;
-	char data[SMOOTHER_SIZE];
-	char framedata[SMOOTHER_SIZE + AST_FRIENDLY_OFFSET];
+	/*! Queued data plus frame headroom; frames are served directly out of
+	 * this buffer at a moving offset rather than being copied out */
+	char data[SMOOTHER_SIZE + AST_FRIENDLY_OFFSET];
 	struct ast_frame *opt;
 	int len;
+	/*! Offset of the first unserved byte within the payload area of data */
+	int head;
 };
 
 static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int swap)
 {
+	char *payload = s->data + AST_FRIENDLY_OFFSET;
+
 	if (s->flags & AST_SMOOTHER_FLAG_G729) {
 		if (s->len % 10) {
 			ast_log(LOG_NOTICE, "Dropping extra frame of G.729 since we already have a VAD frame at the end\n");
 			return 0;
 		}
 	}
+	/* Compact the unserved residue to the front if the new data would not
+	 * otherwise fit. The residue is less than one output frame, so this is
+	 * a small move that happens once per cycle through the buffer. */
+	if (s->head && s->head + s->len + f->datalen > SMOOTHER_SIZE) {
+		memmove(payload, payload + s->head, s->len);
+		s->head = 0;
+	}
 	if (swap) {
-		ast_swapcopy_samples(s->data + s->len, f->data.ptr, f->samples);
+		ast_swapcopy_samples(payload + s->head + s->len, f->data.ptr, f->samples);
 	} else {
-		memcpy(s->data + s->len, f->data.ptr, f->datalen);
+		memcpy(payload + s->head + s->len, f->data.ptr, f->datalen);
 	}
 	/* If either side is empty, reset the delivery time */
 	if (!s->len || ast_tvzero(f->delivery) || ast_tvzero(s->delivery)) {	/* XXX really ? */
@@ -193,20 +205,20 @@ struct ast_frame *ast_smoother_read(struct ast_smoother *s)
 	/* Make frame */
 	s->f.frametype = AST_FRAME_VOICE;
 	s->f.subclass.format = s->format;
-	s->f.data.ptr = s->framedata + AST_FRIENDLY_OFFSET;
-	s->f.offset = AST_FRIENDLY_OFFSET;
+	/* Serve the frame straight out of the buffer rather than copying it
+	   out; the data stays valid until the next feed, which is the same
+	   lifetime the frame had when it was copied */
+	s->f.data.ptr = s->data + AST_FRIENDLY_OFFSET + s->head;
+	s->f.offset = AST_FRIENDLY_OFFSET + s->head;
 	s->f.datalen = len;
 	/* Samples will be improper given VAD, but with VAD the concept really doesn't even exist */
 	s->f.samples = len * s->samplesperbyte;	/* XXX rounding */
 	s->f.delivery = s->delivery;
-	/* Fill Data */
-	memcpy(s->f.data.ptr, s->data, len);
 	s->len -= len;
-	/* Move remaining data to the front if applicable */
+	s->head = s->len ? s->head + len : 0;
 	if (s->len) {
 		/* In principle this should all be fine because if we are sending
 		   G.729 VAD, the next timestamp will take over anyawy */
-		memmove(s->data, s->data + len, s->len);
 		if (!ast_tvzero(s->delivery)) {
 			/* If we have delivery time, increment it, otherwise, leave it at 0 */
 			s->delivery = ast_tvadd(s->delivery, ast_samp2tv(s->f.samples,
@@ -59,6 +59,9 @@
 /*! \brief Number of buckets for object fields (should be prime for performance reasons) */
 #define OBJECT_FIELD_BUCKETS 29
 
+/*! \brief Number of buckets for bulk identifier retrieval results */
+#define RETRIEVE_OBJECT_BUCKETS 17
+
 #define NOTIFY_GENERIC_OBSERVERS(container, type, callback, ...) ({ \
 	struct ao2_iterator i = ao2_iterator_init(container, 0); \
 	struct type *observer; \
@@ -1913,6 +1916,83 @@ void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *
 	return object;
 }
 
+/*! \brief Internal helper which gathers the identifiers not yet present in the given container */
+static size_t sorcery_gather_missing_ids(struct ao2_container *objects,
+	const char * const *ids, size_t num_ids, const char **missing)
+{
+	size_t num_missing = 0;
+	size_t i;
+
+	for (i = 0; i < num_ids; i++) {
+		void *existing = ao2_find(objects, ids[i], OBJ_SEARCH_KEY);
+
+		if (existing) {
+			ao2_ref(existing, -1);
+			continue;
+		}
+		missing[num_missing++] = ids[i];
+	}
+
+	return num_missing;
+}
+
+struct ao2_container *ast_sorcery_retrieve_by_id_multiple(const struct ast_sorcery *sorcery, const char *type, const char * const *ids, size_t num_ids)
+{
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
+	struct ao2_container *objects;
+	const char **missing;
+	int i;
+
+	if (!object_type) {
+		return NULL;
+	}
+
+	objects = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, RETRIEVE_OBJECT_BUCKETS,
+		ast_sorcery_object_id_hash, ast_sorcery_object_id_compare);
+	if (!objects || !num_ids) {
+		return objects;
+	}
+
+	missing = ast_malloc(num_ids * sizeof(*missing));
+	if (!missing) {
+		ao2_ref(objects, -1);
+		return NULL;
+	}
+
+	AST_VECTOR_RW_RDLOCK(&object_type->wizards);
+	for (i = 0; i < AST_VECTOR_SIZE(&object_type->wizards); i++) {
+		struct ast_sorcery_object_wizard *wizard =
+			AST_VECTOR_GET(&object_type->wizards, i);
+		size_t num_missing;
+		size_t j;
+
+		num_missing = sorcery_gather_missing_ids(objects, ids, num_ids, missing);
+		if (!num_missing) {
+			break;
+		}
+
+		if (wizard->wizard->callbacks.retrieve_multiple_id) {
+			wizard->wizard->callbacks.retrieve_multiple_id(sorcery, wizard->data,
+				object_type->name, objects, missing, num_missing);
+		} else if (wizard->wizard->callbacks.retrieve_id) {
+			for (j = 0; j < num_missing; j++) {
+				void *object = wizard->wizard->callbacks.retrieve_id(sorcery,
+					wizard->data, object_type->name, missing[j]);
+
+				if (object) {
+					ao2_link(objects, object);
+					ao2_ref(object, -1);
+				}
+			}
+		}
+	}
+	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
+
+	ast_free(missing);
+
+	return objects;
+}
+
 void *ast_sorcery_retrieve_by_fields(const struct ast_sorcery *sorcery, const char *type, unsigned int flags, struct ast_variable *fields)
 {
 	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
@@ -102,8 +102,19 @@ static int update_index_cb(void *obj, void *arg, int flags)
 {
 	char *lang = obj;
 	struct ast_media_index *index = arg;
+	RAII_VAR(struct ast_str *, cache_file, ast_str_create(64), ast_free);
 
-	if (ast_media_index_update(index, lang)) {
+	if (!cache_file) {
+		return CMP_MATCH;
+	}
+
+	/* The leading dot keeps get_languages() and the index itself from ever
+	 * mistaking the cache for media; it sits beside the language directories
+	 * whose scans it describes. */
+	ast_str_set(&cache_file, 0, "%s/sounds/.sounds-index-%s.cache",
+		ast_config_AST_DATA_DIR, lang);
+
+	if (ast_media_index_update_cached(index, lang, ast_str_buffer(cache_file))) {
 		return CMP_MATCH;
 	}
 	return 0;
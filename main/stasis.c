@@ -385,6 +385,13 @@ struct stasis_subscription {
 
 	/*! Condition for joining with subscription. */
 	ast_cond_t join_cond;
+
+	/*! The message types this subscription is accepting, indexed by
+	 *  \ref stasis_message_type_id().  Protected by the topic lock. */
+	AST_VECTOR(, char) accepted_message_types;
+	/*! The message filtering level for this subscription.
+	 *  Protected by the topic lock. */
+	enum stasis_subscription_message_filter filter;
 	/*! Flag set when final message for sub has been received.
 	 *  Be sure join_lock is held before reading/setting. */
 	int final_message_rxed;
@@ -409,6 +416,8 @@ static void subscription_dtor(void *obj)
 	ast_taskprocessor_unreference(sub->mailbox);
 	sub->mailbox = NULL;
 	ast_cond_destroy(&sub->join_cond);
+
+	AST_VECTOR_FREE(&sub->accepted_message_types);
 }
 
 /*!
@@ -498,6 +507,10 @@ struct stasis_subscription *internal_stasis_subscribe(
 	sub->callback = callback;
 	sub->data = data;
 	ast_cond_init(&sub->join_cond, NULL);
+	sub->filter = STASIS_SUBSCRIPTION_FILTER_NONE;
+	if (AST_VECTOR_INIT(&sub->accepted_message_types, 0)) {
+		return NULL;
+	}
 
 	if (topic_add_subscription(topic, sub) != 0) {
 		return NULL;
@@ -575,6 +588,85 @@ int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscr
 	return res;
 }
 
+int stasis_subscription_accept_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type)
+{
+	int res;
+
+	if (!subscription || !type) {
+		return -1;
+	}
+
+	/* The topic lock is held during dispatch, so it also protects the
+	 * subscription's type set. */
+	ao2_lock(subscription->topic);
+	res = AST_VECTOR_REPLACE(&subscription->accepted_message_types,
+		stasis_message_type_id(type), 1);
+	ao2_unlock(subscription->topic);
+
+	return res;
+}
+
+int stasis_subscription_decline_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type)
+{
+	int res = 0;
+
+	if (!subscription || !type) {
+		return -1;
+	}
+
+	ao2_lock(subscription->topic);
+	if (stasis_message_type_id(type) < AST_VECTOR_SIZE(&subscription->accepted_message_types)) {
+		/* Entries beyond the vector's size already read as "not
+		 * accepted", so there is no point growing the vector here. */
+		res = AST_VECTOR_REPLACE(&subscription->accepted_message_types,
+			stasis_message_type_id(type), 0);
+	}
+	ao2_unlock(subscription->topic);
+
+	return res;
+}
+
+int stasis_subscription_set_message_type_filter(struct stasis_subscription *subscription,
+	enum stasis_subscription_message_filter filter)
+{
+	if (!subscription) {
+		return -1;
+	}
+
+	ao2_lock(subscription->topic);
+	if (subscription->filter != STASIS_SUBSCRIPTION_FILTER_FORCED_NONE) {
+		subscription->filter = filter;
+	}
+	ao2_unlock(subscription->topic);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Decide whether a message should be dispatched to a subscriber.
+ *
+ * Must be called with the topic lock held.  Subscription change messages
+ * are always dispatched so that final message delivery keeps working.
+ */
+static int subscription_is_interested(struct stasis_subscription *sub,
+	struct stasis_message *message)
+{
+	struct stasis_message_type *type = stasis_message_type(message);
+	int id;
+
+	if (sub->filter != STASIS_SUBSCRIPTION_FILTER_SELECTIVE
+		|| type == stasis_subscription_change_type()) {
+		return 1;
+	}
+
+	id = stasis_message_type_id(type);
+	return id < AST_VECTOR_SIZE(&sub->accepted_message_types)
+		&& AST_VECTOR_GET(&sub->accepted_message_types, id);
+}
+
 void stasis_subscription_join(struct stasis_subscription *subscription)
 {
 	if (subscription) {
@@ -830,6 +922,11 @@ static void publish_msg(struct stasis_topic *topic,
 
 		ast_assert(sub != NULL);
 
+		/* A synchronous publish must always reach its target
+		 * subscriber or the publisher would wait forever. */
+		if (sub != sync_sub && !subscription_is_interested(sub, message)) {
+			continue;
+		}
 		dispatch_message(sub, message, (sub == sync_sub));
 	}
 	ao2_unlock(topic);
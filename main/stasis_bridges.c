@@ -252,16 +252,27 @@ struct ast_bridge_snapshot *ast_bridge_snapshot_create(struct ast_bridge *bridge
 		return NULL;
 	}
 
-	snapshot->channels = ast_str_container_alloc(SNAPSHOT_CHANNELS_BUCKETS);
-	if (!snapshot->channels) {
-		return NULL;
-	}
-
-	AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
-		if (ast_str_container_add(snapshot->channels,
-				ast_channel_uniqueid(bridge_channel->chan))) {
+	if (bridge->snapshot_channels) {
+		/* Membership has not changed since the last snapshot, so share
+		 * its immutable channel list instead of rebuilding it.  This
+		 * keeps the per-event cost constant during join/leave storms
+		 * where most events (blobs, state changes) do not alter
+		 * membership. */
+		snapshot->channels = ao2_bump(bridge->snapshot_channels);
+	} else {
+		snapshot->channels = ast_str_container_alloc(SNAPSHOT_CHANNELS_BUCKETS);
+		if (!snapshot->channels) {
 			return NULL;
 		}
+
+		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+			if (ast_str_container_add(snapshot->channels,
+					ast_channel_uniqueid(bridge_channel->chan))) {
+				return NULL;
+			}
+		}
+
+		bridge->snapshot_channels = ao2_bump(snapshot->channels);
 	}
 
 	ast_string_field_set(snapshot, uniqueid, bridge->uniqueid);
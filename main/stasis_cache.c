@@ -138,6 +138,12 @@ struct cache_entry_key {
 	unsigned int hash;
 };
 
+/*!
+ * \note Cache entries are immutable once linked into the entries
+ * container.  Updates swap in a replacement entry under the container
+ * write lock, so readers may examine an entry they hold a ref to
+ * without any locking.
+ */
 struct stasis_cache_entry {
 	struct cache_entry_key key;
 	/*! Aggregate snapshot of the stasis cache. */
@@ -303,8 +309,9 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 		return NULL;
 	}
 
-	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
-		NUM_CACHE_BUCKETS, cache_entry_hash, NULL, cache_entry_cmp);
+	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, NUM_CACHE_BUCKETS,
+		cache_entry_hash, NULL, cache_entry_cmp);
 	if (!cache->entries) {
 		ao2_cleanup(cache);
 		return NULL;
@@ -347,13 +354,12 @@ struct stasis_message *stasis_cache_entry_get_remote(struct stasis_cache_entry *
  * \param entries Container of cached entries.
  * \param type Type of message to retrieve the cache entry.
  * \param id Identity of the snapshot to retrieve the cache entry.
- *
- * \note The entries container is already locked.
+ * \param flags OBJ_NOLOCK if the entries container is already locked.
  *
  * \retval Cache-entry on success.
  * \retval NULL Not in cache.
  */
-static struct stasis_cache_entry *cache_find(struct ao2_container *entries, struct stasis_message_type *type, const char *id)
+static struct stasis_cache_entry *cache_find(struct ao2_container *entries, struct stasis_message_type *type, const char *id, int flags)
 {
 	struct cache_entry_key search_key;
 	struct stasis_cache_entry *entry;
@@ -361,7 +367,7 @@ static struct stasis_cache_entry *cache_find(struct ao2_container *entries, stru
 	search_key.type = type;
 	search_key.id = id;
 	cache_entry_compute_hash(&search_key);
-	entry = ao2_find(entries, &search_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	entry = ao2_find(entries, &search_key, OBJ_SEARCH_KEY | flags);
 
 	/* Ensure that what we looked for is what we found. */
 	ast_assert(!entry
@@ -372,85 +378,82 @@ static struct stasis_cache_entry *cache_find(struct ao2_container *entries, stru
 
 /*!
  * \internal
- * \brief Remove the stasis snapshot in the cache entry determined by eid.
+ * \brief Duplicate a cache entry with the snapshot for eid replaced.
  *
- * \param entries Container of cached entries.
- * \param cached_entry The entry to remove the snapshot from.
- * \param eid Which snapshot in the cached entry.
+ * Published cache entries are immutable so that readers need not hold
+ * the entries container lock.  An update therefore builds a replacement
+ * entry from the old one instead of modifying it in place; the caller
+ * swaps the new entry in under the container write lock, which drains
+ * any lock-free readers still using the old entry.
  *
- * \note The entries container is already locked.
+ * \param old_entry Published entry being replaced.
+ * \param eid Which snapshot in the entry to replace.
+ * \param new_snapshot Replacement snapshot.  NULL to remove.
+ * \param old_snapshot The displaced snapshot.  Reference bumped for the caller.
  *
- * \return Previous stasis entry snapshot.
+ * \retval Replacement cache-entry on success.  Not yet linked.
+ * \retval NULL on error.  The cache is left untouched.
  */
-static struct stasis_message *cache_remove(struct ao2_container *entries, struct stasis_cache_entry *cached_entry, const struct ast_eid *eid)
+static struct stasis_cache_entry *cache_entry_dup(struct stasis_cache_entry *old_entry,
+	const struct ast_eid *eid, struct stasis_message *new_snapshot,
+	struct stasis_message **old_snapshot)
 {
-	struct stasis_message *old_snapshot;
+	struct stasis_cache_entry *entry;
+	struct stasis_message *displaced = NULL;
 	int is_remote;
+	int idx;
 
-	is_remote = ast_eid_cmp(eid, &ast_eid_default);
-	if (!is_remote) {
-		old_snapshot = cached_entry->local;
-		cached_entry->local = NULL;
-	} else {
-		int idx;
-
-		old_snapshot = NULL;
-		for (idx = 0; idx < AST_VECTOR_SIZE(&cached_entry->remote); ++idx) {
-			struct stasis_message *cur;
-
-			cur = AST_VECTOR_GET(&cached_entry->remote, idx);
-			if (!ast_eid_cmp(eid, stasis_message_eid(cur))) {
-				old_snapshot = AST_VECTOR_REMOVE_UNORDERED(&cached_entry->remote, idx);
-				break;
-			}
-		}
+	entry = ao2_alloc_options(sizeof(*entry), cache_entry_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return NULL;
 	}
 
-	if (!cached_entry->local && !AST_VECTOR_SIZE(&cached_entry->remote)) {
-		ao2_unlink_flags(entries, cached_entry, OBJ_NOLOCK);
+	entry->key.id = ast_strdup(old_entry->key.id);
+	if (!entry->key.id) {
+		ao2_cleanup(entry);
+		return NULL;
 	}
+	entry->key.type = ao2_bump(old_entry->key.type);
+	entry->key.hash = old_entry->key.hash;
 
-	return old_snapshot;
-}
-
-/*!
- * \internal
- * \brief Update the stasis snapshot in the cache entry determined by eid.
- *
- * \param cached_entry The entry to remove the snapshot from.
- * \param eid Which snapshot in the cached entry.
- * \param new_snapshot Snapshot to replace the old snapshot.
- *
- * \return Previous stasis entry snapshot.
- */
-static struct stasis_message *cache_udpate(struct stasis_cache_entry *cached_entry, const struct ast_eid *eid, struct stasis_message *new_snapshot)
-{
-	struct stasis_message *old_snapshot;
-	int is_remote;
-	int idx;
+	if (AST_VECTOR_INIT(&entry->remote, AST_VECTOR_SIZE(&old_entry->remote) + 1)) {
+		ao2_cleanup(entry);
+		return NULL;
+	}
 
-	is_remote = ast_eid_cmp(eid, &ast_eid_default);
+	is_remote = ast_eid_cmp(eid, &ast_eid_default) ? 1 : 0;
 	if (!is_remote) {
-		old_snapshot = cached_entry->local;
-		cached_entry->local = ao2_bump(new_snapshot);
-		return old_snapshot;
+		displaced = old_entry->local;
+		entry->local = ao2_bump(new_snapshot);
+	} else {
+		entry->local = ao2_bump(old_entry->local);
 	}
 
-	old_snapshot = NULL;
-	for (idx = 0; idx < AST_VECTOR_SIZE(&cached_entry->remote); ++idx) {
+	for (idx = 0; idx < AST_VECTOR_SIZE(&old_entry->remote); ++idx) {
 		struct stasis_message *cur;
 
-		cur = AST_VECTOR_GET(&cached_entry->remote, idx);
-		if (!ast_eid_cmp(eid, stasis_message_eid(cur))) {
-			old_snapshot = AST_VECTOR_REMOVE_UNORDERED(&cached_entry->remote, idx);
-			break;
+		cur = AST_VECTOR_GET(&old_entry->remote, idx);
+		if (is_remote && !ast_eid_cmp(eid, stasis_message_eid(cur))) {
+			displaced = cur;
+			continue;
+		}
+		if (AST_VECTOR_APPEND(&entry->remote, cur)) {
+			ao2_cleanup(entry);
+			return NULL;
 		}
+		ao2_bump(cur);
 	}
-	if (!AST_VECTOR_APPEND(&cached_entry->remote, new_snapshot)) {
+	if (is_remote && new_snapshot) {
+		if (AST_VECTOR_APPEND(&entry->remote, new_snapshot)) {
+			ao2_cleanup(entry);
+			return NULL;
+		}
 		ao2_bump(new_snapshot);
 	}
 
-	return old_snapshot;
+	*old_snapshot = ao2_bump(displaced);
+	return entry;
 }
 
 struct cache_put_snapshots {
@@ -466,7 +469,8 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 	struct stasis_message_type *type, const char *id, const struct ast_eid *eid,
 	struct stasis_message *new_snapshot)
 {
-	struct stasis_cache_entry *cached_entry;
+	struct stasis_cache_entry *old_entry;
+	struct stasis_cache_entry *new_entry = NULL;
 	struct cache_put_snapshots snapshots;
 
 	ast_assert(cache->entries != NULL);
@@ -478,35 +482,45 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 
 	ao2_wrlock(cache->entries);
 
-	cached_entry = cache_find(cache->entries, type, id);
+	old_entry = cache_find(cache->entries, type, id, OBJ_NOLOCK);
 
-	/* Update the eid snapshot. */
-	if (!new_snapshot) {
-		/* Remove snapshot from cache */
-		if (cached_entry) {
-			snapshots.old = cache_remove(cache->entries, cached_entry, eid);
-		}
-	} else if (cached_entry) {
-		/* Update snapshot in cache */
-		snapshots.old = cache_udpate(cached_entry, eid, new_snapshot);
-	} else {
+	/*
+	 * Entries are immutable once linked so lock-free readers can use
+	 * them safely.  Updates build a replacement entry and swap it in;
+	 * the old entry is only freed once the last reader drops its ref.
+	 */
+	if (old_entry) {
+		new_entry = cache_entry_dup(old_entry, eid, new_snapshot, &snapshots.old);
+	} else if (new_snapshot) {
 		/* Insert into the cache */
-		cached_entry = cache_entry_create(type, id, new_snapshot);
-		if (cached_entry) {
-			ao2_link_flags(cache->entries, cached_entry, OBJ_NOLOCK);
-		}
+		new_entry = cache_entry_create(type, id, new_snapshot);
 	}
 
 	/* Update the aggregate snapshot. */
-	if (cache->aggregate_calc_fn && cached_entry) {
-		snapshots.aggregate_new = cache->aggregate_calc_fn(cached_entry, new_snapshot);
-		snapshots.aggregate_old = cached_entry->aggregate;
-		cached_entry->aggregate = ao2_bump(snapshots.aggregate_new);
+	if (cache->aggregate_calc_fn && new_entry) {
+		snapshots.aggregate_new = cache->aggregate_calc_fn(new_entry, new_snapshot);
+		snapshots.aggregate_old = ao2_bump(old_entry ? old_entry->aggregate : NULL);
+		new_entry->aggregate = ao2_bump(snapshots.aggregate_new);
+	}
+
+	if (new_entry && !new_entry->local && !AST_VECTOR_SIZE(&new_entry->remote)) {
+		/* The replacement entry holds no snapshots; drop it entirely. */
+		ao2_cleanup(new_entry);
+		new_entry = NULL;
+		if (old_entry) {
+			ao2_unlink_flags(cache->entries, old_entry, OBJ_NOLOCK);
+		}
+	} else if (new_entry) {
+		if (old_entry) {
+			ao2_unlink_flags(cache->entries, old_entry, OBJ_NOLOCK);
+		}
+		ao2_link_flags(cache->entries, new_entry, OBJ_NOLOCK);
 	}
 
 	ao2_unlock(cache->entries);
 
-	ao2_cleanup(cached_entry);
+	ao2_cleanup(new_entry);
+	ao2_cleanup(old_entry);
 	return snapshots;
 }
 
@@ -562,16 +576,16 @@ struct ao2_container *stasis_cache_get_all(struct stasis_cache *cache, struct st
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
-
-	cached_entry = cache_find(cache->entries, type, id);
+	/*
+	 * Cache entries are immutable, so holding a ref to the found entry
+	 * is all the protection this read needs.
+	 */
+	cached_entry = cache_find(cache->entries, type, id, 0);
 	if (cached_entry && cache_entry_dump(found, cached_entry)) {
 		ao2_cleanup(found);
 		found = NULL;
 	}
 
-	ao2_unlock(cache->entries);
-
 	ao2_cleanup(cached_entry);
 	return found;
 }
@@ -629,16 +643,15 @@ struct stasis_message *stasis_cache_get_by_eid(struct stasis_cache *cache, struc
 		return NULL;
 	}
 
-	ao2_rdlock(cache->entries);
-
-	cached_entry = cache_find(cache->entries, type, id);
+	/*
+	 * Cache entries are immutable, so no container lock is needed; the
+	 * entry ref keeps its snapshots alive while we bump one of them.
+	 */
+	cached_entry = cache_find(cache->entries, type, id, 0);
 	if (cached_entry) {
-		snapshot = cache_entry_by_eid(cached_entry, eid);
-		ao2_bump(snapshot);
+		snapshot = ao2_bump(cache_entry_by_eid(cached_entry, eid));
 	}
 
-	ao2_unlock(cache->entries);
-
 	ao2_cleanup(cached_entry);
 	return snapshot;
 }
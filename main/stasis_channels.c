@@ -197,6 +197,80 @@ static void channel_snapshot_dtor(void *obj)
 	ao2_cleanup(snapshot->manager_vars);
 }
 
+/*!
+ * \internal
+ * \brief Check whether a previous snapshot still describes the channel.
+ *
+ * Mirrors exactly the fields (and fallbacks) ast_channel_snapshot_create()
+ * captures; keep the two in sync when adding snapshot fields.
+ */
+static int channel_snapshot_is_current(const struct ast_channel_snapshot *old,
+	struct ast_channel *chan)
+{
+	struct ast_bridge *bridge;
+	const char *bridgeid = "";
+	int res;
+
+	if (old->state != ast_channel_state(chan)
+		|| old->priority != ast_channel_priority(chan)
+		|| old->amaflags != ast_channel_amaflags(chan)
+		|| old->hangupcause != ast_channel_hangupcause(chan)
+		|| old->flags.flags != ast_channel_flags(chan)->flags
+		|| old->softhangup_flags.flags != (unsigned int) ast_channel_softhangup_internal_flag(chan)
+		|| old->caller_pres != ast_party_id_presentation(&ast_channel_caller(chan)->id)
+		|| old->tech_properties != ast_channel_tech(chan)->properties
+		|| ast_tvcmp(old->creationtime, ast_channel_creationtime(chan))) {
+		return 0;
+	}
+
+	if (strcmp(old->name, ast_channel_name(chan))
+		|| strcmp(old->type, ast_channel_tech(chan)->type)
+		|| strcmp(old->accountcode, ast_channel_accountcode(chan))
+		|| strcmp(old->peeraccount, ast_channel_peeraccount(chan))
+		|| strcmp(old->userfield, ast_channel_userfield(chan))
+		|| strcmp(old->uniqueid, ast_channel_uniqueid(chan))
+		|| strcmp(old->linkedid, ast_channel_linkedid(chan))
+		|| strcmp(old->hangupsource, ast_channel_hangupsource(chan))
+		|| strcmp(old->appl, S_OR(ast_channel_appl(chan), ""))
+		|| strcmp(old->data, S_OR(ast_channel_data(chan), ""))
+		|| strcmp(old->context, ast_channel_context(chan))
+		|| strcmp(old->exten, ast_channel_exten(chan))
+		|| strcmp(old->language, ast_channel_language(chan))) {
+		return 0;
+	}
+
+	if (strcmp(old->caller_name,
+			S_COR(ast_channel_caller(chan)->id.name.valid, ast_channel_caller(chan)->id.name.str, ""))
+		|| strcmp(old->caller_number,
+			S_COR(ast_channel_caller(chan)->id.number.valid, ast_channel_caller(chan)->id.number.str, ""))
+		|| strcmp(old->caller_dnid, S_OR(ast_channel_dialed(chan)->number.str, ""))
+		|| strcmp(old->caller_subaddr,
+			S_COR(ast_channel_caller(chan)->id.subaddress.valid, ast_channel_caller(chan)->id.subaddress.str, ""))
+		|| strcmp(old->dialed_subaddr,
+			S_COR(ast_channel_dialed(chan)->subaddress.valid, ast_channel_dialed(chan)->subaddress.str, ""))
+		|| strcmp(old->caller_ani,
+			S_COR(ast_channel_caller(chan)->ani.number.valid, ast_channel_caller(chan)->ani.number.str, ""))
+		|| strcmp(old->caller_rdnis,
+			S_COR(ast_channel_redirecting(chan)->from.number.valid, ast_channel_redirecting(chan)->from.number.str, ""))
+		|| strcmp(old->connected_name,
+			S_COR(ast_channel_connected(chan)->id.name.valid, ast_channel_connected(chan)->id.name.str, ""))
+		|| strcmp(old->connected_number,
+			S_COR(ast_channel_connected(chan)->id.number.valid, ast_channel_connected(chan)->id.number.str, ""))) {
+		return 0;
+	}
+
+	bridge = ast_channel_get_bridge(chan);
+	if (bridge) {
+		if (!ast_test_flag(&bridge->feature_flags, AST_BRIDGE_FLAG_INVISIBLE)) {
+			bridgeid = bridge->uniqueid;
+		}
+	}
+	res = !strcmp(old->bridgeid, bridgeid);
+	ao2_cleanup(bridge);
+
+	return res;
+}
+
 struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *chan)
 {
 	struct ast_channel_snapshot *snapshot;
@@ -207,6 +281,21 @@ struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *cha
 		return NULL;
 	}
 
+	/* Most state transitions on a stable call republish a snapshot that
+	 * is identical to the previous one.  When nothing visible changed,
+	 * share the cached snapshot by reference instead of duplicating some
+	 * thirty strings.  Snapshots carrying manager/ARI variables are never
+	 * reused, since variable substitution can produce new values without
+	 * any change to the channel itself. */
+	snapshot = ast_channel_snapshot_get_latest(ast_channel_uniqueid(chan));
+	if (snapshot) {
+		if (!snapshot->manager_vars && !snapshot->ari_vars
+			&& channel_snapshot_is_current(snapshot, chan)) {
+			return snapshot;
+		}
+		ao2_ref(snapshot, -1);
+	}
+
 	snapshot = ao2_alloc_options(sizeof(*snapshot), channel_snapshot_dtor,
 		AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!snapshot || ast_string_field_init(snapshot, 1024)) {
@@ -37,10 +37,14 @@
 struct stasis_message_type {
 	struct stasis_message_vtable *vtable;
 	char *name;
+	int id;
 };
 
 static struct stasis_message_vtable null_vtable = {};
 
+/*! Sequence source for \ref stasis_message_type ids */
+static int message_type_id;
+
 static void message_type_dtor(void *obj)
 {
 	struct stasis_message_type *type = obj;
@@ -74,6 +78,7 @@ int stasis_message_type_create(const char *name,
 		return STASIS_MESSAGE_TYPE_ERROR;
 	}
 	type->vtable = vtable;
+	type->id = ast_atomic_fetchadd_int(&message_type_id, +1);
 	*result = type;
 
 	return STASIS_MESSAGE_TYPE_SUCCESS;
@@ -84,6 +89,11 @@ const char *stasis_message_type_name(const struct stasis_message_type *type)
 	return type->name;
 }
 
+int stasis_message_type_id(const struct stasis_message_type *type)
+{
+	return type->id;
+}
+
 /*! \internal */
 struct stasis_message {
 	/*! Time the message was created */
@@ -43,6 +43,15 @@ struct stasis_message_route {
 	void *data;
 };
 
+/*!
+ * \brief Table of message routes directly indexed by message type id.
+ *
+ * Every registered message type carries a small sequential integer id
+ * (see stasis_message_type_id()), so a route lookup is a bounds check
+ * and a single array load.  Slots for types without a route have a NULL
+ * \c message_type.  The table only grows to the largest id actually
+ * routed, which keeps it small for typical routers.
+ */
 AST_VECTOR(route_table, struct stasis_message_route);
 
 static struct stasis_message_route *route_table_find(struct route_table *table,
@@ -51,32 +60,22 @@ static struct stasis_message_route *route_table_find(struct route_table *table,
 	size_t idx;
 	struct stasis_message_route *route;
 
-	/* While a linear search for routes may seem very inefficient, most
-	 * route tables have six routes or less. For such small data, it's
-	 * hard to beat a linear search. If we start having larger route
-	 * tables, then we can look into containers with more efficient
-	 * lookups.
-	 */
-	for (idx = 0; idx < AST_VECTOR_SIZE(table); ++idx) {
-		route = AST_VECTOR_GET_ADDR(table, idx);
-		if (route->message_type == message_type) {
-			return route;
-		}
+	if (!message_type) {
+		return NULL;
 	}
 
-	return NULL;
-}
+	idx = stasis_message_type_id(message_type);
+	if (idx >= AST_VECTOR_SIZE(table)) {
+		return NULL;
+	}
 
-/*!
- * \brief route_table comparator for AST_VECTOR_REMOVE_CMP_UNORDERED()
- *
- * \param elem Element to compare against
- * \param value Value to compare with the vector element.
- *
- * \return 0 if element does not match.
- * \return Non-zero if element matches.
- */
-#define ROUTE_TABLE_ELEM_CMP(elem, value) ((elem).message_type == (value))
+	route = AST_VECTOR_GET_ADDR(table, idx);
+	if (!route->message_type) {
+		return NULL;
+	}
+
+	return route;
+}
 
 /*!
  * \brief route_table vector element cleanup.
@@ -90,8 +89,16 @@ static struct stasis_message_route *route_table_find(struct route_table *table,
 static int route_table_remove(struct route_table *table,
 	struct stasis_message_type *message_type)
 {
-	return AST_VECTOR_REMOVE_CMP_UNORDERED(table, message_type, ROUTE_TABLE_ELEM_CMP,
-		ROUTE_TABLE_ELEM_CLEANUP);
+	struct stasis_message_route *route;
+
+	route = route_table_find(table, message_type);
+	if (!route) {
+		return -1;
+	}
+
+	ROUTE_TABLE_ELEM_CLEANUP(*route);
+	memset(route, 0, sizeof(*route));
+	return 0;
 }
 
 static int route_table_add(struct route_table *table,
@@ -99,20 +106,29 @@ static int route_table_add(struct route_table *table,
 	stasis_subscription_cb callback, void *data)
 {
 	struct stasis_message_route route;
-	int res;
+	struct stasis_message_route empty_route = {
+		.message_type = NULL,
+	};
+	size_t idx;
 
 	ast_assert(callback != NULL);
 	ast_assert(route_table_find(table, message_type) == NULL);
 
+	/* Grow the table out to the slot for this type, filling any
+	 * intermediate slots with empty routes. */
+	idx = stasis_message_type_id(message_type);
+	while (AST_VECTOR_SIZE(table) <= idx) {
+		if (AST_VECTOR_APPEND(table, empty_route)) {
+			return -1;
+		}
+	}
+
 	route.message_type = ao2_bump(message_type);
 	route.callback = callback;
 	route.data = data;
 
-	res = AST_VECTOR_APPEND(table, route);
-	if (res) {
-		ROUTE_TABLE_ELEM_CLEANUP(route);
-	}
-	return res;
+	*AST_VECTOR_GET_ADDR(table, idx) = route;
+	return 0;
 }
 
 static void route_table_dtor(struct route_table *table)
@@ -231,6 +247,11 @@ static struct stasis_message_router *stasis_message_router_create_internal(
 		return NULL;
 	}
 
+	/* Until a default route is set, the subscription only needs the
+	 * message types that have routes. */
+	stasis_subscription_set_message_type_filter(router->subscription,
+		STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
+
 	ao2_ref(router, +1);
 	return router;
 }
@@ -313,6 +334,9 @@ int stasis_message_router_add(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->routes, message_type, callback, data);
+	if (!res) {
+		stasis_subscription_accept_message_type(router->subscription, message_type);
+	}
 	ao2_unlock(router);
 	return res;
 }
@@ -331,6 +355,12 @@ int stasis_message_router_add_cache_update(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->cache_routes, message_type, callback, data);
+	if (!res) {
+		/* Cache routes are keyed on the type inside the cache update
+		 * wrapper, so it is the wrapper type the subscription needs. */
+		stasis_subscription_accept_message_type(router->subscription,
+			stasis_cache_update_type());
+	}
 	ao2_unlock(router);
 	return res;
 }
@@ -375,6 +405,12 @@ int stasis_message_router_set_default(struct stasis_message_router *router,
 	router->default_route.callback = callback;
 	router->default_route.data = data;
 	ao2_unlock(router);
+
+	/* A default route must see everything, so the filter is forced off
+	 * and stays off even if more routes are added later. */
+	stasis_subscription_set_message_type_filter(router->subscription,
+		STASIS_SUBSCRIPTION_FILTER_FORCED_NONE);
+
 	/* While this implementation can never fail, it used to be able to */
 	return 0;
 }
@@ -61,6 +61,116 @@ static void *calloc_wrapper(unsigned int num_structs, size_t struct_size,
 	return __ast_calloc(num_structs, struct_size, file, lineno, func);
 }
 
+/*
+ * Pools are recycled instead of handed straight back to the allocator.
+ * optimal_alloc_size() only ever produces power-of-two allocations, so
+ * retired pools are kept on a freelist per size class and call
+ * setup/teardown reuses them instead of hitting the allocator for every
+ * channel. The cache is bypassed when memory debugging is compiled in,
+ * so allocations stay attributed to their owners.
+ */
+#if !defined(__AST_DEBUG_MALLOC)
+
+/*! \brief largest power-of-two shift of pool allocation kept in the cache (64k) */
+#define POOL_CACHE_MAX_SHIFT 16
+
+/*! \brief maximum number of retired pools kept per size class */
+#define POOL_CACHE_MAX_PER_CLASS 16
+
+static struct ast_string_field_pool *pool_cache[POOL_CACHE_MAX_SHIFT + 1];
+static unsigned int pool_cache_count[POOL_CACHE_MAX_SHIFT + 1];
+AST_MUTEX_DEFINE_STATIC(pool_cache_lock);
+
+/*! \brief Get the size class shift for a pool allocation size. */
+static unsigned int pool_cache_shift(size_t alloc_size)
+{
+	size_t size = alloc_size + ALLOCATOR_OVERHEAD;
+	unsigned int count;
+
+	/* alloc_size came from optimal_alloc_size(), so size is a power of two */
+	for (count = 0; size > 1; size >>= 1, count++);
+
+	return count;
+}
+
+static void pool_cache_flush(void)
+{
+	unsigned int shift;
+
+	ast_mutex_lock(&pool_cache_lock);
+	for (shift = 0; shift <= POOL_CACHE_MAX_SHIFT; shift++) {
+		struct ast_string_field_pool *pool;
+
+		while ((pool = pool_cache[shift])) {
+			pool_cache[shift] = pool->prev;
+			ast_free(pool);
+		}
+		pool_cache_count[shift] = 0;
+	}
+	ast_mutex_unlock(&pool_cache_lock);
+}
+
+/*! \brief Pull a pool of the given allocation size from the cache, if one is there. */
+static struct ast_string_field_pool *pool_cache_get(size_t alloc_size)
+{
+	unsigned int shift = pool_cache_shift(alloc_size);
+	struct ast_string_field_pool *pool = NULL;
+
+	if (shift > POOL_CACHE_MAX_SHIFT) {
+		return NULL;
+	}
+
+	ast_mutex_lock(&pool_cache_lock);
+	if ((pool = pool_cache[shift])) {
+		pool_cache[shift] = pool->prev;
+		pool_cache_count[shift]--;
+	}
+	ast_mutex_unlock(&pool_cache_lock);
+
+	return pool;
+}
+
+/*! \brief Retire a pool, keeping it for reuse unless its class is full. */
+static void pool_release(struct ast_string_field_pool *pool)
+{
+	static int flush_registered;
+	unsigned int shift = pool_cache_shift(pool->size + sizeof(*pool));
+
+	if (shift > POOL_CACHE_MAX_SHIFT) {
+		ast_free(pool);
+		return;
+	}
+
+	ast_mutex_lock(&pool_cache_lock);
+	if (pool_cache_count[shift] >= POOL_CACHE_MAX_PER_CLASS) {
+		ast_mutex_unlock(&pool_cache_lock);
+		ast_free(pool);
+		return;
+	}
+	pool->prev = pool_cache[shift];
+	pool_cache[shift] = pool;
+	pool_cache_count[shift]++;
+	if (!flush_registered) {
+		flush_registered = 1;
+		ast_register_cleanup(pool_cache_flush);
+	}
+	ast_mutex_unlock(&pool_cache_lock);
+}
+
+#else
+
+static struct ast_string_field_pool *pool_cache_get(size_t alloc_size)
+{
+	return NULL;
+}
+
+static void pool_release(struct ast_string_field_pool *pool)
+{
+	ast_free(pool);
+}
+
+#endif /* !defined(__AST_DEBUG_MALLOC) */
+
 /*! \brief add a new block to the pool.
  * We can only allocate from the topmost pool, so the
  * fields in *mgr reflect the size of that only.
@@ -71,7 +181,9 @@ static int add_string_pool(struct ast_string_field_mgr *mgr, struct ast_string_f
 	struct ast_string_field_pool *pool;
 	size_t alloc_size = optimal_alloc_size(sizeof(*pool) + size);
 
-	if (!(pool = calloc_wrapper(1, alloc_size, file, lineno, func))) {
+	if ((pool = pool_cache_get(alloc_size))) {
+		pool->used = pool->active = 0;
+	} else if (!(pool = calloc_wrapper(1, alloc_size, file, lineno, func))) {
 		return -1;
 	}
 
@@ -147,7 +259,7 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 		struct ast_string_field_pool *prev = cur->prev;
 
 		if (cur != preserve) {
-			ast_free(cur);
+			pool_release(cur);
 		}
 		cur = prev;
 	}
@@ -286,7 +398,7 @@ void __ast_string_field_release_active(struct ast_string_field_pool *pool_head,
 			if (pool->active == 0) {
 				if (prev) {
 					prev->prev = pool->prev;
-					ast_free(pool);
+					pool_release(pool);
 				} else {
 					pool->used = 0;
 				}
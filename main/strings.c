@@ -352,4 +352,110 @@ equals:
 	return 0;
 }
 
+/*
+ * Per-thread cache of malloc'd ast_str buffers, filed in power-of-two
+ * size classes.  Hot paths that build a string, hand it off and free it
+ * on every call (HTTP responses, manager over HTTP) can recycle their
+ * buffers here instead of hitting the allocator each time.  The classes
+ * run from 64 bytes to 8k; anything that grew beyond the top class is
+ * freed on put, which doubles as the high water trim.
+ */
+#define STR_POOL_MIN_SHIFT	6
+#define STR_POOL_MAX_SHIFT	13
+#define STR_POOL_CLASSES	(STR_POOL_MAX_SHIFT - STR_POOL_MIN_SHIFT + 1)
+#define STR_POOL_MAX_PER_CLASS	4
+
+struct str_pool {
+	struct ast_str *strs[STR_POOL_CLASSES][STR_POOL_MAX_PER_CLASS];
+	unsigned char count[STR_POOL_CLASSES];
+};
+
+static void str_pool_cleanup(void *data)
+{
+	struct str_pool *pool = data;
+	int idx;
+	int i;
+
+	for (idx = 0; idx < STR_POOL_CLASSES; idx++) {
+		for (i = 0; i < pool->count[idx]; i++) {
+			ast_free(pool->strs[idx][i]);
+		}
+	}
+	ast_free(pool);
+}
+
+AST_THREADSTORAGE_CUSTOM(str_pool_ts, NULL, str_pool_cleanup);
+
+struct ast_str *ast_str_pool_get(size_t init_len)
+{
+	struct str_pool *pool = ast_threadstorage_get(&str_pool_ts, sizeof(*pool));
+
+	if (pool) {
+		size_t class_len = 1 << STR_POOL_MIN_SHIFT;
+		int idx;
+
+		for (idx = 0; idx < STR_POOL_CLASSES; idx++, class_len <<= 1) {
+			if (class_len < init_len) {
+				continue;
+			}
+			if (pool->count[idx]) {
+				struct ast_str *buf = pool->strs[idx][--pool->count[idx]];
+
+				ast_str_reset(buf);
+				return buf;
+			}
+			/*
+			 * Round the request up to the class size so a later put
+			 * files the buffer back in this class and repeated
+			 * get/grow cycles converge instead of reallocating.
+			 */
+			init_len = class_len;
+			break;
+		}
+	}
+
+	return ast_str_create(init_len);
+}
+
+void ast_str_pool_put(struct ast_str *buf)
+{
+	struct str_pool *pool;
+	size_t class_len;
+	int idx;
+
+	if (!buf) {
+		return;
+	}
+
+	/*
+	 * Only plain malloc'd strings may be cached; alloca and thread
+	 * storage strings are owned elsewhere.
+	 */
+	if (buf->__AST_STR_TS != DS_MALLOC) {
+		return;
+	}
+
+	pool = ast_threadstorage_get(&str_pool_ts, sizeof(*pool));
+	if (!pool || buf->__AST_STR_LEN < (1 << STR_POOL_MIN_SHIFT)
+		|| (1 << STR_POOL_MAX_SHIFT) < buf->__AST_STR_LEN) {
+		ast_free(buf);
+		return;
+	}
+
+	/* File the buffer in the largest class it can fully satisfy. */
+	class_len = 1 << (STR_POOL_MIN_SHIFT + 1);
+	for (idx = 0; idx < STR_POOL_CLASSES - 1; idx++, class_len <<= 1) {
+		if (buf->__AST_STR_LEN < class_len) {
+			break;
+		}
+	}
+
+	if (pool->count[idx] == STR_POOL_MAX_PER_CLASS) {
+		ast_free(buf);
+		return;
+	}
+
+	pool->strs[idx][pool->count[idx]++] = buf;
+}
+
 
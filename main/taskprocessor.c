@@ -29,6 +29,8 @@
 
 #include "asterisk.h"
 
+#include <inttypes.h>
+
 #include "asterisk/_private.h"
 #include "asterisk/module.h"
 #include "asterisk/time.h"
@@ -36,6 +38,8 @@
 #include "asterisk/cli.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/sem.h"
+#include "asterisk/sdt.h"
+#include "asterisk/manager.h"
 
 /*!
  * \brief tps_task structure is queued to a taskprocessor
@@ -54,15 +58,37 @@ struct tps_task {
 	void *datap;
 	/*! \brief AST_LIST_ENTRY overhead */
 	AST_LIST_ENTRY(tps_task) list;
+	/*! \brief Monotonic time the task was queued, for latency tracking */
+	uint64_t enqueued_ns;
 	unsigned int wants_local:1;
 };
 
+/*!
+ * \brief Number of log2 enqueue-to-execute latency buckets
+ *
+ * Bucket 0 holds latencies under 1us and each following bucket doubles,
+ * so the last bucket holds everything at or above 2^18us (~262ms).
+ */
+#define TPS_LATENCY_BUCKETS 20
+
+/*! \brief Latency at which a serializer is considered starved */
+#define TPS_LATENCY_ALARM_NS (500 * 1000000ULL)
+
+/*! \brief Minimum seconds between starvation alarms per taskprocessor */
+#define TPS_LATENCY_ALARM_INTERVAL 60
+
 /*! \brief tps_taskprocessor_stats maintain statistics for a taskprocessor. */
 struct tps_taskprocessor_stats {
 	/*! \brief This is the maximum number of tasks queued at any one time */
 	unsigned long max_qsize;
 	/*! \brief This is the current number of tasks processed */
 	unsigned long _tasks_processed_count;
+	/*! \brief Enqueue-to-execute latency distribution, log2 microsecond buckets */
+	unsigned long latency_histo[TPS_LATENCY_BUCKETS];
+	/*! \brief Largest enqueue-to-execute latency seen */
+	uint64_t max_latency_ns;
+	/*! \brief Last time a starvation alarm was raised */
+	time_t last_latency_alarm;
 };
 
 /*! \brief A ast_taskprocessor structure is a singleton by name */
@@ -113,6 +139,9 @@ struct ast_taskprocessor_listener {
 };
 
 #define TPS_MAX_BUCKETS 7
+
+/*! Largest run of tasks popped from the queue per lock acquisition. */
+#define TPS_BATCH_MAX 32
 /*! \brief tps_singletons is the astobj2 container for taskprocessor singletons */
 static struct ao2_container *tps_singletons;
 
@@ -132,10 +161,12 @@ static int tps_ping_handler(void *datap);
 
 static char *cli_tps_ping(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
 static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
+static char *cli_tps_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
 
 static struct ast_cli_entry taskprocessor_clis[] = {
 	AST_CLI_DEFINE(cli_tps_ping, "Ping a named task processor"),
 	AST_CLI_DEFINE(cli_tps_report, "List instantiated task processors and statistics"),
+	AST_CLI_DEFINE(cli_tps_latency, "Show a task processor's queue latency histogram"),
 };
 
 struct default_taskprocessor_listener_pvt {
@@ -180,12 +211,19 @@ static void *default_tps_processing_function(void *data)
 			/* Just give up */
 			break;
 		}
-		ast_taskprocessor_execute(tps);
+		/* Drain in batches so one lock acquisition covers many tasks.
+		 * Batched pushes may post a single wakeup for several tasks,
+		 * so keep going until the queue is empty. */
+		while (ast_taskprocessor_execute_batch(tps, TPS_BATCH_MAX)) {
+		}
 	}
 
-	/* No posting to a dead taskprocessor! */
+	/* No posting to a dead taskprocessor!  With batched pushes the
+	 * semaphore no longer counts tasks one-to-one; leftover wakeup
+	 * tokens are possible and harmless, but the semaphore must still
+	 * be readable. */
 	res = ast_sem_getvalue(&pvt->sem, &sem_value);
-	ast_assert(res == 0 && sem_value == 0);
+	ast_assert(res == 0);
 
 	/* Free the shutdown reference (see default_listener_shutdown) */
 	ao2_t_ref(listener->tps, -1, "tps-shutdown");
@@ -254,12 +292,228 @@ static const struct ast_taskprocessor_listener_callbacks default_listener_callba
 	.dtor = default_listener_pvt_dtor,
 };
 
+/*! Largest number of tasks a pool worker runs before requeuing the
+ * taskprocessor behind other ready ones. */
+#define POOL_BATCH_MAX		32
+
+/*! Bounds for the automatically sized shared worker pool. */
+#define POOL_THREADS_MIN	2
+#define POOL_THREADS_MAX	16
+
+/*!
+ * \brief Listener private data of a pooled (work-stealing) taskprocessor.
+ *
+ * \details Pooled taskprocessors do not own a thread.  When one
+ * becomes non-empty it is queued on a shared ready list and the
+ * next free pool worker drains it.  A taskprocessor is on the
+ * ready list or owned by a worker at most once at any time, so
+ * per-taskprocessor task ordering is preserved while any worker
+ * may execute any ready taskprocessor.
+ */
+struct pooled_taskprocessor_listener_pvt {
+	/*! The listener owning this private data. */
+	struct ast_taskprocessor_listener *listener;
+	/*! Links in the pool ready list. */
+	AST_LIST_ENTRY(pooled_taskprocessor_listener_pvt) entry;
+	/*! TRUE while queued on the ready list or owned by a worker. */
+	unsigned int scheduled:1;
+	/*! TRUE while a worker is executing tasks of this taskprocessor. */
+	unsigned int running:1;
+};
+
+/*! Shared worker pool executing pooled taskprocessors. */
+static struct {
+	ast_mutex_t lock;
+	/*! Signaled when the ready list grows, a worker finishes a
+	 * taskprocessor, or the pool shuts down. */
+	ast_cond_t cond;
+	/*! Taskprocessors with queued tasks awaiting a worker. */
+	AST_LIST_HEAD_NOLOCK(, pooled_taskprocessor_listener_pvt) ready;
+	pthread_t *threads;
+	int n_threads;
+	/*! TRUE once the worker threads have been spawned. */
+	int started;
+	/*! TRUE when the workers must exit. */
+	int stopping;
+} tps_pool = {
+	.lock = AST_MUTEX_INIT_VALUE,
+};
+
+/*!
+ * \internal
+ * \brief Shared pool worker thread.
+ */
+static void *tps_pool_worker(void *unused)
+{
+	ast_mutex_lock(&tps_pool.lock);
+	while (!tps_pool.stopping) {
+		struct pooled_taskprocessor_listener_pvt *pvt;
+		struct ast_taskprocessor *tps;
+
+		pvt = AST_LIST_REMOVE_HEAD(&tps_pool.ready, entry);
+		if (!pvt) {
+			ast_cond_wait(&tps_pool.cond, &tps_pool.lock);
+			continue;
+		}
+		pvt->running = 1;
+		tps = pvt->listener->tps;
+		ast_mutex_unlock(&tps_pool.lock);
+
+		ast_taskprocessor_execute_batch(tps, POOL_BATCH_MAX);
+
+		ast_mutex_lock(&tps_pool.lock);
+		pvt->running = 0;
+		if (ast_taskprocessor_size(tps)) {
+			/* More work queued; go to the back of the line. */
+			AST_LIST_INSERT_TAIL(&tps_pool.ready, pvt, entry);
+		} else {
+			pvt->scheduled = 0;
+			ao2_t_ref(tps, -1, "tps-pool-ready");
+		}
+		/* Wake any shutdown waiting for this taskprocessor. */
+		ast_cond_broadcast(&tps_pool.cond);
+	}
+	ast_mutex_unlock(&tps_pool.lock);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Spawn the shared pool workers on first use.
+ *
+ * \note Must be called with tps_pool.lock held.
+ */
+static int tps_pool_start(void)
+{
+	int n;
+	int idx;
+
+	if (tps_pool.started) {
+		return 0;
+	}
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < POOL_THREADS_MIN) {
+		n = POOL_THREADS_MIN;
+	} else if (POOL_THREADS_MAX < n) {
+		n = POOL_THREADS_MAX;
+	}
+
+	ast_cond_init(&tps_pool.cond, NULL);
+	tps_pool.threads = ast_calloc(n, sizeof(*tps_pool.threads));
+	if (!tps_pool.threads) {
+		return -1;
+	}
+	for (idx = 0; idx < n; ++idx) {
+		if (ast_pthread_create_background(&tps_pool.threads[idx], NULL,
+			tps_pool_worker, NULL)) {
+			break;
+		}
+	}
+	tps_pool.n_threads = idx;
+	if (!idx) {
+		ast_free(tps_pool.threads);
+		tps_pool.threads = NULL;
+		return -1;
+	}
+	tps_pool.started = 1;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Stop the shared pool workers on Asterisk shutdown.
+ */
+static void tps_pool_stop(void)
+{
+	int idx;
+
+	ast_mutex_lock(&tps_pool.lock);
+	if (!tps_pool.started) {
+		ast_mutex_unlock(&tps_pool.lock);
+		return;
+	}
+	tps_pool.stopping = 1;
+	ast_cond_broadcast(&tps_pool.cond);
+	ast_mutex_unlock(&tps_pool.lock);
+
+	for (idx = 0; idx < tps_pool.n_threads; ++idx) {
+		pthread_join(tps_pool.threads[idx], NULL);
+	}
+	ast_free(tps_pool.threads);
+	tps_pool.threads = NULL;
+	tps_pool.started = 0;
+	tps_pool.stopping = 0;
+}
+
+static int pooled_listener_start(struct ast_taskprocessor_listener *listener)
+{
+	int res;
+
+	ast_mutex_lock(&tps_pool.lock);
+	res = tps_pool_start();
+	ast_mutex_unlock(&tps_pool.lock);
+
+	return res;
+}
+
+static void pooled_task_pushed(struct ast_taskprocessor_listener *listener, int was_empty)
+{
+	struct pooled_taskprocessor_listener_pvt *pvt = listener->user_data;
+
+	ast_mutex_lock(&tps_pool.lock);
+	if (!pvt->scheduled) {
+		pvt->scheduled = 1;
+		ao2_t_ref(listener->tps, +1, "tps-pool-ready");
+		AST_LIST_INSERT_TAIL(&tps_pool.ready, pvt, entry);
+		ast_cond_signal(&tps_pool.cond);
+	}
+	ast_mutex_unlock(&tps_pool.lock);
+}
+
+static void pooled_listener_shutdown(struct ast_taskprocessor_listener *listener)
+{
+	struct pooled_taskprocessor_listener_pvt *pvt = listener->user_data;
+
+	ast_mutex_lock(&tps_pool.lock);
+	/* Wait until the taskprocessor is fully off the pool: a worker that
+	 * finishes a batch with tasks still queued clears running and puts
+	 * the pvt back on the ready list, so waiting for running alone
+	 * could let a worker execute task callbacks after shutdown has
+	 * returned.  Loop until nothing is scheduled, pulling the pvt off
+	 * the ready list ourselves when no worker holds it. */
+	while (pvt->scheduled) {
+		if (!pvt->running) {
+			AST_LIST_REMOVE(&tps_pool.ready, pvt, entry);
+			pvt->scheduled = 0;
+			ao2_t_ref(listener->tps, -1, "tps-pool-ready");
+			break;
+		}
+		ast_cond_wait(&tps_pool.cond, &tps_pool.lock);
+	}
+	ast_mutex_unlock(&tps_pool.lock);
+}
+
+static void pooled_listener_pvt_dtor(struct ast_taskprocessor_listener *listener)
+{
+	ast_free(listener->user_data);
+	listener->user_data = NULL;
+}
+
+static const struct ast_taskprocessor_listener_callbacks pooled_listener_callbacks = {
+	.start = pooled_listener_start,
+	.task_pushed = pooled_task_pushed,
+	.shutdown = pooled_listener_shutdown,
+	.dtor = pooled_listener_pvt_dtor,
+};
+
 /*!
  * \internal
  * \brief Clean up resources on Asterisk shutdown
  */
 static void tps_shutdown(void)
 {
+	tps_pool_stop();
 	ast_cli_unregister_multiple(taskprocessor_clis, ARRAY_LEN(taskprocessor_clis));
 	ao2_t_ref(tps_singletons, -1, "Unref tps_singletons in shutdown");
 	tps_singletons = NULL;
@@ -268,7 +522,10 @@ static void tps_shutdown(void)
 /* initialize the taskprocessor container and register CLI operations */
 int ast_tps_init(void)
 {
-	if (!(tps_singletons = ao2_container_alloc(TPS_MAX_BUCKETS, tps_hash_cb, tps_cmp_cb))) {
+	tps_singletons = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, TPS_MAX_BUCKETS, tps_hash_cb, NULL,
+		tps_cmp_cb);
+	if (!tps_singletons) {
 		ast_log(LOG_ERROR, "taskprocessor container failed to initialize!\n");
 		return -1;
 	}
@@ -332,7 +589,7 @@ static void *tps_task_free(struct tps_task *task)
 }
 
 /* taskprocessor tab completion */
-static char *tps_taskprocessor_tab_complete(struct ast_cli_args *a)
+static char *tps_taskprocessor_tab_complete(struct ast_cli_args *a, int pos)
 {
 	int tklen;
 	int wordnum = 0;
@@ -340,7 +597,7 @@ static char *tps_taskprocessor_tab_complete(struct ast_cli_args *a)
 	char *name = NULL;
 	struct ao2_iterator i;
 
-	if (a->pos != 3)
+	if (a->pos != pos)
 		return NULL;
 
 	tklen = strlen(a->word);
@@ -383,7 +640,7 @@ static char *cli_tps_ping(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 			"	Displays the time required for a task to be processed\n";
 		return NULL;
 	case CLI_GENERATE:
-		return tps_taskprocessor_tab_complete(a);
+		return tps_taskprocessor_tab_complete(a, 3);
 	}
 
 	if (a->argc != 4)
@@ -472,8 +729,8 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	struct ao2_container *sorted_tps;
 	struct ast_taskprocessor *tps;
 	struct ao2_iterator iter;
-#define FMT_HEADERS		"%-45s %10s %10s %10s %10s %10s\n"
-#define FMT_FIELDS		"%-45s %10lu %10lu %10lu %10lu %10lu\n"
+#define FMT_HEADERS		"%-45s %10s %10s %10s %10s %10s %11s\n"
+#define FMT_FIELDS		"%-45s %10lu %10lu %10lu %10lu %10lu %11lu\n"
 
 	switch (cmd) {
 	case CLI_INIT:
@@ -498,21 +755,25 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 		return CLI_FAILURE;
 	}
 
-	ast_cli(a->fd, "\n" FMT_HEADERS, "Processor", "Processed", "In Queue", "Max Depth", "Low water", "High water");
+	ast_cli(a->fd, "\n" FMT_HEADERS, "Processor", "Processed", "In Queue", "Max Depth", "Low water", "High water", "Max Lat(ms)");
 	tcount = 0;
 	iter = ao2_iterator_init(sorted_tps, AO2_ITERATOR_UNLINK);
 	while ((tps = ao2_iterator_next(&iter))) {
+		unsigned long maxlat;
+
 		ast_copy_string(name, tps->name, sizeof(name));
 		qsize = tps->tps_queue_size;
 		if (tps->stats) {
 			maxqsize = tps->stats->max_qsize;
 			processed = tps->stats->_tasks_processed_count;
+			maxlat = tps->stats->max_latency_ns / 1000000;
 		} else {
 			maxqsize = 0;
 			processed = 0;
+			maxlat = 0;
 		}
 		ast_cli(a->fd, FMT_FIELDS, name, processed, qsize, maxqsize,
-			tps->tps_queue_low, tps->tps_queue_high);
+			tps->tps_queue_low, tps->tps_queue_high, maxlat);
 		ast_taskprocessor_unreference(tps);
 		++tcount;
 	}
@@ -522,6 +783,74 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	return CLI_SUCCESS;
 }
 
+/* print the enqueue-to-execute latency histogram of the specified taskprocessor */
+static char *cli_tps_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	const char *name;
+	struct ast_taskprocessor *tps;
+	unsigned long histo[TPS_LATENCY_BUCKETS];
+	unsigned long total = 0;
+	uint64_t max_latency_ns;
+	unsigned int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show taskprocessor latency";
+		e->usage =
+			"Usage: core show taskprocessor latency <taskprocessor>\n"
+			"	Shows the distribution of time tasks spent waiting in the\n"
+			"	named task processor's queue before executing\n";
+		return NULL;
+	case CLI_GENERATE:
+		return tps_taskprocessor_tab_complete(a, 4);
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	name = a->argv[4];
+	if (!(tps = ast_taskprocessor_get(name, TPS_REF_IF_EXISTS))) {
+		ast_cli(a->fd, "\n'%s' not found\n\n", name);
+		return CLI_SUCCESS;
+	}
+
+	ao2_lock(tps);
+	if (!tps->stats) {
+		ao2_unlock(tps);
+		ast_cli(a->fd, "\nNo statistics for '%s'\n\n", name);
+		ast_taskprocessor_unreference(tps);
+		return CLI_SUCCESS;
+	}
+	memcpy(histo, tps->stats->latency_histo, sizeof(histo));
+	max_latency_ns = tps->stats->max_latency_ns;
+	ao2_unlock(tps);
+
+	ast_cli(a->fd, "\nEnqueue-to-execute latency for '%s':\n\n", name);
+	for (i = 0; i < TPS_LATENCY_BUCKETS; i++) {
+		total += histo[i];
+	}
+	for (i = 0; i < TPS_LATENCY_BUCKETS; i++) {
+		unsigned long lower = i ? 1UL << (i - 1) : 0;
+
+		if (!histo[i]) {
+			continue;
+		}
+		if (i == TPS_LATENCY_BUCKETS - 1) {
+			ast_cli(a->fd, "	>= %8luus: %10lu (%5.1f%%)\n",
+				lower, histo[i], histo[i] * 100.0 / total);
+		} else {
+			ast_cli(a->fd, "	 < %8luus: %10lu (%5.1f%%)\n",
+				1UL << i, histo[i], histo[i] * 100.0 / total);
+		}
+	}
+	ast_cli(a->fd, "\n	%lu tasks measured, max latency %" PRIu64 "us\n\n",
+		total, max_latency_ns / 1000);
+
+	ast_taskprocessor_unreference(tps);
+	return CLI_SUCCESS;
+}
+
 /* hash callback for astobj2 */
 static int tps_hash_cb(const void *obj, const int flags)
 {
@@ -657,6 +986,79 @@ static struct tps_task *tps_taskprocessor_pop(struct ast_taskprocessor *tps)
 	return task;
 }
 
+static uint64_t tps_now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*!
+ * \internal
+ * \brief Record a popped task's enqueue-to-execute latency.
+ *
+ * Must be called with the taskprocessor locked.
+ *
+ * \retval non-zero if the task waited long enough that the caller
+ * should raise a starvation alarm once the taskprocessor is unlocked.
+ */
+static int tps_record_latency(struct ast_taskprocessor *tps, struct tps_task *t,
+	uint64_t now_ns)
+{
+	uint64_t latency_ns = now_ns - t->enqueued_ns;
+	uint64_t us = latency_ns / 1000;
+	unsigned int bucket;
+
+	if (!tps->stats || !t->enqueued_ns) {
+		return 0;
+	}
+
+	bucket = us ? 64 - __builtin_clzll(us) : 0;
+	if (bucket >= TPS_LATENCY_BUCKETS) {
+		bucket = TPS_LATENCY_BUCKETS - 1;
+	}
+	tps->stats->latency_histo[bucket]++;
+	if (latency_ns > tps->stats->max_latency_ns) {
+		tps->stats->max_latency_ns = latency_ns;
+	}
+
+	if (latency_ns >= TPS_LATENCY_ALARM_NS) {
+		time_t now = time(NULL);
+
+		if (tps->stats->last_latency_alarm + TPS_LATENCY_ALARM_INTERVAL <= now) {
+			tps->stats->last_latency_alarm = now;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Raise a starvation alarm for a task that waited too long.
+ *
+ * Must be called without the taskprocessor locked.  Rate limited to
+ * once per TPS_LATENCY_ALARM_INTERVAL seconds per taskprocessor by
+ * tps_record_latency().
+ */
+static void tps_latency_alarm(struct ast_taskprocessor *tps, uint64_t latency_ns)
+{
+	ast_log(LOG_WARNING,
+		"The '%s' task processor took %" PRIu64 "ms from enqueue to execute.\n",
+		tps->name, latency_ns / 1000000);
+	manager_event(EVENT_FLAG_SYSTEM, "TaskprocessorStarvation",
+		"Processor: %s\r\n"
+		"LatencyMs: %" PRIu64 "\r\n"
+		"MaxLatencyMs: %" PRIu64 "\r\n"
+		"Processed: %lu\r\n"
+		"InQueue: %ld\r\n",
+		tps->name, latency_ns / 1000000,
+		tps->stats ? tps->stats->max_latency_ns / 1000000 : 0,
+		tps->stats ? tps->stats->_tasks_processed_count : 0,
+		tps->tps_queue_size);
+}
+
 long ast_taskprocessor_size(struct ast_taskprocessor *tps)
 {
 	return (tps) ? tps->tps_queue_size : -1;
@@ -813,6 +1215,42 @@ struct ast_taskprocessor *ast_taskprocessor_get(const char *name, enum ast_tps_o
 	return p;
 }
 
+struct ast_taskprocessor *ast_taskprocessor_get_pooled(const char *name, enum ast_tps_options create)
+{
+	struct ast_taskprocessor *p;
+	struct ast_taskprocessor_listener *listener;
+	struct pooled_taskprocessor_listener_pvt *pvt;
+
+	if (ast_strlen_zero(name)) {
+		ast_log(LOG_ERROR, "requesting a nameless taskprocessor!!!\n");
+		return NULL;
+	}
+	p = ao2_find(tps_singletons, name, OBJ_KEY);
+	if (p) {
+		return p;
+	}
+	if (create & TPS_REF_IF_EXISTS) {
+		/* calling function does not want a new taskprocessor to be created if it doesn't already exist */
+		return NULL;
+	}
+	/* Create a new taskprocessor executed by the shared worker pool. */
+	pvt = ast_calloc(1, sizeof(*pvt));
+	if (!pvt) {
+		return NULL;
+	}
+	listener = ast_taskprocessor_listener_alloc(&pooled_listener_callbacks, pvt);
+	if (!listener) {
+		ast_free(pvt);
+		return NULL;
+	}
+	pvt->listener = listener;
+
+	p = __allocate_taskprocessor(name, listener);
+
+	ao2_ref(listener, -1);
+	return p;
+}
+
 struct ast_taskprocessor *ast_taskprocessor_create_with_listener(const char *name, struct ast_taskprocessor_listener *listener)
 {
 	struct ast_taskprocessor *p = ao2_find(tps_singletons, name, OBJ_KEY);
@@ -877,6 +1315,8 @@ static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 		return -1;
 	}
 
+	t->enqueued_ns = tps_now_ns();
+
 	ao2_lock(tps);
 	AST_LIST_INSERT_TAIL(&tps->tps_queue, t, list);
 	previous_size = tps->tps_queue_size++;
@@ -910,6 +1350,59 @@ int ast_taskprocessor_push_local(struct ast_taskprocessor *tps, int (*task_exe)(
 	return taskprocessor_push(tps, tps_task_alloc_local(task_exe, datap));
 }
 
+int ast_taskprocessor_push_multiple(struct ast_taskprocessor *tps,
+	const struct ast_taskprocessor_batch_task *tasks, size_t num)
+{
+	AST_LIST_HEAD_NOLOCK(, tps_task) batch = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct tps_task *t;
+	size_t idx;
+	int previous_size;
+	int was_empty;
+
+	if (!tps) {
+		ast_log(LOG_ERROR, "tps is NULL!\n");
+		return -1;
+	}
+	if (!num) {
+		return 0;
+	}
+
+	/* Allocate everything up front so the queue lock is taken exactly once. */
+	for (idx = 0; idx < num; ++idx) {
+		t = tps_task_alloc(tasks[idx].execute, tasks[idx].datap);
+		if (!t) {
+			while ((t = AST_LIST_REMOVE_HEAD(&batch, list))) {
+				tps_task_free(t);
+			}
+			return -1;
+		}
+		AST_LIST_INSERT_TAIL(&batch, t, list);
+	}
+
+	ao2_lock(tps);
+	previous_size = tps->tps_queue_size;
+	AST_LIST_APPEND_LIST(&tps->tps_queue, &batch, list);
+	tps->tps_queue_size += num;
+
+	if (tps->tps_queue_high <= tps->tps_queue_size) {
+		if (!tps->high_water_warned) {
+			tps->high_water_warned = 1;
+			ast_log(LOG_WARNING, "The '%s' task processor queue reached %ld scheduled tasks.\n",
+				tps->name, tps->tps_queue_size);
+		}
+		if (!tps->high_water_alert) {
+			tps->high_water_alert = 1;
+			tps_alert_add(tps, +1);
+		}
+	}
+
+	/* The currently executing task counts as still in queue */
+	was_empty = tps->executing ? 0 : previous_size == 0;
+	ao2_unlock(tps);
+	tps->listener->callbacks->task_pushed(tps->listener, was_empty);
+	return 0;
+}
+
 int ast_taskprocessor_suspend(struct ast_taskprocessor *tps)
 {
 	if (tps) {
@@ -942,6 +1435,7 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	struct ast_taskprocessor_local local;
 	struct tps_task *t;
 	long size;
+	uint64_t alarm_latency_ns = 0;
 
 	ao2_lock(tps);
 	t = tps_taskprocessor_pop(tps);
@@ -950,6 +1444,10 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 		return 0;
 	}
 
+	if (tps_record_latency(tps, t, tps_now_ns())) {
+		alarm_latency_ns = tps_now_ns() - t->enqueued_ns;
+	}
+
 	tps->thread = pthread_self();
 	tps->executing = 1;
 
@@ -959,11 +1457,17 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	}
 	ao2_unlock(tps);
 
+	if (alarm_latency_ns) {
+		tps_latency_alarm(tps, alarm_latency_ns);
+	}
+
+	ast_sdt_probe2(taskprocessor_task_start, tps->name, t->callback.execute);
 	if (t->wants_local) {
 		t->callback.execute_local(&local);
 	} else {
 		t->callback.execute(t->datap);
 	}
+	ast_sdt_probe1(taskprocessor_task_end, tps->name);
 	tps_task_free(t);
 
 	ao2_lock(tps);
@@ -993,6 +1497,82 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	return size > 0;
 }
 
+int ast_taskprocessor_execute_batch(struct ast_taskprocessor *tps, unsigned int limit)
+{
+	struct ast_taskprocessor_local local;
+	AST_LIST_HEAD_NOLOCK(, tps_task) run = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct tps_task *t;
+	void *local_data;
+	unsigned int ran = 0;
+	long size;
+	uint64_t now_ns;
+	uint64_t alarm_latency_ns = 0;
+
+	/* Pop a run of tasks under a single lock acquisition. */
+	ao2_lock(tps);
+	now_ns = tps_now_ns();
+	while (ran < limit && (t = tps_taskprocessor_pop(tps))) {
+		if (tps_record_latency(tps, t, now_ns)
+			&& now_ns - t->enqueued_ns > alarm_latency_ns) {
+			alarm_latency_ns = now_ns - t->enqueued_ns;
+		}
+		AST_LIST_INSERT_TAIL(&run, t, list);
+		++ran;
+	}
+	if (!ran) {
+		ao2_unlock(tps);
+		return 0;
+	}
+
+	tps->thread = pthread_self();
+	tps->executing = 1;
+	local_data = tps->local_data;
+	ao2_unlock(tps);
+
+	if (alarm_latency_ns) {
+		tps_latency_alarm(tps, alarm_latency_ns);
+	}
+
+	while ((t = AST_LIST_REMOVE_HEAD(&run, list))) {
+		ast_sdt_probe2(taskprocessor_task_start, tps->name, t->callback.execute);
+		if (t->wants_local) {
+			local.local_data = local_data;
+			local.data = t->datap;
+			t->callback.execute_local(&local);
+		} else {
+			t->callback.execute(t->datap);
+		}
+		ast_sdt_probe1(taskprocessor_task_end, tps->name);
+		tps_task_free(t);
+	}
+
+	ao2_lock(tps);
+	tps->thread = AST_PTHREADT_NULL;
+	/* We need to check size in the same critical section where we reset the
+	 * executing bit. Avoids a race condition where a task is pushed right
+	 * after we pop an empty stack.
+	 */
+	tps->executing = 0;
+	size = ast_taskprocessor_size(tps);
+
+	/* Update the stats */
+	if (tps->stats) {
+		tps->stats->_tasks_processed_count += ran;
+
+		/* Include the tasks we just executed as part of the queue size. */
+		if (size >= tps->stats->max_qsize) {
+			tps->stats->max_qsize = size + 1;
+		}
+	}
+	ao2_unlock(tps);
+
+	/* If we executed a task, check for the transition to empty */
+	if (size == 0 && tps->listener->callbacks->emptied) {
+		tps->listener->callbacks->emptied(tps->listener);
+	}
+	return ran;
+}
+
 int ast_taskprocessor_is_task(struct ast_taskprocessor *tps)
 {
 	int is_task;
@@ -108,6 +108,18 @@ void ast_tcptls_stream_set_exclusive_input(struct ast_tcptls_stream *stream, int
 	stream->exclusive_input = exclusive_input;
 }
 
+int ast_tcptls_stream_pending(struct ast_tcptls_stream *stream)
+{
+	ast_assert(stream != NULL);
+
+#if defined(DO_SSL)
+	if (stream->ssl) {
+		return SSL_pending(stream->ssl) > 0;
+	}
+#endif	/* defined(DO_SSL) */
+	return 0;
+}
+
 /*!
  * \internal
  * \brief fopencookie()/funopen() stream read function.
@@ -890,6 +902,20 @@ static int __ssl_setup(struct ast_tls_config *cfg, int client)
 		ast_test_flag(&cfg->flags, AST_SSL_VERIFY_CLIENT) ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_NONE,
 		NULL);
 
+	if (!client) {
+		/* Enable server side session caching so reconnecting clients can
+		 * resume their previous session and skip the expensive asymmetric
+		 * crypto of a full handshake.  OpenSSL refuses to resume a session
+		 * when client certificates are verified unless a session id context
+		 * is set, so always set one.
+		 */
+		static const unsigned char session_id_context[] = "asterisk";
+
+		SSL_CTX_set_session_id_context(cfg->ssl_ctx, session_id_context,
+			sizeof(session_id_context) - 1);
+		SSL_CTX_set_session_cache_mode(cfg->ssl_ctx, SSL_SESS_CACHE_SERVER);
+	}
+
 	if (!ast_strlen_zero(cfg->certfile)) {
 		char *tmpprivate = ast_strlen_zero(cfg->pvtfile) ? cfg->certfile : cfg->pvtfile;
 		if (SSL_CTX_use_certificate_chain_file(cfg->ssl_ctx, cfg->certfile) == 0) {
@@ -1120,6 +1146,7 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 	}
 
 	if (desc->accept_fd != -1) {
+		ast_listener_fd_unregister(desc->accept_fd);
 		close(desc->accept_fd);
 	}
 
@@ -1129,24 +1156,30 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 		return;
 	}
 
-	desc->accept_fd = socket(ast_sockaddr_is_ipv6(&desc->local_address) ?
-				 AF_INET6 : AF_INET, SOCK_STREAM, 0);
-	if (desc->accept_fd < 0) {
-		ast_log(LOG_ERROR, "Unable to allocate socket for %s: %s\n", desc->name, strerror(errno));
-		return;
-	}
+	desc->accept_fd = ast_listener_fd_acquire(&desc->local_address);
+	if (desc->accept_fd != -1) {
+		ast_verb(2, "Resuming inherited %s listener on %s\n",
+			desc->name, ast_sockaddr_stringify(&desc->local_address));
+	} else {
+		desc->accept_fd = socket(ast_sockaddr_is_ipv6(&desc->local_address) ?
+					 AF_INET6 : AF_INET, SOCK_STREAM, 0);
+		if (desc->accept_fd < 0) {
+			ast_log(LOG_ERROR, "Unable to allocate socket for %s: %s\n", desc->name, strerror(errno));
+			return;
+		}
 
-	setsockopt(desc->accept_fd, SOL_SOCKET, SO_REUSEADDR, &x, sizeof(x));
-	if (ast_bind(desc->accept_fd, &desc->local_address)) {
-		ast_log(LOG_ERROR, "Unable to bind %s to %s: %s\n",
-			desc->name,
-			ast_sockaddr_stringify(&desc->local_address),
-			strerror(errno));
-		goto error;
-	}
-	if (listen(desc->accept_fd, 10)) {
-		ast_log(LOG_ERROR, "Unable to listen for %s!\n", desc->name);
-		goto error;
+		setsockopt(desc->accept_fd, SOL_SOCKET, SO_REUSEADDR, &x, sizeof(x));
+		if (ast_bind(desc->accept_fd, &desc->local_address)) {
+			ast_log(LOG_ERROR, "Unable to bind %s to %s: %s\n",
+				desc->name,
+				ast_sockaddr_stringify(&desc->local_address),
+				strerror(errno));
+			goto error;
+		}
+		if (listen(desc->accept_fd, 10)) {
+			ast_log(LOG_ERROR, "Unable to listen for %s!\n", desc->name);
+			goto error;
+		}
 	}
 	flags = fcntl(desc->accept_fd, F_GETFL);
 	fcntl(desc->accept_fd, F_SETFL, flags | O_NONBLOCK);
@@ -1158,6 +1191,8 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 		goto error;
 	}
 
+	ast_listener_fd_register(desc->accept_fd, &desc->local_address);
+
 	/* Set current info */
 	ast_sockaddr_copy(&desc->old_address, &desc->local_address);
 
@@ -1202,6 +1237,7 @@ void ast_tcptls_server_stop(struct ast_tcptls_session_args *desc)
 		desc->master = AST_PTHREADT_NULL;
 	}
 	if (desc->accept_fd != -1) {
+		ast_listener_fd_unregister(desc->accept_fd);
 		close(desc->accept_fd);
 	}
 	desc->accept_fd = -1;
@@ -34,6 +34,8 @@
 #include "asterisk/_private.h"
 
 #ifdef TEST_FRAMEWORK
+#include <inttypes.h>
+
 #include "asterisk/test.h"
 #include "asterisk/logger.h"
 #include "asterisk/linkedlists.h"
@@ -267,6 +269,80 @@ void ast_test_set_result(struct ast_test *test, enum ast_test_result_state state
 	test->state = state;
 }
 
+/*!
+ * \internal
+ * \brief qsort comparator for benchmark samples
+ */
+static int benchmark_sample_cmp(const void *a, const void *b)
+{
+	const uint64_t *left = a;
+	const uint64_t *right = b;
+
+	if (*left < *right) {
+		return -1;
+	}
+	return *left > *right;
+}
+
+/*!
+ * \internal
+ * \brief Read the monotonic clock in nanoseconds
+ */
+static uint64_t benchmark_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int ast_test_benchmark(struct ast_test *test, const char *label,
+	unsigned int warmup, unsigned int iterations,
+	void (*run)(void *data), void *data)
+{
+	uint64_t *samples;
+	uint64_t total = 0;
+	unsigned int i;
+
+	if (!iterations) {
+		return -1;
+	}
+
+	samples = ast_calloc(iterations, sizeof(*samples));
+	if (!samples) {
+		return -1;
+	}
+
+	for (i = 0; i < warmup; i++) {
+		run(data);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		uint64_t start = benchmark_now_ns();
+
+		run(data);
+		samples[i] = benchmark_now_ns() - start;
+		total += samples[i];
+	}
+
+	qsort(samples, iterations, sizeof(*samples), benchmark_sample_cmp);
+
+	ast_test_status_update(test,
+		"%s: %u iterations: min %" PRIu64 "ns, mean %" PRIu64 "ns, "
+		"median %" PRIu64 "ns, p99 %" PRIu64 "ns, max %" PRIu64 "ns\n",
+		label, iterations,
+		samples[0],
+		total / iterations,
+		samples[iterations / 2],
+		samples[iterations * 99ULL / 100],
+		samples[iterations - 1]);
+
+	ast_free(samples);
+
+	return 0;
+}
+
 static void test_xml_entry(struct ast_test *test, FILE *f)
 {
 	if (!f || !test || test->state == AST_TEST_NOT_RUN) {
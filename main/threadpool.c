@@ -27,6 +27,15 @@
 /* Needs to stay prime if increased */
 #define THREAD_BUCKETS 89
 
+/*! Largest run of tasks a worker executes per shutdown check. */
+#define THREADPOOL_BATCH_MAX 16
+
+/*! Shortest and longest park interval for idle worker threads.  Idle
+ * workers recheck the queue when a park interval expires, doubling the
+ * interval each time so long-idle pools approach zero polling cost. */
+#define THREADPOOL_PARK_MIN_MS 100
+#define THREADPOOL_PARK_MAX_MS 5000
+
 /*!
  * \brief An opaque threadpool structure
  *
@@ -96,6 +105,15 @@ struct ast_threadpool {
 	struct ast_taskprocessor *control_tps;
 	/*! True if the threadpool is in the process of shutting down */
 	int shutting_down;
+	/*!
+	 * \brief True while a queued_task_pushed control task is pending.
+	 *
+	 * Wakeup control tasks are coalesced: while one is queued but has
+	 * not yet run, further pushes do not queue another, since the
+	 * pending wakeup will see their tasks as well.  Protected by the
+	 * pool lock.
+	 */
+	int wakeup_pending;
 	/*! Threadpool-specific options */
 	struct ast_threadpool_options options;
 };
@@ -341,14 +359,14 @@ static void threadpool_idle_thread_dead(struct ast_threadpool *pool,
  *
  * \param pool The pool to which the tasks belong.
  * \retval 0 Either the pool has been shut down or there are no tasks.
- * \retval 1 There are still tasks remaining in the pool.
+ * \return The number of tasks executed from the batch otherwise.
  */
 static int threadpool_execute(struct ast_threadpool *pool)
 {
 	ao2_lock(pool);
 	if (!pool->shutting_down) {
 		ao2_unlock(pool);
-		return ast_taskprocessor_execute(pool->tps);
+		return ast_taskprocessor_execute_batch(pool->tps, THREADPOOL_BATCH_MAX);
 	}
 	ao2_unlock(pool);
 	return 0;
@@ -495,6 +513,30 @@ static int activate_thread(void *obj, void *arg, int flags)
 	return CMP_MATCH;
 }
 
+/*!
+ * \brief Activate up to a set number of idle threads
+ *
+ * Works like \ref activate_thread but stops once the counter reaches
+ * zero, so a coalesced wakeup activates only as many workers as there
+ * are queued tasks instead of emptying the idle container.
+ *
+ * Called as an ao2_callback_data in the threadpool's control taskprocessor thread.
+ * \param obj The worker to activate
+ * \param arg The pool where the worker belongs
+ * \param data The counter
+ * \retval CMP_MATCH The activated thread should be unlinked from the idle container
+ * \retval CMP_STOP The counter has reached zero so no more threads should be activated
+ */
+static int activate_threads_count(void *obj, void *arg, void *data, int flags)
+{
+	int *num_to_activate = data;
+
+	if ((*num_to_activate)-- > 0) {
+		return activate_thread(obj, arg, flags);
+	}
+	return CMP_STOP;
+}
+
 /*!
  * \brief Add threads to the threadpool
  *
@@ -548,19 +590,33 @@ static int queued_task_pushed(void *data)
 	struct ast_threadpool *pool = tpd->pool;
 	int was_empty = tpd->was_empty;
 	unsigned int existing_active;
+	int to_activate;
+
+	/* Clear the coalescing flag before looking at the queue so a push
+	 * racing with this task queues a fresh wakeup for itself. */
+	ao2_lock(pool);
+	pool->wakeup_pending = 0;
+	ao2_unlock(pool);
 
 	if (pool->listener && pool->listener->callbacks->task_pushed) {
 		pool->listener->callbacks->task_pushed(pool, pool->listener, was_empty);
 	}
 
+	/* A single coalesced wakeup may stand for several pushes, so
+	 * activate one idle thread per queued task. */
+	to_activate = ast_taskprocessor_size(pool->tps);
+	if (to_activate < 1) {
+		to_activate = 1;
+	}
+
 	existing_active = ao2_container_count(pool->active_threads);
 
 	/* The first pass transitions any existing idle threads to be active, and
 	 * will also remove any worker threads that have recently entered the dead
 	 * state.
 	 */
-	ao2_callback(pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA,
-			activate_thread, pool);
+	ao2_callback_data(pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
+			activate_threads_count, pool, &to_activate);
 
 	/* If no idle threads could be transitioned to active grow the pool as permitted. */
 	if (ao2_container_count(pool->active_threads) == existing_active) {
@@ -570,8 +626,12 @@ static int queued_task_pushed(void *data)
 		}
 		grow(pool, pool->options.auto_increment);
 		/* An optional second pass transitions any newly added threads. */
-		ao2_callback(pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA,
-				activate_thread, pool);
+		to_activate = ast_taskprocessor_size(pool->tps);
+		if (to_activate < 1) {
+			to_activate = 1;
+		}
+		ao2_callback_data(pool->idle_threads, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
+				activate_threads_count, pool, &to_activate);
 	}
 
 	threadpool_send_state_changed(pool);
@@ -598,11 +658,44 @@ static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listen
 	if (pool->shutting_down) {
 		return;
 	}
+	if (pool->wakeup_pending
+		&& !(pool->listener && pool->listener->callbacks->task_pushed)) {
+		/* A queued wakeup has not run yet; it will see this task too.
+		 * Pools with a task_pushed listener callback still get one
+		 * control task per push so the listener hears every push. */
+		return;
+	}
 	tpd = task_pushed_data_alloc(pool, was_empty);
 	if (!tpd) {
 		return;
 	}
 
+	pool->wakeup_pending = 1;
+	ast_taskprocessor_push(pool->control_tps, queued_task_pushed, tpd);
+}
+
+/*!
+ * \brief Request a wakeup pass on behalf of a parked worker thread
+ *
+ * Called by an idle worker that noticed queued tasks while no wakeup
+ * control task was pending.  This is the backstop that keeps the pool
+ * work conserving now that wakeup control tasks are coalesced.
+ * \param pool The threadpool the parked worker belongs to
+ */
+static void threadpool_request_wakeup(struct ast_threadpool *pool)
+{
+	struct task_pushed_data *tpd;
+	SCOPED_AO2LOCK(lock, pool);
+
+	if (pool->shutting_down || pool->wakeup_pending) {
+		return;
+	}
+	tpd = task_pushed_data_alloc(pool, 0);
+	if (!tpd) {
+		return;
+	}
+
+	pool->wakeup_pending = 1;
 	ast_taskprocessor_push(pool->control_tps, queued_task_pushed, tpd);
 }
 
@@ -1121,16 +1214,42 @@ static void worker_active(struct worker_thread *worker)
 static int worker_idle(struct worker_thread *worker)
 {
 	struct timeval start = ast_tvnow();
-	struct timespec end = {
-		.tv_sec = start.tv_sec + worker->options.idle_timeout,
-		.tv_nsec = start.tv_usec * 1000,
-	};
+	int park_ms = THREADPOOL_PARK_MIN_MS;
+
 	while (!worker->wake_up) {
+		struct timeval deadline;
+		struct timespec park;
+		int64_t remaining_ms;
+
 		if (worker->options.idle_timeout <= 0) {
 			ast_cond_wait(&worker->cond, &worker->lock);
-		} else if (ast_cond_timedwait(&worker->cond, &worker->lock, &end) == ETIMEDOUT) {
+			continue;
+		}
+
+		remaining_ms = worker->options.idle_timeout * 1000LL
+			- ast_tvdiff_ms(ast_tvnow(), start);
+		if (remaining_ms <= 0) {
 			break;
 		}
+
+		/* Park in exponentially growing intervals rather than one
+		 * long wait.  Each expiry rechecks the task queue so a parked
+		 * worker can request activation if a coalesced wakeup left
+		 * work behind, while long-idle workers wake ever more rarely.
+		 */
+		deadline = ast_tvadd(ast_tvnow(),
+			ast_samp2tv(MIN(park_ms, remaining_ms), 1000));
+		park.tv_sec = deadline.tv_sec;
+		park.tv_nsec = deadline.tv_usec * 1000;
+		if (ast_cond_timedwait(&worker->cond, &worker->lock, &park) == ETIMEDOUT) {
+			if (!worker->wake_up
+				&& ast_taskprocessor_size(worker->pool->tps) > 0) {
+				threadpool_request_wakeup(worker->pool);
+			}
+			if (park_ms < THREADPOOL_PARK_MAX_MS) {
+				park_ms *= 2;
+			}
+		}
 	}
 
 	if (!worker->wake_up) {
@@ -53,6 +53,9 @@
 /*! max sample recalc */
 #define MAX_RECALC 1000
 
+/*! how many ready-built translation paths may be parked per format pair */
+#define PATH_POOL_DEPTH 4
+
 /*! \brief the list of translators */
 static AST_RWLIST_HEAD_STATIC(translators, ast_translator);
 
@@ -60,6 +63,9 @@ struct translator_path {
 	struct ast_translator *step;       /*!< Next step translator */
 	uint32_t table_cost;               /*!< Complete table cost to destination */
 	uint8_t multistep;                 /*!< Multiple conversions required for this translation */
+	/*! Constructed, currently idle pvt chains for this exact format pair,
+	 * ready to be handed out again; protected by path_pool_lock */
+	struct ast_trans_pvt *pool[PATH_POOL_DEPTH];
 };
 
 /*!
@@ -96,6 +102,16 @@ static int cur_max_index;
 static int index_size;
 
 static void matrix_rebuild(int samples);
+static void path_pool_flush(int size);
+
+/*!
+ * \brief protects the pooled translation paths stowed in the __matrix cells.
+ *
+ * This lock also keeps __matrix itself stable for ast_translator_free_path(),
+ * which pushes paths back into the pool without holding the translators list
+ * lock; every swap or teardown of the matrix holds it across the switch.
+ */
+AST_MUTEX_DEFINE_STATIC(path_pool_lock);
 
 /*!
  * \internal
@@ -225,7 +241,9 @@ static int matrix_resize(int init)
 	}
 
 	/* if everything went well this far, free the old and use the new */
+	ast_mutex_lock(&path_pool_lock);
 	if (!init) {
+		path_pool_flush(old_index);
 		for (x = 0; x < old_index; x++) {
 			ast_free(__matrix[x]);
 		}
@@ -238,6 +256,7 @@ static int matrix_resize(int init)
 	/* now copy them over */
 	__matrix = tmp_matrix;
 	__indextable = tmp_table;
+	ast_mutex_unlock(&path_pool_lock);
 
 	matrix_rebuild(0);
 	ast_rwlock_unlock(&tablelock);
@@ -268,9 +287,14 @@ resize_cleanup:
 static void matrix_clear(void)
 {
 	int x;
+
+	ast_mutex_lock(&path_pool_lock);
+	/* Whatever invalidated the matrix invalidates the pooled paths too */
+	path_pool_flush(index_size);
 	for (x = 0; x < index_size; x++) {
 		memset(__matrix[x], '\0', sizeof(struct translator_path) * (index_size));
 	}
+	ast_mutex_unlock(&path_pool_lock);
 }
 
 /*!
@@ -304,6 +328,137 @@ static void destroy(struct ast_trans_pvt *pvt)
 	ast_module_unref(t->module);
 }
 
+/*!
+ * \internal
+ * \brief tear down a translation path without offering it back to the pool
+ */
+static void path_destroy(struct ast_trans_pvt *p)
+{
+	struct ast_trans_pvt *pn = p;
+
+	while ((p = pn)) {
+		pn = p->next;
+		destroy(p);
+	}
+}
+
+/*!
+ * \internal
+ * \brief destroy every pooled path in the first size x size cells of the matrix
+ *
+ * \note This function must be protected by path_pool_lock
+ */
+static void path_pool_flush(int size)
+{
+	int x, y, z;
+
+	for (x = 0; x < size; x++) {
+		for (y = 0; y < size; y++) {
+			struct translator_path *entry = __matrix[x] + y;
+
+			for (z = 0; z < PATH_POOL_DEPTH; z++) {
+				if (entry->pool[z]) {
+					path_destroy(entry->pool[z]);
+					entry->pool[z] = NULL;
+				}
+			}
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief fetch a pooled translation path for the given format pair, if one fits
+ *
+ * Pooled paths always agree with the current matrix, because the pool is
+ * flushed whenever the matrix changes; the only thing left to check is that
+ * the chain ends in what this caller considers the destination, since format
+ * attributes can differ between calls.
+ */
+static struct ast_trans_pvt *path_pool_get(int src_index, int dst_index, struct ast_format *dst)
+{
+	struct translator_path *entry;
+	struct ast_trans_pvt *head = NULL;
+	struct ast_trans_pvt *cur;
+	int x;
+
+	ast_mutex_lock(&path_pool_lock);
+	entry = matrix_get(src_index, dst_index);
+	for (x = 0; x < PATH_POOL_DEPTH; x++) {
+		struct ast_trans_pvt *tail;
+
+		if (!entry->pool[x]) {
+			continue;
+		}
+		for (tail = entry->pool[x]; tail->next; tail = tail->next) {
+		}
+		if (ast_format_cmp(tail->f.subclass.format, dst) != AST_FORMAT_CMP_EQUAL) {
+			continue;
+		}
+		head = entry->pool[x];
+		entry->pool[x] = NULL;
+		break;
+	}
+	ast_mutex_unlock(&path_pool_lock);
+
+	if (!head) {
+		return NULL;
+	}
+
+	for (cur = head; cur; cur = cur->next) {
+		cur->samples = 0;
+		cur->datalen = 0;
+		cur->interleaved_stereo = 0;
+		cur->nextin = cur->nextout = ast_tv(0, 0);
+	}
+
+	return head;
+}
+
+/*!
+ * \internal
+ * \brief park a no-longer-used translation path for reuse, if it qualifies
+ *
+ * Only paths made purely of stateless translators (no private descriptor,
+ * no constructor or destructor) may be reused; anything carrying codec
+ * state must not leak that state into another call. This covers the
+ * g711 / slin style conversions that make up the bulk of path churn.
+ *
+ * \retval 0 the path was pooled and must not be touched again
+ * \retval -1 the caller still owns the path
+ */
+static int path_pool_put(struct ast_trans_pvt *head)
+{
+	struct ast_trans_pvt *cur;
+	struct ast_trans_pvt *tail = NULL;
+	struct translator_path *entry;
+	int x;
+
+	for (cur = head; cur; cur = cur->next) {
+		if (cur->t->desc_size || cur->t->newpvt || cur->t->destroy || cur->plc) {
+			return -1;
+		}
+		tail = cur;
+	}
+
+	ast_mutex_lock(&path_pool_lock);
+	if (!__matrix) {
+		ast_mutex_unlock(&path_pool_lock);
+		return -1;
+	}
+	entry = matrix_get(head->t->src_fmt_index, tail->t->dst_fmt_index);
+	for (x = 0; x < PATH_POOL_DEPTH; x++) {
+		if (!entry->pool[x]) {
+			entry->pool[x] = head;
+			ast_mutex_unlock(&path_pool_lock);
+			return 0;
+		}
+	}
+	ast_mutex_unlock(&path_pool_lock);
+
+	return -1;
+}
+
 /*!
  * \brief Allocate the descriptor, required outbuf space,
  * and possibly desc.
@@ -459,11 +614,14 @@ static struct ast_frame *default_frameout(struct ast_trans_pvt *pvt)
 
 void ast_translator_free_path(struct ast_trans_pvt *p)
 {
-	struct ast_trans_pvt *pn = p;
-	while ( (p = pn) ) {
-		pn = p->next;
-		destroy(p);
+	if (!p) {
+		return;
 	}
+	if (!path_pool_put(p)) {
+		/* Parked for the next ast_translator_build_path() of this pair */
+		return;
+	}
+	path_destroy(p);
 }
 
 /*! \brief Build a chain of translators based upon the given source and dest formats */
@@ -482,6 +640,11 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 
 	AST_RWLIST_RDLOCK(&translators);
 
+	if ((head = path_pool_get(src_index, dst_index, dst))) {
+		AST_RWLIST_UNLOCK(&translators);
+		return head;
+	}
+
 	while (src_index != dst_index) {
 		struct ast_trans_pvt *cur;
 		struct ast_format *explicit_dst = NULL;
@@ -1502,6 +1665,8 @@ static void translate_shutdown(void)
 	ast_cli_unregister_multiple(cli_translate, ARRAY_LEN(cli_translate));
 
 	ast_rwlock_wrlock(&tablelock);
+	ast_mutex_lock(&path_pool_lock);
+	path_pool_flush(index_size);
 	for (x = 0; x < index_size; x++) {
 		ast_free(__matrix[x]);
 	}
@@ -1509,6 +1674,7 @@ static void translate_shutdown(void)
 	__matrix = NULL;
 	ast_free(__indextable);
 	__indextable = NULL;
+	ast_mutex_unlock(&path_pool_lock);
 	ast_rwlock_unlock(&tablelock);
 	ast_rwlock_destroy(&tablelock);
 }
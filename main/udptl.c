@@ -601,7 +601,10 @@ static int udptl_rx_packet(struct ast_udptl *s, uint8_t *buf, unsigned int len)
 
 static int udptl_build_packet(struct ast_udptl *s, uint8_t *buf, unsigned int buflen, uint8_t *ifp, unsigned int ifp_len)
 {
-	uint8_t fec[LOCAL_FAX_MAX_DATAGRAM * 2] = { 0, };
+	/* FEC scratch space. The high tide logic below assigns every octet
+	   up to the length that is sent, so the buffer does not need to be
+	   cleared up front. */
+	uint8_t fec[LOCAL_FAX_MAX_DATAGRAM * 2];
 	int i;
 	int j;
 	int seq;
@@ -1148,10 +1151,10 @@ int ast_udptl_write(struct ast_udptl *s, struct ast_frame *f)
 	unsigned int len = f->datalen;
 	/* if no max datagram size is provided, use default value */
 	const int bufsize = (s->far_max_datagram > 0) ? s->far_max_datagram : DEFAULT_FAX_MAX_DATAGRAM;
+	/* udptl_build_packet writes every octet it emits, so the buffer does
+	   not need to be cleared up front */
 	uint8_t buf[bufsize];
 
-	memset(buf, 0, sizeof(buf));
-
 	/* If we have no peer, return immediately */
 	if (ast_sockaddr_isnull(&s->them)) {
 		return 0;
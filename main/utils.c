@@ -1198,6 +1198,41 @@ static struct ast_cli_entry utils_cli[] = {
 #endif /* ! LOW_MEMORY */
 #endif /* DEBUG_THREADS */
 
+#if !defined(LOW_MEMORY)
+static char *handle_show_lock_contention(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_str *str;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show lock contention";
+		e->usage =
+			"Usage: core show lock contention\n"
+			"       Prints a rollup of sampled contended lock acquisitions\n"
+			"       across all threads, worst total wait first.\n";
+		return NULL;
+
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	str = ast_lock_contention_report();
+	if (!str) {
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, "%s", ast_str_buffer(str));
+
+	ast_free(str);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry lock_contention_cli[] = {
+	AST_CLI_DEFINE(handle_show_lock_contention, "Show sampled lock contention hot spots"),
+};
+#endif /* ! LOW_MEMORY */
+
 #if !defined(LOW_MEMORY)
 /*
  * support for 'show threads'. The start routine is wrapped by
@@ -2274,6 +2309,9 @@ int ast_utils_init(void)
 #if !defined(LOW_MEMORY)
 	ast_cli_register_multiple(utils_cli, ARRAY_LEN(utils_cli));
 #endif
+#endif
+#if !defined(LOW_MEMORY)
+	ast_cli_register_multiple(lock_contention_cli, ARRAY_LEN(lock_contention_cli));
 #endif
 	ast_register_cleanup(utils_shutdown);
 	return 0;
@@ -2401,22 +2439,6 @@ int ast_parse_digest(const char *digest, struct ast_http_digest *d, int request,
 	return 0;
 }
 
-#ifndef __AST_DEBUG_MALLOC
-int __ast_asprintf(const char *file, int lineno, const char *func, char **ret, const char *fmt, ...)
-{
-	int res;
-	va_list ap;
-
-	va_start(ap, fmt);
-	if ((res = vasprintf(ret, fmt, ap)) == -1) {
-		MALLOC_FAILURE_MSG;
-	}
-	va_end(ap);
-
-	return res;
-}
-#endif
-
 int ast_get_tid(void)
 {
 	int ret = -1;
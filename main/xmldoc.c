@@ -35,6 +35,7 @@
 #include "asterisk/config.h"
 #include "asterisk/term.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/vector.h"
 #include "asterisk/xmldoc.h"
 #include "asterisk/cli.h"
 
@@ -74,6 +75,153 @@ static int xmldoc_parse_specialtags(struct ast_xml_node *fixnode, const char *ta
  */
 static AST_RWLIST_HEAD_STATIC(xmldoc_tree, documentation_tree);
 
+/*! \brief A single node reference held by \ref xmldoc_item_index. */
+struct xmldoc_index_node {
+	/*! The element node. */
+	struct ast_xml_node *node;
+	/*! Sequence number of the owning document, to preserve the priority
+	 *  of core documents over thirdparty ones. */
+	unsigned int doc_seq;
+};
+
+/*!
+ * \brief Index entry mapping a documentation item to the nodes defining it.
+ *
+ * Built once after all documents are loaded, so that item lookups during
+ * module registration do not have to walk every node of every document.
+ * The referenced nodes are owned by the open documents in \ref xmldoc_tree,
+ * which outlive the index.
+ */
+struct xmldoc_item_index {
+	/*! Nodes defining the item, in document load order. */
+	AST_VECTOR(, struct xmldoc_index_node) nodes;
+	/*! Index key, "<type>:<name>". */
+	char key[0];
+};
+
+/*! \brief Number of buckets for the item index. Prime number. */
+#define XMLDOC_INDEX_BUCKETS 563
+
+/*! \brief Item index container, or NULL to fall back to scanning the documents. */
+static struct ao2_container *xmldoc_item_index;
+
+static int xmldoc_item_index_hash(const void *obj, const int flags)
+{
+	const struct xmldoc_item_index *item = obj;
+	const char *key = (flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_KEY ? obj : item->key;
+
+	return ast_str_hash(key);
+}
+
+static int xmldoc_item_index_cmp(void *obj, void *arg, int flags)
+{
+	const struct xmldoc_item_index *left = obj;
+	const struct xmldoc_item_index *right = arg;
+	const char *key = (flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_KEY ? arg : right->key;
+
+	return strcmp(left->key, key) ? 0 : CMP_MATCH;
+}
+
+static void xmldoc_item_index_dtor(void *obj)
+{
+	struct xmldoc_item_index *item = obj;
+
+	AST_VECTOR_FREE(&item->nodes);
+}
+
+/*!
+ * \internal
+ * \brief Add one documentation element to the item index.
+ *
+ * Elements without a 'name' attribute (such as text nodes) are skipped.
+ *
+ * \retval 0 on success (including skipped elements)
+ * \retval -1 on failure
+ */
+static int xmldoc_index_node_add(struct ast_xml_node *node, unsigned int doc_seq)
+{
+	struct xmldoc_item_index *item;
+	struct xmldoc_index_node index_node = { node, doc_seq };
+	const char *name;
+	char *key;
+	int res;
+
+	name = ast_xml_get_attribute(node, "name");
+	if (!name) {
+		return 0;
+	}
+
+	res = ast_asprintf(&key, "%s:%s", ast_xml_node_get_name(node), name);
+	ast_xml_free_attr(name);
+	if (res < 0) {
+		return -1;
+	}
+
+	item = ao2_find(xmldoc_item_index, key, OBJ_SEARCH_KEY);
+	if (!item) {
+		item = ao2_alloc_options(sizeof(*item) + strlen(key) + 1,
+			xmldoc_item_index_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!item) {
+			ast_free(key);
+			return -1;
+		}
+		strcpy(item->key, key); /* Safe */
+		if (AST_VECTOR_INIT(&item->nodes, 1)) {
+			ao2_ref(item, -1);
+			ast_free(key);
+			return -1;
+		}
+		ao2_link(xmldoc_item_index, item);
+	}
+	ast_free(key);
+
+	res = AST_VECTOR_APPEND(&item->nodes, index_node);
+	ao2_ref(item, -1);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Build the item index from the loaded documentation trees.
+ *
+ * On failure the partial index is discarded and lookups fall back to
+ * scanning the documents.
+ *
+ * \note Assumes xmldoc_tree is locked on entry.
+ */
+static void xmldoc_build_item_index(void)
+{
+	struct documentation_tree *doctree;
+	unsigned int doc_seq = 0;
+
+	/* The index is built once, before anything can query it, and is
+	 * immutable afterwards, so it does not need its own lock. */
+	xmldoc_item_index = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		XMLDOC_INDEX_BUCKETS, xmldoc_item_index_hash, NULL, xmldoc_item_index_cmp);
+	if (!xmldoc_item_index) {
+		return;
+	}
+
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		struct ast_xml_node *node = ast_xml_get_root(doctree->doc);
+
+		if (!node) {
+			continue;
+		}
+
+		for (node = ast_xml_node_get_children(node); node; node = ast_xml_node_get_next(node)) {
+			if (xmldoc_index_node_add(node, doc_seq)) {
+				ao2_cleanup(xmldoc_item_index);
+				xmldoc_item_index = NULL;
+				return;
+			}
+		}
+
+		doc_seq++;
+	}
+}
+
 static const struct strcolorized_tags {
 	const char *init;      /*!< Replace initial tag with this string. */
 	const char *end;       /*!< Replace end tag with this string. */
@@ -439,6 +587,67 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 	struct documentation_tree *doctree;
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
+	if (xmldoc_item_index) {
+		struct xmldoc_item_index *item;
+		unsigned int match_seq = 0;
+		char *key;
+		size_t i;
+
+		if (ast_asprintf(&key, "%s:%s", type, name) < 0) {
+			AST_RWLIST_UNLOCK(&xmldoc_tree);
+			return NULL;
+		}
+		item = ao2_find(xmldoc_item_index, key, OBJ_SEARCH_KEY);
+		ast_free(key);
+
+		for (i = 0; item && i < AST_VECTOR_SIZE(&item->nodes); i++) {
+			struct xmldoc_index_node *idx = AST_VECTOR_GET_ADDR(&item->nodes, i);
+
+			/* As with the document scan below, only the first document
+			 * defining the item is considered. */
+			if (first_match && idx->doc_seq != match_seq) {
+				break;
+			}
+
+			if (!ast_xml_node_get_children(idx->node)) {
+				/* ignore empty nodes */
+				continue;
+			}
+
+			if (!first_match) {
+				first_match = idx->node;
+				match_seq = idx->doc_seq;
+			}
+
+			/* Check language */
+			if (xmldoc_attribute_match(idx->node, "language", language)) {
+				if (!lang_match) {
+					lang_match = idx->node;
+				}
+
+				/* if module is empty we have a match */
+				if (ast_strlen_zero(module)) {
+					node = idx->node;
+					break;
+				}
+
+				/* Check module */
+				if (xmldoc_attribute_match(idx->node, "module", module)) {
+					node = idx->node;
+					break;
+				}
+			}
+		}
+		ao2_cleanup(item);
+
+		if (!node) {
+			node = lang_match ? lang_match : first_match;
+		}
+		AST_RWLIST_UNLOCK(&xmldoc_tree);
+
+		return node;
+	}
+
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
 		/* the core xml documents have priority over thirdparty document. */
 		node = ast_xml_get_root(doctree->doc);
@@ -2822,6 +3031,9 @@ static void xmldoc_unload_documentation(void)
 	ast_cli_unregister(&cli_dump_xmldocs);
 
 	AST_RWLIST_WRLOCK(&xmldoc_tree);
+	/* The index references nodes owned by the documents, so it goes first. */
+	ao2_cleanup(xmldoc_item_index);
+	xmldoc_item_index = NULL;
 	while ((doctree = AST_RWLIST_REMOVE_HEAD(&xmldoc_tree, entry))) {
 		ast_free(doctree->filename);
 		ast_xml_close(doctree->doc);
@@ -2940,6 +3152,10 @@ int ast_xmldoc_load_documentation(void)
 		doc_tree->filename = ast_strdup(globbuf.gl_pathv[i]);
 		AST_RWLIST_INSERT_TAIL(&xmldoc_tree, doc_tree, entry);
 	}
+
+	/* Index the loaded items so registration-time lookups don't rescan
+	 * every document. */
+	xmldoc_build_item_index();
 	AST_RWLIST_UNLOCK(&xmldoc_tree);
 
 	globfree(&globbuf);
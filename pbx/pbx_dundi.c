@@ -68,6 +68,7 @@
 #include "asterisk/netsock2.h"
 #include "asterisk/crypto.h"
 #include "asterisk/astdb.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/acl.h"
 #include "asterisk/app.h"
 
@@ -192,6 +193,7 @@ static int authdebug = 0;
 static int dundi_ttl = DUNDI_DEFAULT_TTL;
 static int dundi_key_ttl = DUNDI_DEFAULT_KEY_EXPIRE;
 static int dundi_cache_time = DUNDI_DEFAULT_CACHE_TIME;
+static int dundi_quorum = 0;
 static int global_autokilltimeout = 0;
 static dundi_eid global_eid;
 static int default_expiration = 60;
@@ -210,6 +212,139 @@ static time_t rotatetime;
 static dundi_eid empty_eid = { { 0, 0, 0, 0, 0, 0 } };
 static int dundi_shutdown = 0;
 
+#define QUERY_CACHE_BUCKETS 53
+
+/*!
+ * \brief In-memory cache of completed lookup results.
+ *
+ * Consulted by dundi_lookup() before the astdb cache and any network
+ * query so repeated resolutions of the same number are answered
+ * without rebuilding a request.  Entries carry the expiration the
+ * peers reported and are immutable once linked; a fresh lookup
+ * replaces the old entry wholesale.  Pushed precache updates only
+ * reach astdb, so an entry may serve a slightly stale answer until
+ * its TTL runs out.
+ */
+struct query_cache_entry {
+	time_t expiration;                  /*!< Absolute time this entry becomes stale */
+	int respcount;                      /*!< Number of results stored */
+	char key[AST_MAX_EXTENSION * 2];    /*!< number@dcontext */
+	struct dundi_result results[0];
+};
+
+static struct ao2_container *query_cache;
+
+static int query_cache_hash(const void *obj, const int flags)
+{
+	const struct query_cache_entry *entry;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		key = entry->key;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_case_hash(key);
+}
+
+static int query_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct query_cache_entry *object_left = obj;
+	const struct query_cache_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(object_left->key, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+	return cmp ? 0 : CMP_MATCH | CMP_STOP;
+}
+
+static void query_cache_build_key(char *key, size_t keylen, const char *dcontext, const char *number)
+{
+	snprintf(key, keylen, "%s@%s", number, S_OR(dcontext, "e164"));
+}
+
+/*! \brief Serve a lookup from the in-memory cache, or return -1 on a miss. */
+static int query_cache_lookup(const char *dcontext, const char *number, struct dundi_result *result, int maxret)
+{
+	struct query_cache_entry *entry;
+	char key[AST_MAX_EXTENSION * 2];
+	int remaining;
+	int res;
+	int x;
+
+	if (!query_cache) {
+		return -1;
+	}
+	query_cache_build_key(key, sizeof(key), dcontext, number);
+	entry = ao2_find(query_cache, key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return -1;
+	}
+	remaining = entry->expiration - time(NULL);
+	if (remaining <= 0) {
+		/* Stale.  Drop it and fall through to the regular path. */
+		ao2_unlink(query_cache, entry);
+		ao2_ref(entry, -1);
+		return -1;
+	}
+	res = entry->respcount;
+	if (res > maxret) {
+		res = maxret;
+	}
+	for (x = 0; x < res; x++) {
+		result[x] = entry->results[x];
+		result[x].expiration = remaining;
+	}
+	ao2_ref(entry, -1);
+	return res;
+}
+
+static void query_cache_store(const char *dcontext, const char *number, const struct dundi_result *results, int respcount, int expiration)
+{
+	struct query_cache_entry *entry;
+
+	if (!query_cache || expiration <= 0 || respcount <= 0) {
+		return;
+	}
+	entry = ao2_alloc_options(sizeof(*entry) + respcount * sizeof(entry->results[0]),
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	query_cache_build_key(entry->key, sizeof(entry->key), dcontext, number);
+	entry->expiration = time(NULL) + expiration;
+	entry->respcount = respcount;
+	memcpy(entry->results, results, respcount * sizeof(entry->results[0]));
+	/* Replace any previous answer wholesale */
+	ao2_find(query_cache, entry->key, OBJ_SEARCH_KEY | OBJ_NODATA | OBJ_UNLINK);
+	ao2_link(query_cache, entry);
+	ao2_ref(entry, -1);
+}
+
+static void query_cache_flush(void)
+{
+	if (query_cache) {
+		ao2_callback(query_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+}
+
 struct permission {
 	AST_LIST_ENTRY(permission) list;
 	int allow;
@@ -2374,6 +2509,7 @@ static char *dundi_flush(struct ast_cli_entry *e, int cmd, struct ast_cli_args *
 		}
 		AST_LIST_UNLOCK(&peers);
 	} else {
+		query_cache_flush();
 		ast_db_deltree("dundi/cache", NULL);
 		ast_cli(a->fd, "DUNDi Cache Flushed\n");
 	}
@@ -3852,6 +3988,13 @@ static int dundi_lookup_internal(struct dundi_result *result, int maxret, struct
 	/* Wait for transaction to come back */
 	start = ast_tvnow();
 	while (!AST_LIST_EMPTY(&dr.trans) && (ast_tvdiff_ms(ast_tvnow(), start) < ttlms) && (!chan || !ast_check_hangup(chan))) {
+		if (dr.respcount >= dr.maxcount
+			|| (dundi_quorum > 0 && dr.respcount >= dundi_quorum)) {
+			/* We already have as many answers as we can use; cancel the
+			   outstanding transactions instead of waiting for every peer
+			   to come back or time out. */
+			break;
+		}
 		ms = 100;
 		ast_waitfor_n_fd(dr.pfds, 1, &ms, NULL);
 	}
@@ -3872,9 +4015,21 @@ int dundi_lookup(struct dundi_result *result, int maxret, struct ast_channel *ch
 	dundi_eid *avoid[1] = { NULL, };
 	int direct[1] = { 0, };
 	int expiration = dundi_cache_time;
+	int res;
+
+	if (!cbypass) {
+		res = query_cache_lookup(dcontext, number, result, maxret);
+		if (res >= 0) {
+			return res;
+		}
+	}
 	memset(&hmd, 0, sizeof(hmd));
 	hmd.flags = DUNDI_HINT_DONT_ASK | DUNDI_HINT_UNAFFECTED;
-	return dundi_lookup_internal(result, maxret, chan, dcontext, number, dundi_ttl, 0, &hmd, &expiration, cbypass, 0, NULL, avoid, direct);
+	res = dundi_lookup_internal(result, maxret, chan, dcontext, number, dundi_ttl, 0, &hmd, &expiration, cbypass, 0, NULL, avoid, direct);
+	if (res > 0) {
+		query_cache_store(dcontext, number, result, res, expiration);
+	}
+	return res;
 }
 
 static void reschedule_precache(const char *number, const char *context, int expiration)
@@ -4919,6 +5074,13 @@ static int set_config(char *config_file, struct sockaddr_in* sin, int reload)
 				ast_log(LOG_WARNING, "'%s' is not a valid cache time at line %d. Using default value '%d'.\n",
 					v->value, v->lineno, DUNDI_DEFAULT_CACHE_TIME);
 			}
+		} else if (!strcasecmp(v->name, "quorum")) {
+			if ((sscanf(v->value, "%30d", &x) == 1) && (x >= 0)) {
+				dundi_quorum = x;
+			} else {
+				ast_log(LOG_WARNING, "'%s' is not a valid quorum at line %d, must be a number of answers >= 0\n",
+					v->value, v->lineno);
+			}
 		}
 		v = v->next;
 	}
@@ -4982,6 +5144,9 @@ static int unload_module(void)
 	io_context_destroy(io);
 	ast_sched_context_destroy(sched);
 
+	ao2_cleanup(query_cache);
+	query_cache = NULL;
+
 	mark_mappings();
 	prune_mappings();
 	mark_peers();
@@ -5019,6 +5184,11 @@ static int load_module(void)
 		goto declined;
 	}
 
+	query_cache = ao2_container_alloc(QUERY_CACHE_BUCKETS, query_cache_hash, query_cache_cmp);
+	if (!query_cache) {
+		goto declined;
+	}
+
 	if (set_config("dundi.conf", &sin, 0)) {
 		goto declined;
 	}
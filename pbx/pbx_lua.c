@@ -97,6 +97,8 @@ static void lua_concat_args(lua_State *L, int start, int nargs);
 static void lua_state_destroy(void *data);
 static void lua_datastore_fixup(void *data, struct ast_channel *old_chan, struct ast_channel *new_chan);
 static lua_State *lua_get_state(struct ast_channel *chan);
+static void lua_release_state(lua_State *L);
+static void lua_pool_flush(void);
 
 static int exists(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
 static int canmatch(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
@@ -107,6 +109,19 @@ AST_MUTEX_DEFINE_STATIC(config_file_lock);
 static char *config_file_data = NULL;
 static long config_file_size = 0;
 
+/*! Pool of initialized channel-less states used for extension matching.
+ * These keep their loaded extensions table between calls, so checking
+ * one out only costs table lookups instead of a full state build. */
+struct lua_pool_state {
+	lua_State *L;
+	AST_LIST_ENTRY(lua_pool_state) list;
+};
+
+#define LUA_STATE_POOL_SIZE 10
+
+static AST_LIST_HEAD_STATIC(lua_state_pool, lua_pool_state);
+static int lua_state_pool_size = 0;
+
 static struct ast_context *local_contexts = NULL;
 static struct ast_hashtab *local_table = NULL;
 
@@ -1075,11 +1090,32 @@ static int lua_extension_cmp(lua_State *L)
  *
  * \return a pointer to the buffer
  */
+/*! \brief Accumulates the output of lua_dump() into a growing buffer */
+struct lua_dump_buffer {
+	char *data;
+	size_t size;
+};
+
+static int lua_dump_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+	struct lua_dump_buffer *buf = ud;
+	char *grown;
+
+	if (!(grown = ast_realloc(buf->data, buf->size + sz))) {
+		return 1;
+	}
+	memcpy(grown + buf->size, p, sz);
+	buf->data = grown;
+	buf->size += sz;
+	return 0;
+}
+
 static char *lua_read_extensions_file(lua_State *L, long *size)
 {
 	FILE *f;
 	int error_func;
 	char *data;
+	struct lua_dump_buffer buf = { NULL, 0 };
 	char *path = ast_alloca(strlen(config) + strlen(ast_config_AST_CONFIG_DIR) + 2);
 	sprintf(path, "%s/%s", ast_config_AST_CONFIG_DIR, config);
 
@@ -1126,14 +1162,38 @@ static char *lua_read_extensions_file(lua_State *L, long *size)
 	lua_pushcfunction(L, &lua_error_function);
 	error_func = lua_gettop(L);
 
-	if (luaL_loadbuffer(L, data, *size, "extensions.lua")
-			|| lua_pcall(L, 0, LUA_MULTRET, error_func)
+	if (luaL_loadbuffer(L, data, *size, "extensions.lua")) {
+		lua_remove(L, error_func);
+		ast_free(data);
+		*size = 0;
+		return NULL;
+	}
+
+	/* Precompile the chunk so per-call states load bytecode instead of
+	 * re-parsing the source.  On failure we just keep the source; both
+	 * forms load through luaL_loadbuffer(). */
+#if LUA_VERSION_NUM < 503
+	if (lua_dump(L, lua_dump_writer, &buf)) {
+#else
+	if (lua_dump(L, lua_dump_writer, &buf, 0)) {
+#endif
+		ast_free(buf.data);
+		buf.data = NULL;
+		buf.size = 0;
+	}
+
+	if (lua_pcall(L, 0, LUA_MULTRET, error_func)
 			|| lua_sort_extensions(L)
 			|| lua_register_switches(L)
 			|| lua_register_hints(L)) {
 		ast_free(data);
+		ast_free(buf.data);
 		data = NULL;
 		*size = 0;
+	} else if (buf.data) {
+		ast_free(data);
+		data = buf.data;
+		*size = buf.size;
 	}
 
 	lua_remove(L, error_func);
@@ -1224,6 +1284,10 @@ static int lua_reload_extensions(lua_State *L)
 	local_contexts = NULL;
 
 	ast_mutex_unlock(&config_file_lock);
+
+	/* Pooled states were built from the old extensions chunk. */
+	lua_pool_flush();
+
 	return 0;
 }
 
@@ -1238,16 +1302,68 @@ static void lua_free_extensions()
 	ast_mutex_unlock(&config_file_lock);
 }
 
+/*!
+ * \brief Return a channel-less lua_State to the pool
+ *
+ * \param L a state obtained from lua_get_state() with no channel
+ *
+ * The state keeps its loaded extensions table so the next checkout skips
+ * the state build entirely.  If the pool is already full the state is
+ * closed instead.
+ */
+static void lua_release_state(lua_State *L)
+{
+	struct lua_pool_state *state;
+
+	lua_settop(L, 0);
+
+	if (!(state = ast_malloc(sizeof(*state)))) {
+		lua_close(L);
+		return;
+	}
+	state->L = L;
+
+	AST_LIST_LOCK(&lua_state_pool);
+	if (lua_state_pool_size < LUA_STATE_POOL_SIZE) {
+		AST_LIST_INSERT_HEAD(&lua_state_pool, state, list);
+		lua_state_pool_size++;
+		state = NULL;
+	}
+	AST_LIST_UNLOCK(&lua_state_pool);
+
+	if (state) {
+		lua_close(state->L);
+		ast_free(state);
+	}
+}
+
+/*!
+ * \brief Close all pooled states, for example after a reload made the
+ * extensions they have loaded stale.
+ */
+static void lua_pool_flush(void)
+{
+	struct lua_pool_state *state;
+
+	AST_LIST_LOCK(&lua_state_pool);
+	while ((state = AST_LIST_REMOVE_HEAD(&lua_state_pool, list))) {
+		lua_close(state->L);
+		ast_free(state);
+		lua_state_pool_size--;
+	}
+	AST_LIST_UNLOCK(&lua_state_pool);
+}
+
 /*!
  * \brief Get the lua_State for this channel
  *
- * If no channel is passed then a new state is allocated.  States with no
- * channel assocatied with them should only be used for matching extensions.
- * If the channel does not yet have a lua state associated with it, one will be
- * created.
+ * If no channel is passed then a state is checked out of the pool, or
+ * allocated if the pool is empty.  States with no channel assocatied with
+ * them should only be used for matching extensions.  If the channel does not
+ * yet have a lua state associated with it, one will be created.
  *
- * \note If no channel was passed then the caller is expected to free the state
- * using lua_close().
+ * \note If no channel was passed then the caller is expected to return the
+ * state with lua_release_state().
  *
  * \return a lua_State
  */
@@ -1257,6 +1373,20 @@ static lua_State *lua_get_state(struct ast_channel *chan)
 	lua_State *L;
 
 	if (!chan) {
+		struct lua_pool_state *state;
+
+		AST_LIST_LOCK(&lua_state_pool);
+		if ((state = AST_LIST_REMOVE_HEAD(&lua_state_pool, list))) {
+			lua_state_pool_size--;
+		}
+		AST_LIST_UNLOCK(&lua_state_pool);
+
+		if (state) {
+			L = state->L;
+			ast_free(state);
+			return L;
+		}
+
 		L = luaL_newstate();
 		if (!L) {
 			ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
@@ -1331,7 +1461,7 @@ static int exists(struct ast_channel *chan, const char *context, const char *ext
 
 	res = lua_find_extension(L, context, exten, priority, &exists, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1354,7 +1484,7 @@ static int canmatch(struct ast_channel *chan, const char *context, const char *e
 
 	res = lua_find_extension(L, context, exten, priority, &canmatch, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1377,7 +1507,7 @@ static int matchmore(struct ast_channel *chan, const char *context, const char *
 	
 	res = lua_find_extension(L, context, exten, priority, &matchmore, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1406,7 +1536,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	if (!lua_find_extension(L, context, exten, priority, &exists, 1)) {
 		lua_pop(L, 1); /* pop the debug function */
 		ast_log(LOG_ERROR, "Could not find extension %s in context %s\n", exten, context);
-		if (!chan) lua_close(L);
+		if (!chan) lua_release_state(L);
 		ast_module_user_remove(u);
 		return -1;
 	}
@@ -1453,7 +1583,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	}
 	lua_pop(L, 1);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_release_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1645,6 +1775,7 @@ static int unload_module(void)
 {
 	ast_context_destroy(NULL, registrar);
 	ast_unregister_switch(&lua_switch);
+	lua_pool_flush();
 	lua_free_extensions();
 	ast_log(LOG_NOTICE, "Lua PBX Switch unloaded.\n");
 	return 0;
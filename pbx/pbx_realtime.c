@@ -70,11 +70,32 @@ struct cache_entry {
 	struct timeval when;
 	struct ast_variable *var;
 	int priority;
+	int mode;
+	char *table;
+	char *context;
+	char *exten;
+	char data[0];
+};
+
+/*! \brief Cached set of pattern extensions for one (table, context, priority) */
+struct pattern_set {
+	struct timeval when;
+	int priority;
+	char *table;
 	char *context;
+	AST_LIST_HEAD_NOLOCK(, pattern_entry) patterns;
+	char data[0];
+};
+
+/*! \brief One pattern row within a \ref pattern_set, in backend order */
+struct pattern_entry {
+	AST_LIST_ENTRY(pattern_entry) list;
+	struct ast_variable *var;
 	char exten[2];
 };
 
 struct ao2_container *cache;
+struct ao2_container *pattern_cache;
 pthread_t cleanup_thread = 0;
 
 static int cache_hash(const void *obj, const int flags)
@@ -87,11 +108,28 @@ static int cache_cmp(void *obj, void *arg, int flags)
 {
 	struct cache_entry *e = obj, *f = arg;
 	return e->priority != f->priority ? 0 :
+		e->mode != f->mode ? 0 :
 		strcmp(e->exten, f->exten) ? 0 :
+		strcmp(e->table, f->table) ? 0 :
 		strcmp(e->context, f->context) ? 0 :
 		CMP_MATCH;
 }
 
+static int pattern_set_hash(const void *obj, const int flags)
+{
+	const struct pattern_set *ps = obj;
+	return ast_str_case_hash(ps->context) + ps->priority;
+}
+
+static int pattern_set_cmp(void *obj, void *arg, int flags)
+{
+	struct pattern_set *p = obj, *q = arg;
+	return p->priority != q->priority ? 0 :
+		strcmp(p->table, q->table) ? 0 :
+		strcmp(p->context, q->context) ? 0 :
+		CMP_MATCH;
+}
+
 static struct ast_variable *dup_vars(struct ast_variable *v)
 {
 	struct ast_variable *new, *list = NULL;
@@ -114,6 +152,17 @@ static void free_entry(void *obj)
 	ast_variables_destroy(e->var);
 }
 
+static void free_pattern_set(void *obj)
+{
+	struct pattern_set *ps = obj;
+	struct pattern_entry *pe;
+
+	while ((pe = AST_LIST_REMOVE_HEAD(&ps->patterns, list))) {
+		ast_variables_destroy(pe->var);
+		ast_free(pe);
+	}
+}
+
 static int purge_old_fn(void *obj, void *arg, int flags)
 {
 	struct cache_entry *e = obj;
@@ -121,6 +170,13 @@ static int purge_old_fn(void *obj, void *arg, int flags)
 	return ast_tvdiff_ms(*now, e->when) >= 1000 ? CMP_MATCH : 0;
 }
 
+static int purge_old_pattern_fn(void *obj, void *arg, int flags)
+{
+	struct pattern_set *ps = obj;
+	struct timeval *now = arg;
+	return ast_tvdiff_ms(*now, ps->when) >= 1000 ? CMP_MATCH : 0;
+}
+
 static void *cleanup(void *unused)
 {
 	struct timespec forever = { 999999999, 0 }, one_second = { 1, 0 };
@@ -128,12 +184,13 @@ static void *cleanup(void *unused)
 
 	for (;;) {
 		pthread_testcancel();
-		if (ao2_container_count(cache) == 0) {
+		if (ao2_container_count(cache) == 0 && ao2_container_count(pattern_cache) == 0) {
 			nanosleep(&forever, NULL);
 		}
 		pthread_testcancel();
 		now = ast_tvnow();
 		ao2_callback(cache, OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA, purge_old_fn, &now);
+		ao2_callback(pattern_cache, OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA, purge_old_pattern_fn, &now);
 		pthread_testcancel();
 		nanosleep(&one_second, NULL);
 	}
@@ -156,6 +213,46 @@ static void *cleanup(void *unused)
 */
 
 
+/*! \brief Convert one bulk-loaded config of pattern extensions into a cacheable set
+ *
+ * The categories (and therefore the resulting pattern list) stay in backend
+ * order, so first-match semantics are identical to walking the config
+ * directly.  Variable lists are stored reversed, exactly like cache_entry, so
+ * that dup_vars() on the way out restores the original order.
+ */
+static struct pattern_set *pattern_set_build(const char *table, const char *context, int priority, struct ast_config *cfg)
+{
+	struct pattern_set *ps;
+	char *cat = NULL;
+
+	ps = ao2_alloc(sizeof(*ps) + strlen(table) + strlen(context) + 2, free_pattern_set);
+	if (!ps) {
+		return NULL;
+	}
+	ps->table = ps->data;
+	ps->context = ps->data + strlen(table) + 1;
+	strcpy(ps->table, table); /* SAFE */
+	strcpy(ps->context, context); /* SAFE */
+	ps->priority = priority;
+	ps->when = ast_tvnow();
+
+	while (cfg && (cat = ast_category_browse(cfg, cat))) {
+		struct pattern_entry *pe;
+		struct ast_variable *detached;
+
+		if (!(pe = ast_calloc(1, sizeof(*pe) + strlen(cat) - 1))) {
+			ao2_ref(ps, -1);
+			return NULL;
+		}
+		strcpy(pe->exten, cat); /* SAFE */
+		detached = ast_category_detach_variables(ast_category_get(cfg, cat, NULL));
+		pe->var = dup_vars(detached);
+		ast_variables_destroy(detached);
+		AST_LIST_INSERT_TAIL(&ps->patterns, pe, list);
+	}
+	return ps;
+}
+
 static struct ast_variable *realtime_switch_common(const char *table, const char *context, const char *exten, int priority, int mode, struct ast_flags flags)
 {
 	struct ast_variable *var;
@@ -187,29 +284,48 @@ static struct ast_variable *realtime_switch_common(const char *table, const char
 	}
 	var = ast_load_realtime(table, ematch, rexten, "context", context, "priority", pri, SENTINEL);
 	if (!var && !ast_test_flag(&flags, OPTION_PATTERNS_DISABLED)) {
-		cfg = ast_load_realtime_multientry(table, "exten LIKE", "\\_%", "context", context, "priority", pri, SENTINEL);	
-		if (cfg) {
-			char *cat = ast_category_browse(cfg, NULL);
-
-			while(cat) {
+		struct pattern_set *ps;
+		struct pattern_entry *pe;
+		struct pattern_set ps_search = {
+			.priority = priority,
+			.table = (char *) table,
+			.context = (char *) context,
+		};
+
+		/* Bulk load the context's pattern extensions once per TTL and match
+		 * against the cached set, rather than re-querying the backend for
+		 * every matching attempt of every priority. */
+		ps = ao2_find(pattern_cache, &ps_search, OBJ_POINTER);
+		if (!ps) {
+			cfg = ast_load_realtime_multientry(table, "exten LIKE", "\\_%", "context", context, "priority", pri, SENTINEL);
+			ps = pattern_set_build(table, context, priority, cfg);
+			if (cfg) {
+				ast_config_destroy(cfg);
+			}
+			if (ps) {
+				ao2_link(pattern_cache, ps);
+				pthread_kill(cleanup_thread, SIGURG);
+			}
+		}
+		if (ps) {
+			AST_LIST_TRAVERSE(&ps->patterns, pe, list) {
 				switch(mode) {
 				case MODE_MATCHMORE:
-					match = ast_extension_close(cat, exten, 1);
+					match = ast_extension_close(pe->exten, exten, 1);
 					break;
 				case MODE_CANMATCH:
-					match = ast_extension_close(cat, exten, 0);
+					match = ast_extension_close(pe->exten, exten, 0);
 					break;
 				case MODE_MATCH:
 				default:
-					match = ast_extension_match(cat, exten);
+					match = ast_extension_match(pe->exten, exten);
 				}
 				if (match) {
-					var = ast_category_detach_variables(ast_category_get(cfg, cat, NULL));
+					var = dup_vars(pe->var);
 					break;
 				}
-				cat = ast_category_browse(cfg, cat);
 			}
-			ast_config_destroy(cfg);
+			ao2_ref(ps, -1);
 		}
 	}
 	return var;
@@ -222,10 +338,11 @@ static struct ast_variable *realtime_common(const char *context, const char *ext
 	struct ast_variable *var=NULL;
 	struct ast_flags flags = { 0, };
 	struct cache_entry *ce;
-	struct {
-		struct cache_entry ce;
-		char exten[AST_MAX_EXTENSION];
-	} cache_search = { { .priority = priority, .context = (char *) context }, };
+	struct cache_entry cache_search = {
+		.priority = priority,
+		.mode = mode,
+		.exten = (char *) exten,
+	};
 	char *buf = ast_strdupa(data);
 	/* "Realtime" prefix is stripped off in the parent engine.  The
 	 * remaining string is: [[context@]table][/opts] */
@@ -242,29 +359,32 @@ static struct ast_variable *realtime_common(const char *context, const char *ext
 	if (!ast_strlen_zero(opts)) {
 		ast_app_parse_options(switch_opts, &flags, NULL, opts);
 	}
-	ast_copy_string(cache_search.exten, exten, sizeof(cache_search.exten));
-	if (mode == MODE_MATCH && (ce = ao2_find(cache, &cache_search, OBJ_POINTER))) {
+	cache_search.table = table;
+	cache_search.context = (char *) ctx;
+	if ((ce = ao2_find(cache, &cache_search, OBJ_POINTER))) {
 		var = dup_vars(ce->var);
 		ao2_ref(ce, -1);
 	} else {
 		var = realtime_switch_common(table, ctx, exten, priority, mode, flags);
 		do {
-			struct ast_variable *new;
-			/* Only cache matches */
-			if (mode != MODE_MATCH) {
+			struct ast_variable *new = NULL;
+			/* Cache misses as well (var == NULL), so that repeated failed
+			 * lookups of the same extension do not requery the backend. */
+			if (var && !(new = dup_vars(var))) {
 				break;
 			}
-			if (!(new = dup_vars(var))) {
-				break;
-			}
-			if (!(ce = ao2_alloc(sizeof(*ce) + strlen(exten) + strlen(context), free_entry))) {
+			if (!(ce = ao2_alloc(sizeof(*ce) + strlen(table) + strlen(ctx) + strlen(exten) + 3, free_entry))) {
 				ast_variables_destroy(new);
 				break;
 			}
-			ce->context = ce->exten + strlen(exten) + 1;
+			ce->table = ce->data;
+			ce->context = ce->table + strlen(table) + 1;
+			ce->exten = ce->context + strlen(ctx) + 1;
+			strcpy(ce->table, table); /* SAFE */
+			strcpy(ce->context, ctx); /* SAFE */
 			strcpy(ce->exten, exten); /* SAFE */
-			strcpy(ce->context, context); /* SAFE */
 			ce->priority = priority;
+			ce->mode = mode;
 			ce->var = new;
 			ce->when = ast_tvnow();
 			ao2_link(cache, ce);
@@ -377,6 +497,16 @@ static struct ast_switch realtime_switch =
 	.matchmore		= realtime_matchmore,
 };
 
+static int reload(void)
+{
+	/* Flush all cached lookups; subsequent calls repopulate from the
+	 * backend, so a reload is the explicit invalidation point after
+	 * realtime dialplan data has been changed. */
+	ao2_callback(cache, OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA, NULL, NULL);
+	ao2_callback(pattern_cache, OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA, NULL, NULL);
+	return 0;
+}
+
 static int unload_module(void)
 {
 	ast_unregister_switch(&realtime_switch);
@@ -385,6 +515,7 @@ static int unload_module(void)
 	pthread_join(cleanup_thread, NULL);
 	/* Destroy all remaining entries */
 	ao2_ref(cache, -1);
+	ao2_ref(pattern_cache, -1);
 	return 0;
 }
 
@@ -394,6 +525,11 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	if (!(pattern_cache = ao2_container_alloc(573, pattern_set_hash, pattern_set_cmp))) {
+		ao2_ref(cache, -1);
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	if (ast_pthread_create(&cleanup_thread, NULL, cleanup, NULL)) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
@@ -403,5 +539,10 @@ static int load_module(void)
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
-AST_MODULE_INFO_STANDARD_EXTENDED(ASTERISK_GPL_KEY, "Realtime Switch");
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Realtime Switch",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.reload = reload,
+);
 
@@ -80,6 +80,12 @@ struct ast_ari_websocket_session *ast_ari_websocket_session_create(
 			config->general->write_timeout);
 	}
 
+	if (config->general->write_batch_ms
+		&& ast_websocket_set_write_batching(ws_session, config->general->write_batch_ms)) {
+		ast_log(LOG_WARNING, "Failed to enable write batching (%d ms) on ARI web socket\n",
+			config->general->write_batch_ms);
+	}
+
 	session = ao2_alloc(sizeof(*session), websocket_session_dtor);
 	if (!session) {
 		return NULL;
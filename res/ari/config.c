@@ -357,6 +357,9 @@ int ast_ari_config_init(void)
 	aco_option_register(&cfg_info, "websocket_write_timeout", ACO_EXACT, general_options,
 		AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT_STR, OPT_INT_T, PARSE_IN_RANGE,
 		FLDSET(struct ast_ari_conf_general, write_timeout), 1, INT_MAX);
+	aco_option_register(&cfg_info, "websocket_write_batching", ACO_EXACT, general_options,
+		"0", OPT_INT_T, PARSE_IN_RANGE,
+		FLDSET(struct ast_ari_conf_general, write_batch_ms), 0, INT_MAX);
 	aco_option_register_custom(&cfg_info, "channelvars", ACO_EXACT, general_options,
 		"", channelvars_handler, 0);
 
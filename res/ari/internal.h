@@ -67,6 +67,9 @@ struct ast_ari_conf_general {
 	int enabled;
 	/*! Write timeout for websocket connections */
 	int write_timeout;
+	/*! Milliseconds outgoing websocket frames may be held back to coalesce
+	 *  event bursts into fewer socket writes (zero disables batching). */
+	int write_batch_ms;
 	/*! Encoding format used during output (default compact). */
 	enum ast_json_encoding_format format;
 	/*! Authentication realm */
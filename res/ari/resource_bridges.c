@@ -46,6 +46,7 @@
 #include "asterisk/file.h"
 #include "asterisk/musiconhold.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/vector.h"
 
 /*!
  * \brief Finds a bridge, filling the response with an error, if appropriate.
@@ -877,6 +878,20 @@ void ast_ari_bridges_destroy(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+/*!
+ * \brief qsort() comparator ordering bridge snapshot messages by unique id,
+ * so cursor pagination sees a stable ordering.
+ */
+static int bridge_snapshot_id_cmp(const void *obj_left, const void *obj_right)
+{
+	const struct ast_bridge_snapshot *left =
+		stasis_message_data(*(struct stasis_message **) obj_left);
+	const struct ast_bridge_snapshot *right =
+		stasis_message_data(*(struct stasis_message **) obj_right);
+
+	return strcmp(left->uniqueid, right->uniqueid);
+}
+
 void ast_ari_bridges_list(struct ast_variable *headers,
 	struct ast_ari_bridges_list_args *args,
 	struct ast_ari_response *response)
@@ -884,8 +899,12 @@ void ast_ari_bridges_list(struct ast_variable *headers,
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
 	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	AST_VECTOR(, struct stasis_message *) matched;
 	struct ao2_iterator i;
 	void *obj;
+	size_t start = 0;
+	size_t end;
+	size_t idx;
 
 	cache = ast_bridge_cache();
 	if (!cache) {
@@ -908,20 +927,68 @@ void ast_ari_bridges_list(struct ast_variable *headers,
 		return;
 	}
 
+	if (AST_VECTOR_INIT(&matched, ao2_container_count(snapshots))) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
 	i = ao2_iterator_init(snapshots, 0);
 	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_bridge_snapshot *snapshot = stasis_message_data(msg);
-		struct ast_json *json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+		struct stasis_message *msg = obj;
 
-		if (!json_bridge || ast_json_array_append(json, json_bridge)) {
+		if (AST_VECTOR_APPEND(&matched, msg)) {
+			ao2_ref(msg, -1);
 			ao2_iterator_destroy(&i);
+			AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+			AST_VECTOR_FREE(&matched);
 			ast_ari_response_alloc_failed(response);
 			return;
 		}
 	}
 	ao2_iterator_destroy(&i);
 
+	if (AST_VECTOR_SIZE(&matched) > 1) {
+		qsort(AST_VECTOR_GET_ADDR(&matched, 0), AST_VECTOR_SIZE(&matched),
+			sizeof(struct stasis_message *), bridge_snapshot_id_cmp);
+	}
+
+	if (!ast_strlen_zero(args->after)) {
+		/* An unknown cursor (e.g. the bridge was destroyed between
+		 * pages) yields an empty page rather than repeating earlier
+		 * entries. */
+		start = AST_VECTOR_SIZE(&matched);
+		for (idx = 0; idx < AST_VECTOR_SIZE(&matched); idx++) {
+			struct ast_bridge_snapshot *snapshot =
+				stasis_message_data(AST_VECTOR_GET(&matched, idx));
+
+			if (!strcmp(snapshot->uniqueid, args->after)) {
+				start = idx + 1;
+				break;
+			}
+		}
+	}
+
+	end = AST_VECTOR_SIZE(&matched);
+	if (args->limit > 0 && start + args->limit < end) {
+		end = start + args->limit;
+	}
+
+	for (idx = start; idx < end; idx++) {
+		struct ast_bridge_snapshot *snapshot =
+			stasis_message_data(AST_VECTOR_GET(&matched, idx));
+		struct ast_json *json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+
+		if (!json_bridge || ast_json_array_append(json, json_bridge)) {
+			AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+			AST_VECTOR_FREE(&matched);
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+	AST_VECTOR_FREE(&matched);
+
 	ast_ari_response_ok(response, ast_json_ref(json));
 }
 
@@ -41,7 +41,22 @@
 
 /*! Argument struct for ast_ari_bridges_list() */
 struct ast_ari_bridges_list_args {
+	/*! Only include bridges ordered after the bridge with this id. Bridges are ordered by id; pass the id of the last bridge of the previous page to fetch the next page. */
+	const char *after;
+	/*! Maximum number of bridges to return. Zero or omitted means no limit. */
+	int limit;
 };
+/*!
+ * \brief Body parsing function for /bridges.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_bridges_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_bridges_list_args *args);
+
 /*!
  * \brief List all active bridges in Asterisk.
  *
@@ -47,6 +47,8 @@
 #include "asterisk/core_local.h"
 #include "asterisk/dial.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/localtime.h"
+#include "asterisk/vector.h"
 #include "resource_channels.h"
 
 #include <limits.h>
@@ -899,6 +901,42 @@ void ast_ari_channels_hangup(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+/*!
+ * \brief Determine if a channel snapshot was created from a given endpoint.
+ *
+ * The endpoint may name just a technology (PJSIP) or a specific resource
+ * (PJSIP/alice); in the latter case the channel name is matched up to the
+ * uniqueness suffix the channel driver appends after the resource.
+ */
+static int channel_snapshot_endpoint_match(
+	const struct ast_channel_snapshot *snapshot, const char *endpoint)
+{
+	size_t len;
+
+	if (!strchr(endpoint, '/')) {
+		return !strcasecmp(snapshot->type, endpoint);
+	}
+
+	len = strlen(endpoint);
+	return !strncasecmp(snapshot->name, endpoint, len)
+		&& (snapshot->name[len] == '-' || snapshot->name[len] == '\0');
+}
+
+/*!
+ * \brief qsort() comparator ordering channel snapshot messages by creation
+ * time, then unique id, so cursor pagination sees a stable ordering.
+ */
+static int channel_snapshot_time_cmp(const void *obj_left, const void *obj_right)
+{
+	const struct ast_channel_snapshot *left =
+		stasis_message_data(*(struct stasis_message **) obj_left);
+	const struct ast_channel_snapshot *right =
+		stasis_message_data(*(struct stasis_message **) obj_right);
+	int cmp = ast_tvcmp(left->creationtime, right->creationtime);
+
+	return cmp ? cmp : strcmp(left->uniqueid, right->uniqueid);
+}
+
 void ast_ari_channels_list(struct ast_variable *headers,
 	struct ast_ari_channels_list_args *args,
 	struct ast_ari_response *response)
@@ -906,10 +944,28 @@ void ast_ari_channels_list(struct ast_variable *headers,
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
 	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	AST_VECTOR(, struct stasis_message *) matched;
+	struct timeval created_since = ast_tv(0, 0);
 	struct ao2_iterator i;
 	void *obj;
+	size_t start = 0;
+	size_t end;
+	size_t idx;
 	struct stasis_message_sanitizer *sanitize = stasis_app_get_sanitizer();
 
+	if (!ast_strlen_zero(args->created_since)) {
+		struct ast_tm tm = {};
+
+		if (!ast_strptime(args->created_since, AST_ISO8601_FORMAT, &tm)
+			&& !ast_strptime(args->created_since, "%FT%T", &tm)) {
+			ast_ari_response_error(
+				response, 400, "Bad Request",
+				"Invalid created_since timestamp");
+			return;
+		}
+		created_since = ast_mktime(&tm, NULL);
+	}
+
 	cache = ast_channel_cache();
 	if (!cache) {
 		ast_ari_response_error(
@@ -931,27 +987,82 @@ void ast_ari_channels_list(struct ast_variable *headers,
 		return;
 	}
 
+	if (AST_VECTOR_INIT(&matched, ao2_container_count(snapshots))) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	/* Evaluate the filters against the snapshots themselves so that only
+	 * the channels actually returned pay the JSON serialization cost. */
 	i = ao2_iterator_init(snapshots, 0);
 	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
+		struct stasis_message *msg = obj;
 		struct ast_channel_snapshot *snapshot = stasis_message_data(msg);
-		int r;
 
-		if (sanitize && sanitize->channel_snapshot
-			&& sanitize->channel_snapshot(snapshot)) {
+		if ((sanitize && sanitize->channel_snapshot
+				&& sanitize->channel_snapshot(snapshot))
+			|| (!ast_strlen_zero(args->state)
+				&& strcasecmp(ast_state2str(snapshot->state), args->state))
+			|| (!ast_strlen_zero(args->endpoint)
+				&& !channel_snapshot_endpoint_match(snapshot, args->endpoint))
+			|| (!ast_tvzero(created_since)
+				&& ast_tvcmp(snapshot->creationtime, created_since) < 0)) {
+			ao2_ref(msg, -1);
 			continue;
 		}
 
-		r = ast_json_array_append(
-			json, ast_channel_snapshot_to_json(snapshot, NULL));
-		if (r != 0) {
-			ast_ari_response_alloc_failed(response);
+		if (AST_VECTOR_APPEND(&matched, msg)) {
+			ao2_ref(msg, -1);
 			ao2_iterator_destroy(&i);
+			AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+			AST_VECTOR_FREE(&matched);
+			ast_ari_response_alloc_failed(response);
 			return;
 		}
 	}
 	ao2_iterator_destroy(&i);
 
+	if (AST_VECTOR_SIZE(&matched) > 1) {
+		qsort(AST_VECTOR_GET_ADDR(&matched, 0), AST_VECTOR_SIZE(&matched),
+			sizeof(struct stasis_message *), channel_snapshot_time_cmp);
+	}
+
+	if (!ast_strlen_zero(args->after)) {
+		/* An unknown cursor (e.g. the channel hung up between pages)
+		 * yields an empty page rather than repeating earlier entries. */
+		start = AST_VECTOR_SIZE(&matched);
+		for (idx = 0; idx < AST_VECTOR_SIZE(&matched); idx++) {
+			struct ast_channel_snapshot *snapshot =
+				stasis_message_data(AST_VECTOR_GET(&matched, idx));
+
+			if (!strcmp(snapshot->uniqueid, args->after)) {
+				start = idx + 1;
+				break;
+			}
+		}
+	}
+
+	end = AST_VECTOR_SIZE(&matched);
+	if (args->limit > 0 && start + args->limit < end) {
+		end = start + args->limit;
+	}
+
+	for (idx = start; idx < end; idx++) {
+		struct ast_channel_snapshot *snapshot =
+			stasis_message_data(AST_VECTOR_GET(&matched, idx));
+
+		if (ast_json_array_append(
+				json, ast_channel_snapshot_to_json(snapshot, NULL))) {
+			AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+			AST_VECTOR_FREE(&matched);
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&matched, ao2_cleanup);
+	AST_VECTOR_FREE(&matched);
+
 	ast_ari_response_ok(response, ast_json_ref(json));
 }
 
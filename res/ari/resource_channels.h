@@ -41,7 +41,28 @@
 
 /*! Argument struct for ast_ari_channels_list() */
 struct ast_ari_channels_list_args {
+	/*! Only include channels in this state (e.g. Up, Ringing). */
+	const char *state;
+	/*! Only include channels created from this endpoint, as technology or technology/resource (e.g. PJSIP or PJSIP/alice). */
+	const char *endpoint;
+	/*! Only include channels created at or after this time, in ISO 8601 format (e.g. 2016-04-27T14:54:21.737+0000). */
+	const char *created_since;
+	/*! Only include channels ordered after the channel with this id. Channels are ordered by creation time, then id; pass the id of the last channel of the previous page to fetch the next page. */
+	const char *after;
+	/*! Maximum number of channels to return. Zero or omitted means no limit. */
+	int limit;
 };
+/*!
+ * \brief Body parsing function for /channels.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_channels_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_list_args *args);
+
 /*!
  * \brief List all active channels in Asterisk.
  *
@@ -63,6 +63,7 @@
 #include "asterisk/srv.h"
 #include "asterisk/test.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/taskprocessor.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/stasis_message_router.h"
 #include "asterisk/format_cache.h"
@@ -1968,6 +1969,91 @@ async_agi_abort:
 #undef AMI_BUF_SIZE
 }
 
+/*! Number of pre-warmed connections to keep per FastAGI host */
+#define AGI_POOL_SIZE 2
+
+/*! How long, in seconds, a pre-warmed connection may sit idle before being discarded */
+#define AGI_POOL_IDLE_TTL 60
+
+/*! \brief A single pre-established FastAGI connection */
+struct agi_pooled_conn {
+	AST_LIST_ENTRY(agi_pooled_conn) list;
+	/*! The connected socket */
+	int fd;
+	/*! When the connection was established */
+	struct timeval when;
+};
+
+/*! \brief Pre-warmed connections for one FastAGI host[:port] */
+struct agi_pool_host {
+	/*! Available connections, oldest first.  Protected by the ao2 lock. */
+	AST_LIST_HEAD_NOLOCK(, agi_pooled_conn) conns;
+	/*! Number of connections in \c conns */
+	unsigned int count;
+	/*! Number of replenish tasks currently in flight */
+	unsigned int pending;
+	/*! The host[:port] portion of the AGI URL */
+	char host[0];
+};
+
+/*! \brief Container of \ref agi_pool_host objects, keyed by host */
+static struct ao2_container *agi_pool;
+
+/*! \brief Taskprocessor establishing pool connections off the call path */
+static struct ast_taskprocessor *agi_pool_tp;
+
+static void agi_pool_host_dtor(void *obj)
+{
+	struct agi_pool_host *entry = obj;
+	struct agi_pooled_conn *conn;
+
+	while ((conn = AST_LIST_REMOVE_HEAD(&entry->conns, list))) {
+		close(conn->fd);
+		ast_free(conn);
+	}
+}
+
+static int agi_pool_host_hash(const void *obj, const int flags)
+{
+	const struct agi_pool_host *entry;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		key = entry->host;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_case_hash(key);
+}
+
+static int agi_pool_host_cmp(void *obj, void *arg, int flags)
+{
+	const struct agi_pool_host *object_left = obj;
+	const struct agi_pool_host *object_right = arg;
+	const char *right_key = arg;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->host;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		cmp = strcasecmp(object_left->host, right_key);
+		break;
+	default:
+		cmp = -1;
+		break;
+	}
+	return cmp ? 0 : CMP_MATCH | CMP_STOP;
+}
+
 /*!
  * \internal
  * \brief Handle the connection that was started by launch_netscript.
@@ -2018,28 +2104,25 @@ static int handle_connection(const char *agiurl, const struct ast_sockaddr addr,
 	return 0;
 }
 
-/* launch_netscript: The fastagi handler.
-	FastAGI defaults to port 4573 */
-static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
+/*!
+ * \internal
+ * \brief Resolve a FastAGI host and establish a TCP connection to it.
+ *
+ * \param agiurl The URL being serviced, for log messages.
+ * \param host The host[:port] portion of the URL.
+ *
+ * \retval A connected, non-blocking socket on success.
+ * \retval -1 on failure.
+ */
+static int fastagi_connect(const char *agiurl, const char *host)
 {
-	int s = 0, flags;
-	char *host, *script;
+	int s = 0, flags, nodelay = 1;
 	int num_addrs = 0, i = 0;
 	struct ast_sockaddr *addrs;
 
-	/* agiurl is "agi://host.domain[:port][/script/name]" */
-	host = ast_strdupa(agiurl + 6);	/* Remove agi:// */
-
-	/* Strip off any script name */
-	if ((script = strchr(host, '/'))) {
-		*script++ = '\0';
-	} else {
-		script = "";
-	}
-
 	if (!(num_addrs = ast_sockaddr_resolve(&addrs, host, 0, AST_AF_UNSPEC))) {
 		ast_log(LOG_WARNING, "Unable to locate host '%s'\n", host);
-		return AGI_RESULT_FAILURE;
+		return -1;
 	}
 
 	for (i = 0; i < num_addrs; i++) {
@@ -2082,12 +2165,162 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 	ast_free(addrs);
 
 	if (i == num_addrs) {
-		ast_log(LOG_WARNING, "Couldn't connect to any host.  FastAGI failed.\n");
-		return AGI_RESULT_FAILURE;
+		return -1;
+	}
+
+	/* An AGI session is a long series of tiny request/response writes;
+	 * don't let Nagle hold any of them back. */
+	if (setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay))) {
+		ast_debug(1, "Unable to disable Nagle on FastAGI socket: %s\n", strerror(errno));
+	}
+
+	return s;
+}
+
+/*! \brief Taskprocessor task establishing one pool connection for a host */
+static int agi_pool_replenish(void *data)
+{
+	struct agi_pool_host *entry = data;
+	struct agi_pooled_conn *conn;
+	int fd;
+
+	fd = fastagi_connect(entry->host, entry->host);
+
+	ao2_lock(entry);
+	entry->pending--;
+	if (fd < 0 || entry->count >= AGI_POOL_SIZE
+		|| !(conn = ast_calloc(1, sizeof(*conn)))) {
+		ao2_unlock(entry);
+		if (fd > -1) {
+			close(fd);
+		}
+		ao2_ref(entry, -1);
+		return 0;
+	}
+	conn->fd = fd;
+	conn->when = ast_tvnow();
+	AST_LIST_INSERT_TAIL(&entry->conns, conn, list);
+	entry->count++;
+	ao2_unlock(entry);
+
+	ao2_ref(entry, -1);
+	return 0;
+}
+
+/*! \brief Queue background tasks to bring a host's pool back up to size */
+static void agi_pool_schedule_replenish(struct agi_pool_host *entry)
+{
+	ao2_lock(entry);
+	while (entry->count + entry->pending < AGI_POOL_SIZE) {
+		entry->pending++;
+		ao2_ref(entry, +1);
+		if (ast_taskprocessor_push(agi_pool_tp, agi_pool_replenish, entry)) {
+			entry->pending--;
+			ao2_ref(entry, -1);
+			break;
+		}
+	}
+	ao2_unlock(entry);
+}
+
+/*!
+ * \internal
+ * \brief Grab a pre-warmed connection for a FastAGI host, if one is available.
+ *
+ * Dead connections (the server hung up or spoke while idle; a FastAGI server
+ * must not talk before receiving the environment) and connections idle for
+ * longer than AGI_POOL_IDLE_TTL are discarded.  Regardless of the outcome,
+ * background replenishment is scheduled so that subsequent calls find warm
+ * connections waiting and skip DNS resolution and the TCP handshake.
+ *
+ * \retval A connected socket on success.
+ * \retval -1 if the pool has nothing usable for this host.
+ */
+static int agi_pool_checkout(const char *host)
+{
+	struct agi_pool_host *entry;
+	struct agi_pooled_conn *conn;
+	int fd = -1;
+
+	ao2_lock(agi_pool);
+	entry = ao2_find(agi_pool, host, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry) {
+		entry = ao2_alloc(sizeof(*entry) + strlen(host) + 1, agi_pool_host_dtor);
+		if (!entry) {
+			ao2_unlock(agi_pool);
+			return -1;
+		}
+		strcpy(entry->host, host); /* SAFE */
+		ao2_link_flags(agi_pool, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(agi_pool);
+
+	ao2_lock(entry);
+	while ((conn = AST_LIST_REMOVE_HEAD(&entry->conns, list))) {
+		struct pollfd pfd = { .events = POLLIN, };
+		int alive;
+
+		entry->count--;
+		pfd.fd = conn->fd;
+		alive = ast_tvdiff_sec(ast_tvnow(), conn->when) < AGI_POOL_IDLE_TTL
+			&& ast_poll(&pfd, 1, 0) == 0;
+		fd = conn->fd;
+		ast_free(conn);
+		if (alive) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	ao2_unlock(entry);
+
+	agi_pool_schedule_replenish(entry);
+	ao2_ref(entry, -1);
+
+	return fd;
+}
+
+/* launch_netscript: The fastagi handler.
+	FastAGI defaults to port 4573 */
+static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
+{
+	int s, pooled;
+	char *host, *script;
+
+	/* agiurl is "agi://host.domain[:port][/script/name]" */
+	host = ast_strdupa(agiurl + 6);	/* Remove agi:// */
+
+	/* Strip off any script name */
+	if ((script = strchr(host, '/'))) {
+		*script++ = '\0';
+	} else {
+		script = "";
+	}
+
+	s = agi_pool_checkout(host);
+	pooled = s > -1;
+	if (!pooled) {
+		s = fastagi_connect(agiurl, host);
+		if (s < 0) {
+			ast_log(LOG_WARNING, "Couldn't connect to any host.  FastAGI failed.\n");
+			return AGI_RESULT_FAILURE;
+		}
 	}
 
 	if (ast_agi_send(s, NULL, "agi_network: yes\n") < 0) {
-		if (errno != EINTR) {
+		if (pooled) {
+			/* The server likely timed the idle connection out underneath
+			 * us; fall back to a fresh connection before giving up. */
+			close(s);
+			s = fastagi_connect(agiurl, host);
+			if (s < 0 || ast_agi_send(s, NULL, "agi_network: yes\n") < 0) {
+				ast_log(LOG_WARNING, "Connect to '%s' failed: %s\n", agiurl, strerror(errno));
+				if (s > -1) {
+					close(s);
+				}
+				return AGI_RESULT_FAILURE;
+			}
+		} else if (errno != EINTR) {
 			ast_log(LOG_WARNING, "Connect to '%s' failed: %s\n", agiurl, strerror(errno));
 			close(s);
 			return AGI_RESULT_FAILURE;
@@ -2301,47 +2534,59 @@ static enum agi_result launch_script(struct ast_channel *chan, char *script, int
 static void setup_env(struct ast_channel *chan, char *request, int fd, int enhanced, int argc, char *argv[])
 {
 	int count;
+	struct ast_str *env;
+
+	/* Build the entire environment block and ship it in a single write;
+	 * this pipelines roughly twenty-five lines that the peer never
+	 * responds to individually. */
+	env = ast_str_create(1024);
+	if (!env) {
+		return;
+	}
 
 	/* Print initial environment, with agi_request always being the first
 	   thing */
-	ast_agi_send(fd, chan, "agi_request: %s\n", request);
-	ast_agi_send(fd, chan, "agi_channel: %s\n", ast_channel_name(chan));
-	ast_agi_send(fd, chan, "agi_language: %s\n", ast_channel_language(chan));
-	ast_agi_send(fd, chan, "agi_type: %s\n", ast_channel_tech(chan)->type);
-	ast_agi_send(fd, chan, "agi_uniqueid: %s\n", ast_channel_uniqueid(chan));
-	ast_agi_send(fd, chan, "agi_version: %s\n", ast_get_version());
+	ast_str_append(&env, 0, "agi_request: %s\n", request);
+	ast_str_append(&env, 0, "agi_channel: %s\n", ast_channel_name(chan));
+	ast_str_append(&env, 0, "agi_language: %s\n", ast_channel_language(chan));
+	ast_str_append(&env, 0, "agi_type: %s\n", ast_channel_tech(chan)->type);
+	ast_str_append(&env, 0, "agi_uniqueid: %s\n", ast_channel_uniqueid(chan));
+	ast_str_append(&env, 0, "agi_version: %s\n", ast_get_version());
 
 	/* ANI/DNIS */
-	ast_agi_send(fd, chan, "agi_callerid: %s\n",
+	ast_str_append(&env, 0, "agi_callerid: %s\n",
 		S_COR(ast_channel_caller(chan)->id.number.valid, ast_channel_caller(chan)->id.number.str, "unknown"));
-	ast_agi_send(fd, chan, "agi_calleridname: %s\n",
+	ast_str_append(&env, 0, "agi_calleridname: %s\n",
 		S_COR(ast_channel_caller(chan)->id.name.valid, ast_channel_caller(chan)->id.name.str, "unknown"));
-	ast_agi_send(fd, chan, "agi_callingpres: %d\n",
+	ast_str_append(&env, 0, "agi_callingpres: %d\n",
 		ast_party_id_presentation(&ast_channel_caller(chan)->id));
-	ast_agi_send(fd, chan, "agi_callingani2: %d\n", ast_channel_caller(chan)->ani2);
-	ast_agi_send(fd, chan, "agi_callington: %d\n", ast_channel_caller(chan)->id.number.plan);
-	ast_agi_send(fd, chan, "agi_callingtns: %d\n", ast_channel_dialed(chan)->transit_network_select);
-	ast_agi_send(fd, chan, "agi_dnid: %s\n", S_OR(ast_channel_dialed(chan)->number.str, "unknown"));
-	ast_agi_send(fd, chan, "agi_rdnis: %s\n",
+	ast_str_append(&env, 0, "agi_callingani2: %d\n", ast_channel_caller(chan)->ani2);
+	ast_str_append(&env, 0, "agi_callington: %d\n", ast_channel_caller(chan)->id.number.plan);
+	ast_str_append(&env, 0, "agi_callingtns: %d\n", ast_channel_dialed(chan)->transit_network_select);
+	ast_str_append(&env, 0, "agi_dnid: %s\n", S_OR(ast_channel_dialed(chan)->number.str, "unknown"));
+	ast_str_append(&env, 0, "agi_rdnis: %s\n",
 		S_COR(ast_channel_redirecting(chan)->from.number.valid, ast_channel_redirecting(chan)->from.number.str, "unknown"));
 
 	/* Context information */
-	ast_agi_send(fd, chan, "agi_context: %s\n", ast_channel_context(chan));
-	ast_agi_send(fd, chan, "agi_extension: %s\n", ast_channel_exten(chan));
-	ast_agi_send(fd, chan, "agi_priority: %d\n", ast_channel_priority(chan));
-	ast_agi_send(fd, chan, "agi_enhanced: %s\n", enhanced ? "1.0" : "0.0");
+	ast_str_append(&env, 0, "agi_context: %s\n", ast_channel_context(chan));
+	ast_str_append(&env, 0, "agi_extension: %s\n", ast_channel_exten(chan));
+	ast_str_append(&env, 0, "agi_priority: %d\n", ast_channel_priority(chan));
+	ast_str_append(&env, 0, "agi_enhanced: %s\n", enhanced ? "1.0" : "0.0");
 
 	/* User information */
-	ast_agi_send(fd, chan, "agi_accountcode: %s\n", ast_channel_accountcode(chan) ? ast_channel_accountcode(chan) : "");
-	ast_agi_send(fd, chan, "agi_threadid: %ld\n", (long)pthread_self());
+	ast_str_append(&env, 0, "agi_accountcode: %s\n", ast_channel_accountcode(chan) ? ast_channel_accountcode(chan) : "");
+	ast_str_append(&env, 0, "agi_threadid: %ld\n", (long)pthread_self());
 
 	/* Send any parameters to the fastagi server that have been passed via the agi application */
 	/* Agi application paramaters take the form of: AGI(/path/to/example/script|${EXTEN}) */
 	for(count = 1; count < argc; count++)
-		ast_agi_send(fd, chan, "agi_arg_%d: %s\n", count, argv[count]);
+		ast_str_append(&env, 0, "agi_arg_%d: %s\n", count, argv[count]);
 
 	/* End with empty return */
-	ast_agi_send(fd, chan, "\n");
+	ast_str_append(&env, 0, "\n");
+
+	ast_agi_send(fd, chan, "%s", ast_str_buffer(env));
+	ast_free(env);
 }
 
 static int handle_answer(struct ast_channel *chan, AGI *agi, int argc, const char * const argv[])
@@ -4640,6 +4885,9 @@ static int unload_module(void)
 	ast_manager_unregister("AGI");
 	ast_unregister_application(app);
 	AST_TEST_UNREGISTER(test_agi_null_docs);
+	agi_pool_tp = ast_taskprocessor_unreference(agi_pool_tp);
+	ao2_cleanup(agi_pool);
+	agi_pool = NULL;
 	return 0;
 }
 
@@ -4647,6 +4895,18 @@ static int load_module(void)
 {
 	int err = 0;
 
+	agi_pool = ao2_container_alloc(17, agi_pool_host_hash, agi_pool_host_cmp);
+	if (!agi_pool) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	agi_pool_tp = ast_taskprocessor_get("agi_pool", TPS_REF_DEFAULT);
+	if (!agi_pool_tp) {
+		ao2_cleanup(agi_pool);
+		agi_pool = NULL;
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	err |= STASIS_MESSAGE_TYPE_INIT(agi_exec_start_type);
 	err |= STASIS_MESSAGE_TYPE_INIT(agi_exec_end_type);
 	err |= STASIS_MESSAGE_TYPE_INIT(agi_async_start_type);
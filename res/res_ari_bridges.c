@@ -50,6 +50,23 @@
 
 #define MAX_VALS 128
 
+int ast_ari_bridges_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_bridges_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "after");
+	if (field) {
+		args->after = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "limit");
+	if (field) {
+		args->limit = ast_json_integer_get(field);
+	}
+	return 0;
+}
+
 /*!
  * \brief Parameter parsing callback for /bridges.
  * \param get_params GET parameters in the HTTP request.
@@ -63,12 +80,41 @@ static void ast_ari_bridges_list_cb(
 	struct ast_variable *headers, struct ast_ari_response *response)
 {
 	struct ast_ari_bridges_list_args args = {};
+	struct ast_variable *i;
 	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
 #if defined(AST_DEVMODE)
 	int is_valid;
 	int code;
 #endif /* AST_DEVMODE */
 
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "after") == 0) {
+			args.after = (i->value);
+		} else
+		if (strcmp(i->name, "limit") == 0) {
+			args.limit = atoi(i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_bridges_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
 	ast_ari_bridges_list(headers, &args, response);
 #if defined(AST_DEVMODE)
 	code = response->response_code;
@@ -63,11 +63,15 @@ struct caldav_pvt {
 		AST_STRING_FIELD(url);
 		AST_STRING_FIELD(user);
 		AST_STRING_FIELD(secret);
+		AST_STRING_FIELD(etag);      /*!< ETag from the last calendar-query response */
+		AST_STRING_FIELD(lastmod);   /*!< Last-Modified from the last calendar-query response */
 	);
 	struct ast_calendar *owner;
 	ne_uri uri;
 	ne_session *session;
 	struct ao2_container *events;
+	struct ast_str *last_response;   /*!< Body of the last calendar-query response */
+	int unchanged;                   /*!< Set when the server answered 304 Not Modified */
 };
 
 static void caldav_destructor(void *obj)
@@ -79,6 +83,7 @@ static void caldav_destructor(void *obj)
 		ne_session_destroy(pvt->session);
 	}
 	ast_string_field_free_memory(pvt);
+	ast_free(pvt->last_response);
 
 	ao2_callback(pvt->events, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
 
@@ -157,7 +162,37 @@ static struct ast_str *caldav_request(struct caldav_pvt *pvt, const char *method
 	ne_set_request_body_buffer(req, ast_str_buffer(req_body), ast_str_strlen(req_body));
 	ne_add_request_header(req, "Content-type", ast_strlen_zero(content_type) ? "text/xml" : content_type);
 
+	/* Make the calendar-query conditional so a server that supports
+	 * validators can answer 304 instead of resending the whole body */
+	if (!strcmp(method, "REPORT")) {
+		if (!ast_strlen_zero(pvt->etag)) {
+			ne_add_request_header(req, "If-None-Match", pvt->etag);
+		}
+		if (!ast_strlen_zero(pvt->lastmod)) {
+			ne_add_request_header(req, "If-Modified-Since", pvt->lastmod);
+		}
+	}
+
 	ret = ne_request_dispatch(req);
+
+	if (ret == NE_OK && ne_get_status(req)->code == 304) {
+		pvt->unchanged = 1;
+		ne_request_destroy(req);
+		ast_free(response);
+		return NULL;
+	}
+
+	if (ret == NE_OK && !strcmp(method, "REPORT")) {
+		const char *hdr;
+
+		if ((hdr = ne_get_response_header(req, "ETag"))) {
+			ast_string_field_set(pvt, etag, hdr);
+		}
+		if ((hdr = ne_get_response_header(req, "Last-Modified"))) {
+			ast_string_field_set(pvt, lastmod, hdr);
+		}
+	}
+
 	ne_request_destroy(req);
 
 	if (ret != NE_OK) {
@@ -545,12 +580,23 @@ static int update_caldav(struct caldav_pvt *pvt)
 
 	start = now.tv_sec;
 	end = now.tv_sec + 60 * pvt->owner->timeframe;
+	pvt->unchanged = 0;
 	if (!(response = caldav_get_events_between(pvt, start, end))) {
-		return -1;
+		if (pvt->unchanged && pvt->last_response) {
+			/* The server answered 304 Not Modified, so replay the cached
+			 * body to re-expand recurrences over the new time window
+			 * without the transfer */
+			ast_debug(3, "CalDAV calendar %s unchanged, reusing cached response\n", pvt->owner->name);
+			response = pvt->last_response;
+		} else {
+			return -1;
+		}
 	}
 
 	if (!(state.cdata = ast_str_create(512))) {
-		ast_free(response);
+		if (response != pvt->last_response) {
+			ast_free(response);
+		}
 		return -1;
 	}
 
@@ -566,7 +612,11 @@ static int update_caldav(struct caldav_pvt *pvt)
 
 	ast_calendar_merge_events(pvt->owner, pvt->events);
 
-	ast_free(response);
+	if (response != pvt->last_response) {
+		/* Keep the body so a future 304 can be served from it */
+		ast_free(pvt->last_response);
+		pvt->last_response = response;
+	}
 	ast_free(state.cdata);
 
 	return 0;
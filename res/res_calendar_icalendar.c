@@ -58,12 +58,15 @@ struct icalendar_pvt {
 		AST_STRING_FIELD(url);
 		AST_STRING_FIELD(user);
 		AST_STRING_FIELD(secret);
+		AST_STRING_FIELD(etag);      /*!< ETag from the last fetch */
+		AST_STRING_FIELD(lastmod);   /*!< Last-Modified from the last fetch */
 	);
 	struct ast_calendar *owner;
 	ne_uri uri;
 	ne_session *session;
 	icalcomponent *data;
 	struct ao2_container *events;
+	int unchanged;                   /*!< Set when the server answered 304 Not Modified */
 };
 
 static void icalendar_destructor(void *obj)
@@ -143,7 +146,35 @@ static icalcomponent *fetch_icalendar(struct icalendar_pvt *pvt)
 	req = ne_request_create(pvt->session, "GET", pvt->uri.path);
 	ne_add_response_body_reader(req, ne_accept_2xx, fetch_response_reader, &response);
 
+	/* Make the fetch conditional so an unchanged calendar only costs a
+	 * header exchange */
+	if (!ast_strlen_zero(pvt->etag)) {
+		ne_add_request_header(req, "If-None-Match", pvt->etag);
+	}
+	if (!ast_strlen_zero(pvt->lastmod)) {
+		ne_add_request_header(req, "If-Modified-Since", pvt->lastmod);
+	}
+
 	ret = ne_request_dispatch(req);
+
+	if (ret == NE_OK && ne_get_status(req)->code == 304) {
+		pvt->unchanged = 1;
+		ne_request_destroy(req);
+		ast_free(response);
+		return NULL;
+	}
+
+	if (ret == NE_OK) {
+		const char *hdr;
+
+		if ((hdr = ne_get_response_header(req, "ETag"))) {
+			ast_string_field_set(pvt, etag, hdr);
+		}
+		if ((hdr = ne_get_response_header(req, "Last-Modified"))) {
+			ast_string_field_set(pvt, lastmod, hdr);
+		}
+	}
+
 	ne_request_destroy(req);
 	if (ret != NE_OK || !ast_str_strlen(response)) {
 		ast_log(LOG_WARNING, "Unable to retrieve iCalendar '%s' from '%s': %s\n", pvt->owner->name, pvt->url, ne_get_error(pvt->session));
@@ -449,6 +480,7 @@ static void *ical_load_calendar(void *void_data)
 	for(;;) {
 		struct timeval tv = ast_tvnow();
 		struct timespec ts = {0,};
+		icalcomponent *data;
 
 		ts.tv_sec = tv.tv_sec + (60 * pvt->owner->refresh);
 
@@ -467,14 +499,21 @@ static void *ical_load_calendar(void *void_data)
 
 		ast_debug(10, "Refreshing after %d minute timeout\n", pvt->owner->refresh);
 
-		/* Free the old calendar data */
-		if (pvt->data) {
-			icalcomponent_free(pvt->data);
-			pvt->data = NULL;
-		}
-		if (!(pvt->data = fetch_icalendar(pvt))) {
-			ast_log(LOG_WARNING, "Unable to parse iCalendar '%s'\n", pvt->owner->name);
-			continue;
+		pvt->unchanged = 0;
+		if (!(data = fetch_icalendar(pvt))) {
+			if (!pvt->unchanged || !pvt->data) {
+				ast_log(LOG_WARNING, "Unable to parse iCalendar '%s'\n", pvt->owner->name);
+				continue;
+			}
+			/* Not modified, so re-expand the new time window from the
+			 * data we already have */
+			ast_debug(3, "iCalendar %s unchanged, reusing parsed data\n", pvt->owner->name);
+		} else {
+			/* Replace the old calendar data */
+			if (pvt->data) {
+				icalcomponent_free(pvt->data);
+			}
+			pvt->data = data;
 		}
 
 		icalendar_update_events(pvt);
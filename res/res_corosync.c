@@ -225,17 +225,23 @@ static struct {
 	struct stasis_cache *(* cache_fn)(void);
 	struct stasis_message_type *(* message_type_fn)(void);
 	void (* publish_to_stasis)(struct ast_event *);
+	/*! If non-zero, the string IE identifying the entity an outbound event
+	 *  describes.  Events sharing the identity are coalesced within the
+	 *  configured window, with newer state superseding older. */
+	enum ast_event_ie_type coalesce_ie;
 } event_types[] = {
 	[AST_EVENT_MWI] = { .name = "mwi",
 	                    .topic_fn = ast_mwi_topic_all,
 	                    .cache_fn = ast_mwi_state_cache,
 	                    .message_type_fn = ast_mwi_state_type,
-	                    .publish_to_stasis = publish_mwi_to_stasis, },
+	                    .publish_to_stasis = publish_mwi_to_stasis,
+	                    .coalesce_ie = AST_EVENT_IE_MAILBOX, },
 	[AST_EVENT_DEVICE_STATE_CHANGE] = { .name = "device_state",
 	                                    .topic_fn = ast_device_state_topic_all,
 	                                    .cache_fn = ast_device_state_cache,
 	                                    .message_type_fn = ast_device_state_message_type,
-	                                    .publish_to_stasis = publish_device_state_to_stasis, },
+	                                    .publish_to_stasis = publish_device_state_to_stasis,
+	                                    .coalesce_ie = AST_EVENT_IE_DEVICE, },
 	[AST_EVENT_PING] = { .name = "ping",
 	                     .publish_default = 1,
 	                     .subscribe_default = 1,
@@ -259,6 +265,36 @@ static struct {
 	.alert_pipe = { -1, -1 },
 };
 
+/*! \brief Default time outbound events are held so a flood can coalesce */
+#define COALESCE_WINDOW_DEFAULT_MS 50
+
+/*! \brief Maximum number of events packed into a single CPG message */
+#define BATCH_MAX_EVENTS 32
+
+/*! \brief Soft cap on the payload carried by a single CPG message */
+#define BATCH_MAX_BYTES 49152
+
+/*! \brief Past this many pending events the supersede scan is skipped */
+#define COALESCE_SCAN_LIMIT 512
+
+/*! \brief Milliseconds to hold outbound events for coalescing; 0 disables */
+static unsigned int coalesce_window_ms = COALESCE_WINDOW_DEFAULT_MS;
+
+/*! \brief An outbound event waiting for the coalescing window to expire */
+struct pending_event {
+	AST_LIST_ENTRY(pending_event) entry;
+	struct ast_event *event;
+};
+
+/*! \brief Outbound events waiting to be multicast to the cluster */
+static AST_LIST_HEAD_STATIC(pending_events, pending_event);
+
+/*! \brief Number of events on \ref pending_events */
+static unsigned int pending_count;
+
+/*! \brief When the pending events are due on the wire (valid while non-empty) */
+static struct timeval pending_flush_deadline;
+
 static cpg_handle_t cpg_handle;
 static corosync_cfg_handle_t cfg_handle;
 
@@ -460,20 +496,13 @@ static void cfg_shutdown_cb(corosync_cfg_handle_t cfg_handle,
 {
 }
 
-static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_name,
-		uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
+/*! \brief Handle a single event carried in a CPG message */
+static void cpg_deliver_event(void *msg, size_t msg_len)
 {
 	struct ast_event *event;
 	void (*publish_handler)(struct ast_event *) = NULL;
 	enum ast_event_type event_type;
 
-	if (msg_len < ast_event_minimum_length()) {
-		ast_debug(1, "Ignoring event that's too small. %u < %u\n",
-			(unsigned int) msg_len,
-			(unsigned int) ast_event_minimum_length());
-		return;
-	}
-
 	if (!ast_eid_cmp(&ast_eid_default, ast_event_get_ie_raw(msg, AST_EVENT_IE_EID))) {
 		/* Don't feed events back in that originated locally. */
 		return;
@@ -514,6 +543,39 @@ static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 	publish_handler(event);
 }
 
+static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_name,
+		uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
+{
+	unsigned char *data = msg;
+
+	/*
+	 * A CPG message may carry several concatenated events when the sender
+	 * batched them; each event carries its own length, so walk the payload
+	 * event by event.
+	 */
+	while (msg_len >= ast_event_minimum_length()) {
+		size_t event_len = ast_event_get_size((struct ast_event *) data);
+
+		if (event_len < ast_event_minimum_length() || msg_len < event_len) {
+			ast_debug(1, "Ignoring malformed remainder of event batch. %u of %u byte(s)\n",
+				(unsigned int) event_len,
+				(unsigned int) msg_len);
+			return;
+		}
+
+		cpg_deliver_event(data, event_len);
+
+		data += event_len;
+		msg_len -= event_len;
+	}
+
+	if (msg_len) {
+		ast_debug(1, "Ignoring trailing event fragment that's too small. %u < %u\n",
+			(unsigned int) msg_len,
+			(unsigned int) ast_event_minimum_length());
+	}
+}
+
 static void publish_event_to_corosync(struct ast_event *event)
 {
 	cs_error_t cs_err;
@@ -533,9 +595,147 @@ static void publish_event_to_corosync(struct ast_event *event)
 	}
 }
 
+/*! \brief Determine whether two events of the same type describe the same entity */
+static int event_keys_match(const struct ast_event *left, const struct ast_event *right,
+		enum ast_event_ie_type coalesce_ie)
+{
+	const char *left_key = ast_event_get_ie_str(left, coalesce_ie);
+	const char *right_key = ast_event_get_ie_str(right, coalesce_ie);
+
+	if (!left_key || !right_key || strcmp(left_key, right_key)) {
+		return 0;
+	}
+
+	if (ast_event_get_type(left) == AST_EVENT_MWI) {
+		/* A mailbox is only unique within its context. */
+		left_key = ast_event_get_ie_str(left, AST_EVENT_IE_CONTEXT);
+		right_key = ast_event_get_ie_str(right, AST_EVENT_IE_CONTEXT);
+		if (!left_key || !right_key || strcmp(left_key, right_key)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*!
+ * \brief Hold an outbound event until the coalescing window expires.
+ *
+ * If a pending event already describes the same entity it has been
+ * superseded and is replaced in place, so a flood of changes for one
+ * device costs the cluster a single multicast.  Takes ownership of the
+ * event.
+ */
+static void queue_event_for_corosync(struct ast_event *event, enum ast_event_ie_type coalesce_ie)
+{
+	struct pending_event *new_pending;
+
+	new_pending = ast_calloc(1, sizeof(*new_pending));
+	if (!new_pending) {
+		publish_event_to_corosync(event);
+		ast_event_destroy(event);
+		return;
+	}
+	new_pending->event = event;
+
+	AST_LIST_LOCK(&pending_events);
+
+	if (pending_count < COALESCE_SCAN_LIMIT) {
+		struct pending_event *pending;
+
+		AST_LIST_TRAVERSE(&pending_events, pending, entry) {
+			if (ast_event_get_type(pending->event) != ast_event_get_type(event)) {
+				continue;
+			}
+			if (event_keys_match(pending->event, event, coalesce_ie)) {
+				/* Superseded.  Replace in place to preserve ordering. */
+				ast_event_destroy(pending->event);
+				pending->event = event;
+				AST_LIST_UNLOCK(&pending_events);
+				ast_free(new_pending);
+				return;
+			}
+		}
+	}
+
+	if (AST_LIST_EMPTY(&pending_events)) {
+		char meepmeep = 'x';
+
+		pending_flush_deadline = ast_tvadd(ast_tvnow(),
+			ast_samp2tv(coalesce_window_ms, 1000));
+		if (ast_carefulwrite(dispatch_thread.alert_pipe[1], &meepmeep, 1, 5000) == -1) {
+			ast_log(LOG_ERROR, "Failed to write to pipe: %s (%d)\n",
+					strerror(errno), errno);
+		}
+	}
+	AST_LIST_INSERT_TAIL(&pending_events, new_pending, entry);
+	pending_count++;
+
+	AST_LIST_UNLOCK(&pending_events);
+}
+
+/*! \brief Multicast a batch of pending events as one CPG message */
+static void send_event_batch(struct iovec *iov, struct pending_event **batch, unsigned int count)
+{
+	cs_error_t cs_err;
+	unsigned int i;
+
+	if (!count) {
+		return;
+	}
+
+	ast_debug(5, "Multicasting a batch of %u event(s) to corosync\n", count);
+
+	if ((cs_err = cpg_mcast_joined(cpg_handle, CPG_TYPE_FIFO, iov, count)) != CS_OK) {
+		ast_log(LOG_WARNING, "CPG mcast failed (%u) for a batch of %u event(s)\n",
+			cs_err, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		ast_event_destroy(batch[i]->event);
+		ast_free(batch[i]);
+	}
+}
+
+/*! \brief Send every pending event to the cluster in batched CPG messages */
+static void flush_pending_events(void)
+{
+	struct pending_event *pending;
+	struct pending_event *batch[BATCH_MAX_EVENTS];
+	struct iovec iov[BATCH_MAX_EVENTS];
+	unsigned int count = 0;
+	size_t bytes = 0;
+	AST_LIST_HEAD_NOLOCK(, pending_event) doomed = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+
+	AST_LIST_LOCK(&pending_events);
+	AST_LIST_APPEND_LIST(&doomed, &pending_events, entry);
+	pending_count = 0;
+	AST_LIST_UNLOCK(&pending_events);
+
+	while ((pending = AST_LIST_REMOVE_HEAD(&doomed, entry))) {
+		size_t event_len = ast_event_get_size(pending->event);
+
+		if (count && (count == BATCH_MAX_EVENTS || BATCH_MAX_BYTES < bytes + event_len)) {
+			send_event_batch(iov, batch, count);
+			count = 0;
+			bytes = 0;
+		}
+
+		iov[count].iov_base = (void *) pending->event;
+		iov[count].iov_len = event_len;
+		batch[count] = pending;
+		count++;
+		bytes += event_len;
+	}
+
+	send_event_batch(iov, batch, count);
+}
+
 static void publish_to_corosync(struct stasis_message *message)
 {
 	struct ast_event *event;
+	enum ast_event_ie_type coalesce_ie = 0;
+	enum ast_event_type type;
 
 	event = stasis_message_to_event(message);
 	if (!event) {
@@ -548,7 +748,9 @@ static void publish_to_corosync(struct stasis_message *message)
 		return;
 	}
 
-	if (ast_event_get_type(event) == AST_EVENT_PING) {
+	type = ast_event_get_type(event);
+
+	if (type == AST_EVENT_PING) {
 		const struct ast_eid *eid;
 		char buf[128] = "";
 
@@ -557,7 +759,19 @@ static void publish_to_corosync(struct stasis_message *message)
 		ast_log(LOG_NOTICE, "Sending event PING from this server with EID: '%s'\n", buf);
 	}
 
+	ast_rwlock_rdlock(&event_types_lock);
+	if (type < ARRAY_LEN(event_types)) {
+		coalesce_ie = event_types[type].coalesce_ie;
+	}
+	ast_rwlock_unlock(&event_types_lock);
+
+	if (coalesce_window_ms && coalesce_ie) {
+		queue_event_for_corosync(event, coalesce_ie);
+		return;
+	}
+
 	publish_event_to_corosync(event);
+	ast_event_destroy(event);
 }
 
 static void stasis_message_cb(void *data, struct stasis_subscription *sub, struct stasis_message *message)
@@ -604,7 +818,10 @@ static void cpg_confchg_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 	}
 
 	/* If any new nodes have joined, dump our cache of events we are publishing
-	 * that originated from this server. */
+	 * that originated from this server.  The cache holds one entry per device
+	 * or mailbox, so this is a snapshot of current state rather than a replay
+	 * of the changes that led to it, and it flows through the coalescing
+	 * queue so it reaches the wire as batched CPG messages. */
 	if (!joined_list_entries) {
 		return;
 	}
@@ -697,6 +914,8 @@ static void *dispatch_thread_handler(void *data)
 	send_cluster_notify();
 	while (!dispatch_thread.stop) {
 		int res;
+		int timeout = -1;
+		int flush;
 
 		cs_err = CS_OK;
 
@@ -704,7 +923,17 @@ static void *dispatch_thread_handler(void *data)
 		pfd[1].revents = 0;
 		pfd[2].revents = 0;
 
-		res = ast_poll(pfd, ARRAY_LEN(pfd), -1);
+		/* Wake up when the pending events are due on the wire. */
+		AST_LIST_LOCK(&pending_events);
+		if (!AST_LIST_EMPTY(&pending_events)) {
+			timeout = ast_tvdiff_ms(pending_flush_deadline, ast_tvnow());
+			if (timeout < 0) {
+				timeout = 0;
+			}
+		}
+		AST_LIST_UNLOCK(&pending_events);
+
+		res = ast_poll(pfd, ARRAY_LEN(pfd), timeout);
 		if (res == -1 && errno != EINTR && errno != EAGAIN) {
 			ast_log(LOG_ERROR, "poll() error: %s (%d)\n", strerror(errno), errno);
 			continue;
@@ -722,6 +951,25 @@ static void *dispatch_thread_handler(void *data)
 			}
 		}
 
+		if (pfd[2].revents & POLLIN) {
+			char dummy[16];
+
+			/* Just drain the alerts; the timeout and stop flag
+			 * above carry the actual information. */
+			if (read(dispatch_thread.alert_pipe[0], dummy, sizeof(dummy)) < 0) {
+				ast_log(LOG_ERROR, "Failed to read from pipe: %s (%d)\n",
+						strerror(errno), errno);
+			}
+		}
+
+		AST_LIST_LOCK(&pending_events);
+		flush = !AST_LIST_EMPTY(&pending_events)
+			&& ast_tvdiff_ms(ast_tvnow(), pending_flush_deadline) >= 0;
+		AST_LIST_UNLOCK(&pending_events);
+		if (flush) {
+			flush_pending_events();
+		}
+
 		if (cs_err == CS_ERR_LIBRARY || cs_err == CS_ERR_BAD_HANDLE) {
 			struct cpg_name name;
 
@@ -972,12 +1220,20 @@ static int load_general_config(struct ast_config *cfg)
 		event_types[i].publish = event_types[i].publish_default;
 		event_types[i].subscribe = event_types[i].subscribe_default;
 	}
+	coalesce_window_ms = COALESCE_WINDOW_DEFAULT_MS;
 
 	for (v = ast_variable_browse(cfg, "general"); v && !res; v = v->next) {
 		if (!strcasecmp(v->name, "publish_event")) {
 			res = set_event(v->value, PUBLISH);
 		} else if (!strcasecmp(v->name, "subscribe_event")) {
 			res = set_event(v->value, SUBSCRIBE);
+		} else if (!strcasecmp(v->name, "coalesce_window")) {
+			if (sscanf(v->value, "%30u", &coalesce_window_ms) != 1
+				|| coalesce_window_ms > 1000) {
+				ast_log(LOG_WARNING, "Invalid coalesce_window '%s'; must be 0-1000 ms\n",
+						v->value);
+				coalesce_window_ms = COALESCE_WINDOW_DEFAULT_MS;
+			}
 		} else {
 			ast_log(LOG_WARNING, "Unknown option '%s'\n", v->name);
 		}
@@ -1033,6 +1289,7 @@ static int load_config(unsigned int reload)
 static void cleanup_module(void)
 {
 	cs_error_t cs_err;
+	struct pending_event *pending;
 	unsigned int i;
 
 	if (stasis_router) {
@@ -1072,6 +1329,16 @@ static void cleanup_module(void)
 		pthread_join(dispatch_thread.id, NULL);
 	}
 
+	/* The dispatch thread is gone, so nothing will flush these now.  The
+	 * cluster resyncs from our cache on the next join anyway. */
+	AST_LIST_LOCK(&pending_events);
+	while ((pending = AST_LIST_REMOVE_HEAD(&pending_events, entry))) {
+		ast_event_destroy(pending->event);
+		ast_free(pending);
+	}
+	pending_count = 0;
+	AST_LIST_UNLOCK(&pending_events);
+
 	if (dispatch_thread.alert_pipe[0] != -1) {
 		close(dispatch_thread.alert_pipe[0]);
 		dispatch_thread.alert_pipe[0] = -1;
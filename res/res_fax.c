@@ -89,6 +89,8 @@
 #include "asterisk/stasis_channels.h"
 #include "asterisk/smoother.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 
 /*** DOCUMENTATION
 	<application name="ReceiveFAX" language="en_US" module="res_fax">
@@ -455,6 +457,8 @@ struct fax_gateway {
 	int detected_v21:1;
 	/*! \brief a flag to track the state of our negotiation */
 	enum ast_t38_state t38_state;
+	/*! \brief serialized worker queue running this session's DSP work */
+	struct ast_taskprocessor *serializer;
 	/*! \brief original audio formats */
 	struct ast_format *chan_read_format;
 	struct ast_format *chan_write_format;
@@ -483,6 +487,9 @@ struct fax_detect {
 
 static int fax_logger_level = -1;
 
+/*! \brief thread pool servicing gateway DSP work off the channel threads */
+static struct ast_threadpool *fax_gateway_pool;
+
 /*! \brief maximum buckets for res_fax ao2 containers */
 #define FAX_MAXBUCKETS 10
 
@@ -2845,6 +2852,9 @@ static void destroy_gateway(void *data)
 		gateway->s = NULL;
 	}
 
+	ast_taskprocessor_unreference(gateway->serializer);
+	gateway->serializer = NULL;
+
 	ao2_cleanup(gateway->chan_read_format);
 	ao2_cleanup(gateway->chan_write_format);
 	ao2_cleanup(gateway->peer_read_format);
@@ -2932,6 +2942,19 @@ static int fax_gateway_start(struct fax_gateway *gateway, struct ast_fax_session
 	gateway->s = s;
 	gateway->token = NULL;
 
+	/* hand the heavy modem processing for this session off to a
+	 * serialized worker so it does not run on the channel threads.  If
+	 * the serializer can't be created the gateway falls back to running
+	 * the DSP work in-line. */
+	if (!gateway->serializer) {
+		char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		snprintf(tps_name, sizeof(tps_name), "fax/gw-%u", s->id);
+		if (!(gateway->serializer = ast_threadpool_serializer(tps_name, fax_gateway_pool))) {
+			ast_log(LOG_WARNING, "Can't create DSP serializer for FAX session '%u', processing will run on the channel threads.\n", s->id);
+		}
+	}
+
 	ast_channel_unlock(chan);
 	start_res = gateway->s->tech->start_session(gateway->s);
 	ast_channel_lock(chan);
@@ -3285,6 +3308,83 @@ static struct ast_frame *fax_gateway_detect_t38(struct fax_gateway *gateway, str
 	return f;
 }
 
+/*! \brief a frame handed to a gateway session's DSP worker */
+struct fax_gateway_frame_task {
+	/*! \brief the session the frame is written to */
+	struct ast_fax_session *s;
+	/*! \brief private copy of the frame to process */
+	struct ast_frame *f;
+};
+
+/*! \brief serialized task running a gateway frame through the FAX technology */
+static int fax_gateway_write_task(void *data)
+{
+	struct fax_gateway_frame_task *task = data;
+
+	/* XXX as in the in-line write path, the return value is ignored */
+	task->s->tech->write(task->s, task->f);
+
+	ast_frfree(task->f);
+	ao2_ref(task->s, -1);
+	ast_free(task);
+	return 0;
+}
+
+/*! \brief Queue a frame to a gateway session's DSP worker.
+ * \param gateway the gateway the frame belongs to
+ * \param f the frame to process
+ *
+ * The frame is duplicated for the worker; the caller keeps ownership of
+ * \a f. Frames queued for a single session are processed in order on a
+ * single pool thread at a time, so the technology sees the same
+ * serialized stream it would see from the channel threads.
+ *
+ * \retval 0 the frame was queued
+ * \retval -1 the frame could not be queued and must be written in-line
+ */
+static int fax_gateway_queue_frame(struct fax_gateway *gateway, struct ast_frame *f)
+{
+	struct fax_gateway_frame_task *task;
+
+	if (!gateway->serializer) {
+		return -1;
+	}
+
+	if (!(task = ast_calloc(1, sizeof(*task)))) {
+		return -1;
+	}
+
+	if (!(task->f = ast_frdup(f))) {
+		ast_free(task);
+		return -1;
+	}
+
+	ao2_ref(gateway->s, +1);
+	task->s = gateway->s;
+
+	if (ast_taskprocessor_push(gateway->serializer, fax_gateway_write_task, task)) {
+		ast_frfree(task->f);
+		ao2_ref(task->s, -1);
+		ast_free(task);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*! \brief serialized task cancelling a gateway session after queued DSP work */
+static int fax_gateway_cancel_task(void *data)
+{
+	struct ast_fax_session *s = data;
+
+	if (s->tech->cancel_session) {
+		s->tech->cancel_session(s);
+	}
+
+	ao2_ref(s, -1);
+	return 0;
+}
+
 /*! \brief Destroy the gateway data structure when the framehook is detached
  * \param data framehook data (gateway data)*/
 static void fax_gateway_framehook_destroy(void *data)
@@ -3298,6 +3398,15 @@ static void fax_gateway_framehook_destroy(void *data)
 		case AST_FAX_STATE_ACTIVE:
 		case AST_FAX_STATE_COMPLETE:
 			if (gateway->s->tech->cancel_session) {
+				/* cancel through the serializer so the cancel lands
+				 * after any frames still queued for this session */
+				if (gateway->serializer) {
+					ao2_ref(gateway->s, +1);
+					if (!ast_taskprocessor_push(gateway->serializer, fax_gateway_cancel_task, gateway->s)) {
+						break;
+					}
+					ao2_ref(gateway->s, -1);
+				}
 				gateway->s->tech->cancel_session(gateway->s);
 			}
 			/* fall through */
@@ -3515,9 +3624,11 @@ static struct ast_frame *fax_gateway_framehook(struct ast_channel *chan, struct
 			 * disable the gateway if a write fails. I am not sure how a
 			 * write would fail, or even if a failure would be fatal so for
 			 * now we'll just ignore the return value. */
-			gateway->s->tech->write(gateway->s, f);
+			if (fax_gateway_queue_frame(gateway, f)) {
+				gateway->s->tech->write(gateway->s, f);
+			}
 			ast_frfree(f);
-		} else {
+		} else if (fax_gateway_queue_frame(gateway, f)) {
 			gateway->s->tech->write(gateway->s, f);
 		}
 
@@ -4706,6 +4817,9 @@ static int unload_module(void)
 		ast_logger_unregister_level("FAX");
 	}
 
+	ast_threadpool_shutdown(fax_gateway_pool);
+	fax_gateway_pool = NULL;
+
 	ao2_ref(faxregistry.container, -1);
 
 	return 0;
@@ -4724,6 +4838,13 @@ static int unload_module(void)
 static int load_module(void)
 {
 	int res;
+	struct ast_threadpool_options pool_options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.auto_increment = 1,
+		.max_size = 0,
+		.idle_timeout = 60,
+		.initial_size = 0,
+	};
 
 	/* initialize the registry */
 	faxregistry.active_sessions = 0;
@@ -4732,8 +4853,15 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	if (!(fax_gateway_pool = ast_threadpool_create("fax-gateway", NULL, &pool_options))) {
+		ast_log(LOG_ERROR, "failed to create FAX gateway thread pool\n");
+		ao2_ref(faxregistry.container, -1);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (set_config(0) < 0) {
 		ast_log(LOG_ERROR, "failed to load configuration file '%s'\n", config);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -4741,12 +4869,14 @@ static int load_module(void)
 	/* register CLI operations and applications */
 	if (ast_register_application_xml(app_sendfax, sendfax_exec) < 0) {
 		ast_log(LOG_WARNING, "failed to register '%s'.\n", app_sendfax);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
 	if (ast_register_application_xml(app_receivefax, receivefax_exec) < 0) {
 		ast_log(LOG_WARNING, "failed to register '%s'.\n", app_receivefax);
 		ast_unregister_application(app_sendfax);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -4755,6 +4885,7 @@ static int load_module(void)
 		ast_log(LOG_WARNING, "failed to register 'FAXSessions' AMI command.\n");
 		ast_unregister_application(app_receivefax);
 		ast_unregister_application(app_sendfax);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -4764,6 +4895,7 @@ static int load_module(void)
 		ast_manager_unregister("FAXSession");
 		ast_unregister_application(app_receivefax);
 		ast_unregister_application(app_sendfax);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -4774,6 +4906,7 @@ static int load_module(void)
 		ast_manager_unregister("FAXSessions");
 		ast_unregister_application(app_receivefax);
 		ast_unregister_application(app_sendfax);
+		ast_threadpool_shutdown(fax_gateway_pool);
 		ao2_ref(faxregistry.container, -1);
 		return AST_MODULE_LOAD_DECLINE;
 	}
@@ -37,6 +37,7 @@
  */
 
 /*** MODULEINFO
+	<use type="external">zlib</use>
 	<support_level>extended</support_level>
  ***/
 
@@ -72,6 +73,26 @@
 				<configOption name="capture_address" default="192.168.1.1:9061">
 					<synopsis>The address and port of the Homer server to send packets to.</synopsis>
 				</configOption>
+				<configOption name="capture_transport" default="udp">
+					<synopsis>The transport used to ship packets to the Homer server.</synopsis>
+					<description>
+						<enumlist>
+							<enum name="udp"><para>Send each capture packet in its own datagram</para></enum>
+							<enum name="tcp"><para>Stream length-prefixed capture packets over a TCP
+							connection.  Packets are batched and flushed on a short timer, which
+							significantly reduces the packet rate under heavy capture load.</para></enum>
+						</enumlist>
+					</description>
+				</configOption>
+				<configOption name="payload_compression" default="no">
+					<synopsis>Compress capture payloads with zlib before sending.</synopsis>
+					<description>
+						<enumlist>
+							<enum name="no" />
+							<enum name="yes" />
+						</enumlist>
+					</description>
+				</configOption>
 				<configOption name="capture_password">
 					<synopsis>If set, the authentication password to send to Homer.</synopsis>
 				</configOption>
@@ -89,6 +110,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/config_options.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/sched.h"
 #include "asterisk/res_hep.h"
 
 #include <netinet/ip.h>
@@ -96,8 +118,21 @@
 #include <netinet/udp.h>
 #include <netinet/ip6.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #define DEFAULT_HEP_SERVER ""
 
+/*! How long to wait before flushing a partially filled TCP batch buffer */
+#define HEP_BATCH_TIME_MS 10
+
+/*! Size of the TCP batch buffer.  A full buffer is flushed immediately. */
+#define HEP_BUFFER_SIZE 16384
+
+/*! Payloads smaller than this are never worth compressing */
+#define HEP_COMPRESS_THRESHOLD 128
+
 /*! Generic vendor ID. Used for HEPv3 standard packets */
 #define GENERIC_VENDOR_ID 0x0000
 
@@ -234,11 +269,19 @@ struct hep_generic {
 	struct hep_chunk_uint32 capt_id;
 } __attribute__((packed));
 
+/*! \brief Transports supported for shipping packets to the capture server */
+enum hep_transport {
+	HEP_TRANSPORT_UDP = 0,
+	HEP_TRANSPORT_TCP,
+};
+
 /*! \brief Global configuration for the module */
 struct hepv3_global_config {
 	unsigned int enabled;                    /*!< Whether or not sending is enabled */
 	unsigned int capture_id;                 /*!< Capture ID for this agent */
+	unsigned int payload_compression;        /*!< Whether to zlib compress payloads */
 	enum hep_uuid_type uuid_type;            /*!< The preferred type of the UUID */
+	enum hep_transport transport;            /*!< The transport to ship packets over */
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(capture_address);   /*!< Address to send to */
 		AST_STRING_FIELD(capture_password);  /*!< Password for Homer server */
@@ -254,6 +297,10 @@ struct module_config {
 struct hepv3_runtime_data {
 	struct ast_sockaddr remote_addr;  /*!< The address to send to */
 	int sockfd;                       /*!< The socket file descriptor */
+	enum hep_transport transport;     /*!< Transport the socket was created for */
+	char *buf;                        /*!< Batch buffer for TCP streaming */
+	size_t buf_len;                   /*!< Bytes currently held in \c buf */
+	unsigned int timer_scheduled:1;   /*!< Whether a batch flush timer is pending */
 };
 
 static struct aco_type global_option = {
@@ -279,6 +326,9 @@ static AO2_GLOBAL_OBJ_STATIC(global_data);
 
 static struct ast_taskprocessor *hep_queue_tp;
 
+/*! \brief Scheduler for flushing partially filled batch buffers */
+static struct ast_sched_context *hep_sched;
+
 static void *module_config_alloc(void);
 static void hepv3_config_post_apply(void);
 
@@ -356,15 +406,70 @@ static int uuid_type_handler(const struct aco_option *opt, struct ast_variable *
 	return 0;
 }
 
+/*! \brief Handler for the capture_transport attribute */
+static int transport_handler(const struct aco_option *opt, struct ast_variable *var, void *obj)
+{
+	struct hepv3_global_config *global_config = obj;
+
+	if (strcasecmp(var->name, "capture_transport")) {
+		return -1;
+	}
+
+	if (!strcasecmp(var->value, "udp")) {
+		global_config->transport = HEP_TRANSPORT_UDP;
+	} else if (!strcasecmp(var->value, "tcp")) {
+		global_config->transport = HEP_TRANSPORT_TCP;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/*! \brief Send a raw block of bytes over a stream socket, retrying short writes */
+static int hep_send_all(struct hepv3_runtime_data *data, const void *buf, size_t len)
+{
+	size_t offset = 0;
+
+	while (offset < len) {
+		ssize_t res = send(data->sockfd, (const char *) buf + offset, len - offset, 0);
+
+		if (res < 0) {
+			ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
+				errno, strerror(errno));
+			return -1;
+		}
+		offset += res;
+	}
+
+	return 0;
+}
+
+/*! \brief Flush the TCP batch buffer to the capture server */
+static int hep_send_buffer(struct hepv3_runtime_data *data)
+{
+	int res = 0;
+
+	if (data->buf_len) {
+		res = hep_send_all(data, data->buf, data->buf_len);
+		data->buf_len = 0;
+	}
+
+	return res;
+}
+
 /*! \brief HEPv3 run-time data destructor */
 static void hepv3_data_dtor(void *obj)
 {
 	struct hepv3_runtime_data *data = obj;
 
 	if (data->sockfd > -1) {
+		/* Best effort flush of anything still batched */
+		hep_send_buffer(data);
 		close(data->sockfd);
 		data->sockfd = -1;
 	}
+	ast_free(data->buf);
+	data->buf = NULL;
 }
 
 /*! \brief Allocate the HEPv3 run-time data */
@@ -377,13 +482,15 @@ static struct hepv3_runtime_data *hepv3_data_alloc(struct hepv3_global_config *c
 		return NULL;
 	}
 
+	data->transport = config->transport;
 	if (!ast_sockaddr_parse(&data->remote_addr, config->capture_address, PARSE_PORT_REQUIRE)) {
 		ast_log(AST_LOG_WARNING, "Failed to create address from %s\n", config->capture_address);
 		ao2_ref(data, -1);
 		return NULL;
 	}
 
-	data->sockfd = socket(ast_sockaddr_is_ipv6(&data->remote_addr) ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+	data->sockfd = socket(ast_sockaddr_is_ipv6(&data->remote_addr) ? AF_INET6 : AF_INET,
+		data->transport == HEP_TRANSPORT_TCP ? SOCK_STREAM : SOCK_DGRAM, 0);
 	if (data->sockfd < 0) {
 		ast_log(AST_LOG_WARNING, "Failed to create socket for address %s: %s\n",
 				config->capture_address, strerror(errno));
@@ -391,9 +498,76 @@ static struct hepv3_runtime_data *hepv3_data_alloc(struct hepv3_global_config *c
 		return NULL;
 	}
 
+	if (data->transport == HEP_TRANSPORT_TCP) {
+		if (ast_connect(data->sockfd, &data->remote_addr)) {
+			ast_log(AST_LOG_WARNING, "Failed to connect to %s: %s\n",
+					config->capture_address, strerror(errno));
+			ao2_ref(data, -1);
+			return NULL;
+		}
+
+		data->buf = ast_malloc(HEP_BUFFER_SIZE);
+		if (!data->buf) {
+			ao2_ref(data, -1);
+			return NULL;
+		}
+	}
+
 	return data;
 }
 
+/*! \brief Taskprocessor callback that flushes a partially filled batch buffer */
+static int hep_flush_cb(void *unused)
+{
+	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
+
+	if (!hepv3_data || hepv3_data->transport != HEP_TRANSPORT_TCP) {
+		return 0;
+	}
+
+	hepv3_data->timer_scheduled = 0;
+
+	return hep_send_buffer(hepv3_data);
+}
+
+/*! \brief Batch timer callback; hands the actual flush to the taskprocessor */
+static int hep_batch_timer_cb(const void *unused)
+{
+	if (ast_taskprocessor_push(hep_queue_tp, hep_flush_cb, NULL)) {
+		ast_debug(1, "Failed to push batch buffer flush to the taskprocessor\n");
+	}
+
+	return 0;
+}
+
+/*! \brief Queue a serialized HEPv3 packet on the TCP batch buffer
+ *
+ * The buffer is flushed immediately when full; otherwise a short one-shot
+ * timer flushes it, so that many capture packets arriving close together
+ * are shipped in a single TCP segment.
+ */
+static int hep_buffer_packet(struct hepv3_runtime_data *data, const void *packet, size_t len)
+{
+	if (len > HEP_BUFFER_SIZE - data->buf_len && hep_send_buffer(data)) {
+		return -1;
+	}
+
+	if (len > HEP_BUFFER_SIZE) {
+		/* Too large to ever batch; ship it on its own */
+		return hep_send_all(data, packet, len);
+	}
+
+	memcpy(data->buf + data->buf_len, packet, len);
+	data->buf_len += len;
+
+	if (!data->timer_scheduled
+		&& ast_sched_add(hep_sched, HEP_BATCH_TIME_MS, hep_batch_timer_cb, NULL) >= 0) {
+		data->timer_scheduled = 1;
+	}
+
+	return 0;
+}
+
 /*! \brief Destructor for a \ref hepv3_capture_info object */
 static void capture_info_dtor(void *obj)
 {
@@ -465,6 +639,28 @@ static int hep_queue_cb(void *data)
 		return -1;
 	}
 
+#ifdef HAVE_ZLIB
+	if (config->general->payload_compression && !capture_info->zipped
+		&& capture_info->len > HEP_COMPRESS_THRESHOLD) {
+		uLongf zipped_len = compressBound(capture_info->len);
+		Bytef *zipped = ast_malloc(zipped_len);
+
+		/* Only take the compressed payload if it actually shrank; tiny or
+		 * already dense payloads can grow, in which case they are sent as-is. */
+		if (zipped) {
+			if (compress(zipped, &zipped_len, capture_info->payload, capture_info->len) == Z_OK
+				&& zipped_len < capture_info->len) {
+				ast_free(capture_info->payload);
+				capture_info->payload = zipped;
+				capture_info->len = zipped_len;
+				capture_info->zipped = 1;
+			} else {
+				ast_free(zipped);
+			}
+		}
+	}
+#endif
+
 	packet_len = sizeof(hg_pkt);
 
 	/* Build HEPv3 header, capture info, and calculate the total packet size */
@@ -558,6 +754,14 @@ static int hep_queue_cb(void *data)
 
 	ast_assert(sock_buffer_len == packet_len);
 
+	if (hepv3_data->transport == HEP_TRANSPORT_TCP) {
+		/* HEP packets are length prefixed by their header, so multiple
+		 * packets can be coalesced on the stream and flushed together. */
+		res = hep_buffer_packet(hepv3_data, sock_buffer, sock_buffer_len);
+		ast_free(sock_buffer);
+		return res;
+	}
+
 	res = ast_sendto(hepv3_data->sockfd, sock_buffer, sock_buffer_len, 0, &hepv3_data->remote_addr);
 	if (res < 0) {
 		ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
@@ -626,6 +830,10 @@ static int reload_module(void)
  */
 static int unload_module(void)
 {
+	if (hep_sched) {
+		ast_sched_context_destroy(hep_sched);
+		hep_sched = NULL;
+	}
 	hep_queue_tp = ast_taskprocessor_unreference(hep_queue_tp);
 
 	ao2_global_obj_release(global_config);
@@ -649,11 +857,18 @@ static int load_module(void)
 		goto error;
 	}
 
+	hep_sched = ast_sched_context_create();
+	if (!hep_sched || ast_sched_start_thread(hep_sched)) {
+		goto error;
+	}
+
 	aco_option_register(&cfg_info, "enabled", ACO_EXACT, global_options, "yes", OPT_BOOL_T, 1, FLDSET(struct hepv3_global_config, enabled));
 	aco_option_register(&cfg_info, "capture_address", ACO_EXACT, global_options, DEFAULT_HEP_SERVER, OPT_STRINGFIELD_T, 0, STRFLDSET(struct hepv3_global_config, capture_address));
 	aco_option_register(&cfg_info, "capture_password", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct hepv3_global_config, capture_password));
 	aco_option_register(&cfg_info, "capture_id", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, STRFLDSET(struct hepv3_global_config, capture_id));
+	aco_option_register(&cfg_info, "payload_compression", ACO_EXACT, global_options, "no", OPT_BOOL_T, 1, FLDSET(struct hepv3_global_config, payload_compression));
 	aco_option_register_custom(&cfg_info, "uuid_type", ACO_EXACT, global_options, "call-id", uuid_type_handler, 0);
+	aco_option_register_custom(&cfg_info, "capture_transport", ACO_EXACT, global_options, "udp", transport_handler, 0);
 
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		goto error;
@@ -662,6 +877,10 @@ static int load_module(void)
 	return AST_MODULE_LOAD_SUCCESS;
 
 error:
+	if (hep_sched) {
+		ast_sched_context_destroy(hep_sched);
+		hep_sched = NULL;
+	}
 	aco_info_destroy(&cfg_info);
 	return AST_MODULE_LOAD_DECLINE;
 }
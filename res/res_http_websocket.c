@@ -24,11 +24,16 @@
  */
 
 /*** MODULEINFO
+	<use type="external">zlib</use>
 	<support_level>core</support_level>
  ***/
 
 #include "asterisk.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "asterisk/module.h"
 #include "asterisk/http.h"
 #include "asterisk/astobj2.h"
@@ -37,6 +42,7 @@
 #include "asterisk/unaligned.h"
 #include "asterisk/uri.h"
 #include "asterisk/uuid.h"
+#include "asterisk/sched.h"
 
 #define AST_API_MODULE
 #include "asterisk/http_websocket.h"
@@ -84,6 +90,9 @@
 #define MAX_WS_HDR_SZ 14
 #define MIN_WS_HDR_SZ 2
 
+/*! \brief Scheduler context used to flush write batched sessions */
+static struct ast_sched_context *websocket_sched;
+
 /*! \brief Structure definition for session */
 struct ast_websocket {
 	FILE *f;                           /*!< Pointer to the file instance used for writing and reading */
@@ -94,13 +103,325 @@ struct ast_websocket {
 	char *payload;                     /*!< Pointer to the payload */
 	size_t reconstruct;                /*!< Number of bytes before a reconstructed payload will be returned and a new one started */
 	int timeout;                       /*!< The timeout for operations on the socket */
+	int write_batch_ms;                /*!< Milliseconds written frames may be held back to coalesce flushes, zero to flush every frame */
+	int flush_sched_id;                /*!< Scheduler id of the pending deferred flush, or -1 when none is pending */
 	unsigned int secure:1;             /*!< Bit to indicate that the transport is secure */
 	unsigned int closing:1;            /*!< Bit to indicate that the session is in the process of being closed */
 	unsigned int close_sent:1;         /*!< Bit to indicate that the session close opcode has been sent and no further data will be sent */
+#ifdef HAVE_ZLIB
+	unsigned int rx_compressed:1;      /*!< Bit to indicate that the message being read arrived compressed */
+	struct websocket_deflate *deflate; /*!< Negotiated permessage-deflate state, NULL when the extension is not in use */
+#endif
 	struct websocket_client *client;   /*!< Client object when connected as a client websocket */
 	char session_id[AST_UUID_STR_LEN]; /*!< The identifier for the websocket session */
 };
 
+#ifdef HAVE_ZLIB
+
+/*! \brief Outgoing messages smaller than this are sent uncompressed; the deflate
+ *         header and flush overhead eat most of the gain on tiny frames and the
+ *         compressor run is pure cost. */
+#define WEBSOCKET_DEFLATE_SKIP_SIZE 128
+
+/*! \brief Growth increment for the decompression output buffer */
+#define WEBSOCKET_INFLATE_BUF_INCREMENT 8192
+
+/*! \brief RFC 7692 permessage-deflate state for a session
+ *
+ * Both directions keep their sliding window across messages (context
+ * takeover), which is where most of the gain on repetitive event streams
+ * comes from, unless the peer negotiated otherwise.
+ */
+struct websocket_deflate {
+	z_stream tx;                        /*!< Compressor for outgoing messages */
+	z_stream rx;                        /*!< Decompressor for incoming messages */
+	char *tx_buf;                       /*!< Scratch buffer compressed payloads are built in */
+	size_t tx_buf_size;                 /*!< Allocated size of the compression buffer */
+	char *rx_buf;                       /*!< Buffer decompressed payloads are returned in */
+	size_t rx_buf_size;                 /*!< Allocated size of the decompression buffer */
+	unsigned int tx_active:1;           /*!< Bit cleared when the compressor can no longer be trusted to stay in sync */
+	unsigned int no_context_takeover:1; /*!< Bit to indicate the compressor must be reset after every message */
+};
+
+static struct websocket_deflate *websocket_deflate_create(int window_bits, int no_context_takeover)
+{
+	struct websocket_deflate *deflate = ast_calloc(1, sizeof(*deflate));
+
+	if (!deflate) {
+		return NULL;
+	}
+
+	if (deflateInit2(&deflate->tx, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -window_bits,
+			8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		ast_free(deflate);
+		return NULL;
+	}
+
+	if (inflateInit2(&deflate->rx, -MAX_WBITS) != Z_OK) {
+		deflateEnd(&deflate->tx);
+		ast_free(deflate);
+		return NULL;
+	}
+
+	deflate->tx_active = 1;
+	deflate->no_context_takeover = no_context_takeover ? 1 : 0;
+
+	return deflate;
+}
+
+static void websocket_deflate_destroy(struct websocket_deflate *deflate)
+{
+	if (!deflate) {
+		return;
+	}
+
+	deflateEnd(&deflate->tx);
+	inflateEnd(&deflate->rx);
+	ast_free(deflate->tx_buf);
+	ast_free(deflate->rx_buf);
+	ast_free(deflate);
+}
+
+/*!
+ * \internal
+ * \brief Negotiate permessage-deflate against the extensions offered by a client
+ *
+ * \param offers The contents of the Sec-WebSocket-Extensions request header
+ * \param response Buffer the full response header line is written to when an offer is accepted
+ * \param response_size Size of the response buffer
+ *
+ * \retval deflate state to place on the session when an offer was accepted
+ * \retval NULL when no acceptable offer was present (response is left empty)
+ */
+static struct websocket_deflate *websocket_deflate_negotiate(const char *offers, char *response, size_t response_size)
+{
+	char *remaining = ast_strdupa(offers);
+	char *offer;
+
+	response[0] = '\0';
+
+	while ((offer = strsep(&remaining, ","))) {
+		char *params = offer;
+		char *param = strsep(&params, ";");
+		int window_bits = MAX_WBITS;
+		int no_context_takeover = 0;
+		int client_no_context_takeover = 0;
+		int acceptable = 1;
+		struct websocket_deflate *deflate;
+		size_t used;
+
+		if (strcasecmp(ast_strip(param), "permessage-deflate")) {
+			continue;
+		}
+
+		while (acceptable && (param = strsep(&params, ";"))) {
+			char *value = param;
+			char *name = ast_strip(strsep(&value, "="));
+
+			if (!strcasecmp(name, "server_no_context_takeover")) {
+				no_context_takeover = 1;
+			} else if (!strcasecmp(name, "client_no_context_takeover")) {
+				client_no_context_takeover = 1;
+			} else if (!strcasecmp(name, "client_max_window_bits")) {
+				/* This limits the window the client compresses with; our
+				 * decompressor always uses the maximum window, so any
+				 * value the client chooses is acceptable as-is. */
+			} else if (!strcasecmp(name, "server_max_window_bits")) {
+				if (!value || sscanf(ast_strip(value), "%30d", &window_bits) != 1
+					|| window_bits < 9 || window_bits > MAX_WBITS) {
+					/* zlib cannot reliably produce raw deflate with a
+					 * window below 9 bits, so decline such an offer. */
+					acceptable = 0;
+				}
+			} else {
+				/* RFC 7692 requires declining an offer containing a
+				 * parameter we do not understand. */
+				acceptable = 0;
+			}
+		}
+
+		if (!acceptable) {
+			continue;
+		}
+
+		deflate = websocket_deflate_create(window_bits, no_context_takeover);
+		if (!deflate) {
+			return NULL;
+		}
+
+		used = snprintf(response, response_size,
+			"Sec-WebSocket-Extensions: permessage-deflate");
+		if (no_context_takeover) {
+			used += snprintf(response + used, response_size - used,
+				"; server_no_context_takeover");
+		}
+		if (client_no_context_takeover) {
+			used += snprintf(response + used, response_size - used,
+				"; client_no_context_takeover");
+		}
+		if (window_bits < MAX_WBITS) {
+			used += snprintf(response + used, response_size - used,
+				"; server_max_window_bits=%d", window_bits);
+		}
+		snprintf(response + used, response_size - used, "\r\n");
+
+		return deflate;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Compress an outgoing message payload
+ *
+ * On success the payload pointer and size are swapped for the compressed
+ * form, which lives in a per-session scratch buffer.
+ *
+ * \note Must be called with the session locked.
+ *
+ * \retval 0 on success
+ * \retval -1 if the payload must be sent uncompressed
+ */
+static int websocket_deflate_payload(struct ast_websocket *session, char **payload, uint64_t *payload_size)
+{
+	struct websocket_deflate *dstate = session->deflate;
+	uLong bound;
+	uint64_t deflated_size;
+
+	if (!dstate->tx_active) {
+		return -1;
+	}
+
+	/* Padding on top of deflateBound() covers the extra empty block a
+	 * Z_SYNC_FLUSH may emit, so a single deflate call always suffices. */
+	bound = deflateBound(&dstate->tx, *payload_size) + 16;
+	if (dstate->tx_buf_size < bound) {
+		char *buf = ast_realloc(dstate->tx_buf, bound);
+
+		if (!buf) {
+			/* Nothing was fed to the compressor, sending uncompressed is safe */
+			return -1;
+		}
+		dstate->tx_buf = buf;
+		dstate->tx_buf_size = bound;
+	}
+
+	dstate->tx.next_in = (unsigned char *) *payload;
+	dstate->tx.avail_in = *payload_size;
+	dstate->tx.next_out = (unsigned char *) dstate->tx_buf;
+	dstate->tx.avail_out = dstate->tx_buf_size;
+
+	if (deflate(&dstate->tx, Z_SYNC_FLUSH) != Z_OK || dstate->tx.avail_in) {
+		/* The compressor consumed input the peer will never see, so later
+		 * messages could reference history the peer's decompressor does not
+		 * have; stop compressing on this session entirely. */
+		dstate->tx_active = 0;
+		return -1;
+	}
+
+	deflated_size = dstate->tx_buf_size - dstate->tx.avail_out;
+
+	/* A Z_SYNC_FLUSH always ends the output with an empty stored block
+	 * (00 00 ff ff) which RFC 7692 says to strip before framing. */
+	if (deflated_size < 4) {
+		dstate->tx_active = 0;
+		return -1;
+	}
+	deflated_size -= 4;
+
+	if (dstate->no_context_takeover) {
+		deflateReset(&dstate->tx);
+	}
+
+	*payload = dstate->tx_buf;
+	*payload_size = deflated_size;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Decompress a received message payload
+ *
+ * On success the payload pointer and size are swapped for the decompressed
+ * form, which lives in a per-session buffer that remains valid until the
+ * next compressed message is read.
+ *
+ * \param final Non-zero when this payload ends its message, restoring the
+ *              flush block the sender stripped per RFC 7692
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int websocket_inflate_payload(struct ast_websocket *session, char **payload, uint64_t *payload_len, int final)
+{
+	static const unsigned char tail[4] = { 0x00, 0x00, 0xff, 0xff };
+	struct websocket_deflate *deflate = session->deflate;
+	size_t used = 0;
+	int tail_fed = !final;
+	int res;
+
+	deflate->rx.next_in = (unsigned char *) *payload;
+	deflate->rx.avail_in = *payload_len;
+
+	for (;;) {
+		uInt before;
+
+		if (used == deflate->rx_buf_size) {
+			char *buf;
+
+			if (deflate->rx_buf_size >= MAXIMUM_FRAME_SIZE) {
+				ast_log(LOG_WARNING, "Cannot fit huge decompressed websocket payload\n");
+				return -1;
+			}
+			buf = ast_realloc(deflate->rx_buf,
+				deflate->rx_buf_size + WEBSOCKET_INFLATE_BUF_INCREMENT);
+			if (!buf) {
+				return -1;
+			}
+			deflate->rx_buf = buf;
+			deflate->rx_buf_size += WEBSOCKET_INFLATE_BUF_INCREMENT;
+		}
+
+		deflate->rx.next_out = (unsigned char *) deflate->rx_buf + used;
+		deflate->rx.avail_out = deflate->rx_buf_size - used;
+		before = deflate->rx.avail_out;
+
+		res = inflate(&deflate->rx, Z_SYNC_FLUSH);
+		used += before - deflate->rx.avail_out;
+
+		if (res != Z_OK && res != Z_BUF_ERROR) {
+			ast_log(LOG_WARNING, "Failed to decompress websocket payload: %s\n",
+				deflate->rx.msg ? deflate->rx.msg : "unknown error");
+			return -1;
+		}
+
+		if (deflate->rx.avail_in) {
+			/* More input remains, provide more output space */
+			continue;
+		}
+		if (!tail_fed) {
+			deflate->rx.next_in = (unsigned char *) tail;
+			deflate->rx.avail_in = sizeof(tail);
+			tail_fed = 1;
+			continue;
+		}
+		if (!deflate->rx.avail_out) {
+			/* The output space filled up exactly, check for more */
+			continue;
+		}
+		break;
+	}
+
+	*payload = deflate->rx_buf;
+	*payload_len = used;
+
+	return 0;
+}
+
+#endif	/* HAVE_ZLIB */
+
 /*! \brief Hashing function for protocols */
 static int protocol_hash_fn(const void *obj, const int flags)
 {
@@ -189,6 +510,9 @@ static void session_destroy_fn(void *obj)
 
 	ao2_cleanup(session->client);
 	ast_free(session->payload);
+#ifdef HAVE_ZLIB
+	websocket_deflate_destroy(session->deflate);
+#endif
 }
 
 struct ast_websocket_protocol *AST_OPTIONAL_API_NAME(ast_websocket_sub_protocol_alloc)(const char *name)
@@ -342,17 +666,140 @@ static const char *websocket_opcode2str(enum ast_websocket_opcode opcode)
 	}
 }
 
+/*! \brief Scheduler callback which flushes frames held back by write batching */
+static int websocket_flush_cb(const void *data)
+{
+	struct ast_websocket *session = (struct ast_websocket *) data;
+
+	ao2_lock(session);
+	session->flush_sched_id = -1;
+	if (session->f && ast_careful_fwrite(session->f, session->fd, "", 0, session->timeout)) {
+		/* A failed flush is as fatal as a failed write; explicitly terminate
+		 * the connection so the thread polling on it wakes up and terminates.
+		 */
+		fclose(session->f);
+		session->f = NULL;
+		ast_verb(2, "WebSocket connection %s '%s' forcefully closed due to fatal write error\n",
+			session->client ? "to" : "from", ast_sockaddr_stringify(&session->address));
+	}
+	ao2_unlock(session);
+
+	ao2_ref(session, -1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Buffer a piece of a frame on a session without flushing it.
+ *
+ * Behaves like ast_careful_fwrite() except that the stream buffer is left
+ * unflushed on success, so consecutive pieces of a frame, and frames
+ * batched together, are pushed to the socket by a single flush.
+ *
+ * \note Must be called with the session locked.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int websocket_write_buffered(struct ast_websocket *session, const char *buf, uint64_t size)
+{
+	struct timeval start = ast_tvnow();
+	int elapsed = 0;
+
+	while (size) {
+		size_t written;
+
+		/* Clear any errors from a previous write */
+		clearerr(session->f);
+
+		written = fwrite(buf, 1, size, session->f);
+
+		if (ferror(session->f) && errno != EINTR && errno != EAGAIN) {
+			/* fatal error from fwrite() */
+			if (!feof(session->f)) {
+				/* Don't spam the logs if it was just that the connection is closed. */
+				ast_log(LOG_ERROR, "fwrite() returned error: %s\n", strerror(errno));
+			}
+			return -1;
+		}
+
+		buf += written;
+		size -= written;
+		if (!size) {
+			break;
+		}
+
+		/* The stream buffer is full and the socket is not accepting more,
+		 * so wait for it to drain as ast_careful_fwrite() would.
+		 */
+		elapsed = ast_tvdiff_ms(ast_tvnow(), start);
+		if (elapsed >= session->timeout
+			|| ast_wait_for_output(session->fd, session->timeout - elapsed) <= 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Flush buffered frames, or leave them for the batch window to expire.
+ *
+ * \note Must be called with the session locked.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int websocket_flush_or_defer(struct ast_websocket *session)
+{
+	if (session->write_batch_ms && websocket_sched) {
+		if (session->flush_sched_id >= 0) {
+			return 0;
+		}
+
+		ao2_ref(session, +1);
+		session->flush_sched_id = ast_sched_add(websocket_sched,
+			session->write_batch_ms, websocket_flush_cb, session);
+		if (session->flush_sched_id >= 0) {
+			return 0;
+		}
+
+		/* No timer, no deferral; push the frames out now instead. */
+		ao2_ref(session, -1);
+	}
+
+	return ast_careful_fwrite(session->f, session->fd, "", 0, session->timeout);
+}
+
 /*! \brief Write function for websocket traffic */
 int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
 {
 	size_t header_size = 2; /* The minimum size of a websocket frame is 2 bytes */
-	char *frame;
+	char header[MAX_WS_HDR_SZ] = { 0, };
 	uint64_t length;
-	uint64_t frame_size;
+	int rsv = 0;
 
 	ast_debug(3, "Writing websocket %s frame, length %" PRIu64 "\n",
 			websocket_opcode2str(opcode), payload_size);
 
+	ao2_lock(session);
+	if (session->closing) {
+		ao2_unlock(session);
+		return -1;
+	}
+
+#ifdef HAVE_ZLIB
+	/* Control frames are never compressed, and the per-message overhead is
+	 * not worth it on tiny payloads. */
+	if (session->deflate
+		&& (opcode == AST_WEBSOCKET_OPCODE_TEXT || opcode == AST_WEBSOCKET_OPCODE_BINARY)
+		&& payload_size >= WEBSOCKET_DEFLATE_SKIP_SIZE
+		&& !websocket_deflate_payload(session, &payload, &payload_size)) {
+		rsv = 0x40;
+	}
+#endif
+
 	if (payload_size < 126) {
 		length = payload_size;
 	} else if (payload_size < (1 << 16)) {
@@ -365,30 +812,23 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		header_size += 8;
 	}
 
-	frame_size = header_size + payload_size;
-
-	frame = ast_alloca(frame_size + 1);
-	memset(frame, 0, frame_size + 1);
-
-	frame[0] = opcode | 0x80;
-	frame[1] = length;
+	header[0] = opcode | 0x80 | rsv;
+	header[1] = length;
 
 	/* Use the additional available bytes to store the length */
 	if (length == 126) {
-		put_unaligned_uint16(&frame[2], htons(payload_size));
+		put_unaligned_uint16(&header[2], htons(payload_size));
 	} else if (length == 127) {
-		put_unaligned_uint64(&frame[2], htonll(payload_size));
+		put_unaligned_uint64(&header[2], htonll(payload_size));
 	}
 
-	memcpy(&frame[header_size], payload, payload_size);
-
-	ao2_lock(session);
-	if (session->closing) {
-		ao2_unlock(session);
-		return -1;
-	}
-
-	if (ast_careful_fwrite(session->f, session->fd, frame, frame_size, session->timeout)) {
+	/* The header and payload are written to the stream separately, saving
+	 * a copy of the payload into a combined frame buffer; the buffered
+	 * stream still delivers the bytes to the socket in order.
+	 */
+	if (websocket_write_buffered(session, header, header_size)
+		|| websocket_write_buffered(session, payload, payload_size)
+		|| websocket_flush_or_defer(session)) {
 		ao2_unlock(session);
 		/* 1011 - server terminating connection due to not being able to fulfill the request */
 		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
@@ -396,7 +836,6 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		return -1;
 	}
 
-	fflush(session->f);
 	ao2_unlock(session);
 
 	return 0;
@@ -461,6 +900,19 @@ int AST_OPTIONAL_API_NAME(ast_websocket_set_timeout)(struct ast_websocket *sessi
 	return 0;
 }
 
+int AST_OPTIONAL_API_NAME(ast_websocket_set_write_batching)(struct ast_websocket *session, int batch_ms)
+{
+	if (batch_ms < 0 || (batch_ms && !websocket_sched)) {
+		return -1;
+	}
+
+	ao2_lock(session);
+	session->write_batch_ms = batch_ms;
+	ao2_unlock(session);
+
+	return 0;
+}
+
 const char * AST_OPTIONAL_API_NAME(ast_websocket_session_id)(struct ast_websocket *session)
 {
 	return session->session_id;
@@ -580,6 +1032,18 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 		fin = (buf[0] >> 7) & 1;
 		mask_present = (buf[1] >> 7) & 1;
 
+#ifdef HAVE_ZLIB
+		if ((buf[0] >> 6) & 1) {
+			if (!session->deflate
+				|| (*opcode != AST_WEBSOCKET_OPCODE_TEXT && *opcode != AST_WEBSOCKET_OPCODE_BINARY)) {
+				ast_log(LOG_WARNING, "WebSocket compressed frame received without negotiated permessage-deflate\n");
+				ast_websocket_close(session, 1002);
+				return -1;
+			}
+			session->rx_compressed = 1;
+		}
+#endif
+
 		/* Based on the mask flag and payload length, determine how much more we need to read before start parsing the rest of the header */
 		options_len += mask_present ? 4 : 0;
 		options_len += (*payload_len == 126) ? 2 : (*payload_len == 127) ? 8 : 0;
@@ -670,6 +1134,21 @@ int AST_OPTIONAL_API_NAME(ast_websocket_read)(struct ast_websocket *session, cha
 			*payload_len = session->payload_len;
 			*payload = session->payload;
 			session->payload_len = 0;
+
+#ifdef HAVE_ZLIB
+			if (session->rx_compressed) {
+				if (fin) {
+					session->rx_compressed = 0;
+				}
+				if (*payload_len
+					&& websocket_inflate_payload(session, payload, payload_len, fin)) {
+					*payload = NULL;
+					*payload_len = 0;
+					ast_websocket_close(session, 1009);
+					return -1;
+				}
+			}
+#endif
 		}
 	} else if (*opcode == AST_WEBSOCKET_OPCODE_CLOSE) {
 		/* Make the payload available so the user can look at the reason code if they so desire */
@@ -739,6 +1218,9 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 {
 	struct ast_variable *v;
 	char *upgrade = NULL, *key = NULL, *key1 = NULL, *key2 = NULL, *protos = NULL, *requested_protocols = NULL, *protocol = NULL;
+#ifdef HAVE_ZLIB
+	char *extensions = NULL;
+#endif
 	int version = 0, flags = 1;
 	struct ast_websocket_protocol *protocol_handler = NULL;
 	struct ast_websocket *session;
@@ -767,6 +1249,10 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Protocol")) {
 			requested_protocols = ast_strip(ast_strdupa(v->value));
 			protos = ast_strdupa(requested_protocols);
+#ifdef HAVE_ZLIB
+		} else if (!strcasecmp(v->name, "Sec-WebSocket-Extensions")) {
+			extensions = ast_strip(ast_strdupa(v->value));
+#endif
 		} else if (!strcasecmp(v->name, "Sec-WebSocket-Version")) {
 			if (sscanf(v->value, "%30d", &version) != 1) {
 				version = 0;
@@ -817,6 +1303,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 	/* Determine how to respond depending on the version */
 	if (version == 7 || version == 8 || version == 13) {
 		char base64[64];
+		char extension_header[160] = "";
 
 		if (!key || strlen(key) + strlen(WEBSOCKET_GUID) + 1 > 8192) { /* no stack overflows please */
 			websocket_bad_request(ser);
@@ -838,6 +1325,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 			return 0;
 		}
 		session->timeout =  AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT;
+		session->flush_sched_id = -1;
 
 		/* Generate the session id */
 		if (!ast_uuid_generate_str(session->session_id, sizeof(session->session_id))) {
@@ -866,22 +1354,37 @@ int AST_OPTIONAL_API_NAME(ast_websocket_uri_cb)(struct ast_tcptls_session_instan
 		 *    the client), the client MUST _Fail the WebSocket
 		 *    Connection_.
 		 */
+#ifdef HAVE_ZLIB
+		if (!ast_strlen_zero(extensions)) {
+			session->deflate = websocket_deflate_negotiate(extensions,
+				extension_header, sizeof(extension_header));
+			if (session->deflate) {
+				ast_debug(3, "WebSocket connection from '%s' negotiated permessage-deflate\n",
+					ast_sockaddr_stringify(&ser->remote_address));
+			}
+		}
+#endif
+
 		if (protocol) {
 			fprintf(ser->f, "HTTP/1.1 101 Switching Protocols\r\n"
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
 				"Sec-WebSocket-Accept: %s\r\n"
-				"Sec-WebSocket-Protocol: %s\r\n\r\n",
+				"Sec-WebSocket-Protocol: %s\r\n"
+				"%s\r\n",
 				upgrade,
 				websocket_combine_key(key, base64, sizeof(base64)),
-				protocol);
+				protocol,
+				extension_header);
 		} else {
 			fprintf(ser->f, "HTTP/1.1 101 Switching Protocols\r\n"
 				"Upgrade: %s\r\n"
 				"Connection: Upgrade\r\n"
-				"Sec-WebSocket-Accept: %s\r\n\r\n",
+				"Sec-WebSocket-Accept: %s\r\n"
+				"%s\r\n",
 				upgrade,
-				websocket_combine_key(key, base64, sizeof(base64)));
+				websocket_combine_key(key, base64, sizeof(base64)),
+				extension_header);
 		}
 
 		fflush(ser->f);
@@ -1215,6 +1718,7 @@ static struct ast_websocket * websocket_client_create(
 	ws->client->version = 13;
 	ws->opcode = -1;
 	ws->reconstruct = DEFAULT_RECONSTRUCTION_CEILING;
+	ws->flush_sched_id = -1;
 	return ws;
 }
 
@@ -1447,8 +1951,21 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write_string)
 
 static int load_module(void)
 {
+	websocket_sched = ast_sched_context_create();
+	if (!websocket_sched || ast_sched_start_thread(websocket_sched)) {
+		ast_log(LOG_WARNING, "Unable to start WebSocket scheduler thread; write batching disabled\n");
+		if (websocket_sched) {
+			ast_sched_context_destroy(websocket_sched);
+			websocket_sched = NULL;
+		}
+	}
+
 	websocketuri.data = websocket_server_internal_create();
 	if (!websocketuri.data) {
+		if (websocket_sched) {
+			ast_sched_context_destroy(websocket_sched);
+			websocket_sched = NULL;
+		}
 		return AST_MODULE_LOAD_FAILURE;
 	}
 	ast_http_uri_link(&websocketuri);
@@ -1464,6 +1981,11 @@ static int unload_module(void)
 	ao2_ref(websocketuri.data, -1);
 	websocketuri.data = NULL;
 
+	if (websocket_sched) {
+		ast_sched_context_destroy(websocket_sched);
+		websocket_sched = NULL;
+	}
+
 	return 0;
 }
 
@@ -0,0 +1,596 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2026, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ *
+ * \brief Built-in call and media load generator
+ *
+ * Originates a configurable number of synthetic calls, ramped at a
+ * configurable rate, against any channel technology and dialplan target or
+ * application. Setup latency is measured per call and frame arrival jitter is
+ * sampled with a framehook on the answered channel, so a release's capacity
+ * can be regression tested on one box without an external SIPp farm and with
+ * full access to internal paths such as Local channels and ConfBridge.
+ */
+
+/*** MODULEINFO
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <math.h>
+
+#include "asterisk/channel.h"
+#include "asterisk/pbx.h"
+#include "asterisk/module.h"
+#include "asterisk/cli.h"
+#include "asterisk/utils.h"
+#include "asterisk/framehook.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/format_cap.h"
+#include "asterisk/vector.h"
+#include "asterisk/test.h"
+
+/*! \brief How long each originate may take to be answered, in seconds */
+#define LOADTEST_SETUP_TIMEOUT 30
+
+/*! \brief Granularity of the hold time and completion polling, in microseconds */
+#define LOADTEST_POLL_INTERVAL 100000
+
+/*! \brief Per-call frame arrival jitter state, updated under the channel lock */
+struct loadtest_jitter {
+	/*! \brief Arrival time of the previous voice frame */
+	struct timeval last;
+	/*! \brief Running mean of the inter-arrival interval in microseconds */
+	double mean_interval;
+	/*! \brief Smoothed absolute deviation from the mean interval in microseconds */
+	double jitter_us;
+	/*! \brief Number of intervals observed */
+	unsigned int intervals;
+};
+
+/*! \brief State of the current (or most recent) load generation run */
+static struct {
+	/*! \brief Total number of calls to originate */
+	unsigned int count;
+	/*! \brief Ramp rate in calls per second */
+	unsigned int rate;
+	/*! \brief How long each answered call is held, in seconds */
+	unsigned int duration;
+	/*! \brief Channel technology to originate with */
+	char tech[64];
+	/*! \brief Address data passed to the channel technology */
+	char data[256];
+	/*! \brief Application executed on the answered channel */
+	char app[64];
+	/*! \brief Data for the application */
+	char appdata[256];
+
+	/*! \brief Number of calls handed to workers so far */
+	unsigned int originated;
+	/*! \brief Number of calls that reached answer */
+	unsigned int answered;
+	/*! \brief Number of calls that failed to set up */
+	unsigned int failed;
+	/*! \brief Number of calls fully finished, success or failure */
+	unsigned int completed;
+	/*! \brief Non-zero while a run is in progress */
+	unsigned int running;
+	/*! \brief Set to ask the ramp and workers to wind down early */
+	unsigned int stop;
+	/*! \brief When the run began */
+	struct timeval started;
+	/*! \brief Per-call setup latencies in microseconds */
+	AST_VECTOR(, int64_t) setup_us;
+	/*! \brief Per-call smoothed frame jitter in microseconds */
+	AST_VECTOR(, int64_t) jitter_us;
+} run;
+
+AST_MUTEX_DEFINE_STATIC(loadtest_lock);
+
+static void loadtest_jitter_destroy(void *data)
+{
+	ao2_cleanup(data);
+}
+
+static struct ast_frame *loadtest_jitter_event(struct ast_channel *chan,
+	struct ast_frame *frame, enum ast_framehook_event event, void *data)
+{
+	struct loadtest_jitter *jitter = data;
+	struct timeval now;
+
+	if (event != AST_FRAMEHOOK_EVENT_READ || !frame || frame->frametype != AST_FRAME_VOICE) {
+		return frame;
+	}
+
+	now = ast_tvnow();
+	if (!ast_tvzero(jitter->last)) {
+		int64_t interval = ast_tvdiff_us(now, jitter->last);
+		double delta;
+
+		jitter->intervals++;
+		delta = interval - jitter->mean_interval;
+		jitter->mean_interval += delta / jitter->intervals;
+		/* RFC 3550 style smoothing of the absolute deviation, so one
+		 * late frame does not dominate the figure for a long call. */
+		jitter->jitter_us += (fabs(delta) - jitter->jitter_us) / 16.0;
+	}
+	jitter->last = now;
+
+	return frame;
+}
+
+/*! \brief Worker servicing one synthetic call from originate to hangup */
+static void *loadtest_call(void *ignore)
+{
+	struct ast_format_cap *cap;
+	struct ast_channel *chan = NULL;
+	struct loadtest_jitter *jitter = NULL;
+	struct timeval start;
+	int64_t setup_us;
+	unsigned int held;
+	int hook_id = -1;
+	int reason = 0;
+	int res;
+
+	cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!cap) {
+		goto failed;
+	}
+	ast_format_cap_append(cap, ast_format_slin, 0);
+
+	start = ast_tvnow();
+	res = ast_pbx_outgoing_app(run.tech, cap, run.data, LOADTEST_SETUP_TIMEOUT * 1000,
+		run.app, run.appdata, &reason, 1, NULL, NULL, NULL, NULL, &chan, NULL);
+	setup_us = ast_tvdiff_us(ast_tvnow(), start);
+	ao2_ref(cap, -1);
+
+	if (res || !chan) {
+		goto failed;
+	}
+
+	/* The channel comes back locked, which is exactly what attaching a
+	 * framehook requires. */
+	jitter = ao2_alloc_options(sizeof(*jitter), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (jitter) {
+		struct ast_framehook_interface interface = {
+			.version = AST_FRAMEHOOK_INTERFACE_VERSION,
+			.event_cb = loadtest_jitter_event,
+			.destroy_cb = loadtest_jitter_destroy,
+			.data = ao2_bump(jitter),
+		};
+
+		hook_id = ast_framehook_attach(chan, &interface);
+		if (hook_id < 0) {
+			/* Attach does not invoke destroy_cb on failure */
+			ao2_ref(jitter, -1);
+		}
+	}
+	ast_channel_unlock(chan);
+
+	ast_mutex_lock(&loadtest_lock);
+	run.answered++;
+	AST_VECTOR_APPEND(&run.setup_us, setup_us);
+	ast_mutex_unlock(&loadtest_lock);
+
+	/* Let the media loop run for the configured hold time */
+	for (held = 0; held < run.duration * 10 && !run.stop; held++) {
+		usleep(LOADTEST_POLL_INTERVAL);
+	}
+
+	if (hook_id >= 0) {
+		ast_channel_lock(chan);
+		ast_framehook_detach(chan, hook_id);
+		ast_channel_unlock(chan);
+	}
+	ast_softhangup(chan, AST_SOFTHANGUP_EXPLICIT);
+	ast_channel_unref(chan);
+
+	ast_mutex_lock(&loadtest_lock);
+	if (jitter && jitter->intervals) {
+		AST_VECTOR_APPEND(&run.jitter_us, (int64_t) jitter->jitter_us);
+	}
+	run.completed++;
+	ast_mutex_unlock(&loadtest_lock);
+	ao2_cleanup(jitter);
+
+	return NULL;
+
+failed:
+	ast_mutex_lock(&loadtest_lock);
+	run.failed++;
+	run.completed++;
+	ast_mutex_unlock(&loadtest_lock);
+
+	return NULL;
+}
+
+static int int64_sort_cmp(const void *a, const void *b)
+{
+	int64_t left = *(const int64_t *) a;
+	int64_t right = *(const int64_t *) b;
+
+	return (left > right) - (left < right);
+}
+
+static int64_t loadtest_percentile(const int64_t *sorted, size_t len, unsigned int percent)
+{
+	size_t idx = (len * percent) / 100;
+
+	return sorted[MIN(idx, len - 1)];
+}
+
+/*! \brief Append one "min/p50/p90/p99/max" line for a sample set, in milliseconds */
+static void loadtest_append_stats(struct ast_str **buf, const char *label,
+	const int64_t *samples, size_t len)
+{
+	int64_t *sorted;
+
+	if (!len) {
+		ast_str_append(buf, 0, "  %s no samples\n", label);
+		return;
+	}
+
+	sorted = ast_malloc(len * sizeof(*sorted));
+	if (!sorted) {
+		return;
+	}
+	memcpy(sorted, samples, len * sizeof(*sorted));
+	qsort(sorted, len, sizeof(*sorted), int64_sort_cmp);
+
+	ast_str_append(buf, 0, "  %s min %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f (ms, %zu samples)\n",
+		label,
+		sorted[0] / 1000.0,
+		loadtest_percentile(sorted, len, 50) / 1000.0,
+		loadtest_percentile(sorted, len, 90) / 1000.0,
+		loadtest_percentile(sorted, len, 99) / 1000.0,
+		sorted[len - 1] / 1000.0,
+		len);
+
+	ast_free(sorted);
+}
+
+/*! \brief Format the state and statistics of the current run, must be called without the lock */
+static void loadtest_report(struct ast_str **buf)
+{
+	ast_mutex_lock(&loadtest_lock);
+	if (!run.count) {
+		ast_str_append(buf, 0, "No load test has been run\n");
+		ast_mutex_unlock(&loadtest_lock);
+		return;
+	}
+
+	ast_str_append(buf, 0, "Load test of %u calls at %u/s with %us hold against %s/%s (%s%s%s)%s\n",
+		run.count, run.rate, run.duration, run.tech, run.data,
+		run.app, ast_strlen_zero(run.appdata) ? "" : " ", run.appdata,
+		run.running ? " [running]" : "");
+	ast_str_append(buf, 0, "  originated %u, answered %u, failed %u, in progress %u\n",
+		run.originated, run.answered, run.failed, run.originated - run.completed);
+	loadtest_append_stats(buf, "setup latency:", AST_VECTOR_SIZE(&run.setup_us)
+		? AST_VECTOR_GET_ADDR(&run.setup_us, 0) : NULL, AST_VECTOR_SIZE(&run.setup_us));
+	loadtest_append_stats(buf, "frame jitter: ", AST_VECTOR_SIZE(&run.jitter_us)
+		? AST_VECTOR_GET_ADDR(&run.jitter_us, 0) : NULL, AST_VECTOR_SIZE(&run.jitter_us));
+	ast_mutex_unlock(&loadtest_lock);
+}
+
+/*! \brief Ramp thread spawning call workers at the configured rate */
+static void *loadtest_ramp(void *ignore)
+{
+	int64_t interval_us = run.rate ? 1000000 / run.rate : 0;
+	unsigned int spawned;
+
+	for (spawned = 0; spawned < run.count && !run.stop; spawned++) {
+		pthread_t thread;
+
+		ast_mutex_lock(&loadtest_lock);
+		run.originated++;
+		ast_mutex_unlock(&loadtest_lock);
+
+		if (ast_pthread_create_detached_background(&thread, NULL, loadtest_call, NULL)) {
+			ast_mutex_lock(&loadtest_lock);
+			run.failed++;
+			run.completed++;
+			ast_mutex_unlock(&loadtest_lock);
+		}
+
+		if (interval_us) {
+			usleep(interval_us);
+		}
+	}
+
+	for (;;) {
+		unsigned int outstanding;
+
+		ast_mutex_lock(&loadtest_lock);
+		outstanding = run.originated - run.completed;
+		ast_mutex_unlock(&loadtest_lock);
+
+		if (!outstanding) {
+			break;
+		}
+		usleep(LOADTEST_POLL_INTERVAL);
+	}
+
+	if (VERBOSITY_ATLEAST(2)) {
+		struct ast_str *buf = ast_str_create(256);
+
+		if (buf) {
+			loadtest_report(&buf);
+			ast_verb(2, "Load test complete after %" PRId64 "ms:\n%s",
+				ast_tvdiff_ms(ast_tvnow(), run.started), ast_str_buffer(buf));
+			ast_free(buf);
+		}
+	}
+
+	ast_mutex_lock(&loadtest_lock);
+	run.running = 0;
+	ast_mutex_unlock(&loadtest_lock);
+
+	return NULL;
+}
+
+/*!
+ * \brief Begin a load generation run
+ *
+ * \retval 0 the run was started
+ * \retval -1 a run is already in progress or the parameters are unusable
+ */
+static int loadtest_start(unsigned int count, unsigned int rate, unsigned int duration,
+	const char *target, const char *app, const char *appdata)
+{
+	pthread_t thread;
+	char *tech;
+	char *data;
+
+	if (!count || !rate || ast_strlen_zero(target)) {
+		return -1;
+	}
+
+	data = ast_strdupa(target);
+	tech = strsep(&data, "/");
+	if (ast_strlen_zero(tech) || ast_strlen_zero(data)) {
+		return -1;
+	}
+
+	ast_mutex_lock(&loadtest_lock);
+	if (run.running) {
+		ast_mutex_unlock(&loadtest_lock);
+		return -1;
+	}
+
+	run.count = count;
+	run.rate = rate;
+	run.duration = duration;
+	ast_copy_string(run.tech, tech, sizeof(run.tech));
+	ast_copy_string(run.data, data, sizeof(run.data));
+	ast_copy_string(run.app, S_OR(app, "Echo"), sizeof(run.app));
+	ast_copy_string(run.appdata, S_OR(appdata, ""), sizeof(run.appdata));
+	run.originated = run.answered = run.failed = run.completed = 0;
+	run.stop = 0;
+	run.started = ast_tvnow();
+	AST_VECTOR_RESET(&run.setup_us, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	AST_VECTOR_RESET(&run.jitter_us, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	run.running = 1;
+
+	if (ast_pthread_create_detached_background(&thread, NULL, loadtest_ramp, NULL)) {
+		run.running = 0;
+		ast_mutex_unlock(&loadtest_lock);
+		return -1;
+	}
+	ast_mutex_unlock(&loadtest_lock);
+
+	return 0;
+}
+
+static char *handle_loadtest_start(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int count;
+	unsigned int rate;
+	unsigned int duration;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadtest start";
+		e->usage =
+			"Usage: loadtest start <count> <rate> <duration> <tech/data> [app [appdata]]\n"
+			"       Originate <count> synthetic calls against the given channel\n"
+			"       technology target, ramped at <rate> calls per second, each held\n"
+			"       for <duration> seconds while running the given application\n"
+			"       (Echo when omitted). Setup latency percentiles and frame\n"
+			"       arrival jitter are reported when the run finishes and through\n"
+			"       'loadtest show' while it is in progress.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 6) {
+			return ast_complete_applications(a->line, a->word, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc < 6 || a->argc > 8) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (sscanf(a->argv[2], "%30u", &count) != 1
+		|| sscanf(a->argv[3], "%30u", &rate) != 1
+		|| sscanf(a->argv[4], "%30u", &duration) != 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (loadtest_start(count, rate, duration, a->argv[5],
+		a->argc > 6 ? a->argv[6] : NULL, a->argc > 7 ? a->argv[7] : NULL)) {
+		ast_cli(a->fd, "Unable to start load test; check the parameters and that no run is already in progress\n");
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, "Started load test of %u calls at %u/s\n", count, rate);
+	return CLI_SUCCESS;
+}
+
+static char *handle_loadtest_stop(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadtest stop";
+		e->usage =
+			"Usage: loadtest stop\n"
+			"       Stop ramping new calls and hang up the synthetic calls that\n"
+			"       are still up. Statistics collected so far are retained.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	ast_mutex_lock(&loadtest_lock);
+	if (!run.running) {
+		ast_mutex_unlock(&loadtest_lock);
+		ast_cli(a->fd, "No load test is running\n");
+		return CLI_SUCCESS;
+	}
+	run.stop = 1;
+	ast_mutex_unlock(&loadtest_lock);
+
+	ast_cli(a->fd, "Stopping load test\n");
+	return CLI_SUCCESS;
+}
+
+static char *handle_loadtest_show(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_str *buf;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "loadtest show";
+		e->usage =
+			"Usage: loadtest show\n"
+			"       Show the progress and statistics of the current or most\n"
+			"       recent load test.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	buf = ast_str_create(256);
+	if (!buf) {
+		return CLI_FAILURE;
+	}
+
+	loadtest_report(&buf);
+	ast_cli(a->fd, "%s", ast_str_buffer(buf));
+	ast_free(buf);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_loadtest[] = {
+	AST_CLI_DEFINE(handle_loadtest_start, "Start a call load generation run"),
+	AST_CLI_DEFINE(handle_loadtest_stop, "Stop the running load generation run"),
+	AST_CLI_DEFINE(handle_loadtest_show, "Show load generation statistics"),
+};
+
+#ifdef TEST_FRAMEWORK
+AST_TEST_DEFINE(loadtest_benchmark)
+{
+	struct ast_str *buf;
+	unsigned int answered;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "loadtest_unicast_rtp";
+		info->category = "/benchmarks/";
+		info->summary = "Benchmark call setup using the load generator";
+		info->description =
+			"Originates a small burst of UnicastRTP calls running Echo and "
+			"reports the setup latency percentiles, giving a per-release "
+			"capacity figure without external traffic generators.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!ast_get_channel_tech("UnicastRTP")) {
+		ast_test_status_update(test, "chan_rtp is not loaded, skipping\n");
+		return AST_TEST_NOT_RUN;
+	}
+
+	if (loadtest_start(10, 10, 1, "UnicastRTP/127.0.0.1:9", "Echo", NULL)) {
+		ast_test_status_update(test, "Unable to start a run; is one already in progress?\n");
+		return AST_TEST_FAIL;
+	}
+
+	while (run.running) {
+		usleep(LOADTEST_POLL_INTERVAL);
+	}
+
+	buf = ast_str_create(256);
+	if (!buf) {
+		return AST_TEST_FAIL;
+	}
+	loadtest_report(&buf);
+	ast_test_status_update(test, "%s", ast_str_buffer(buf));
+	ast_free(buf);
+
+	ast_mutex_lock(&loadtest_lock);
+	answered = run.answered;
+	ast_mutex_unlock(&loadtest_lock);
+
+	return answered ? AST_TEST_PASS : AST_TEST_FAIL;
+}
+#endif
+
+static int load_module(void)
+{
+	if (AST_VECTOR_INIT(&run.setup_us, 0) || AST_VECTOR_INIT(&run.jitter_us, 0)) {
+		AST_VECTOR_FREE(&run.setup_us);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	ast_cli_register_multiple(cli_loadtest, ARRAY_LEN(cli_loadtest));
+	AST_TEST_REGISTER(loadtest_benchmark);
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+static int unload_module(void)
+{
+	unsigned int attempts;
+
+	AST_TEST_UNREGISTER(loadtest_benchmark);
+	ast_cli_unregister_multiple(cli_loadtest, ARRAY_LEN(cli_loadtest));
+
+	ast_mutex_lock(&loadtest_lock);
+	run.stop = 1;
+	ast_mutex_unlock(&loadtest_lock);
+
+	/* Give in-flight synthetic calls a chance to wind down; the worker
+	 * threads execute code from this module so unloading under them is
+	 * not an option. */
+	for (attempts = 0; attempts < (LOADTEST_SETUP_TIMEOUT + 5) * 10 && run.running; attempts++) {
+		usleep(LOADTEST_POLL_INTERVAL);
+	}
+	if (run.running) {
+		return -1;
+	}
+
+	AST_VECTOR_FREE(&run.setup_us);
+	AST_VECTOR_FREE(&run.jitter_us);
+
+	return 0;
+}
+
+AST_MODULE_INFO_STANDARD_EXTENDED(ASTERISK_GPL_KEY, "Call and media load generator");
@@ -152,6 +152,7 @@ struct moh_files_state {
 #define MOH_CACHERTCLASSES	(1 << 5)	/*!< Should we use a separate instance of MOH for each user or not */
 #define MOH_ANNOUNCEMENT	(1 << 6)	/*!< Do we play announcement files between songs on this channel? */
 #define MOH_PREFERCHANNELCLASS	(1 << 7)	/*!< Should queue moh override channel moh */
+#define MOH_BROADCAST		(1 << 8)	/*!< One shared decoder feeds every listener of the class */
 
 /* Custom astobj2 flag */
 #define MOH_NOTDELETED          (1 << 30)       /*!< Find only records that aren't deleted? */
@@ -171,6 +172,18 @@ struct mohclass {
 	int allowed_files;
 	/*! The current number of files loaded into the filearray */
 	int total_files;
+	/*! File type extensions matching the filearray, only filled in for broadcast classes */
+	char **extarray;
+	/*! The number of entries in the extarray */
+	int ext_files;
+	/*! Index of the file the broadcast decoder is playing */
+	int bcast_pos;
+	/*! The stream the broadcast decoder is reading from */
+	struct ast_filestream *bcast_stream;
+	/*! Translation path from the file's format to \c format for the broadcast decoder */
+	struct ast_trans_pvt *bcast_trans;
+	/*! The source format of \c bcast_trans */
+	struct ast_format *bcast_trans_format;
 	unsigned int flags;
 	/*! The format from the MOH source, not applicable to "files" mode */
 	struct ast_format *format;
@@ -1057,6 +1070,8 @@ static void moh_parse_options(struct ast_variable *var, struct mohclass *mohclas
 			} else if (!strcasecmp(var->value, "randstart")) {
 				ast_set_flag(mohclass, MOH_RANDSTART);
 			}
+		} else if (!strcasecmp(var->name, "broadcast")) {
+			ast_set2_flag(mohclass, ast_true(var->value), MOH_BROADCAST);
 		} else if (!strcasecmp(var->name, "format")) {
 			mohclass->format = ast_format_cache_get(var->value);
 			if (!mohclass->format) {
@@ -1210,6 +1225,308 @@ static int init_files_class(struct mohclass *class)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Record the on-disk file type extension of each file in the filearray.
+ *
+ * The filearray only holds extensionless paths, because per-channel streams let
+ * ast_openstream() negotiate the best format for the channel.  The broadcast
+ * decoder has no channel to negotiate for, so it needs an extension to hand to
+ * ast_readfile().  Must be called with the class locked once the decoder thread
+ * is running.
+ */
+static int moh_broadcast_scan_exts(struct mohclass *class)
+{
+	DIR *files_DIR;
+	struct dirent *files_dirent;
+	char dir_path[PATH_MAX];
+	char filepath[PATH_MAX];
+	char *ext;
+	int i;
+
+	if (class->extarray) {
+		for (i = 0; i < class->ext_files; i++) {
+			ast_free(class->extarray[i]);
+		}
+		ast_free(class->extarray);
+		class->extarray = NULL;
+		class->ext_files = 0;
+	}
+
+	class->extarray = ast_calloc(class->total_files, sizeof(*class->extarray));
+	if (!class->extarray) {
+		return -1;
+	}
+	class->ext_files = class->total_files;
+
+	if (class->dir[0] != '/') {
+		ast_copy_string(dir_path, ast_config_AST_DATA_DIR, sizeof(dir_path));
+		strncat(dir_path, "/", sizeof(dir_path) - 1);
+		strncat(dir_path, class->dir, sizeof(dir_path) - 1);
+	} else {
+		ast_copy_string(dir_path, class->dir, sizeof(dir_path));
+	}
+
+	files_DIR = opendir(dir_path);
+	if (!files_DIR) {
+		ast_log(LOG_WARNING, "Cannot open dir %s or dir does not exist\n", dir_path);
+		return -1;
+	}
+
+	while ((files_dirent = readdir(files_DIR))) {
+		snprintf(filepath, sizeof(filepath), "%s/%s", dir_path, files_dirent->d_name);
+
+		if (!(ext = strrchr(filepath, '.'))) {
+			continue;
+		}
+		*ext++ = '\0';
+
+		/* Any one of the formats the file exists in will do */
+		for (i = 0; i < class->ext_files; i++) {
+			if (!class->extarray[i] && !strcmp(filepath, class->filearray[i])) {
+				class->extarray[i] = ast_strdup(ext);
+				break;
+			}
+		}
+	}
+
+	closedir(files_DIR);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Advance the broadcast decoder to the next file in the class.
+ *
+ * Must be called with the class locked.
+ */
+static int moh_broadcast_next(struct mohclass *class)
+{
+	int tries;
+
+	if (class->bcast_stream) {
+		ast_closestream(class->bcast_stream);
+		class->bcast_stream = NULL;
+	}
+
+	for (tries = 0; tries < class->total_files; tries++) {
+		if (ast_test_flag(class, MOH_SORTMODE) == MOH_RANDOMIZE) {
+			class->bcast_pos = ast_random() % class->total_files;
+		} else {
+			class->bcast_pos = (class->bcast_pos + 1) % class->total_files;
+		}
+
+		if (class->bcast_pos >= class->ext_files || !class->extarray[class->bcast_pos]) {
+			continue;
+		}
+
+		class->bcast_stream = ast_readfile(class->filearray[class->bcast_pos],
+			class->extarray[class->bcast_pos], NULL, O_RDONLY, 0, 0);
+		if (class->bcast_stream) {
+			return 0;
+		}
+
+		ast_log(LOG_WARNING, "Unable to open file '%s': %s\n",
+			class->filearray[class->bcast_pos], strerror(errno));
+	}
+
+	return -1;
+}
+
+/*! Decoded audio buffered ahead by the broadcast decoder, in bytes */
+#define MOH_BCAST_BUFLEN 32768
+
+/*!
+ * \internal
+ * \brief Decode files until at least \a needed bytes of audio in the class's
+ * format are buffered, or no file can be opened.
+ *
+ * Must be called with the class locked.
+ *
+ * \return the number of bytes now buffered in \a buf
+ */
+static int moh_broadcast_fill(struct mohclass *class, char *buf, int used, int needed)
+{
+	while (used < needed) {
+		struct ast_frame *f;
+		struct ast_frame *out;
+		struct ast_frame *cur;
+
+		if (!class->bcast_stream && moh_broadcast_next(class)) {
+			break;
+		}
+
+		if (!(f = ast_readframe(class->bcast_stream))) {
+			/* End of file, move along to the next one */
+			ast_closestream(class->bcast_stream);
+			class->bcast_stream = NULL;
+			continue;
+		}
+
+		if (ast_format_cmp(f->subclass.format, class->format) == AST_FORMAT_CMP_EQUAL) {
+			out = f;
+		} else {
+			if (!class->bcast_trans
+				|| ast_format_cmp(f->subclass.format, class->bcast_trans_format) != AST_FORMAT_CMP_EQUAL) {
+				if (class->bcast_trans) {
+					ast_translator_free_path(class->bcast_trans);
+				}
+				class->bcast_trans = ast_translator_build_path(class->format, f->subclass.format);
+				ao2_replace(class->bcast_trans_format, f->subclass.format);
+				if (!class->bcast_trans) {
+					ast_log(LOG_WARNING, "Cannot translate from %s to %s for MOH class '%s'\n",
+						ast_format_get_name(f->subclass.format),
+						ast_format_get_name(class->format), class->name);
+					ast_frfree(f);
+					/* Skip the file rather than spinning on it */
+					ast_closestream(class->bcast_stream);
+					class->bcast_stream = NULL;
+					continue;
+				}
+			}
+			if (!(out = ast_translate(class->bcast_trans, f, 1))) {
+				continue;
+			}
+		}
+
+		for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			int copy = MIN(cur->datalen, MOH_BCAST_BUFLEN - used);
+
+			memcpy(buf + used, cur->data.ptr, copy);
+			used += copy;
+		}
+		ast_frfree(out);
+	}
+
+	return used;
+}
+
+/*!
+ * \internal
+ * \brief Shared decoder for a broadcast "files" mode class.
+ *
+ * Rather than each held channel decoding its own stream, a single thread
+ * decodes the class's files once and fans the audio out to every member's
+ * pipe, exactly like monmp3thread() does for raw audio from an external
+ * application.  The members then hear it through the mohgen generator.
+ */
+static void *moh_broadcast_thread(void *data)
+{
+	struct mohclass *class = data;
+	struct mohdata *moh;
+	char buf[MOH_BCAST_BUFLEN];
+	int used = 0;
+	int res = 0, res2;
+	int len;
+	struct timeval deadline, tv_tmp;
+
+	deadline.tv_sec = 0;
+	deadline.tv_usec = 0;
+	for (;/* ever */;) {
+		pthread_testcancel();
+		if (class->timer) {
+			struct pollfd pfd = { .fd = ast_timer_fd(class->timer), .events = POLLIN | POLLPRI, };
+
+#ifdef SOLARIS
+			thr_yield();
+#endif
+			/* Pause some amount of time */
+			if (ast_poll(&pfd, 1, -1) > 0) {
+				if (ast_timer_ack(class->timer, 1) < 0) {
+					ast_log(LOG_ERROR, "Failed to acknowledge timer for broadcast MOH\n");
+					return NULL;
+				}
+				/* 25 samples per second => 40ms framerate => 320 samples */
+				res = 320; /* 320/40 = 8 samples/ms */
+			} else {
+				ast_log(LOG_WARNING, "poll() failed: %s\n", strerror(errno));
+				res = 0;
+			}
+			pthread_testcancel();
+		} else {
+			long delta;
+			/* Reliable sleep */
+			tv_tmp = ast_tvnow();
+			if (ast_tvzero(deadline))
+				deadline = tv_tmp;
+			delta = ast_tvdiff_ms(tv_tmp, deadline);
+			if (delta < MOH_MS_INTERVAL) {	/* too early */
+				deadline = ast_tvadd(deadline, ast_samp2tv(MOH_MS_INTERVAL, 1000));	/* next deadline */
+				usleep(1000 * (MOH_MS_INTERVAL - delta));
+				pthread_testcancel();
+			} else {
+				ast_log(LOG_NOTICE, "Request to schedule in the past?!?!\n");
+				deadline = tv_tmp;
+			}
+			/* 10 samples per second (MOH_MS_INTERVAL) => 100ms framerate => 800 samples */
+			res = 8 * MOH_MS_INTERVAL; /* 800/100 = 8 samples/ms */
+		}
+		/* For non-8000Hz formats, we need to alter the resolution */
+		res = res * ast_format_get_sample_rate(class->format) / 8000;
+
+		if (AST_LIST_EMPTY(&class->members)) {
+			/* Nobody is listening; don't decode, and pick up where we
+			 * left off when somebody next goes on hold */
+			continue;
+		}
+
+		len = ast_format_determine_length(class->format, res);
+		if (len > MOH_BCAST_BUFLEN) {
+			len = MOH_BCAST_BUFLEN;
+		}
+
+		ao2_lock(class);
+		used = moh_broadcast_fill(class, buf, used, len);
+		res2 = MIN(len, used);
+		if (!res2) {
+			ao2_unlock(class);
+			continue;
+		}
+		AST_LIST_TRAVERSE(&class->members, moh, list) {
+			/* Write data */
+			if ((res = write(moh->pipe[1], buf, res2)) != res2) {
+				ast_debug(1, "Only wrote %d of %d bytes to pipe\n", res, res2);
+			}
+		}
+		ao2_unlock(class);
+
+		memmove(buf, buf + res2, used - res2);
+		used -= res2;
+	}
+	return NULL;
+}
+
+static int init_broadcast_class(struct mohclass *class)
+{
+	if (moh_broadcast_scan_exts(class)) {
+		return -1;
+	}
+
+	class->bcast_pos = -1;
+
+	if (!(class->timer = ast_timer_open())) {
+		ast_log(LOG_WARNING, "Unable to create timer: %s\n", strerror(errno));
+		return -1;
+	}
+	if (class->timer && ast_timer_set_rate(class->timer, 25)) {
+		ast_log(LOG_WARNING, "Unable to set 40ms frame rate: %s\n", strerror(errno));
+		ast_timer_close(class->timer);
+		class->timer = NULL;
+	}
+
+	if (ast_pthread_create_background(&class->thread, NULL, moh_broadcast_thread, class)) {
+		ast_log(LOG_WARNING, "Unable to create moh thread...\n");
+		if (class->timer) {
+			ast_timer_close(class->timer);
+			class->timer = NULL;
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
 static void moh_rescan_files(void) {
 	struct ao2_iterator i;
 	struct mohclass *c;
@@ -1218,7 +1535,16 @@ static void moh_rescan_files(void) {
 
 	while ((c = ao2_iterator_next(&i))) {
 		if (!strcasecmp(c->mode, "files")) {
-			moh_scan_files(c);
+			if (ast_test_flag(c, MOH_BROADCAST)) {
+				/* The broadcast decoder walks these arrays from its own thread */
+				ao2_lock(c);
+				if (moh_scan_files(c) > 0) {
+					moh_broadcast_scan_exts(c);
+				}
+				ao2_unlock(c);
+			} else {
+				moh_scan_files(c);
+			}
 		}
 		ao2_ref(c, -1);
 	}
@@ -1313,7 +1639,13 @@ static int _moh_register(struct mohclass *moh, int reload, int unref, const char
 			}
 			return -1;
 		}
-	} else if (!strcasecmp(moh->mode, "mp3") || !strcasecmp(moh->mode, "mp3nb") || 
+		if (ast_test_flag(moh, MOH_BROADCAST) && init_broadcast_class(moh)) {
+			if (unref) {
+				moh = mohclass_unref(moh, "unreffing potential new moh class (init_broadcast_class failed)");
+			}
+			return -1;
+		}
+	} else if (!strcasecmp(moh->mode, "mp3") || !strcasecmp(moh->mode, "mp3nb") ||
 			!strcasecmp(moh->mode, "quietmp3") || !strcasecmp(moh->mode, "quietmp3nb") || 
 			!strcasecmp(moh->mode, "httpmp3") || !strcasecmp(moh->mode, "custom")) {
 		if (init_app_class(moh)) {
@@ -1492,6 +1824,12 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 						mohclass = mohclass_unref(mohclass, "unreffing potential mohclass (moh_scan_files failed)");
 						return -1;
 					}
+					if (ast_test_flag(mohclass, MOH_BROADCAST)) {
+						/* An uncached realtime class lives only as long as the
+						 * channel using it, so there is nothing to share a
+						 * decoder between; fall back to per-channel streams. */
+						ast_clear_flag(mohclass, MOH_BROADCAST);
+					}
 					if (strchr(mohclass->args, 'r')) {
 						static int deprecation_warning = 0;
 						if (!deprecation_warning) {
@@ -1559,14 +1897,27 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 
 	/* If we are using a cached realtime class with files, re-scan the files */
 	if (!var && ast_test_flag(global_flags, MOH_CACHERTCLASSES) && mohclass->realtime && !strcasecmp(mohclass->mode, "files")) {
-		if (!moh_scan_files(mohclass)) {
+		int scanned;
+
+		if (ast_test_flag(mohclass, MOH_BROADCAST)) {
+			/* The broadcast decoder walks these arrays from its own thread */
+			ao2_lock(mohclass);
+			scanned = moh_scan_files(mohclass);
+			if (scanned > 0) {
+				moh_broadcast_scan_exts(mohclass);
+			}
+			ao2_unlock(mohclass);
+		} else {
+			scanned = moh_scan_files(mohclass);
+		}
+		if (!scanned) {
 			mohclass = mohclass_unref(mohclass, "unreffing potential mohclass (moh_scan_files failed)");
 			return -1;
 		}
 	}
 
 	if (!state || !state->class || strcmp(mohclass->name, state->class->name)) {
-		if (mohclass->total_files) {
+		if (mohclass->total_files && !ast_test_flag(mohclass, MOH_BROADCAST)) {
 			res = ast_activate_generator(chan, &moh_file_stream, mohclass);
 		} else {
 			res = ast_activate_generator(chan, &mohgen, mohclass);
@@ -1674,6 +2025,16 @@ static void moh_class_destructor(void *obj)
 		class->filearray = NULL;
 	}
 
+	if (class->extarray) {
+		int i;
+		for (i = 0; i < class->ext_files; i++) {
+			ast_free(class->extarray[i]);
+		}
+		ast_free(class->extarray);
+		class->extarray = NULL;
+		class->ext_files = 0;
+	}
+
 	if (class->timer) {
 		ast_timer_close(class->timer);
 		class->timer = NULL;
@@ -1686,6 +2047,16 @@ static void moh_class_destructor(void *obj)
 		pthread_join(tid, NULL);
 	}
 
+	/* The broadcast decoder's state can only be released once its thread is gone */
+	if (class->bcast_stream) {
+		ast_closestream(class->bcast_stream);
+		class->bcast_stream = NULL;
+	}
+	if (class->bcast_trans) {
+		ast_translator_free_path(class->bcast_trans);
+		class->bcast_trans = NULL;
+	}
+	ao2_cleanup(class->bcast_trans_format);
 }
 
 static int moh_class_mark(void *obj, void *arg, int flags)
@@ -62,6 +62,7 @@
 #include "asterisk/strings.h"
 #include "asterisk/threadstorage.h"
 #include "asterisk/data.h"
+#include "asterisk/taskprocessor.h"
 
 struct odbc_class
 {
@@ -78,6 +79,7 @@ struct odbc_class
 	unsigned int isolation;              /*!< Flags for how the DB should deal with data in other, uncommitted transactions */
 	unsigned int conntimeout;            /*!< Maximum time the connection process should take */
 	unsigned int maxconnections;         /*!< Maximum number of allowed connections */
+	unsigned int minconnections;         /*!< Minimum number of warm connections to maintain */
 	/*! When a connection fails, cache that failure for how long? */
 	struct timeval negative_connection_cache;
 	/*! When a connection fails, when did that last occur? */
@@ -94,6 +96,9 @@ struct odbc_class
 
 static struct ao2_container *class_container;
 
+/*! Serializer used to warm up and replace pooled connections in the background */
+static struct ast_taskprocessor *replenish_tps;
+
 static AST_RWLIST_HEAD_STATIC(odbc_tables, odbc_cache_tables);
 
 static odbc_status odbc_obj_connect(struct odbc_obj *obj);
@@ -488,7 +493,7 @@ static int load_odbc_config(void)
 	struct ast_variable *v;
 	char *cat;
 	const char *dsn, *username, *password, *sanitysql;
-	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections;
+	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections, minconnections;
 	struct timeval ncache = { 0, 0 };
 	int preconnect = 0, res = 0;
 	struct ast_flags config_flags = { 0 };
@@ -516,6 +521,7 @@ static int load_odbc_config(void)
 			forcecommit = 0;
 			isolation = SQL_TXN_READ_COMMITTED;
 			maxconnections = 1;
+			minconnections = 0;
 			for (v = ast_variable_browse(config, cat); v; v = v->next) {
 				if (!strcasecmp(v->name, "pooling") ||
 						!strncasecmp(v->name, "share", 5) ||
@@ -564,10 +570,20 @@ static int load_odbc_config(void)
 						ast_log(LOG_WARNING, "max_connections must be a positive integer\n");
 						maxconnections = 1;
                                         }
+				} else if (!strcasecmp(v->name, "min_connections")) {
+					if (sscanf(v->value, "%30d", &minconnections) != 1 || minconnections < 0) {
+						ast_log(LOG_WARNING, "min_connections must be a non-negative integer\n");
+						minconnections = 0;
+					}
 				}
 			}
 
 			if (enabled && !ast_strlen_zero(dsn)) {
+				if (minconnections > maxconnections) {
+					ast_log(LOG_WARNING, "min_connections cannot exceed max_connections; clamping to %d\n", maxconnections);
+					minconnections = maxconnections;
+				}
+
 				new = ao2_alloc(sizeof(*new), odbc_class_destructor);
 
 				if (!new) {
@@ -590,6 +606,7 @@ static int load_odbc_config(void)
 				new->conntimeout = conntimeout;
 				new->negative_connection_cache = ncache;
 				new->maxconnections = maxconnections;
+				new->minconnections = minconnections;
 
 				if (cat)
 					ast_copy_string(new->name, cat, sizeof(new->name));
@@ -689,6 +706,77 @@ static struct ast_cli_entry cli_odbc[] = {
 	AST_CLI_DEFINE(handle_cli_odbc_show, "List ODBC DSN(s)")
 };
 
+/*!
+ * \internal
+ * \brief Replenish a class up to its configured connection floor.
+ *
+ * Runs in the replenish taskprocessor.  Connections are established with
+ * the class unlocked, so a database that is slow to answer during a
+ * failover only stalls this worker and not threads requesting handles.
+ *
+ * \param data An odbc_class to warm up.  The reference is stolen.
+ * \retval 0
+ */
+static int odbc_class_replenish(void *data)
+{
+	struct odbc_class *class = data;
+	struct odbc_obj *obj;
+
+	ast_mutex_lock(&class->lock);
+	while (!class->delme && class->connection_cnt < class->minconnections) {
+		/* Reserve the slot while connecting unlocked. */
+		class->connection_cnt++;
+		ast_mutex_unlock(&class->lock);
+
+		obj = ao2_alloc(sizeof(*obj), odbc_obj_destructor);
+		if (obj) {
+			obj->parent = ao2_bump(class);
+			if (odbc_obj_connect(obj) == ODBC_FAIL) {
+				ao2_ref(obj->parent, -1);
+				ao2_ref(obj, -1);
+				obj = NULL;
+			}
+		}
+
+		ast_mutex_lock(&class->lock);
+		if (!obj) {
+			/* Don't beat on an unreachable server; the negative connection
+			 * cache governs when we may try again.
+			 */
+			class->connection_cnt--;
+			break;
+		}
+
+		/* Pooled connections don't hold a class reference. */
+		ao2_ref(obj->parent, -1);
+		obj->parent = NULL;
+		AST_LIST_INSERT_TAIL(&class->connections, obj, list);
+		ast_cond_signal(&class->cond);
+		ast_debug(2, "Warmed up ODBC handle %p on class '%s', new count is %zd\n", obj,
+			class->name, class->connection_cnt);
+	}
+	ast_mutex_unlock(&class->lock);
+
+	ao2_ref(class, -1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Schedule a background warm up of a class to its connection floor.
+ */
+static void odbc_class_schedule_replenish(struct odbc_class *class)
+{
+	if (!class->minconnections || class->delme) {
+		return;
+	}
+
+	ao2_bump(class);
+	if (ast_taskprocessor_push(replenish_tps, odbc_class_replenish, class)) {
+		ao2_ref(class, -1);
+	}
+}
+
 static void odbc_register_class(struct odbc_class *class, int preconnect)
 {
 	struct odbc_obj *obj;
@@ -696,6 +784,9 @@ static void odbc_register_class(struct odbc_class *class, int preconnect)
 	ao2_link(class_container, class);
 	/* I still have a reference in the caller, so a deref is NOT missing here. */
 
+	/* Build the connection floor in the background. */
+	odbc_class_schedule_replenish(class);
+
 	if (!preconnect) {
 		return;
 	}
@@ -822,49 +913,77 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 	while (!obj) {
 		obj = AST_LIST_REMOVE_HEAD(&class->connections, list);
 
-		if (!obj) {
-			if (class->connection_cnt < class->maxconnections) {
-				/* If no connection is immediately available establish a new
-				 * one if allowed. If we try and fail we give up completely as
-				 * we could go into an infinite loop otherwise.
+		if (obj) {
+			/* Sanity check the pooled connection with the class unlocked.  A
+			 * probing query against a dead server can take a long time to
+			 * fail and must not hold up threads grabbing other connections.
+			 */
+			ast_mutex_unlock(&class->lock);
+			if (connection_dead(obj, class)) {
+				ao2_ref(obj, -1);
+				obj = NULL;
+			}
+			ast_mutex_lock(&class->lock);
+
+			if (!obj) {
+				/* The connection is dead, so grab another functional one from
+				 * the pool instead of trying to resurrect this one and let the
+				 * background worker build a replacement.
 				 */
-				obj = ao2_alloc(sizeof(*obj), odbc_obj_destructor);
-				if (!obj) {
-					break;
-				}
+				class->connection_cnt--;
+				ast_debug(2, "Dead ODBC handle removed from class '%s', new count is %zd\n",
+					name, class->connection_cnt);
+				odbc_class_schedule_replenish(class);
+				continue;
+			}
 
+			/* We successfully grabbed a connection from the pool and all is well!
+			 */
+			obj->parent = ao2_bump(class);
+			ast_debug(2, "Reusing ODBC handle %p from class '%s'\n", obj, name);
+			break;
+		}
+
+		if (class->connection_cnt < class->maxconnections) {
+			/* If no connection is immediately available establish a new
+			 * one if allowed. If we try and fail we give up completely as
+			 * we could go into an infinite loop otherwise.
+			 *
+			 * The slot is reserved and the connection built with the class
+			 * unlocked so a slow connect (such as during a database
+			 * failover) does not stall threads that only need an idle
+			 * pooled connection.
+			 */
+			class->connection_cnt++;
+			ast_mutex_unlock(&class->lock);
+
+			obj = ao2_alloc(sizeof(*obj), odbc_obj_destructor);
+			if (obj) {
 				obj->parent = ao2_bump(class);
 				if (odbc_obj_connect(obj) == ODBC_FAIL) {
 					ao2_ref(obj->parent, -1);
 					ao2_ref(obj, -1);
 					obj = NULL;
-					break;
 				}
+			}
 
-				class->connection_cnt++;
-				ast_debug(2, "Created ODBC handle %p on class '%s', new count is %zd\n", obj,
-					name, class->connection_cnt);
-			} else {
-				/* Otherwise if we're not allowed to create a new one we
-				 * wait for another thread to give up the connection they
-				 * own.
+			ast_mutex_lock(&class->lock);
+			if (!obj) {
+				/* Return the reserved slot and wake a waiter so it may
+				 * retry the connect itself.
 				 */
-				ast_cond_wait(&class->cond, &class->lock);
+				class->connection_cnt--;
+				ast_cond_signal(&class->cond);
+				break;
 			}
-		} else if (connection_dead(obj, class)) {
-			/* If the connection is dead try to grab another functional one from the
-			 * pool instead of trying to resurrect this one.
-			 */
-			ao2_ref(obj, -1);
-			obj = NULL;
-			class->connection_cnt--;
-			ast_debug(2, "ODBC handle %p dead - removing from class '%s', new count is %zd\n",
-				obj, name, class->connection_cnt);
+			ast_debug(2, "Created ODBC handle %p on class '%s', new count is %zd\n", obj,
+				name, class->connection_cnt);
 		} else {
-			/* We successfully grabbed a connection from the pool and all is well!
+			/* Otherwise if we're not allowed to create a new one we
+			 * wait for another thread to give up the connection they
+			 * own.
 			 */
-			obj->parent = ao2_bump(class);
-			ast_debug(2, "Reusing ODBC handle %p from class '%s'\n", obj, name);
+			ast_cond_wait(&class->cond, &class->lock);
 		}
 	}
 
@@ -1084,6 +1203,8 @@ static int load_module(void)
 {
 	if (!(class_container = ao2_container_alloc(1, null_hash_fn, ao2_match_by_addr)))
 		return AST_MODULE_LOAD_DECLINE;
+	if (!(replenish_tps = ast_taskprocessor_get("res_odbc", TPS_REF_DEFAULT)))
+		return AST_MODULE_LOAD_DECLINE;
 	if (load_odbc_config() == -1)
 		return AST_MODULE_LOAD_DECLINE;
 	ast_cli_register_multiple(cli_odbc, ARRAY_LEN(cli_odbc));
@@ -48,6 +48,7 @@
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <net/if.h>
 #ifdef SOLARIS
 #include <sys/sockio.h>
@@ -330,6 +331,8 @@ struct http_route {
 	struct user *user;	/*!< The user that has variables to substitute into the file
 						 * NULL in the case of a static route */
 	struct phone_profile *profile;
+	struct ast_str *rendered;	/*!< Cached rendered template, protected by the route lock */
+	time_t rendered_mtime;	/*!< Template modification time \ref rendered was built from */
 };
 struct ao2_container *http_routes;
 SIMPLE_HASH_FN(http_route_hash_fn, http_route, uri)
@@ -490,6 +493,7 @@ static void route_destructor(void *obj)
 {
 	struct http_route *route = obj;
 
+	ast_free(route->rendered);
 	ast_string_field_free_memory(route);
 }
 
@@ -911,77 +915,95 @@ static int phoneprov_callback(struct ast_tcptls_session_instance *ser, const str
 		route = unref_route(route);
 		return 0;
 	} else { /* Dynamic file */
-		struct ast_str *tmp;
-
-		len = load_file(path, &file);
-		if (len < 0) {
-			ast_log(LOG_WARNING, "Could not load file: %s (%d)\n", path, len);
-			if (file) {
-				ast_free(file);
-			}
+		struct stat st;
 
+		if (stat(path, &st)) {
+			ast_log(LOG_WARNING, "Could not load file: %s (%s)\n", path, strerror(errno));
 			goto out500;
 		}
 
-		if (!file) {
-			goto out500;
-		}
+		/* A mass phone reboot hits the same routes with thousands of
+		 * requests, so the rendered output is cached on the route and
+		 * only rebuilt when the template file changes on disk.  Routes
+		 * are recreated on reload, which drops the cache. */
+		ao2_lock(route);
+		if (!route->rendered || route->rendered_mtime != st.st_mtime) {
+			struct ast_str *tmp;
+
+			len = load_file(path, &file);
+			if (len < 0) {
+				ast_log(LOG_WARNING, "Could not load file: %s (%d)\n", path, len);
+				if (file) {
+					ast_free(file);
+				}
 
-		if (!(tmp = ast_str_create(len))) {
-			if (file) {
-				ast_free(file);
+				ao2_unlock(route);
+				goto out500;
 			}
 
-			goto out500;
-		}
-
-		/* Unless we are overridden by serveriface or serveraddr, we set the SERVER variable to
-		 * the IP address we are listening on that the phone contacted for this config file */
-
-		server = ast_var_find(AST_LIST_FIRST(&route->user->extensions)->headp,
-			variable_lookup[AST_PHONEPROV_STD_SERVER]);
-
-		if (!server) {
-			union {
-				struct sockaddr sa;
-				struct sockaddr_in sa_in;
-			} name;
-			socklen_t namelen = sizeof(name.sa);
-			int res;
+			if (!file) {
+				ao2_unlock(route);
+				goto out500;
+			}
 
-			if ((res = getsockname(ser->fd, &name.sa, &namelen))) {
-				ast_log(LOG_WARNING, "Could not get server IP, breakage likely.\n");
-			} else {
-				struct extension *exten_iter;
-				const char *newserver = ast_inet_ntoa(name.sa_in.sin_addr);
+			if (!(tmp = ast_str_create(len))) {
+				ast_free(file);
+				ao2_unlock(route);
+				goto out500;
+			}
 
-				AST_LIST_TRAVERSE(&route->user->extensions, exten_iter, entry) {
-					AST_VAR_LIST_INSERT_TAIL(exten_iter->headp,
-						ast_var_assign(variable_lookup[AST_PHONEPROV_STD_SERVER], newserver));
+			/* Unless we are overridden by serveriface or serveraddr, we set the SERVER variable to
+			 * the IP address we are listening on that the phone contacted for this config file */
+
+			server = ast_var_find(AST_LIST_FIRST(&route->user->extensions)->headp,
+				variable_lookup[AST_PHONEPROV_STD_SERVER]);
+
+			if (!server) {
+				union {
+					struct sockaddr sa;
+					struct sockaddr_in sa_in;
+				} name;
+				socklen_t namelen = sizeof(name.sa);
+				int res;
+
+				if ((res = getsockname(ser->fd, &name.sa, &namelen))) {
+					ast_log(LOG_WARNING, "Could not get server IP, breakage likely.\n");
+				} else {
+					struct extension *exten_iter;
+					const char *newserver = ast_inet_ntoa(name.sa_in.sin_addr);
+
+					AST_LIST_TRAVERSE(&route->user->extensions, exten_iter, entry) {
+						AST_VAR_LIST_INSERT_TAIL(exten_iter->headp,
+							ast_var_assign(variable_lookup[AST_PHONEPROV_STD_SERVER], newserver));
+					}
 				}
 			}
-		}
 
-		ast_str_substitute_variables_varshead(&tmp, 0, AST_LIST_FIRST(&route->user->extensions)->headp, file);
+			ast_str_substitute_variables_varshead(&tmp, 0, AST_LIST_FIRST(&route->user->extensions)->headp, file);
+
+			ast_free(file);
 
-		ast_free(file);
+			ast_free(route->rendered);
+			route->rendered = tmp;
+			route->rendered_mtime = st.st_mtime;
+		}
 
 		http_header = ast_str_create(80);
 		ast_str_set(&http_header, 0, "Content-type: %s\r\n",
 			route->file->mime_type);
 
-		if (!(result = ast_str_create(512))) {
+		if (!(result = ast_str_create(ast_str_strlen(route->rendered) + 1))) {
 			ast_log(LOG_ERROR, "Could not create result string!\n");
-			if (tmp) {
-				ast_free(tmp);
-			}
 			ast_free(http_header);
+			ao2_unlock(route);
 			goto out500;
 		}
-		ast_str_append(&result, 0, "%s", ast_str_buffer(tmp));
+		/* Copy out under the route lock so a concurrent re-render cannot
+		 * free the cached string out from under us. */
+		ast_str_append(&result, 0, "%s", ast_str_buffer(route->rendered));
+		ao2_unlock(route);
 
 		ast_http_send(ser, method, 200, NULL, http_header, result, 0, 0);
-		ast_free(tmp);
 
 		route = unref_route(route);
 
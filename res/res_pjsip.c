@@ -4017,6 +4017,49 @@ int ast_sip_push_task_synchronous(struct ast_taskprocessor *serializer, int (*si
 	return std.fail;
 }
 
+struct completion_task_data {
+	int (*task)(void *);
+	void (*complete)(void *task_data, int res);
+	void *task_data;
+};
+
+static int completion_task(void *data)
+{
+	struct completion_task_data *ctd = data;
+	int res;
+
+	res = ctd->task(ctd->task_data);
+	ctd->complete(ctd->task_data, res);
+	ast_free(ctd);
+	return res;
+}
+
+int ast_sip_push_task_completion(struct ast_taskprocessor *serializer,
+	int (*sip_task)(void *), void *task_data,
+	void (*sip_task_complete)(void *task_data, int res))
+{
+	struct completion_task_data *ctd;
+
+	if (!sip_task_complete) {
+		return ast_sip_push_task(serializer, sip_task, task_data);
+	}
+
+	ctd = ast_malloc(sizeof(*ctd));
+	if (!ctd) {
+		return -1;
+	}
+	ctd->task = sip_task;
+	ctd->complete = sip_task_complete;
+	ctd->task_data = task_data;
+
+	if (ast_sip_push_task(serializer, completion_task, ctd)) {
+		ast_free(ctd);
+		return -1;
+	}
+
+	return 0;
+}
+
 void ast_copy_pj_str(char *dest, const pj_str_t *src, size_t size)
 {
 	size_t chars_to_copy = MIN(size - 1, pj_strlen(src));
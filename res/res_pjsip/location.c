@@ -153,6 +153,161 @@ struct ast_sip_aor *ast_sip_location_retrieve_aor(const char *aor_name)
 	return ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "aor", aor_name);
 }
 
+static int permanent_uri_sort_fn(const void *obj_left, const void *obj_right, int flags);
+
+/*! Number of buckets for the registrar contact index.  (Best if prime number) */
+#define CONTACT_INDEX_BUCKETS		53
+
+/*!
+ * \brief In-memory index of the dynamic contacts bound to an AOR
+ *
+ * Looking the contacts up previously meant a sorcery regex retrieval, which
+ * with a database backed registrar put an ODBC round trip in the path of
+ * every inbound call.  Each entry mirrors the dynamic contacts of one AOR;
+ * entries are created on first lookup and kept current by the contact
+ * observer, leaving sorcery as the persistence layer only.
+ */
+struct contact_index_entry {
+	/*! Mirrored dynamic contacts, keyed on sorcery object id */
+	struct ao2_container *contacts;
+	/*! Name of the AOR the contacts belong to */
+	char aor[];
+};
+
+static struct ao2_container *contact_index;
+
+/*! Bumped by the contact observer so an in-flight index fill detects it raced a change */
+static int contact_index_version;
+
+static void contact_index_entry_destructor(void *obj)
+{
+	struct contact_index_entry *entry = obj;
+
+	ao2_cleanup(entry->contacts);
+}
+
+static int contact_index_hash(const void *obj, int flags)
+{
+	const struct contact_index_entry *entry = obj;
+
+	if (flags & OBJ_SEARCH_OBJECT) {
+		return ast_str_hash(entry->aor);
+	} else if (flags & OBJ_SEARCH_KEY) {
+		return ast_str_hash(obj);
+	}
+	return -1;
+}
+
+static int contact_index_cmp(void *obj, void *arg, int flags)
+{
+	const struct contact_index_entry *object_left = obj;
+	const struct contact_index_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp = 0;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->aor;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (strcmp(object_left->aor, right_key) == 0) {
+			cmp = CMP_MATCH | CMP_STOP;
+		}
+		break;
+	default:
+		cmp = 0;
+		break;
+	}
+	return cmp;
+}
+
+/*!
+ * \brief Publish a freshly retrieved contact set into the index
+ *
+ * \note The version snapshot was taken before the sorcery retrieval.  When
+ * the observer fired in between, the fill is abandoned rather than risk
+ * caching a contact that was just removed; the next lookup tries again.
+ */
+static void contact_index_fill(const char *aor_name, struct ao2_container *contacts, int version)
+{
+	struct contact_index_entry *entry;
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(aor_name) + 1,
+		contact_index_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->aor, aor_name); /* Safe */
+	entry->contacts = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		permanent_uri_sort_fn, NULL);
+	if (!entry->contacts || ao2_container_dup(entry->contacts, contacts, 0)) {
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	ao2_wrlock(contact_index);
+	if (version == contact_index_version) {
+		struct contact_index_entry *existing;
+
+		if ((existing = ao2_find(contact_index, aor_name, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+			ao2_ref(existing, -1);
+		} else {
+			ao2_link_flags(contact_index, entry, OBJ_NOLOCK);
+		}
+	}
+	ao2_unlock(contact_index);
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Observer callback replacing a contact in its AOR's index entry, if one exists */
+static void contact_index_created_updated(const void *object)
+{
+	const struct ast_sip_contact *contact = object;
+	struct contact_index_entry *entry;
+
+	ast_atomic_fetchadd_int(&contact_index_version, +1);
+	entry = ao2_find(contact_index, contact->aor, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return;
+	}
+	ao2_wrlock(entry->contacts);
+	ao2_find(entry->contacts, ast_sorcery_object_get_id(contact),
+		OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(entry->contacts, (void *) contact, OBJ_NOLOCK);
+	ao2_unlock(entry->contacts);
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Observer callback dropping a contact from its AOR's index entry, if one exists */
+static void contact_index_deleted(const void *object)
+{
+	const struct ast_sip_contact *contact = object;
+	struct contact_index_entry *entry;
+
+	ast_atomic_fetchadd_int(&contact_index_version, +1);
+	entry = ao2_find(contact_index, contact->aor, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return;
+	}
+	ao2_find(entry->contacts, ast_sorcery_object_get_id(contact),
+		OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	ao2_ref(entry, -1);
+}
+
+static void contact_index_loaded(const char *object_type)
+{
+	ast_atomic_fetchadd_int(&contact_index_version, +1);
+	ao2_callback(contact_index, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, NULL, NULL);
+}
+
+/*! \brief Observer keeping the contact index in step with registrations and reloads */
+static const struct ast_sorcery_observer contact_index_observer = {
+	.created = contact_index_created_updated,
+	.updated = contact_index_created_updated,
+	.deleted = contact_index_deleted,
+	.loaded = contact_index_loaded,
+};
+
 /*! \brief Internal callback function which deletes and unlinks any expired contacts */
 static int contact_expire(void *obj, void *arg, int flags)
 {
@@ -193,14 +348,34 @@ struct ast_sip_contact *ast_sip_location_retrieve_first_aor_contact(const struct
 
 struct ao2_container *ast_sip_location_retrieve_aor_contacts_nolock(const struct ast_sip_aor *aor)
 {
+	const char *aor_name = ast_sorcery_object_get_id(aor);
 	/* Give enough space for ^ at the beginning and ;@ at the end, since that is our object naming scheme */
-	char regex[strlen(ast_sorcery_object_get_id(aor)) + 4];
+	char regex[strlen(aor_name) + 4];
 	struct ao2_container *contacts;
+	struct contact_index_entry *entry;
+
+	if ((entry = ao2_find(contact_index, aor_name, OBJ_SEARCH_KEY))) {
+		/* Serve the lookup from the index without touching sorcery */
+		contacts = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+			permanent_uri_sort_fn, NULL);
+		if (!contacts || ao2_container_dup(contacts, entry->contacts, 0)) {
+			ao2_cleanup(contacts);
+			contacts = NULL;
+		}
+		ao2_ref(entry, -1);
+		if (!contacts) {
+			return NULL;
+		}
+	} else {
+		int version = contact_index_version;
 
-	snprintf(regex, sizeof(regex), "^%s;@", ast_sorcery_object_get_id(aor));
+		snprintf(regex, sizeof(regex), "^%s;@", aor_name);
 
-	if (!(contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex))) {
-		return NULL;
+		if (!(contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex))) {
+			return NULL;
+		}
+
+		contact_index_fill(aor_name, contacts, version);
 	}
 
 	/* Prune any expired contacts and delete them, we do this first because static contacts can never expire */
@@ -1157,7 +1332,14 @@ int ast_sip_initialize_sorcery_location(void)
 		return -1;
 	}
 
+	contact_index = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		CONTACT_INDEX_BUCKETS, contact_index_hash, NULL, contact_index_cmp);
+	if (!contact_index) {
+		return -1;
+	}
+
 	ast_sorcery_observer_add(sorcery, "aor", &aor_observer);
+	ast_sorcery_observer_add(sorcery, "contact", &contact_index_observer);
 
 	ast_sorcery_object_field_register(sorcery, "contact", "type", "", OPT_NOOP_T, 0, 0);
 	ast_sorcery_object_field_register(sorcery, "contact", "uri", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_sip_contact, uri));
@@ -1237,6 +1419,9 @@ int ast_sip_initialize_sorcery_location(void)
 int ast_sip_destroy_sorcery_location(void)
 {
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "aor", &aor_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "contact", &contact_index_observer);
+	ao2_cleanup(contact_index);
+	contact_index = NULL;
 	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
 	ast_sip_unregister_cli_formatter(contact_formatter);
 	ast_sip_unregister_cli_formatter(aor_formatter);
@@ -2141,18 +2141,35 @@ struct ast_sip_endpoint *ast_sip_default_outbound_endpoint(void)
 
 int ast_sip_retrieve_auths(const struct ast_sip_auth_vector *auths, struct ast_sip_auth **out)
 {
+	struct ao2_container *objects;
 	int i;
 
+	if (!AST_VECTOR_SIZE(auths)) {
+		return 0;
+	}
+
+	/* Using the vector's storage directly is safe since the vector is immutable.
+	 * Retrieving all of the auth objects at once lets backends which support
+	 * bulk retrieval resolve them with a single query.
+	 */
+	objects = ast_sorcery_retrieve_by_id_multiple(ast_sip_get_sorcery(),
+		SIP_SORCERY_AUTH_TYPE, AST_VECTOR_GET_ADDR(auths, 0), AST_VECTOR_SIZE(auths));
+	if (!objects) {
+		return -1;
+	}
+
 	for (i = 0; i < AST_VECTOR_SIZE(auths); ++i) {
-		/* Using AST_VECTOR_GET is safe since the vector is immutable */
 		const char *name = AST_VECTOR_GET(auths, i);
-		out[i] = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), SIP_SORCERY_AUTH_TYPE, name);
+
+		out[i] = ao2_find(objects, name, OBJ_SEARCH_KEY);
 		if (!out[i]) {
 			ast_log(LOG_NOTICE, "Couldn't find auth '%s'. Cannot authenticate\n", name);
+			ao2_ref(objects, -1);
 			return -1;
 		}
 	}
 
+	ao2_ref(objects, -1);
 	return 0;
 }
 
@@ -509,6 +509,145 @@ struct ast_sip_endpoint *ast_sip_get_artificial_endpoint(void)
 	return artificial_endpoint;
 }
 
+/*! Number of buckets for endpoint identification cache entries.  (Best if prime number) */
+#define IDENTIFY_CACHE_BUCKETS		53
+
+/*! Refuse to grow the endpoint identification cache beyond this many entries */
+#define IDENTIFY_CACHE_MAX_SIZE		1024
+
+/*!
+ * \brief Cached result of endpoint identification
+ *
+ * Running every request through the registered endpoint identifiers is
+ * expensive (the IP identifier walks an ACL for each identify section), so
+ * successful identifications are remembered keyed on the source address and
+ * From user.  The cache is emptied whenever configuration the identifiers
+ * draw on changes or reloads.
+ */
+struct identify_cache_entry {
+	/*! The endpoint the identifiers resolved this traffic to */
+	struct ast_sip_endpoint *endpoint;
+	/*! Source address, source port and From user */
+	char key[];
+};
+
+static struct ao2_container *identify_cache;
+
+/*! Nonzero once the observer watching the identify config type is in place */
+static int identify_observer_added;
+
+static void identify_cache_entry_destructor(void *obj)
+{
+	struct identify_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->endpoint);
+}
+
+static int identify_cache_hash(const void *obj, int flags)
+{
+	const struct identify_cache_entry *entry = obj;
+
+	if (flags & OBJ_SEARCH_OBJECT) {
+		return ast_str_hash(entry->key);
+	} else if (flags & OBJ_SEARCH_KEY) {
+		return ast_str_hash(obj);
+	}
+	return -1;
+}
+
+static int identify_cache_compare(void *obj, void *arg, int flags)
+{
+	const struct identify_cache_entry *object_left = obj;
+	const struct identify_cache_entry *object_right = arg;
+	const char *right_key = arg;
+	int cmp = 0;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (strcmp(object_left->key, right_key) == 0) {
+			cmp = CMP_MATCH | CMP_STOP;
+		}
+		break;
+	default:
+		cmp = 0;
+		break;
+	}
+	return cmp;
+}
+
+static void identify_cache_key(pjsip_rx_data *rdata, char *buf, size_t len)
+{
+	char user[PJSIP_MAX_URL_SIZE] = "";
+	pjsip_uri *from = rdata->msg_info.from->uri;
+
+	if (PJSIP_URI_SCHEME_IS_SIP(from) || PJSIP_URI_SCHEME_IS_SIPS(from)) {
+		pjsip_sip_uri *sip_from = pjsip_uri_get_uri(from);
+
+		ast_copy_pj_str(user, &sip_from->user, sizeof(user));
+	}
+	snprintf(buf, len, "%s:%d/%s", rdata->pkt_info.src_name, rdata->pkt_info.src_port, user);
+}
+
+static void identify_cache_flush_loaded(const char *object_type)
+{
+	ao2_callback(identify_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, NULL, NULL);
+}
+
+static void identify_cache_flush_object(const void *object)
+{
+	ao2_callback(identify_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, NULL, NULL);
+}
+
+/*! \brief Observer which empties the identification cache when the configuration it was built from changes */
+static struct ast_sorcery_observer identify_cache_observer = {
+	.created = identify_cache_flush_object,
+	.updated = identify_cache_flush_object,
+	.deleted = identify_cache_flush_object,
+	.loaded = identify_cache_flush_loaded,
+};
+
+static void identify_cache_insert(const char *key, struct ast_sip_endpoint *endpoint)
+{
+	struct identify_cache_entry *entry;
+
+	/* The identify config type belongs to a module loaded after this one, so
+	 * its observer can only be hooked up once traffic is actually flowing.
+	 */
+	if (!identify_observer_added
+		&& !ast_sorcery_observer_add(ast_sip_get_sorcery(), "identify", &identify_cache_observer)) {
+		identify_observer_added = 1;
+	}
+
+	if (ao2_container_count(identify_cache) >= IDENTIFY_CACHE_MAX_SIZE) {
+		return;
+	}
+
+	ao2_wrlock(identify_cache);
+	/* Checking again with the write lock held keeps concurrent misses from
+	 * inserting the same key twice.
+	 */
+	if ((entry = ao2_find(identify_cache, key, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+		ao2_ref(entry, -1);
+		ao2_unlock(identify_cache);
+		return;
+	}
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(key) + 1,
+		identify_cache_entry_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		ao2_unlock(identify_cache);
+		return;
+	}
+	strcpy(entry->key, key); /* Safe */
+	entry->endpoint = endpoint;
+	ao2_ref(endpoint, +1);
+	ao2_link_flags(identify_cache, entry, OBJ_NOLOCK);
+	ao2_ref(entry, -1);
+	ao2_unlock(identify_cache);
+}
+
 static void log_failed_request(pjsip_rx_data *rdata, char *msg, unsigned int count, unsigned int period)
 {
 	char from_buf[PJSIP_MAX_URL_SIZE];
@@ -546,6 +685,8 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 {
 	struct ast_sip_endpoint *endpoint;
 	struct unidentified_request *unid;
+	char cache_key[PJSIP_MAX_URL_SIZE];
+	int cacheable;
 	int is_ack = rdata->msg_info.msg->line.req.method.id == PJSIP_ACK_METHOD;
 
 	endpoint = rdata->endpt_info.mod_data[endpoint_mod.id];
@@ -563,7 +704,28 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	endpoint = ast_sip_identify_endpoint(rdata);
+	/* The auth_username identifier keys off the Authorization header rather
+	 * than anything the (source address, From user) pair captures, so its
+	 * results cannot be served from the cache.
+	 */
+	cacheable = !using_auth_username;
+	if (cacheable) {
+		struct identify_cache_entry *entry;
+
+		identify_cache_key(rdata, cache_key, sizeof(cache_key));
+		if ((entry = ao2_find(identify_cache, cache_key, OBJ_SEARCH_KEY))) {
+			endpoint = entry->endpoint;
+			ao2_ref(endpoint, +1);
+			ao2_ref(entry, -1);
+		}
+	}
+
+	if (!endpoint) {
+		endpoint = ast_sip_identify_endpoint(rdata);
+		if (endpoint && cacheable) {
+			identify_cache_insert(cache_key, endpoint);
+		}
+	}
 	if (endpoint) {
 		if ((unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY))) {
 			ao2_unlink(unidentified_requests, unid);
@@ -1047,6 +1209,13 @@ int ast_sip_initialize_distributor(void)
 		return -1;
 	}
 
+	identify_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		IDENTIFY_CACHE_BUCKETS, identify_cache_hash, NULL, identify_cache_compare);
+	if (!identify_cache) {
+		ast_sip_destroy_distributor();
+		return -1;
+	}
+
 	if (distributor_pool_setup()) {
 		ast_sip_destroy_distributor();
 		return -1;
@@ -1064,6 +1233,7 @@ int ast_sip_initialize_distributor(void)
 	}
 
 	ast_sorcery_observer_add(ast_sip_get_sorcery(), "global", &global_observer);
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "endpoint", &identify_cache_observer);
 	ast_sorcery_reload_object(ast_sip_get_sorcery(), "global");
 
 	if (create_artificial_endpoint() || create_artificial_auth()) {
@@ -1118,6 +1288,11 @@ void ast_sip_destroy_distributor(void)
 	ao2_cleanup(artificial_endpoint);
 
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "global", &global_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "endpoint", &identify_cache_observer);
+	if (identify_observer_added) {
+		ast_sorcery_observer_remove(ast_sip_get_sorcery(), "identify", &identify_cache_observer);
+		identify_observer_added = 0;
+	}
 
 	if (prune_context) {
 		ast_sched_context_destroy(prune_context);
@@ -1126,4 +1301,6 @@ void ast_sip_destroy_distributor(void)
 	distributor_pool_shutdown();
 
 	ao2_cleanup(unidentified_requests);
+	ao2_cleanup(identify_cache);
+	identify_cache = NULL;
 }
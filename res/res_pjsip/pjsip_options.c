@@ -143,17 +143,32 @@ AST_MUTEX_DEFINE_STATIC(creation_lock);
 struct ast_sip_contact_status *ast_res_pjsip_find_or_create_contact_status(const struct ast_sip_contact *contact)
 {
 	struct ast_sip_contact_status *status;
-	SCOPED_MUTEX(lock, &creation_lock);
 
+	/*
+	 * On a running system the status object nearly always exists, so
+	 * check for it before funneling every qualify result through the
+	 * creation lock.
+	 */
+	status = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), CONTACT_STATUS,
+		ast_sorcery_object_get_id(contact));
+	if (status) {
+		return status;
+	}
+
+	ast_mutex_lock(&creation_lock);
+
+	/* Recheck in case another thread created it while we waited. */
 	status = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), CONTACT_STATUS,
 		ast_sorcery_object_get_id(contact));
 	if (status) {
+		ast_mutex_unlock(&creation_lock);
 		return status;
 	}
 
 	status = ast_sorcery_alloc(ast_sip_get_sorcery(), CONTACT_STATUS,
 		ast_sorcery_object_get_id(contact));
 	if (!status) {
+		ast_mutex_unlock(&creation_lock);
 		ast_log(LOG_ERROR, "Unable to create ast_sip_contact_status for contact %s/%s\n",
 			contact->aor, contact->uri);
 		return NULL;
@@ -164,12 +179,15 @@ struct ast_sip_contact_status *ast_res_pjsip_find_or_create_contact_status(const
 	status->rtt = 0;
 
 	if (ast_sorcery_create(ast_sip_get_sorcery(), status)) {
+		ast_mutex_unlock(&creation_lock);
 		ast_log(LOG_ERROR, "Unable to persist ast_sip_contact_status for contact %s\n",
 			contact->uri);
 		ao2_ref(status, -1);
 		return NULL;
 	}
 
+	ast_mutex_unlock(&creation_lock);
+
 	/* The permanent contact added after asterisk start should be qualified. */
 	if (ast_test_flag(&ast_options, AST_OPT_FLAG_FULLY_BOOTED) && ast_tvzero(contact->expiration_time)) {
 		/*
@@ -579,6 +597,29 @@ static void unschedule_qualify(struct ast_sip_contact *contact)
 	ao2_t_ref(data, -1, "Done with ao2_find ref");
 }
 
+/*!
+ * \internal
+ * \brief Calculate a smeared initial qualify interval for a contact.
+ *
+ * \details Picks a random point within the qualify frequency, bounded by
+ * the configured maximum initial qualify time.  Spreading the first check
+ * keeps contacts that were created in a burst from qualifying in lockstep
+ * on every period thereafter.
+ */
+static int smeared_initial_interval(const struct ast_sip_contact *contact)
+{
+	int initial_interval;
+	int max_time = ast_sip_get_max_initial_qualify_time();
+
+	if (max_time && max_time < contact->qualify_frequency) {
+		initial_interval = max_time;
+	} else {
+		initial_interval = contact->qualify_frequency;
+	}
+
+	return (int)((initial_interval * 1000) * ast_random_double());
+}
+
 /*!
  * \internal
  * \brief Qualify the given contact and set up scheduling if configured.
@@ -593,7 +634,12 @@ static void qualify_and_schedule(struct ast_sip_contact *contact)
 			ao2_ref(contact, -1);
 		}
 
-		schedule_qualify(contact, contact->qualify_frequency * 1000);
+		/*
+		 * Smear the first periodic check.  Contacts created together,
+		 * such as during a bulk registration or configuration reload,
+		 * would otherwise share a schedule slot forever.
+		 */
+		schedule_qualify(contact, smeared_initial_interval(contact));
 	} else {
 		update_contact_status(contact, UNKNOWN, 0);
 	}
@@ -1110,21 +1156,10 @@ int ast_sip_initialize_sorcery_qualify(void)
 
 static void qualify_and_schedule_contact(struct ast_sip_contact *contact)
 {
-	int initial_interval;
-	int max_time = ast_sip_get_max_initial_qualify_time();
-
-	/* Delay initial qualification by a random fraction of the specified interval */
-	if (max_time && max_time < contact->qualify_frequency) {
-		initial_interval = max_time;
-	} else {
-		initial_interval = contact->qualify_frequency;
-	}
-
-	initial_interval = (int)((initial_interval * 1000) * ast_random_double());
-
 	unschedule_qualify(contact);
 	if (contact->qualify_frequency) {
-		schedule_qualify(contact, initial_interval);
+		/* Delay initial qualification by a random fraction of the specified interval */
+		schedule_qualify(contact, smeared_initial_interval(contact));
 	} else {
 		update_contact_status(contact, UNKNOWN, 0);
 	}
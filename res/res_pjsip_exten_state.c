@@ -231,9 +231,107 @@ static struct exten_state_subscription *exten_state_subscription_alloc(
 	return exten_state_sub;
 }
 
+/*!
+ * \brief A shared snapshot of a single extension state change
+ *
+ * A change to a heavily watched hint fans out to one notify task per
+ * subscriber, but the change being reported is identical for all of
+ * them.  The snapshot captures the presence strings and device state
+ * container once so that each watcher's task merely takes a reference,
+ * instead of duplicating them hundreds of times during a busy lamp
+ * storm.  The NOTIFY body itself is still rendered per subscription
+ * since it embeds the watcher's own dialog URIs.
+ */
+struct exten_state_change {
+	/*! The new extension state */
+	enum ast_extension_states exten_state;
+	/*! The new presence state */
+	enum ast_presence_state presence_state;
+	/*! The new presence subtype */
+	char *presence_subtype;
+	/*! The new presence message */
+	char *presence_message;
+	/*! Device state information for the change */
+	struct ao2_container *device_state_info;
+	/*! Context of the changed extension */
+	char context[AST_MAX_CONTEXT];
+	/*! The changed extension */
+	char exten[AST_MAX_EXTENSION];
+};
+
+/*! The most recent snapshot, reused while the same change fans out to its watchers */
+static struct exten_state_change *last_exten_state_change;
+
+AST_MUTEX_DEFINE_STATIC(last_exten_state_change_lock);
+
+static void exten_state_change_destructor(void *obj)
+{
+	struct exten_state_change *change = obj;
+
+	ast_free(change->presence_subtype);
+	ast_free(change->presence_message);
+	ao2_cleanup(change->device_state_info);
+}
+
+static int exten_state_change_matches(const struct exten_state_change *change,
+	const char *context, const char *exten, const struct ast_state_cb_info *info)
+{
+	return change->exten_state == info->exten_state
+		&& change->presence_state == info->presence_state
+		&& change->device_state_info == info->device_state_info
+		&& !strcmp(change->context, context)
+		&& !strcmp(change->exten, exten)
+		&& !strcmp(S_OR(change->presence_subtype, ""), S_OR(info->presence_subtype, ""))
+		&& !strcmp(S_OR(change->presence_message, ""), S_OR(info->presence_message, ""));
+}
+
+/*!
+ * \internal
+ * \brief Get a snapshot describing the given state change.
+ *
+ * The state change callbacks for all watchers of a hint fire in sequence
+ * for the same change, so the last snapshot built is reused whenever it
+ * still describes the change being reported.
+ */
+static struct exten_state_change *exten_state_change_get(const char *context,
+	const char *exten, struct ast_state_cb_info *info)
+{
+	struct exten_state_change *change;
+
+	ast_mutex_lock(&last_exten_state_change_lock);
+	change = last_exten_state_change;
+	if (change && exten_state_change_matches(change, context, exten, info)) {
+		ao2_ref(change, +1);
+		ast_mutex_unlock(&last_exten_state_change_lock);
+		return change;
+	}
+	ast_mutex_unlock(&last_exten_state_change_lock);
+
+	change = ao2_alloc(sizeof(*change), exten_state_change_destructor);
+	if (!change) {
+		return NULL;
+	}
+
+	change->exten_state = info->exten_state;
+	change->presence_state = info->presence_state;
+	change->presence_subtype = ast_strdup(info->presence_subtype);
+	change->presence_message = ast_strdup(info->presence_message);
+	change->device_state_info = ao2_bump(info->device_state_info);
+	ast_copy_string(change->context, context, sizeof(change->context));
+	ast_copy_string(change->exten, exten, sizeof(change->exten));
+
+	ast_mutex_lock(&last_exten_state_change_lock);
+	ao2_replace(last_exten_state_change, change);
+	ast_mutex_unlock(&last_exten_state_change_lock);
+
+	return change;
+}
+
 struct notify_task_data {
 	struct ast_sip_exten_state_data exten_state_data;
 	struct exten_state_subscription *exten_state_sub;
+	/*! The state change snapshot shared with the other watchers' tasks */
+	struct exten_state_change *change;
 	int terminate;
 };
 
@@ -242,10 +340,7 @@ static void notify_task_data_destructor(void *obj)
 	struct notify_task_data *task_data = obj;
 
 	ao2_ref(task_data->exten_state_sub, -1);
-	ao2_cleanup(task_data->exten_state_data.device_state_info);
-	ast_free(task_data->exten_state_data.presence_subtype);
-	ast_free(task_data->exten_state_data.presence_message);
-	ast_free(task_data->exten_state_data.user_agent);
+	ao2_cleanup(task_data->change);
 }
 
 static struct notify_task_data *alloc_notify_task_data(const char *exten,
@@ -265,13 +360,24 @@ static struct notify_task_data *alloc_notify_task_data(const char *exten,
 	task_data->exten_state_sub->last_presence_state = info->presence_state;
 	ao2_ref(task_data->exten_state_sub, +1);
 
+	task_data->change = exten_state_change_get(exten_state_sub->context, exten, info);
+	if (!task_data->change) {
+		ast_log(LOG_WARNING, "Unable to create notify task data\n");
+		ao2_cleanup(task_data);
+		return NULL;
+	}
+
+	/* The strings and device state container are borrowed from the snapshot
+	 * and the subscription wrapper, both of which the task holds references
+	 * to, so nothing here is copied or owned by the task itself.
+	 */
 	task_data->exten_state_data.exten = exten_state_sub->exten;
 	task_data->exten_state_data.exten_state = info->exten_state;
 	task_data->exten_state_data.presence_state = info->presence_state;
-	task_data->exten_state_data.presence_subtype = ast_strdup(info->presence_subtype);
-	task_data->exten_state_data.presence_message = ast_strdup(info->presence_message);
-	task_data->exten_state_data.user_agent = ast_strdup(exten_state_sub->user_agent);
-	task_data->exten_state_data.device_state_info = ao2_bump(info->device_state_info);
+	task_data->exten_state_data.presence_subtype = task_data->change->presence_subtype;
+	task_data->exten_state_data.presence_message = task_data->change->presence_message;
+	task_data->exten_state_data.user_agent = exten_state_sub->user_agent;
+	task_data->exten_state_data.device_state_info = task_data->change->device_state_info;
 	task_data->exten_state_data.sub = exten_state_sub->sip_sub;
 	task_data->exten_state_data.datastores = ast_sip_subscription_get_datastores(exten_state_sub->sip_sub);
 
@@ -950,6 +1056,10 @@ static int unload_module(void)
 	ao2_cleanup(publishers);
 	publishers = NULL;
 
+	ast_mutex_lock(&last_exten_state_change_lock);
+	ao2_replace(last_exten_state_change, NULL);
+	ast_mutex_unlock(&last_exten_state_change_lock);
+
 	return 0;
 }
 
@@ -552,6 +552,25 @@ static const char *delayed_method2str(enum delayed_method method)
 	return str;
 }
 
+/*!
+ * \brief How long a session refresh is held to coalesce updates (milliseconds)
+ *
+ * Connected line updates, direct media setup, and codec changes tend to
+ * arrive in a burst right after call establishment, each wanting its own
+ * session refresh.  Refreshes are held for this long so later modifications
+ * fold into the same delayed request; the SDP and headers are generated
+ * when the request is finally sent, so one re-INVITE or UPDATE carries the
+ * combined result.
+ */
+#define REFRESH_COALESCE_WINDOW 200
+
+static int session_refresh(struct ast_sip_session *session,
+	ast_sip_session_request_creation_cb on_request_creation,
+	ast_sip_session_sdp_creation_cb on_sdp_creation,
+	ast_sip_session_response_cb on_response,
+	enum ast_sip_session_refresh_method method, int generate_new_sdp,
+	int allow_coalesce);
+
 /*!
  * \brief Structure used for sending delayed requests
  *
@@ -602,14 +621,14 @@ static int send_delayed_request(struct ast_sip_session *session, struct ast_sip_
 
 	switch (delay->method) {
 	case DELAYED_METHOD_INVITE:
-		ast_sip_session_refresh(session, delay->on_request_creation,
+		session_refresh(session, delay->on_request_creation,
 			delay->on_sdp_creation, delay->on_response,
-			AST_SIP_SESSION_REFRESH_METHOD_INVITE, delay->generate_new_sdp);
+			AST_SIP_SESSION_REFRESH_METHOD_INVITE, delay->generate_new_sdp, 0);
 		return 0;
 	case DELAYED_METHOD_UPDATE:
-		ast_sip_session_refresh(session, delay->on_request_creation,
+		session_refresh(session, delay->on_request_creation,
 			delay->on_sdp_creation, delay->on_response,
-			AST_SIP_SESSION_REFRESH_METHOD_UPDATE, delay->generate_new_sdp);
+			AST_SIP_SESSION_REFRESH_METHOD_UPDATE, delay->generate_new_sdp, 0);
 		return 0;
 	case DELAYED_METHOD_BYE:
 		ast_sip_session_terminate(session, 0);
@@ -777,9 +796,31 @@ static int delay_request(struct ast_sip_session *session,
 	int generate_new_sdp,
 	enum delayed_method method)
 {
-	struct ast_sip_session_delayed_request *delay = delayed_request_alloc(method,
-			on_request, on_sdp_creation, on_response, generate_new_sdp);
+	struct ast_sip_session_delayed_request *delay;
 
+	if (method != DELAYED_METHOD_BYE) {
+		AST_LIST_TRAVERSE(&session->delayed_requests, delay, next) {
+			if (delay->method == method
+				&& delay->on_request_creation == on_request
+				&& delay->on_sdp_creation == on_sdp_creation
+				&& delay->on_response == on_response) {
+				/*
+				 * An equivalent request is already queued.  Its SDP and
+				 * headers are generated from the session state at send
+				 * time, so the one request covers both modifications.
+				 */
+				ast_debug(3, "Endpoint '%s(%s)' coalescing %s request into pending one.\n",
+					ast_sorcery_object_get_id(session->endpoint),
+					session->channel ? ast_channel_name(session->channel) : "",
+					delayed_method2str(method));
+				delay->generate_new_sdp |= generate_new_sdp;
+				return 0;
+			}
+		}
+	}
+
+	delay = delayed_request_alloc(method, on_request, on_sdp_creation, on_response,
+			generate_new_sdp);
 	if (!delay) {
 		return -1;
 	}
@@ -793,6 +834,87 @@ static int delay_request(struct ast_sip_session *session,
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Coalescing window timer expired.
+ *
+ * Runs in the pjsip timer thread; hands off to the session serializer
+ * the same way the re-INVITE collision timer does.
+ */
+static void refresh_window_expired(pj_timer_heap_t *timer, pj_timer_entry *entry)
+{
+	struct ast_sip_session *session = entry->user_data;
+
+	ast_debug(3, "Endpoint '%s(%s)' refresh coalescing window expired.\n",
+		ast_sorcery_object_get_id(session->endpoint),
+		session->channel ? ast_channel_name(session->channel) : "");
+
+	if (AST_LIST_EMPTY(&session->delayed_requests)) {
+		/* No delayed request pending, so just return */
+		ao2_ref(session, -1);
+		return;
+	}
+	if (ast_sip_push_task(session->serializer, invite_collision_timeout, session)) {
+		/*
+		 * Uh oh.  We now have nothing in the foreseeable future
+		 * to trigger sending the delayed requests.
+		 */
+		ao2_ref(session, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Queue a refresh and hold it briefly so nearby updates share one request.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int coalesce_refresh(struct ast_sip_session *session,
+	ast_sip_session_request_creation_cb on_request,
+	ast_sip_session_sdp_creation_cb on_sdp_creation,
+	ast_sip_session_response_cb on_response,
+	int generate_new_sdp,
+	enum ast_sip_session_refresh_method method)
+{
+	pj_time_val tv;
+
+	if (delay_request(session, on_request, on_sdp_creation, on_response,
+		generate_new_sdp,
+		method == AST_SIP_SESSION_REFRESH_METHOD_INVITE
+			? DELAYED_METHOD_INVITE : DELAYED_METHOD_UPDATE)) {
+		return -1;
+	}
+
+	if (pj_timer_entry_running(&session->coalesced_refresh)
+		|| pj_timer_entry_running(&session->rescheduled_reinvite)) {
+		/* An earlier refresh or a collision retry will carry this update. */
+		return 0;
+	}
+
+	ast_debug(3, "Endpoint '%s(%s)' holding session refresh for %d ms to coalesce updates.\n",
+		ast_sorcery_object_get_id(session->endpoint),
+		session->channel ? ast_channel_name(session->channel) : "",
+		REFRESH_COALESCE_WINDOW);
+
+	tv.sec = 0;
+	tv.msec = REFRESH_COALESCE_WINDOW;
+	pj_timer_entry_init(&session->coalesced_refresh, 0, session, refresh_window_expired);
+
+	ao2_ref(session, +1);
+	if (pjsip_endpt_schedule_timer(ast_sip_get_pjsip_endpoint(),
+		&session->coalesced_refresh, &tv) != PJ_SUCCESS) {
+		ao2_ref(session, -1);
+		/*
+		 * Without the timer nothing may trigger the request we just
+		 * queued, so send it now.
+		 */
+		ao2_ref(session, +1);
+		return invite_terminated(session);
+	}
+	return 0;
+}
+
 static pjmedia_sdp_session *generate_session_refresh_sdp(struct ast_sip_session *session)
 {
 	pjsip_inv_session *inv_session = session->inv_session;
@@ -877,11 +999,12 @@ static void set_from_header(struct ast_sip_session *session)
 	}
 }
 
-int ast_sip_session_refresh(struct ast_sip_session *session,
-		ast_sip_session_request_creation_cb on_request_creation,
-		ast_sip_session_sdp_creation_cb on_sdp_creation,
-		ast_sip_session_response_cb on_response,
-		enum ast_sip_session_refresh_method method, int generate_new_sdp)
+static int session_refresh(struct ast_sip_session *session,
+	ast_sip_session_request_creation_cb on_request_creation,
+	ast_sip_session_sdp_creation_cb on_sdp_creation,
+	ast_sip_session_response_cb on_response,
+	enum ast_sip_session_refresh_method method, int generate_new_sdp,
+	int allow_coalesce)
 {
 	pjsip_inv_session *inv_session = session->inv_session;
 	pjmedia_sdp_session *new_sdp = NULL;
@@ -921,6 +1044,13 @@ int ast_sip_session_refresh(struct ast_sip_session *session,
 		}
 	}
 
+	if (allow_coalesce) {
+		/* Nothing forces a delay, but hold the refresh briefly anyway so
+		 * any closely following session modifications share the request. */
+		return coalesce_refresh(session, on_request_creation, on_sdp_creation,
+			on_response, generate_new_sdp, method);
+	}
+
 	if (generate_new_sdp) {
 		/* SDP can only be generated if current negotiation has already completed */
 		if (inv_session->neg
@@ -973,6 +1103,16 @@ int ast_sip_session_refresh(struct ast_sip_session *session,
 	return 0;
 }
 
+int ast_sip_session_refresh(struct ast_sip_session *session,
+		ast_sip_session_request_creation_cb on_request_creation,
+		ast_sip_session_sdp_creation_cb on_sdp_creation,
+		ast_sip_session_response_cb on_response,
+		enum ast_sip_session_refresh_method method, int generate_new_sdp)
+{
+	return session_refresh(session, on_request_creation, on_sdp_creation,
+		on_response, method, generate_new_sdp, 1);
+}
+
 /*!
  * \internal
  * \brief Wrapper for pjsip_inv_send_msg
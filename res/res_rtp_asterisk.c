@@ -36,6 +36,7 @@
 #include "asterisk.h"
 
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <signal.h>
 #include <fcntl.h>
 
@@ -52,6 +53,7 @@
 #include <ifaddrs.h>
 #endif
 
+#include "asterisk/paths.h"
 #include "asterisk/stun.h"
 #include "asterisk/pbx.h"
 #include "asterisk/frame.h"
@@ -68,6 +70,7 @@
 #include "asterisk/rtp_engine.h"
 #include "asterisk/smoother.h"
 #include "asterisk/test.h"
+#include "asterisk/sdt.h"
 
 #define MAX_TIMESTAMP_SKEW	640
 
@@ -98,6 +101,20 @@
 #define RTP_MTU		1200
 #define DTMF_SAMPLE_RATE_MS    8 /*!< DTMF samples per millisecond */
 
+/*! Size of the receive buffer RTP packets are read into */
+#define RTP_RAWDATA_LEN (8192 + AST_FRIENDLY_OFFSET)
+
+/*! Maximum number of locally bridged packets forwarded per wakeup */
+#define RTP_P2P_DRAIN_MAX 16
+
+#if defined(__linux__)
+/*! Maximum number of datagrams drained from the RTP socket by one recvmmsg() call */
+#define RTP_RECV_BATCH 8
+/*! Size of each stashed datagram; matches the receive length callers pass so
+ * a batched datagram is never truncated harder than an unbatched one. */
+#define RTP_RECV_STASH_DATALEN (RTP_RAWDATA_LEN - AST_FRIENDLY_OFFSET)
+#endif
+
 #define DEFAULT_DTMF_TIMEOUT (150 * (8000 / 1000))	/*!< samples */
 
 #define ZFONE_PROFILE_ID 0x505a
@@ -108,6 +125,28 @@
 #define SRTP_MASTER_SALT_LEN 14
 #define SRTP_MASTER_LEN (SRTP_MASTER_KEY_LEN + SRTP_MASTER_SALT_LEN)
 
+#if defined(__linux__)
+/*!
+ * \brief Datagrams drained ahead of time from an RTP socket by recvmmsg().
+ *
+ * Allocated the first time more than one datagram is found queued on the
+ * socket.  Entries are served in arrival order by subsequent reads before
+ * the kernel is asked for more, so packet ordering is preserved.
+ */
+struct rtp_recv_stash {
+	/*! Source address of each stashed datagram */
+	struct ast_sockaddr addr[RTP_RECV_BATCH];
+	/*! Length of each stashed datagram */
+	int len[RTP_RECV_BATCH];
+	/*! Stashed datagram payloads */
+	unsigned char buf[RTP_RECV_BATCH][RTP_RECV_STASH_DATALEN];
+	/*! Next entry to serve */
+	unsigned int head;
+	/*! Number of stashed entries */
+	unsigned int count;
+};
+#endif
+
 enum strict_rtp_state {
 	STRICT_RTP_OPEN = 0, /*! No RTP packets should be dropped, all sources accepted */
 	STRICT_RTP_LEARN,    /*! Accept next packet as source */
@@ -127,6 +166,7 @@ static int rtpend = DEFAULT_RTP_END;			/*!< Last port for RTP sessions (set in r
 static int rtpdebug;			/*!< Are we debugging? */
 static int rtcpdebug;			/*!< Are we debugging RTCP? */
 static int rtcpstats;			/*!< Are we debugging RTCP? */
+static int rtpstatsshm;			/*!< Publish live quality stats to a shared memory segment? */
 static int rtcpinterval = RTCP_DEFAULT_INTERVALMS; /*!< Time between rtcp reports in millisecs */
 static struct ast_sockaddr rtpdebugaddr;	/*!< Debug packets to/from this host */
 static struct ast_sockaddr rtcpdebugaddr;	/*!< Debug RTCP packets to/from this host */
@@ -147,6 +187,28 @@ static pj_str_t turnpassword;
 static struct ast_ha *ice_blacklist = NULL;    /*!< Blacklisted ICE networks */
 static ast_rwlock_t ice_blacklist_lock = AST_RWLOCK_INIT_VALUE;
 
+/*! \brief How long a STUN-discovered external mapping may be reused, in seconds */
+#define STUN_EXTERNAL_CACHE_TTL 60
+
+/*!
+ * \brief Cached result of STUN external address discovery.
+ *
+ * Candidate gathering performed a blocking STUN round trip per component
+ * on every session setup.  When the NAT in front of us preserves ports
+ * (mapped port == local port), the server reflexive candidate for any
+ * local port can be synthesized from the last discovered external address
+ * without asking the STUN server again.  Entries expire after
+ * STUN_EXTERNAL_CACHE_TTL seconds so external address changes are picked
+ * up; a stale srflx candidate is weeded out by the ICE connectivity
+ * checks in any case.
+ */
+static struct {
+	struct in_addr external_addr; /*!< Last mapped address the STUN server reported */
+	time_t when;                  /*!< When the mapping was learned */
+	int port_preserving;          /*!< TRUE if the mapped port equaled the local port */
+} stun_external_cache;
+AST_MUTEX_DEFINE_STATIC(stun_external_cache_lock);
+
 
 /*! \brief Pool factory used by pjlib to allocate memory. */
 static pj_caching_pool cachingpool;
@@ -226,11 +288,69 @@ struct dtls_details {
 };
 #endif
 
+/*! \brief Magic marking the head of the live statistics segment ("RTPS") */
+#define RTP_STATS_SHM_MAGIC 0x52545053
+
+/*! \brief Layout version of the live statistics segment; bump on any layout change */
+#define RTP_STATS_SHM_VERSION 1
+
+/*! \brief Number of statistics slots in the segment; bounds concurrent RTP instances published */
+#define RTP_STATS_SHM_SLOTS 8192
+
+/*!
+ * \brief Head of the live statistics shared memory segment.
+ *
+ * The segment is a plain file in the Asterisk run directory, mapped
+ * MAP_SHARED, so external collectors can mmap() it read-only and scrape
+ * every active call without issuing AMI/CLI commands or taking any
+ * Asterisk locks.  The layout is ABI for those readers: fixed width
+ * types only, and RTP_STATS_SHM_VERSION must change if it does.
+ */
+struct rtp_stats_shm_header {
+	uint32_t magic;			/*!< RTP_STATS_SHM_MAGIC; written last during creation */
+	uint32_t version;		/*!< RTP_STATS_SHM_VERSION */
+	uint32_t slot_count;		/*!< Number of slots following this header */
+	uint32_t slot_size;		/*!< sizeof(struct rtp_stats_shm_slot) */
+};
+
+/*!
+ * \brief One published RTP instance in the live statistics segment.
+ *
+ * Readers must use the seqlock protocol: read \c seq, copy the slot,
+ * read \c seq again, and retry if the values differ or were odd.  All
+ * counters are cumulative for the life of the RTP instance.
+ */
+struct rtp_stats_shm_slot {
+	uint32_t seq;			/*!< Seqlock generation; odd while a writer is mid-update */
+	uint32_t in_use;		/*!< Nonzero while an RTP instance owns this slot */
+	uint32_t ssrc;			/*!< Our synchronization source */
+	uint32_t themssrc;		/*!< Their synchronization source */
+	char channel_uniqueid[MAX_CHANNEL_ID];	/*!< Unique id of the channel owning the instance */
+	uint64_t rxcount;		/*!< Packets received */
+	uint64_t txcount;		/*!< Packets transmitted */
+	uint64_t rxlost;		/*!< Packets we lost */
+	uint64_t txlost;		/*!< Packets the far end reported lost */
+	double rxjitter;		/*!< Our interarrival jitter in seconds */
+	double txjitter;		/*!< Far end reported jitter in seconds */
+	double rtt;			/*!< Last measured round trip time in seconds */
+};
+
+/*! \brief Live statistics segment mapping, or NULL when not enabled */
+static struct rtp_stats_shm_header *rtp_stats_shm;
+
+/*! \brief Path of the backing file so unload can remove it */
+static char rtp_stats_shm_path[PATH_MAX];
+
+/*! \brief Serializes slot allocation and release between RTP instances */
+AST_MUTEX_DEFINE_STATIC(rtp_stats_shm_lock);
+
 /*! \brief RTP session description */
 struct ast_rtp {
 	int s;
 	struct ast_frame f;
-	unsigned char rawdata[8192 + AST_FRIENDLY_OFFSET];
+	unsigned char *rawdata;		/*!< Receive buffer of RTP_RAWDATA_LEN bytes; handed to the
+					 *   returned frame and replaced when a media frame is built
+					 *   so the payload is never copied after the kernel writes it */
 	unsigned int ssrc;		/*!< Synchronization source, RFC 3550, page 10. */
 	unsigned int themssrc;		/*!< Their SSRC */
 	unsigned int rxssrc;
@@ -300,6 +420,12 @@ struct ast_rtp {
 
 	struct rtp_red *red;
 
+	struct rtp_stats_shm_slot *stats_slot;	/*!< Slot in the live statistics segment, or NULL */
+
+#if defined(__linux__)
+	struct rtp_recv_stash *recv_stash; /*!< Datagrams drained ahead of time by recvmmsg() */
+#endif
+
 	ast_mutex_t lock;           /*!< Lock for synchronization purposes */
 	ast_cond_t cond;            /*!< Condition for signaling */
 
@@ -434,6 +560,191 @@ struct rtp_red {
 
 AST_LIST_HEAD_NOLOCK(frame_list, ast_frame);
 
+/*!
+ * \internal
+ * \brief Create and map the live statistics segment if not already done.
+ *
+ * The backing file lives in the run directory so collectors know where
+ * to find it and so it disappears with the rest of the runtime state.
+ * Once created the segment stays mapped until the module is unloaded;
+ * turning the option off only takes effect on the next load.
+ */
+static void rtp_stats_shm_create(void)
+{
+	size_t size = sizeof(struct rtp_stats_shm_header)
+		+ RTP_STATS_SHM_SLOTS * sizeof(struct rtp_stats_shm_slot);
+	struct rtp_stats_shm_header *header;
+	int fd;
+
+	if (rtp_stats_shm) {
+		return;
+	}
+
+	snprintf(rtp_stats_shm_path, sizeof(rtp_stats_shm_path), "%s/rtp_stats",
+		ast_config_AST_RUN_DIR);
+
+	fd = open(rtp_stats_shm_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		ast_log(LOG_WARNING, "Could not create RTP statistics segment '%s': %s\n",
+			rtp_stats_shm_path, strerror(errno));
+		return;
+	}
+	if (ftruncate(fd, size)) {
+		ast_log(LOG_WARNING, "Could not size RTP statistics segment '%s': %s\n",
+			rtp_stats_shm_path, strerror(errno));
+		close(fd);
+		unlink(rtp_stats_shm_path);
+		return;
+	}
+
+	header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED) {
+		ast_log(LOG_WARNING, "Could not map RTP statistics segment '%s': %s\n",
+			rtp_stats_shm_path, strerror(errno));
+		unlink(rtp_stats_shm_path);
+		return;
+	}
+
+	memset(header, 0, size);
+	header->version = RTP_STATS_SHM_VERSION;
+	header->slot_count = RTP_STATS_SHM_SLOTS;
+	header->slot_size = sizeof(struct rtp_stats_shm_slot);
+	/* The magic goes in last so a reader never sees a half built header */
+	__sync_synchronize();
+	header->magic = RTP_STATS_SHM_MAGIC;
+
+	rtp_stats_shm = header;
+	ast_verb(2, "RTP live statistics published in %s\n", rtp_stats_shm_path);
+}
+
+/*!
+ * \internal
+ * \brief Unmap and remove the live statistics segment.
+ */
+static void rtp_stats_shm_destroy(void)
+{
+	if (!rtp_stats_shm) {
+		return;
+	}
+
+	munmap(rtp_stats_shm, sizeof(struct rtp_stats_shm_header)
+		+ RTP_STATS_SHM_SLOTS * sizeof(struct rtp_stats_shm_slot));
+	rtp_stats_shm = NULL;
+	unlink(rtp_stats_shm_path);
+}
+
+/*!
+ * \internal
+ * \brief Claim a free slot in the live statistics segment for an RTP instance.
+ *
+ * \retval The claimed slot.
+ * \retval NULL if the segment is not mapped or every slot is taken.
+ */
+static struct rtp_stats_shm_slot *rtp_stats_shm_slot_alloc(struct ast_rtp *rtp)
+{
+	struct rtp_stats_shm_slot *slots = (struct rtp_stats_shm_slot *)(rtp_stats_shm + 1);
+	uint32_t idx;
+
+	ast_mutex_lock(&rtp_stats_shm_lock);
+	for (idx = 0; idx < RTP_STATS_SHM_SLOTS; idx++) {
+		if (!slots[idx].in_use) {
+			break;
+		}
+	}
+	if (idx == RTP_STATS_SHM_SLOTS) {
+		ast_mutex_unlock(&rtp_stats_shm_lock);
+		ast_debug(1, "No free RTP statistics slot for instance '%p'\n", rtp);
+		return NULL;
+	}
+	slots[idx].seq++;
+	__sync_synchronize();
+	slots[idx].in_use = 1;
+	rtp->stats_slot = &slots[idx];
+	ast_mutex_unlock(&rtp_stats_shm_lock);
+
+	return rtp->stats_slot;
+}
+
+/*!
+ * \internal
+ * \brief Return an RTP instance's slot to the free pool.
+ *
+ * The contents are zeroed under an odd sequence count so a reader that
+ * raced the release retries instead of reporting a dead call.  The
+ * sequence count itself survives reuse, which is what keeps the seqlock
+ * monotonic for readers.
+ */
+static void rtp_stats_shm_slot_release(struct ast_rtp *rtp)
+{
+	struct rtp_stats_shm_slot *slot = rtp->stats_slot;
+	uint32_t seq;
+
+	if (!slot) {
+		return;
+	}
+
+	ast_mutex_lock(&rtp_stats_shm_lock);
+	seq = slot->seq + 1;
+	slot->seq = seq;
+	__sync_synchronize();
+	memset(&slot->in_use, 0, sizeof(*slot) - offsetof(struct rtp_stats_shm_slot, in_use));
+	__sync_synchronize();
+	slot->seq = seq + 1;
+	rtp->stats_slot = NULL;
+	ast_mutex_unlock(&rtp_stats_shm_lock);
+}
+
+/*!
+ * \internal
+ * \brief Publish an RTP instance's current quality counters to its slot.
+ *
+ * Called whenever RTCP gives us fresh numbers: when we build an SR/RR
+ * and when we digest one from the far end.  The update is done in place
+ * under the seqlock so collectors never block us and we never block
+ * them; the instance's own lock serializes the two writer paths.
+ */
+static void rtp_stats_shm_publish(struct ast_rtp_instance *instance, struct ast_rtp *rtp)
+{
+	struct rtp_stats_shm_slot *slot;
+	unsigned int extended_seq_no;
+	unsigned int expected_packets;
+
+	if (!rtp_stats_shm || !rtp->rtcp) {
+		return;
+	}
+
+	slot = rtp->stats_slot;
+	if (!slot && !(slot = rtp_stats_shm_slot_alloc(rtp))) {
+		return;
+	}
+
+	/* Cumulative expected packet count, same arithmetic as the SR/RR builder */
+	extended_seq_no = rtp->cycles + rtp->lastrxseqno;
+	expected_packets = extended_seq_no - rtp->seedrxseqno + 1;
+	if (rtp->rxcount > expected_packets) {
+		expected_packets = rtp->rxcount;
+	}
+
+	ast_mutex_lock(&rtp->lock);
+	slot->seq++;
+	__sync_synchronize();
+	slot->ssrc = rtp->ssrc;
+	slot->themssrc = rtp->themssrc;
+	ast_copy_string(slot->channel_uniqueid, ast_rtp_instance_get_channel_id(instance),
+		sizeof(slot->channel_uniqueid));
+	slot->rxcount = rtp->rxcount;
+	slot->txcount = rtp->txcount;
+	slot->rxlost = expected_packets - rtp->rxcount;
+	slot->txlost = rtp->rtcp->reported_lost;
+	slot->rxjitter = rtp->rxjitter;
+	slot->txjitter = rtp->rtcp->reported_jitter / 65536.0;
+	slot->rtt = rtp->rtcp->rtt;
+	__sync_synchronize();
+	slot->seq++;
+	ast_mutex_unlock(&rtp->lock);
+}
+
 /* Forward Declarations */
 static int ast_rtp_new(struct ast_rtp_instance *instance, struct ast_sched_context *sched, struct ast_sockaddr *addr, void *data);
 static int ast_rtp_destroy(struct ast_rtp_instance *instance);
@@ -1192,6 +1503,26 @@ static void ast_rtp_ice_turn_request(struct ast_rtp_instance *instance, enum ast
 
 	ast_mutex_lock(&rtp->lock);
 	if (*turn_sock) {
+		/*
+		 * An allocation on the same server survives renegotiation, so an
+		 * ICE restart can reuse it instead of paying for a destroy wait
+		 * plus a fresh TURN handshake.
+		 */
+		if (rtp->turn_state == PJ_TURN_STATE_READY
+			&& pj_turn_sock_get_info(*turn_sock, &info) == PJ_SUCCESS) {
+			pj_sockaddr server_addr;
+			pj_str_t server_str = pj_str(ast_strdupa(ast_sockaddr_stringify_addr(&addr)));
+
+			pj_sockaddr_init(ast_sockaddr_is_ipv4(&addr) ? pj_AF_INET() : pj_AF_INET6(),
+				&server_addr, &server_str, port);
+			if (pj_sockaddr_cmp(&info.server, &server_addr) == 0) {
+				ast_mutex_unlock(&rtp->lock);
+				ast_rtp_ice_add_cand(rtp, component, conn_transport, PJ_ICE_CAND_TYPE_RELAYED,
+					65535, &info.relay_addr, &info.relay_addr, &info.mapped_addr,
+					pj_sockaddr_get_len(&info.relay_addr));
+				return;
+			}
+		}
 		pj_turn_sock_destroy(*turn_sock);
 		rtp->turn_state = PJ_TURN_STATE_NULL;
 		while (rtp->turn_state != PJ_TURN_STATE_DESTROYING) {
@@ -2162,6 +2493,116 @@ error:
 }
 #endif
 
+#if defined(__linux__)
+/*!
+ * \internal
+ * \brief Drain the RTP socket with recvmmsg(), stashing extra datagrams.
+ *
+ * One recvfrom() per voice packet is fine while the reading thread keeps
+ * up, but a thread that has fallen behind finds several datagrams queued
+ * and pays a poll() wakeup plus a recvfrom() for every one of them.
+ * Drain up to RTP_RECV_BATCH datagrams in a single syscall instead: the
+ * first is returned to the caller and the rest are stashed on the
+ * instance and served, in arrival order, by subsequent reads without
+ * touching the kernel.
+ *
+ * Ordering with datagrams still queued in the kernel is preserved since
+ * the stash is always served before the kernel is read again, and poll()
+ * keeps waking the reader while either has data.
+ */
+static int rtp_recvfrom_batch(struct ast_rtp *rtp, void *buf, size_t size, int flags, struct ast_sockaddr *sa)
+{
+	struct rtp_recv_stash *stash = rtp->recv_stash;
+	struct mmsghdr msgs[RTP_RECV_BATCH];
+	struct iovec iovs[RTP_RECV_BATCH];
+	struct sockaddr_storage probe_addr;
+	unsigned char probe_buf[RTP_RECV_STASH_DATALEN];
+	int num_msgs;
+	int num;
+	int idx;
+
+	/* Serve previously drained datagrams first to preserve ordering. */
+	if (stash && stash->count) {
+		int len;
+
+		idx = stash->head;
+		len = stash->len[idx];
+		if (len > (int) size) {
+			len = size;
+		}
+		memcpy(buf, stash->buf[idx], len);
+		ast_sockaddr_copy(sa, &stash->addr[idx]);
+		stash->head = (stash->head + 1) % RTP_RECV_BATCH;
+		--stash->count;
+		return len;
+	}
+
+	memset(msgs, 0, sizeof(msgs));
+	sa->len = sizeof(sa->ss);
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = size;
+	msgs[0].msg_hdr.msg_name = &sa->ss;
+	msgs[0].msg_hdr.msg_namelen = sa->len;
+	msgs[0].msg_hdr.msg_iov = &iovs[0];
+	msgs[0].msg_hdr.msg_iovlen = 1;
+	if (stash) {
+		/* The stash is empty, so the kernel can scatter extra datagrams
+		 * straight into its full-size slots with no intermediate copy. */
+		stash->head = 0;
+		for (idx = 1; idx < RTP_RECV_BATCH; ++idx) {
+			iovs[idx].iov_base = stash->buf[idx - 1];
+			iovs[idx].iov_len = sizeof(stash->buf[idx - 1]);
+			msgs[idx].msg_hdr.msg_name = &stash->addr[idx - 1].ss;
+			msgs[idx].msg_hdr.msg_namelen = sizeof(stash->addr[idx - 1].ss);
+			msgs[idx].msg_hdr.msg_iov = &iovs[idx];
+			msgs[idx].msg_hdr.msg_iovlen = 1;
+		}
+		num_msgs = RTP_RECV_BATCH;
+	} else {
+		/* No stash yet; probe with a single extra message to learn
+		 * whether this socket backs up without burning stack on a
+		 * full set of receive buffers. */
+		iovs[1].iov_base = probe_buf;
+		iovs[1].iov_len = sizeof(probe_buf);
+		msgs[1].msg_hdr.msg_name = &probe_addr;
+		msgs[1].msg_hdr.msg_namelen = sizeof(probe_addr);
+		msgs[1].msg_hdr.msg_iov = &iovs[1];
+		msgs[1].msg_hdr.msg_iovlen = 1;
+		num_msgs = 2;
+	}
+
+	num = recvmmsg(rtp->s, msgs, num_msgs, flags | MSG_DONTWAIT, NULL);
+	if (num <= 0) {
+		return -1;
+	}
+	sa->len = msgs[0].msg_hdr.msg_namelen;
+
+	if (num > 1 && !stash) {
+		/* This socket has shown it can back up; give it a stash and
+		 * hold on to the probed datagram. */
+		rtp->recv_stash = stash = ast_calloc(1, sizeof(*stash));
+		if (stash) {
+			stash->head = 0;
+			stash->len[0] = msgs[1].msg_len;
+			memcpy(stash->buf[0], probe_buf, msgs[1].msg_len);
+			memcpy(&stash->addr[0].ss, &probe_addr, msgs[1].msg_hdr.msg_namelen);
+			stash->addr[0].len = msgs[1].msg_hdr.msg_namelen;
+			stash->count = 1;
+		}
+		/* If the stash could not be allocated the probed datagram is
+		 * lost, which UDP media must tolerate anyway. */
+	} else if (num > 1) {
+		for (idx = 1; idx < num; ++idx) {
+			stash->len[idx - 1] = msgs[idx].msg_len;
+			stash->addr[idx - 1].len = msgs[idx].msg_hdr.msg_namelen;
+		}
+		stash->count = num - 1;
+	}
+
+	return msgs[0].msg_len;
+}
+#endif
+
 static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
 {
 	int len;
@@ -2172,9 +2613,20 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 	struct ast_sockaddr *loop = rtcp ? &rtp->rtcp_loop : &rtp->rtp_loop;
 #endif
 
+#if defined(__linux__)
+	if (rtcp) {
+		len = ast_recvfrom(rtp->rtcp->s, buf, size, flags, sa);
+	} else {
+		len = rtp_recvfrom_batch(rtp, buf, size, flags, sa);
+	}
+	if (len < 0) {
+		return len;
+	}
+#else
 	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
 	   return len;
 	}
+#endif
 
 #ifdef HAVE_OPENSSL_SRTP
 	/* If this is an SSL packet pass it to OpenSSL for processing. RFC section for first byte value:
@@ -2510,8 +2962,30 @@ static void rtp_add_candidates_to_ice(struct ast_rtp_instance *instance, struct
 	/* If configured to use a STUN server to get our external mapped address do so */
 	if (stunaddr.sin_addr.s_addr && ast_sockaddr_is_ipv4(addr) && count) {
 		struct sockaddr_in answer;
-
-		if (!ast_stun_request(component == AST_RTP_ICE_COMPONENT_RTCP ? rtp->rtcp->s : rtp->s, &stunaddr, NULL, &answer)) {
+		int have_answer = 0;
+
+		/* A fresh port-preserving mapping lets us synthesize the srflx
+		 * candidate without the blocking STUN round trip. */
+		ast_mutex_lock(&stun_external_cache_lock);
+		if (stun_external_cache.port_preserving
+			&& time(NULL) < stun_external_cache.when + STUN_EXTERNAL_CACHE_TTL) {
+			answer.sin_addr = stun_external_cache.external_addr;
+			answer.sin_port = htons(port);
+			have_answer = 1;
+		}
+		ast_mutex_unlock(&stun_external_cache_lock);
+
+		if (!have_answer
+			&& !ast_stun_request(component == AST_RTP_ICE_COMPONENT_RTCP ? rtp->rtcp->s : rtp->s, &stunaddr, NULL, &answer)) {
+			have_answer = 1;
+			ast_mutex_lock(&stun_external_cache_lock);
+			stun_external_cache.external_addr = answer.sin_addr;
+			stun_external_cache.port_preserving = (ntohs(answer.sin_port) == port);
+			stun_external_cache.when = time(NULL);
+			ast_mutex_unlock(&stun_external_cache_lock);
+		}
+
+		if (have_answer) {
 			pj_sockaddr base;
 			pj_sockaddr ext;
 			pj_str_t mapped = pj_str(ast_strdupa(ast_inet_ntoa(answer.sin_addr)));
@@ -2641,6 +3115,10 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 	if (!(rtp = ast_calloc(1, sizeof(*rtp)))) {
 		return -1;
 	}
+	if (!(rtp->rawdata = ast_frame_data_alloc(RTP_RAWDATA_LEN))) {
+		ast_free(rtp);
+		return -1;
+	}
 
 	/* Initialize synchronization aspects */
 	ast_mutex_init(&rtp->lock);
@@ -2661,6 +3139,7 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 			       ast_sockaddr_is_ipv4(addr) ? AF_INET  :
 			       ast_sockaddr_is_ipv6(addr) ? AF_INET6 : -1)) < 0) {
 		ast_log(LOG_WARNING, "Failed to create a new socket for RTP instance '%p'\n", instance);
+		ast_frame_data_free(rtp->rawdata, RTP_RAWDATA_LEN);
 		ast_free(rtp);
 		return -1;
 	}
@@ -2688,6 +3167,7 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 		if (x == startplace || (errno != EADDRINUSE && errno != EACCES)) {
 			ast_log(LOG_ERROR, "Oh dear... we couldn't allocate a port for RTP instance '%p'\n", instance);
 			close(rtp->s);
+			ast_frame_data_free(rtp->rawdata, RTP_RAWDATA_LEN);
 			ast_free(rtp);
 			return -1;
 		}
@@ -2738,11 +3218,22 @@ static int ast_rtp_destroy(struct ast_rtp_instance *instance)
 	ast_rtp_dtls_stop(instance);
 #endif
 
+	/* Stop publishing live statistics for this instance */
+	rtp_stats_shm_slot_release(rtp);
+
 	/* Destroy the smoother that was smoothing out audio if present */
 	if (rtp->smoother) {
 		ast_smoother_free(rtp->smoother);
 	}
 
+#if defined(__linux__)
+	/* Toss any datagrams drained ahead of time */
+	ast_free(rtp->recv_stash);
+#endif
+
+	/* Release the receive buffer */
+	ast_frame_data_free(rtp->rawdata, RTP_RAWDATA_LEN);
+
 	/* Close our own socket so we no longer get packets */
 	if (rtp->s > -1) {
 		close(rtp->s);
@@ -3191,6 +3682,8 @@ static int ast_rtcp_write_report(struct ast_rtp_instance *instance, int sr)
 	/* Compute statistics */
 	calculate_lost_packet_statistics(rtp, &lost_packets, &fraction_lost);
 
+	rtp_stats_shm_publish(instance, rtp);
+
 	gettimeofday(&now, NULL);
 	rtcp_report->reception_report_count = rtp->themssrc ? 1 : 0;
 	rtcp_report->ssrc = rtp->ssrc;
@@ -3510,6 +4003,8 @@ static int ast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *fr
 	struct ast_format *format;
 	int codec;
 
+	ast_sdt_probe3(rtp_write, instance, frame->frametype, frame->datalen);
+
 	ast_rtp_instance_get_remote_address(instance, &remote_address);
 
 	/* If we don't actually know the remote address don't even bother doing anything */
@@ -3980,6 +4475,7 @@ static struct ast_frame *process_cn_rfc3389(struct ast_rtp_instance *instance, u
 	if (!len) {
 		return NULL;
 	}
+	rtp->f.mallocd = 0;
 	if (len < 24) {
 		rtp->f.data.ptr = rtp->rawdata + AST_FRIENDLY_OFFSET;
 		rtp->f.datalen = len - 1;
@@ -4261,6 +4757,7 @@ static struct ast_frame *ast_rtcp_read(struct ast_rtp_instance *instance)
 				update_jitter_stats(rtp, report_block->ia_jitter);
 				update_lost_stats(rtp, report_block->lost_count.packets);
 				rtp->rtcp->reported_jitter_count++;
+				rtp_stats_shm_publish(instance, rtp);
 
 				if (rtcp_debug_test_addr(&addr)) {
 					ast_verbose("  Fraction lost: %d\n", report_block->lost_count.fraction);
@@ -4430,11 +4927,12 @@ static int bridge_p2p_rtp_write(struct ast_rtp_instance *instance, unsigned int
 	return 0;
 }
 
-static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+static struct ast_frame *ast_rtp_read_one(struct ast_rtp_instance *instance, int rtcp)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 	struct ast_sockaddr addr;
 	int res, hdrlen = 12, version, payloadtype, padding, mark, ext, cc, prev_seqno;
+	int p2p_forwarded = 0;
 	unsigned int *rtpheader = (unsigned int*)(rtp->rawdata + AST_FRIENDLY_OFFSET), seqno, ssrc, timestamp;
 	RAII_VAR(struct ast_rtp_payload_type *, payload, NULL, ao2_cleanup);
 	struct ast_sockaddr remote_address = { {0,} };
@@ -4454,9 +4952,15 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	}
 
 	/* Actually read in the data from the socket */
-	if ((res = rtp_recvfrom(instance, rtp->rawdata + AST_FRIENDLY_OFFSET,
-				sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET, 0,
-				&addr)) < 0) {
+	res = rtp_recvfrom(instance, rtp->rawdata + AST_FRIENDLY_OFFSET,
+				RTP_RAWDATA_LEN - AST_FRIENDLY_OFFSET, 0,
+				&addr);
+
+	ast_sdt_probe2(rtp_read, instance, res);
+
+	/* Re-entered by the passthrough drain below with the next queued packet */
+process_packet:
+	if (res < 0) {
 		ast_assert(errno != EBADF);
 		if (errno != EAGAIN) {
 			ast_log(LOG_WARNING, "RTP Read error: %s.  Hanging up.\n",
@@ -4566,6 +5070,18 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 
 	/* If we are directly bridged to another instance send the audio directly out */
 	if (ast_rtp_instance_get_bridged(instance) && !bridge_p2p_rtp_write(instance, rtpheader, res, hdrlen)) {
+		/* While passthrough is in effect no frame is ever built, so
+		 * there is no reason to climb back through the channel layer
+		 * between packets.  Forward whatever else is already queued
+		 * right now, re-running the full per-packet checks above for
+		 * each one.  The cap bounds how long one wakeup can hog the
+		 * channel thread; anything left triggers another poll() wakeup. */
+		if (++p2p_forwarded < RTP_P2P_DRAIN_MAX) {
+			res = rtp_recvfrom(instance, rtp->rawdata + AST_FRIENDLY_OFFSET,
+						RTP_RAWDATA_LEN - AST_FRIENDLY_OFFSET, 0,
+						&addr);
+			goto process_packet;
+		}
 		return &ast_null_frame;
 	}
 
@@ -4852,10 +5368,110 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 		return &ast_null_frame;;
 	}
 
+	/* Hand the receive buffer to the frame so the payload the kernel
+	 * wrote is the very buffer that travels through the core, instead
+	 * of being copied again when the frame is isolated or queued.  A
+	 * fresh buffer is swapped in for the next read; if that cannot be
+	 * allocated the frame stays unowned and the core copies it as it
+	 * always used to. */
+	{
+		unsigned char *fresh = ast_frame_data_alloc(RTP_RAWDATA_LEN);
+
+		if (fresh) {
+			rtp->f.mallocd = AST_MALLOCD_DATA;
+			/* The t140 handling above may have advanced data.ptr, so
+			 * recompute the offset from the true buffer start. */
+			rtp->f.offset = (unsigned char *) rtp->f.data.ptr - rtp->rawdata;
+			rtp->rawdata = fresh;
+		}
+	}
+
 	AST_LIST_INSERT_TAIL(&frames, &rtp->f, frame_list);
 	return AST_LIST_FIRST(&frames);
 }
 
+#if defined(__linux__)
+/*!
+ * \internal
+ * \brief Isolate every frame on a list from the instance's embedded storage.
+ *
+ * Frames returned by ast_rtp_read_one() may be, or point into, storage the
+ * next read reuses (the embedded frame, the receive buffer).  Isolating
+ * them makes another read safe while they are still queued for return.
+ * Frames that cannot be isolated are dropped.
+ */
+static struct ast_frame *rtp_read_isolate(struct ast_frame *head)
+{
+	struct ast_frame *out = NULL;
+	struct ast_frame *out_tail = NULL;
+
+	while (head) {
+		struct ast_frame *next = AST_LIST_NEXT(head, frame_list);
+		struct ast_frame *isolated;
+
+		AST_LIST_NEXT(head, frame_list) = NULL;
+		isolated = ast_frisolate(head);
+		if (isolated) {
+			if (out_tail) {
+				AST_LIST_NEXT(out_tail, frame_list) = isolated;
+			} else {
+				out = isolated;
+			}
+			out_tail = isolated;
+		}
+		head = next;
+	}
+
+	return out;
+}
+
+static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+
+	/* Datagrams stashed by the recvmmsg() drain are invisible to the
+	 * caller's poll(), which only watches the socket, so everything
+	 * parked on the stash must come back as frames during this wakeup;
+	 * otherwise it strands there until the next inbound datagram.  The
+	 * common case of one datagram and an empty stash takes a single
+	 * pass with no extra work. */
+	for (;;) {
+		struct ast_frame *f = ast_rtp_read_one(instance, rtcp);
+		int more = !rtcp && rtp->recv_stash && rtp->recv_stash->count;
+
+		if (!head && !more) {
+			return f;
+		}
+		if (f != &ast_null_frame) {
+			if (more) {
+				f = rtp_read_isolate(f);
+			}
+			if (f) {
+				if (tail) {
+					AST_LIST_NEXT(tail, frame_list) = f;
+				} else {
+					head = f;
+				}
+				while (AST_LIST_NEXT(f, frame_list)) {
+					f = AST_LIST_NEXT(f, frame_list);
+				}
+				tail = f;
+			}
+		}
+		if (!more) {
+			return head ? head : &ast_null_frame;
+		}
+	}
+}
+#else
+static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	return ast_rtp_read_one(instance, rtcp);
+}
+#endif
+
 static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
@@ -5444,6 +6060,7 @@ static int rtp_reload(int reload)
 	dtmftimeout = DEFAULT_DTMF_TIMEOUT;
 	strictrtp = DEFAULT_STRICT_RTP;
 	learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL;
+	rtpstatsshm = 0;
 
 	/** This resource is not "reloaded" so much as unloaded and loaded again.
 	 * In the case of the TURN related variables, the memory referenced by a
@@ -5510,6 +6127,9 @@ static int rtp_reload(int reload)
 		if ((s = ast_variable_retrieve(cfg, "general", "strictrtp"))) {
 			strictrtp = ast_true(s);
 		}
+		if ((s = ast_variable_retrieve(cfg, "general", "rtpstatsshm"))) {
+			rtpstatsshm = ast_true(s);
+		}
 		if ((s = ast_variable_retrieve(cfg, "general", "probation"))) {
 			if ((sscanf(s, "%d", &learning_min_sequential) <= 0) || learning_min_sequential <= 0) {
 				ast_log(LOG_WARNING, "Value for 'probation' could not be read, using default of '%d' instead\n",
@@ -5602,6 +6222,9 @@ static int rtp_reload(int reload)
 		rtpend = DEFAULT_RTP_END;
 	}
 	ast_verb(2, "RTP Allocating from port range %d -> %d\n", rtpstart, rtpend);
+	if (rtpstatsshm) {
+		rtp_stats_shm_create();
+	}
 	return 0;
 }
 
@@ -5694,6 +6317,8 @@ static int unload_module(void)
 	ast_rtp_engine_unregister(&asterisk_rtp_engine);
 	ast_cli_unregister_multiple(cli_rtp, ARRAY_LEN(cli_rtp));
 
+	rtp_stats_shm_destroy();
+
 #ifdef HAVE_PJPROJECT
 	host_candidate_overrides_clear();
 	pj_thread_register_check();
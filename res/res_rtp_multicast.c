@@ -93,15 +93,20 @@ struct multicast_rtp {
 	unsigned int ssrc;
 	/*! Sequence number, used when creating/sending the RTP packet */
 	uint16_t seqno;
-	unsigned int lastts;	
+	/*! Additional unicast destinations the encoded packet is fanned out to */
+	struct ast_sockaddr *fanout;
+	/*! Number of fanout destinations */
+	size_t fanout_count;
+	unsigned int lastts;
 	struct timeval txcore;
 };
 
 enum {
-	OPT_CODEC = (1 << 0),
-	OPT_LOOP =  (1 << 1),
-	OPT_TTL =   (1 << 2),
-	OPT_IF =    (1 << 3),
+	OPT_CODEC =  (1 << 0),
+	OPT_LOOP =   (1 << 1),
+	OPT_TTL =    (1 << 2),
+	OPT_IF =     (1 << 3),
+	OPT_FANOUT = (1 << 4),
 };
 
 enum {
@@ -109,6 +114,7 @@ enum {
 	OPT_ARG_LOOP,
 	OPT_ARG_TTL,
 	OPT_ARG_IF,
+	OPT_ARG_FANOUT,
 	OPT_ARG_ARRAY_SIZE,
 };
 
@@ -121,6 +127,8 @@ AST_APP_OPTIONS(multicast_rtp_options, BEGIN_OPTIONS
 	AST_APP_OPTION_ARG('t', OPT_TTL, OPT_ARG_TTL),
 	/*! Set the interface from which multicast RTP is sent */
 	AST_APP_OPTION_ARG('i', OPT_IF, OPT_ARG_IF),
+	/*! Additional '^' separated host:port destinations to fan the stream out to */
+	AST_APP_OPTION_ARG('d', OPT_FANOUT, OPT_ARG_FANOUT),
 END_OPTIONS );
 
 struct ast_multicast_rtp_options {
@@ -308,6 +316,41 @@ static int multicast_rtp_new(struct ast_rtp_instance *instance, struct ast_sched
 		set_if(multicast->socket, mcast_options->opt_args[OPT_ARG_IF]);
 	}
 
+	if (ast_test_flag(&mcast_options->opts, OPT_FANOUT)
+		&& !ast_strlen_zero(mcast_options->opt_args[OPT_ARG_FANOUT])) {
+		char *addrs = ast_strdupa(mcast_options->opt_args[OPT_ARG_FANOUT]);
+		char *addr;
+		char *pos;
+		size_t count = 1;
+
+		/* The dialplan splits dial strings on '&' and application
+		 * arguments on ',' so the destination list uses '^', the same
+		 * nested separator the dial options use. */
+		for (pos = addrs; *pos; pos++) {
+			if (*pos == '^') {
+				count++;
+			}
+		}
+
+		multicast->fanout = ast_calloc(count, sizeof(*multicast->fanout));
+		if (!multicast->fanout) {
+			close(multicast->socket);
+			ast_free(multicast);
+			return -1;
+		}
+
+		while ((addr = strsep(&addrs, "^"))) {
+			if (ast_strlen_zero(addr)) {
+				continue;
+			}
+			if (!ast_sockaddr_parse(&multicast->fanout[multicast->fanout_count], addr, PARSE_PORT_REQUIRE)) {
+				ast_log(LOG_WARNING, "Fanout destination '%s' could not be parsed, skipping it\n", addr);
+				continue;
+			}
+			multicast->fanout_count++;
+		}
+	}
+
 	multicast->ssrc = ast_random();
 
 	ast_rtp_instance_set_data(instance, multicast);
@@ -397,11 +440,78 @@ static int multicast_rtp_destroy(struct ast_rtp_instance *instance)
 
 	close(multicast->socket);
 
+	ast_free(multicast->fanout);
 	ast_free(multicast);
 
 	return 0;
 }
 
+/*!
+ * \brief Send one encoded packet to the primary and every fanout destination
+ *
+ * The packet, RTP header included, is identical for every receiver; only the
+ * UDP destination differs. On Linux the whole set is handed to the kernel in
+ * a single sendmmsg() batch sharing one payload buffer, elsewhere it falls
+ * back to one sendto() per destination. Either way the codec pass is paid
+ * once regardless of how many receivers are being paged.
+ */
+static int multicast_rtp_fanout(struct multicast_rtp *multicast, void *packet, size_t len,
+	struct ast_sockaddr *remote_address)
+{
+	int res = 0;
+	size_t i;
+#ifdef __linux__
+	unsigned int total = multicast->fanout_count + 1;
+	unsigned int sent = 0;
+	struct mmsghdr *msgs = ast_alloca(total * sizeof(*msgs));
+	struct iovec iov = {
+		.iov_base = packet,
+		.iov_len = len,
+	};
+
+	memset(msgs, 0, total * sizeof(*msgs));
+	msgs[0].msg_hdr.msg_name = &remote_address->ss;
+	msgs[0].msg_hdr.msg_namelen = remote_address->len;
+	msgs[0].msg_hdr.msg_iov = &iov;
+	msgs[0].msg_hdr.msg_iovlen = 1;
+	for (i = 0; i < multicast->fanout_count; i++) {
+		msgs[i + 1].msg_hdr.msg_name = &multicast->fanout[i].ss;
+		msgs[i + 1].msg_hdr.msg_namelen = multicast->fanout[i].len;
+		msgs[i + 1].msg_hdr.msg_iov = &iov;
+		msgs[i + 1].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < total) {
+		int batch = sendmmsg(multicast->socket, msgs + sent, total - sent, 0);
+
+		if (batch < 0) {
+			ast_log(LOG_ERROR, "Multicast RTP fanout transmission error: %s\n",
+				strerror(errno));
+			res = -1;
+			break;
+		}
+		sent += batch;
+	}
+#else
+	if (ast_sendto(multicast->socket, packet, len, 0, remote_address) < 0) {
+		ast_log(LOG_ERROR, "Multicast RTP Transmission error to %s: %s\n",
+			ast_sockaddr_stringify(remote_address),
+			strerror(errno));
+		res = -1;
+	}
+	for (i = 0; i < multicast->fanout_count; i++) {
+		if (ast_sendto(multicast->socket, packet, len, 0, &multicast->fanout[i]) < 0) {
+			ast_log(LOG_ERROR, "Multicast RTP Transmission error to %s: %s\n",
+				ast_sockaddr_stringify(&multicast->fanout[i]),
+				strerror(errno));
+			res = -1;
+		}
+	}
+#endif
+
+	return res;
+}
+
 /*! \brief Function called to broadcast some audio on a multicast instance */
 static int multicast_rtp_write(struct ast_rtp_instance *instance, struct ast_frame *frame)
 {
@@ -451,7 +561,9 @@ static int multicast_rtp_write(struct ast_rtp_instance *instance, struct ast_fra
 	/* Finally send it out to the eager phones listening for us */
 	ast_rtp_instance_get_remote_address(instance, &remote_address);
 
-	if (ast_sendto(multicast->socket, (void *) rtpheader, f->datalen + hdrlen, 0, &remote_address) < 0) {
+	if (multicast->fanout_count) {
+		res = multicast_rtp_fanout(multicast, rtpheader, f->datalen + hdrlen, &remote_address);
+	} else if (ast_sendto(multicast->socket, (void *) rtpheader, f->datalen + hdrlen, 0, &remote_address) < 0) {
 		ast_log(LOG_ERROR, "Multicast RTP Transmission error to %s: %s\n",
 			ast_sockaddr_stringify(&remote_address),
 			strerror(errno));
@@ -97,6 +97,128 @@ static struct ast_sorcery_wizard config_object_wizard = {
 	.close = sorcery_config_close,
 };
 
+/*! \brief Structure for a configuration file parse shared between object types */
+struct shared_config_file {
+	/*! \brief Linked list information */
+	AST_LIST_ENTRY(shared_config_file) entry;
+
+	/*! \brief The parsed configuration, NULL when the file was found unchanged */
+	struct ast_config *cfg;
+
+	/*! \brief Filename of the configuration file */
+	char filename[];
+};
+
+/*!
+ * \brief Parses shared between object types during an instance wide load
+ *
+ * Several object types are commonly mapped to the same configuration file, so
+ * during an instance wide load or reload the first object type to parse a file
+ * places the parsed tree here and the remaining object types consume it
+ * instead of re-parsing the file. The list is emptied once every in-progress
+ * instance load has finished.
+ */
+static AST_LIST_HEAD_STATIC(shared_config_files, shared_config_file);
+
+/*! \brief Number of sorcery instances currently inside a load or reload */
+static unsigned int shared_config_loading;
+
+/*! \brief Internal function which empties the shared parse cache, must be called with the list locked */
+static void shared_config_flush(void)
+{
+	struct shared_config_file *shared;
+
+	while ((shared = AST_LIST_REMOVE_HEAD(&shared_config_files, entry))) {
+		if (shared->cfg) {
+			ast_config_destroy(shared->cfg);
+		}
+		ast_free(shared);
+	}
+}
+
+/*! \brief Internal function which finds a shared parse, must be called with the list locked */
+static struct shared_config_file *shared_config_find(const char *filename)
+{
+	struct shared_config_file *shared;
+
+	AST_LIST_TRAVERSE(&shared_config_files, shared, entry) {
+		if (!strcmp(shared->filename, filename)) {
+			return shared;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Internal function which hands back a configuration tree after use
+ *
+ * A tree which was parsed by this object type during an instance wide load is
+ * published for the remaining object types mapped to the same file, otherwise
+ * it is destroyed. A tree which came from the shared cache is owned by the
+ * cache and left alone. A NULL tree publishes an unchanged verdict so the
+ * remaining object types can skip their own freshness check.
+ */
+static void shared_config_finish(struct shared_config_file *shared, const char *filename, struct ast_config *cfg)
+{
+	if (shared) {
+		return;
+	}
+
+	AST_LIST_LOCK(&shared_config_files);
+	if (!shared_config_loading || shared_config_find(filename)) {
+		AST_LIST_UNLOCK(&shared_config_files);
+		if (cfg) {
+			ast_config_destroy(cfg);
+		}
+		return;
+	}
+
+	shared = ast_calloc(1, sizeof(*shared) + strlen(filename) + 1);
+	if (!shared) {
+		AST_LIST_UNLOCK(&shared_config_files);
+		if (cfg) {
+			ast_config_destroy(cfg);
+		}
+		return;
+	}
+
+	shared->cfg = cfg;
+	strcpy(shared->filename, filename); /* Safe */
+	AST_LIST_INSERT_TAIL(&shared_config_files, shared, entry);
+	AST_LIST_UNLOCK(&shared_config_files);
+}
+
+static void shared_config_instance_loading(const char *name, const struct ast_sorcery *sorcery, int reloaded)
+{
+	AST_LIST_LOCK(&shared_config_files);
+	shared_config_loading++;
+	AST_LIST_UNLOCK(&shared_config_files);
+}
+
+static void shared_config_instance_loaded(const char *name, const struct ast_sorcery *sorcery, int reloaded)
+{
+	AST_LIST_LOCK(&shared_config_files);
+	if (shared_config_loading && !--shared_config_loading) {
+		shared_config_flush();
+	}
+	AST_LIST_UNLOCK(&shared_config_files);
+}
+
+static const struct ast_sorcery_instance_observer shared_config_instance_observer = {
+	.instance_loading = shared_config_instance_loading,
+	.instance_loaded = shared_config_instance_loaded,
+};
+
+static void shared_config_instance_created(const char *name, struct ast_sorcery *sorcery)
+{
+	ast_sorcery_instance_observer_add(sorcery, &shared_config_instance_observer);
+}
+
+static const struct ast_sorcery_global_observer shared_config_global_observer = {
+	.instance_created = shared_config_instance_created,
+};
+
 /*! \brief Destructor function for sorcery config */
 static void sorcery_config_destructor(void *obj)
 {
@@ -218,21 +340,48 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 {
 	struct sorcery_config *config = data;
 	struct ast_flags flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
-	struct ast_config *cfg = ast_config_load2(config->filename, config->uuid, flags);
+	struct ast_config *cfg;
+	struct shared_config_file *shared;
 	struct ast_category *category = NULL;
 	RAII_VAR(struct ao2_container *, objects, NULL, ao2_cleanup);
 	const char *id = NULL;
 	unsigned int buckets = 0;
 
-	if (!cfg) {
-		ast_log(LOG_ERROR, "Unable to load config file '%s'\n", config->filename);
-		return;
-	} else if (cfg == CONFIG_STATUS_FILEUNCHANGED) {
-		ast_debug(1, "Config file '%s' was unchanged\n", config->filename);
-		return;
-	} else if (cfg == CONFIG_STATUS_FILEINVALID) {
-		ast_log(LOG_ERROR, "Contents of config file '%s' are invalid and cannot be parsed\n", config->filename);
-		return;
+	AST_LIST_LOCK(&shared_config_files);
+	shared = shared_config_loading ? shared_config_find(config->filename) : NULL;
+	if (shared && !shared->cfg && !reload) {
+		/* Another object type found the file unchanged but this type is
+		 * performing an initial load, so it needs the actual tree. */
+		shared = NULL;
+	}
+	AST_LIST_UNLOCK(&shared_config_files);
+
+	if (shared) {
+		if (!shared->cfg) {
+			ast_debug(1, "Config file '%s' was unchanged\n", config->filename);
+			return;
+		}
+
+		/* Shared entries are immutable and only freed once every instance
+		 * load which could have produced them has finished, so the tree
+		 * remains valid for the duration of this use. */
+		cfg = shared->cfg;
+		ast_debug(2, "Reusing shared parse of config file '%s' for objects of type '%s'\n",
+			config->filename, type);
+	} else {
+		cfg = ast_config_load2(config->filename, config->uuid, flags);
+
+		if (!cfg) {
+			ast_log(LOG_ERROR, "Unable to load config file '%s'\n", config->filename);
+			return;
+		} else if (cfg == CONFIG_STATUS_FILEUNCHANGED) {
+			ast_debug(1, "Config file '%s' was unchanged\n", config->filename);
+			shared_config_finish(NULL, config->filename, NULL);
+			return;
+		} else if (cfg == CONFIG_STATUS_FILEINVALID) {
+			ast_log(LOG_ERROR, "Contents of config file '%s' are invalid and cannot be parsed\n", config->filename);
+			return;
+		}
 	}
 
 	if (!config->buckets) {
@@ -269,7 +418,7 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 	if (!objects) {
 		ast_log(LOG_ERROR, "Could not create bucket for new objects from '%s', keeping existing objects\n",
 			config->filename);
-		ast_config_destroy(cfg);
+		shared_config_finish(shared, config->filename, cfg);
 		return;
 	}
 
@@ -289,7 +438,7 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 		if (obj) {
 			ast_log(LOG_ERROR, "Config file '%s' could not be loaded; configuration contains a duplicate object: '%s' of type '%s'\n",
 				config->filename, id, type);
-			ast_config_destroy(cfg);
+			shared_config_finish(shared, config->filename, cfg);
 			return;
 		}
 
@@ -299,7 +448,7 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 			if (config->file_integrity) {
 				ast_log(LOG_ERROR, "Config file '%s' could not be loaded due to error with object '%s' of type '%s'\n",
 					config->filename, id, type);
-				ast_config_destroy(cfg);
+				shared_config_finish(shared, config->filename, cfg);
 				return;
 			} else {
 				ast_log(LOG_ERROR, "Could not create an object of type '%s' with id '%s' from configuration file '%s'\n",
@@ -320,7 +469,7 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 	}
 
 	ao2_global_obj_replace_unref(config->objects, objects);
-	ast_config_destroy(cfg);
+	shared_config_finish(shared, config->filename, cfg);
 }
 
 static void sorcery_config_load(void *data, const struct ast_sorcery *sorcery, const char *type)
@@ -408,12 +557,20 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	ast_sorcery_global_observer_add(&shared_config_global_observer);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
+	ast_sorcery_global_observer_remove(&shared_config_global_observer);
 	ast_sorcery_wizard_unregister(&config_object_wizard);
+
+	AST_LIST_LOCK(&shared_config_files);
+	shared_config_flush();
+	AST_LIST_UNLOCK(&shared_config_files);
+
 	return 0;
 }
 
@@ -192,6 +192,8 @@ static void sorcery_memory_cache_load(void *data, const struct ast_sorcery *sorc
 static void sorcery_memory_cache_reload(void *data, const struct ast_sorcery *sorcery, const char *type);
 static void *sorcery_memory_cache_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type,
 	const char *id);
+static void sorcery_memory_cache_retrieve_multiple_id(const struct ast_sorcery *sorcery, void *data, const char *type,
+	struct ao2_container *objects, const char * const *ids, size_t num_ids);
 static void *sorcery_memory_cache_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type,
 	const struct ast_variable *fields);
 static void sorcery_memory_cache_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type,
@@ -210,6 +212,7 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 	.load = sorcery_memory_cache_load,
 	.reload = sorcery_memory_cache_reload,
 	.retrieve_id = sorcery_memory_cache_retrieve_id,
+	.retrieve_multiple_id = sorcery_memory_cache_retrieve_multiple_id,
 	.retrieve_fields = sorcery_memory_cache_retrieve_fields,
 	.retrieve_multiple = sorcery_memory_cache_retrieve_multiple,
 	.retrieve_regex = sorcery_memory_cache_retrieve_regex,
@@ -1230,6 +1233,63 @@ static void *sorcery_memory_cache_retrieve_id(const struct ast_sorcery *sorcery,
 	return object;
 }
 
+/*!
+ * \internal
+ * \brief Callback function to retrieve multiple objects by id from a memory cache
+ *
+ * Cached objects are provided under a single container lock acquisition
+ * instead of one per identifier. Identifiers not present in the cache are
+ * simply not added to the container, leaving them for later wizards.
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the objects to retrieve
+ * \param objects Container to place the objects into
+ * \param ids Array of object identifiers to retrieve
+ * \param num_ids Number of identifiers in the array
+ */
+static void sorcery_memory_cache_retrieve_multiple_id(const struct ast_sorcery *sorcery, void *data, const char *type,
+	struct ao2_container *objects, const char * const *ids, size_t num_ids)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cached_object **found;
+	size_t num_found = 0;
+	size_t i;
+
+	if (is_passthru_update()) {
+		return;
+	}
+
+	memory_cache_full_update(sorcery, type, cache);
+
+	found = ast_malloc(num_ids * sizeof(*found));
+	if (!found) {
+		return;
+	}
+
+	ao2_rdlock(cache->objects);
+	for (i = 0; i < num_ids; i++) {
+		struct sorcery_memory_cached_object *cached;
+
+		cached = ao2_find(cache->objects, ids[i], OBJ_SEARCH_KEY | OBJ_NOLOCK);
+		if (cached) {
+			found[num_found++] = cached;
+		}
+	}
+	ao2_unlock(cache->objects);
+
+	/* The stale checks are done outside of the container lock as a stale full
+	 * backend cache is refreshed under the container write lock.
+	 */
+	for (i = 0; i < num_found; i++) {
+		memory_cache_stale_check_object(sorcery, cache, found[i]);
+		ao2_link(objects, found[i]->object);
+		ao2_ref(found[i], -1);
+	}
+
+	ast_free(found);
+}
+
 /*!
  * \internal
  * \brief AO2 callback function for comparing a retrieval request and finding applicable objects
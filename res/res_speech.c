@@ -117,6 +117,128 @@ int ast_speech_results_free(struct ast_speech_result *result)
 	return res;
 }
 
+/*! \brief Most audio allowed to sit in a session's queue before new audio is dropped */
+#define SPEECH_MAX_QUEUED_AUDIO (64 * 1024)
+
+/*! \brief One chunk of audio buffered for the engine */
+struct ast_speech_audio_chunk {
+	AST_LIST_ENTRY(ast_speech_audio_chunk) list;
+	int len;
+	char data[0];
+};
+
+/*!
+ * \brief Audio buffered between the channel thread and the engine.
+ *
+ * Recognition engines can take longer to digest a frame of audio than the
+ * frame lasts, and with the engine being fed from the channel thread that
+ * time came straight out of the channel's audio servicing.  Instead each
+ * speech session gets a worker thread: ast_speech_write() only copies the
+ * frame onto this queue, and the worker feeds the engine at whatever pace
+ * the engine manages.  The engine raises results exactly as before - by
+ * setting flags and state on the speech structure under its lock, which
+ * the application polls - so applications see partial and final results
+ * without knowing the writes were handed off.
+ */
+struct ast_speech_audio_queue {
+	ast_mutex_t lock;
+	ast_cond_t wakeup;
+	pthread_t thread;
+	/*! Tells the worker to exit once set */
+	unsigned int stop:1;
+	/*! Bytes currently buffered */
+	int queued;
+	AST_LIST_HEAD_NOLOCK(, ast_speech_audio_chunk) chunks;
+};
+
+static void *speech_audio_queue_thread(void *data)
+{
+	struct ast_speech *speech = data;
+	struct ast_speech_audio_queue *queue = speech->queue;
+
+	for (;;) {
+		struct ast_speech_audio_chunk *chunk;
+
+		ast_mutex_lock(&queue->lock);
+		while (!(chunk = AST_LIST_REMOVE_HEAD(&queue->chunks, list))) {
+			if (queue->stop) {
+				ast_mutex_unlock(&queue->lock);
+				return NULL;
+			}
+			ast_cond_wait(&queue->wakeup, &queue->lock);
+		}
+		queue->queued -= chunk->len;
+		ast_mutex_unlock(&queue->lock);
+
+		/* The engine sees the same environment as a direct write: the
+		 * speech structure locked and in the ready state */
+		ast_mutex_lock(&speech->lock);
+		if (speech->state == AST_SPEECH_STATE_READY) {
+			speech->engine->write(speech, chunk->data, chunk->len);
+		}
+		ast_mutex_unlock(&speech->lock);
+
+		ast_free(chunk);
+	}
+
+	return NULL;
+}
+
+/*! \brief Drop any audio buffered for the engine */
+static void speech_audio_queue_flush(struct ast_speech_audio_queue *queue)
+{
+	struct ast_speech_audio_chunk *chunk;
+
+	ast_mutex_lock(&queue->lock);
+	while ((chunk = AST_LIST_REMOVE_HEAD(&queue->chunks, list))) {
+		ast_free(chunk);
+	}
+	queue->queued = 0;
+	ast_mutex_unlock(&queue->lock);
+}
+
+/*! \brief Start the worker feeding the engine; without it writes stay synchronous */
+static void speech_audio_queue_create(struct ast_speech *speech)
+{
+	struct ast_speech_audio_queue *queue;
+
+	queue = ast_calloc(1, sizeof(*queue));
+	if (!queue) {
+		return;
+	}
+	ast_mutex_init(&queue->lock);
+	ast_cond_init(&queue->wakeup, NULL);
+	speech->queue = queue;
+
+	if (ast_pthread_create_background(&queue->thread, NULL, speech_audio_queue_thread, speech)) {
+		speech->queue = NULL;
+		ast_mutex_destroy(&queue->lock);
+		ast_cond_destroy(&queue->wakeup);
+		ast_free(queue);
+	}
+}
+
+static void speech_audio_queue_destroy(struct ast_speech *speech)
+{
+	struct ast_speech_audio_queue *queue = speech->queue;
+
+	if (!queue) {
+		return;
+	}
+
+	ast_mutex_lock(&queue->lock);
+	queue->stop = 1;
+	ast_cond_signal(&queue->wakeup);
+	ast_mutex_unlock(&queue->lock);
+	pthread_join(queue->thread, NULL);
+
+	speech_audio_queue_flush(queue);
+	ast_mutex_destroy(&queue->lock);
+	ast_cond_destroy(&queue->wakeup);
+	ast_free(queue);
+	speech->queue = NULL;
+}
+
 /*! \brief Start speech recognition on a speech structure */
 void ast_speech_start(struct ast_speech *speech)
 {
@@ -132,6 +254,11 @@ void ast_speech_start(struct ast_speech *speech)
 		speech->results = NULL;
 	}
 
+	/* Audio still buffered belongs to the previous utterance */
+	if (speech->queue) {
+		speech_audio_queue_flush(speech->queue);
+	}
+
 	/* If the engine needs to start stuff up, do it */
 	if (speech->engine->start)
 		speech->engine->start(speech);
@@ -142,11 +269,39 @@ void ast_speech_start(struct ast_speech *speech)
 /*! \brief Write in signed linear audio to be recognized */
 int ast_speech_write(struct ast_speech *speech, void *data, int len)
 {
+	struct ast_speech_audio_chunk *chunk;
+
 	/* Make sure the speech engine is ready to accept audio */
 	if (speech->state != AST_SPEECH_STATE_READY)
 		return -1;
 
-	return speech->engine->write(speech, data, len);
+	if (!speech->queue) {
+		return speech->engine->write(speech, data, len);
+	}
+
+	chunk = ast_malloc(sizeof(*chunk) + len);
+	if (!chunk) {
+		return -1;
+	}
+	chunk->len = len;
+	memcpy(chunk->data, data, len);
+
+	ast_mutex_lock(&speech->queue->lock);
+	if (speech->queue->queued + len > SPEECH_MAX_QUEUED_AUDIO) {
+		/* The engine has fallen behind by several seconds; feeding it
+		 * ever staler audio will not produce a usable result */
+		ast_mutex_unlock(&speech->queue->lock);
+		ast_free(chunk);
+		ast_debug(1, "Engine '%s' is not keeping up, dropping %d bytes of audio\n",
+			speech->engine->name, len);
+		return -1;
+	}
+	speech->queue->queued += len;
+	AST_LIST_INSERT_TAIL(&speech->queue->chunks, chunk, list);
+	ast_cond_signal(&speech->queue->wakeup);
+	ast_mutex_unlock(&speech->queue->lock);
+
+	return 0;
 }
 
 /*! \brief Signal to the engine that DTMF was received */
@@ -232,6 +387,12 @@ struct ast_speech *ast_speech_new(const char *engine_name, const struct ast_form
 		new_speech = NULL;
 	}
 
+	/* Put a worker between the audio source and the engine, so a slow
+	 * engine delays its own thread and not the channel's */
+	if (new_speech) {
+		speech_audio_queue_create(new_speech);
+	}
+
 	return new_speech;
 }
 
@@ -240,6 +401,9 @@ int ast_speech_destroy(struct ast_speech *speech)
 {
 	int res = 0;
 
+	/* Stop feeding the engine and wait out any write in progress */
+	speech_audio_queue_destroy(speech);
+
 	/* Call our engine so we are destroyed properly */
 	speech->engine->destroy(speech);
 
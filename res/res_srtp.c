@@ -52,8 +52,12 @@
 #include "asterisk/sdp_srtp.h"
 #include "asterisk/res_srtp.h"          /* for ast_srtp_cb, ast_srtp_suite, etc */
 #include "asterisk/rtp_engine.h"        /* for ast_rtp_engine_register_srtp, etc */
+#include "asterisk/threadstorage.h"     /* for AST_THREADSTORAGE, etc */
 #include "asterisk/utils.h"             /* for ast_free, ast_calloc */
 
+/*! Size of the scratch buffer packets are copied into for in-place protection */
+#define SRTP_LOCAL_BUF_LEN (8192 + AST_FRIENDLY_OFFSET)
+
 struct ast_srtp {
 	struct ast_rtp_instance *rtp;
 	struct ao2_container *policies;
@@ -61,10 +65,17 @@ struct ast_srtp {
 	const struct ast_srtp_cb *cb;
 	void *data;
 	int warned;
-	unsigned char buf[8192 + AST_FRIENDLY_OFFSET];
-	unsigned char rtcpbuf[8192 + AST_FRIENDLY_OFFSET];
 };
 
+/*!
+ * libsrtp only protects packets in place, so the packet is copied into a
+ * scratch buffer with room for the authentication trailer first.  The
+ * protected packet is consumed by the caller before it returns, so one
+ * buffer per thread is enough and keeps a warm buffer shared across every
+ * instance the thread services instead of dirtying per-instance storage.
+ */
+AST_THREADSTORAGE(srtp_loc_buf);
+
 struct ast_srtp_policy {
 	srtp_policy_t sp;
 };
@@ -359,7 +370,6 @@ static int ast_srtp_unprotect(struct ast_srtp *srtp, void *buf, int *len, int rt
 	int res = 0;
 	int i;
 	int retry = 0;
-	struct ast_rtp_instance_stats stats = {0,};
 
 tryagain:
 
@@ -370,6 +380,10 @@ tryagain:
 		}
 
 		if (srtp->cb && srtp->cb->no_ctx) {
+			/* Only initialized on this error path; it is too large to
+			 * zero on every packet. */
+			struct ast_rtp_instance_stats stats = {0,};
+
 			if (ast_rtp_instance_get_stats(srtp->rtp, &stats, AST_RTP_INSTANCE_STAT_REMOTE_SSRC)) {
 				break;
 			}
@@ -456,11 +470,13 @@ static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtc
 	int res;
 	unsigned char *localbuf;
 
-	if ((*len + SRTP_MAX_TRAILER_LEN) > sizeof(srtp->buf)) {
+	if ((*len + SRTP_MAX_TRAILER_LEN) > SRTP_LOCAL_BUF_LEN) {
+		return -1;
+	}
+
+	if (!(localbuf = ast_threadstorage_get(&srtp_loc_buf, SRTP_LOCAL_BUF_LEN))) {
 		return -1;
 	}
-	
-	localbuf = rtcp ? srtp->rtcpbuf : srtp->buf;
 
 	memcpy(localbuf, *buf, *len);
 
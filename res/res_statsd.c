@@ -45,6 +45,18 @@
 				<configOption name="add_newline">
 					<synopsis>Append a newline to every event. This is useful if you want to fake out a server using netcat (nc -lu 8125)</synopsis>
 				</configOption>
+				<configOption name="flush_interval" default="0">
+					<synopsis>Interval, in milliseconds, at which aggregated metrics are flushed to the server</synopsis>
+					<description><para>
+						When set to a positive value, counters, meters and gauges are
+						aggregated in memory - counters and meters summed, gauges tracked
+						to their latest value - and shipped as batched multi-metric
+						datagrams every interval, instead of one datagram per sample.
+						This keeps statsd traffic from scaling with call volume.  Sampled
+						and timer metrics are always sent immediately.  A value of 0
+						(the default) disables aggregation.
+						</para></description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -52,9 +64,13 @@
 
 #include "asterisk.h"
 
+#include <inttypes.h>
+
+#include "asterisk/astobj2.h"
 #include "asterisk/config_options.h"
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/sched.h"
 
 #define AST_API_MODULE
 #include "asterisk/statsd.h"
@@ -63,6 +79,12 @@
 
 #define MAX_PREFIX 40
 
+/*! Number of buckets for the metric aggregation container */
+#define METRIC_BUCKETS 127
+
+/*! Maximum size of a batched multi-metric datagram */
+#define METRIC_BATCH_SIZE 1400
+
 /*! Socket for sending statd messages */
 static int socket_fd = -1;
 
@@ -72,12 +94,39 @@ struct conf_global_options {
 	int enabled;
 	/*! Disabled by default, appends newlines to all messages when enabled. */
 	int add_newline;
+	/*! If positive, aggregate metrics and flush them on this interval (ms). */
+	unsigned int flush_interval;
 	/*! Statsd server address[:port]. */
 	struct ast_sockaddr statsd_server;
 	/*! Prefix to put on every stat. */
 	char prefix[MAX_PREFIX + 1];
 };
 
+/*! \brief An aggregated metric, keyed on (name, type) */
+struct metric_entry {
+	/*! Accumulated value for counters and meters */
+	intmax_t counter;
+	/*! Last absolute value seen for a gauge */
+	intmax_t gauge_base;
+	/*! Accumulated gauge deltas since the last absolute value */
+	intmax_t gauge_delta;
+	/*! Whether an absolute gauge value has been seen */
+	unsigned int has_base:1;
+	/*! The metric name, pointing into \c data */
+	char *name;
+	/*! The metric type, pointing into \c data */
+	char *type;
+	char data[0];
+};
+
+/*! \brief Aggregated metrics awaiting the next flush */
+static struct ao2_container *metrics;
+
+/*! \brief Scheduler running the periodic flush */
+static struct ast_sched_context *statsd_sched;
+
+static int flush_sched_id = -1;
+
 /*! \brief All configuration options for statsd client. */
 struct conf {
 	/*! The general section configuration options. */
@@ -95,6 +144,162 @@ static void conf_server(const struct conf *cfg, struct ast_sockaddr *addr)
 	}
 }
 
+static int metric_entry_hash(const void *obj, const int flags)
+{
+	const struct metric_entry *entry = obj;
+	return ast_str_hash(entry->name);
+}
+
+static int metric_entry_cmp(void *obj, void *arg, int flags)
+{
+	struct metric_entry *left = obj, *right = arg;
+	return strcmp(left->name, right->name) ? 0 :
+		strcmp(left->type, right->type) ? 0 :
+		CMP_MATCH;
+}
+
+/*!
+ * \brief Fold one sample into the aggregation container.
+ *
+ * Counters and meters are summed.  Gauges keep their latest absolute value,
+ * with any subsequent signed deltas accumulated on top of it, so a flush
+ * emits a single equivalent sample.
+ *
+ * \retval 0 the sample was aggregated and should not be sent
+ * \retval -1 the sample cannot be aggregated and must be sent immediately
+ */
+static int aggregate_metric(const char *metric_name, const char *metric_type,
+	const char *value)
+{
+	struct metric_entry *entry;
+	struct metric_entry search = {
+		.name = (char *) metric_name,
+		.type = (char *) metric_type,
+	};
+	intmax_t parsed;
+	char *end;
+	int is_delta;
+
+	if (strcmp(metric_type, AST_STATSD_COUNTER)
+		&& strcmp(metric_type, AST_STATSD_METER)
+		&& strcmp(metric_type, AST_STATSD_GAUGE)) {
+		return -1;
+	}
+
+	errno = 0;
+	parsed = strtoimax(value, &end, 10);
+	if (errno || end == value || *end) {
+		return -1;
+	}
+	is_delta = (value[0] == '+' || value[0] == '-');
+
+	ao2_lock(metrics);
+	entry = ao2_find(metrics, &search, OBJ_POINTER | OBJ_NOLOCK);
+	if (!entry) {
+		entry = ao2_alloc(sizeof(*entry) + strlen(metric_name) + strlen(metric_type) + 2, NULL);
+		if (!entry) {
+			ao2_unlock(metrics);
+			return -1;
+		}
+		entry->name = entry->data;
+		entry->type = entry->data + strlen(metric_name) + 1;
+		strcpy(entry->name, metric_name); /* SAFE */
+		strcpy(entry->type, metric_type); /* SAFE */
+		ao2_link_flags(metrics, entry, OBJ_NOLOCK);
+	}
+
+	if (!strcmp(metric_type, AST_STATSD_GAUGE)) {
+		if (is_delta) {
+			entry->gauge_delta += parsed;
+		} else {
+			entry->gauge_base = parsed;
+			entry->gauge_delta = 0;
+			entry->has_base = 1;
+		}
+	} else {
+		entry->counter += parsed;
+	}
+	ao2_unlock(metrics);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+/*! \brief Ship one batched datagram to the statsd server */
+static void send_batch(struct ast_str **batch, const struct conf *cfg,
+	const struct ast_sockaddr *statsd_server)
+{
+	if (!ast_str_strlen(*batch)) {
+		return;
+	}
+
+	if (cfg->global->add_newline) {
+		ast_str_append(batch, 0, "\n");
+	}
+
+	ast_debug(6, "Sending aggregated statistics to StatsD server\n");
+	ast_sendto(socket_fd, ast_str_buffer(*batch), ast_str_strlen(*batch), 0,
+		(struct ast_sockaddr *) statsd_server);
+	ast_str_reset(*batch);
+}
+
+/*! \brief Scheduler callback that flushes all aggregated metrics */
+static int flush_metrics(const void *data)
+{
+	RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
+	struct ao2_iterator iter;
+	struct metric_entry *entry;
+	struct ast_str *batch;
+	struct ast_str *line;
+	struct ast_sockaddr statsd_server;
+
+	if (!cfg || socket_fd == -1) {
+		return 0;
+	}
+	conf_server(cfg, &statsd_server);
+
+	batch = ast_str_create(METRIC_BATCH_SIZE);
+	line = ast_str_create(80);
+	if (!batch || !line) {
+		ast_free(batch);
+		ast_free(line);
+		return cfg->global->flush_interval;
+	}
+
+	iter = ao2_iterator_init(metrics, AO2_ITERATOR_UNLINK);
+	while ((entry = ao2_iterator_next(&iter))) {
+		const char *prefix = cfg->global->prefix;
+		const char *dot = ast_strlen_zero(prefix) ? "" : ".";
+
+		if (!strcmp(entry->type, AST_STATSD_GAUGE) && !entry->has_base) {
+			/* Nothing but deltas seen; emit the equivalent signed delta */
+			ast_str_set(&line, 0, "%s%s%s:%+jd|%s", prefix, dot,
+				entry->name, entry->gauge_delta, entry->type);
+		} else if (!strcmp(entry->type, AST_STATSD_GAUGE)) {
+			ast_str_set(&line, 0, "%s%s%s:%jd|%s", prefix, dot,
+				entry->name, entry->gauge_base + entry->gauge_delta, entry->type);
+		} else {
+			ast_str_set(&line, 0, "%s%s%s:%jd|%s", prefix, dot,
+				entry->name, entry->counter, entry->type);
+		}
+		ao2_ref(entry, -1);
+
+		if (ast_str_strlen(batch)
+			&& ast_str_strlen(batch) + ast_str_strlen(line) + 1 > METRIC_BATCH_SIZE) {
+			send_batch(&batch, cfg, &statsd_server);
+		}
+		ast_str_append(&batch, 0, "%s%s", ast_str_strlen(batch) ? "\n" : "",
+			ast_str_buffer(line));
+	}
+	ao2_iterator_destroy(&iter);
+
+	send_batch(&batch, cfg, &statsd_server);
+	ast_free(batch);
+	ast_free(line);
+
+	return cfg->global->flush_interval;
+}
+
 void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	const char *metric_type, const char *value, double sample_rate)
 {
@@ -117,6 +322,17 @@ void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	}
 
 	cfg = ao2_global_obj_ref(confs);
+
+	/* With aggregation enabled, fold the sample into the in-memory table
+	 * instead of paying for a syscall per sample; the flush timer ships
+	 * the combined result.  Sampled metrics keep their |@rate notation and
+	 * are sent immediately, as are types that cannot be merged. */
+	if (cfg->global->flush_interval && sample_rate >= 1.0
+		&& !aggregate_metric(metric_name, metric_type, value)) {
+		ao2_cleanup(cfg);
+		return;
+	}
+
 	conf_server(cfg, &statsd_server);
 
 	msg = ast_str_create(40);
@@ -303,6 +519,16 @@ static int statsd_init(void)
 	ast_debug(3, "  statsd server = %s.\n", server);
 	ast_debug(3, "  add newline = %s\n", AST_YESNO(cfg->global->add_newline));
 	ast_debug(3, "  prefix = %s\n", cfg->global->prefix);
+	ast_debug(3, "  flush interval = %u\n", cfg->global->flush_interval);
+
+	AST_SCHED_DEL(statsd_sched, flush_sched_id);
+	if (cfg->global->flush_interval) {
+		flush_sched_id = ast_sched_add(statsd_sched, cfg->global->flush_interval,
+			flush_metrics, NULL);
+		if (flush_sched_id < 0) {
+			return -1;
+		}
+	}
 
 	return 0;
 }
@@ -310,6 +536,9 @@ static int statsd_init(void)
 static void statsd_shutdown(void)
 {
 	ast_debug(3, "Shutting down statsd client.\n");
+	AST_SCHED_DEL(statsd_sched, flush_sched_id);
+	/* Get anything still aggregated out the door before the socket goes */
+	flush_metrics(NULL);
 	if (socket_fd != -1) {
 		close(socket_fd);
 		socket_fd = -1;
@@ -318,6 +547,22 @@ static void statsd_shutdown(void)
 
 static int load_module(void)
 {
+	metrics = ao2_container_alloc(METRIC_BUCKETS, metric_entry_hash, metric_entry_cmp);
+	if (!metrics) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	statsd_sched = ast_sched_context_create();
+	if (!statsd_sched || ast_sched_start_thread(statsd_sched)) {
+		if (statsd_sched) {
+			ast_sched_context_destroy(statsd_sched);
+			statsd_sched = NULL;
+		}
+		ao2_cleanup(metrics);
+		metrics = NULL;
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (aco_info_init(&cfg_info)) {
 		aco_info_destroy(&cfg_info);
 		return AST_MODULE_LOAD_DECLINE;
@@ -339,6 +584,10 @@ static int load_module(void)
 		"", OPT_CHAR_ARRAY_T, 0,
 		CHARFLDSET(struct conf_global_options, prefix));
 
+	aco_option_register(&cfg_info, "flush_interval", ACO_EXACT, global_options,
+		"0", OPT_UINT_T, 0,
+		FLDSET(struct conf_global_options, flush_interval));
+
 	if (aco_process_config(&cfg_info, 0)) {
 		aco_info_destroy(&cfg_info);
 		return AST_MODULE_LOAD_DECLINE;
@@ -358,6 +607,12 @@ static int load_module(void)
 static int unload_module(void)
 {
 	statsd_shutdown();
+	if (statsd_sched) {
+		ast_sched_context_destroy(statsd_sched);
+		statsd_sched = NULL;
+	}
+	ao2_cleanup(metrics);
+	metrics = NULL;
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(confs);
 	return 0;
@@ -0,0 +1,593 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2016, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ *
+ * \brief Multiplexed timerfd timing interface
+ *
+ * Unlike \ref res_timing_timerfd.c, which creates one kernel timer per
+ * timing handle, this module arms a single timerfd per distinct rate and
+ * fans the ticks out to per-handle eventfds from a dispatcher thread. With
+ * thousands of channels running at the same rate (20ms being dominant)
+ * this trades one kernel timer per channel for one per rate, avoiding the
+ * per-timer arm/disarm churn at the cost of a small amount of tick
+ * distribution latency.
+ *
+ * This module registers at a lower priority than res_timing_timerfd, so to
+ * use it res_timing_timerfd must be noloaded in modules.conf.
+ */
+
+/*** MODULEINFO
+	<depend>timerfd</depend>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include "asterisk/module.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/timing.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/logger.h"
+#include "asterisk/poll-compat.h"
+#include "asterisk/utils.h"
+
+static void *timing_funcs_handle;
+
+static void *timerfd_mux_timer_open(void);
+static void timerfd_mux_timer_close(void *data);
+static int timerfd_mux_timer_set_rate(void *data, unsigned int rate);
+static int timerfd_mux_timer_ack(void *data, unsigned int quantity);
+static int timerfd_mux_timer_enable_continuous(void *data);
+static int timerfd_mux_timer_disable_continuous(void *data);
+static enum ast_timer_event timerfd_mux_timer_get_event(void *data);
+static unsigned int timerfd_mux_timer_get_max_rate(void *data);
+static int timerfd_mux_timer_fd(void *data);
+
+static struct ast_timing_interface timerfd_mux_timing = {
+	.name = "timerfd_mux",
+	.priority = 150,
+	.timer_open = timerfd_mux_timer_open,
+	.timer_close = timerfd_mux_timer_close,
+	.timer_set_rate = timerfd_mux_timer_set_rate,
+	.timer_ack = timerfd_mux_timer_ack,
+	.timer_enable_continuous = timerfd_mux_timer_enable_continuous,
+	.timer_disable_continuous = timerfd_mux_timer_disable_continuous,
+	.timer_get_event = timerfd_mux_timer_get_event,
+	.timer_get_max_rate = timerfd_mux_timer_get_max_rate,
+	.timer_fd = timerfd_mux_timer_fd,
+};
+
+#define TIMERFD_MUX_MAX_RATE 1000
+
+/*! Few distinct rates are expected, so the container stays small */
+#define RATE_BUCKETS 11
+
+struct mux_timer;
+
+/*! \brief A shared kernel timer driving every handle at one rate */
+struct mux_rate {
+	/*! The shared timerfd for this rate */
+	int timer_fd;
+	/*! eventfd used to wake the dispatcher thread for shutdown */
+	int stop_fd;
+	/*! The dispatcher thread fanning ticks out to the timers */
+	pthread_t thread;
+	/*! The rate in ticks per second */
+	unsigned int rate;
+	/*! Timers being driven at this rate, protected by the mux_rate lock */
+	AST_LIST_HEAD_NOLOCK(, mux_timer) timers;
+};
+
+/*! \brief An individual timing handle */
+struct mux_timer {
+	/*! The per-handle eventfd handed out by timer_fd */
+	int efd;
+	/*! The shared rate source currently driving us, NULL when idle */
+	struct mux_rate *rate_source;
+	unsigned int is_continuous:1;
+	/*! Entry in the rate source's timer list */
+	AST_LIST_ENTRY(mux_timer) list;
+};
+
+/*! \brief Container of shared rate sources, keyed by rate */
+static struct ao2_container *mux_rates;
+
+static int mux_rate_hash(const void *obj, const int flags)
+{
+	const struct mux_rate *rate;
+	unsigned int key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = *(const unsigned int *) obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		rate = obj;
+		key = rate->rate;
+		break;
+	default:
+		ast_assert(0);
+		key = 0;
+		break;
+	}
+	return (int) key;
+}
+
+static int mux_rate_cmp(void *obj, void *arg, int flags)
+{
+	const struct mux_rate *left = obj;
+	const struct mux_rate *right = arg;
+	unsigned int rate;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		rate = *(const unsigned int *) arg;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		rate = right->rate;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return left->rate == rate ? CMP_MATCH | CMP_STOP : 0;
+}
+
+static void mux_rate_destructor(void *obj)
+{
+	struct mux_rate *rate = obj;
+
+	ast_assert(AST_LIST_EMPTY(&rate->timers));
+
+	if (rate->timer_fd > -1) {
+		close(rate->timer_fd);
+	}
+	if (rate->stop_fd > -1) {
+		close(rate->stop_fd);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Arm or disarm the shared timerfd
+ * \pre rate is locked
+ */
+static int mux_rate_arm(struct mux_rate *rate, int arm)
+{
+	struct itimerspec period = { { 0, }, };
+
+	if (arm) {
+		period.it_interval.tv_nsec = (long) (1000000000 / rate->rate);
+		period.it_value.tv_nsec = period.it_interval.tv_nsec;
+	}
+
+	return timerfd_settime(rate->timer_fd, 0, &period, NULL);
+}
+
+/*! \brief Dispatcher thread distributing ticks from the shared timerfd */
+static void *dispatch_ticks(void *data)
+{
+	struct mux_rate *rate = data;
+	struct pollfd fds[2] = {
+		{ .events = POLLIN, },
+		{ .events = POLLIN, },
+	};
+
+	fds[0].fd = rate->timer_fd;
+	fds[1].fd = rate->stop_fd;
+
+	for (;;) {
+		uint64_t expirations;
+		struct mux_timer *timer;
+
+		fds[0].revents = 0;
+		fds[1].revents = 0;
+
+		if (ast_poll(fds, ARRAY_LEN(fds), -1) < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			ast_log(LOG_ERROR, "Poll error on shared timerfd for rate %u: %s\n",
+				rate->rate, strerror(errno));
+			break;
+		}
+
+		if (fds[1].revents) {
+			/* Module shutdown */
+			break;
+		}
+
+		if (!fds[0].revents) {
+			continue;
+		}
+
+		if (read(rate->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			ast_log(LOG_ERROR, "Read error on shared timerfd for rate %u: %s\n",
+				rate->rate, strerror(errno));
+			break;
+		}
+
+		ao2_lock(rate);
+		AST_LIST_TRAVERSE(&rate->timers, timer, list) {
+			/* The eventfd accumulates the expiration count until the
+			 * handle acknowledges it, just as a private timerfd would. */
+			if (write(timer->efd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+				ast_log(LOG_ERROR, "Error distributing tick for rate %u: %s\n",
+					rate->rate, strerror(errno));
+			}
+		}
+		ao2_unlock(rate);
+	}
+
+	ao2_ref(rate, -1);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Get the shared rate source for a rate, creating it if necessary
+ * \return a reference to the rate source
+ */
+static struct mux_rate *mux_rate_get(unsigned int rate_value)
+{
+	struct mux_rate *rate;
+
+	ao2_lock(mux_rates);
+	rate = ao2_find(mux_rates, &rate_value, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (rate) {
+		ao2_unlock(mux_rates);
+		return rate;
+	}
+
+	rate = ao2_alloc(sizeof(*rate), mux_rate_destructor);
+	if (!rate) {
+		ao2_unlock(mux_rates);
+		return NULL;
+	}
+
+	rate->rate = rate_value;
+	rate->timer_fd = -1;
+	rate->stop_fd = -1;
+
+	if ((rate->timer_fd = timerfd_create(CLOCK_MONOTONIC, 0)) < 0
+		|| (rate->stop_fd = eventfd(0, EFD_NONBLOCK)) < 0) {
+		ast_log(LOG_ERROR, "Failed to create shared timer for rate %u: %s\n",
+			rate_value, strerror(errno));
+		ao2_unlock(mux_rates);
+		ao2_ref(rate, -1);
+		return NULL;
+	}
+
+	/* The dispatcher thread gets its own reference */
+	ao2_ref(rate, +1);
+	if (ast_pthread_create_background(&rate->thread, NULL, dispatch_ticks, rate)) {
+		ast_log(LOG_ERROR, "Failed to start dispatcher thread for rate %u\n", rate_value);
+		ao2_unlock(mux_rates);
+		ao2_ref(rate, -2);
+		return NULL;
+	}
+
+	ao2_link_flags(mux_rates, rate, OBJ_NOLOCK);
+	ao2_unlock(mux_rates);
+
+	return rate;
+}
+
+/*!
+ * \internal
+ * \brief Detach a timer from the rate source driving it
+ * \pre timer is locked
+ */
+static void mux_timer_detach(struct mux_timer *timer)
+{
+	struct mux_rate *rate = timer->rate_source;
+
+	if (!rate) {
+		return;
+	}
+
+	ao2_lock(rate);
+	AST_LIST_REMOVE(&rate->timers, timer, list);
+	if (AST_LIST_EMPTY(&rate->timers)) {
+		/* Nobody left at this rate, stop the kernel timer but keep the
+		 * rate source and its dispatcher around for the next subscriber. */
+		mux_rate_arm(rate, 0);
+	}
+	ao2_unlock(rate);
+
+	timer->rate_source = NULL;
+	ao2_ref(rate, -1);
+
+	/* Release the reference the rate source list held on us */
+	ao2_ref(timer, -1);
+}
+
+/*!
+ * \internal
+ * \brief Attach a timer to a rate source
+ * \pre timer is locked
+ * \note Steals the caller's reference to the rate source
+ */
+static void mux_timer_attach(struct mux_timer *timer, struct mux_rate *rate)
+{
+	ao2_lock(rate);
+	if (AST_LIST_EMPTY(&rate->timers)) {
+		mux_rate_arm(rate, 1);
+	}
+	/* The rate source list holds a reference on the timer */
+	ao2_ref(timer, +1);
+	AST_LIST_INSERT_TAIL(&rate->timers, timer, list);
+	ao2_unlock(rate);
+
+	timer->rate_source = rate;
+}
+
+static void mux_timer_destructor(void *obj)
+{
+	struct mux_timer *timer = obj;
+
+	ast_assert(timer->rate_source == NULL);
+
+	if (timer->efd > -1) {
+		close(timer->efd);
+	}
+}
+
+static void *timerfd_mux_timer_open(void)
+{
+	struct mux_timer *timer;
+
+	if (!(timer = ao2_alloc(sizeof(*timer), mux_timer_destructor))) {
+		ast_log(LOG_ERROR, "Could not allocate memory for mux_timer structure\n");
+		return NULL;
+	}
+	if ((timer->efd = eventfd(0, EFD_NONBLOCK)) < 0) {
+		ast_log(LOG_ERROR, "Failed to create timer eventfd: %s\n", strerror(errno));
+		ao2_ref(timer, -1);
+		return NULL;
+	}
+
+	return timer;
+}
+
+static void timerfd_mux_timer_close(void *data)
+{
+	struct mux_timer *timer = data;
+
+	ao2_lock(timer);
+	mux_timer_detach(timer);
+	ao2_unlock(timer);
+
+	ao2_ref(timer, -1);
+}
+
+static int timerfd_mux_timer_set_rate(void *data, unsigned int rate)
+{
+	struct mux_timer *timer = data;
+	struct mux_rate *rate_source = NULL;
+
+	if (rate && !(rate_source = mux_rate_get(rate))) {
+		return -1;
+	}
+
+	ao2_lock(timer);
+
+	if (timer->rate_source == rate_source) {
+		/* Unchanged rate, nothing to do */
+		ao2_unlock(timer);
+		ao2_cleanup(rate_source);
+		return 0;
+	}
+
+	mux_timer_detach(timer);
+	if (rate_source) {
+		mux_timer_attach(timer, rate_source);
+	}
+
+	ao2_unlock(timer);
+
+	return 0;
+}
+
+static int timerfd_mux_timer_ack(void *data, unsigned int quantity)
+{
+	struct mux_timer *timer = data;
+	uint64_t expirations = 0;
+	int res = 0;
+
+	ao2_lock(timer);
+
+	if (read(timer->efd, &expirations, sizeof(expirations)) == -1) {
+		if (errno == EAGAIN) {
+			/* No unacknowledged ticks, nothing to consume */
+			expirations = 0;
+		} else {
+			ast_log(LOG_ERROR, "Read error: %s\n", strerror(errno));
+			res = -1;
+		}
+	}
+
+	if (timer->is_continuous) {
+		uint64_t continuous = 1;
+
+		/* Leave the eventfd readable so the handle keeps waking up */
+		if (write(timer->efd, &continuous, sizeof(continuous)) != sizeof(continuous)) {
+			ast_log(LOG_ERROR, "Error re-signaling continuous mode: %s\n", strerror(errno));
+			res = -1;
+		}
+	}
+
+	ao2_unlock(timer);
+
+	if (expirations != quantity) {
+		ast_debug(2, "Expected to acknowledge %u ticks but got %llu instead\n",
+			quantity, (unsigned long long) expirations);
+	}
+
+	return res;
+}
+
+static int timerfd_mux_timer_enable_continuous(void *data)
+{
+	struct mux_timer *timer = data;
+	uint64_t continuous = 1;
+	int res = 0;
+
+	ao2_lock(timer);
+
+	if (timer->is_continuous) {
+		/* It's already in continuous mode, no need to do
+		 * anything further
+		 */
+		ao2_unlock(timer);
+		return 0;
+	}
+
+	timer->is_continuous = 1;
+	if (write(timer->efd, &continuous, sizeof(continuous)) != sizeof(continuous)) {
+		ast_log(LOG_ERROR, "Error signaling continuous mode: %s\n", strerror(errno));
+		res = -1;
+	}
+
+	ao2_unlock(timer);
+
+	return res;
+}
+
+static int timerfd_mux_timer_disable_continuous(void *data)
+{
+	struct mux_timer *timer = data;
+	uint64_t expirations;
+
+	ao2_lock(timer);
+
+	if (!timer->is_continuous) {
+		/* No reason to do anything if we're not
+		 * in continuous mode
+		 */
+		ao2_unlock(timer);
+		return 0;
+	}
+
+	timer->is_continuous = 0;
+	/* Drain the eventfd so the handle stops waking up */
+	if (read(timer->efd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+		ast_log(LOG_ERROR, "Read error: %s\n", strerror(errno));
+	}
+
+	ao2_unlock(timer);
+
+	return 0;
+}
+
+static enum ast_timer_event timerfd_mux_timer_get_event(void *data)
+{
+	struct mux_timer *timer = data;
+	enum ast_timer_event res;
+
+	ao2_lock(timer);
+
+	if (timer->is_continuous) {
+		res = AST_TIMING_EVENT_CONTINUOUS;
+	} else {
+		res = AST_TIMING_EVENT_EXPIRED;
+	}
+
+	ao2_unlock(timer);
+
+	return res;
+}
+
+static unsigned int timerfd_mux_timer_get_max_rate(void *data)
+{
+	return TIMERFD_MUX_MAX_RATE;
+}
+
+static int timerfd_mux_timer_fd(void *data)
+{
+	struct mux_timer *timer = data;
+
+	return timer->efd;
+}
+
+/*! \brief Stop a rate source's dispatcher thread, used at unload */
+static int mux_rate_stop(void *obj, void *arg, int flags)
+{
+	struct mux_rate *rate = obj;
+	uint64_t stop = 1;
+
+	if (write(rate->stop_fd, &stop, sizeof(stop)) != sizeof(stop)) {
+		ast_log(LOG_ERROR, "Error stopping dispatcher thread for rate %u: %s\n",
+			rate->rate, strerror(errno));
+	}
+	pthread_join(rate->thread, NULL);
+
+	return CMP_MATCH;
+}
+
+static int load_module(void)
+{
+	int fd;
+
+	/* Make sure we support the necessary clock type */
+	if ((fd = timerfd_create(CLOCK_MONOTONIC, 0)) < 0) {
+		ast_log(LOG_ERROR, "timerfd_create() not supported by the kernel.  Not loading.\n");
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	close(fd);
+
+	if (!(mux_rates = ao2_container_alloc(RATE_BUCKETS, mux_rate_hash, mux_rate_cmp))) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if (!(timing_funcs_handle = ast_register_timing_interface(&timerfd_mux_timing))) {
+		ao2_ref(mux_rates, -1);
+		mux_rates = NULL;
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+static int unload_module(void)
+{
+	int res;
+
+	if (!(res = ast_unregister_timing_interface(timing_funcs_handle))) {
+		ao2_callback(mux_rates, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, mux_rate_stop, NULL);
+		ao2_ref(mux_rates, -1);
+		mux_rates = NULL;
+	}
+
+	return res;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "Multiplexed Timerfd Timing Interface",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.load_pri = AST_MODPRI_TIMING,
+);
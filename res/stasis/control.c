@@ -1305,16 +1305,36 @@ int control_dispatch_all(struct stasis_app_control *control,
 	int count = 0;
 	struct ao2_iterator iter;
 	struct stasis_app_command *command;
+	struct stasis_app_command *commands[16];
+	int batch;
+	int i;
 
 	ast_assert(control->channel == chan);
 
-	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
-	while ((command = ao2_iterator_next(&iter))) {
-		command_invoke(command, control, chan);
-		ao2_ref(command, -1);
-		++count;
-	}
-	ao2_iterator_destroy(&iter);
+	/* Unlinking through a plain iterator relocks the queue for every
+	 * command.  Drain in batches under a single lock acquisition so
+	 * ARI threads queueing more work contend with us once per batch
+	 * instead of once per command, then invoke with the queue lock
+	 * released. */
+	do {
+		batch = 0;
+
+		ao2_lock(control->command_queue);
+		iter = ao2_iterator_init(control->command_queue,
+			AO2_ITERATOR_UNLINK | AO2_ITERATOR_DONTLOCK);
+		while (batch < ARRAY_LEN(commands)
+			&& (command = ao2_iterator_next(&iter))) {
+			commands[batch++] = command;
+		}
+		ao2_iterator_destroy(&iter);
+		ao2_unlock(control->command_queue);
+
+		for (i = 0; i < batch; i++) {
+			command_invoke(commands[i], control, chan);
+			ao2_ref(commands[i], -1);
+		}
+		count += batch;
+	} while (batch == ARRAY_LEN(commands));
 
 	return count;
 }
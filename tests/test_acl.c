@@ -433,10 +433,145 @@ acl_cleanup:
 	return res;
 }
 
+static struct ast_acl_list *build_acl_list(const struct acl *rules, size_t len, const char *acl_name,
+	struct ast_test *test, enum ast_test_result_state *res)
+{
+	struct ast_acl_list *list = NULL;
+	size_t i;
+	int err = 0;
+
+	for (i = 0; i < len; ++i) {
+		ast_append_acl(rules[i].access, rules[i].host, &list, &err, NULL);
+		if (err) {
+			ast_test_status_update(test, "Failed to add rule %s with access %s to %s\n",
+				rules[i].host, rules[i].access, acl_name);
+			*res = AST_TEST_FAIL;
+			return ast_free_acl_list(list);
+		}
+	}
+
+	return list;
+}
+
+AST_TEST_DEFINE(compiled_acl)
+{
+	struct acl acl2[] = {
+		{ "10.0.0.0/8", "deny" },
+		{ "10.0.0.0/8", "permit" },
+		{ "10.0.0.0/16", "deny" },
+		{ "10.0.0.0/24", "permit" },
+	};
+
+	struct acl acl4[] = {
+		{ "::/0", "deny" },
+		{ "fe80::/64", "permit" },
+		{ "fe80::ffff:0:0:0/80", "deny" },
+		{ "fe80::ffff:0:ffff:0/112", "permit" },
+	};
+
+	/* The non-contiguous netmask cannot be compiled and exercises the
+	 * linear fallback within ast_apply_acl. */
+	struct acl aclnc[] = {
+		{ "10.0.0.0/255.0.255.0", "deny" },
+	};
+
+	struct {
+		const char *test_address;
+		int list2_result;
+		int list4_result;
+		int listnc_result;
+	} compiled_tests[] = {
+		{ "10.1.1.5",                  TACL_A, TACL_A, TACL_A },
+		{ "10.0.10.10",                TACL_D, TACL_A, TACL_A },
+		{ "10.0.0.5",                  TACL_A, TACL_A, TACL_D },
+		{ "10.1.0.1",                  TACL_A, TACL_A, TACL_D },
+		{ "1.2.3.4",                   TACL_A, TACL_A, TACL_A },
+		{ "fe80::ffff:1213:dead:beef", TACL_A, TACL_D, TACL_A },
+		{ "fe80::ffff:0:ffff:abcd",    TACL_A, TACL_A, TACL_A },
+	};
+
+	struct ast_acl_list *list2 = NULL;
+	struct ast_acl_list *list4 = NULL;
+	struct ast_acl_list *listnc = NULL;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int pass;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "compiled_acl";
+		info->category = "/main/acl/";
+		info->summary = "Compiled ACL unit test";
+		info->description =
+			"Tests that the compiled representation built by ast_apply_acl "
+			"matches hosts the same way the linear rule walk does, including "
+			"the fallback for netmasks that cannot be compiled";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(list2 = build_acl_list(acl2, ARRAY_LEN(acl2), "list2", test, &res))) {
+		goto compiled_acl_cleanup;
+	}
+
+	if (!(list4 = build_acl_list(acl4, ARRAY_LEN(acl4), "list4", test, &res))) {
+		goto compiled_acl_cleanup;
+	}
+
+	if (!(listnc = build_acl_list(aclnc, ARRAY_LEN(aclnc), "listnc", test, &res))) {
+		goto compiled_acl_cleanup;
+	}
+
+	/* The first pass compiles the lists, the second reuses the compiled form. */
+	for (pass = 0; pass < 2; ++pass) {
+		for (i = 0; i < ARRAY_LEN(compiled_tests); ++i) {
+			struct ast_sockaddr addr;
+			int list2_res;
+			int list4_res;
+			int listnc_res;
+
+			ast_sockaddr_parse(&addr, compiled_tests[i].test_address, PARSE_PORT_FORBID);
+
+			list2_res = ast_apply_acl(list2, &addr, NULL);
+			list4_res = ast_apply_acl(list4, &addr, NULL);
+			listnc_res = ast_apply_acl(listnc, &addr, NULL);
+
+			if (list2_res != compiled_tests[i].list2_result) {
+				ast_test_status_update(test, "Access not as expected to %s on list2 (pass %d). Expected %d but "
+						"got %d instead\n", compiled_tests[i].test_address, pass, compiled_tests[i].list2_result, list2_res);
+				res = AST_TEST_FAIL;
+				goto compiled_acl_cleanup;
+			}
+
+			if (list4_res != compiled_tests[i].list4_result) {
+				ast_test_status_update(test, "Access not as expected to %s on list4 (pass %d). Expected %d but "
+						"got %d instead\n", compiled_tests[i].test_address, pass, compiled_tests[i].list4_result, list4_res);
+				res = AST_TEST_FAIL;
+				goto compiled_acl_cleanup;
+			}
+
+			if (listnc_res != compiled_tests[i].listnc_result) {
+				ast_test_status_update(test, "Access not as expected to %s on listnc (pass %d). Expected %d but "
+						"got %d instead\n", compiled_tests[i].test_address, pass, compiled_tests[i].listnc_result, listnc_res);
+				res = AST_TEST_FAIL;
+				goto compiled_acl_cleanup;
+			}
+		}
+	}
+
+compiled_acl_cleanup:
+	list2 = ast_free_acl_list(list2);
+	list4 = ast_free_acl_list(list4);
+	listnc = ast_free_acl_list(listnc);
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(invalid_acl);
 	AST_TEST_UNREGISTER(acl);
+	AST_TEST_UNREGISTER(compiled_acl);
 	return 0;
 }
 
@@ -444,6 +579,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(invalid_acl);
 	AST_TEST_REGISTER(acl);
+	AST_TEST_REGISTER(compiled_acl);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
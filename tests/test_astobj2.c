@@ -418,7 +418,7 @@ static int test_ao2_find_w_OBJ_PARTIAL_KEY(int res, struct ao2_container *look_i
 	return res;
 }
 
-static int astobj2_test_1_helper(int tst_num, enum test_container_type type, int use_sort, unsigned int lim, struct ast_test *test)
+static int astobj2_test_1_helper(int tst_num, enum test_container_type type, int use_sort, unsigned int options, unsigned int lim, struct ast_test *test)
 {
 	const char *c_type;
 	struct ao2_container *c1;
@@ -441,18 +441,18 @@ static int astobj2_test_1_helper(int tst_num, enum test_container_type type, int
 	case TEST_CONTAINER_LIST:
 		/* Lists just have one bucket. */
 		n_buckets = 1;
-		c1 = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		c1 = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, options,
 			use_sort ? test_sort_cb : NULL, test_cmp_cb, "test");
 		break;
 	case TEST_CONTAINER_HASH:
 		n_buckets = (ast_random() % ((lim / 4) + 1)) + 1;
-		c1 = ao2_t_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, n_buckets,
+		c1 = ao2_t_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, options, n_buckets,
 			test_hash_cb, use_sort ? test_sort_cb : NULL, test_cmp_cb, "test");
 		break;
 	case TEST_CONTAINER_RBTREE:
 		/* RBTrees just have one bucket. */
 		n_buckets = 1;
-		c1 = ao2_t_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		c1 = ao2_t_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, options,
 			test_sort_cb, test_cmp_cb, "test");
 		break;
 	}
@@ -663,24 +663,39 @@ AST_TEST_DEFINE(astobj2_test_1)
 		break;
 	}
 
-	/* Test number, container_type, use_sort, number of objects. */
-	if ((res = astobj2_test_1_helper(1, TEST_CONTAINER_LIST, 0, 50, test)) == AST_TEST_FAIL) {
+	/* Test number, container_type, use_sort, container options, number of objects. */
+	if ((res = astobj2_test_1_helper(1, TEST_CONTAINER_LIST, 0, 0, 50, test)) == AST_TEST_FAIL) {
 		return res;
 	}
 
-	if ((res = astobj2_test_1_helper(2, TEST_CONTAINER_LIST, 1, 50, test)) == AST_TEST_FAIL) {
+	if ((res = astobj2_test_1_helper(2, TEST_CONTAINER_LIST, 1, 0, 50, test)) == AST_TEST_FAIL) {
 		return res;
 	}
 
-	if ((res = astobj2_test_1_helper(3, TEST_CONTAINER_HASH, 0, 1000, test)) == AST_TEST_FAIL) {
+	if ((res = astobj2_test_1_helper(3, TEST_CONTAINER_HASH, 0, 0, 1000, test)) == AST_TEST_FAIL) {
 		return res;
 	}
 
-	if ((res = astobj2_test_1_helper(4, TEST_CONTAINER_HASH, 1, 1000, test)) == AST_TEST_FAIL) {
+	if ((res = astobj2_test_1_helper(4, TEST_CONTAINER_HASH, 1, 0, 1000, test)) == AST_TEST_FAIL) {
 		return res;
 	}
 
-	if ((res = astobj2_test_1_helper(4, TEST_CONTAINER_RBTREE, 1, 1000, test)) == AST_TEST_FAIL) {
+	if ((res = astobj2_test_1_helper(4, TEST_CONTAINER_RBTREE, 1, 0, 1000, test)) == AST_TEST_FAIL) {
+		return res;
+	}
+
+	if ((res = astobj2_test_1_helper(5, TEST_CONTAINER_HASH, 0,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, 1000, test)) == AST_TEST_FAIL) {
+		return res;
+	}
+
+	if ((res = astobj2_test_1_helper(6, TEST_CONTAINER_HASH, 1,
+		AO2_CONTAINER_ALLOC_OPT_READ_MOSTLY, 1000, test)) == AST_TEST_FAIL) {
+		return res;
+	}
+
+	if ((res = astobj2_test_1_helper(7, TEST_CONTAINER_HASH, 0,
+		AO2_CONTAINER_ALLOC_OPT_OPEN_ADDRESSING, 1000, test)) == AST_TEST_FAIL) {
 		return res;
 	}
 
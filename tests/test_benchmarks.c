@@ -0,0 +1,532 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2018, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Microbenchmarks for hot core primitives
+ *
+ * Each test here measures a primitive rather than verifying behavior, so
+ * the whole file lives under the /benchmarks/ category and is skipped by
+ * category-scoped regression runs.  Run them all with
+ * 'test execute category /benchmarks/' or 'make benchmark'.
+ *
+ * Because most of these operations complete in well under a microsecond,
+ * every callback performs a fixed batch of BENCH_BATCH operations per
+ * timed invocation; the reported statistics are per batch.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/sched.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/translate.h"
+#include "asterisk/pbx.h"
+#include "asterisk/stasis.h"
+
+#define BENCH_CATEGORY "/benchmarks/"
+
+/*! \brief Operations performed per timed invocation */
+#define BENCH_BATCH 64
+
+/*! \brief Untimed invocations used to prime caches */
+#define BENCH_WARMUP 100
+
+/*! \brief Timed invocations per benchmark */
+#define BENCH_ITERATIONS 1000
+
+/*! \brief Number of objects populating the ao2 container */
+#define BENCH_AO2_OBJS 1024
+
+/*! \brief Number of extensions populating the benchmark context */
+#define BENCH_PBX_EXTENS 256
+
+static const char bench_registrar[] = "test_benchmarks";
+
+/*! \brief Cheap deterministic sequence so lookups don't hit one bucket */
+static unsigned int bench_rand(unsigned int *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return *seed >> 16;
+}
+
+struct bench_ao2_obj {
+	int key;
+};
+
+static int bench_ao2_hash_fn(const void *obj, const int flags)
+{
+	const struct bench_ao2_obj *ao2_obj;
+	const int *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		ao2_obj = obj;
+		key = &ao2_obj->key;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return *key;
+}
+
+static int bench_ao2_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct bench_ao2_obj *left = obj;
+	const struct bench_ao2_obj *right = arg;
+	const int *key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		key = &right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		return left->key == *key ? CMP_MATCH : 0;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+struct bench_ao2_state {
+	struct ao2_container *container;
+	unsigned int seed;
+};
+
+static void bench_ao2_find_run(void *data)
+{
+	struct bench_ao2_state *state = data;
+	int i;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		int key = bench_rand(&state->seed) % BENCH_AO2_OBJS;
+		struct bench_ao2_obj *obj;
+
+		obj = ao2_find(state->container, &key, OBJ_SEARCH_KEY);
+		ao2_cleanup(obj);
+	}
+}
+
+AST_TEST_DEFINE(bench_ao2_find)
+{
+	struct bench_ao2_state state = {
+		.seed = 42,
+	};
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "ao2_find";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark ao2 container lookup";
+		info->description = "Measures ao2_find() against a hash container "
+			"holding 1024 integer keyed objects.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	state.container = ao2_container_alloc(53, bench_ao2_hash_fn, bench_ao2_cmp_fn);
+	if (!state.container) {
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < BENCH_AO2_OBJS; i++) {
+		struct bench_ao2_obj *obj;
+
+		obj = ao2_alloc_options(sizeof(*obj), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!obj) {
+			ao2_ref(state.container, -1);
+			return AST_TEST_FAIL;
+		}
+		obj->key = i;
+		ao2_link(state.container, obj);
+		ao2_ref(obj, -1);
+	}
+
+	if (ast_test_benchmark(test, "ao2_find x64",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_ao2_find_run, &state)) {
+		ao2_ref(state.container, -1);
+		return AST_TEST_FAIL;
+	}
+
+	ao2_ref(state.container, -1);
+
+	return AST_TEST_PASS;
+}
+
+static int bench_sched_cb(const void *data)
+{
+	return 0;
+}
+
+struct bench_sched_state {
+	struct ast_sched_context *con;
+	unsigned int seed;
+};
+
+static void bench_sched_run(void *data)
+{
+	struct bench_sched_state *state = data;
+	int ids[BENCH_BATCH];
+	int i;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		ids[i] = ast_sched_add(state->con,
+			(int) (bench_rand(&state->seed) % 10000) + 1, bench_sched_cb, NULL);
+	}
+	for (i = 0; i < BENCH_BATCH; i++) {
+		if (ids[i] > -1) {
+			ast_sched_del(state->con, ids[i]);
+		}
+	}
+}
+
+AST_TEST_DEFINE(bench_sched_add_del)
+{
+	struct bench_sched_state state = {
+		.seed = 42,
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_add_del";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark scheduler entry add and delete";
+		info->description = "Measures ast_sched_add() and ast_sched_del() "
+			"pairs at pseudo random offsets within ten seconds.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	state.con = ast_sched_context_create();
+	if (!state.con) {
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_test_benchmark(test, "sched add+del x64",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_sched_run, &state)) {
+		ast_sched_context_destroy(state.con);
+		return AST_TEST_FAIL;
+	}
+
+	ast_sched_context_destroy(state.con);
+
+	return AST_TEST_PASS;
+}
+
+static void bench_frame_run(void *data)
+{
+	struct ast_frame *f = data;
+	int i;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		struct ast_frame *dup = ast_frdup(f);
+
+		if (dup) {
+			ast_frfree(dup);
+		}
+	}
+}
+
+AST_TEST_DEFINE(bench_frame_dup_free)
+{
+	short samples[160] = { 0, };
+	struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = ast_format_slin,
+		.data.ptr = samples,
+		.datalen = sizeof(samples),
+		.samples = ARRAY_LEN(samples),
+		.src = "test_benchmarks",
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "frame_dup_free";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark frame allocation and release";
+		info->description = "Measures ast_frdup() and ast_frfree() of a "
+			"20ms signed linear voice frame.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (ast_test_benchmark(test, "frdup+frfree x64",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_frame_run, &f)) {
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
+struct bench_translate_state {
+	struct ast_trans_pvt *path;
+	struct ast_frame *f;
+};
+
+static void bench_translate_run(void *data)
+{
+	struct bench_translate_state *state = data;
+	struct ast_frame *out;
+
+	out = ast_translate(state->path, state->f, 0);
+	if (out && out != state->f) {
+		ast_frfree(out);
+	}
+}
+
+AST_TEST_DEFINE(bench_translate_slin_ulaw)
+{
+	struct bench_translate_state state;
+	short samples[160] = { 0, };
+	struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = ast_format_slin,
+		.data.ptr = samples,
+		.datalen = sizeof(samples),
+		.samples = ARRAY_LEN(samples),
+		.src = "test_benchmarks",
+	};
+	int res;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "translate_slin_ulaw";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark the signed linear to ulaw translate path";
+		info->description = "Measures ast_translate() of a 20ms signed "
+			"linear voice frame to ulaw.  Not run when the translator "
+			"is unavailable.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	state.path = ast_translator_build_path(ast_format_ulaw, ast_format_slin);
+	if (!state.path) {
+		ast_test_status_update(test, "slin -> ulaw translator unavailable\n");
+		return AST_TEST_NOT_RUN;
+	}
+	state.f = &f;
+
+	res = ast_test_benchmark(test, "translate 20ms slin->ulaw",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_translate_run, &state);
+
+	ast_translator_free_path(state.path);
+
+	return res ? AST_TEST_FAIL : AST_TEST_PASS;
+}
+
+struct bench_pbx_state {
+	unsigned int seed;
+};
+
+static void bench_pbx_run(void *data)
+{
+	struct bench_pbx_state *state = data;
+	char exten[AST_MAX_EXTENSION];
+	int i;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		unsigned int num = bench_rand(&state->seed) % BENCH_PBX_EXTENS;
+
+		if (num & 1) {
+			/* Matches the _2XXXXXXX pattern */
+			snprintf(exten, sizeof(exten), "2%07u", num);
+		} else {
+			snprintf(exten, sizeof(exten), "1%07u", num);
+		}
+		ast_exists_extension(NULL, "test_benchmarks_pbx", exten, 1, NULL);
+	}
+}
+
+AST_TEST_DEFINE(bench_pbx_lookup)
+{
+	struct bench_pbx_state state = {
+		.seed = 42,
+	};
+	struct ast_context *con;
+	char exten[AST_MAX_EXTENSION];
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "pbx_lookup";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark dialplan extension lookup";
+		info->description = "Measures ast_exists_extension() against a "
+			"context holding 256 literal "
+			"extensions and one pattern, alternating between literal and "
+			"pattern matches.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	con = ast_context_find_or_create(NULL, NULL, "test_benchmarks_pbx", bench_registrar);
+	if (!con) {
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < BENCH_PBX_EXTENS; i++) {
+		snprintf(exten, sizeof(exten), "1%07d", i);
+		if (ast_add_extension2(con, 0, exten, 1, NULL, NULL,
+			"NoOp", NULL, NULL, bench_registrar)) {
+			ast_context_destroy(con, bench_registrar);
+			return AST_TEST_FAIL;
+		}
+	}
+	if (ast_add_extension2(con, 0, "_2XXXXXXX", 1, NULL, NULL,
+		"NoOp", NULL, NULL, bench_registrar)) {
+		ast_context_destroy(con, bench_registrar);
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_test_benchmark(test, "exists_extension x64",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_pbx_run, &state)) {
+		ast_context_destroy(con, bench_registrar);
+		return AST_TEST_FAIL;
+	}
+
+	ast_context_destroy(con, bench_registrar);
+
+	return AST_TEST_PASS;
+}
+
+static void bench_stasis_noop_cb(void *data, struct stasis_subscription *sub,
+	struct stasis_message *message)
+{
+}
+
+struct bench_stasis_state {
+	struct stasis_topic *topic;
+	struct stasis_message_type *type;
+	void *payload;
+};
+
+static void bench_stasis_run(void *data)
+{
+	struct bench_stasis_state *state = data;
+	int i;
+
+	for (i = 0; i < BENCH_BATCH; i++) {
+		struct stasis_message *msg;
+
+		msg = stasis_message_create(state->type, state->payload);
+		if (!msg) {
+			continue;
+		}
+		stasis_publish(state->topic, msg);
+		ao2_ref(msg, -1);
+	}
+}
+
+AST_TEST_DEFINE(bench_stasis_publish)
+{
+	struct bench_stasis_state state = {
+		.topic = NULL,
+	};
+	struct stasis_subscription *sub = NULL;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "stasis_publish";
+		info->category = BENCH_CATEGORY;
+		info->summary = "Benchmark stasis message creation and publish";
+		info->description = "Measures stasis_message_create() and "
+			"stasis_publish() to a topic with one subscriber.  Delivery "
+			"is asynchronous, so only the publish side is timed.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (stasis_message_type_create("BenchMessage", NULL, &state.type)
+		!= STASIS_MESSAGE_TYPE_SUCCESS) {
+		goto done;
+	}
+
+	state.payload = ao2_alloc_options(1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!state.payload) {
+		goto done;
+	}
+
+	state.topic = stasis_topic_create("test_benchmarks_topic");
+	if (!state.topic) {
+		goto done;
+	}
+
+	sub = stasis_subscribe(state.topic, bench_stasis_noop_cb, NULL);
+	if (!sub) {
+		goto done;
+	}
+
+	if (!ast_test_benchmark(test, "message create+publish x64",
+		BENCH_WARMUP, BENCH_ITERATIONS, bench_stasis_run, &state)) {
+		res = AST_TEST_PASS;
+	}
+
+done:
+	if (sub) {
+		stasis_unsubscribe_and_join(sub);
+	}
+	ao2_cleanup(state.topic);
+	ao2_cleanup(state.payload);
+	ao2_cleanup(state.type);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(bench_ao2_find);
+	AST_TEST_UNREGISTER(bench_sched_add_del);
+	AST_TEST_UNREGISTER(bench_frame_dup_free);
+	AST_TEST_UNREGISTER(bench_translate_slin_ulaw);
+	AST_TEST_UNREGISTER(bench_pbx_lookup);
+	AST_TEST_UNREGISTER(bench_stasis_publish);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(bench_ao2_find);
+	AST_TEST_REGISTER(bench_sched_add_del);
+	AST_TEST_REGISTER(bench_frame_dup_free);
+	AST_TEST_REGISTER(bench_translate_slin_ulaw);
+	AST_TEST_REGISTER(bench_pbx_lookup);
+	AST_TEST_REGISTER(bench_stasis_publish);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Core primitive microbenchmarks");
@@ -104,26 +104,13 @@ static int sched_order_8_cb(const void *data)
 	return 0;
 }
 
-AST_TEST_DEFINE(sched_test_order)
+static enum ast_test_result_state sched_order_run(struct ast_test *test, enum ast_sched_backend backend)
 {
 	struct ast_sched_context *con;
 	enum ast_test_result_state res = AST_TEST_FAIL;
 	int id1, id2, id3, wait;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "sched_test_order";
-		info->category = "/main/sched/";
-		info->summary = "Test ordering of events in the scheduler API";
-		info->description =
-			"This test ensures that events are properly ordered by the "
-			"time they are scheduled to execute in the scheduler API.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
-	if (!(con = ast_sched_context_create())) {
+	if (!(con = ast_sched_context_create_backend(backend))) {
 		ast_test_status_update(test,
 				"Test failed - could not create scheduler context\n");
 		return AST_TEST_FAIL;
@@ -262,6 +249,97 @@ return_cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(sched_test_order)
+{
+	enum ast_test_result_state res;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_order";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in the scheduler API";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute in the scheduler API. "
+			"Runs once with the heap backend and once with the timing "
+			"wheel backend.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Testing heap backend.\n");
+	res = sched_order_run(test, AST_SCHED_BACKEND_HEAP);
+	if (res == AST_TEST_FAIL) {
+		return res;
+	}
+
+	ast_test_status_update(test, "Testing timing wheel backend.\n");
+	return sched_order_run(test, AST_SCHED_BACKEND_WHEEL);
+}
+
+AST_TEST_DEFINE(sched_test_wheel_alias)
+{
+	struct ast_sched_context *con;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	int wait;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_wheel_alias";
+		info->category = "/main/sched/";
+		info->summary = "Test the wait time of a timer aliased onto a wheel cursor slot";
+		info->description =
+			"A delay just under a full level period lands in the timing "
+			"wheel cursor's own slot at that level.  This test ensures "
+			"such a timer reports a positive wait time instead of "
+			"appearing due immediately, which would busy-spin the "
+			"scheduler thread.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(con = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
+		ast_test_status_update(test,
+				"Test failed - could not create scheduler context\n");
+		return AST_TEST_FAIL;
+	}
+
+	/* Advance the wheel cursor off the level-1 slot boundary so that a
+	 * maximum level-1 delay aliases onto the cursor's own slot. */
+	if (ast_sched_add(con, 1, sched_cb, NULL) == -1) {
+		ast_test_status_update(test, "Test failed - sched_add returned -1\n");
+		goto return_cleanup;
+	}
+	usleep(10 * 1000);
+	ast_sched_runq(con);
+
+	if (ast_sched_add(con, 65535, sched_cb, NULL) == -1) {
+		ast_test_status_update(test, "Test failed - sched_add returned -1\n");
+		goto return_cleanup;
+	}
+
+	wait = ast_sched_wait(con);
+	if (wait <= 0) {
+		ast_test_status_update(test,
+				"Test failed - aliased timer reported due immediately (wait %d)\n", wait);
+		goto return_cleanup;
+	}
+	if (wait > 65535) {
+		ast_test_status_update(test,
+				"Test failed - aliased timer reported wait %d beyond its delay\n", wait);
+		goto return_cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+return_cleanup:
+	ast_sched_context_destroy(con);
+
+	return res;
+}
+
 static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	struct ast_sched_context *con;
@@ -343,6 +421,7 @@ static struct ast_cli_entry cli_sched[] = {
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(sched_test_order);
+	AST_TEST_UNREGISTER(sched_test_wheel_alias);
 	ast_cli_unregister_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return 0;
 }
@@ -350,6 +429,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(sched_test_order);
+	AST_TEST_REGISTER(sched_test_wheel_alias);
 	ast_cli_register_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return AST_MODULE_LOAD_SUCCESS;
 }
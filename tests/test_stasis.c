@@ -604,6 +604,65 @@ AST_TEST_DEFINE(unsubscribe_stops_messages)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(type_filters)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_subscription *, uut, NULL, stasis_unsubscribe);
+	RAII_VAR(char *, test_data, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, wanted_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, unwanted_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, wanted_message, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, unwanted_message, NULL, ao2_cleanup);
+	int actual_len;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test subscription message type filtering";
+		info->description = "Test subscription message type filtering";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate(test, NULL != topic);
+
+	consumer = consumer_create(1);
+	ast_test_validate(test, NULL != consumer);
+
+	uut = stasis_subscribe(topic, consumer_exec, consumer);
+	ast_test_validate(test, NULL != uut);
+	ao2_ref(consumer, +1);
+
+	ast_test_validate(test, stasis_message_type_create("WantedMessage", NULL, &wanted_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	ast_test_validate(test, stasis_message_type_create("UnwantedMessage", NULL, &unwanted_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+
+	ast_test_validate(test, 0 == stasis_subscription_accept_message_type(uut, wanted_type));
+	ast_test_validate(test, 0 == stasis_subscription_set_message_type_filter(uut, STASIS_SUBSCRIPTION_FILTER_SELECTIVE));
+
+	test_data = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data);
+	wanted_message = stasis_message_create(wanted_type, test_data);
+	unwanted_message = stasis_message_create(unwanted_type, test_data);
+
+	stasis_publish(topic, unwanted_message);
+	stasis_publish(topic, wanted_message);
+
+	/* Since delivery is in order, receiving the wanted message proves
+	 * the unwanted one was filtered out rather than just still queued. */
+	actual_len = consumer_wait_for(consumer, 1);
+	ast_test_validate(test, 1 == actual_len);
+	ast_test_validate(test, wanted_type == stasis_message_type(consumer->messages_rxed[0]));
+
+	actual_len = consumer_should_stay(consumer, 1);
+	ast_test_validate(test, 1 == actual_len);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(forward)
 {
 	RAII_VAR(struct stasis_topic *, parent_topic, NULL, ao2_cleanup);
@@ -2054,6 +2113,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(publish_sync);
 	AST_TEST_UNREGISTER(publish_pool);
 	AST_TEST_UNREGISTER(unsubscribe_stops_messages);
+	AST_TEST_UNREGISTER(type_filters);
 	AST_TEST_UNREGISTER(forward);
 	AST_TEST_UNREGISTER(cache_filter);
 	AST_TEST_UNREGISTER(cache);
@@ -2083,6 +2143,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(publish_sync);
 	AST_TEST_REGISTER(publish_pool);
 	AST_TEST_REGISTER(unsubscribe_stops_messages);
+	AST_TEST_REGISTER(type_filters);
 	AST_TEST_REGISTER(forward);
 	AST_TEST_REGISTER(cache_filter);
 	AST_TEST_REGISTER(cache);